@@ -13,6 +13,8 @@ set FILESTORAGE_SRC=%BASE_DIR%lib\*.c
 
 set FSBLOCKSTORE_SRC=%BASE_DIR%lib\fsblockstore\*.c
 
+set FASTCDCCHUNKER_SRC=%BASE_DIR%lib\fastcdcchunker\*.c
+
 set HPCDCCHUNKER_SRC=%BASE_DIR%lib\hpcdcchunker\*.c
 
 set LRUBLOCKSTORE_SRC=%BASE_DIR%lib\lrublockstore\*.c
@@ -21,14 +23,20 @@ set MEMSTORAGE_SRC=%BASE_DIR%lib\memstorage\*.c
 
 set MEOWHASH_SRC=%BASE_DIR%lib\meowhash\*.c
 
+set METRICS_SRC=%BASE_DIR%lib\metrics\*.c
+
 set COMPRESSION_REGISTRY_SRC=%BASE_DIR%lib\compressionregistry\*.c
 
 set HASH_REGISTRY_SRC=%BASE_DIR%lib\hashregistry\*.c
 
+set SEEDBLOCKSTORE_SRC=%BASE_DIR%lib\seedblockstore\*.c
+
 set SHAREBLOCKSTORE_SRC=%BASE_DIR%lib\shareblockstore\*.c
 
 set BIKESHED_SRC=%BASE_DIR%lib\bikeshed\*.c
 
+set WORKSTEALING_SRC=%BASE_DIR%lib\workstealing\*.c
+
 set BLAKE2_SRC=%BASE_DIR%lib\blake2\*.c
 set BLAKE2_THIRDPARTY_SRC=%BASE_DIR%lib\blake2\ext\*.c
 
@@ -37,6 +45,8 @@ set BLAKE3_THIRDPARTY_SRC=%BASE_DIR%lib\blake3\ext\blake3.c %BASE_DIR%lib\blake3
 set BLAKE3_THIRDPARTY_AVX2=%BASE_DIR%lib\blake3\ext\blake3_avx2.c
 set BLAKE3_THIRDPARTY_AVX512=%BASE_DIR%lib\blake3\ext\blake3_avx512.c
 
+set XXH3_SRC=%BASE_DIR%lib\xxh3\*.c
+
 set LZ4_SRC=%BASE_DIR%lib\lz4\*.c
 set LZ4_THIRDPARTY_SRC=%BASE_DIR%lib\lz4\ext\*.c
 
@@ -46,7 +56,7 @@ set BROTLI_THIRDPARTY_SRC=%BASE_DIR%lib\brotli\ext\common\*.c %BASE_DIR%lib\brot
 set ZSTD_SRC=%BASE_DIR%lib\zstd\*.c
 set ZSTD_THIRDPARTY_SRC=%BASE_DIR%lib\zstd\ext\common\*.c %BASE_DIR%lib\zstd\ext\compress\*.c %BASE_DIR%lib\zstd\ext\decompress\*.c
 
-set SRC=%BASE_DIR%src\*.c %LIB_SRC% %ATOMICCANCEL_SRC% %BLOCKSTORESTORAGE_SRC% %COMPRESSBLOCKSTORE_SRC% %CACHEBLOCKSTORE_SRC% %SHAREBLOCKSTORE_SRC% %FILESTORAGE_SRC% %FSBLOCKSTORE_SRC% %HPCDCCHUNKER_SRC% %LRUBLOCKSTORE_SRC% %MEMSTORAGE_SRC% %MEOWHASH_SRC% %COMPRESSION_REGISTRY_SRC% %HASH_REGISTRY_SRC% %BIKESHED_SRC% %BLAKE2_SRC% %BLAKE3_SRC% %LZ4_SRC% %BROTLI_SRC% %ZSTD_SRC%
+set SRC=%BASE_DIR%src\*.c %LIB_SRC% %ATOMICCANCEL_SRC% %BLOCKSTORESTORAGE_SRC% %COMPRESSBLOCKSTORE_SRC% %CACHEBLOCKSTORE_SRC% %SEEDBLOCKSTORE_SRC% %SHAREBLOCKSTORE_SRC% %FILESTORAGE_SRC% %FSBLOCKSTORE_SRC% %FASTCDCCHUNKER_SRC% %HPCDCCHUNKER_SRC% %LRUBLOCKSTORE_SRC% %MEMSTORAGE_SRC% %MEOWHASH_SRC% %METRICS_SRC% %COMPRESSION_REGISTRY_SRC% %HASH_REGISTRY_SRC% %BIKESHED_SRC% %WORKSTEALING_SRC% %BLAKE2_SRC% %BLAKE3_SRC% %XXH3_SRC% %LZ4_SRC% %BROTLI_SRC% %ZSTD_SRC%
 set THIRDPARTY_SRC=%LIB_THIRDPARTY_SRC% %BLAKE2_THIRDPARTY_SRC% %BLAKE3_THIRDPARTY_SRC% %LZ4_THIRDPARTY_SRC% %BROTLI_THIRDPARTY_SRC% %ZSTD_THIRDPARTY_SRC%
 set THIRDPARTY_SRC_SSE42=
 set THIRDPARTY_SRC_AVX2=%BLAKE3_THIRDPARTY_AVX2%
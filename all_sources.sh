@@ -15,6 +15,8 @@ FILESTORAGE_SRC="${BASE_DIR}lib/*.c"
 
 FSBLOCKSTORAGE_SRC="${BASE_DIR}lib/fsblockstore/*.c"
 
+FASTCDCCHUNKER_SRC="${BASE_DIR}lib/fastcdcchunker/*.c"
+
 HPCDCCHUNKER_SRC="${BASE_DIR}lib/hpcdcchunker/*.c"
 
 LRUBLOCKSTORE_SRC="${BASE_DIR}lib/lrublockstore/*.c"
@@ -23,14 +25,20 @@ MEMSTORAGE_SRC="${BASE_DIR}lib/memstorage/*.c"
 
 MEOWHASH_SRC="${BASE_DIR}lib/meowhash/*.c"
 
+METRICS_SRC="${BASE_DIR}lib/metrics/*.c"
+
 COMPRESSION_REGISTRY_SRC="${BASE_DIR}lib/compressionregistry/*.c"
 
 HASH_REGISTRY_SRC="${BASE_DIR}lib/hashregistry/*.c"
 
+SEEDBLOCKSTORE_SRC="${BASE_DIR}lib/seedblockstore/*.c"
+
 SHAREBLOCKSTORE_SRC="${BASE_DIR}lib/shareblockstore/*.c"
 
 BIKESHED_SRC="${BASE_DIR}lib/bikeshed/*.c"
 
+WORKSTEALING_SRC="${BASE_DIR}lib/workstealing/*.c"
+
 BLAKE2_SRC="${BASE_DIR}lib/blake2/*.c"
 BLAKE2_THIRDPARTY_SRC="${BASE_DIR}lib/blake2/ext/*.c"
 
@@ -39,6 +47,8 @@ BLAKE3_THIRDPARTY_SRC="${BASE_DIR}lib/blake3/ext/blake3.c ${BASE_DIR}lib/blake3/
 BLAKE3_THIRDPARTY_AVX2="${BASE_DIR}lib/blake3/ext/blake3_avx2.c"
 BLAKE3_THIRDPARTY_AVX512="${BASE_DIR}lib/blake3/ext/blake3_avx512.c"
 
+XXH3_SRC="${BASE_DIR}lib/xxh3/*.c"
+
 LZ4_SRC="${BASE_DIR}lib/lz4/*.c"
 LZ4_THIRDPARTY_SRC="${BASE_DIR}lib/lz4/ext/*.c"
 
@@ -48,7 +58,7 @@ BROTLI_THIRDPARTY_SRC="${BASE_DIR}lib/brotli/ext/common/*.c ${BASE_DIR}lib/brotl
 ZSTD_SRC="${BASE_DIR}lib/zstd/*.c"
 ZSTD_THIRDPARTY_SRC="${BASE_DIR}lib/zstd/ext/common/*.c ${BASE_DIR}lib/zstd/ext/compress/*.c ${BASE_DIR}lib/zstd/ext/decompress/*.c"
 
-export SRC="${BASE_DIR}src/*.c $LIB_SRC $ATOMICCANCEL_SRC $BLOCKSTORESTORAGE_SRC $COMPRESSBLOCKSTORE_SRC $CACHEBLOCKSTORE_SRC $SHAREBLOCKSTORE_SRC $FILESTORAGE_SRC $FSBLOCKSTORAGE_SRC $HPCDCCHUNKER_SRC $LRUBLOCKSTORE_SRC $MEMSTORAGE_SRC $MEOWHASH_SRC $COMPRESSION_REGISTRY_SRC $HASH_REGISTRY_SRC $BIKESHED_SRC $BLAKE2_SRC $BLAKE3_SRC $LZ4_SRC $BROTLI_SRC $ZSTD_SRC"
+export SRC="${BASE_DIR}src/*.c $LIB_SRC $ATOMICCANCEL_SRC $BLOCKSTORESTORAGE_SRC $COMPRESSBLOCKSTORE_SRC $CACHEBLOCKSTORE_SRC $SEEDBLOCKSTORE_SRC $SHAREBLOCKSTORE_SRC $FILESTORAGE_SRC $FSBLOCKSTORAGE_SRC $FASTCDCCHUNKER_SRC $HPCDCCHUNKER_SRC $LRUBLOCKSTORE_SRC $MEMSTORAGE_SRC $MEOWHASH_SRC $METRICS_SRC $COMPRESSION_REGISTRY_SRC $HASH_REGISTRY_SRC $BIKESHED_SRC $WORKSTEALING_SRC $BLAKE2_SRC $BLAKE3_SRC $XXH3_SRC $LZ4_SRC $BROTLI_SRC $ZSTD_SRC"
 export THIRDPARTY_SRC="$LIB_THIRDPARTY_SRC $BLAKE2_THIRDPARTY_SRC $BLAKE3_THIRDPARTY_SRC $LZ4_THIRDPARTY_SRC $BROTLI_THIRDPARTY_SRC $ZSTD_THIRDPARTY_SRC"
 export THIRDPARTY_SRC_SSE42=""
 export THIRDPARTY_SRC_AVX2="$BLAKE3_THIRDPARTY_AVX2"
@@ -10,13 +10,18 @@
 #include "../lib/blockstorestorage/longtail_blockstorestorage.h"
 #include "../lib/cacheblockstore/longtail_cacheblockstore.h"
 #include "../lib/compressionregistry/longtail_full_compression_registry.h"
+#include "../lib/compressionregistry/longtail_zstd_dictionary_compression_registry.h"
 #include "../lib/fsblockstore/longtail_fsblockstore.h"
+#include "../lib/fastcdcchunker/longtail_fastcdcchunker.h"
 #include "../lib/hpcdcchunker/longtail_hpcdcchunker.h"
 #include "../lib/filestorage/longtail_filestorage.h"
 #include "../lib/hashregistry/longtail_full_hash_registry.h"
 #include "../lib/lrublockstore/longtail_lrublockstore.h"
 #include "../lib/memstorage/longtail_memstorage.h"
 #include "../lib/meowhash/longtail_meowhash.h"
+#include "../lib/xxh3/longtail_xxh3.h"
+#include "../lib/metrics/longtail_metrics.h"
+#include "../lib/seedblockstore/longtail_seedblockstore.h"
 #include "../lib/shareblockstore/longtail_shareblockstore.h"
 #include "../lib/brotli/longtail_brotli.h"
 #include "../lib/lz4/longtail_lz4.h"
@@ -186,9 +191,41 @@ uint32_t ParseCompressionType(const char* compression_algorithm) {
     {
         return Longtail_GetZStdMaxQuality();
     }
+    if (strcmp("zstd_max_mt", compression_algorithm) == 0)
+    {
+        return Longtail_GetZStdMaxMTQuality();
+    }
+    return 0xffffffff;
+}
+
+uint32_t ParseChunkerType(const char* chunker_type)
+{
+    if (0 == chunker_type || (strcmp("hpcdc", chunker_type) == 0))
+    {
+        return Longtail_GetHPCDCChunkerType();
+    }
+    if (strcmp("fastcdc", chunker_type) == 0)
+    {
+        return Longtail_GetFastCDCChunkerType();
+    }
     return 0xffffffff;
 }
 
+static struct Longtail_ChunkerAPI* CreateChunkerAPI(uint32_t chunker_type)
+{
+    // Version indexes that do not record a chunker were always chunked with HPCDC
+    if (chunker_type == 0 || chunker_type == Longtail_GetHPCDCChunkerType())
+    {
+        return Longtail_CreateHPCDCChunkerAPI();
+    }
+    if (chunker_type == Longtail_GetFastCDCChunkerType())
+    {
+        return Longtail_CreateFastCDCChunkerAPI();
+    }
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Unknown chunker type %u", chunker_type)
+    return 0;
+}
+
 uint32_t ParseHashingType(const char* hashing_type)
 {
     if (0 == hashing_type || (strcmp("blake3", hashing_type) == 0))
@@ -203,6 +240,10 @@ uint32_t ParseHashingType(const char* hashing_type)
     {
         return Longtail_GetMeowHashType();
     }
+    if (strcmp("xxh3", hashing_type) == 0)
+    {
+        return Longtail_GetXXH3HashType();
+    }
     return 0xffffffff;
 }
 
@@ -305,25 +346,184 @@ static int SyncRetargetContent(struct Longtail_BlockStoreAPI* block_store, struc
     return 0;
 }
 
+static struct Longtail_CompressionRegistryAPI* CreateCompressionRegistry(struct Longtail_StorageAPI* storage_api, const char* storage_path)
+{
+    struct Longtail_CompressionRegistryAPI* full_compression_registry = Longtail_CreateFullCompressionRegistry();
+    if (!full_compression_registry)
+    {
+        return 0;
+    }
+    char* dictionary_path = storage_api->ConcatPath(storage_api, storage_path, "dictionaries");
+    struct Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateZStdDictionaryCompressionRegistry(storage_api, dictionary_path, full_compression_registry);
+    Longtail_Free(dictionary_path);
+    if (!compression_registry)
+    {
+        SAFE_DISPOSE_API(full_compression_registry);
+        return 0;
+    }
+    return compression_registry;
+}
+
+#define ZSTD_DICTIONARY_MAX_ASSET_SIZE      65536u
+#define ZSTD_DICTIONARY_MIN_ASSET_COUNT     16u
+#define ZSTD_DICTIONARY_MAX_SIZE            (112u * 1024u)
+#define ZSTD_DICTIONARY_MAX_SAMPLE_SIZE     (100u * ZSTD_DICTIONARY_MAX_SIZE)
+
+// Small assets compress poorly on their own, for each zstd tag sample the small assets into
+// a dictionary, store it with the block store and retag the small asset chunks to use it
+static int CreateZStdDictionaries(
+    struct Longtail_StorageAPI* storage_api,
+    const char* storage_path,
+    const char* source_path,
+    struct Longtail_VersionIndex* version_index)
+{
+    const uint32_t zstd_types[3] = {Longtail_GetZStdMinQuality(), Longtail_GetZStdDefaultQuality(), Longtail_GetZStdMaxQuality()};
+    uint32_t asset_count = *version_index->m_AssetCount;
+    uint32_t* small_assets = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * (asset_count + 1));
+    if (!small_assets)
+    {
+        return ENOMEM;
+    }
+    char* dictionary_path = storage_api->ConcatPath(storage_api, storage_path, "dictionaries");
+    int err = 0;
+    for (uint32_t t = 0; t < 3 && !err; ++t)
+    {
+        uint32_t small_asset_count = 0;
+        uint64_t small_assets_size = 0;
+        for (uint32_t a = 0; a < asset_count; ++a)
+        {
+            uint64_t asset_size = version_index->m_AssetSizes[a];
+            if (asset_size == 0 || asset_size > ZSTD_DICTIONARY_MAX_ASSET_SIZE)
+            {
+                continue;
+            }
+            uint32_t chunk_index = version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[a]];
+            if (version_index->m_ChunkTags[chunk_index] != zstd_types[t])
+            {
+                continue;
+            }
+            small_assets[small_asset_count++] = a;
+            small_assets_size += asset_size;
+        }
+        if (small_asset_count < ZSTD_DICTIONARY_MIN_ASSET_COUNT)
+        {
+            continue;
+        }
+
+        uint32_t sample_stride = (uint32_t)(small_assets_size / ZSTD_DICTIONARY_MAX_SAMPLE_SIZE) + 1;
+        uint32_t max_sample_count = (small_asset_count + sample_stride - 1) / sample_stride;
+        void** samples = (void**)Longtail_Alloc((sizeof(void*) + sizeof(size_t)) * max_sample_count);
+        if (!samples)
+        {
+            err = ENOMEM;
+            break;
+        }
+        size_t* sample_sizes = (size_t*)&samples[max_sample_count];
+        uint32_t sample_count = 0;
+        for (uint32_t i = 0; i < small_asset_count && !err; i += sample_stride)
+        {
+            uint32_t a = small_assets[i];
+            const char* asset_path = &version_index->m_NameData[version_index->m_NameOffsets[a]];
+            char* full_path = storage_api->ConcatPath(storage_api, source_path, asset_path);
+            Longtail_StorageAPI_HOpenFile f;
+            err = storage_api->OpenReadFile(storage_api, full_path, &f);
+            if (!err)
+            {
+                size_t sample_size = (size_t)version_index->m_AssetSizes[a];
+                void* sample = Longtail_Alloc(sample_size);
+                err = sample ? storage_api->Read(storage_api, f, 0, sample_size, sample) : ENOMEM;
+                storage_api->CloseFile(storage_api, f);
+                if (!err)
+                {
+                    samples[sample_count] = sample;
+                    sample_sizes[sample_count] = sample_size;
+                    ++sample_count;
+                }
+                else
+                {
+                    Longtail_Free(sample);
+                }
+            }
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to read dictionary sample `%s`, %d", full_path, err);
+            }
+            Longtail_Free(full_path);
+        }
+
+        void* dictionary_data = 0;
+        size_t dictionary_size = 0;
+        if (!err)
+        {
+            err = Longtail_CreateZStdDictionary(sample_count, (const void* const*)samples, sample_sizes, ZSTD_DICTIONARY_MAX_SIZE, &dictionary_data, &dictionary_size);
+        }
+        for (uint32_t s = 0; s < sample_count; ++s)
+        {
+            Longtail_Free(samples[s]);
+        }
+        Longtail_Free(samples);
+
+        uint32_t dictionary_type = 0;
+        if (!err)
+        {
+            err = Longtail_WriteZStdDictionary(storage_api, dictionary_path, dictionary_data, dictionary_size, &dictionary_type);
+            Longtail_Free(dictionary_data);
+        }
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to create zstd dictionary in `%s`, %d", dictionary_path, err);
+            break;
+        }
+
+        for (uint32_t i = 0; i < small_asset_count; ++i)
+        {
+            uint32_t a = small_assets[i];
+            uint32_t chunk_index_start = version_index->m_AssetChunkIndexStarts[a];
+            for (uint32_t c = 0; c < version_index->m_AssetChunkCounts[a]; ++c)
+            {
+                version_index->m_ChunkTags[version_index->m_AssetChunkIndexes[chunk_index_start + c]] = dictionary_type;
+            }
+        }
+    }
+    Longtail_Free(dictionary_path);
+    Longtail_Free(small_assets);
+    return err;
+}
+
+static struct Longtail_JobAPI* CreateJobAPI(uint32_t io_worker_count, uint32_t max_io_jobs)
+{
+    const uint32_t class_worker_counts[LONGTAIL_JOB_CLASS_COUNT] = {0, io_worker_count};
+    const uint32_t class_max_in_flight[LONGTAIL_JOB_CLASS_COUNT] = {0, max_io_jobs};
+    return Longtail_CreateBikeshedJobAPIWithClasses(Longtail_GetCPUCount(), 0, class_worker_counts, class_max_in_flight);
+}
+
 int UpSync(
     const char* storage_uri_raw,
     const char* source_path,
     const char* optional_source_index_path,
+    const char* optional_previous_index_path,
     const char* target_index_path,
     const char* optional_target_version_content_index_path,
     uint32_t target_chunk_size,
     uint32_t target_block_size,
     uint32_t max_chunks_per_block,
     uint32_t hashing_type,
-    uint32_t compression_type)
+    uint32_t chunker_type,
+    uint32_t compression_type,
+    int enable_zstd_dictionaries,
+    int sorted_store_index,
+    int segmented_store_index,
+    uint32_t min_frame_size,
+    uint32_t io_worker_count,
+    uint32_t max_io_jobs)
 {
     const char* storage_path = NormalizePath(storage_uri_raw);
     struct Longtail_HashRegistryAPI* hash_registry = Longtail_CreateFullHashRegistry();
-    struct Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(Longtail_GetCPUCount(), 0);
-    struct Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
+    struct Longtail_JobAPI* job_api = CreateJobAPI(io_worker_count, max_io_jobs);
     struct Longtail_StorageAPI* storage_api = Longtail_CreateFSStorageAPI();
-    struct Longtail_BlockStoreAPI* store_block_fsstore_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, storage_path, target_block_size, max_chunks_per_block, 0);
-    struct Longtail_BlockStoreAPI* store_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_fsstore_api, compression_registry);
+    struct Longtail_CompressionRegistryAPI* compression_registry = CreateCompressionRegistry(storage_api, storage_path);
+    struct Longtail_BlockStoreAPI* store_block_fsstore_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, storage_path, target_block_size, max_chunks_per_block, 0, sorted_store_index, segmented_store_index);
+    struct Longtail_BlockStoreAPI* store_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_fsstore_api, compression_registry, min_frame_size);
 
     struct Longtail_VersionIndex* source_version_index = 0;
     if (optional_source_index_path)
@@ -350,7 +550,7 @@ int UpSync(
         SAFE_DISPOSE_API(hash_registry);
         return err;
     }
-    struct Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    struct Longtail_ChunkerAPI* chunker_api = CreateChunkerAPI(chunker_type);
     if (!chunker_api)
     {
         Longtail_Free(source_version_index);
@@ -393,10 +593,20 @@ int UpSync(
         {
             tags[i] = compression_type;
         }
+        struct Longtail_VersionIndex* previous_version_index = 0;
+        if (optional_previous_index_path)
+        {
+            err = Longtail_ReadVersionIndex(storage_api, optional_previous_index_path, &previous_version_index);
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to read previous version index from `%s`, %d", optional_previous_index_path, err);
+                previous_version_index = 0;
+            }
+        }
         {
             struct Progress create_version_progress;
             Progress_Init(&create_version_progress, "Indexing version");
-            err = Longtail_CreateVersionIndex(
+            err = Longtail_CreateVersionIndexIncremental(
                 storage_api,
                 hash_api,
                 chunker_api,
@@ -408,9 +618,11 @@ int UpSync(
                 file_infos,
                 tags,
                 target_chunk_size,
+                previous_version_index,
                 &source_version_index);
             Progress_Dispose(&create_version_progress);
         }
+        Longtail_Free(previous_version_index);
         Longtail_Free(tags);
         Longtail_Free(file_infos);
         if (err)
@@ -427,6 +639,29 @@ int UpSync(
             return err;
         }
     }
+    if (enable_zstd_dictionaries)
+    {
+        err = CreateZStdDictionaries(
+            storage_api,
+            storage_path,
+            source_path,
+            source_version_index);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to create zstd dictionaries for `%s`, %d", source_path, err);
+            Longtail_Free(source_version_index);
+            SAFE_DISPOSE_API(chunker_api);
+            SAFE_DISPOSE_API(store_block_store_api);
+            SAFE_DISPOSE_API(store_block_fsstore_api);
+            SAFE_DISPOSE_API(storage_api);
+            SAFE_DISPOSE_API(compression_registry);
+            SAFE_DISPOSE_API(hash_registry);
+            SAFE_DISPOSE_API(job_api);
+            Longtail_Free((char*)storage_path);
+            return err;
+        }
+    }
+
     struct Longtail_ContentIndex* version_content_index = 0;
     err = Longtail_CreateContentIndex(
         hash_api,
@@ -622,13 +857,15 @@ int DownSync(
     int retain_permissions,
     uint32_t target_chunk_size,
     uint32_t target_block_size,
-    uint32_t max_chunks_per_block)
+    uint32_t max_chunks_per_block,
+    uint32_t io_worker_count,
+    uint32_t max_io_jobs)
 {
     const char* storage_path = NormalizePath(storage_uri_raw);
-    struct Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(Longtail_GetCPUCount(), 0);
+    struct Longtail_JobAPI* job_api = CreateJobAPI(io_worker_count, max_io_jobs);
     struct Longtail_HashRegistryAPI* hash_registry = Longtail_CreateFullHashRegistry();
-    struct Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
     struct Longtail_StorageAPI* storage_api = Longtail_CreateFSStorageAPI();
+    struct Longtail_CompressionRegistryAPI* compression_registry = CreateCompressionRegistry(storage_api, storage_path);
     struct Longtail_BlockStoreAPI* store_block_remotestore_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, storage_path, target_block_size, max_chunks_per_block, 0);
     struct Longtail_BlockStoreAPI* store_block_localstore_api = 0;
     struct Longtail_BlockStoreAPI* store_block_cachestore_api = 0;
@@ -637,14 +874,14 @@ int DownSync(
     {
         store_block_localstore_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, cache_path, target_block_size, max_chunks_per_block, 0);
         store_block_cachestore_api = Longtail_CreateCacheBlockStoreAPI(job_api, store_block_localstore_api, store_block_remotestore_api);
-        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_cachestore_api, compression_registry);
+        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_cachestore_api, compression_registry, 0);
     }
     else
     {
-        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_remotestore_api, compression_registry);
+        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_remotestore_api, compression_registry, 0);
     }
 
-    struct Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(compress_block_store_api, 32);
+    struct Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(compress_block_store_api, 0, 32u * (uint64_t)target_block_size, 1);
     struct Longtail_BlockStoreAPI* store_block_store_api = Longtail_CreateShareBlockStoreAPI(lru_block_store_api);
 
     struct Longtail_VersionIndex* source_version_index = 0;
@@ -686,7 +923,8 @@ int DownSync(
         return err;
     }
 
-    struct Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    // The target folder must be chunked the same way as the source version for unchanged assets to match
+    struct Longtail_ChunkerAPI* chunker_api = CreateChunkerAPI(Longtail_VersionIndex_GetChunkerAPI(source_version_index));
     if (!chunker_api)
     {
         Longtail_Free(source_version_index);
@@ -704,6 +942,27 @@ int DownSync(
         return ENOMEM;
     }
 
+    // Files moved aside by an interrupted downsync must be back in place before the target folder is indexed
+    err = Longtail_RecoverSeedBlockStoreStash(storage_api, target_path);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to restore files left by an interrupted update of `%s`, %d", target_path, err);
+        Longtail_Free(source_version_index);
+        SAFE_DISPOSE_API(chunker_api);
+        SAFE_DISPOSE_API(store_block_store_api);
+        SAFE_DISPOSE_API(lru_block_store_api);
+        SAFE_DISPOSE_API(compress_block_store_api);
+        SAFE_DISPOSE_API(store_block_cachestore_api);
+        SAFE_DISPOSE_API(store_block_localstore_api);
+        SAFE_DISPOSE_API(store_block_remotestore_api);
+        SAFE_DISPOSE_API(storage_api);
+        SAFE_DISPOSE_API(compression_registry);
+        SAFE_DISPOSE_API(hash_registry);
+        SAFE_DISPOSE_API(job_api);
+        Longtail_Free((void*)storage_path);
+        return err;
+    }
+
     struct Longtail_VersionIndex* target_version_index = 0;
     if (optional_target_index_path)
     {
@@ -897,11 +1156,20 @@ int DownSync(
     Longtail_Free(source_version_content_index);
     source_version_content_index = retargetted_version_content_index;
 
+    // Blocks whose chunks are already present in the target folder are rebuilt locally instead of being fetched
+    struct Longtail_BlockStoreAPI* seed_block_store_api = Longtail_CreateSeedBlockStoreAPI(
+        storage_api,
+        hash_api,
+        target_version_index,
+        version_diff,
+        target_path,
+        store_block_store_api);
+
     {
         struct Progress change_version_progress;
         Progress_Init(&change_version_progress, "Updating version");
         err = Longtail_ChangeVersion(
-            store_block_store_api,
+            seed_block_store_api ? seed_block_store_api : store_block_store_api,
             storage_api,
             hash_api,
             job_api,
@@ -916,6 +1184,7 @@ int DownSync(
             retain_permissions ? 1 : 0);
         Progress_Dispose(&change_version_progress);
     }
+    SAFE_DISPOSE_API(seed_block_store_api);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to update version `%s` from `%s` using `%s`, %d", target_path, source_path, storage_uri_raw, err);
@@ -969,6 +1238,41 @@ int SetLogLevel(const char* log_level_raw)
     return 0;
 }
 
+int WriteMetrics(struct Longtail_MetricsAPI* metrics_api, const char* metrics_path, const char* metrics_format_raw)
+{
+    char* text = 0;
+    int err = 0;
+    if (0 == strcmp(metrics_format_raw, "json"))
+    {
+        err = Longtail_Metrics_FormatJSON(metrics_api, &text);
+    }
+    else if (0 == strcmp(metrics_format_raw, "prometheus"))
+    {
+        err = Longtail_Metrics_FormatPrometheus(metrics_api, &text);
+    }
+    else
+    {
+        printf("Invalid metrics format `%s`\n", metrics_format_raw);
+        return EINVAL;
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to format metrics, %d", err)
+        return err;
+    }
+    FILE* f = fopen(metrics_path, "wb");
+    if (!f)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to open metrics file `%s`", metrics_path)
+        Longtail_Free(text);
+        return EACCES;
+    }
+    fputs(text, f);
+    fclose(f);
+    Longtail_Free(text);
+    return 0;
+}
+
 int ValidateVersionIndex(
     const char* storage_uri_raw,
     const char* version_index_path,
@@ -1087,7 +1391,7 @@ int VersionIndex_ls(
 
 
     struct Longtail_VersionIndex* version_index = 0;
-    int err = Longtail_ReadVersionIndex(storage_api, version_index_path, &version_index);
+    int err = Longtail_MapVersionIndex(storage_api, version_index_path, &version_index);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to read version index from `%s`, %d", version_index_path, err);
@@ -1105,6 +1409,7 @@ int VersionIndex_ls(
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Can not create hashing API for version index `%s`, failed with %d", version_index_path, err);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(fake_block_store);
         SAFE_DISPOSE_API(fake_block_store_fs);
         SAFE_DISPOSE_API(storage_api);
@@ -1132,6 +1437,7 @@ int VersionIndex_ls(
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to create file system for version index `%s`, failed with %d", version_index_path, err);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(fake_block_store);
         SAFE_DISPOSE_API(fake_block_store_fs);
@@ -1148,6 +1454,7 @@ int VersionIndex_ls(
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to create file iteration for version index `%s`, failed with %d", version_index_path, err);
         SAFE_DISPOSE_API(block_store_fs);
         Longtail_Free(content_index);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(fake_block_store);
         SAFE_DISPOSE_API(fake_block_store_fs);
         SAFE_DISPOSE_API(storage_api);
@@ -1182,6 +1489,7 @@ int VersionIndex_ls(
     
     SAFE_DISPOSE_API(block_store_fs);
     Longtail_Free(content_index);
+    Longtail_UnmapVersionIndex(version_index);
     SAFE_DISPOSE_API(fake_block_store);
     SAFE_DISPOSE_API(fake_block_store_fs);
     SAFE_DISPOSE_API(storage_api);
@@ -1198,14 +1506,17 @@ int VersionIndex_cp(
     uint32_t target_block_size,
     uint32_t max_chunks_per_block,
     const char* source_path,
-    const char* target_path)
+    const char* target_path,
+    int partial_decompression,
+    uint32_t io_worker_count,
+    uint32_t max_io_jobs)
 {
     const char* storage_path = NormalizePath(storage_uri_raw);
 
-    struct Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(Longtail_GetCPUCount(), 0);
+    struct Longtail_JobAPI* job_api = CreateJobAPI(io_worker_count, max_io_jobs);
     struct Longtail_HashRegistryAPI* hash_registry = Longtail_CreateFullHashRegistry();
-    struct Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
     struct Longtail_StorageAPI* storage_api = Longtail_CreateFSStorageAPI();
+    struct Longtail_CompressionRegistryAPI* compression_registry = CreateCompressionRegistry(storage_api, storage_path);
     struct Longtail_BlockStoreAPI* store_block_remotestore_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, storage_path, target_block_size, max_chunks_per_block, 0);
     struct Longtail_BlockStoreAPI* store_block_localstore_api = 0;
     struct Longtail_BlockStoreAPI* store_block_cachestore_api = 0;
@@ -1214,18 +1525,19 @@ int VersionIndex_cp(
     {
         store_block_localstore_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, cache_path, target_block_size, max_chunks_per_block, 0);
         store_block_cachestore_api = Longtail_CreateCacheBlockStoreAPI(job_api, store_block_localstore_api, store_block_remotestore_api);
-        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_cachestore_api, compression_registry);
     }
-    else
+    struct Longtail_BlockStoreAPI* raw_block_store_api = store_block_cachestore_api ? store_block_cachestore_api : store_block_remotestore_api;
+    if (!partial_decompression)
     {
-        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(store_block_remotestore_api, compression_registry);
+        compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(raw_block_store_api, compression_registry, 0);
     }
 
-    struct Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(compress_block_store_api, 32);
+    // With partial decompression the blocks are kept compressed and only the frames a read needs are decompressed
+    struct Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(partial_decompression ? raw_block_store_api : compress_block_store_api, 0, 32u * (uint64_t)target_block_size, 1);
     struct Longtail_BlockStoreAPI* store_block_store_api = Longtail_CreateShareBlockStoreAPI(lru_block_store_api);
 
     struct Longtail_VersionIndex* version_index = 0;
-    int err = Longtail_ReadVersionIndex(storage_api, version_index_path, &version_index);
+    int err = Longtail_MapVersionIndex(storage_api, version_index_path, &version_index);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Failed to read version index from `%s`, %d", version_index_path, err);
@@ -1254,6 +1566,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1279,6 +1592,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1302,6 +1616,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1323,6 +1638,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1331,10 +1647,11 @@ int VersionIndex_cp(
         return err;
     }
 
-    struct Longtail_StorageAPI* block_store_fs = Longtail_CreateBlockStoreStorageAPI(
+    struct Longtail_StorageAPI* block_store_fs = Longtail_CreateBlockStoreStorageAPIWithCompression(
         hash_api,
         job_api,
         store_block_store_api,
+        partial_decompression ? compression_registry : 0,
         block_store_content_index,
         version_index);
     if (err)
@@ -1347,6 +1664,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1368,6 +1686,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1389,6 +1708,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1410,6 +1730,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1446,6 +1767,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1466,6 +1788,7 @@ int VersionIndex_cp(
         SAFE_DISPOSE_API(store_block_cachestore_api);
         SAFE_DISPOSE_API(store_block_localstore_api);
         SAFE_DISPOSE_API(store_block_remotestore_api);
+        Longtail_UnmapVersionIndex(version_index);
         SAFE_DISPOSE_API(storage_api);
         SAFE_DISPOSE_API(compression_registry);
         SAFE_DISPOSE_API(hash_registry);
@@ -1482,6 +1805,7 @@ int VersionIndex_cp(
     SAFE_DISPOSE_API(store_block_cachestore_api);
     SAFE_DISPOSE_API(store_block_localstore_api);
     SAFE_DISPOSE_API(store_block_remotestore_api);
+    Longtail_UnmapVersionIndex(version_index);
     SAFE_DISPOSE_API(storage_api);
     SAFE_DISPOSE_API(compression_registry);
     SAFE_DISPOSE_API(hash_registry);
@@ -1511,6 +1835,18 @@ int main(int argc, char** argv)
     int32_t max_chunks_per_block = 0;
     kgflags_int("max-chunks-per-block", 1024, "Max chunks per block", false, &max_chunks_per_block);
 
+    int32_t io_worker_count = 0;
+    kgflags_int("io-worker-count", 0, "Extra workers that only run disk I/O jobs", false, &io_worker_count);
+
+    int32_t max_io_jobs = 0;
+    kgflags_int("max-io-jobs", 0, "Max disk I/O jobs running at once, 0 for no limit. I/O jobs read and write asset files and read blocks from the store, including decompressing them. Compressing and storing new blocks runs as CPU jobs and is not limited. Use a low value for spinning disks", false, &max_io_jobs);
+
+    const char* metrics_path_raw = 0;
+    kgflags_string("metrics-path", 0, "Optional file to write timing and throughput metrics to when the command completes", false, &metrics_path_raw);
+
+    const char* metrics_format_raw = 0;
+    kgflags_string("metrics-format", "json", "Format of the metrics file (json, prometheus)", false, &metrics_format_raw);
+
     if (argc < 2)
     {
         kgflags_set_custom_description("Use command `upsync`, `downsync`, `validate`, `ls` or `cp`");
@@ -1530,13 +1866,26 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    if (metrics_path_raw && (strcmp(metrics_format_raw, "json") != 0) && (strcmp(metrics_format_raw, "prometheus") != 0))
+    {
+        printf("Invalid metrics format `%s`\n", metrics_format_raw);
+        return 1;
+    }
+
+    // Collecting is cheap, the metrics are only written if --metrics-path is given
+    struct Longtail_MetricsAPI* metrics_api = Longtail_CreateMetricsAPI();
+    Longtail_SetMetrics(metrics_api);
+
     int err = 0;
     if (strcmp(command, "upsync") == 0){
         const char* storage_uri_raw = 0;
         kgflags_string("storage-uri", 0, "URI for chunks and content index for store", true, &storage_uri_raw);
 
         const char* hasing_raw = 0;
-        kgflags_string("hash-algorithm", "blake3", "Hashing algorithm: blake2, blake3, meow", false, &hasing_raw);
+        kgflags_string("hash-algorithm", "blake3", "Hashing algorithm: blake2, blake3, meow, xxh3", false, &hasing_raw);
+
+        const char* chunker_raw = 0;
+        kgflags_string("chunker", "hpcdc", "Chunking algorithm: hpcdc, fastcdc", false, &chunker_raw);
 
         const char* source_path_raw = 0;
         kgflags_string("source-path", 0, "Source folder path", true, &source_path_raw);
@@ -1544,6 +1893,9 @@ int main(int argc, char** argv)
         const char* source_index_raw = 0;
         kgflags_string("source-index-path", 0, "Optional pre-computed index of source-path", false, &source_index_raw);
 
+        const char* previous_index_raw = 0;
+        kgflags_string("previous-index-path", 0, "Optional index of an earlier upsync of source-path, unchanged files reuse its chunks", false, &previous_index_raw);
+
         const char* target_path_raw = 0;
         kgflags_string("target-path", 0, "Target file path", true, &target_path_raw);
 
@@ -1551,7 +1903,19 @@ int main(int argc, char** argv)
         kgflags_string("version-content-index-path", 0, "Optional path to store minimal content index for version", false, &optional_version_content_index_path_raw);
 
         const char* compression_raw = 0;
-        kgflags_string("compression-algorithm", "zstd", "Comression algorithm: none, brotli, brotli_min, brotli_max, brotli_text, brotli_text_min, brotli_text_max, lz4, zstd, zstd_min, zstd_max", false, &compression_raw);
+        kgflags_string("compression-algorithm", "zstd", "Comression algorithm: none, brotli, brotli_min, brotli_max, brotli_text, brotli_text_min, brotli_text_max, lz4, zstd, zstd_min, zstd_max, zstd_max_mt", false, &compression_raw);
+
+        bool zstd_dictionaries_raw = false;
+        kgflags_bool("zstd-dictionaries", false, "Compress small files with zstd dictionaries stored in the store", false, &zstd_dictionaries_raw);
+
+        bool sorted_store_index_raw = false;
+        kgflags_bool("sorted-store-index", false, "Write the store index with sorted chunk lookup, it can not be read by older clients", false, &sorted_store_index_raw);
+
+        bool segmented_store_index_raw = false;
+        kgflags_bool("segmented-store-index", false, "Write added blocks to store index segments instead of rewriting the store index, older clients do not see them until they are compacted", false, &segmented_store_index_raw);
+
+        int min_frame_size = 0;
+        kgflags_int("min-frame-size", 0, "Compress blocks in independent frames of at least this size so cp can decompress parts of a block, 0 compresses whole blocks", false, &min_frame_size);
 
         if (!kgflags_parse(argc, argv)) {
             kgflags_print_errors();
@@ -1578,8 +1942,16 @@ int main(int argc, char** argv)
             return 1;
         }
 
+        uint32_t chunker = ParseChunkerType(chunker_raw);
+        if (chunker == 0xffffffff)
+        {
+            printf("Invalid chunker `%s`\n", chunker_raw);
+            return 1;
+        }
+
         const char* source_path = NormalizePath(source_path_raw);
         const char* source_index = source_index_raw ? NormalizePath(source_index_raw) : 0;
+        const char* previous_index = previous_index_raw ? NormalizePath(previous_index_raw) : 0;
         const char* target_path = NormalizePath(target_path_raw);
         const char* optional_target_version_content_index_path = optional_version_content_index_path_raw ? NormalizePath(optional_version_content_index_path_raw) : 0;
 
@@ -1587,16 +1959,25 @@ int main(int argc, char** argv)
             storage_uri_raw,
             source_path,
             source_index,
+            previous_index,
             target_path,
             optional_target_version_content_index_path,
             target_chunk_size,
             target_block_size,
             max_chunks_per_block,
             hashing,
-            compression);
+            chunker,
+            compression,
+            zstd_dictionaries_raw,
+            sorted_store_index_raw,
+            segmented_store_index_raw,
+            (uint32_t)min_frame_size,
+            io_worker_count,
+            max_io_jobs);
 
         Longtail_Free((void*)source_path);
         Longtail_Free((void*)source_index);
+        Longtail_Free((void*)previous_index);
         Longtail_Free((void*)target_path);
     }
     else if (strcmp(command, "downsync") == 0)
@@ -1645,7 +2026,9 @@ int main(int argc, char** argv)
             retain_permission_raw,
             target_chunk_size,
             target_block_size,
-            max_chunks_per_block);
+            max_chunks_per_block,
+            io_worker_count,
+            max_io_jobs);
 
         Longtail_Free((void*)source_path);
         Longtail_Free((void*)target_index);
@@ -1723,6 +2106,9 @@ int main(int argc, char** argv)
         const char* version_index_path_raw = 0;
         kgflags_string("version-index-path", 0, "Version index file path", true, &version_index_path_raw);
 
+        bool partial_decompression_raw = false;
+        kgflags_bool("partial-decompression", false, "Only decompress the parts of blocks that are read, for stores upsynced with --min-frame-size", false, &partial_decompression_raw);
+
         if (!kgflags_parse(argc, argv)) {
             kgflags_print_errors();
             kgflags_print_usage();
@@ -1751,8 +2137,18 @@ int main(int argc, char** argv)
             target_block_size,
             max_chunks_per_block,
             source_path,
-            target_path);
+            target_path,
+            partial_decompression_raw,
+            io_worker_count,
+            max_io_jobs);
+    }
+    if (metrics_path_raw)
+    {
+        int metrics_err = WriteMetrics(metrics_api, metrics_path_raw, metrics_format_raw);
+        err = err ? err : metrics_err;
     }
+    Longtail_SetMetrics(0);
+    SAFE_DISPOSE_API(metrics_api);
 #if defined(_CRTDBG_MAP_ALLOC)
     _CrtDumpMemoryLeaks();
 #endif
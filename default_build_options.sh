@@ -1,4 +1,4 @@
 #!/bin/bash
 
-export CXXFLAGS="$CXXFLAGS -pthread -U_WIN32 -DLONGTAIL_LOG_LEVEL=5 -msse4.1 -maes"
-export CXXFLAGS_DEBUG="$CXXFLAGS_DEBUG -DBIKESHED_ASSERTS -DLONGTAIL_LOG_LEVEL=3 -DLONGTAIL_ASSERTS -msse4.1 -maes"
+export CXXFLAGS="$CXXFLAGS -pthread -U_WIN32 -DLONGTAIL_LOG_LEVEL=5 -DLONGTAIL_LOG_MIN_LEVEL=1 -DZSTD_MULTITHREAD -msse4.1 -maes"
+export CXXFLAGS_DEBUG="$CXXFLAGS_DEBUG -DBIKESHED_ASSERTS -DLONGTAIL_LOG_LEVEL=3 -DLONGTAIL_ASSERTS -DZSTD_MULTITHREAD -msse4.1 -maes"
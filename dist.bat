@@ -25,6 +25,7 @@ mkdir dist\include\lib\brotli
 mkdir dist\include\lib\cacheblockstore
 mkdir dist\include\lib\compressblockstore
 mkdir dist\include\lib\compressionregistry
+mkdir dist\include\lib\fastcdcchunker
 mkdir dist\include\lib\filestorage
 mkdir dist\include\lib\fsblockstore
 mkdir dist\include\lib\hpcdcchunker
@@ -33,7 +34,11 @@ mkdir dist\include\lib\hashregistry
 mkdir dist\include\lib\lz4
 mkdir dist\include\lib\memstorage
 mkdir dist\include\lib\meowhash
+mkdir dist\include\lib\metrics
+mkdir dist\include\lib\seedblockstore
 mkdir dist\include\lib\shareblockstore
+mkdir dist\include\lib\workstealing
+mkdir dist\include\lib\xxh3
 mkdir dist\include\lib\zstd
 cp src/*.h dist/include/src
 cp lib/atomiccancel/*.h dist/include/lib/atomiccancel
@@ -47,11 +52,16 @@ cp lib/compressblockstore/*.h dist/include/lib/compressblockstore
 cp lib/compressionregistry/*.h dist/include/lib/compressionregistry
 cp lib/filestorage/*.h dist/include/lib/filestorage
 cp lib/fsblockstore/*.h dist/include/lib/fsblockstore
+cp lib/fastcdcchunker/*.h dist/include/lib/fastcdcchunker
 cp lib/hpcdcchunker/*.h dist/include/lib/hpcdcchunker
 cp lib/lrublockstore/*.h dist/include/lib/lrublockstore
 cp lib/hashregistry/*.h dist/include/lib/hashregistry
 cp lib/lz4/*.h dist/include/lib/lz4
 cp lib/memstorage/*.h dist/include/lib/memstorage
 cp lib/meowhash/*.h dist/include/lib/meowhash
+cp lib/metrics/*.h dist/include/lib/metrics
+cp lib/seedblockstore/*.h dist/include/lib/seedblockstore
 cp lib/shareblockstore/*.h dist/include/lib/shareblockstore
+cp lib/workstealing/*.h dist/include/lib/workstealing
+cp lib/xxh3/*.h dist/include/lib/xxh3
 cp lib/zstd/*.h dist/include/lib/zstd
@@ -7,15 +7,23 @@
 
 #include <errno.h>
 
+// m_Semaphore wakes workers that run any job class, m_ClassSemaphores wakes workers dedicated to one class
 struct ReadyCallback
 {
     struct Bikeshed_ReadyCallback cb;
     HLongtail_Sema m_Semaphore;
+    HLongtail_Sema m_ClassSemaphores[LONGTAIL_JOB_CLASS_COUNT];
+    uint32_t m_ClassWorkerCounts[LONGTAIL_JOB_CLASS_COUNT];
 };
 
 static void ReadyCallback_Dispose(struct ReadyCallback* ready_callback)
 {
     LONGTAIL_FATAL_ASSERT(ready_callback, return)
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        Longtail_DeleteSema(ready_callback->m_ClassSemaphores[c]);
+        Longtail_Free(ready_callback->m_ClassSemaphores[c]);
+    }
     Longtail_DeleteSema(ready_callback->m_Semaphore);
     Longtail_Free(ready_callback->m_Semaphore);
 }
@@ -23,37 +31,119 @@ static void ReadyCallback_Dispose(struct ReadyCallback* ready_callback)
 static void ReadyCallback_Ready(struct Bikeshed_ReadyCallback* ready_callback, uint8_t channel, uint32_t ready_count)
 {
     LONGTAIL_FATAL_ASSERT(ready_callback, return)
+    LONGTAIL_FATAL_ASSERT(channel < LONGTAIL_JOB_CLASS_COUNT, return)
     struct ReadyCallback* cb = (struct ReadyCallback*)ready_callback;
+    // Nobody waits on the semaphore of a class without dedicated workers, posting would only grow its count
+    if (cb->m_ClassWorkerCounts[channel] > 0)
+    {
+        Longtail_PostSema(cb->m_ClassSemaphores[channel], ready_count);
+    }
     Longtail_PostSema(cb->m_Semaphore, ready_count);
 }
 
-static void ReadyCallback_Wait(struct ReadyCallback* ready_callback)
-{
-    LONGTAIL_FATAL_ASSERT(ready_callback, return)
-    Longtail_WaitSema(ready_callback->m_Semaphore, LONGTAIL_TIMEOUT_INFINITE);
-}
-
-static int ReadyCallback_Init(struct ReadyCallback* ready_callback)
+static int ReadyCallback_Init(struct ReadyCallback* ready_callback, const uint32_t* optional_class_worker_counts)
 {
     LONGTAIL_FATAL_ASSERT(ready_callback, return EINVAL)
     ready_callback->cb.SignalReady = ReadyCallback_Ready;
-    return Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &ready_callback->m_Semaphore);
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        ready_callback->m_ClassWorkerCounts[c] = optional_class_worker_counts ? optional_class_worker_counts[c] : 0;
+    }
+    int err = Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &ready_callback->m_Semaphore);
+    if (err)
+    {
+        return err;
+    }
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        err = Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &ready_callback->m_ClassSemaphores[c]);
+        if (err)
+        {
+            while (c-- > 0)
+            {
+                Longtail_DeleteSema(ready_callback->m_ClassSemaphores[c]);
+                Longtail_Free(ready_callback->m_ClassSemaphores[c]);
+            }
+            Longtail_DeleteSema(ready_callback->m_Semaphore);
+            Longtail_Free(ready_callback->m_Semaphore);
+            return err;
+        }
+    }
+    return 0;
 }
 
+struct ThreadWorker;
+
+struct BikeshedJobAPI
+{
+    struct Longtail_JobAPI m_BikeshedAPI;
+
+    struct ReadyCallback m_ReadyCallback;
+    Bikeshed m_Shed;
+    uint32_t m_WorkerCount;
+    struct ThreadWorker* m_Workers;
+    int m_WorkerPriority;
+    int32_t volatile m_Stop;
+    uint32_t m_ClassMaxInFlight[LONGTAIL_JOB_CLASS_COUNT];
+    TLongtail_Atomic32 m_ClassInFlight[LONGTAIL_JOB_CLASS_COUNT];
+};
+
+#define BIKESHED_ALL_JOB_CLASSES ((1u << LONGTAIL_JOB_CLASS_COUNT) - 1u)
+
+// Executes one ready job of a class in class_mask, classes that are at their in-flight limit are skipped
+static int Bikeshed_ExecuteOneJob(struct BikeshedJobAPI* job_api, uint32_t class_mask, uint32_t first_class)
+{
+    LONGTAIL_FATAL_ASSERT(job_api, return 0)
+    for (uint32_t i = 0; i < LONGTAIL_JOB_CLASS_COUNT; ++i)
+    {
+        uint32_t job_class = (first_class + i) % LONGTAIL_JOB_CLASS_COUNT;
+        if ((class_mask & (1u << job_class)) == 0)
+        {
+            continue;
+        }
+        uint32_t max_in_flight = job_api->m_ClassMaxInFlight[job_class];
+        if (max_in_flight == 0)
+        {
+            if (Bikeshed_ExecuteOne(job_api->m_Shed, (uint8_t)job_class))
+            {
+                return 1;
+            }
+            continue;
+        }
+        if (Longtail_AtomicAdd32(&job_api->m_ClassInFlight[job_class], 1) > (int32_t)max_in_flight)
+        {
+            Longtail_AtomicAdd32(&job_api->m_ClassInFlight[job_class], -1);
+            continue;
+        }
+        int executed = Bikeshed_ExecuteOne(job_api->m_Shed, (uint8_t)job_class);
+        Longtail_AtomicAdd32(&job_api->m_ClassInFlight[job_class], -1);
+        if (executed)
+        {
+            // A worker may have skipped a job of this class while we held the slot
+            ReadyCallback_Ready(&job_api->m_ReadyCallback.cb, (uint8_t)job_class, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
 
 struct ThreadWorker
 {
-    int32_t volatile*   stop;
-    Bikeshed            shed;
-    HLongtail_Sema        semaphore;
-    HLongtail_Thread      thread;
+    int32_t volatile*       stop;
+    struct BikeshedJobAPI*  job_api;
+    uint32_t                class_mask;
+    uint32_t                first_class;
+    HLongtail_Sema          semaphore;
+    HLongtail_Thread        thread;
 };
 
 static void ThreadWorker_Init(struct ThreadWorker* thread_worker)
 {
     LONGTAIL_FATAL_ASSERT(thread_worker, return)
     thread_worker->stop = 0;
-    thread_worker->shed = 0;
+    thread_worker->job_api = 0;
+    thread_worker->class_mask = 0;
+    thread_worker->first_class = 0;
     thread_worker->semaphore = 0;
     thread_worker->thread = 0;
 }
@@ -66,7 +156,7 @@ static int32_t ThreadWorker_Execute(void* context)
     LONGTAIL_FATAL_ASSERT(thread_worker->stop, return 0)
     while (*thread_worker->stop == 0)
     {
-        if (!Bikeshed_ExecuteOne(thread_worker->shed, 0))
+        if (!Bikeshed_ExecuteOneJob(thread_worker->job_api, thread_worker->class_mask, thread_worker->first_class))
         {
             Longtail_WaitSema(thread_worker->semaphore, LONGTAIL_TIMEOUT_INFINITE);
         }
@@ -74,13 +164,16 @@ static int32_t ThreadWorker_Execute(void* context)
     return 0;
 }
 
-static int ThreadWorker_CreateThread(struct ThreadWorker* thread_worker, Bikeshed in_shed, int worker_priority, HLongtail_Sema in_semaphore, int32_t volatile* in_stop)
+static int ThreadWorker_CreateThread(struct ThreadWorker* thread_worker, struct BikeshedJobAPI* in_job_api, uint32_t in_class_mask, uint32_t in_first_class, int worker_priority, HLongtail_Sema in_semaphore, int32_t volatile* in_stop)
 {
     LONGTAIL_FATAL_ASSERT(thread_worker, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(in_shed, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(in_job_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(in_class_mask, return EINVAL)
     LONGTAIL_FATAL_ASSERT(in_semaphore, return EINVAL)
     LONGTAIL_FATAL_ASSERT(in_stop, return EINVAL)
-    thread_worker->shed               = in_shed;
+    thread_worker->job_api            = in_job_api;
+    thread_worker->class_mask         = in_class_mask;
+    thread_worker->first_class        = in_first_class;
     thread_worker->stop               = in_stop;
     thread_worker->semaphore          = in_semaphore;
     return Longtail_CreateThread(Longtail_Alloc(Longtail_GetThreadSize()), ThreadWorker_Execute, 0, thread_worker, worker_priority, &thread_worker->thread);
@@ -112,18 +205,6 @@ struct JobWrapper
     void* m_Context;
 };
 
-struct BikeshedJobAPI
-{
-    struct Longtail_JobAPI m_BikeshedAPI;
-
-    struct ReadyCallback m_ReadyCallback;
-    Bikeshed m_Shed;
-    uint32_t m_WorkerCount;
-    struct ThreadWorker* m_Workers;
-    int m_WorkerPriority;
-    int32_t volatile m_Stop;
-};
-
 struct Bikeshed_JobAPI_Group
 {
     struct BikeshedJobAPI* m_API;
@@ -231,12 +312,14 @@ static int Bikeshed_CreateJobs(
     uint32_t job_count,
     Longtail_JobAPI_JobFunc job_funcs[],
     void* job_contexts[],
+    uint32_t job_class,
     Longtail_JobAPI_Jobs* out_jobs)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Bikeshed_CreateJobs(%p, %u, %p, %p, %p)", job_api, job_count, job_funcs, job_contexts, out_jobs)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Bikeshed_CreateJobs(%p, %u, %p, %p, %u, %p)", job_api, job_count, job_funcs, job_contexts, job_class, out_jobs)
     LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(job_funcs, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(job_contexts, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_class < LONGTAIL_JOB_CLASS_COUNT, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(out_jobs, return EINVAL)
     int err = EINVAL;
     struct BikeshedJobAPI* bikeshed_job_api = (struct BikeshedJobAPI*)job_api;
@@ -292,7 +375,11 @@ static int Bikeshed_CreateJobs(
 
     while (!Bikeshed_CreateTasks(bikeshed_job_api->m_Shed, job_count, func, ctx, task_ids))
     {
-        Bikeshed_ExecuteOne(bikeshed_job_api->m_Shed, 0);
+        Bikeshed_ExecuteOneJob(bikeshed_job_api, BIKESHED_ALL_JOB_CLASSES, 0);
+    }
+    if (job_class != 0)
+    {
+        Bikeshed_SetTasksChannel(bikeshed_job_api->m_Shed, job_count, task_ids, (uint8_t)job_class);
     }
 
     Longtail_AtomicAdd32(&bikeshed_job_group->m_PendingJobCount, (int)job_count);
@@ -303,8 +390,8 @@ end:
     Longtail_Free(work_mem);
     return err;
 on_error:
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Bikeshed_CreateJobs(%p, %p, %u, %p, %p, %p) failed with %d",
-        job_api, job_group, job_count, job_funcs, job_contexts, out_jobs,
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Bikeshed_CreateJobs(%p, %p, %u, %p, %p, %u, %p) failed with %d",
+        job_api, job_group, job_count, job_funcs, job_contexts, job_class, out_jobs,
         err)
     Longtail_AtomicAdd32(&bikeshed_job_group->m_SubmittedJobCount, -((int32_t)job_count));
     goto end;
@@ -320,7 +407,7 @@ static int Bikeshed_AddDependecies(struct Longtail_JobAPI* job_api, uint32_t job
     struct BikeshedJobAPI* bikeshed_job_api = (struct BikeshedJobAPI*)job_api;
     while (!Bikeshed_AddDependencies(bikeshed_job_api->m_Shed, job_count, (Bikeshed_TaskID*)jobs, dependency_job_count, (Bikeshed_TaskID*)dependency_jobs))
     {
-        Bikeshed_ExecuteOne(bikeshed_job_api->m_Shed, 0);
+        Bikeshed_ExecuteOneJob(bikeshed_job_api, BIKESHED_ALL_JOB_CLASSES, 0);
     }
     return 0;
 }
@@ -359,7 +446,7 @@ static int Bikeshed_WaitForAllJobs(struct Longtail_JobAPI* job_api, Longtail_Job
                 }
             }
         }
-        if (Bikeshed_ExecuteOne(bikeshed_job_api->m_Shed, 0))
+        if (Bikeshed_ExecuteOneJob(bikeshed_job_api, BIKESHED_ALL_JOB_CLASSES, 0))
         {
             continue;
         }
@@ -398,7 +485,10 @@ static void Bikeshed_Dispose(struct Longtail_API* job_api)
     LONGTAIL_VALIDATE_INPUT(job_api, return)
     struct BikeshedJobAPI* bikeshed_job_api = (struct BikeshedJobAPI*)job_api;
     Longtail_AtomicAdd32(&bikeshed_job_api->m_Stop, 1);
-    ReadyCallback_Ready(&bikeshed_job_api->m_ReadyCallback.cb, 0, bikeshed_job_api->m_WorkerCount);
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        ReadyCallback_Ready(&bikeshed_job_api->m_ReadyCallback.cb, (uint8_t)c, bikeshed_job_api->m_WorkerCount);
+    }
     for (uint32_t i = 0; i < bikeshed_job_api->m_WorkerCount; ++i)
     {
         ThreadWorker_JoinThread(&bikeshed_job_api->m_Workers[i]);
@@ -413,7 +503,7 @@ static void Bikeshed_Dispose(struct Longtail_API* job_api)
     Longtail_Free(bikeshed_job_api);
 }
 
-static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count, int worker_priority)
+static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count, int worker_priority, const uint32_t* optional_class_worker_counts, const uint32_t* optional_class_max_in_flight)
 {
     LONGTAIL_FATAL_ASSERT(job_api, return EINVAL)
     job_api->m_BikeshedAPI.m_API.Dispose = Bikeshed_Dispose;
@@ -429,8 +519,14 @@ static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count,
     job_api->m_Workers = 0;
     job_api->m_WorkerPriority = worker_priority;
     job_api->m_Stop = 0;
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        job_api->m_WorkerCount += optional_class_worker_counts ? optional_class_worker_counts[c] : 0;
+        job_api->m_ClassMaxInFlight[c] = optional_class_max_in_flight ? optional_class_max_in_flight[c] : 0;
+        job_api->m_ClassInFlight[c] = 0;
+    }
 
-    int err = ReadyCallback_Init(&job_api->m_ReadyCallback);
+    int err = ReadyCallback_Init(&job_api->m_ReadyCallback, optional_class_worker_counts);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Bikeshed_Init(%p, %u) failed with %d",
@@ -439,7 +535,7 @@ static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count,
         return err;
     }
 
-    job_api->m_Shed = Bikeshed_Create(Longtail_Alloc(BIKESHED_SIZE(1048576, 7340032, 1)), 1048576, 7340032, 1, &job_api->m_ReadyCallback.cb);
+    job_api->m_Shed = Bikeshed_Create(Longtail_Alloc(BIKESHED_SIZE(1048576, 7340032, LONGTAIL_JOB_CLASS_COUNT)), 1048576, 7340032, LONGTAIL_JOB_CLASS_COUNT, &job_api->m_ReadyCallback.cb);
     if (!job_api->m_Shed)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Bikeshed_Init(%p, %u) failed with %d",
@@ -458,10 +554,26 @@ static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count,
         ReadyCallback_Dispose(&job_api->m_ReadyCallback);
         return ENOMEM;
     }
+    uint32_t class_worker_start = worker_count;
+    uint32_t job_class = 0;
     for (uint32_t i = 0; i < job_api->m_WorkerCount; ++i)
     {
+        // General workers run all classes with alternating preference, the rest are dedicated to one class
+        uint32_t class_mask = BIKESHED_ALL_JOB_CLASSES;
+        uint32_t first_class = i % LONGTAIL_JOB_CLASS_COUNT;
+        HLongtail_Sema semaphore = job_api->m_ReadyCallback.m_Semaphore;
+        if (i >= worker_count)
+        {
+            while (i >= class_worker_start + optional_class_worker_counts[job_class])
+            {
+                class_worker_start += optional_class_worker_counts[job_class++];
+            }
+            class_mask = 1u << job_class;
+            first_class = job_class;
+            semaphore = job_api->m_ReadyCallback.m_ClassSemaphores[job_class];
+        }
         ThreadWorker_Init(&job_api->m_Workers[i]);
-        err = ThreadWorker_CreateThread(&job_api->m_Workers[i], job_api->m_Shed, job_api->m_WorkerPriority, job_api->m_ReadyCallback.m_Semaphore, &job_api->m_Stop);
+        err = ThreadWorker_CreateThread(&job_api->m_Workers[i], job_api, class_mask, first_class, job_api->m_WorkerPriority, semaphore, &job_api->m_Stop);
         if (err)
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Bikeshed_Init(%p, %u) failed with %d",
@@ -482,15 +594,21 @@ static int Bikeshed_Init(struct BikeshedJobAPI* job_api, uint32_t worker_count,
 
 struct Longtail_JobAPI* Longtail_CreateBikeshedJobAPI(uint32_t worker_count, int worker_priority)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateBikeshedJobAPI(%u)", worker_count)
+    return Longtail_CreateBikeshedJobAPIWithClasses(worker_count, worker_priority, 0, 0);
+}
+
+struct Longtail_JobAPI* Longtail_CreateBikeshedJobAPIWithClasses(uint32_t worker_count, int worker_priority, const uint32_t* optional_class_worker_counts, const uint32_t* optional_class_max_in_flight)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateBikeshedJobAPIWithClasses(%u, %d, %p, %p)", worker_count, worker_priority, optional_class_worker_counts, optional_class_max_in_flight)
     LONGTAIL_VALIDATE_INPUT(worker_priority >= -1 && worker_priority <= 1, return 0)
     struct BikeshedJobAPI* job_api = (struct BikeshedJobAPI*)Longtail_Alloc(sizeof(struct BikeshedJobAPI));
-    int err = Bikeshed_Init(job_api, worker_count, worker_priority);
+    int err = Bikeshed_Init(job_api, worker_count, worker_priority, optional_class_worker_counts, optional_class_max_in_flight);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBikeshedJobAPI(%u) failed with %d",
-            worker_count,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBikeshedJobAPIWithClasses(%u, %d, %p, %p) failed with %d",
+            worker_count, worker_priority, optional_class_worker_counts, optional_class_max_in_flight,
             err)
+        Longtail_Free(job_api);
         return 0;
     }
     return &job_api->m_BikeshedAPI;
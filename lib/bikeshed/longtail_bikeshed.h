@@ -8,6 +8,11 @@ extern "C" {
 
 LONGTAIL_EXPORT extern struct Longtail_JobAPI* Longtail_CreateBikeshedJobAPI(uint32_t worker_count, int worker_priority);
 
+// optional_class_worker_counts adds workers that only run jobs of one class (LONGTAIL_JOB_CLASS_COUNT entries).
+// optional_class_max_in_flight limits how many jobs of each class execute at once, 0 means no limit.
+// Use a low I/O limit for spinning disks and more I/O workers for NVMe drives.
+LONGTAIL_EXPORT extern struct Longtail_JobAPI* Longtail_CreateBikeshedJobAPIWithClasses(uint32_t worker_count, int worker_priority, const uint32_t* optional_class_worker_counts, const uint32_t* optional_class_max_in_flight);
+
 #ifdef __cplusplus
 }
 #endif
@@ -92,6 +92,7 @@ static void Blake2Hash_Init(struct Blake2HashAPI* hash_api)
     hash_api->m_Blake2HashAPI.Hash = Blake2Hash_Hash;
     hash_api->m_Blake2HashAPI.EndContext = Blake2Hash_EndContext;
     hash_api->m_Blake2HashAPI.HashBuffer = Blake2Hash_HashBuffer;
+    hash_api->m_Blake2HashAPI.HashBuffers = 0;
 }
 
 struct Longtail_HashAPI* Longtail_CreateBlake2HashAPI()
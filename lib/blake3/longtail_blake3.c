@@ -1,6 +1,7 @@
 #include "longtail_blake3.h"
 
 #include "ext/blake3.h"
+#include "ext/blake3_impl.h"
 #include <errno.h>
 
 const uint32_t LONGTAIL_BLAKE3_HASH_TYPE = (((uint32_t)'b') << 24) + (((uint32_t)'l') << 16) + (((uint32_t)'k') << 8) + ((uint32_t)'3');
@@ -65,6 +66,219 @@ static int Blake3Hash_HashBuffer(struct Longtail_HashAPI* hash_api, uint32_t len
     return 0;
 }
 
+// Buffers up to BLAKE3_BATCH_MAX_LENGTH are hashed side by side, one buffer per SIMD lane, larger
+// buffers have enough chunks of their own to fill the lanes and are hashed one at a time
+#define BLAKE3_BATCH_BUFFER_COUNT 16
+#define BLAKE3_BATCH_MAX_CHUNK_COUNT 16
+#define BLAKE3_BATCH_MAX_LENGTH (BLAKE3_BATCH_MAX_CHUNK_COUNT * BLAKE3_CHUNK_LEN)
+#define BLAKE3_BATCH_LANE_COUNT 64
+
+struct Blake3Batch
+{
+    uint8_t m_CVs[BLAKE3_BATCH_BUFFER_COUNT][BLAKE3_BATCH_MAX_CHUNK_COUNT][BLAKE3_OUT_LEN];
+    uint32_t m_CVCounts[BLAKE3_BATCH_BUFFER_COUNT];
+    const uint8_t* m_LaneInputs[BLAKE3_BATCH_LANE_COUNT];
+    uint8_t* m_LaneOutputs[BLAKE3_BATCH_LANE_COUNT];
+    uint8_t m_LaneResults[BLAKE3_BATCH_LANE_COUNT][BLAKE3_OUT_LEN];
+    uint32_t m_LaneCount;
+};
+
+static void Blake3Batch_FlushLanes(struct Blake3Batch* batch, size_t block_count, uint64_t counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end)
+{
+    if (batch->m_LaneCount == 0)
+    {
+        return;
+    }
+    blake3_hash_many(batch->m_LaneInputs, batch->m_LaneCount, block_count, IV, counter, false, flags, flags_start, flags_end, &batch->m_LaneResults[0][0]);
+    for (uint32_t l = 0; l < batch->m_LaneCount; ++l)
+    {
+        memcpy(batch->m_LaneOutputs[l], batch->m_LaneResults[l], BLAKE3_OUT_LEN);
+    }
+    batch->m_LaneCount = 0;
+}
+
+static void Blake3Batch_AddLane(struct Blake3Batch* batch, const uint8_t* input, uint8_t* output, size_t block_count, uint64_t counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end)
+{
+    if (batch->m_LaneCount == BLAKE3_BATCH_LANE_COUNT)
+    {
+        Blake3Batch_FlushLanes(batch, block_count, counter, flags, flags_start, flags_end);
+    }
+    batch->m_LaneInputs[batch->m_LaneCount] = input;
+    batch->m_LaneOutputs[batch->m_LaneCount] = output;
+    ++batch->m_LaneCount;
+}
+
+// Hashes the last, possibly partial, chunk of a buffer. If it is the only chunk the result is the
+// root and goes to out_hash, otherwise it is the chunk chaining value and goes to out_cv
+static void Blake3HashLastChunk(const uint8_t* data, uint32_t length, uint64_t chunk_counter, uint8_t* out_cv, uint64_t* out_hash)
+{
+    uint32_t cv[8];
+    memcpy(cv, IV, sizeof(cv));
+    uint8_t flags = CHUNK_START;
+    while (length > BLAKE3_BLOCK_LEN)
+    {
+        blake3_compress_in_place(cv, data, BLAKE3_BLOCK_LEN, chunk_counter, flags);
+        flags = 0;
+        data += BLAKE3_BLOCK_LEN;
+        length -= BLAKE3_BLOCK_LEN;
+    }
+    uint8_t block[BLAKE3_BLOCK_LEN];
+    memset(block, 0, sizeof(block));
+    if (length > 0)
+    {
+        memcpy(block, data, length);
+    }
+    flags |= CHUNK_END;
+    if (chunk_counter == 0)
+    {
+        uint8_t root[BLAKE3_BLOCK_LEN];
+        blake3_compress_xof(cv, block, (uint8_t)length, 0, flags | ROOT, root);
+        memcpy(out_hash, root, sizeof(uint64_t));
+        return;
+    }
+    blake3_compress_in_place(cv, block, (uint8_t)length, chunk_counter, flags);
+    for (uint32_t w = 0; w < 8; ++w)
+    {
+        out_cv[w * 4 + 0] = (uint8_t)(cv[w]);
+        out_cv[w * 4 + 1] = (uint8_t)(cv[w] >> 8);
+        out_cv[w * 4 + 2] = (uint8_t)(cv[w] >> 16);
+        out_cv[w * 4 + 3] = (uint8_t)(cv[w] >> 24);
+    }
+}
+
+// Hashes up to BLAKE3_BATCH_BUFFER_COUNT buffers of at most BLAKE3_BATCH_MAX_LENGTH bytes each.
+// Chunk n of every buffer shares the chunk counter so they can be compressed in the same
+// blake3_hash_many call, the parent nodes of each tree level are batched the same way.
+static void Blake3HashBatch(struct Blake3Batch* batch, uint32_t buffer_count, const uint32_t* buffer_indexes, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes)
+{
+    uint32_t max_full_chunk_count = 0;
+    for (uint32_t b = 0; b < buffer_count; ++b)
+    {
+        uint32_t length = lengths[buffer_indexes[b]];
+        // The last chunk is finalized separately, even when it is complete
+        uint32_t full_chunk_count = length > 0 ? (length - 1) / BLAKE3_CHUNK_LEN : 0;
+        batch->m_CVCounts[b] = full_chunk_count;
+        max_full_chunk_count = full_chunk_count > max_full_chunk_count ? full_chunk_count : max_full_chunk_count;
+    }
+
+    batch->m_LaneCount = 0;
+    for (uint32_t chunk = 0; chunk < max_full_chunk_count; ++chunk)
+    {
+        for (uint32_t b = 0; b < buffer_count; ++b)
+        {
+            if (chunk < batch->m_CVCounts[b])
+            {
+                const uint8_t* chunk_data = &((const uint8_t*)data[buffer_indexes[b]])[chunk * BLAKE3_CHUNK_LEN];
+                Blake3Batch_AddLane(batch, chunk_data, batch->m_CVs[b][chunk], BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, chunk, 0, CHUNK_START, CHUNK_END);
+            }
+        }
+        Blake3Batch_FlushLanes(batch, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, chunk, 0, CHUNK_START, CHUNK_END);
+    }
+
+    for (uint32_t b = 0; b < buffer_count; ++b)
+    {
+        uint32_t i = buffer_indexes[b];
+        uint32_t full_chunk_count = batch->m_CVCounts[b];
+        const uint8_t* last_chunk_data = &((const uint8_t*)data[i])[full_chunk_count * BLAKE3_CHUNK_LEN];
+        Blake3HashLastChunk(last_chunk_data, lengths[i] - full_chunk_count * BLAKE3_CHUNK_LEN, full_chunk_count, batch->m_CVs[b][full_chunk_count], &out_hashes[i]);
+        batch->m_CVCounts[b] = full_chunk_count + 1;
+    }
+
+    // Merge pairs of chaining values level by level, an odd one out moves up a level unchanged
+    // which gives the same left-balanced tree as the incremental hasher
+    int merging = 1;
+    while (merging)
+    {
+        merging = 0;
+        for (uint32_t b = 0; b < buffer_count; ++b)
+        {
+            uint32_t cv_count = batch->m_CVCounts[b];
+            if (cv_count <= 2)
+            {
+                continue;
+            }
+            for (uint32_t p = 0; p < cv_count / 2; ++p)
+            {
+                Blake3Batch_AddLane(batch, batch->m_CVs[b][p * 2], batch->m_CVs[b][p], 1, 0, PARENT, 0, 0);
+            }
+            merging = 1;
+        }
+        Blake3Batch_FlushLanes(batch, 1, 0, PARENT, 0, 0);
+        for (uint32_t b = 0; b < buffer_count; ++b)
+        {
+            uint32_t cv_count = batch->m_CVCounts[b];
+            if (cv_count <= 2)
+            {
+                continue;
+            }
+            if (cv_count & 1)
+            {
+                memcpy(batch->m_CVs[b][cv_count / 2], batch->m_CVs[b][cv_count - 1], BLAKE3_OUT_LEN);
+            }
+            batch->m_CVCounts[b] = (cv_count + 1) / 2;
+        }
+    }
+
+    for (uint32_t b = 0; b < buffer_count; ++b)
+    {
+        if (batch->m_CVCounts[b] == 2)
+        {
+            uint8_t root[BLAKE3_BLOCK_LEN];
+            blake3_compress_xof(IV, batch->m_CVs[b][0], BLAKE3_BLOCK_LEN, 0, PARENT | ROOT, root);
+            memcpy(&out_hashes[buffer_indexes[b]], root, sizeof(uint64_t));
+        }
+    }
+}
+
+static int Blake3Hash_HashBuffers(struct Longtail_HashAPI* hash_api, uint32_t count, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || lengths, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || data, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || out_hashes, return EINVAL)
+    if (count == 1)
+    {
+        return Blake3Hash_HashBuffer(hash_api, lengths[0], data[0], &out_hashes[0]);
+    }
+    struct Blake3Batch* batch = (struct Blake3Batch*)Longtail_Alloc(sizeof(struct Blake3Batch));
+    if (!batch)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Blake3Hash_HashBuffers(%p, %u, %p, %p, %p) failed with %d",
+            hash_api, count, lengths, data, out_hashes,
+            ENOMEM)
+        return ENOMEM;
+    }
+    uint32_t i = 0;
+    while (i < count)
+    {
+        uint32_t buffer_indexes[BLAKE3_BATCH_BUFFER_COUNT];
+        uint32_t buffer_count = 0;
+        while (i < count && buffer_count < BLAKE3_BATCH_BUFFER_COUNT)
+        {
+            if (lengths[i] > BLAKE3_BATCH_MAX_LENGTH)
+            {
+                int err = Blake3Hash_HashBuffer(hash_api, lengths[i], data[i], &out_hashes[i]);
+                if (err)
+                {
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Blake3Hash_HashBuffers(%p, %u, %p, %p, %p) failed with %d",
+                        hash_api, count, lengths, data, out_hashes,
+                        err)
+                    Longtail_Free(batch);
+                    return err;
+                }
+            }
+            else
+            {
+                buffer_indexes[buffer_count++] = i;
+            }
+            ++i;
+        }
+        Blake3HashBatch(batch, buffer_count, buffer_indexes, lengths, data, out_hashes);
+    }
+    Longtail_Free(batch);
+    return 0;
+}
+
 static void Blake3Hash_Dispose(struct Longtail_API* hash_api)
 {
     LONGTAIL_FATAL_ASSERT(hash_api, return)
@@ -80,6 +294,7 @@ static void Blake3Hash_Init(struct Blake3HashAPI* hash_api)
     hash_api->m_Blake3HashAPI.Hash = Blake3Hash_Hash;
     hash_api->m_Blake3HashAPI.EndContext = Blake3Hash_EndContext;
     hash_api->m_Blake3HashAPI.HashBuffer = Blake3Hash_HashBuffer;
+    hash_api->m_Blake3HashAPI.HashBuffers = Blake3Hash_HashBuffers;
 }
 
 struct Longtail_HashAPI* Longtail_CreateBlake3HashAPI()
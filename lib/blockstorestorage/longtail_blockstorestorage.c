@@ -1,6 +1,8 @@
 #include "longtail_blockstorestorage.h"
 
 #include "../../src/ext/stb_ds.h"
+#include "../compressblockstore/longtail_compressblockstore.h"
+#include "../longtail_platform.h"
 
 #include <errno.h>
 #include <inttypes.h>
@@ -198,6 +200,7 @@ struct BlockStoreStorageAPI
     struct Longtail_HashAPI* m_HashAPI;
     struct Longtail_JobAPI* m_JobAPI;
     struct Longtail_BlockStoreAPI* m_BlockStore;
+    struct Longtail_CompressionRegistryAPI* m_CompressionRegistry;
     struct Longtail_ContentIndex* m_ContentIndex;
     struct Longtail_VersionIndex* m_VersionIndex;
     struct Longtail_LookupTable* m_ChunkHashToBlockIndexLookup;
@@ -205,11 +208,45 @@ struct BlockStoreStorageAPI
     uint64_t* m_ChunkAssetOffsets;
 };
 
+// Once a file is read sequentially the blocks ahead of the read position are fetched in the
+// background by IO jobs that the read does not wait for. Each open file keeps a small window of
+// fetched blocks so small reads do not fetch and decompress the same block over and over.
+#define BLOCKSTORESTORAGE_SEQUENTIAL_READ_COUNT 2
+#define BLOCKSTORESTORAGE_PREFETCH_BLOCK_COUNT 2
+#define BLOCKSTORESTORAGE_PREFETCH_MAX_CHUNK_SCAN 4096
+#define BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE (BLOCKSTORESTORAGE_PREFETCH_BLOCK_COUNT + 2)
+
+#define BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY 0
+#define BLOCKSTORESTORAGE_WINDOW_BLOCK_PENDING 1
+#define BLOCKSTORESTORAGE_WINDOW_BLOCK_READY 2
+
+struct BlockStoreStorageAPI_OpenFile;
+
+struct BlockStoreStorageAPI_WindowBlock
+{
+    struct Longtail_AsyncGetStoredBlockAPI m_AsyncCompleteAPI;
+    struct BlockStoreStorageAPI* m_BlockStoreFS;
+    struct BlockStoreStorageAPI_OpenFile* m_BlockStoreFile;
+    HLongtail_Sema m_CompleteSema;
+    TLongtail_Hash m_BlockHash;
+    struct Longtail_StoredBlock* m_StoredBlock;
+    struct Longtail_LookupTable* m_ChunkLookup;
+    uint64_t m_LastUse;
+    int m_Err;
+    int m_State;
+};
+
 struct BlockStoreStorageAPI_OpenFile
 {
     uint32_t m_AssetIndex;
     uint32_t m_SeekChunkOffset;
     uint64_t m_SeekAssetPos;
+    uint64_t m_NextReadPos;
+    uint32_t m_SequentialReadCount;
+    uint64_t m_UseCounter;
+    Longtail_JobAPI_Group m_PrefetchJobGroup;
+    TLongtail_Atomic32 m_PrefetchJobCount;
+    struct BlockStoreStorageAPI_WindowBlock m_WindowBlocks[BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE];
 };
 
 struct BlockStoreStorageAPI_ChunkRange
@@ -226,27 +263,20 @@ struct BlockStoreStorageAPI_BlockRange
     struct BlockStoreStorageAPI_ChunkRange value;
 };
 
-static int BlockStoreStorageAPI_ReadFromBlock(
-    struct Longtail_StoredBlock* stored_block,
-    struct BlockStoreStorageAPI_ChunkRange* range,
-    struct BlockStoreStorageAPI* block_store_fs,
-    struct BlockStoreStorageAPI_OpenFile* block_store_file,
-    uint64_t start,
-    uint64_t size,
-    char* buffer,
-    const uint32_t* chunk_indexes)
+// Maps the chunk hashes of a block to their index in the block (high 32 bits) and their offset in the
+// uncompressed block data (low 32 bits), free with Longtail_Free
+static struct Longtail_LookupTable* BlockStoreStorageAPI_CreateBlockChunkLookup(struct Longtail_StoredBlock* stored_block)
 {
-    uint64_t read_end = start + size;
     uint32_t chunk_block_offset = 0;
     uint32_t chunk_count = *stored_block->m_BlockIndex->m_ChunkCount;
     size_t block_chunk_lookup_size = Longtail_LookupTable_GetSize(chunk_count);
     void* work_mem = Longtail_Alloc(block_chunk_lookup_size);
     if (work_mem == 0)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFromBlock(%p, %p, %p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
-            stored_block, range, block_store_fs, block_store_file, start, size, buffer, chunk_indexes,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_CreateBlockChunkLookup(%p) failed with %d",
+            stored_block,
             ENOMEM)
-        return ENOMEM;
+        return 0;
     }
     const TLongtail_Hash* block_chunk_hashes = stored_block->m_BlockIndex->m_ChunkHashes;
     const uint32_t* block_chunk_sizes = stored_block->m_BlockIndex->m_ChunkSizes;
@@ -254,11 +284,100 @@ static int BlockStoreStorageAPI_ReadFromBlock(
     for (uint32_t c = 0; c < chunk_count; ++c)
     {
         TLongtail_Hash chunk_hash = block_chunk_hashes[c];
-        Longtail_LookupTable_Put(block_chunk_lookup, chunk_hash, chunk_block_offset);
+        Longtail_LookupTable_Put(block_chunk_lookup, chunk_hash, ((uint64_t)c << 32) | chunk_block_offset);
         chunk_block_offset += block_chunk_sizes[c];
     }
+    return block_chunk_lookup;
+}
+
+// Decompresses the chunks of a compressed block that range reads, from the first to the last of them in the block.
+// out_data_offset is where the decompressed data starts in the uncompressed block data
+static int BlockStoreStorageAPI_DecompressChunkSpan(
+    struct Longtail_StoredBlock* stored_block,
+    struct Longtail_LookupTable* block_chunk_lookup,
+    struct BlockStoreStorageAPI_ChunkRange* range,
+    struct BlockStoreStorageAPI* block_store_fs,
+    const uint32_t* chunk_indexes,
+    char** out_data,
+    uint32_t* out_data_offset)
+{
+    const TLongtail_Hash* version_chunk_hashes = block_store_fs->m_VersionIndex->m_ChunkHashes;
+    const uint32_t* block_chunk_sizes = stored_block->m_BlockIndex->m_ChunkSizes;
+    uint32_t block_chunk_start = 0xffffffffu;
+    uint32_t block_chunk_end = 0;
+    uint32_t data_start = 0;
+    uint32_t data_end = 0;
+    for (uint32_t c = range->m_ChunkStart; c < range->m_ChunkEnd; ++c)
+    {
+        const uint64_t* chunk_block_location = Longtail_LookupTable_Get(block_chunk_lookup, version_chunk_hashes[chunk_indexes[c]]);
+        if (chunk_block_location == 0)
+        {
+            continue;
+        }
+        uint32_t block_chunk_index = (uint32_t)(*chunk_block_location >> 32);
+        uint32_t chunk_block_offset = (uint32_t)*chunk_block_location;
+        if (block_chunk_index < block_chunk_start)
+        {
+            block_chunk_start = block_chunk_index;
+            data_start = chunk_block_offset;
+        }
+        if (block_chunk_index >= block_chunk_end)
+        {
+            block_chunk_end = block_chunk_index + 1;
+            data_end = chunk_block_offset + block_chunk_sizes[block_chunk_index];
+        }
+    }
+    *out_data = 0;
+    *out_data_offset = data_start;
+    if (data_end <= data_start)
+    {
+        return 0;
+    }
+    char* data = (char*)Longtail_Alloc(data_end - data_start);
+    if (!data)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_DecompressChunkSpan(%p, %p, %p, %p, %p, %p, %p) failed with %d",
+            stored_block, block_chunk_lookup, range, block_store_fs, chunk_indexes, out_data, out_data_offset,
+            ENOMEM)
+        return ENOMEM;
+    }
+    int err = Longtail_DecompressBlockChunkRange(block_store_fs->m_CompressionRegistry, stored_block, block_chunk_start, block_chunk_end, data);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_DecompressChunkSpan(%p, %p, %p, %p, %p, %p, %p) failed with %d",
+            stored_block, block_chunk_lookup, range, block_store_fs, chunk_indexes, out_data, out_data_offset,
+            err)
+        Longtail_Free(data);
+        return err;
+    }
+    *out_data = data;
+    return 0;
+}
+
+static int BlockStoreStorageAPI_CopyFromBlock(
+    struct Longtail_StoredBlock* stored_block,
+    struct Longtail_LookupTable* block_chunk_lookup,
+    struct BlockStoreStorageAPI_ChunkRange* range,
+    struct BlockStoreStorageAPI* block_store_fs,
+    uint64_t start,
+    uint64_t size,
+    char* buffer,
+    const uint32_t* chunk_indexes)
+{
+    uint64_t read_end = start + size;
     uint64_t asset_offset = range->m_AssetStartOffset;
     const char* block_data = (char*)stored_block->m_BlockData;
+    uint32_t block_data_offset = 0;
+    char* decompressed_data = 0;
+    if (block_store_fs->m_CompressionRegistry)
+    {
+        int err = BlockStoreStorageAPI_DecompressChunkSpan(stored_block, block_chunk_lookup, range, block_store_fs, chunk_indexes, &decompressed_data, &block_data_offset);
+        if (err)
+        {
+            return err;
+        }
+        block_data = decompressed_data;
+    }
     const TLongtail_Hash* version_chunk_hashes = block_store_fs->m_VersionIndex->m_ChunkHashes;
     const uint32_t* version_chunk_sizes = block_store_fs->m_VersionIndex->m_ChunkSizes;
     for (uint32_t c = range->m_ChunkStart; c < range->m_ChunkEnd; ++c)
@@ -267,7 +386,7 @@ static int BlockStoreStorageAPI_ReadFromBlock(
         TLongtail_Hash chunk_hash = version_chunk_hashes[chunk_index];
         uint32_t chunk_size = version_chunk_sizes[chunk_index];
         uint64_t asset_offset_chunk_end = asset_offset + chunk_size;
-        LONGTAIL_FATAL_ASSERT(asset_offset_chunk_end >= start, return EINVAL)
+        LONGTAIL_FATAL_ASSERT(asset_offset_chunk_end >= start, Longtail_Free(decompressed_data); return EINVAL)
 
         uint64_t* chunk_block_offset_ptr = Longtail_LookupTable_Get(block_chunk_lookup, chunk_hash);
         if (chunk_block_offset_ptr == 0)
@@ -289,10 +408,40 @@ static int BlockStoreStorageAPI_ReadFromBlock(
         }
 
         uint32_t chunk_block_offset = (uint32_t)*chunk_block_offset_ptr;
-        memcpy(&buffer[asset_offset - start], &block_data[chunk_block_offset + chunk_offset], read_length);
+        memcpy(&buffer[asset_offset - start], &block_data[chunk_block_offset - block_data_offset + chunk_offset], read_length);
         asset_offset += read_length;
     }
-    Longtail_Free(work_mem);
+    Longtail_Free(decompressed_data);
+    return 0;
+}
+
+static int BlockStoreStorageAPI_ReadFromBlock(
+    struct Longtail_StoredBlock* stored_block,
+    struct BlockStoreStorageAPI_ChunkRange* range,
+    struct BlockStoreStorageAPI* block_store_fs,
+    struct BlockStoreStorageAPI_OpenFile* block_store_file,
+    uint64_t start,
+    uint64_t size,
+    char* buffer,
+    const uint32_t* chunk_indexes)
+{
+    struct Longtail_LookupTable* block_chunk_lookup = BlockStoreStorageAPI_CreateBlockChunkLookup(stored_block);
+    if (block_chunk_lookup == 0)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFromBlock(%p, %p, %p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            stored_block, range, block_store_fs, block_store_file, start, size, buffer, chunk_indexes,
+            ENOMEM)
+        return ENOMEM;
+    }
+    int err = BlockStoreStorageAPI_CopyFromBlock(stored_block, block_chunk_lookup, range, block_store_fs, start, size, buffer, chunk_indexes);
+    Longtail_Free(block_chunk_lookup);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFromBlock(%p, %p, %p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            stored_block, range, block_store_fs, block_store_file, start, size, buffer, chunk_indexes,
+            err)
+        return err;
+    }
     return 0;
 }
 
@@ -317,6 +466,7 @@ struct BlockStoreStorageAPI_ReadFromBlockJobData
     char* m_Buffer;
     const uint32_t* m_ChunkIndexes;
     struct Longtail_StoredBlock* m_StoredBlock;
+    int m_RetainBlock;
     int m_Err;
 };
 
@@ -380,6 +530,11 @@ static int BlockStoreStorageAPI_ReadFromBlockJob(void* context, uint32_t job_id,
             context, job_id, is_cancelled,
             data->m_Err)
     }
+    if (data->m_RetainBlock)
+    {
+        // Ownership of the block is handed to the block window of the file
+        return 0;
+    }
     if (data->m_StoredBlock->Dispose)
     {
         data->m_StoredBlock->Dispose(data->m_StoredBlock);
@@ -387,6 +542,290 @@ static int BlockStoreStorageAPI_ReadFromBlockJob(void* context, uint32_t job_id,
     return 0;
 }
 
+static void BlockStoreStorageAPI_WindowBlock_OnComplete(struct Longtail_AsyncGetStoredBlockAPI* async_complete_api, struct Longtail_StoredBlock* stored_block, int err)
+{
+    struct BlockStoreStorageAPI_WindowBlock* window_block = (struct BlockStoreStorageAPI_WindowBlock*)async_complete_api;
+    window_block->m_StoredBlock = stored_block;
+    window_block->m_Err = err;
+    Longtail_PostSema(window_block->m_CompleteSema, 1);
+}
+
+// Waits for the prefetch jobs of the file so their group can be released, the jobs run on this thread if no worker has picked them up
+static void BlockStoreStorageAPI_WaitForPrefetchJobs(
+    struct BlockStoreStorageAPI* block_store_fs,
+    struct BlockStoreStorageAPI_OpenFile* block_store_file)
+{
+    if (block_store_file->m_PrefetchJobGroup == 0)
+    {
+        return;
+    }
+    struct Longtail_JobAPI* job_api = block_store_fs->m_JobAPI;
+    int err = job_api->WaitForAllJobs(job_api, block_store_file->m_PrefetchJobGroup, 0, 0, 0);
+    LONGTAIL_FATAL_ASSERT(err == 0, return)
+    block_store_file->m_PrefetchJobGroup = 0;
+}
+
+static void BlockStoreStorageAPI_ClearWindowBlock(struct BlockStoreStorageAPI_WindowBlock* window_block)
+{
+    if (window_block->m_State == BLOCKSTORESTORAGE_WINDOW_BLOCK_PENDING)
+    {
+        BlockStoreStorageAPI_WaitForPrefetchJobs(window_block->m_BlockStoreFS, window_block->m_BlockStoreFile);
+        Longtail_WaitSema(window_block->m_CompleteSema, LONGTAIL_TIMEOUT_INFINITE);
+    }
+    if (window_block->m_StoredBlock && window_block->m_StoredBlock->Dispose)
+    {
+        window_block->m_StoredBlock->Dispose(window_block->m_StoredBlock);
+    }
+    Longtail_Free(window_block->m_ChunkLookup);
+    window_block->m_StoredBlock = 0;
+    window_block->m_ChunkLookup = 0;
+    window_block->m_Err = 0;
+    window_block->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY;
+}
+
+// Takes ownership of stored_block, disposing it on failure
+static int BlockStoreStorageAPI_SetWindowBlock(
+    struct BlockStoreStorageAPI_WindowBlock* window_block,
+    TLongtail_Hash block_hash,
+    struct Longtail_StoredBlock* stored_block)
+{
+    window_block->m_BlockHash = block_hash;
+    window_block->m_StoredBlock = stored_block;
+    window_block->m_ChunkLookup = BlockStoreStorageAPI_CreateBlockChunkLookup(stored_block);
+    if (window_block->m_ChunkLookup == 0)
+    {
+        BlockStoreStorageAPI_ClearWindowBlock(window_block);
+        return ENOMEM;
+    }
+    window_block->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_READY;
+    return 0;
+}
+
+// Waits for a prefetched block to arrive, on failure the slot is emptied so the block is fetched again by the reader
+static int BlockStoreStorageAPI_WaitForWindowBlock(struct BlockStoreStorageAPI_WindowBlock* window_block)
+{
+    if (window_block->m_State != BLOCKSTORESTORAGE_WINDOW_BLOCK_PENDING)
+    {
+        return 0;
+    }
+    BlockStoreStorageAPI_WaitForPrefetchJobs(window_block->m_BlockStoreFS, window_block->m_BlockStoreFile);
+    Longtail_WaitSema(window_block->m_CompleteSema, LONGTAIL_TIMEOUT_INFINITE);
+    window_block->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_READY;
+    int err = window_block->m_Err;
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "BlockStoreStorageAPI_WaitForWindowBlock(%p) prefetch failed with %d",
+            window_block,
+            err)
+        BlockStoreStorageAPI_ClearWindowBlock(window_block);
+        return err;
+    }
+    return BlockStoreStorageAPI_SetWindowBlock(window_block, window_block->m_BlockHash, window_block->m_StoredBlock);
+}
+
+static struct BlockStoreStorageAPI_WindowBlock* BlockStoreStorageAPI_FindWindowBlock(
+    struct BlockStoreStorageAPI_OpenFile* block_store_file,
+    TLongtail_Hash block_hash)
+{
+    for (uint32_t w = 0; w < BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE; ++w)
+    {
+        struct BlockStoreStorageAPI_WindowBlock* window_block = &block_store_file->m_WindowBlocks[w];
+        if (window_block->m_State != BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY && window_block->m_BlockHash == block_hash)
+        {
+            return window_block;
+        }
+    }
+    return 0;
+}
+
+// Returns an empty slot, evicting the least recently used ready block that has not been used since read_use
+static struct BlockStoreStorageAPI_WindowBlock* BlockStoreStorageAPI_GetFreeWindowBlock(
+    struct BlockStoreStorageAPI_OpenFile* block_store_file,
+    uint64_t read_use)
+{
+    struct BlockStoreStorageAPI_WindowBlock* evict_block = 0;
+    for (uint32_t w = 0; w < BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE; ++w)
+    {
+        struct BlockStoreStorageAPI_WindowBlock* window_block = &block_store_file->m_WindowBlocks[w];
+        if (window_block->m_State == BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY)
+        {
+            return window_block;
+        }
+        if (window_block->m_State != BLOCKSTORESTORAGE_WINDOW_BLOCK_READY || window_block->m_LastUse >= read_use)
+        {
+            continue;
+        }
+        if (evict_block == 0 || window_block->m_LastUse < evict_block->m_LastUse)
+        {
+            evict_block = window_block;
+        }
+    }
+    if (evict_block)
+    {
+        BlockStoreStorageAPI_ClearWindowBlock(evict_block);
+    }
+    return evict_block;
+}
+
+static int BlockStoreStorageAPI_GetChunkBlockHash(
+    struct BlockStoreStorageAPI* block_store_fs,
+    TLongtail_Hash chunk_hash,
+    TLongtail_Hash* out_block_hash)
+{
+    uint64_t block_index;
+    if (block_store_fs->m_ChunkHashToBlockIndexLookup)
+    {
+        const uint64_t* block_index_ptr = Longtail_LookupTable_Get(block_store_fs->m_ChunkHashToBlockIndexLookup, chunk_hash);
+        if (block_index_ptr == 0)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_GetChunkBlockHash(%p, 0x%" PRIx64 ", %p) failed with %d",
+                block_store_fs, chunk_hash, out_block_hash,
+                ENOENT)
+            return ENOENT;
+        }
+        block_index = *block_index_ptr;
+    }
+    else
+    {
+        int err = Longtail_ContentIndex_LookupChunkBlockIndex(block_store_fs->m_ContentIndex, chunk_hash, &block_index);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_GetChunkBlockHash(%p, 0x%" PRIx64 ", %p) failed with %d",
+                block_store_fs, chunk_hash, out_block_hash,
+                err)
+            return err;
+        }
+    }
+    *out_block_hash = block_store_fs->m_ContentIndex->m_BlockHashes[block_index];
+    return 0;
+}
+
+// Block stores may read and decompress the block on the calling thread so the request is made from an IO job
+static int BlockStoreStorageAPI_PrefetchBlockJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    struct BlockStoreStorageAPI_WindowBlock* window_block = (struct BlockStoreStorageAPI_WindowBlock*)context;
+    struct Longtail_BlockStoreAPI* block_store = window_block->m_BlockStoreFS->m_BlockStore;
+    struct BlockStoreStorageAPI_OpenFile* block_store_file = window_block->m_BlockStoreFile;
+    int err = block_store->GetStoredBlock(block_store, window_block->m_BlockHash, &window_block->m_AsyncCompleteAPI);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "BlockStoreStorageAPI_PrefetchBlockJob(%p, %u, %d) failed with %d",
+            context, job_id, is_cancelled,
+            err)
+        window_block->m_AsyncCompleteAPI.OnComplete(&window_block->m_AsyncCompleteAPI, 0, err);
+    }
+    Longtail_AtomicAdd32(&block_store_file->m_PrefetchJobCount, -1);
+    return 0;
+}
+
+// Starts fetching the blocks following chunk last_chunk of the asset that are not already in the block window.
+// Only one batch of prefetches per file is in flight at a time
+static void BlockStoreStorageAPI_PrefetchBlocks(
+    struct BlockStoreStorageAPI* block_store_fs,
+    struct BlockStoreStorageAPI_OpenFile* block_store_file,
+    uint32_t last_chunk,
+    uint64_t read_use)
+{
+    if (block_store_file->m_PrefetchJobCount > 0)
+    {
+        return;
+    }
+    BlockStoreStorageAPI_WaitForPrefetchJobs(block_store_fs, block_store_file);
+
+    const struct Longtail_VersionIndex* version_index = block_store_fs->m_VersionIndex;
+    uint32_t asset_index = block_store_file->m_AssetIndex;
+    uint32_t chunk_count = version_index->m_AssetChunkCounts[asset_index];
+    const uint32_t* chunk_indexes = &version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[asset_index]];
+
+    TLongtail_Hash last_block_hash;
+    if (BlockStoreStorageAPI_GetChunkBlockHash(block_store_fs, version_index->m_ChunkHashes[chunk_indexes[last_chunk]], &last_block_hash))
+    {
+        return;
+    }
+    Longtail_JobAPI_JobFunc funcs[BLOCKSTORESTORAGE_PREFETCH_BLOCK_COUNT];
+    void* ctxs[BLOCKSTORESTORAGE_PREFETCH_BLOCK_COUNT];
+    uint32_t fetch_count = 0;
+    uint32_t prefetch_count = 0;
+    uint32_t chunk_end = chunk_count - last_chunk > BLOCKSTORESTORAGE_PREFETCH_MAX_CHUNK_SCAN ? last_chunk + BLOCKSTORESTORAGE_PREFETCH_MAX_CHUNK_SCAN : chunk_count;
+    for (uint32_t c = last_chunk + 1; c < chunk_end && prefetch_count < BLOCKSTORESTORAGE_PREFETCH_BLOCK_COUNT; ++c)
+    {
+        TLongtail_Hash block_hash;
+        if (BlockStoreStorageAPI_GetChunkBlockHash(block_store_fs, version_index->m_ChunkHashes[chunk_indexes[c]], &block_hash))
+        {
+            // Prefetching is only a hint, the read of the chunk reports the missing block
+            break;
+        }
+        if (block_hash == last_block_hash)
+        {
+            continue;
+        }
+        last_block_hash = block_hash;
+        struct BlockStoreStorageAPI_WindowBlock* window_block = BlockStoreStorageAPI_FindWindowBlock(block_store_file, block_hash);
+        if (window_block)
+        {
+            if (window_block->m_LastUse < read_use)
+            {
+                window_block->m_LastUse = read_use;
+                ++prefetch_count;
+            }
+            continue;
+        }
+        window_block = BlockStoreStorageAPI_GetFreeWindowBlock(block_store_file, read_use);
+        if (window_block == 0)
+        {
+            break;
+        }
+        window_block->m_BlockHash = block_hash;
+        window_block->m_LastUse = read_use;
+        window_block->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_PENDING;
+        funcs[fetch_count] = BlockStoreStorageAPI_PrefetchBlockJob;
+        ctxs[fetch_count] = window_block;
+        ++fetch_count;
+        ++prefetch_count;
+    }
+    if (fetch_count == 0)
+    {
+        return;
+    }
+
+    struct Longtail_JobAPI* job_api = block_store_fs->m_JobAPI;
+    Longtail_JobAPI_Group job_group;
+    int err = job_api->ReserveJobs(job_api, fetch_count, &job_group);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "BlockStoreStorageAPI_PrefetchBlocks(%p, %p, %u, %" PRIu64 ") failed with %d",
+            block_store_fs, block_store_file, last_chunk, read_use,
+            err)
+        for (uint32_t j = 0; j < fetch_count; ++j)
+        {
+            ((struct BlockStoreStorageAPI_WindowBlock*)ctxs[j])->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY;
+        }
+        return;
+    }
+    Longtail_JobAPI_Jobs jobs;
+    err = job_api->CreateJobs(job_api, job_group, fetch_count, funcs, ctxs, LONGTAIL_JOB_CLASS_IO, &jobs);
+    if (!err)
+    {
+        block_store_file->m_PrefetchJobGroup = job_group;
+        block_store_file->m_PrefetchJobCount = (int32_t)fetch_count;
+        err = job_api->ReadyJobs(job_api, fetch_count, jobs);
+    }
+    if (err)
+    {
+        // No job will complete the pending slots, release them and the job group
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "BlockStoreStorageAPI_PrefetchBlocks(%p, %p, %u, %" PRIu64 ") failed with %d",
+            block_store_fs, block_store_file, last_chunk, read_use,
+            err)
+        for (uint32_t j = 0; j < fetch_count; ++j)
+        {
+            ((struct BlockStoreStorageAPI_WindowBlock*)ctxs[j])->m_State = BLOCKSTORESTORAGE_WINDOW_BLOCK_EMPTY;
+        }
+        block_store_file->m_PrefetchJobGroup = 0;
+        block_store_file->m_PrefetchJobCount = 0;
+        job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0);
+    }
+}
+
 static uint32_t BlockStoreStorageAPI_FindStartChunk(const uint64_t* a, uint32_t n, uint64_t val) {
     uint32_t first = 0;
     uint32_t count = n;
@@ -509,16 +948,32 @@ static int BlockStoreStorageAPI_ReadFile(
     struct Longtail_LookupTable* block_range_map = Longtail_LookupTable_Create(Longtail_Alloc(block_range_map_size), estimated_block_count, 0);
     struct BlockStoreStorageAPI_ChunkRange* chunk_ranges = 0;
     arrsetcap(chunk_ranges, estimated_block_count);
-    const TLongtail_Hash* block_hashes = block_store_fs->m_ContentIndex->m_BlockHashes;
+
+    uint64_t read_use = ++block_store_file->m_UseCounter;
+    if (start == block_store_file->m_NextReadPos)
+    {
+        ++block_store_file->m_SequentialReadCount;
+    }
+    else
+    {
+        block_store_file->m_SequentialReadCount = 1;
+    }
 
     for (uint32_t c = seek_chunk_offset; c < chunk_count; ++c)
     {
         uint32_t chunk_index = chunk_indexes[c];
         TLongtail_Hash chunk_hash = chunk_hashes[chunk_index];
-        const uint64_t* block_index_ptr = Longtail_LookupTable_Get(block_store_fs->m_ChunkHashToBlockIndexLookup, chunk_hash);
-        LONGTAIL_FATAL_ASSERT(block_index_ptr, EINVAL)
-        uint64_t block_index = *block_index_ptr;
-        TLongtail_Hash block_hash = block_hashes[block_index];
+        TLongtail_Hash block_hash;
+        err = BlockStoreStorageAPI_GetChunkBlockHash(block_store_fs, chunk_hash, &block_hash);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+                block_store_fs, block_store_file, start, size, out_buffer,
+                err)
+            Longtail_Free(block_range_map);
+            arrfree(chunk_ranges);
+            return err;
+        }
         uint64_t* chunk_range_index = Longtail_LookupTable_PutUnique(block_range_map, block_hash, arrlen(chunk_ranges));
         if (chunk_range_index)
         {
@@ -552,55 +1007,168 @@ static int BlockStoreStorageAPI_ReadFile(
     uint32_t block_count = (uint32_t)arrlen(chunk_ranges);
     LONGTAIL_FATAL_ASSERT(block_count > 0, return EINVAL);
 
+    // The block holding the end of the read is kept in the block window for the next read
+    uint32_t last_chunk = block_store_file->m_SeekChunkOffset;
+    TLongtail_Hash last_block_hash;
+    err = BlockStoreStorageAPI_GetChunkBlockHash(block_store_fs, chunk_hashes[chunk_indexes[last_chunk]], &last_block_hash);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+            block_store_fs, block_store_file, start, size, out_buffer,
+            err)
+        Longtail_Free(block_range_map);
+        arrfree(chunk_ranges);
+        return err;
+    }
+
+    struct BlockStoreStorageAPI_WindowBlock** window_blocks = (struct BlockStoreStorageAPI_WindowBlock**)Longtail_Alloc(sizeof(struct BlockStoreStorageAPI_WindowBlock*) * block_count);
+    if (!window_blocks)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+            block_store_fs, block_store_file, start, size, out_buffer,
+            ENOMEM)
+        Longtail_Free(block_range_map);
+        arrfree(chunk_ranges);
+        return ENOMEM;
+    }
+    uint32_t fetch_count = 0;
+    for (uint32_t b = 0; b < block_count; ++b)
+    {
+        struct BlockStoreStorageAPI_WindowBlock* window_block = BlockStoreStorageAPI_FindWindowBlock(block_store_file, chunk_ranges[b].m_BlockHash);
+        if (window_block && BlockStoreStorageAPI_WaitForWindowBlock(window_block) == 0)
+        {
+            window_block->m_LastUse = read_use;
+        }
+        else
+        {
+            // Not in the window or the prefetch failed, fetch it again
+            window_block = 0;
+            ++fetch_count;
+        }
+        window_blocks[b] = window_block;
+    }
+
     struct Longtail_JobAPI* job_api = block_store_fs->m_JobAPI;
 
-	size_t work_mem_size = sizeof(struct BlockStoreStorageAPI_ReadFromBlockJobData) * block_count +
-		sizeof(Longtail_JobAPI_JobFunc) * block_count +
-		sizeof(void*) * block_count;
-	void* work_mem = Longtail_Alloc(work_mem_size);
-	if (!work_mem)
+	size_t work_mem_size = sizeof(struct BlockStoreStorageAPI_ReadFromBlockJobData) * fetch_count +
+		sizeof(Longtail_JobAPI_JobFunc) * fetch_count +
+		sizeof(void*) * fetch_count;
+	void* work_mem = fetch_count > 0 ? Longtail_Alloc(work_mem_size) : 0;
+	if (fetch_count > 0 && !work_mem)
 	{
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
             block_store_fs, block_store_file, start, size, out_buffer,
             ENOMEM)
+        Longtail_Free(window_blocks);
+        Longtail_Free(block_range_map);
+        arrfree(chunk_ranges);
 		return ENOMEM;
 	}
     struct BlockStoreStorageAPI_ReadFromBlockJobData* job_datas = (struct BlockStoreStorageAPI_ReadFromBlockJobData*)work_mem;
-    Longtail_JobAPI_JobFunc* funcs = (Longtail_JobAPI_JobFunc*)&job_datas[block_count];
-    void** ctxs = (void**)&funcs[block_count];
+    Longtail_JobAPI_JobFunc* funcs = (Longtail_JobAPI_JobFunc*)&job_datas[fetch_count];
+    void** ctxs = (void**)&funcs[fetch_count];
 
     Longtail_JobAPI_Group job_group;
-    err = job_api->ReserveJobs(job_api, block_count, &job_group);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
+    if (fetch_count > 0)
+    {
+        err = job_api->ReserveJobs(job_api, fetch_count, &job_group);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+
+        uint32_t j = 0;
+        for (uint32_t b = 0; b < block_count; ++b)
+        {
+            if (window_blocks[b])
+            {
+                continue;
+            }
+            struct BlockStoreStorageAPI_ChunkRange* range = &chunk_ranges[b];
+
+            job_datas[j].m_Range = range;
+            job_datas[j].m_BlockStoreFS = block_store_fs;
+            job_datas[j].m_BlockStoreFile = block_store_file;
+            job_datas[j].m_Start = start;
+            job_datas[j].m_Size = size;
+            job_datas[j].m_Buffer = buffer;
+            job_datas[j].m_ChunkIndexes = chunk_indexes;
+            job_datas[j].m_StoredBlock = 0;
+            job_datas[j].m_RetainBlock = range->m_BlockHash == last_block_hash;
+            job_datas[j].m_Err = 0;
+
+            funcs[j] = BlockStoreStorageAPI_ReadFromBlockJob;
+            ctxs[j] = &job_datas[j];
+            ++j;
+        }
+        Longtail_JobAPI_Jobs jobs;
+        err = job_api->CreateJobs(job_api, job_group, fetch_count, funcs, ctxs, LONGTAIL_JOB_CLASS_IO, &jobs);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        err = job_api->ReadyJobs(job_api, fetch_count, jobs);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+    }
+
+    int copy_err = 0;
 
+    // Copy from the blocks already in the window while the missing blocks are fetched
     for (uint32_t b = 0; b < block_count; ++b)
     {
-        struct BlockStoreStorageAPI_ChunkRange* range = &chunk_ranges[b];
-
-        job_datas[b].m_Range = range;
-        job_datas[b].m_BlockStoreFS = block_store_fs;
-        job_datas[b].m_BlockStoreFile = block_store_file;
-        job_datas[b].m_Start = start;
-        job_datas[b].m_Size = size;
-        job_datas[b].m_Buffer = buffer;
-        job_datas[b].m_ChunkIndexes = chunk_indexes;
-        job_datas[b].m_StoredBlock = 0;
-        job_datas[b].m_Err = 0;
+        struct BlockStoreStorageAPI_WindowBlock* window_block = window_blocks[b];
+        if (window_block)
+        {
+            err = BlockStoreStorageAPI_CopyFromBlock(window_block->m_StoredBlock, window_block->m_ChunkLookup, &chunk_ranges[b], block_store_fs, start, size, buffer, chunk_indexes);
+            if (err && copy_err == 0)
+            {
+                copy_err = err;
+            }
+        }
+    }
 
-        funcs[b] = BlockStoreStorageAPI_ReadFromBlockJob;
-        ctxs[b] = &job_datas[b];
+    if (fetch_count > 0)
+    {
+        err = job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        for (uint32_t j = 0; j < fetch_count; ++j)
+        {
+            struct BlockStoreStorageAPI_ReadFromBlockJobData* job_data = &job_datas[j];
+            if (job_data->m_Err && copy_err == 0)
+            {
+                copy_err = job_data->m_Err;
+            }
+            if (!job_data->m_RetainBlock || job_data->m_StoredBlock == 0)
+            {
+                continue;
+            }
+            struct BlockStoreStorageAPI_WindowBlock* window_block = BlockStoreStorageAPI_GetFreeWindowBlock(block_store_file, read_use);
+            if (window_block == 0)
+            {
+                if (job_data->m_StoredBlock->Dispose)
+                {
+                    job_data->m_StoredBlock->Dispose(job_data->m_StoredBlock);
+                }
+                continue;
+            }
+            window_block->m_LastUse = read_use;
+            BlockStoreStorageAPI_SetWindowBlock(window_block, job_data->m_Range->m_BlockHash, job_data->m_StoredBlock);
+        }
     }
-    Longtail_JobAPI_Jobs jobs;
-    err = job_api->CreateJobs(job_api, job_group, block_count, funcs, ctxs, &jobs);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
-    err = job_api->ReadyJobs(job_api, block_count, jobs);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
-    err = job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
     Longtail_Free(work_mem);
+    Longtail_Free(window_blocks);
 
     Longtail_Free(block_range_map);
     arrfree(chunk_ranges);
+
+    if (copy_err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_ReadFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+            block_store_fs, block_store_file, start, size, out_buffer,
+            copy_err)
+        block_store_file->m_SequentialReadCount = 0;
+        return copy_err;
+    }
+
+    block_store_file->m_NextReadPos = read_end;
+    if (block_store_file->m_SequentialReadCount >= BLOCKSTORESTORAGE_SEQUENTIAL_READ_COUNT)
+    {
+        BlockStoreStorageAPI_PrefetchBlocks(block_store_fs, block_store_file, last_chunk, read_use);
+    }
     return 0;
 }
 
@@ -634,10 +1202,40 @@ static int BlockStoreStorageAPI_OpenReadFile(
         return ENOENT;
     }
     uint32_t asset_index = block_store_fs->m_PathLookup->m_PathEntries[*path_entry_index].m_AssetIndex;
-    struct BlockStoreStorageAPI_OpenFile* block_store_file = (struct BlockStoreStorageAPI_OpenFile*)Longtail_Alloc(sizeof(struct BlockStoreStorageAPI_OpenFile));
+    size_t block_store_file_size = sizeof(struct BlockStoreStorageAPI_OpenFile) + Longtail_GetSemaSize() * BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE;
+    struct BlockStoreStorageAPI_OpenFile* block_store_file = (struct BlockStoreStorageAPI_OpenFile*)Longtail_Alloc(block_store_file_size);
+    if (block_store_file == 0)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_OpenReadFile(%p, `%s`, %p) failed with %d",
+            block_store_fs, path, out_open_file,
+            ENOMEM)
+        return ENOMEM;
+    }
+    memset(block_store_file, 0, sizeof(struct BlockStoreStorageAPI_OpenFile));
     block_store_file->m_AssetIndex = asset_index;
     block_store_file->m_SeekChunkOffset = 0;
     block_store_file->m_SeekAssetPos = 0;
+    char* sema_mem = (char*)&block_store_file[1];
+    for (uint32_t w = 0; w < BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE; ++w)
+    {
+        struct BlockStoreStorageAPI_WindowBlock* window_block = &block_store_file->m_WindowBlocks[w];
+        window_block->m_AsyncCompleteAPI.OnComplete = BlockStoreStorageAPI_WindowBlock_OnComplete;
+        window_block->m_BlockStoreFS = block_store_fs;
+        window_block->m_BlockStoreFile = block_store_file;
+        err = Longtail_CreateSema(&sema_mem[Longtail_GetSemaSize() * w], 0, &window_block->m_CompleteSema);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockStoreStorageAPI_OpenReadFile(%p, `%s`, %p) failed with %d",
+                block_store_fs, path, out_open_file,
+                err)
+            while (w-- > 0)
+            {
+                Longtail_DeleteSema(block_store_file->m_WindowBlocks[w].m_CompleteSema);
+            }
+            Longtail_Free(block_store_file);
+            return err;
+        }
+    }
     *out_open_file = (Longtail_StorageAPI_HOpenFile)block_store_file;
     return 0;
 }
@@ -781,6 +1379,12 @@ static void BlockStoreStorageAPI_CloseFile(
 
     struct BlockStoreStorageAPI* block_store_fs = (struct BlockStoreStorageAPI*)storage_api;
     struct BlockStoreStorageAPI_OpenFile* block_store_file = (struct BlockStoreStorageAPI_OpenFile*)f;
+    BlockStoreStorageAPI_WaitForPrefetchJobs(block_store_fs, block_store_file);
+    for (uint32_t w = 0; w < BLOCKSTORESTORAGE_BLOCK_WINDOW_SIZE; ++w)
+    {
+        BlockStoreStorageAPI_ClearWindowBlock(&block_store_file->m_WindowBlocks[w]);
+        Longtail_DeleteSema(block_store_file->m_WindowBlocks[w].m_CompleteSema);
+    }
     Longtail_Free(block_store_file);
 }
 
@@ -1097,6 +1701,44 @@ static int BlockStoreStorageAPI_GetEntryProperties(
     out_properties->m_IsDir = is_dir;
     out_properties->m_Permissions = block_store_fs->m_VersionIndex->m_Permissions[path_entry->m_AssetIndex];
     out_properties->m_Size = block_store_fs->m_VersionIndex->m_AssetSizes[path_entry->m_AssetIndex];
+    const struct Longtail_VersionIndex* version_index = block_store_fs->m_VersionIndex;
+    out_properties->m_ModificationTime = version_index->m_ModificationTimes ? version_index->m_ModificationTimes[path_entry->m_AssetIndex] : 0;
+    out_properties->m_ChangeTime = version_index->m_ChangeTimes ? version_index->m_ChangeTimes[path_entry->m_AssetIndex] : 0;
+    out_properties->m_FileId = version_index->m_FileIds ? version_index->m_FileIds[path_entry->m_AssetIndex] : 0;
+    return 0;
+}
+
+static int BlockStoreStorageAPI_MapFile(
+    struct Longtail_StorageAPI* storage_api,
+    Longtail_StorageAPI_HOpenFile f,
+    uint64_t offset,
+    uint64_t length,
+    Longtail_StorageAPI_HFileMap* out_file_map,
+    const void** out_data_ptr)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return 0)
+    LONGTAIL_VALIDATE_INPUT(f != 0, return 0)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "BlockStoreStorageAPI_MapFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+        storage_api, f, offset, length, out_file_map, out_data_ptr,
+        ENOTSUP)
+    return ENOTSUP;
+}
+
+static void BlockStoreStorageAPI_UnmapFile(
+    struct Longtail_StorageAPI* storage_api,
+    Longtail_StorageAPI_HFileMap file_map)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return)
+    LONGTAIL_VALIDATE_INPUT(file_map != 0, return)
+}
+
+// Open files detect sequential reads on their own and read ahead in the block store
+static int BlockStoreStorageAPI_AdviseSequentialRead(
+    struct Longtail_StorageAPI* storage_api,
+    Longtail_StorageAPI_HOpenFile f)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(f != 0, return EINVAL)
     return 0;
 }
 
@@ -1111,6 +1753,7 @@ static int BlockStoreStorageAPI_Init(
     struct Longtail_HashAPI* hash_api,
     struct Longtail_JobAPI* job_api,
     struct Longtail_BlockStoreAPI* block_store,
+    struct Longtail_CompressionRegistryAPI* optional_compression_registry,
     struct Longtail_ContentIndex* content_index,
     struct Longtail_VersionIndex* version_index,
     struct Longtail_StorageAPI** out_storage_api)
@@ -1148,25 +1791,36 @@ static int BlockStoreStorageAPI_Init(
     block_store_fs->m_API.FindNext = BlockStoreStorageAPI_FindNext;
     block_store_fs->m_API.CloseFind = BlockStoreStorageAPI_CloseFind;
     block_store_fs->m_API.GetEntryProperties = BlockStoreStorageAPI_GetEntryProperties;
+    block_store_fs->m_API.MapFile = BlockStoreStorageAPI_MapFile;
+    block_store_fs->m_API.UnmapFile = BlockStoreStorageAPI_UnmapFile;
+    block_store_fs->m_API.AdviseSequentialRead = BlockStoreStorageAPI_AdviseSequentialRead;
     block_store_fs->m_HashAPI = hash_api;
     block_store_fs->m_JobAPI = job_api;
     block_store_fs->m_BlockStore = block_store;
+    block_store_fs->m_CompressionRegistry = optional_compression_registry;
     block_store_fs->m_ContentIndex = content_index;
     block_store_fs->m_VersionIndex = version_index;
 
     char* p = (char*)&block_store_fs[1];
-    block_store_fs->m_ChunkHashToBlockIndexLookup = Longtail_LookupTable_Create(p, content_index_chunk_count, 0);
-    p += Longtail_LookupTable_GetSize(content_index_chunk_count);
+    block_store_fs->m_ChunkHashToBlockIndexLookup = 0;
+    if (content_index->m_SortedChunkHashes == 0)
+    {
+        block_store_fs->m_ChunkHashToBlockIndexLookup = Longtail_LookupTable_Create(p, content_index_chunk_count, 0);
+        p += Longtail_LookupTable_GetSize(content_index_chunk_count);
+    }
     block_store_fs->m_PathLookup = BlockStoreStorageAPI_CreatePathLookup(p, hash_api, version_index);
     p += GetPathEntriesSize(version_index_asset_count);
     block_store_fs->m_ChunkAssetOffsets = (uint64_t*)p;
 
-    const uint64_t* content_index_chunk_block_indexes = content_index->m_ChunkBlockIndexes;
-    const TLongtail_Hash* content_index_chunk_hashes = content_index->m_ChunkHashes;
-    for (uint64_t c = 0; c < content_index_chunk_count; ++c)
+    if (block_store_fs->m_ChunkHashToBlockIndexLookup)
     {
-        uint64_t block_index = content_index_chunk_block_indexes[c];
-        Longtail_LookupTable_Put(block_store_fs->m_ChunkHashToBlockIndexLookup, content_index_chunk_hashes[c], block_index);
+        const uint64_t* content_index_chunk_block_indexes = content_index->m_ChunkBlockIndexes;
+        const TLongtail_Hash* content_index_chunk_hashes = content_index->m_ChunkHashes;
+        for (uint64_t c = 0; c < content_index_chunk_count; ++c)
+        {
+            uint64_t block_index = content_index_chunk_block_indexes[c];
+            Longtail_LookupTable_Put(block_store_fs->m_ChunkHashToBlockIndexLookup, content_index_chunk_hashes[c], block_index);
+        }
     }
     const uint32_t* asset_chunk_index_starts = block_store_fs->m_VersionIndex->m_AssetChunkIndexStarts;
     const uint32_t* asset_chunk_indexes = block_store_fs->m_VersionIndex->m_AssetChunkIndexes;
@@ -1196,30 +1850,32 @@ static int BlockStoreStorageAPI_Init(
     return 0;
 }
 
-struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPI(
+struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPIWithCompression(
     struct Longtail_HashAPI* hash_api,
     struct Longtail_JobAPI* job_api,
     struct Longtail_BlockStoreAPI* block_store,
+    struct Longtail_CompressionRegistryAPI* optional_compression_registry,
     struct Longtail_ContentIndex* content_index,
     struct Longtail_VersionIndex* version_index)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateBlockStoreStorageAPI(%p, %p, %p, %p, %p)",
-        hash_api, job_api, block_store, content_index, version_index)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateBlockStoreStorageAPIWithCompression(%p, %p, %p, %p, %p, %p)",
+        hash_api, job_api, block_store, optional_compression_registry, content_index, version_index)
     LONGTAIL_VALIDATE_INPUT(hash_api != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(job_api != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(block_store != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(content_index != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(version_index != 0, return 0)
 
+    // A sorted content index is searched in place so no chunk lookup table is needed
     size_t api_size = sizeof(struct BlockStoreStorageAPI) + 
-        Longtail_LookupTable_GetSize(*content_index->m_ChunkCount) +
+        (content_index->m_SortedChunkHashes ? 0 : Longtail_LookupTable_GetSize(*content_index->m_ChunkCount)) +
         GetPathEntriesSize(*version_index->m_AssetCount) +
         sizeof(uint64_t) * (*version_index->m_AssetChunkIndexCount);
     void* mem = Longtail_Alloc(api_size);
     if (!mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBlockStoreStorageAPI(%p, %p, %p, %p, %p) failed with %d",
-            hash_api, job_api, block_store, content_index, version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBlockStoreStorageAPIWithCompression(%p, %p, %p, %p, %p, %p) failed with %d",
+            hash_api, job_api, block_store, optional_compression_registry, content_index, version_index,
             ENOMEM)
         return 0;
     }
@@ -1229,14 +1885,15 @@ struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPI(
         hash_api,
         job_api,
         block_store,
+        optional_compression_registry,
         content_index,
         version_index,
         &storage_api);
 
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBlockStoreStorageAPI(%p, %p, %p, %p, %p,) failed with %d",
-            hash_api, job_api, block_store, content_index, version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateBlockStoreStorageAPIWithCompression(%p, %p, %p, %p, %p, %p) failed with %d",
+            hash_api, job_api, block_store, optional_compression_registry, content_index, version_index,
             err)
         Longtail_Free(mem);
         return 0;
@@ -1244,3 +1901,19 @@ struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPI(
 
     return storage_api;
 }
+
+struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPI(
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_BlockStoreAPI* block_store,
+    struct Longtail_ContentIndex* content_index,
+    struct Longtail_VersionIndex* version_index)
+{
+    return Longtail_CreateBlockStoreStorageAPIWithCompression(
+        hash_api,
+        job_api,
+        block_store,
+        0,
+        content_index,
+        version_index);
+}
@@ -13,6 +13,16 @@ LONGTAIL_EXPORT extern struct Longtail_StorageAPI* Longtail_CreateBlockStoreStor
     struct Longtail_ContentIndex* content_index,
     struct Longtail_VersionIndex* version_index);
 
+// With a compression registry block_store must hand out blocks as stored by the compress block store,
+// each read then only decompresses the frames of a block that it touches, see Longtail_DecompressBlockChunkRange
+LONGTAIL_EXPORT extern struct Longtail_StorageAPI* Longtail_CreateBlockStoreStorageAPIWithCompression(
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_BlockStoreAPI* block_store,
+    struct Longtail_CompressionRegistryAPI* optional_compression_registry,
+    struct Longtail_ContentIndex* content_index,
+    struct Longtail_VersionIndex* version_index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@ struct CompressBlockStoreAPI
     struct Longtail_BlockStoreAPI m_BlockStoreAPI;
     struct Longtail_BlockStoreAPI* m_BackingBlockStore;
     struct Longtail_CompressionRegistryAPI* m_CompressionRegistryAPI;
+    uint32_t m_MinFrameSize;
     struct Longtail_BlockStore_Stats m_Stats;
 
     TLongtail_Atomic64 m_StatU64[Longtail_BlockStoreAPI_StatU64_Count];
@@ -49,12 +50,23 @@ static int CompressedStoredBlock_Dispose(struct Longtail_StoredBlock* stored_blo
     return 0;
 }
 
+// Framed layout header: [LONGTAIL_COMPRESSED_FRAMES_FLAG | uncompressed size, frame count, frame table, frame data]
+// The whole-block layout header is [uncompressed size, compressed size] followed by the compressed data
+#define LONGTAIL_COMPRESSED_FRAMES_FLAG 0x80000000u
+
+struct CompressedFrame
+{
+    uint32_t m_ChunkEnd;        // Index of the first chunk after the frame
+    uint32_t m_CompressedEnd;   // Offset in the frame data where the next frame starts
+};
+
 static int CompressBlock(
     struct Longtail_CompressionRegistryAPI* compression_registry,
+    uint32_t min_frame_size,
     struct Longtail_StoredBlock* uncompressed_stored_block,
     struct Longtail_StoredBlock** out_compressed_stored_block)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CompressBlock(%p, %p, %p)", compression_registry, uncompressed_stored_block, out_compressed_stored_block)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CompressBlock(%p, %u, %p, %p)", compression_registry, min_frame_size, uncompressed_stored_block, out_compressed_stored_block)
     LONGTAIL_FATAL_ASSERT(compression_registry, return EINVAL)
     LONGTAIL_FATAL_ASSERT(uncompressed_stored_block, return EINVAL)
     LONGTAIL_FATAL_ASSERT(out_compressed_stored_block, return EINVAL)
@@ -73,21 +85,42 @@ static int CompressBlock(
         &compression_settings);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %p, %p) failed with %d",
-            compression_registry, uncompressed_stored_block, out_compressed_stored_block,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %u, %p, %p) failed with %d",
+            compression_registry, min_frame_size, uncompressed_stored_block, out_compressed_stored_block,
             err)
         return err;
     }
     uint32_t block_chunk_data_size = uncompressed_stored_block->m_BlockChunksDataSize;
     uint32_t chunk_count = *uncompressed_stored_block->m_BlockIndex->m_ChunkCount;
+    const uint32_t* chunk_sizes = uncompressed_stored_block->m_BlockIndex->m_ChunkSizes;
+    uint32_t frame_count = 0;
     size_t block_index_size = Longtail_GetBlockIndexSize(chunk_count);
-    size_t max_compressed_chunk_data_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, block_chunk_data_size);
-    size_t compressed_stored_block_size = sizeof(struct Longtail_StoredBlock) + block_index_size + sizeof(uint32_t) + sizeof(uint32_t) + max_compressed_chunk_data_size;
+    size_t max_compressed_chunk_data_size = 0;
+    if (min_frame_size)
+    {
+        uint32_t frame_size = 0;
+        for (uint32_t c = 0; c < chunk_count; ++c)
+        {
+            frame_size += chunk_sizes[c];
+            if (frame_size >= min_frame_size || c + 1 == chunk_count)
+            {
+                max_compressed_chunk_data_size += compression_api->GetMaxCompressedSize(compression_api, compression_settings, frame_size);
+                frame_size = 0;
+                ++frame_count;
+            }
+        }
+    }
+    else
+    {
+        max_compressed_chunk_data_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, block_chunk_data_size);
+    }
+    size_t header_size = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(struct CompressedFrame) * frame_count;
+    size_t compressed_stored_block_size = sizeof(struct Longtail_StoredBlock) + block_index_size + header_size + max_compressed_chunk_data_size;
     struct Longtail_StoredBlock* compressed_stored_block = (struct Longtail_StoredBlock*)Longtail_Alloc(compressed_stored_block_size);
     if (!compressed_stored_block)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %p, %p) failed with %d",
-            compression_registry, uncompressed_stored_block, out_compressed_stored_block,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %u, %p, %p) failed with %d",
+            compression_registry, min_frame_size, uncompressed_stored_block, out_compressed_stored_block,
             ENOMEM)
         return ENOMEM;
     }
@@ -97,26 +130,77 @@ static int CompressBlock(
     uint32_t* header_ptr = (uint32_t*)(&((uint8_t*)compressed_stored_block->m_BlockIndex)[block_index_size]);
     compressed_stored_block->m_BlockData = header_ptr;
     memmove(compressed_stored_block->m_BlockIndex, uncompressed_stored_block->m_BlockIndex, block_index_size);
-    size_t compressed_chunk_data_size;
-    err = compression_api->Compress(
-        compression_api,
-        compression_settings,
-        (const char*)uncompressed_stored_block->m_BlockData,
-        (char*)&header_ptr[2],
-        block_chunk_data_size,
-        max_compressed_chunk_data_size,
-        &compressed_chunk_data_size);
-    if (err)
+
+    if (min_frame_size == 0)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %p, %p) failed with %d",
-            compression_registry, uncompressed_stored_block, out_compressed_stored_block,
-            err)
-        Longtail_Free(compressed_stored_block);
-        return err;
+        size_t compressed_chunk_data_size;
+        err = compression_api->Compress(
+            compression_api,
+            compression_settings,
+            (const char*)uncompressed_stored_block->m_BlockData,
+            (char*)&header_ptr[2],
+            block_chunk_data_size,
+            max_compressed_chunk_data_size,
+            &compressed_chunk_data_size);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %u, %p, %p) failed with %d",
+                compression_registry, min_frame_size, uncompressed_stored_block, out_compressed_stored_block,
+                err)
+            Longtail_Free(compressed_stored_block);
+            return err;
+        }
+        header_ptr[0] = block_chunk_data_size;
+        header_ptr[1] = (uint32_t)compressed_chunk_data_size;
+        compressed_stored_block->m_BlockChunksDataSize = (uint32_t)(header_size + compressed_chunk_data_size);
+        compressed_stored_block->Dispose = CompressedStoredBlock_Dispose;
+        *out_compressed_stored_block = compressed_stored_block;
+        return 0;
     }
-    header_ptr[0] = block_chunk_data_size;
-    header_ptr[1] = (uint32_t)compressed_chunk_data_size;
-    compressed_stored_block->m_BlockChunksDataSize = (uint32_t)(sizeof(uint32_t) + sizeof(uint32_t) + compressed_chunk_data_size);
+
+    struct CompressedFrame* frames = (struct CompressedFrame*)&header_ptr[2];
+    char* frame_data = (char*)&frames[frame_count];
+    const char* uncompressed_data = (const char*)uncompressed_stored_block->m_BlockData;
+    uint32_t frame_index = 0;
+    uint32_t frame_start_offset = 0;
+    uint32_t frame_end_offset = 0;
+    size_t compressed_offset = 0;
+    for (uint32_t c = 0; c < chunk_count; ++c)
+    {
+        frame_end_offset += chunk_sizes[c];
+        if (frame_end_offset - frame_start_offset < min_frame_size && c + 1 < chunk_count)
+        {
+            continue;
+        }
+        size_t frame_size = frame_end_offset - frame_start_offset;
+        size_t max_compressed_frame_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, frame_size);
+        size_t compressed_frame_size;
+        err = compression_api->Compress(
+            compression_api,
+            compression_settings,
+            &uncompressed_data[frame_start_offset],
+            &frame_data[compressed_offset],
+            frame_size,
+            max_compressed_frame_size,
+            &compressed_frame_size);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlock(%p, %u, %p, %p) failed with %d",
+                compression_registry, min_frame_size, uncompressed_stored_block, out_compressed_stored_block,
+                err)
+            Longtail_Free(compressed_stored_block);
+            return err;
+        }
+        compressed_offset += compressed_frame_size;
+        frames[frame_index].m_ChunkEnd = c + 1;
+        frames[frame_index].m_CompressedEnd = (uint32_t)compressed_offset;
+        ++frame_index;
+        frame_start_offset = frame_end_offset;
+    }
+    LONGTAIL_FATAL_ASSERT(frame_index == frame_count, Longtail_Free(compressed_stored_block); return EINVAL; )
+    header_ptr[0] = LONGTAIL_COMPRESSED_FRAMES_FLAG | block_chunk_data_size;
+    header_ptr[1] = frame_count;
+    compressed_stored_block->m_BlockChunksDataSize = (uint32_t)(header_size + compressed_offset);
     compressed_stored_block->Dispose = CompressedStoredBlock_Dispose;
     *out_compressed_stored_block = compressed_stored_block;
     return 0;
@@ -167,7 +251,8 @@ static int CompressBlockStore_PutStoredBlock(
 
     struct Longtail_StoredBlock* compressed_stored_block;
 
-    int err = CompressBlock(block_store->m_CompressionRegistryAPI, stored_block, &compressed_stored_block);
+    uint64_t compress_start_time = Longtail_GetMetricTime();
+    int err = CompressBlock(block_store->m_CompressionRegistryAPI, block_store->m_MinFrameSize, stored_block, &compressed_stored_block);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompressBlockStore_PutStoredBlock(%p, %p, %p) failed with %d",
@@ -176,6 +261,11 @@ static int CompressBlockStore_PutStoredBlock(
         Longtail_AtomicAdd64(&block_store->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_FailCount], 1);
         return err;
     }
+    if (compressed_stored_block)
+    {
+        Longtail_ObserveMetricTime(Longtail_Metric_Compress_Time, compress_start_time);
+        Longtail_AddMetric(Longtail_Metric_Compress_ByteCount, stored_block->m_BlockChunksDataSize);
+    }
     struct Longtail_StoredBlock* to_store = compressed_stored_block ? compressed_stored_block : stored_block;
 
     size_t on_put_backing_store_async_api_size = sizeof(struct OnPutBackingStoreAsync_API);
@@ -229,6 +319,110 @@ static int CompressBlockStore_PreflightGet(struct Longtail_BlockStoreAPI* block_
     return err;
 }
 
+struct CompressedBlockLayout
+{
+    uint32_t m_UncompressedSize;
+    uint32_t m_FrameCount;
+    const struct CompressedFrame* m_Frames;
+    const char* m_FrameData;
+    struct CompressedFrame m_WholeBlockFrame;
+};
+
+static int GetCompressedBlockLayout(const struct Longtail_StoredBlock* compressed_stored_block, struct CompressedBlockLayout* out_layout)
+{
+    uint32_t chunk_count = *compressed_stored_block->m_BlockIndex->m_ChunkCount;
+    const uint32_t* header_ptr = (const uint32_t*)compressed_stored_block->m_BlockData;
+    size_t data_size = compressed_stored_block->m_BlockChunksDataSize;
+    if (data_size < sizeof(uint32_t) * 2)
+    {
+        return EBADF;
+    }
+    if ((header_ptr[0] & LONGTAIL_COMPRESSED_FRAMES_FLAG) == 0)
+    {
+        out_layout->m_UncompressedSize = header_ptr[0];
+        out_layout->m_WholeBlockFrame.m_ChunkEnd = chunk_count;
+        out_layout->m_WholeBlockFrame.m_CompressedEnd = header_ptr[1];
+        out_layout->m_FrameCount = 1;
+        out_layout->m_Frames = &out_layout->m_WholeBlockFrame;
+        out_layout->m_FrameData = (const char*)&header_ptr[2];
+    }
+    else
+    {
+        out_layout->m_UncompressedSize = header_ptr[0] & ~LONGTAIL_COMPRESSED_FRAMES_FLAG;
+        out_layout->m_FrameCount = header_ptr[1];
+        out_layout->m_Frames = (const struct CompressedFrame*)&header_ptr[2];
+        out_layout->m_FrameData = (const char*)&out_layout->m_Frames[out_layout->m_FrameCount];
+        if (out_layout->m_FrameCount > chunk_count ||
+            data_size < sizeof(uint32_t) * 2 + sizeof(struct CompressedFrame) * out_layout->m_FrameCount ||
+            (out_layout->m_FrameCount > 0 && out_layout->m_Frames[out_layout->m_FrameCount - 1].m_ChunkEnd != chunk_count))
+        {
+            return EBADF;
+        }
+        const uint32_t* chunk_sizes = compressed_stored_block->m_BlockIndex->m_ChunkSizes;
+        uint64_t chunks_size = 0;
+        for (uint32_t c = 0; c < chunk_count; ++c)
+        {
+            chunks_size += chunk_sizes[c];
+        }
+        if (chunks_size != out_layout->m_UncompressedSize)
+        {
+            return EBADF;
+        }
+    }
+    size_t header_size = (size_t)(out_layout->m_FrameData - (const char*)header_ptr);
+    if (out_layout->m_FrameCount > 0 && header_size + out_layout->m_Frames[out_layout->m_FrameCount - 1].m_CompressedEnd > data_size)
+    {
+        return EBADF;
+    }
+    return 0;
+}
+
+// Decompresses frames [first_frame, end_frame) into out_data, which must fit the uncompressed size of the frames
+static int DecompressFrames(
+    struct Longtail_CompressionAPI* compression_api,
+    const uint32_t* chunk_sizes,
+    const struct CompressedBlockLayout* layout,
+    uint32_t first_frame,
+    uint32_t end_frame,
+    char* out_data)
+{
+    uint32_t chunk_index = first_frame > 0 ? layout->m_Frames[first_frame - 1].m_ChunkEnd : 0;
+    uint32_t compressed_offset = first_frame > 0 ? layout->m_Frames[first_frame - 1].m_CompressedEnd : 0;
+    size_t out_offset = 0;
+    for (uint32_t f = first_frame; f < end_frame; ++f)
+    {
+        const struct CompressedFrame* frame = &layout->m_Frames[f];
+        if (frame->m_ChunkEnd < chunk_index || frame->m_CompressedEnd < compressed_offset)
+        {
+            return EBADF;
+        }
+        size_t frame_size = 0;
+        while (chunk_index < frame->m_ChunkEnd)
+        {
+            frame_size += chunk_sizes[chunk_index++];
+        }
+        size_t real_frame_size = 0;
+        int err = compression_api->Decompress(
+            compression_api,
+            &layout->m_FrameData[compressed_offset],
+            &out_data[out_offset],
+            frame->m_CompressedEnd - compressed_offset,
+            frame_size,
+            &real_frame_size);
+        if (err)
+        {
+            return err;
+        }
+        if (real_frame_size != frame_size)
+        {
+            return EBADF;
+        }
+        out_offset += frame_size;
+        compressed_offset = frame->m_CompressedEnd;
+    }
+    return 0;
+}
+
 static int DecompressBlock(
     struct Longtail_CompressionRegistryAPI* compression_registry,
     struct Longtail_StoredBlock* compressed_stored_block,
@@ -254,12 +448,19 @@ static int DecompressBlock(
         return err;
     }
 
+    struct CompressedBlockLayout layout;
+    err = GetCompressedBlockLayout(compressed_stored_block, &layout);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DecompressBlock(%p, %p, %p) failed with %d",
+            compression_registry, compressed_stored_block, out_stored_block,
+            err)
+        return err;
+    }
+
     uint32_t chunk_count = *compressed_stored_block->m_BlockIndex->m_ChunkCount;
     uint32_t block_index_data_size = (uint32_t)Longtail_GetBlockIndexDataSize(chunk_count);
-    uint32_t* header_ptr = (uint32_t*)compressed_stored_block->m_BlockData;
-    void* compressed_chunks_data = &header_ptr[2];
-    uint32_t uncompressed_size = header_ptr[0];
-    uint32_t compressed_size = header_ptr[1];
+    uint32_t uncompressed_size = layout.m_UncompressedSize;
 
     uint32_t uncompressed_block_data_size = block_index_data_size + uncompressed_size;
     size_t uncompressed_stored_block_size = Longtail_GetStoredBlockSize(uncompressed_block_data_size);
@@ -277,21 +478,39 @@ static int DecompressBlock(
     uncompressed_stored_block->m_BlockChunksDataSize = uncompressed_size;
     memmove(&uncompressed_stored_block->m_BlockIndex[1], &compressed_stored_block->m_BlockIndex[1], block_index_data_size);
 
-    size_t real_uncompressed_size = 0;
-    err = compression_api->Decompress(
-        compression_api,
-        (const char*)compressed_chunks_data,
-        (char*)uncompressed_stored_block->m_BlockData,
-        compressed_size,
-        uncompressed_size,
-        &real_uncompressed_size);
-    if (real_uncompressed_size != uncompressed_size)
+    if (layout.m_FrameCount == 1 && layout.m_Frames == &layout.m_WholeBlockFrame)
+    {
+        // The whole-block layout does not rely on the chunk sizes adding up to the uncompressed size
+        size_t real_uncompressed_size = 0;
+        err = compression_api->Decompress(
+            compression_api,
+            layout.m_FrameData,
+            (char*)uncompressed_stored_block->m_BlockData,
+            layout.m_WholeBlockFrame.m_CompressedEnd,
+            uncompressed_size,
+            &real_uncompressed_size);
+        if (!err && real_uncompressed_size != uncompressed_size)
+        {
+            err = EBADF;
+        }
+    }
+    else
+    {
+        err = DecompressFrames(
+            compression_api,
+            uncompressed_stored_block->m_BlockIndex->m_ChunkSizes,
+            &layout,
+            0,
+            layout.m_FrameCount,
+            (char*)uncompressed_stored_block->m_BlockData);
+    }
+    if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DecompressBlock(%p, %p, %p) failed with %d",
             compression_registry, compressed_stored_block, out_stored_block,
-            ENOMEM)
+            err)
         Longtail_Free(uncompressed_stored_block);
-        return EBADF;
+        return err;
     }
     compressed_stored_block->Dispose(compressed_stored_block);
     uncompressed_stored_block->Dispose = CompressedStoredBlock_Dispose;
@@ -339,6 +558,7 @@ static void OnGetBackingStoreComplete(struct Longtail_AsyncGetStoredBlockAPI* as
         return;
     }
 
+    uint64_t decompress_start_time = Longtail_GetMetricTime();
     err = DecompressBlock(
         async_block_store->m_BlockStore->m_CompressionRegistryAPI,
         stored_block,
@@ -355,6 +575,8 @@ static void OnGetBackingStoreComplete(struct Longtail_AsyncGetStoredBlockAPI* as
         CompressBlockStore_CompleteRequest(blockstore);
         return;
     }
+    Longtail_ObserveMetricTime(Longtail_Metric_Decompress_Time, decompress_start_time);
+    Longtail_AddMetric(Longtail_Metric_Decompress_ByteCount, stored_block->m_BlockChunksDataSize);
     async_block_store->m_AsyncCompleteAPI->OnComplete(async_block_store->m_AsyncCompleteAPI, stored_block, 0);
     Longtail_Free(async_block_store);
     CompressBlockStore_CompleteRequest(blockstore);
@@ -491,10 +713,11 @@ static int CompressBlockStore_Init(
     void* mem,
     struct Longtail_BlockStoreAPI* backing_block_store,
     struct Longtail_CompressionRegistryAPI* compression_registry,
+    uint32_t min_frame_size,
     struct Longtail_BlockStoreAPI** out_block_store_api)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CompressBlockStore_Init(%p, %p, %p, %p)",
-        mem, backing_block_store, compression_registry, out_block_store_api)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CompressBlockStore_Init(%p, %p, %p, %u, %p)",
+        mem, backing_block_store, compression_registry, min_frame_size, out_block_store_api)
     LONGTAIL_FATAL_ASSERT(mem, return EINVAL)
     LONGTAIL_FATAL_ASSERT(backing_block_store, return EINVAL)
     LONGTAIL_FATAL_ASSERT(compression_registry, return EINVAL)
@@ -518,6 +741,7 @@ static int CompressBlockStore_Init(
 
     api->m_BackingBlockStore = backing_block_store;
     api->m_CompressionRegistryAPI = compression_registry;
+    api->m_MinFrameSize = min_frame_size;
     api->m_PendingRequestCount = 0;
     api->m_PendingAsyncFlushAPIs = 0;
 
@@ -538,9 +762,10 @@ static int CompressBlockStore_Init(
 
 struct Longtail_BlockStoreAPI* Longtail_CreateCompressBlockStoreAPI(
     struct Longtail_BlockStoreAPI* backing_block_store,
-    struct Longtail_CompressionRegistryAPI* compression_registry)
+    struct Longtail_CompressionRegistryAPI* compression_registry,
+    uint32_t min_frame_size)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateCompressBlockStoreAPI(%p, %p)", backing_block_store, compression_registry)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateCompressBlockStoreAPI(%p, %p, %u)", backing_block_store, compression_registry, min_frame_size)
     LONGTAIL_VALIDATE_INPUT(backing_block_store, return 0)
     LONGTAIL_VALIDATE_INPUT(compression_registry, return 0)
 
@@ -548,8 +773,8 @@ struct Longtail_BlockStoreAPI* Longtail_CreateCompressBlockStoreAPI(
     void* mem = Longtail_Alloc(api_size);
     if (!mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateCompressBlockStoreAPI(%p, %p) failed with %d",
-            backing_block_store, compression_registry,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateCompressBlockStoreAPI(%p, %p, %u) failed with %d",
+            backing_block_store, compression_registry, min_frame_size,
             ENOMEM)
         return 0;
     }
@@ -558,14 +783,140 @@ struct Longtail_BlockStoreAPI* Longtail_CreateCompressBlockStoreAPI(
         mem,
         backing_block_store,
         compression_registry,
+        min_frame_size,
         &block_store_api);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateCompressBlockStoreAPI(%p, %p) failed with %d",
-            backing_block_store, compression_registry,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateCompressBlockStoreAPI(%p, %p, %u) failed with %d",
+            backing_block_store, compression_registry, min_frame_size,
             err)
         Longtail_Free(mem);
         return 0;
     }
     return block_store_api;
 }
+
+int Longtail_DecompressBlockChunkRange(
+    struct Longtail_CompressionRegistryAPI* compression_registry,
+    const struct Longtail_StoredBlock* compressed_stored_block,
+    uint32_t chunk_start,
+    uint32_t chunk_end,
+    void* out_data)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_DecompressBlockChunkRange(%p, %p, %u, %u, %p)", compression_registry, compressed_stored_block, chunk_start, chunk_end, out_data)
+    LONGTAIL_VALIDATE_INPUT(compression_registry, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(compressed_stored_block, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunk_start <= chunk_end, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunk_end <= *compressed_stored_block->m_BlockIndex->m_ChunkCount, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_data != 0 || chunk_start == chunk_end, return EINVAL)
+
+    const uint32_t* chunk_sizes = compressed_stored_block->m_BlockIndex->m_ChunkSizes;
+    uint32_t range_offset = 0;
+    for (uint32_t c = 0; c < chunk_start; ++c)
+    {
+        range_offset += chunk_sizes[c];
+    }
+    uint32_t range_size = 0;
+    for (uint32_t c = chunk_start; c < chunk_end; ++c)
+    {
+        range_size += chunk_sizes[c];
+    }
+    if (range_size == 0)
+    {
+        return 0;
+    }
+
+    uint32_t compressionType = *compressed_stored_block->m_BlockIndex->m_Tag;
+    if (compressionType == 0)
+    {
+        if (range_offset + range_size > compressed_stored_block->m_BlockChunksDataSize)
+        {
+            return EBADF;
+        }
+        memcpy(out_data, &((const char*)compressed_stored_block->m_BlockData)[range_offset], range_size);
+        return 0;
+    }
+
+    struct Longtail_CompressionAPI* compression_api;
+    uint32_t compression_settings;
+    int err = compression_registry->GetCompressionAPI(
+        compression_registry,
+        compressionType,
+        &compression_api,
+        &compression_settings);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_DecompressBlockChunkRange(%p, %p, %u, %u, %p) failed with %d",
+            compression_registry, compressed_stored_block, chunk_start, chunk_end, out_data,
+            err)
+        return err;
+    }
+
+    struct CompressedBlockLayout layout;
+    err = GetCompressedBlockLayout(compressed_stored_block, &layout);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_DecompressBlockChunkRange(%p, %p, %u, %u, %p) failed with %d",
+            compression_registry, compressed_stored_block, chunk_start, chunk_end, out_data,
+            err)
+        return err;
+    }
+
+    uint32_t first_frame = 0;
+    while (first_frame < layout.m_FrameCount && layout.m_Frames[first_frame].m_ChunkEnd <= chunk_start)
+    {
+        ++first_frame;
+    }
+    uint32_t end_frame = first_frame;
+    while (end_frame < layout.m_FrameCount && layout.m_Frames[end_frame].m_ChunkEnd < chunk_end)
+    {
+        ++end_frame;
+    }
+    if (end_frame == layout.m_FrameCount)
+    {
+        return EBADF;
+    }
+    ++end_frame;
+
+    uint32_t frames_chunk_start = first_frame > 0 ? layout.m_Frames[first_frame - 1].m_ChunkEnd : 0;
+    uint32_t frames_chunk_end = layout.m_Frames[end_frame - 1].m_ChunkEnd;
+    if (frames_chunk_start == chunk_start && frames_chunk_end == chunk_end)
+    {
+        err = DecompressFrames(compression_api, chunk_sizes, &layout, first_frame, end_frame, (char*)out_data);
+    }
+    else
+    {
+        uint32_t skip_size = 0;
+        for (uint32_t c = frames_chunk_start; c < chunk_start; ++c)
+        {
+            skip_size += chunk_sizes[c];
+        }
+        uint32_t frames_size = skip_size + range_size;
+        for (uint32_t c = chunk_end; c < frames_chunk_end; ++c)
+        {
+            frames_size += chunk_sizes[c];
+        }
+        char* frames_data = (char*)Longtail_Alloc(frames_size);
+        if (!frames_data)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_DecompressBlockChunkRange(%p, %p, %u, %u, %p) failed with %d",
+                compression_registry, compressed_stored_block, chunk_start, chunk_end, out_data,
+                ENOMEM)
+            return ENOMEM;
+        }
+        err = DecompressFrames(compression_api, chunk_sizes, &layout, first_frame, end_frame, frames_data);
+        if (!err)
+        {
+            memcpy(out_data, &frames_data[skip_size], range_size);
+        }
+        Longtail_Free(frames_data);
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_DecompressBlockChunkRange(%p, %p, %u, %u, %p) failed with %d",
+            compression_registry, compressed_stored_block, chunk_start, chunk_end, out_data,
+            err)
+        return err;
+    }
+    return 0;
+}
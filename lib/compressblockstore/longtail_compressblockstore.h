@@ -9,9 +9,22 @@ extern "C" {
 typedef struct Longtail_CompressionAPI_CompressionContext* Longtail_CompressionAPI_HCompressionContext;
 typedef struct Longtail_CompressionAPI_DecompressionContext* Longtail_CompressionAPI_HDecompressionContext;
 
+// If min_frame_size is non-zero the chunks of a block are compressed in independent frames of
+// at least min_frame_size bytes (a chunk is never split) so parts of a block can be decompressed
+// without decompressing the whole block, see Longtail_DecompressBlockChunkRange.
 LONGTAIL_EXPORT extern struct Longtail_BlockStoreAPI* Longtail_CreateCompressBlockStoreAPI(
     struct Longtail_BlockStoreAPI* backing_block_store,
-    struct Longtail_CompressionRegistryAPI* compression_registry);
+    struct Longtail_CompressionRegistryAPI* compression_registry,
+    uint32_t min_frame_size);
+
+// Decompresses the data of chunks [chunk_start, chunk_end) of a block as stored by the compress
+// block store into out_data. Only the frames covering the chunk range are decompressed.
+LONGTAIL_EXPORT extern int Longtail_DecompressBlockChunkRange(
+    struct Longtail_CompressionRegistryAPI* compression_registry,
+    const struct Longtail_StoredBlock* compressed_stored_block,
+    uint32_t chunk_start,
+    uint32_t chunk_end,
+    void* out_data);
 
 #ifdef __cplusplus
 }
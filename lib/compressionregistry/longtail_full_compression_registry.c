@@ -29,7 +29,7 @@ struct Longtail_CompressionRegistryAPI* Longtail_CreateFullCompressionRegistry()
         return 0;
     }
 
-    uint32_t compression_types[13] = {
+    uint32_t compression_types[11] = {
         Longtail_GetBrotliGenericMinQuality(),
         Longtail_GetBrotliGenericDefaultQuality(),
         Longtail_GetBrotliGenericMaxQuality(),
@@ -41,8 +41,9 @@ struct Longtail_CompressionRegistryAPI* Longtail_CreateFullCompressionRegistry()
 
         Longtail_GetZStdMinQuality(),
         Longtail_GetZStdDefaultQuality(),
-        Longtail_GetZStdMaxQuality()};
-    struct Longtail_CompressionAPI* compression_apis[10] = {
+        Longtail_GetZStdMaxQuality(),
+        Longtail_GetZStdMaxMTQuality()};
+    struct Longtail_CompressionAPI* compression_apis[11] = {
         brotli_compression,
         brotli_compression,
         brotli_compression,
@@ -52,8 +53,9 @@ struct Longtail_CompressionRegistryAPI* Longtail_CreateFullCompressionRegistry()
         lz4_compression,
         zstd_compression,
         zstd_compression,
+        zstd_compression,
         zstd_compression};
-    uint32_t compression_settings[10] = {
+    uint32_t compression_settings[11] = {
         Longtail_GetBrotliGenericMinQuality(),
         Longtail_GetBrotliGenericDefaultQuality(),
         Longtail_GetBrotliGenericMaxQuality(),
@@ -63,10 +65,11 @@ struct Longtail_CompressionRegistryAPI* Longtail_CreateFullCompressionRegistry()
         Longtail_GetLZ4DefaultQuality(),
         Longtail_GetZStdMinQuality(),
         Longtail_GetZStdDefaultQuality(),
-        Longtail_GetZStdMaxQuality()};
+        Longtail_GetZStdMaxQuality(),
+        Longtail_GetZStdMaxMTQuality()};
 
     struct Longtail_CompressionRegistryAPI* registry = Longtail_CreateDefaultCompressionRegistry(
-        10,
+        11,
         (const uint32_t*)compression_types,
         (const struct Longtail_CompressionAPI **)compression_apis,
         compression_settings);
@@ -12,21 +12,24 @@ struct Longtail_CompressionRegistryAPI* Longtail_CreateZStdCompressionRegistry()
         return 0;
     }
 
-    uint32_t compression_types[3] = {
+    uint32_t compression_types[4] = {
         Longtail_GetZStdMinQuality(),
         Longtail_GetZStdDefaultQuality(),
-        Longtail_GetZStdMaxQuality()};
-    struct Longtail_CompressionAPI* compression_apis[3] = {
+        Longtail_GetZStdMaxQuality(),
+        Longtail_GetZStdMaxMTQuality()};
+    struct Longtail_CompressionAPI* compression_apis[4] = {
+        zstd_compression,
         zstd_compression,
         zstd_compression,
         zstd_compression};
-    uint32_t compression_settings[3] = {
+    uint32_t compression_settings[4] = {
         Longtail_GetZStdMinQuality(),
         Longtail_GetZStdDefaultQuality(),
-        Longtail_GetZStdMaxQuality()};
+        Longtail_GetZStdMaxQuality(),
+        Longtail_GetZStdMaxMTQuality()};
 
     struct Longtail_CompressionRegistryAPI* registry = Longtail_CreateDefaultCompressionRegistry(
-        3,
+        4,
         (const uint32_t*)compression_types,
         (const struct Longtail_CompressionAPI **)compression_apis,
         compression_settings);
@@ -0,0 +1,261 @@
+#include "longtail_zstd_dictionary_compression_registry.h"
+
+#include "../../src/ext/stb_ds.h"
+#include "../longtail_platform.h"
+#include "../zstd/longtail_zstd.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+struct ZStdDictionaryLookup
+{
+    uint32_t key;
+    struct Longtail_CompressionAPI* value;
+};
+
+struct ZStdDictionary_CompressionRegistry
+{
+    struct Longtail_CompressionRegistryAPI m_CompressionRegistryAPI;
+    struct Longtail_CompressionRegistryAPI* m_FallbackRegistry;
+    struct Longtail_StorageAPI* m_StorageAPI;
+    char* m_DictionaryPath;
+    HLongtail_SpinLock m_Lock;
+    struct ZStdDictionaryLookup* m_Dictionaries;
+};
+
+static char* GetDictionaryPath(struct Longtail_StorageAPI* storage_api, const char* dictionary_path, uint32_t compression_type)
+{
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "%08x.zdict", compression_type);
+    return storage_api->ConcatPath(storage_api, dictionary_path, file_name);
+}
+
+static int ReadDictionary(struct Longtail_StorageAPI* storage_api, const char* path, void** out_data, size_t* out_size)
+{
+    Longtail_StorageAPI_HOpenFile f;
+    int err = storage_api->OpenReadFile(storage_api, path, &f);
+    if (err)
+    {
+        return err;
+    }
+    uint64_t size;
+    err = storage_api->GetSize(storage_api, f, &size);
+    if (err)
+    {
+        storage_api->CloseFile(storage_api, f);
+        return err;
+    }
+    void* data = Longtail_Alloc(size ? (size_t)size : 1);
+    if (!data)
+    {
+        storage_api->CloseFile(storage_api, f);
+        return ENOMEM;
+    }
+    err = storage_api->Read(storage_api, f, 0, size, data);
+    storage_api->CloseFile(storage_api, f);
+    if (err)
+    {
+        Longtail_Free(data);
+        return err;
+    }
+    *out_data = data;
+    *out_size = (size_t)size;
+    return 0;
+}
+
+static void ZStdDictionaryCompressionRegistry_Dispose(struct Longtail_API* api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "ZStdDictionaryCompressionRegistry_Dispose(%p)", api)
+    LONGTAIL_VALIDATE_INPUT(api, return);
+    struct ZStdDictionary_CompressionRegistry* registry = (struct ZStdDictionary_CompressionRegistry*)api;
+    for (ptrdiff_t i = 0; i < hmlen(registry->m_Dictionaries); ++i)
+    {
+        SAFE_DISPOSE_API(registry->m_Dictionaries[i].value);
+    }
+    hmfree(registry->m_Dictionaries);
+    SAFE_DISPOSE_API(registry->m_FallbackRegistry);
+    Longtail_DeleteSpinLock(registry->m_Lock);
+    Longtail_Free(registry->m_Lock);
+    Longtail_Free(registry);
+}
+
+static int ZStdDictionary_GetCompressionAPI(struct Longtail_CompressionRegistryAPI* compression_registry, uint32_t compression_type, struct Longtail_CompressionAPI** out_compression_api, uint32_t* out_settings)
+{
+    LONGTAIL_FATAL_ASSERT(compression_registry, return EINVAL);
+    LONGTAIL_FATAL_ASSERT(out_compression_api, return EINVAL);
+    LONGTAIL_FATAL_ASSERT(out_settings, return EINVAL);
+
+    struct ZStdDictionary_CompressionRegistry* registry = (struct ZStdDictionary_CompressionRegistry*)compression_registry;
+    if (!Longtail_IsZStdDictionaryCompressionType(compression_type))
+    {
+        return registry->m_FallbackRegistry->GetCompressionAPI(registry->m_FallbackRegistry, compression_type, out_compression_api, out_settings);
+    }
+
+    Longtail_LockSpinLock(registry->m_Lock);
+    intptr_t i = hmgeti(registry->m_Dictionaries, compression_type);
+    if (i != -1)
+    {
+        *out_compression_api = registry->m_Dictionaries[i].value;
+        *out_settings = compression_type;
+        Longtail_UnlockSpinLock(registry->m_Lock);
+        return 0;
+    }
+    Longtail_UnlockSpinLock(registry->m_Lock);
+
+    char* path = GetDictionaryPath(registry->m_StorageAPI, registry->m_DictionaryPath, compression_type);
+    void* dictionary_data = 0;
+    size_t dictionary_size = 0;
+    int err = ReadDictionary(registry->m_StorageAPI, path, &dictionary_data, &dictionary_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "ZStdDictionary_GetCompressionAPI(%p, %u, %p, %p) failed to read `%s` with %d", compression_registry, compression_type, out_compression_api, out_settings, path, err)
+        Longtail_Free(path);
+        return ENOENT;
+    }
+    Longtail_Free(path);
+    struct Longtail_CompressionAPI* compression_api = dictionary_size ? Longtail_CreateZStdDictionaryCompressionAPI(dictionary_data, dictionary_size) : 0;
+    Longtail_Free(dictionary_data);
+    if (!compression_api)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "ZStdDictionary_GetCompressionAPI(%p, %u, %p, %p) failed with %d", compression_registry, compression_type, out_compression_api, out_settings, EBADF)
+        return EBADF;
+    }
+
+    Longtail_LockSpinLock(registry->m_Lock);
+    i = hmgeti(registry->m_Dictionaries, compression_type);
+    if (i != -1)
+    {
+        // Another thread loaded the same dictionary
+        SAFE_DISPOSE_API(compression_api);
+        compression_api = registry->m_Dictionaries[i].value;
+    }
+    else
+    {
+        hmput(registry->m_Dictionaries, compression_type, compression_api);
+    }
+    Longtail_UnlockSpinLock(registry->m_Lock);
+    *out_compression_api = compression_api;
+    *out_settings = compression_type;
+    return 0;
+}
+
+struct Longtail_CompressionRegistryAPI* Longtail_CreateZStdDictionaryCompressionRegistry(
+    struct Longtail_StorageAPI* storage_api,
+    const char* dictionary_path,
+    struct Longtail_CompressionRegistryAPI* fallback_registry)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateZStdDictionaryCompressionRegistry(%p, %s, %p)", storage_api, dictionary_path, fallback_registry)
+    LONGTAIL_VALIDATE_INPUT(storage_api, return 0);
+    LONGTAIL_VALIDATE_INPUT(dictionary_path, return 0);
+    LONGTAIL_VALIDATE_INPUT(fallback_registry, return 0);
+    size_t dictionary_path_size = strlen(dictionary_path) + 1;
+    size_t registry_size = sizeof(struct ZStdDictionary_CompressionRegistry) + dictionary_path_size;
+    void* mem = Longtail_Alloc(registry_size);
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionaryCompressionRegistry(%p, %s, %p) failed with %d",
+            storage_api, dictionary_path, fallback_registry,
+            ENOMEM)
+        return 0;
+    }
+
+    struct ZStdDictionary_CompressionRegistry* registry = (struct ZStdDictionary_CompressionRegistry*)Longtail_MakeCompressionRegistryAPI(
+        mem,
+        ZStdDictionaryCompressionRegistry_Dispose,
+        ZStdDictionary_GetCompressionAPI);
+
+    registry->m_FallbackRegistry = fallback_registry;
+    registry->m_StorageAPI = storage_api;
+    registry->m_DictionaryPath = (char*)&registry[1];
+    memmove(registry->m_DictionaryPath, dictionary_path, dictionary_path_size);
+    registry->m_Dictionaries = 0;
+    int err = Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &registry->m_Lock);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionaryCompressionRegistry(%p, %s, %p) failed with %d",
+            storage_api, dictionary_path, fallback_registry,
+            err)
+        Longtail_Free(mem);
+        return 0;
+    }
+    return &registry->m_CompressionRegistryAPI;
+}
+
+int Longtail_WriteZStdDictionary(
+    struct Longtail_StorageAPI* storage_api,
+    const char* dictionary_path,
+    const void* dictionary_data,
+    size_t dictionary_size,
+    uint32_t* out_compression_type)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_WriteZStdDictionary(%p, %s, %p, %" PRIu64 ", %p)", storage_api, dictionary_path, dictionary_data, (uint64_t)dictionary_size, out_compression_type)
+    LONGTAIL_VALIDATE_INPUT(storage_api, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(dictionary_path, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(dictionary_data, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(dictionary_size > 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(out_compression_type, return EINVAL);
+
+    // The dictionary id is derived from the content so the same dictionary maps to the same id across upsyncs
+    uint32_t content_hash = 2166136261u;
+    for (size_t i = 0; i < dictionary_size; ++i)
+    {
+        content_hash = (content_hash ^ ((const uint8_t*)dictionary_data)[i]) * 16777619u;
+    }
+    uint16_t dictionary_id = (uint16_t)((content_hash >> 16) ^ content_hash);
+    for (uint32_t attempt = 0; attempt <= 0xffff; ++attempt)
+    {
+        uint32_t compression_type = Longtail_GetZStdDictionaryCompressionType((uint16_t)(dictionary_id + attempt));
+        char* path = GetDictionaryPath(storage_api, dictionary_path, compression_type);
+        if (storage_api->IsFile(storage_api, path))
+        {
+            void* existing_data = 0;
+            size_t existing_size = 0;
+            int err = ReadDictionary(storage_api, path, &existing_data, &existing_size);
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteZStdDictionary(%p, %s, %p, %" PRIu64 ", %p) failed to read `%s` with %d",
+                    storage_api, dictionary_path, dictionary_data, (uint64_t)dictionary_size, out_compression_type,
+                    path, err)
+                Longtail_Free(path);
+                return err;
+            }
+            int is_same = existing_size == dictionary_size && memcmp(existing_data, dictionary_data, dictionary_size) == 0;
+            Longtail_Free(existing_data);
+            Longtail_Free(path);
+            if (is_same)
+            {
+                *out_compression_type = compression_type;
+                return 0;
+            }
+            continue;
+        }
+        int err = EnsureParentPathExists(storage_api, path);
+        Longtail_StorageAPI_HOpenFile f = 0;
+        if (!err)
+        {
+            err = storage_api->OpenWriteFile(storage_api, path, 0, &f);
+        }
+        if (!err)
+        {
+            err = storage_api->Write(storage_api, f, 0, dictionary_size, dictionary_data);
+            storage_api->CloseFile(storage_api, f);
+        }
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteZStdDictionary(%p, %s, %p, %" PRIu64 ", %p) failed to write `%s` with %d",
+                storage_api, dictionary_path, dictionary_data, (uint64_t)dictionary_size, out_compression_type,
+                path, err)
+            Longtail_Free(path);
+            return err;
+        }
+        Longtail_Free(path);
+        *out_compression_type = compression_type;
+        return 0;
+    }
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteZStdDictionary(%p, %s, %p, %" PRIu64 ", %p) failed with %d",
+        storage_api, dictionary_path, dictionary_data, (uint64_t)dictionary_size, out_compression_type,
+        ENOSPC)
+    return ENOSPC;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../../src/longtail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Resolves zstd dictionary compression types by loading the referenced dictionary from
+// dictionary_path on first use, other compression types are resolved by fallback_registry.
+// The registry takes ownership of fallback_registry.
+LONGTAIL_EXPORT extern struct Longtail_CompressionRegistryAPI* Longtail_CreateZStdDictionaryCompressionRegistry(
+    struct Longtail_StorageAPI* storage_api,
+    const char* dictionary_path,
+    struct Longtail_CompressionRegistryAPI* fallback_registry);
+
+// Stores a dictionary in dictionary_path and returns the zstd dictionary compression type referencing it.
+// If an identical dictionary is already stored its compression type is returned.
+LONGTAIL_EXPORT extern int Longtail_WriteZStdDictionary(
+    struct Longtail_StorageAPI* storage_api,
+    const char* dictionary_path,
+    const void* dictionary_data,
+    size_t dictionary_size,
+    uint32_t* out_compression_type);
+
+#ifdef __cplusplus
+}
+#endif
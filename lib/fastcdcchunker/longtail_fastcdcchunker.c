@@ -0,0 +1,466 @@
+// https://www.usenix.org/conference/atc16/technical-sessions/presentation/xia
+
+#include "longtail_fastcdcchunker.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+const uint32_t LONGTAIL_FASTCDC_CHUNKER_TYPE = (((uint32_t)'f') << 24) + (((uint32_t)'c') << 16) + (((uint32_t)'d') << 8) + ((uint32_t)'c');
+const uint32_t Longtail_GetFastCDCChunkerType() { return LONGTAIL_FASTCDC_CHUNKER_TYPE; }
+
+// Each step shifts the hash one bit so a byte no longer affects the hash after 64 steps
+#define FastCDCWindowSize 64u
+
+// Number of mask bits added before and removed after the average chunk size
+#define FastCDCNormalizationLevel 2u
+
+// Generated with splitmix64, changing the table changes all chunk boundaries
+static const uint64_t GearTable[256] = {
+    0xe9da33d53a399390ull, 0x808dca3a9e46625dull, 0x99b259741eaf60a9ull, 0xb12e8324f49483b8ull,
+    0xb6a4ec520391c1caull, 0x30de6a72b414cbfcull, 0x87064a34ed68c485ull, 0x04757952bdbb2de2ull,
+    0x4b61122e4c4fd62cull, 0x3bd2793179b080eaull, 0xc573a3f52a0c3ee9ull, 0xab92aef9c7e8dc71ull,
+    0x2a7fb29d2f2bdfbcull, 0x2b325658128dd7ddull, 0x98b7615e40be81beull, 0x01cbf3f302fe7927ull,
+    0x0328afb09ac08fa5ull, 0x975eb5ab0dc23426ull, 0x8c1480a69bfe1beeull, 0xaf38e1cd52dd98f6ull,
+    0xe00626ed66386f25ull, 0xc8a0c335c41a10f4ull, 0x74cb6e86b80eb674ull, 0xedbbf3673fa25f23ull,
+    0x078966ae8b596cddull, 0x671273ada77019c1ull, 0xdfecec3ac1c7d5e9ull, 0xccf082735c883df5ull,
+    0xd2b7cba894cca383ull, 0x50b8cc34096a6256ull, 0x459195447389c03eull, 0x6eaf627de69674d2ull,
+    0xdb1660a047ed6cc9ull, 0xa4be3497c6d2e11bull, 0xcbc8410e6bb1f322ull, 0x357f9cd79f2fae31ull,
+    0x23b802ee8e7b77e1ull, 0x36cdb777a016725aull, 0xd3918e2b72993757ull, 0x9523af6eba4733bfull,
+    0xb87d608b53c0feedull, 0x6fd76e741cea7dcaull, 0x59decd0e74745065ull, 0xdcf3831493e5a7a3ull,
+    0x8513fdb9d175e4fcull, 0x50f81f3c3be46454ull, 0x21880a9a36de35f1ull, 0x717a4c6aa3cceec3ull,
+    0xc9c41849832ceddfull, 0x6b8c88a7c1d34e26ull, 0x627b5f0bc475938eull, 0xeb1aba4a0462a574ull,
+    0x26071a60c2b2e3a2ull, 0x027c92081e8aeac5ull, 0x0145d026339a3e7bull, 0x230b75005aef4ee2ull,
+    0x651ed8002d18e8ecull, 0x5ca1ec3a9f316cc4ull, 0x1715ec775185c12bull, 0x277a672d63acbd2bull,
+    0x7bc38336ac2ff6d8ull, 0x3de617232ccecd66ull, 0x66716328b9a32ccdull, 0xe6338410daa02541ull,
+    0x25372c0e1332dc5aull, 0xb1b3ad9cab044e06ull, 0xbb0b5f27980ee245ull, 0x49ab4e750818d15dull,
+    0x411897ec7fef65dcull, 0x27e53dec311541fbull, 0x6e877b0ebc244585ull, 0xcc7164a6c1255c3eull,
+    0x0fad150a8eb7d3d1ull, 0xf5c713ccddd61a34ull, 0x3e9b0600214d183eull, 0x000c9e293d0e462cull,
+    0x3178f43993333932ull, 0x5456a0d62b60761aull, 0xe64d486be9b97205ull, 0x70e1ea393eee5a44ull,
+    0x808d5cfda79b2ab6ull, 0xb2e313bd1e6d5d51ull, 0x6d89e4f723e447baull, 0x3a8178656f01e9a2ull,
+    0x38fea0ea43907496ull, 0x3c4a5d9011f30a5bull, 0xca8ae24dc33a9642ull, 0x912e0e2a10232b54ull,
+    0x663d27bbf0c57407ull, 0x95fe2ff5ffe556f4ull, 0xeb133bfb3f209a49ull, 0xcd049cf110f1696aull,
+    0xd44072f442c3f0c2ull, 0x9a4b9e5cf36b3c28ull, 0x97af57c4d35111ddull, 0xd6564720443df463ull,
+    0x0a364909a9288856ull, 0xec4b33e44a030803ull, 0x29212db5e08e8475ull, 0x86785638ad25197bull,
+    0x136853f5b8c3da66ull, 0xdf55f99a48a55d40ull, 0xb9b1511bdfa4bd10ull, 0xc174432c19bbcaecull,
+    0x6d548aac62274292ull, 0xb4a1e4d4acb25fc2ull, 0x86e383a30e51c730ull, 0x40379fd15ee79164ull,
+    0xa56148f63d55b8ffull, 0xd2301664faf7f29bull, 0x8f8be184744268c8ull, 0x932ee40d5d36f588ull,
+    0x7958110b4314e1ceull, 0x2c166d50f9824bd9ull, 0x90a9acf4f5d9cb7full, 0xba56d5aa1ec4ac40ull,
+    0x862d7c520c5e146full, 0xeb2308bac837e60full, 0x9f57b83f145ef3f0ull, 0x9a9227b3ba5136a1ull,
+    0x31ea8289d2207256ull, 0x157ce5fee736114aull, 0x1c38b85095a667e7ull, 0xecdaa57c1a6a1e22ull,
+    0x6b72edf4c241ae59ull, 0x92b16df231d60431ull, 0x3f175192f2c44734ull, 0xcd5db2dfeff3fec7ull,
+    0x3f6ee943ee8eb6beull, 0xb3be5fa84c9ed8c7ull, 0x26cb3c37b8aa5832ull, 0xef64dcac8a4b67f5ull,
+    0x265e59e775be15beull, 0x6a1c29c5713d1ab0ull, 0xf6cea559b201855dull, 0x79257147baa323b9ull,
+    0x8b030d3513bc4bacull, 0xc17340893896c812ull, 0xbcda9c7ec8a78ecdull, 0xbd9bd6e71a7b5078ull,
+    0xb9ffc079921ee458ull, 0xa026a4417866d778ull, 0xee9a329fb983092bull, 0xd96fe41d638e8074ull,
+    0xcddfa6b46eb663c3ull, 0x5f1d9922a13933daull, 0x51ff3c4e0709a3e0ull, 0xaf76ec62c4db24efull,
+    0x6d01c75b85b5781aull, 0xa52919cc8b6752e4ull, 0x654219aa786d814dull, 0x882b59355a55c71eull,
+    0xbc22a706f01afe9dull, 0xf5246f2317df006full, 0x06256b01f9aeec5bull, 0x0ce59f837e57f80cull,
+    0x1cd9c11995ff805aull, 0x5ea4969254518519ull, 0xd3f97a972414faa8ull, 0x6683c39151d6cc9full,
+    0xab0a34f32ba43cf9ull, 0x709eae506f3e902dull, 0xc4b99ec22eb4a27aull, 0x074600b8b9ce7927ull,
+    0x16e799f7ee0da388ull, 0x8a96195e242d1d14ull, 0xf8e47f2fd5d31b11ull, 0x6f1d69865e46c31eull,
+    0x389267a6ffb81edcull, 0xdae0b4a399232714ull, 0xdab822c4ee023a86ull, 0x518d400b8f843498ull,
+    0xe1d7b435b6378655ull, 0xc20c207ab2517b4dull, 0x4906bc7e9276d29cull, 0x9bce573ee3c95bfaull,
+    0xf1d48c8a38e06c4dull, 0xa8ea03579acc8f6eull, 0x21c0cebfe7ad41edull, 0x78b7094493aa785eull,
+    0xdd955677c0e9d44bull, 0x6d3616790ce8a230ull, 0x3d6895718624ce69ull, 0xea4c676e037b187full,
+    0x2e36fde8f543d5b7ull, 0x9445eb025b16a8d5ull, 0x3861e3bffa6e0fc1ull, 0x1b00e3460d97a7dcull,
+    0x5379ce7d9cfb6685ull, 0x629f73d429bc41dbull, 0xf7e2da59ebfc4a9aull, 0xd99e0dd2a0714b57ull,
+    0xf422607129d27ee7ull, 0x2e6e673a134db264ull, 0x02c2c867396fd944ull, 0x572256069903cd33ull,
+    0xe975d2bf7b6940d1ull, 0x332634fb284a8b56ull, 0x7a4a5e0c3e80d3b1ull, 0x2448024e12c47a8cull,
+    0xf71ba40fc7f52c6eull, 0xf887aa65fb0efba1ull, 0x138e5301ec158422ull, 0xd0f1c2a6ceb53b67ull,
+    0x798a086bf4c8767dull, 0x3e7e4dc44ee5ac0dull, 0x0d7369d2967cbd75ull, 0x505d6e02221feb3eull,
+    0xb9b3a727e1ed2aa9ull, 0x5fa7a6b06167e783ull, 0xdcebc7070b11b4d3ull, 0x8ec22f7dbddf1448ull,
+    0x42c3179671b582caull, 0x8b9b38ff92683cc8ull, 0x6fa658a4fa86a12bull, 0xa129da7d0f8d2040ull,
+    0x13d3464157e9840cull, 0x80a1d4d02433ea6aull, 0x38f01b06e7733634ull, 0x7dcb8c64b57fd03cull,
+    0xbb2c309eed631981ull, 0xac99e79d07df32e3ull, 0xa913a53cda4f8e2dull, 0x6aeec75033d4ed78ull,
+    0xeff70f5992ec98d1ull, 0x2f82019d04313a7bull, 0x99521a0f0e7cc6e1ull, 0xf3f5722f2e009ef6ull,
+    0xfd69a46c1842ae4bull, 0xf2298cd77475d17cull, 0xfe647afbbb12f6ccull, 0xd02eea5b94f5e2cfull,
+    0xe6fd022c910bd1f4ull, 0xed45844dbebe20afull, 0xdf9c41a8d18ebedbull, 0xf3babbb7d8b210caull,
+    0x3cae1f1cdacc05afull, 0xca4038d39f1b0f9eull, 0x3dd921eede85f842ull, 0x69b10ec6f6983f1bull,
+    0xd607553365e19690ull, 0x71874ba63debb410ull, 0xf118db04672a0319ull, 0x50fb52349d53179dull,
+    0x184e3183aca944ffull, 0x19a411dc35ee5364ull, 0xa9ec39cd6580f6ecull, 0x19b9bba248bf06fbull,
+    0x9473d103c4be0469ull, 0xeb3040a8c21f817aull, 0x6435ebce15bb32c8ull, 0x075bedefa762bb2bull,
+    0xdd287cddfa88a11dull, 0xab57c18d0770b6d6ull, 0x32ac5b9a032683efull, 0xdffabad80406a01aull,
+};
+
+struct Longtail_FastCDCChunkerParams
+{
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+};
+
+struct Longtail_FastCDCChunker
+{
+    struct Longtail_FastCDCChunkerParams params;
+    uint8_t* buf;
+    uint32_t len;
+    uint32_t max_feed;
+    uint32_t off;
+    uint64_t mask_s;
+    uint64_t mask_l;
+    uint64_t processed_count;
+};
+
+static uint32_t Log2Round(uint32_t v)
+{
+    uint32_t bits = 0;
+    while ((v >> (bits + 1)) != 0)
+    {
+        ++bits;
+    }
+    // Round up if v is closer to the next power of two
+    if (bits < 31 && (v - (1u << bits)) > ((1u << (bits + 1)) - v))
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+// Mask with the `bits` most significant bits set, the high bits of the gear hash depend on the most input bytes
+static uint64_t FastCDCMask(uint32_t bits)
+{
+    if (bits == 0)
+    {
+        return 0;
+    }
+    if (bits >= 64)
+    {
+        return ~0ull;
+    }
+    return ~0ull << (64 - bits);
+}
+
+static int FastCDCCreateChunker(
+    struct Longtail_FastCDCChunkerParams* params,
+    struct Longtail_FastCDCChunker** out_chunker)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCCreateChunker(%p, %p)",
+        params, out_chunker)
+    LONGTAIL_FATAL_ASSERT(params != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(params->min >= FastCDCWindowSize, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(params->min <= params->max, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(params->min <= params->avg, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(params->avg <= params->max, return EINVAL)
+
+    size_t max_feed = (size_t)params->max * 4;
+    if (max_feed >= 0xffffffffu)
+    {
+        max_feed = 0xffffffffu;
+    }
+
+    // The feed buffer is only allocated if the chunker is fed, chunking from a buffer does not need it
+    size_t chunker_size = sizeof(struct Longtail_FastCDCChunker);
+    struct Longtail_FastCDCChunker* c = (struct Longtail_FastCDCChunker*)Longtail_Alloc(chunker_size);
+    if (!c)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FastCDCCreateChunker(%p, %p) failed with %d",
+            params, out_chunker,
+            ENOMEM)
+        return ENOMEM;
+    }
+    uint32_t bits = Log2Round(params->avg);
+    c->params = *params;
+    c->buf = 0;
+    c->len = 0;
+    c->max_feed = (uint32_t)max_feed;
+    c->off = 0;
+    c->mask_s = FastCDCMask(bits + FastCDCNormalizationLevel);
+    c->mask_l = FastCDCMask(bits > FastCDCNormalizationLevel ? bits - FastCDCNormalizationLevel : 1);
+    c->processed_count = 0;
+    *out_chunker = c;
+    return 0;
+}
+
+static int FeedChunker(
+    struct Longtail_FastCDCChunker* c,
+    Longtail_Chunker_Feeder feeder,
+    void* context)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FeedChunker(%p)",
+        c)
+    LONGTAIL_FATAL_ASSERT(c != 0, return EINVAL)
+
+    if (c->buf == 0)
+    {
+        c->buf = (uint8_t*)Longtail_Alloc(c->max_feed);
+        if (!c->buf)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FeedChunker(%p) failed with %d",
+                c,
+                ENOMEM)
+            return ENOMEM;
+        }
+    }
+
+    if (c->off != 0)
+    {
+        memmove(c->buf, &c->buf[c->off], c->len - c->off);
+        c->processed_count += c->off;
+        c->len -= c->off;
+        c->off = 0;
+    }
+    uint32_t feed_max = (uint32_t)(c->max_feed - c->len);
+    uint32_t feed_count;
+    int err = feeder(context, (Longtail_ChunkerAPI_HChunker)c, feed_max, (char*)&c->buf[c->len], &feed_count);
+    c->len += feed_count;
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FeedChunker(%p) failed with %d",
+            c,
+            err)
+    }
+    return err;
+}
+
+#define FASTCDC_STEP(mask) \
+    hash = (hash << 1) + GearTable[data[pos++]]; \
+    if ((hash & (mask)) == 0) \
+    { \
+        *io_hash = hash; \
+        return pos; \
+    }
+
+// Returns the position after the first cut point in [pos, end), or end if there is none
+static uint32_t FastCDCScan(const uint8_t* data, uint32_t pos, uint32_t end, uint64_t mask, uint64_t* io_hash)
+{
+    uint64_t hash = *io_hash;
+    // Unrolled so the loop condition is only checked every fourth byte
+    while (pos + 4 <= end)
+    {
+        FASTCDC_STEP(mask)
+        FASTCDC_STEP(mask)
+        FASTCDC_STEP(mask)
+        FASTCDC_STEP(mask)
+    }
+    while (pos < end)
+    {
+        FASTCDC_STEP(mask)
+    }
+    *io_hash = hash;
+    return end;
+}
+
+#undef FASTCDC_STEP
+
+// Returns the length of the chunk at the start of data, left must be larger than the min chunk size
+static uint32_t FastCDCFindChunkLength(
+    const struct Longtail_FastCDCChunker* c,
+    const uint8_t* data,
+    uint32_t left)
+{
+    uint32_t end = left > c->params.max ? c->params.max : left;
+    uint32_t normal = c->params.avg < end ? c->params.avg : end;
+
+    // Warm up on the window before min so the cut points only depend on the preceding FastCDCWindowSize bytes
+    uint64_t hash = 0;
+    for (uint32_t i = c->params.min - FastCDCWindowSize; i < c->params.min; ++i)
+    {
+        hash = (hash << 1) + GearTable[data[i]];
+    }
+
+    // Harder to cut before the average size and easier after it which narrows the chunk size distribution
+    uint32_t pos = FastCDCScan(data, c->params.min, normal, c->mask_s, &hash);
+    if (pos == normal)
+    {
+        pos = FastCDCScan(data, normal, end, c->mask_l, &hash);
+    }
+    return pos;
+}
+
+static const struct Longtail_Chunker_ChunkRange EmptyChunkRange = {0, 0, 0};
+
+static struct Longtail_Chunker_ChunkRange FastCDCNextChunk(
+    struct Longtail_FastCDCChunker* c,
+    Longtail_Chunker_Feeder feeder,
+    void* context)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCNextChunk(%p)",
+        c)
+    LONGTAIL_FATAL_ASSERT(c != 0, return EmptyChunkRange)
+    if (c->len - c->off < c->params.max)
+    {
+        int err = FeedChunker(c, feeder, context);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FastCDCNextChunk(%p) failed with %d",
+                c,
+                err)
+            return EmptyChunkRange;
+        }
+    }
+    if (c->off == c->len)
+    {
+        // All done
+        struct Longtail_Chunker_ChunkRange r = {0, c->processed_count + c->off, 0};
+        return r;
+    }
+
+    uint32_t left = c->len - c->off;
+    if (left <= c->params.min)
+    {
+        // Less than min-size left, just consume it all
+        struct Longtail_Chunker_ChunkRange r = {&c->buf[c->off], c->processed_count + c->off, left};
+        c->off += left;
+        return r;
+    }
+
+    const uint8_t* data = &c->buf[c->off];
+    uint32_t pos = FastCDCFindChunkLength(c, data, left);
+    struct Longtail_Chunker_ChunkRange r = {data, c->processed_count + c->off, pos};
+    c->off += pos;
+    return r;
+}
+
+struct Longtail_FastCDCChunkerAPI
+{
+    struct Longtail_ChunkerAPI m_API;
+};
+
+static void FastCDCChunker_Dispose(struct Longtail_API* base_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_Dispose(%p)", base_api)
+    LONGTAIL_FATAL_ASSERT(base_api, return)
+    struct Longtail_FastCDCChunkerAPI* api = (struct Longtail_FastCDCChunkerAPI*)base_api;
+    Longtail_Free(api);
+}
+
+static uint32_t FastCDCChunker_GetIdentifier(struct Longtail_ChunkerAPI* chunker_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_GetIdentifier(%p)", chunker_api)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return 0)
+    return LONGTAIL_FASTCDC_CHUNKER_TYPE;
+}
+
+static int FastCDCChunker_GetMinChunkSize(struct Longtail_ChunkerAPI* chunker_api, uint32_t* out_min_chunk_size)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_GetMinChunkSize(%p, %p)", chunker_api, out_min_chunk_size)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_min_chunk_size, return EINVAL)
+    *out_min_chunk_size = FastCDCWindowSize;
+    return 0;
+}
+
+static int FastCDCChunker_CreateChunker(struct Longtail_ChunkerAPI* chunker_api, uint32_t min_chunk_size, uint32_t avg_chunk_size, uint32_t max_chunk_size, Longtail_ChunkerAPI_HChunker* out_chunker)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_CreateChunker(%p, %u, %u, %u, %p)", chunker_api, min_chunk_size, avg_chunk_size, max_chunk_size, out_chunker)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(min_chunk_size >= FastCDCWindowSize, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(min_chunk_size <= avg_chunk_size, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(avg_chunk_size <= max_chunk_size, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_chunker, return EINVAL)
+
+    struct Longtail_FastCDCChunkerParams chunker_params;
+    chunker_params.min = min_chunk_size;
+    chunker_params.avg = avg_chunk_size;
+    chunker_params.max = max_chunk_size;
+
+    struct Longtail_FastCDCChunker* chunker;
+    int err = FastCDCCreateChunker(&chunker_params, &chunker);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FastCDCChunker_CreateChunker(%p, %u, %u, %u, %p) failed with %d",
+            chunker_api, min_chunk_size, avg_chunk_size, max_chunk_size, out_chunker,
+            err)
+        return err;
+    }
+    *out_chunker = (Longtail_ChunkerAPI_HChunker)chunker;
+    return 0;
+}
+
+static int FastCDCChunker_NextChunk(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, Longtail_Chunker_Feeder feeder, void* feeder_context, struct Longtail_Chunker_ChunkRange* out_chunk_range)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_NextChunk(%p, %p, %p, %p, %p)",
+        chunker_api, chunker, feeder, feeder_context, out_chunk_range)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunker, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(feeder_context, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_chunk_range, return EINVAL)
+
+    struct Longtail_FastCDCChunker* c = (struct Longtail_FastCDCChunker*)chunker;
+    *out_chunk_range = FastCDCNextChunk(c, feeder, feeder_context);
+    if (out_chunk_range->len == 0)
+    {
+        return ESPIPE;
+    }
+    return 0;
+}
+
+static int FastCDCChunker_DisposeChunker(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_DisposeChunker(%p, %p)",
+        chunker_api, chunker)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunker, return EINVAL)
+    struct Longtail_FastCDCChunker* c = (struct Longtail_FastCDCChunker*)chunker;
+    Longtail_Free(c->buf);
+    Longtail_Free(c);
+    return 0;
+}
+
+static int FastCDCChunker_NextChunkFromBuffer(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, const void* buffer, uint64_t buffer_size, const void** out_next_chunk_start)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_NextChunkFromBuffer(%p, %p, %p, %" PRIu64 ", %p)",
+        chunker_api, chunker, buffer, buffer_size, out_next_chunk_start)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunker, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(buffer, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(buffer_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_next_chunk_start, return EINVAL)
+
+    const struct Longtail_FastCDCChunker* c = (const struct Longtail_FastCDCChunker*)chunker;
+    uint32_t left = buffer_size > c->params.max ? c->params.max : (uint32_t)buffer_size;
+    uint32_t len = (left <= c->params.min) ? left : FastCDCFindChunkLength(c, (const uint8_t*)buffer, left);
+    *out_next_chunk_start = &((const uint8_t*)buffer)[len];
+    return 0;
+}
+
+static int FastCDCChunker_Init(
+    void* mem,
+    struct Longtail_ChunkerAPI** out_chunker_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FastCDCChunker_Init(%p, %p)", mem, out_chunker_api)
+    LONGTAIL_VALIDATE_INPUT(mem != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_chunker_api != 0, return EINVAL)
+
+    struct Longtail_ChunkerAPI* chunker_api = Longtail_MakeChunkerAPI(
+        mem,
+        FastCDCChunker_Dispose,
+        FastCDCChunker_GetIdentifier,
+        FastCDCChunker_GetMinChunkSize,
+        FastCDCChunker_CreateChunker,
+        FastCDCChunker_NextChunk,
+        FastCDCChunker_DisposeChunker,
+        FastCDCChunker_NextChunkFromBuffer);
+    if (!chunker_api)
+    {
+        return EINVAL;
+    }
+    *out_chunker_api = chunker_api;
+    return 0;
+}
+
+struct Longtail_ChunkerAPI* Longtail_CreateFastCDCChunkerAPI()
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateFastCDCChunkerAPI()%s", "")
+
+    void* mem = Longtail_Alloc(sizeof(struct Longtail_FastCDCChunkerAPI));
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFastCDCChunkerAPI() failed with %d",
+            ENOMEM)
+        return 0;
+    }
+    struct Longtail_ChunkerAPI* chunker_api;
+    int err = FastCDCChunker_Init(
+        mem,
+        &chunker_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFastCDCChunkerAPI() failed with %d",
+            err)
+        Longtail_Free(mem);
+        return 0;
+    }
+    return chunker_api;
+}
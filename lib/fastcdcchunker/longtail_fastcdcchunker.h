@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../../src/longtail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gear hash based chunker with normalized chunking, see FastCDC (Xia et al, USENIX ATC 2016)
+LONGTAIL_EXPORT extern struct Longtail_ChunkerAPI* Longtail_CreateFastCDCChunkerAPI();
+LONGTAIL_EXPORT extern const uint32_t Longtail_GetFastCDCChunkerType();
+
+#ifdef __cplusplus
+}
+#endif
@@ -84,6 +84,7 @@ static int FSStorageAPI_Read(struct Longtail_StorageAPI* storage_api, Longtail_S
             err)
         return err;
     }
+    Longtail_AddMetric(Longtail_Metric_FileStorage_ReadByteCount, length);
     return 0;
 }
 
@@ -120,6 +121,7 @@ static int FSStorageAPI_Write(struct Longtail_StorageAPI* storage_api, Longtail_
             err)
         return 0;
     }
+    Longtail_AddMetric(Longtail_Metric_FileStorage_WriteByteCount, length);
     return err;
 }
 
@@ -347,7 +349,7 @@ static int FSStorageAPI_GetEntryProperties(struct Longtail_StorageAPI* storage_a
     LONGTAIL_FATAL_ASSERT(storage_api != 0, return EINVAL);
     LONGTAIL_FATAL_ASSERT(iterator != 0, return EINVAL);
     LONGTAIL_FATAL_ASSERT(out_properties != 0, return EINVAL);
-    int err = Longtail_GetEntryProperties((HLongtail_FSIterator)iterator, &out_properties->m_Size, &out_properties->m_Permissions, &out_properties->m_IsDir);
+    int err = Longtail_GetEntryProperties((HLongtail_FSIterator)iterator, &out_properties->m_Size, &out_properties->m_Permissions, &out_properties->m_IsDir, &out_properties->m_ModificationTime, &out_properties->m_ChangeTime, &out_properties->m_FileId);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "FSStorageAPI_GetEntryProperties(%p, %p, %p) failed with %d",
@@ -388,6 +390,58 @@ static int FSStorageAPI_UnlockFile(struct Longtail_StorageAPI* storage_api, Long
     return 0;
 }
 
+static int FSStorageAPI_MapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(f != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(length != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(out_file_map != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(out_data_ptr != 0, return EINVAL);
+    void* mem = Longtail_Alloc(Longtail_GetFileMapSize());
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSStorageAPI_MapFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            storage_api, f, offset, length, out_file_map, out_data_ptr,
+            ENOMEM)
+        return ENOMEM;
+    }
+    HLongtail_FileMap file_map;
+    int err = Longtail_MapFile(mem, (HLongtail_OpenFile)f, offset, length, &file_map, out_data_ptr);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSStorageAPI_MapFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            storage_api, f, offset, length, out_file_map, out_data_ptr,
+            err)
+        Longtail_Free(mem);
+        return err;
+    }
+    *out_file_map = (Longtail_StorageAPI_HFileMap)file_map;
+    return 0;
+}
+
+static void FSStorageAPI_UnmapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return);
+    LONGTAIL_VALIDATE_INPUT(file_map != 0, return);
+    Longtail_UnmapFile((HLongtail_FileMap)file_map);
+    Longtail_Free(file_map);
+}
+
+static int FSStorageAPI_AdviseSequentialRead(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(f != 0, return EINVAL);
+    int err = Longtail_AdviseSequentialRead((HLongtail_OpenFile)f);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "FSStorageAPI_AdviseSequentialRead(%p, %p) failed with %d",
+            storage_api, f,
+            err)
+        return err;
+    }
+    return 0;
+}
+
 static int FSStorageAPI_Init(
     void* mem,
     struct Longtail_StorageAPI** out_storage_api)
@@ -417,7 +471,10 @@ static int FSStorageAPI_Init(
         FSStorageAPI_CloseFind,
         FSStorageAPI_GetEntryProperties,
         FSStorageAPI_LockFile,
-        FSStorageAPI_UnlockFile);
+        FSStorageAPI_UnlockFile,
+        FSStorageAPI_MapFile,
+        FSStorageAPI_UnmapFile,
+        FSStorageAPI_AdviseSequentialRead);
     *out_storage_api = api;
     return 0;
 }
@@ -14,6 +14,18 @@ struct BlockHashToBlockState
     uint32_t value;
 };
 
+struct BlockHashToCompleteCallbacks
+{
+    uint64_t key;
+    struct Longtail_AsyncGetStoredBlockAPI** value;
+};
+
+struct SegmentIdToMerged
+{
+    uint64_t key;
+    uint32_t value;
+};
+
 #define TMP_EXTENSION_LENGTH (1 + 16)
 
 struct FSBlockStoreAPI
@@ -29,14 +41,37 @@ struct FSBlockStoreAPI
 
     struct Longtail_ContentIndex* m_ContentIndex;
     struct BlockHashToBlockState* m_BlockState;
+    struct BlockHashToCompleteCallbacks* m_BlockHashToCompleteCallbacks;
     struct Longtail_BlockIndex** m_AddedBlockIndexes;
     const char* m_BlockExtension;
     const char* m_ContentIndexLockPath;
     uint32_t m_DefaultMaxBlockSize;
     uint32_t m_DefaultMaxChunksPerBlock;
+    int m_SortedStoreIndex;
+    int m_SegmentedStoreIndex;
+    struct Longtail_ContentIndex* m_PendingStoreIndex;
+    struct SegmentIdToMerged* m_MergedSegments;
+    uint64_t m_StoreIndexSize;
+    int m_StoreIndexStale;
+    HLongtail_Thread m_CompactionThread;
+    TLongtail_Atomic32 m_CompactionRunning;
     char m_TmpExtension[TMP_EXTENSION_LENGTH + 1];
 };
 
+// With segmented_store_index the store index is log structured. store.lci is the base segment and each
+// flush that adds blocks writes an immutable delta segment with just those blocks to INDEX_SEGMENTS_FOLDER
+// instead of rewriting the base. Readers merge the deltas into the base when they read the index and once
+// there are MAX_INDEX_SEGMENT_COUNT deltas they are compacted into the base on a background thread.
+// Clients that only read store.lci do not see the blocks in the deltas until they are compacted so it is
+// opt-in, by default each flush merges the deltas and the new blocks into a complete store.lci.
+//
+// m_PendingStoreIndex holds the blocks flushed since m_ContentIndex was last updated, m_MergedSegments the
+// ids of the segments whose blocks are in either of them and m_StoreIndexSize the size of the store.lci
+// they were read on top of. A flush only reads the segments it has not seen and if store.lci has changed
+// under us m_StoreIndexStale makes the next index read reload the whole index.
+#define INDEX_SEGMENTS_FOLDER "store_segments"
+#define MAX_INDEX_SEGMENT_COUNT 16
+
 #define BLOCK_NAME_LENGTH   23
 
 static const char* HashLUT = "0123456789abcdef";
@@ -63,6 +98,28 @@ static void GetUniqueExtension(uint64_t id, char* extension)
     extension[17] = 0;
 }
 
+// Segment names are the segment id as 16 hex digits followed by .lci
+static int ParseSegmentId(const char* segment_name, uint64_t* out_segment_id)
+{
+    uint64_t segment_id = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        char c = segment_name[i];
+        const char* lut_entry = c ? strchr(HashLUT, c) : 0;
+        if (lut_entry == 0)
+        {
+            return 0;
+        }
+        segment_id = (segment_id << 4) | (uint64_t)(lut_entry - HashLUT);
+    }
+    if (strcmp(&segment_name[16], ".lci") != 0)
+    {
+        return 0;
+    }
+    *out_segment_id = segment_id;
+    return 1;
+}
+
 static void GetBlockName(TLongtail_Hash block_hash, char* out_name)
 {
     LONGTAIL_FATAL_ASSERT(out_name, return)
@@ -113,7 +170,7 @@ static char* GetTempBlockPath(struct Longtail_StorageAPI* storage_api, const cha
     return storage_api->ConcatPath(storage_api, content_path, file_name);
 }
 
-static int SafeWriteContentIndex(struct FSBlockStoreAPI* api)
+static int WriteContentIndexFile(struct FSBlockStoreAPI* api, struct Longtail_ContentIndex* content_index)
 {
     struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
     const char* content_path = api->m_ContentPath;
@@ -125,54 +182,38 @@ static int SafeWriteContentIndex(struct FSBlockStoreAPI* api)
     int err = EnsureParentPathExists(storage_api, content_index_path_tmp);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) EnsureParentPathExists() failed with %d",
-            api,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexFile(%p, %p) EnsureParentPathExists() failed with %d",
+            api, content_index,
             err)
         Longtail_Free((char*)content_index_path_tmp);
         return err;
     }
 
-    const char* content_index_path = storage_api->ConcatPath(storage_api, content_path, "store.lci");
-
-    struct Longtail_ContentIndex* content_index = api->m_ContentIndex;
-    if (storage_api->IsFile(storage_api, content_index_path))
+    // The sorted chunk columns lets readers that map the base index look up chunks without building a hash table,
+    // but it is a 1.1.0 content index which older clients can not read so it is opt-in. Merged indexes keep the
+    // sorted columns of their inputs so they are added or stripped here to match the option
+    struct Longtail_ContentIndex* sorted_content_index = 0;
+    if ((api->m_SortedStoreIndex != 0) != (content_index->m_SortedChunkHashes != 0))
     {
-        struct Longtail_ContentIndex* existing_content_index = 0;
-        err = Longtail_ReadContentIndex(storage_api, content_index_path, &existing_content_index);
-        if (err)
-        {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) Longtail_ReadContentIndex() failed with %d",
-                api,
-                err)
-            Longtail_Free((void*)content_index_path);
-            Longtail_Free((void*)content_index_path_tmp);
-            return err;
-        }
-        struct Longtail_ContentIndex* merged_content_index = 0;
-        err = Longtail_MergeContentIndex(
-            api->m_JobAPI,
-            existing_content_index,
-            content_index,
-            &merged_content_index);
+        err = Longtail_CopyContentIndex(content_index, api->m_SortedStoreIndex, &sorted_content_index);
         if (err)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) Longtail_MergeContentIndex() failed with %d",
-                api,
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexFile(%p, %p) Longtail_CopyContentIndex() failed with %d",
+                api, content_index,
                 err)
-            Longtail_Free(existing_content_index);
-            Longtail_Free((void*)content_index_path);
-            Longtail_Free((void*)content_index_path_tmp);
+            Longtail_Free((char*)content_index_path_tmp);
             return err;
         }
-        Longtail_Free(existing_content_index);
-        content_index = merged_content_index;
     }
 
-    err = Longtail_WriteContentIndex(storage_api, content_index, content_index_path_tmp);
+    const char* content_index_path = storage_api->ConcatPath(storage_api, content_path, "store.lci");
+
+    err = Longtail_WriteContentIndex(storage_api, sorted_content_index ? sorted_content_index : content_index, content_index_path_tmp);
+    Longtail_Free(sorted_content_index);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) Longtail_WriteContentIndex() failed with %d",
-            api,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexFile(%p, %p) Longtail_WriteContentIndex() failed with %d",
+            api, content_index,
             err)
         Longtail_Free((void*)content_index_path);
         Longtail_Free((void*)content_index_path_tmp);
@@ -184,8 +225,8 @@ static int SafeWriteContentIndex(struct FSBlockStoreAPI* api)
         err = storage_api->RemoveFile(storage_api, content_index_path);
         if (err)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) RemoveFile() failed with %d",
-                api,
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexFile(%p, %p) RemoveFile() failed with %d",
+                api, content_index,
                 err)
             Longtail_Free((void*)content_index_path);
             storage_api->RemoveFile(storage_api, content_index_path_tmp);
@@ -197,24 +238,67 @@ static int SafeWriteContentIndex(struct FSBlockStoreAPI* api)
     err = storage_api->RenameFile(storage_api, content_index_path_tmp, content_index_path);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SafeWriteContentIndex(%p) RenameFile() failed with %d",
-            api,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexFile(%p, %p) RenameFile() failed with %d",
+            api, content_index,
             err)
         storage_api->RemoveFile(storage_api, content_index_path_tmp);
     }
 
+    Longtail_Free((void*)content_index_path);
+    Longtail_Free((void*)content_index_path_tmp);
+
+    return err;
+}
+
+// Segments are named from the blocks they hold so writing the same blocks twice gives the same segment
+static int WriteContentIndexSegment(struct FSBlockStoreAPI* api, struct Longtail_ContentIndex* added_content_index, uint64_t* out_segment_id)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+
+    uint64_t segment_id = 0;
+    uint64_t block_count = *added_content_index->m_BlockCount;
+    for (uint64_t b = 0; b < block_count; ++b)
+    {
+        segment_id ^= added_content_index->m_BlockHashes[b];
+    }
+    *out_segment_id = segment_id;
+    char segment_id_string[TMP_EXTENSION_LENGTH + 1];
+    GetUniqueExtension(segment_id, segment_id_string);
+
+    // sizeof(INDEX_SEGMENTS_FOLDER) covers the separator and the segment id fits in TMP_EXTENSION_LENGTH
+    char segment_name[sizeof(INDEX_SEGMENTS_FOLDER) + TMP_EXTENSION_LENGTH + 4 + 1];
+    snprintf(segment_name, sizeof(segment_name), INDEX_SEGMENTS_FOLDER "/%s.lci", &segment_id_string[1]);
+    char tmp_segment_name[sizeof(INDEX_SEGMENTS_FOLDER) + TMP_EXTENSION_LENGTH + TMP_EXTENSION_LENGTH + 1];
+    snprintf(tmp_segment_name, sizeof(tmp_segment_name), INDEX_SEGMENTS_FOLDER "/%s%s", &segment_id_string[1], api->m_TmpExtension);
+
+    const char* segment_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, segment_name);
+    if (storage_api->IsFile(storage_api, segment_path))
+    {
+        Longtail_Free((void*)segment_path);
+        return 0;
+    }
+    const char* tmp_segment_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, tmp_segment_name);
+    int err = EnsureParentPathExists(storage_api, tmp_segment_path);
     if (!err)
     {
-        if (api->m_ContentIndex != content_index)
+        err = Longtail_WriteContentIndex(storage_api, added_content_index, tmp_segment_path);
+    }
+    if (!err)
+    {
+        err = storage_api->RenameFile(storage_api, tmp_segment_path, segment_path);
+        if (err)
         {
-            Longtail_Free(api->m_ContentIndex);
-            api->m_ContentIndex = content_index;
+            storage_api->RemoveFile(storage_api, tmp_segment_path);
         }
     }
-
-    Longtail_Free((void*)content_index_path);
-    Longtail_Free((void*)content_index_path_tmp);
-
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentIndexSegment(%p, %p, %p) failed with %d",
+            api, added_content_index, out_segment_id,
+            err)
+    }
+    Longtail_Free((void*)tmp_segment_path);
+    Longtail_Free((void*)segment_path);
     return err;
 }
 
@@ -243,6 +327,7 @@ static int SafeWriteStoredBlock(struct FSBlockStoreAPI* api, struct Longtail_Sto
         return err;
     }
 
+    uint64_t write_start_time = Longtail_GetMetricTime();
     err = Longtail_WriteStoredBlock(storage_api, stored_block, tmp_block_path);
     if (err)
     {
@@ -253,6 +338,7 @@ static int SafeWriteStoredBlock(struct FSBlockStoreAPI* api, struct Longtail_Sto
         Longtail_Free((char*)block_path);
         return err;
     }
+    Longtail_ObserveMetricTime(Longtail_Metric_FSBlockStore_WriteTime, write_start_time);
 
     err = storage_api->RenameFile(storage_api, tmp_block_path, block_path);
     if (err)
@@ -501,7 +587,7 @@ static int ReadContent(
         Longtail_JobAPI_JobFunc job_func[] = {ScanBlock};
         void* ctx[] = {job};
         Longtail_JobAPI_Jobs jobs;
-        err = job_api->CreateJobs(job_api, job_group, 1, job_func, ctx, &jobs);
+        err = job_api->CreateJobs(job_api, job_group, 1, job_func, ctx, LONGTAIL_JOB_CLASS_IO, &jobs);
         LONGTAIL_FATAL_ASSERT(!err, return err)
         err = job_api->ReadyJobs(job_api, 1, jobs);
         LONGTAIL_FATAL_ASSERT(!err, return err)
@@ -572,6 +658,53 @@ static int ReadContent(
     return err;
 }
 
+static int FSBlockStore_ReadStoredBlock(
+    struct FSBlockStoreAPI* fsblockstore_api,
+    uint64_t block_hash,
+    struct Longtail_AsyncGetStoredBlockAPI* async_complete_api)
+{
+    char* block_path = GetBlockPath(fsblockstore_api->m_StorageAPI, fsblockstore_api->m_ContentPath, fsblockstore_api->m_BlockExtension, block_hash);
+
+    struct Longtail_StoredBlock* stored_block;
+    uint64_t read_start_time = Longtail_GetMetricTime();
+    int err = Longtail_ReadStoredBlock(fsblockstore_api->m_StorageAPI, block_path, &stored_block);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_WARNING, "FSBlockStore_ReadStoredBlock(%p, 0x%" PRIx64 ", %p) failed with %d",
+            fsblockstore_api, block_hash, async_complete_api,
+            err)
+        Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_FailCount], 1);
+        Longtail_Free((char*)block_path);
+        return err;
+    }
+    Longtail_ObserveMetricTime(Longtail_Metric_FSBlockStore_ReadTime, read_start_time);
+    Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *stored_block->m_BlockIndex->m_ChunkCount);
+    Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*stored_block->m_BlockIndex->m_ChunkCount) + stored_block->m_BlockChunksDataSize);
+
+    Longtail_Free(block_path);
+
+    async_complete_api->OnComplete(async_complete_api, stored_block, 0);
+    return 0;
+}
+
+static void FSBlockStore_CompleteWaitingGets(
+    struct FSBlockStoreAPI* fsblockstore_api,
+    uint64_t block_hash,
+    struct Longtail_AsyncGetStoredBlockAPI** wait_list,
+    int err)
+{
+    size_t wait_count = arrlen(wait_list);
+    for (size_t i = 0; i < wait_count; ++i)
+    {
+        int get_err = err ? err : FSBlockStore_ReadStoredBlock(fsblockstore_api, block_hash, wait_list[i]);
+        if (get_err)
+        {
+            wait_list[i]->OnComplete(wait_list[i], 0, get_err);
+        }
+    }
+    arrfree(wait_list);
+}
+
 static int FSBlockStore_PutStoredBlock(
     struct Longtail_BlockStoreAPI* block_store_api,
     struct Longtail_StoredBlock* stored_block,
@@ -603,6 +736,7 @@ static int FSBlockStore_PutStoredBlock(
     hmput(fsblockstore_api->m_BlockState, block_hash, 0);
     Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
 
+    struct Longtail_AsyncGetStoredBlockAPI** wait_list;
     int err = SafeWriteStoredBlock(fsblockstore_api, fsblockstore_api->m_StorageAPI, fsblockstore_api->m_ContentPath, fsblockstore_api->m_BlockExtension, stored_block);
     if (err)
     {
@@ -612,42 +746,46 @@ static int FSBlockStore_PutStoredBlock(
         Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_FailCount], 1);
         Longtail_LockSpinLock(fsblockstore_api->m_Lock);
         hmdel(fsblockstore_api->m_BlockState, block_hash);
+        wait_list = hmget(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash);
+        hmdel(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash);
         Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
+        // Anybody waiting for the put to finish is told the block does not exist
+        FSBlockStore_CompleteWaitingGets(fsblockstore_api, block_hash, wait_list, ENOENT);
         async_complete_api->OnComplete(async_complete_api, err);
         return 0;
     }
 
+    struct Longtail_BlockIndex* block_index_copy = 0;
     void* block_index_buffer;
     size_t block_index_buffer_size;
     err = Longtail_WriteBlockIndexToBuffer(stored_block->m_BlockIndex, &block_index_buffer, &block_index_buffer_size);
-    if (err)
+    if (!err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_PutStoredBlock(%p, %p, %p) failed with %d",
-            block_store_api, stored_block, async_complete_api,
-            err)
-        Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_FailCount], 1);
-        async_complete_api->OnComplete(async_complete_api, err);
-        return 0;
+        err = Longtail_ReadBlockIndexFromBuffer(block_index_buffer, block_index_buffer_size, &block_index_copy);
+        Longtail_Free(block_index_buffer);
     }
-    struct Longtail_BlockIndex* block_index_copy;
-    err = Longtail_ReadBlockIndexFromBuffer(block_index_buffer, block_index_buffer_size, &block_index_copy);
-    Longtail_Free(block_index_buffer);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_PutStoredBlock(%p, %p, %p) failed with %d",
             block_store_api, stored_block, async_complete_api,
             err)
         Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_FailCount], 1);
-        async_complete_api->OnComplete(async_complete_api, err);
-        return 0;
     }
 
+    // The block is on disk even if we failed to record it in the content index, let any waiting gets read it
     Longtail_LockSpinLock(fsblockstore_api->m_Lock);
     hmput(fsblockstore_api->m_BlockState, block_hash, 1);
-    arrput(fsblockstore_api->m_AddedBlockIndexes, block_index_copy);
+    if (block_index_copy)
+    {
+        arrput(fsblockstore_api->m_AddedBlockIndexes, block_index_copy);
+    }
+    wait_list = hmget(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash);
+    hmdel(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash);
     Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
 
-    async_complete_api->OnComplete(async_complete_api, 0);
+    FSBlockStore_CompleteWaitingGets(fsblockstore_api, block_hash, wait_list, 0);
+
+    async_complete_api->OnComplete(async_complete_api, err);
     return 0;
 }
 
@@ -667,7 +805,7 @@ static int FSBlockStore_GetStoredBlock(
     uint64_t block_hash,
     struct Longtail_AsyncGetStoredBlockAPI* async_complete_api)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FSBlockStore_GetStoredBlock(%p, 0x" PRIx64 ", %p)",
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FSBlockStore_GetStoredBlock(%p, 0x%" PRIx64 ", %p)",
         block_store_api, block_hash, async_complete_api)
     LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(async_complete_api, return EINVAL)
@@ -677,56 +815,611 @@ static int FSBlockStore_GetStoredBlock(
 
     Longtail_LockSpinLock(fsblockstore_api->m_Lock);
     intptr_t block_ptr = hmgeti(fsblockstore_api->m_BlockState, block_hash);
-    if (block_ptr == -1)
+    if (block_ptr != -1 && fsblockstore_api->m_BlockState[block_ptr].value == 0)
     {
-        char* block_path = GetBlockPath(fsblockstore_api->m_StorageAPI, fsblockstore_api->m_ContentPath, fsblockstore_api->m_BlockExtension, block_hash);
-        if (!fsblockstore_api->m_StorageAPI->IsFile(fsblockstore_api->m_StorageAPI, block_path))
+        // A put of the block is in progress, it will complete the request once the block is written
+        intptr_t find_wait_list_ptr = hmgeti(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash);
+        if (find_wait_list_ptr != -1)
         {
-            Longtail_Free((void*)block_path);
-            Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
-            return ENOENT;
+            arrput(fsblockstore_api->m_BlockHashToCompleteCallbacks[find_wait_list_ptr].value, async_complete_api);
         }
-        Longtail_Free((void*)block_path);
-        hmput(fsblockstore_api->m_BlockState, block_hash, 1);
-        block_ptr = hmgeti(fsblockstore_api->m_BlockState, block_hash);
+        else
+        {
+            struct Longtail_AsyncGetStoredBlockAPI** wait_list = 0;
+            arrput(wait_list, async_complete_api);
+            hmput(fsblockstore_api->m_BlockHashToCompleteCallbacks, block_hash, wait_list);
+        }
+        Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
+        return 0;
     }
-    uint32_t state = fsblockstore_api->m_BlockState[block_ptr].value;
     Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
-    while (state == 0)
+
+    if (block_ptr == -1)
     {
-        Longtail_Sleep(1000);
+        char* block_path = GetBlockPath(fsblockstore_api->m_StorageAPI, fsblockstore_api->m_ContentPath, fsblockstore_api->m_BlockExtension, block_hash);
+        int is_file = fsblockstore_api->m_StorageAPI->IsFile(fsblockstore_api->m_StorageAPI, block_path);
+        Longtail_Free((void*)block_path);
+        if (!is_file)
+        {
+            return ENOENT;
+        }
         Longtail_LockSpinLock(fsblockstore_api->m_Lock);
-        state = hmget(fsblockstore_api->m_BlockState, block_hash);
+        if (hmgeti(fsblockstore_api->m_BlockState, block_hash) == -1)
+        {
+            hmput(fsblockstore_api->m_BlockState, block_hash, 1);
+        }
         Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
     }
-    char* block_path = GetBlockPath(fsblockstore_api->m_StorageAPI, fsblockstore_api->m_ContentPath, fsblockstore_api->m_BlockExtension, block_hash);
 
-    struct Longtail_StoredBlock* stored_block;
-    int err = Longtail_ReadStoredBlock(fsblockstore_api->m_StorageAPI, block_path, &stored_block);
+    int err = FSBlockStore_ReadStoredBlock(fsblockstore_api, block_hash, async_complete_api);
     if (err)
     {
-        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_WARNING, "FSBlockStore_GetStoredBlock(%p, 0x" PRIx64 ", %p) failed with %d",
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_WARNING, "FSBlockStore_GetStoredBlock(%p, 0x%" PRIx64 ", %p) failed with %d",
             block_store_api, block_hash, async_complete_api,
             err)
-        Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_FailCount], 1);
-        Longtail_Free((char*)block_path);
         return err;
     }
-    Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *stored_block->m_BlockIndex->m_ChunkCount);
-    Longtail_AtomicAdd64(&fsblockstore_api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*stored_block->m_BlockIndex->m_ChunkCount) + stored_block->m_BlockChunksDataSize);
+    return 0;
+}
 
-    Longtail_Free(block_path);
+static void FreeIndexSegmentNames(char** segment_names)
+{
+    for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+    {
+        Longtail_Free(segment_names[i]);
+    }
+    arrfree(segment_names);
+}
 
-    async_complete_api->OnComplete(async_complete_api, stored_block, 0);
+static int GetIndexSegmentNames(struct Longtail_StorageAPI* storage_api, const char* content_path, char*** out_segment_names)
+{
+    const char* segments_path = storage_api->ConcatPath(storage_api, content_path, INDEX_SEGMENTS_FOLDER);
+    char** segment_names = 0;
+    Longtail_StorageAPI_HIterator iterator = 0;
+    int err = storage_api->StartFind(storage_api, segments_path, &iterator);
+    if (err == ENOENT)
+    {
+        Longtail_Free((void*)segments_path);
+        *out_segment_names = 0;
+        return 0;
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "GetIndexSegmentNames(%p, %s, %p) failed with %d",
+            storage_api, content_path, out_segment_names,
+            err)
+        Longtail_Free((void*)segments_path);
+        return err;
+    }
+    while (err == 0)
+    {
+        struct Longtail_StorageAPI_EntryProperties properties;
+        err = storage_api->GetEntryProperties(storage_api, iterator, &properties);
+        if (err)
+        {
+            break;
+        }
+        if (!properties.m_IsDir && EndsWith(properties.m_Name, ".lci"))
+        {
+            arrput(segment_names, Longtail_Strdup(properties.m_Name));
+        }
+        err = storage_api->FindNext(storage_api, iterator);
+    }
+    storage_api->CloseFind(storage_api, iterator);
+    Longtail_Free((void*)segments_path);
+    if (err != ENOENT)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "GetIndexSegmentNames(%p, %s, %p) failed with %d",
+            storage_api, content_path, out_segment_names,
+            err)
+        FreeIndexSegmentNames(segment_names);
+        return err;
+    }
+    *out_segment_names = segment_names;
+    return 0;
+}
+
+// Reads the delta segments and merges them into one index, the deltas are small so merging them
+// with each other first means the full index is only merged once
+static int ReadIndexSegments(
+    struct FSBlockStoreAPI* api,
+    char** segment_names,
+    struct Longtail_ContentIndex** out_delta_content_index)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    const char* segments_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, INDEX_SEGMENTS_FOLDER);
+    struct Longtail_ContentIndex* delta_content_index = 0;
+    int err = 0;
+    for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+    {
+        const char* segment_path = storage_api->ConcatPath(storage_api, segments_path, segment_names[i]);
+        struct Longtail_ContentIndex* segment_content_index = 0;
+        err = Longtail_ReadContentIndex(storage_api, segment_path, &segment_content_index);
+        Longtail_Free((void*)segment_path);
+        if (err)
+        {
+            break;
+        }
+        if (delta_content_index == 0)
+        {
+            delta_content_index = segment_content_index;
+            continue;
+        }
+        struct Longtail_ContentIndex* merged_content_index = 0;
+        err = Longtail_MergeContentIndex(api->m_JobAPI, delta_content_index, segment_content_index, &merged_content_index);
+        Longtail_Free(segment_content_index);
+        if (err)
+        {
+            break;
+        }
+        Longtail_Free(delta_content_index);
+        delta_content_index = merged_content_index;
+    }
+    Longtail_Free((void*)segments_path);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ReadIndexSegments(%p, %p, %p) failed with %d",
+            api, segment_names, out_delta_content_index,
+            err)
+        Longtail_Free(delta_content_index);
+        return err;
+    }
+    *out_delta_content_index = delta_content_index;
     return 0;
 }
 
-int FSBlockStore_GetContentIndexFromStorage(
+static void RemoveIndexSegments(struct FSBlockStoreAPI* api, char** segment_names)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    const char* segments_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, INDEX_SEGMENTS_FOLDER);
+    for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+    {
+        const char* segment_path = storage_api->ConcatPath(storage_api, segments_path, segment_names[i]);
+        int remove_err = storage_api->RemoveFile(storage_api, segment_path);
+        if (remove_err)
+        {
+            // Harmless, the blocks in it are already in the base segment
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "RemoveIndexSegments(%p, %p) failed to remove `%s`, %d",
+                api, segment_names, segment_path, remove_err)
+        }
+        Longtail_Free((void*)segment_path);
+    }
+    Longtail_Free((void*)segments_path);
+}
+
+static int GetStoreIndexSize(struct Longtail_StorageAPI* storage_api, const char* content_index_path, uint64_t* out_size)
+{
+    Longtail_StorageAPI_HOpenFile content_index_file;
+    int err = storage_api->OpenReadFile(storage_api, content_index_path, &content_index_file);
+    if (err)
+    {
+        return err;
+    }
+    err = storage_api->GetSize(storage_api, content_index_file, out_size);
+    storage_api->CloseFile(storage_api, content_index_file);
+    return err;
+}
+
+// Must be called with m_Lock held
+static void SetStoredBlockStates(
+    struct FSBlockStoreAPI* api,
+    const struct Longtail_ContentIndex* content_index)
+{
+    uint64_t block_count = *content_index->m_BlockCount;
+    for (uint64_t b = 0; b < block_count; ++b)
+    {
+        uint64_t block_hash = content_index->m_BlockHashes[b];
+        if (hmgeti(api->m_BlockState, block_hash) == -1)
+        {
+            hmput(api->m_BlockState, block_hash, 1);
+        }
+    }
+}
+
+// Must be called with m_Lock held
+static void SetMergedSegments(
+    struct FSBlockStoreAPI* api,
+    char** segment_names)
+{
+    hmfree(api->m_MergedSegments);
+    api->m_MergedSegments = 0;
+    for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+    {
+        uint64_t segment_id;
+        if (ParseSegmentId(segment_names[i], &segment_id))
+        {
+            hmput(api->m_MergedSegments, segment_id, 1);
+        }
+    }
+}
+
+// Takes ownership of content_index. Must be called with m_Lock held
+static int AddPendingStoreIndex(
+    struct FSBlockStoreAPI* api,
+    struct Longtail_ContentIndex* content_index)
+{
+    if (api->m_PendingStoreIndex == 0)
+    {
+        api->m_PendingStoreIndex = content_index;
+        return 0;
+    }
+    struct Longtail_ContentIndex* merged_content_index = 0;
+    int err = Longtail_MergeContentIndex(api->m_JobAPI, api->m_PendingStoreIndex, content_index, &merged_content_index);
+    Longtail_Free(content_index);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "AddPendingStoreIndex(%p, %p) failed with %d",
+            api, content_index,
+            err)
+        return err;
+    }
+    Longtail_Free(api->m_PendingStoreIndex);
+    api->m_PendingStoreIndex = merged_content_index;
+    return 0;
+}
+
+// Merges the blocks flushed since the last call into m_ContentIndex. Must be called with m_Lock held
+static int FoldPendingStoreIndex(struct FSBlockStoreAPI* api)
+{
+    if (api->m_PendingStoreIndex == 0)
+    {
+        return 0;
+    }
+    if (api->m_ContentIndex == 0)
+    {
+        // The whole index is read from the store when it is first needed
+        Longtail_Free(api->m_PendingStoreIndex);
+        api->m_PendingStoreIndex = 0;
+        return 0;
+    }
+    struct Longtail_ContentIndex* merged_content_index = 0;
+    int err = Longtail_MergeContentIndex(api->m_JobAPI, api->m_ContentIndex, api->m_PendingStoreIndex, &merged_content_index);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FoldPendingStoreIndex(%p) failed with %d",
+            api,
+            err)
+        return err;
+    }
+    Longtail_Free(api->m_ContentIndex);
+    api->m_ContentIndex = merged_content_index;
+    Longtail_Free(api->m_PendingStoreIndex);
+    api->m_PendingStoreIndex = 0;
+    return 0;
+}
+
+// Reads store.lci merged with the delta segments, must be called with the store lock held.
+// store.lci is mapped rather than read and the mapping is released before returning so it never
+// outlives the lock. out_content_index is set to zero if there is no store.lci
+static int ReadStoreIndex(
+    struct FSBlockStoreAPI* api,
+    const char* content_index_path,
+    struct Longtail_ContentIndex** out_content_index,
+    char*** out_segment_names,
+    uint64_t* out_store_index_size)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    *out_content_index = 0;
+    *out_segment_names = 0;
+    *out_store_index_size = 0;
+    if (!storage_api->IsFile(storage_api, content_index_path))
+    {
+        return 0;
+    }
+    struct Longtail_ContentIndex* mapped_content_index = 0;
+    struct Longtail_ContentIndex* delta_content_index = 0;
+    struct Longtail_ContentIndex* content_index = 0;
+    char** segment_names = 0;
+    uint64_t store_index_size = 0;
+    int err = GetStoreIndexSize(storage_api, content_index_path, &store_index_size);
+    if (!err)
+    {
+        err = Longtail_MapContentIndex(storage_api, content_index_path, &mapped_content_index);
+    }
+    if (!err)
+    {
+        err = GetIndexSegmentNames(storage_api, api->m_ContentPath, &segment_names);
+    }
+    if (!err)
+    {
+        err = ReadIndexSegments(api, segment_names, &delta_content_index);
+    }
+    if (!err)
+    {
+        if (delta_content_index)
+        {
+            err = Longtail_MergeContentIndex(api->m_JobAPI, mapped_content_index, delta_content_index, &content_index);
+        }
+        else
+        {
+            err = Longtail_CopyContentIndex(mapped_content_index, mapped_content_index->m_SortedChunkHashes != 0, &content_index);
+        }
+    }
+    Longtail_Free(delta_content_index);
+    if (mapped_content_index)
+    {
+        Longtail_UnmapContentIndex(mapped_content_index);
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ReadStoreIndex(%p, %s, %p, %p, %p) failed with %d",
+            api, content_index_path, out_content_index, out_segment_names, out_store_index_size,
+            err)
+        FreeIndexSegmentNames(segment_names);
+        return err;
+    }
+    *out_content_index = content_index;
+    *out_segment_names = segment_names;
+    *out_store_index_size = store_index_size;
+    return 0;
+}
+
+// Merges store.lci and the delta segments with the in-memory index and writes it as a complete store.lci
+// so clients that only read store.lci see every block. Must be called with m_Lock and the store lock held
+static int RewriteStoreIndex(
+    struct FSBlockStoreAPI* api,
+    const char* content_index_path)
+{
+    struct Longtail_ContentIndex* store_content_index = 0;
+    char** segment_names = 0;
+    uint64_t store_index_size = 0;
+    int err = ReadStoreIndex(api, content_index_path, &store_content_index, &segment_names, &store_index_size);
+    struct Longtail_ContentIndex* merged_content_index = 0;
+    if (!err && store_content_index)
+    {
+        err = Longtail_MergeContentIndex(api->m_JobAPI, store_content_index, api->m_ContentIndex, &merged_content_index);
+    }
+    if (!err)
+    {
+        err = WriteContentIndexFile(api, merged_content_index ? merged_content_index : api->m_ContentIndex);
+    }
+    if (!err)
+    {
+        RemoveIndexSegments(api, segment_names);
+        if (store_content_index)
+        {
+            SetStoredBlockStates(api, store_content_index);
+        }
+        if (merged_content_index)
+        {
+            Longtail_Free(api->m_ContentIndex);
+            api->m_ContentIndex = merged_content_index;
+            merged_content_index = 0;
+        }
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "RewriteStoreIndex(%p, %s) failed with %d",
+            api, content_index_path,
+            err)
+    }
+    Longtail_Free(merged_content_index);
+    Longtail_Free(store_content_index);
+    FreeIndexSegmentNames(segment_names);
+    return err;
+}
+
+// Picks up the blocks other processes have flushed to the store by reading only the segments in
+// segment_names that are not merged yet. If store.lci has changed it may hold segments we never saw
+// so the next index read reloads the whole index instead. Must be called with m_Lock and the store lock held
+static int ReadNewIndexSegments(
+    struct FSBlockStoreAPI* api,
+    const char* content_index_path,
+    char** segment_names)
+{
+    if (api->m_ContentIndex == 0 || api->m_StoreIndexStale)
+    {
+        return 0;
+    }
+    uint64_t store_index_size = 0;
+    int err = GetStoreIndexSize(api->m_StorageAPI, content_index_path, &store_index_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ReadNewIndexSegments(%p, %s, %p) failed with %d",
+            api, content_index_path, segment_names,
+            err)
+        return err;
+    }
+    if (store_index_size != api->m_StoreIndexSize)
+    {
+        api->m_StoreIndexStale = 1;
+        return 0;
+    }
+    char** new_segment_names = 0;
+    for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+    {
+        uint64_t segment_id;
+        if (!ParseSegmentId(segment_names[i], &segment_id) || hmgeti(api->m_MergedSegments, segment_id) == -1)
+        {
+            arrput(new_segment_names, segment_names[i]);
+        }
+    }
+    if (arrlen(new_segment_names) == 0)
+    {
+        arrfree(new_segment_names);
+        return 0;
+    }
+    struct Longtail_ContentIndex* delta_content_index = 0;
+    err = ReadIndexSegments(api, new_segment_names, &delta_content_index);
+    if (!err)
+    {
+        SetStoredBlockStates(api, delta_content_index);
+        err = AddPendingStoreIndex(api, delta_content_index);
+    }
+    for (ptrdiff_t i = 0; !err && i < arrlen(new_segment_names); ++i)
+    {
+        uint64_t segment_id;
+        if (ParseSegmentId(new_segment_names[i], &segment_id))
+        {
+            hmput(api->m_MergedSegments, segment_id, 1);
+        }
+    }
+    arrfree(new_segment_names);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ReadNewIndexSegments(%p, %s, %p) failed with %d",
+            api, content_index_path, segment_names,
+            err)
+    }
+    return err;
+}
+
+// The segments are read under the store lock but merged without holding it. If any of the segments
+// are gone when the lock is taken again someone else compacted them and the result is dropped.
+static int CompactIndexSegments(struct FSBlockStoreAPI* api)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+
+    Longtail_StorageAPI_HLockFile content_index_lock_file;
+    int err = storage_api->LockFile(storage_api, api->m_ContentIndexLockPath, &content_index_lock_file);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompactIndexSegments(%p) failed with %d",
+            api,
+            err)
+        return err;
+    }
+    const char* content_index_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, "store.lci");
+    struct Longtail_ContentIndex* content_index = 0;
+    char** segment_names = 0;
+    uint64_t store_index_size = 0;
+    err = ReadStoreIndex(api, content_index_path, &content_index, &segment_names, &store_index_size);
+    storage_api->UnlockFile(storage_api, content_index_lock_file);
+
+    if (err || content_index == 0 || arrlen(segment_names) == 0)
+    {
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompactIndexSegments(%p) failed with %d",
+                api,
+                err)
+        }
+        Longtail_Free((void*)content_index_path);
+        Longtail_Free(content_index);
+        FreeIndexSegmentNames(segment_names);
+        return err;
+    }
+
+    err = storage_api->LockFile(storage_api, api->m_ContentIndexLockPath, &content_index_lock_file);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CompactIndexSegments(%p) failed with %d",
+            api,
+            err)
+        Longtail_Free((void*)content_index_path);
+        Longtail_Free(content_index);
+        FreeIndexSegmentNames(segment_names);
+        return err;
+    }
+    const char* segments_path = storage_api->ConcatPath(storage_api, api->m_ContentPath, INDEX_SEGMENTS_FOLDER);
+    int segments_intact = 1;
+    for (ptrdiff_t i = 0; segments_intact && i < arrlen(segment_names); ++i)
+    {
+        const char* segment_path = storage_api->ConcatPath(storage_api, segments_path, segment_names[i]);
+        segments_intact = storage_api->IsFile(storage_api, segment_path);
+        Longtail_Free((void*)segment_path);
+    }
+    Longtail_Free((void*)segments_path);
+    uint64_t compacted_store_index_size = 0;
+    if (segments_intact)
+    {
+        err = WriteContentIndexFile(api, content_index);
+        if (!err)
+        {
+            RemoveIndexSegments(api, segment_names);
+            err = GetStoreIndexSize(storage_api, content_index_path, &compacted_store_index_size);
+        }
+    }
+    storage_api->UnlockFile(storage_api, content_index_lock_file);
+    if (segments_intact)
+    {
+        // If we had already merged the base and every segment we compacted the in-memory index is still
+        // complete and only the recorded size changes, otherwise it is reloaded when it is next read
+        Longtail_LockSpinLock(api->m_Lock);
+        int merged_all = !err && !api->m_StoreIndexStale && api->m_StoreIndexSize == store_index_size;
+        for (ptrdiff_t i = 0; merged_all && i < arrlen(segment_names); ++i)
+        {
+            uint64_t segment_id;
+            merged_all = ParseSegmentId(segment_names[i], &segment_id) && hmgeti(api->m_MergedSegments, segment_id) != -1;
+        }
+        if (merged_all)
+        {
+            api->m_StoreIndexSize = compacted_store_index_size;
+            for (ptrdiff_t i = 0; i < arrlen(segment_names); ++i)
+            {
+                uint64_t segment_id;
+                ParseSegmentId(segment_names[i], &segment_id);
+                (void)hmdel(api->m_MergedSegments, segment_id);
+            }
+        }
+        else
+        {
+            api->m_StoreIndexStale = 1;
+        }
+        Longtail_UnlockSpinLock(api->m_Lock);
+    }
+    Longtail_Free((void*)content_index_path);
+    Longtail_Free(content_index);
+    FreeIndexSegmentNames(segment_names);
+    return err;
+}
+
+static int FSBlockStore_CompactionThread(void* context_data)
+{
+    struct FSBlockStoreAPI* api = (struct FSBlockStoreAPI*)context_data;
+    int err = CompactIndexSegments(api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to compact store index for `%s`, %d", api->m_ContentPath, err);
+    }
+    Longtail_AtomicAdd32(&api->m_CompactionRunning, -1);
+    return err;
+}
+
+static void FSBlockStore_JoinCompaction(struct FSBlockStoreAPI* api)
+{
+    if (api->m_CompactionThread == 0)
+    {
+        return;
+    }
+    Longtail_JoinThread(api->m_CompactionThread, LONGTAIL_TIMEOUT_INFINITE);
+    Longtail_DeleteThread(api->m_CompactionThread);
+    Longtail_Free(api->m_CompactionThread);
+    api->m_CompactionThread = 0;
+}
+
+static void FSBlockStore_StartCompaction(struct FSBlockStoreAPI* api)
+{
+    if (api->m_CompactionThread && api->m_CompactionRunning != 0)
+    {
+        return;
+    }
+    FSBlockStore_JoinCompaction(api);
+    void* thread_mem = Longtail_Alloc(Longtail_GetThreadSize());
+    if (!thread_mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to start store index compaction for `%s`, %d", api->m_ContentPath, ENOMEM);
+        return;
+    }
+    Longtail_AtomicAdd32(&api->m_CompactionRunning, 1);
+    int err = Longtail_CreateThread(thread_mem, FSBlockStore_CompactionThread, 0, api, 0, &api->m_CompactionThread);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to start store index compaction for `%s`, %d", api->m_ContentPath, err);
+        Longtail_AtomicAdd32(&api->m_CompactionRunning, -1);
+        Longtail_Free(thread_mem);
+        api->m_CompactionThread = 0;
+    }
+}
+
+static int FSBlockStore_GetContentIndexFromStorage(
     struct FSBlockStoreAPI* fsblockstore_api,
-    struct Longtail_ContentIndex** out_content_index)
+    struct Longtail_ContentIndex** out_content_index,
+    char*** out_segment_names,
+    uint64_t* out_store_index_size)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FSBlockStore_GetContentIndexFromStorage(%p, %p)",
-        fsblockstore_api, out_content_index)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FSBlockStore_GetContentIndexFromStorage(%p, %p, %p, %p)",
+        fsblockstore_api, out_content_index, out_segment_names, out_store_index_size)
     struct Longtail_StorageAPI* storage_api = fsblockstore_api->m_StorageAPI;
     struct Longtail_JobAPI* job_api = fsblockstore_api->m_JobAPI;
     const char* content_path = fsblockstore_api->m_ContentPath;
@@ -739,8 +1432,8 @@ int FSBlockStore_GetContentIndexFromStorage(
     int err = EnsureParentPathExists(storage_api, fsblockstore_api->m_ContentIndexLockPath);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p) failed with %d",
-            fsblockstore_api, out_content_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p, %p, %p) failed with %d",
+            fsblockstore_api, out_content_index, out_segment_names, out_store_index_size,
             err)
         return err;
     }
@@ -748,33 +1441,32 @@ int FSBlockStore_GetContentIndexFromStorage(
     err = storage_api->LockFile(storage_api, fsblockstore_api->m_ContentIndexLockPath, &content_index_lock_file);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p) failed with %d",
-            fsblockstore_api, out_content_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p, %p, %p) failed with %d",
+            fsblockstore_api, out_content_index, out_segment_names, out_store_index_size,
             err)
         return err;
     }
 
     const char* content_index_path = storage_api->ConcatPath(storage_api, content_path, "store.lci");
 
-    if (storage_api->IsFile(storage_api, content_index_path))
+    char** segment_names = 0;
+    uint64_t store_index_size = 0;
+    err = ReadStoreIndex(fsblockstore_api, content_index_path, &content_index, &segment_names, &store_index_size);
+    storage_api->UnlockFile(storage_api, content_index_lock_file);
+    Longtail_Free((void*)content_index_path);
+    if (err)
     {
-        int err = Longtail_ReadContentIndex(storage_api, content_index_path, &content_index);
-        if (err)
-        {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p) failed with %d",
-                fsblockstore_api, out_content_index,
-                err)
-            Longtail_Free((void*)content_index_path);
-            storage_api->UnlockFile(storage_api, content_index_lock_file);
-            return err;
-        }
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetContentIndexFromStorage(%p, %p, %p, %p) failed with %d",
+            fsblockstore_api, out_content_index, out_segment_names, out_store_index_size,
+            err)
+        return err;
     }
-    storage_api->UnlockFile(storage_api, content_index_lock_file);
 
-    Longtail_Free((void*)content_index_path);
     if (content_index)
     {
         *out_content_index = content_index;
+        *out_segment_names = segment_names;
+        *out_store_index_size = store_index_size;
         return 0;
     }
     err = ReadContent(
@@ -793,6 +1485,8 @@ int FSBlockStore_GetContentIndexFromStorage(
         return err;
     }
     *out_content_index = content_index;
+    *out_segment_names = 0;
+    *out_store_index_size = 0;
     return 0;
 }
 
@@ -804,56 +1498,70 @@ static int FSBlockStore_GetIndexSync(
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FSBlockStore_GetIndexSync(%p, %p)",
         fsblockstore_api, out_content_index)
     Longtail_LockSpinLock(fsblockstore_api->m_Lock);
-    if (!fsblockstore_api->m_ContentIndex)
+    int err = FoldPendingStoreIndex(fsblockstore_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetIndexSync(%p, %p) failed with %d",
+            fsblockstore_api, out_content_index,
+            err)
+        Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
+        return err;
+    }
+    if (!fsblockstore_api->m_ContentIndex || fsblockstore_api->m_StoreIndexStale)
     {
         struct Longtail_ContentIndex* content_index;
-        int err = FSBlockStore_GetContentIndexFromStorage(
+        char** segment_names;
+        uint64_t store_index_size;
+        err = FSBlockStore_GetContentIndexFromStorage(
             fsblockstore_api,
-            &content_index);
+            &content_index,
+            &segment_names,
+            &store_index_size);
         if (err)
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetIndexSync(%p, %p) failed with %d",
                 fsblockstore_api, out_content_index,
                 err)
+            Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
             return err;
         }
 
         if (fsblockstore_api->m_ContentIndex)
         {
+            // Keep the blocks we know of that did not make it to the store index
             struct Longtail_ContentIndex* merged_content_index;
             err = Longtail_MergeContentIndex(
                 fsblockstore_api->m_JobAPI,
                 content_index,
                 fsblockstore_api->m_ContentIndex,
                 &merged_content_index);
+            Longtail_Free(content_index);
             if (err)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_GetIndexSync(%p, %p) failed with %d",
                     fsblockstore_api, out_content_index,
                     err)
-                Longtail_Free(content_index);
+                FreeIndexSegmentNames(segment_names);
+                Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
                 return err;
             }
-            Longtail_Free(content_index);
             Longtail_Free(fsblockstore_api->m_ContentIndex);
-            fsblockstore_api->m_ContentIndex = 0;
             content_index = merged_content_index;
         }
 
         fsblockstore_api->m_ContentIndex = content_index;
-        uint64_t block_count = *content_index->m_BlockCount;
-        for (uint64_t b = 0; b < block_count; ++b)
-        {
-            uint64_t block_hash = content_index->m_BlockHashes[b];
-            hmput(fsblockstore_api->m_BlockState, block_hash, 1);
-        }
+        SetStoredBlockStates(fsblockstore_api, content_index);
+        SetMergedSegments(fsblockstore_api, segment_names);
+        FreeIndexSegmentNames(segment_names);
+        fsblockstore_api->m_StoreIndexSize = store_index_size;
+        fsblockstore_api->m_StoreIndexStale = 0;
     }
 
     intptr_t new_block_count = arrlen(fsblockstore_api->m_AddedBlockIndexes);
     if (new_block_count > 0)
     {
         struct Longtail_ContentIndex* new_content_index;
-        int err = UpdateContentIndex(
+        err = UpdateContentIndex(
             fsblockstore_api->m_ContentIndex,
             fsblockstore_api->m_AddedBlockIndexes,
             &new_content_index);
@@ -879,7 +1587,7 @@ static int FSBlockStore_GetIndexSync(
 
     size_t content_index_size;
     void* tmp_content_buffer;
-    int err = Longtail_WriteContentIndexToBuffer(fsblockstore_api->m_ContentIndex, &tmp_content_buffer, &content_index_size);
+    err = Longtail_WriteContentIndexToBuffer(fsblockstore_api->m_ContentIndex, &tmp_content_buffer, &content_index_size);
     Longtail_UnlockSpinLock(fsblockstore_api->m_Lock);
     if (err)
     {
@@ -967,42 +1675,21 @@ static int FSBlockStore_Flush(struct Longtail_BlockStoreAPI* block_store_api, st
 
     int err = 0;
 
+    struct Longtail_ContentIndex* added_content_index = 0;
     intptr_t new_block_count = arrlen(api->m_AddedBlockIndexes);
     if (new_block_count > 0)
     {
-        if (api->m_ContentIndex)
-        {
-            struct Longtail_ContentIndex* new_content_index;
-            err = UpdateContentIndex(
-                api->m_ContentIndex,
-                api->m_AddedBlockIndexes,
-                &new_content_index);
-            if (err)
-            {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_Flush(%p, %p) failed with %d",
-                    block_store_api, async_complete_api,
-                    err)
-            }
-            else
-            {
-                Longtail_Free(api->m_ContentIndex);
-                api->m_ContentIndex = new_content_index;
-            }
-        }
-        else
+        err = Longtail_CreateContentIndexFromBlocks(
+            api->m_ContentIndex ? *api->m_ContentIndex->m_MaxBlockSize : api->m_DefaultMaxBlockSize,
+            api->m_ContentIndex ? *api->m_ContentIndex->m_MaxChunksPerBlock : api->m_DefaultMaxChunksPerBlock,
+            (uint64_t)(arrlen(api->m_AddedBlockIndexes)),
+            api->m_AddedBlockIndexes,
+            &added_content_index);
+        if (err)
         {
-            err = Longtail_CreateContentIndexFromBlocks(
-                api->m_DefaultMaxBlockSize,
-                api->m_DefaultMaxChunksPerBlock,
-                (uint64_t)(arrlen(api->m_AddedBlockIndexes)),
-                api->m_AddedBlockIndexes,
-                &api->m_ContentIndex);
-            if (err)
-            {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_Flush(%p, %p) failed with %d",
-                    block_store_api, async_complete_api,
-                    err)
-            }
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FSBlockStore_Flush(%p, %p) failed with %d",
+                block_store_api, async_complete_api,
+                err)
         }
         intptr_t free_block_index = new_block_count;
         while(free_block_index-- > 0)
@@ -1013,7 +1700,7 @@ static int FSBlockStore_Flush(struct Longtail_BlockStoreAPI* block_store_api, st
     }
     arrfree(api->m_AddedBlockIndexes);
 
-    if (api->m_ContentIndex)
+    if (!err && (api->m_ContentIndex || added_content_index))
     {
         int err = EnsureParentPathExists(api->m_StorageAPI, api->m_ContentIndexLockPath);
         if (err)
@@ -1029,19 +1716,92 @@ static int FSBlockStore_Flush(struct Longtail_BlockStoreAPI* block_store_api, st
             int err = api->m_StorageAPI->LockFile(api->m_StorageAPI, api->m_ContentIndexLockPath, &content_index_lock_file);
             if (!err)
             {
-                if (new_block_count > 0 || (!api->m_StorageAPI->IsFile(api->m_StorageAPI, content_index_path)))
+                intptr_t segment_count = 0;
+                int has_store_index = api->m_StorageAPI->IsFile(api->m_StorageAPI, content_index_path);
+                if (api->m_SegmentedStoreIndex && has_store_index)
                 {
-                    err = SafeWriteContentIndex(api);
-                    if (err)
+                    // Only the new blocks are written and only the segments we have not seen are read,
+                    // m_ContentIndex is brought up to date when the index is read
+                    if (added_content_index)
                     {
-                        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to store content index for `%s`, %d", api->m_ContentPath, err);
+                        uint64_t segment_id;
+                        err = WriteContentIndexSegment(api, added_content_index, &segment_id);
+                        if (api->m_ContentIndex)
+                        {
+                            if (!err)
+                            {
+                                hmput(api->m_MergedSegments, segment_id, 1);
+                            }
+                            // The blocks are in the store even if we failed to record them in a segment
+                            int add_err = AddPendingStoreIndex(api, added_content_index);
+                            added_content_index = 0;
+                            err = err ? err : add_err;
+                        }
                     }
+                    char** segment_names = 0;
+                    if (!err)
+                    {
+                        err = GetIndexSegmentNames(api->m_StorageAPI, api->m_ContentPath, &segment_names);
+                    }
+                    if (!err)
+                    {
+                        segment_count = arrlen(segment_names);
+                        err = ReadNewIndexSegments(api, content_index_path, segment_names);
+                    }
+                    FreeIndexSegmentNames(segment_names);
+                }
+                else if (new_block_count > 0 || !has_store_index)
+                {
+                    err = FoldPendingStoreIndex(api);
+                    if (!err && added_content_index)
+                    {
+                        if (api->m_ContentIndex)
+                        {
+                            struct Longtail_ContentIndex* new_content_index;
+                            err = Longtail_AddContentIndex(
+                                api->m_ContentIndex,
+                                added_content_index,
+                                &new_content_index);
+                            if (!err)
+                            {
+                                Longtail_Free(api->m_ContentIndex);
+                                api->m_ContentIndex = new_content_index;
+                            }
+                        }
+                        else
+                        {
+                            api->m_ContentIndex = added_content_index;
+                            added_content_index = 0;
+                        }
+                    }
+                    if (!err && has_store_index)
+                    {
+                        err = RewriteStoreIndex(api, content_index_path);
+                    }
+                    else if (!err)
+                    {
+                        err = WriteContentIndexFile(api, api->m_ContentIndex);
+                    }
+                    if (!err)
+                    {
+                        err = GetStoreIndexSize(api->m_StorageAPI, content_index_path, &api->m_StoreIndexSize);
+                        api->m_StoreIndexStale = err != 0;
+                    }
+                }
+                if (err)
+                {
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Failed to store content index for `%s`, %d", api->m_ContentPath, err);
                 }
                 api->m_StorageAPI->UnlockFile(api->m_StorageAPI, content_index_lock_file);
+                if (segment_count >= MAX_INDEX_SEGMENT_COUNT)
+                {
+                    FSBlockStore_StartCompaction(api);
+                }
             }
             Longtail_Free((void*)content_index_path);
         }
     }
+    Longtail_Free(added_content_index);
 
     Longtail_UnlockSpinLock(api->m_Lock);
 
@@ -1072,7 +1832,11 @@ static void FSBlockStore_Dispose(struct Longtail_API* api)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "FSBlockStore_Flush failed for `%s`, %d", fsblockstore_api->m_ContentPath, err);
     }
+    FSBlockStore_JoinCompaction(fsblockstore_api);
 
+    LONGTAIL_FATAL_ASSERT(hmlen(fsblockstore_api->m_BlockHashToCompleteCallbacks) == 0, return)
+    hmfree(fsblockstore_api->m_BlockHashToCompleteCallbacks);
+    fsblockstore_api->m_BlockHashToCompleteCallbacks = 0;
     hmfree(fsblockstore_api->m_BlockState);
     fsblockstore_api->m_BlockState = 0;
     Longtail_DeleteSpinLock(fsblockstore_api->m_Lock);
@@ -1080,6 +1844,8 @@ static void FSBlockStore_Dispose(struct Longtail_API* api)
     Longtail_Free((void*)fsblockstore_api->m_ContentIndexLockPath);
     Longtail_Free(fsblockstore_api->m_ContentPath);
     Longtail_Free(fsblockstore_api->m_ContentIndex);
+    Longtail_Free(fsblockstore_api->m_PendingStoreIndex);
+    hmfree(fsblockstore_api->m_MergedSegments);
     Longtail_Free(fsblockstore_api);
 }
 
@@ -1091,6 +1857,8 @@ static int FSBlockStore_Init(
     uint32_t default_max_block_size,
     uint32_t default_max_chunks_per_block,
     const char* optional_extension,
+    int sorted_store_index,
+    int segmented_store_index,
     uint64_t unique_id,
     struct Longtail_BlockStoreAPI** out_block_store_api)
 {
@@ -1122,6 +1890,7 @@ static int FSBlockStore_Init(
     api->m_ContentPath = Longtail_Strdup(content_path);
     api->m_ContentIndex = 0;
     api->m_BlockState = 0;
+    api->m_BlockHashToCompleteCallbacks = 0;
     api->m_AddedBlockIndexes = 0;
     api->m_BlockExtension = optional_extension ? optional_extension : ".lrb";
     api->m_ContentIndexLockPath = storage_api->ConcatPath(storage_api, content_path, "store.lci.sync");
@@ -1129,6 +1898,14 @@ static int FSBlockStore_Init(
     GetUniqueExtension(unique_id, api->m_TmpExtension);
     api->m_DefaultMaxBlockSize = default_max_block_size;
     api->m_DefaultMaxChunksPerBlock = default_max_chunks_per_block;
+    api->m_SortedStoreIndex = sorted_store_index;
+    api->m_SegmentedStoreIndex = segmented_store_index;
+    api->m_PendingStoreIndex = 0;
+    api->m_MergedSegments = 0;
+    api->m_StoreIndexSize = 0;
+    api->m_StoreIndexStale = 0;
+    api->m_CompactionThread = 0;
+    api->m_CompactionRunning = 0;
 
     for (uint32_t s = 0; s < Longtail_BlockStoreAPI_StatU64_Count; ++s)
     {
@@ -1148,16 +1925,18 @@ static int FSBlockStore_Init(
     return 0;
 }
 
-struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPI(
+struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPIWithOptions(
     struct Longtail_JobAPI* job_api,
     struct Longtail_StorageAPI* storage_api,
     const char* content_path,
     uint32_t default_max_block_size,
     uint32_t default_max_chunks_per_block,
-    const char* optional_extension)
+    const char* optional_extension,
+    int sorted_store_index,
+    int segmented_store_index)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateFSBlockStoreAPI(%p, %s, %u, %u)",
-        storage_api, content_path, default_max_block_size, default_max_chunks_per_block)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateFSBlockStoreAPIWithOptions(%p, %s, %u, %u, %d, %d)",
+        storage_api, content_path, default_max_block_size, default_max_chunks_per_block, sorted_store_index, segmented_store_index)
     LONGTAIL_VALIDATE_INPUT(storage_api != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(content_path != 0, return 0)
     LONGTAIL_VALIDATE_INPUT(default_max_block_size != 0, return 0)
@@ -1167,8 +1946,8 @@ struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPI(
     void* mem = Longtail_Alloc(api_size);
     if (!mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFSBlockStoreAPI(%p, %s, %u, %u) failed with %d",
-            storage_api, content_path, default_max_block_size, default_max_chunks_per_block,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFSBlockStoreAPIWithOptions(%p, %s, %u, %u, %d, %d) failed with %d",
+            storage_api, content_path, default_max_block_size, default_max_chunks_per_block, sorted_store_index, segmented_store_index,
             ENOMEM)
         return 0;
     }
@@ -1185,15 +1964,36 @@ struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPI(
         default_max_block_size,
         default_max_chunks_per_block,
         optional_extension,
+        sorted_store_index,
+        segmented_store_index,
         unique_id,
         &block_store_api);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFSBlockStoreAPI(%p, %s, %u, %u) failed with %d",
-            storage_api, content_path, default_max_block_size, default_max_chunks_per_block,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateFSBlockStoreAPIWithOptions(%p, %s, %u, %u, %d, %d) failed with %d",
+            storage_api, content_path, default_max_block_size, default_max_chunks_per_block, sorted_store_index, segmented_store_index,
             err)
         Longtail_Free(mem);
         return 0;
     }
     return block_store_api;
 }
+
+struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPI(
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_StorageAPI* storage_api,
+    const char* content_path,
+    uint32_t default_max_block_size,
+    uint32_t default_max_chunks_per_block,
+    const char* optional_extension)
+{
+    return Longtail_CreateFSBlockStoreAPIWithOptions(
+        job_api,
+        storage_api,
+        content_path,
+        default_max_block_size,
+        default_max_chunks_per_block,
+        optional_extension,
+        0,
+        0);
+}
@@ -14,6 +14,19 @@ LONGTAIL_EXPORT extern struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStor
     uint32_t default_max_chunks_per_block,
     const char* optional_extension);
 
+// sorted_store_index writes store.lci as a 1.1.0 content index with sorted chunk lookup columns, older clients can not read it
+// segmented_store_index writes the blocks added by each flush to a small index segment next to store.lci instead of rewriting it,
+// the segments are compacted into store.lci in the background. Older clients only see the blocks in store.lci
+LONGTAIL_EXPORT extern struct Longtail_BlockStoreAPI* Longtail_CreateFSBlockStoreAPIWithOptions(
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_StorageAPI* storage_api,
+    const char* content_path,
+    uint32_t default_max_block_size,
+    uint32_t default_max_chunks_per_block,
+    const char* optional_extension,
+    int sorted_store_index,
+    int segmented_store_index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
 #include "../blake2/longtail_blake2.h"
 #include "../blake3/longtail_blake3.h"
 #include "../meowhash/longtail_meowhash.h"
+#include "../xxh3/longtail_xxh3.h"
 
  struct Longtail_HashRegistryAPI* Longtail_CreateFullHashRegistry()
  {
@@ -26,23 +27,34 @@
          SAFE_DISPOSE_API(blake2_hash);
          return 0;
      }
+     struct Longtail_HashAPI* xxh3_hash = Longtail_CreateXXH3HashAPI();
+     if (!xxh3_hash)
+     {
+         SAFE_DISPOSE_API(meow_hash);
+         SAFE_DISPOSE_API(blake3_hash);
+         SAFE_DISPOSE_API(blake2_hash);
+         return 0;
+     }
 
-     uint32_t hash_types[3] = {
+     uint32_t hash_types[4] = {
          Longtail_GetBlake2HashType(),
          Longtail_GetBlake3HashType(),
-         Longtail_GetMeowHashType()};
+         Longtail_GetMeowHashType(),
+         Longtail_GetXXH3HashType()};
 
-    struct Longtail_HashAPI* hash_apis[3] = {
+    struct Longtail_HashAPI* hash_apis[4] = {
         blake2_hash,
         blake3_hash,
-        meow_hash};
+        meow_hash,
+        xxh3_hash};
 
     struct Longtail_HashRegistryAPI* registry = Longtail_CreateDefaultHashRegistry(
-        3,
+        4,
         (const uint32_t*)hash_types,
         (const struct Longtail_HashAPI**)hash_apis);
     if (!registry)
     {
+         SAFE_DISPOSE_API(xxh3_hash);
          SAFE_DISPOSE_API(meow_hash);
          SAFE_DISPOSE_API(blake3_hash);
          SAFE_DISPOSE_API(blake2_hash);
@@ -3,9 +3,13 @@
 #include "longtail_hpcdcchunker.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 
+const uint32_t LONGTAIL_HPCDC_CHUNKER_TYPE = (((uint32_t)'h') << 24) + (((uint32_t)'p') << 16) + (((uint32_t)'c') << 8) + ((uint32_t)'d');
+const uint32_t Longtail_GetHPCDCChunkerType() { return LONGTAIL_HPCDC_CHUNKER_TYPE; }
+
 // ChunkerWindowSize is the number of bytes in the rolling hash window
 #define ChunkerWindowSize 48u
 
@@ -134,7 +138,8 @@ int Longtail_HPCDCCreateChunker(
         max_feed = 0xffffffffu;
     }
 
-    size_t chunker_size = sizeof(struct Longtail_HPCDCChunker) + max_feed;
+    // The feed buffer is only allocated if the chunker is fed, chunking from a buffer does not need it
+    size_t chunker_size = sizeof(struct Longtail_HPCDCChunker);
     struct Longtail_HPCDCChunker* c = (struct Longtail_HPCDCChunker*)Longtail_Alloc(chunker_size);
     if (!c)
     {
@@ -144,7 +149,7 @@ int Longtail_HPCDCCreateChunker(
         return ENOMEM;
     }
     c->params = *params;
-    c->buf.data = (uint8_t*)&c[1];
+    c->buf.data = 0;
     c->buf.len = 0;
     c->max_feed = (uint32_t)max_feed;
     c->off = 0;
@@ -164,6 +169,18 @@ static int FeedChunker(
         c)
     LONGTAIL_FATAL_ASSERT(c != 0, return EINVAL)
 
+    if (c->buf.data == 0)
+    {
+        c->buf.data = (uint8_t*)Longtail_Alloc(c->max_feed);
+        if (!c->buf.data)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FeedChunker(%p) failed with %d",
+                c,
+                ENOMEM)
+            return ENOMEM;
+        }
+    }
+
     if (c->off != 0)
     {
         memmove(c->buf.data, &c->buf.data[c->off], c->buf.len - c->off);
@@ -190,6 +207,51 @@ static int FeedChunker(
 #  define LONGTAIL_rotl32(x,r) ((x << r) | (x >> (32 - r)))
 #endif
 
+// Returns the length of the chunk at the start of scoped_buf, left must be larger than the min chunk size
+static uint32_t HPCDCFindChunkLength(
+    struct Longtail_HPCDCChunker* c,
+    const uint8_t* scoped_buf,
+    uint32_t left)
+{
+    uint32_t hash = 0;
+    {
+        const uint8_t* window = &scoped_buf[c->params.min - ChunkerWindowSize];
+        for (uint32_t i = 0; i < ChunkerWindowSize; ++i)
+        {
+            uint8_t b = window[i];
+            hash ^= LONGTAIL_rotl32(hashTable[b], (int)((ChunkerWindowSize-i-1u) & 31));
+            c->hWindow[i] = b;
+        }
+    }
+
+    uint32_t pos = c->params.min;
+    uint32_t idx = 0;
+
+    uint32_t data_len = left > c->params.max ? c->params.max : left;
+    uint8_t* window = c->hWindow;
+    const uint32_t discriminator = c->hDiscriminator - 1;
+    const uint32_t d = c->hDiscriminator;
+    while(pos < data_len)
+    {
+        uint8_t in = scoped_buf[pos++];
+        uint8_t out = window[idx];
+        window[idx++] = in;
+        hash = LONGTAIL_rotl32(hash, 1) ^
+            LONGTAIL_rotl32(hashTable[out], (int)(ChunkerWindowSize & 31)) ^
+            hashTable[in];
+
+        if ((hash % d) == discriminator)
+        {
+            break;
+        }
+        if (idx == ChunkerWindowSize)
+        {
+            idx = 0;
+        }
+    }
+    return pos;
+}
+
 static const struct Longtail_Chunker_ChunkRange EmptyChunkRange = {0, 0, 0};
 
 struct Longtail_Chunker_ChunkRange Longtail_HPCDCNextChunk(
@@ -227,47 +289,8 @@ struct Longtail_Chunker_ChunkRange Longtail_HPCDCNextChunk(
         return r;
     }
 
-    uint32_t hash = 0;
-    struct Longtail_Chunker_ChunkRange scoped_data = {&c->buf.data[c->off], c->processed_count + c->off, left};
-    {
-        struct Longtail_Chunker_ChunkRange window = {
-            &scoped_data.buf[c->params.min - ChunkerWindowSize],
-            c->processed_count + c->off + c->params.min - ChunkerWindowSize,
-            ChunkerWindowSize};
-        for (uint32_t i = 0; i < ChunkerWindowSize; ++i)
-        {
-            uint8_t b = window.buf[i];
-            hash ^= LONGTAIL_rotl32(hashTable[b], (int)((ChunkerWindowSize-i-1u) & 31));
-            c->hWindow[i] = b;
-        }
-    }
-
-    uint32_t pos = c->params.min;
-    uint32_t idx = 0;
-
-    uint32_t data_len = scoped_data.len > c->params.max ? c->params.max : scoped_data.len;
-    uint8_t* window = c->hWindow;
-    const uint32_t discriminator = c->hDiscriminator - 1;
-    const uint8_t* scoped_buf = scoped_data.buf;
-    const uint32_t d = c->hDiscriminator;
-    while(pos < data_len)
-    {
-        uint8_t in = scoped_buf[pos++];
-        uint8_t out = window[idx];
-        window[idx++] = in;
-        hash = LONGTAIL_rotl32(hash, 1) ^
-            LONGTAIL_rotl32(hashTable[out], (int)(ChunkerWindowSize & 31)) ^
-            hashTable[in];
-
-        if ((hash % d) == discriminator)
-        {
-            break;
-        }
-        if (idx == ChunkerWindowSize)
-        {
-            idx = 0;
-        }
-    }
+    const uint8_t* scoped_buf = &c->buf.data[c->off];
+    uint32_t pos = HPCDCFindChunkLength(c, scoped_buf, left);
     struct Longtail_Chunker_ChunkRange r = {scoped_buf, c->processed_count + c->off, pos};
     c->off += pos;
     return r;
@@ -287,6 +310,13 @@ void HPCDCChunker_Dispose(struct Longtail_API* base_api)
 	Longtail_Free(api);
 }
 
+uint32_t HPCDCChunker_GetIdentifier(struct Longtail_ChunkerAPI* chunker_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "HPCDCChunker_GetIdentifier(%p)", chunker_api)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return 0)
+    return LONGTAIL_HPCDC_CHUNKER_TYPE;
+}
+
 int HPCDCChunker_GetMinChunkSize(struct Longtail_ChunkerAPI* chunker_api, uint32_t* out_min_chunk_size)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "HPCDCChunker_GetMinChunkSize(%p, %p)", chunker_api, out_min_chunk_size)
@@ -349,7 +379,26 @@ int HPCDCChunker_DisposeChunker(struct Longtail_ChunkerAPI* chunker_api, Longtai
     LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(chunker, return EINVAL)
 	struct Longtail_HPCDCChunkerAPI* api = (struct Longtail_HPCDCChunkerAPI*)chunker_api;
-	Longtail_Free(chunker);
+	struct Longtail_HPCDCChunker* c = (struct Longtail_HPCDCChunker*)chunker;
+	Longtail_Free(c->buf.data);
+	Longtail_Free(c);
+	return 0;
+}
+
+int HPCDCChunker_NextChunkFromBuffer(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, const void* buffer, uint64_t buffer_size, const void** out_next_chunk_start)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "HPCDCChunker_NextChunkFromBuffer(%p, %p, %p, %" PRIu64 ", %p)",
+		chunker_api, chunker, buffer, buffer_size, out_next_chunk_start)
+    LONGTAIL_VALIDATE_INPUT(chunker_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(chunker, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(buffer, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(buffer_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_next_chunk_start, return EINVAL)
+
+	struct Longtail_HPCDCChunker* c = (struct Longtail_HPCDCChunker*)chunker;
+	uint32_t left = buffer_size > c->params.max ? c->params.max : (uint32_t)buffer_size;
+	uint32_t len = (left <= c->params.min) ? left : HPCDCFindChunkLength(c, (const uint8_t*)buffer, left);
+	*out_next_chunk_start = &((const uint8_t*)buffer)[len];
 	return 0;
 }
 
@@ -364,10 +413,12 @@ static int HPCDCChunker_Init(
 	struct Longtail_ChunkerAPI* chunker_api = Longtail_MakeChunkerAPI(
 		mem,
 		HPCDCChunker_Dispose,
+		HPCDCChunker_GetIdentifier,
 		HPCDCChunker_GetMinChunkSize,
 		HPCDCChunker_CreateChunker,
 		HPCDCChunker_NextChunk,
-		HPCDCChunker_DisposeChunker);
+		HPCDCChunker_DisposeChunker,
+		HPCDCChunker_NextChunkFromBuffer);
     if (!chunker_api)
     {
         return EINVAL;
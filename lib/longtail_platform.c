@@ -135,11 +135,30 @@ void Longtail_Sleep(uint64_t timeout_us)
     Sleep(wait_ms);
 }
 
+uint64_t Longtail_GetTimeNs()
+{
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t seconds = (uint64_t)(counter.QuadPart / frequency.QuadPart);
+    uint64_t remainder = (uint64_t)(counter.QuadPart % frequency.QuadPart);
+    return seconds * 1000000000u + (remainder * 1000000000u) / (uint64_t)frequency.QuadPart;
+}
+
 int32_t Longtail_AtomicAdd32(TLongtail_Atomic32* value, int32_t amount)
 {
     return (int32_t)InterlockedAdd((LONG volatile*)value, (LONG)amount);
 }
 
+int Longtail_CompareAndSwap(TLongtail_Atomic32* value, int32_t expected, int32_t new_value)
+{
+    return InterlockedCompareExchange((LONG volatile*)value, (LONG)new_value, (LONG)expected) == (LONG)expected;
+}
+
 #if !defined(__GNUC__)
     #define _InterlockedAdd64 _InlineInterlockedAdd64
 #endif
@@ -524,7 +543,7 @@ const char* Longtail_GetDirectoryName(HLongtail_FSIterator fs_iterator)
     return 0;
 }
 
-int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir)
+int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir, uint64_t* out_modification_time, uint64_t* out_change_time, uint64_t* out_file_id)
 {
     DWORD high = fs_iterator->m_FindData.nFileSizeHigh;
     DWORD low = fs_iterator->m_FindData.nFileSizeLow;
@@ -544,6 +563,10 @@ int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_
         permissions = permissions | Longtail_StorageAPI_UserWriteAccess | Longtail_StorageAPI_GroupWriteAccess | Longtail_StorageAPI_OtherWriteAccess;
     }
     *out_permissions = permissions;
+    // FindData has no file index and writes do not update a separate change time
+    *out_modification_time = (((uint64_t)fs_iterator->m_FindData.ftLastWriteTime.dwHighDateTime) << 32) + (uint64_t)fs_iterator->m_FindData.ftLastWriteTime.dwLowDateTime;
+    *out_change_time = 0;
+    *out_file_id = 0;
     return 0;
 }
 
@@ -558,6 +581,12 @@ int Longtail_OpenReadFile(const char* path, HLongtail_OpenFile* out_read_file)
     return 0;
 }
 
+int Longtail_AdviseSequentialRead(HLongtail_OpenFile handle)
+{
+    // Windows only takes the sequential scan hint when the file is opened
+    return 0;
+}
+
 int Longtail_OpenWriteFile(const char* path, uint64_t initial_size, HLongtail_OpenFile* out_write_file)
 {
     HANDLE handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, 0, initial_size == 0 ? CREATE_ALWAYS : OPEN_ALWAYS, 0, 0);
@@ -663,16 +692,15 @@ int Longtail_GetFilePermissions(const char* path, uint16_t* out_permissions)
     return 0;
 }
 
+// Positional reads and writes via OVERLAPPED offsets so the same handle can be used from multiple threads
 int Longtail_Read(HLongtail_OpenFile handle, uint64_t offset, uint64_t length, void* output)
 {
     HANDLE h = (HANDLE)(handle);
-    LONG low = (LONG)(offset & 0xffffffff);
-    LONG high = (LONG)(offset >> 32);
-    if (INVALID_SET_FILE_POINTER == SetFilePointer(h, low, &high, FILE_BEGIN))
-    {
-        return Win32ErrorToErrno(GetLastError());
-    }
-    if (FALSE == ReadFile(h, output, (LONG)length, 0, 0))
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = (DWORD)(offset & 0xffffffff);
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD read_count = 0;
+    if (FALSE == ReadFile(h, output, (DWORD)length, &read_count, &overlapped))
     {
         return Win32ErrorToErrno(GetLastError());
     }
@@ -682,13 +710,11 @@ int Longtail_Read(HLongtail_OpenFile handle, uint64_t offset, uint64_t length, v
 int Longtail_Write(HLongtail_OpenFile handle, uint64_t offset, uint64_t length, const void* input)
 {
     HANDLE h = (HANDLE)(handle);
-    LONG low = (LONG)(offset & 0xffffffff);
-    LONG high = (LONG)(offset >> 32);
-    if (INVALID_SET_FILE_POINTER == SetFilePointer(h, low, &high, FILE_BEGIN))
-    {
-        return Win32ErrorToErrno(GetLastError());
-    }
-    if (FALSE == WriteFile(h, input, (LONG)length, 0, 0))
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = (DWORD)(offset & 0xffffffff);
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD written_count = 0;
+    if (FALSE == WriteFile(h, input, (DWORD)length, &written_count, &overlapped))
     {
         return Win32ErrorToErrno(GetLastError());
     }
@@ -825,6 +851,50 @@ int Longtail_UnlockFile(HLongtail_FileLock file_lock)
     }
     return 0;
 }
+
+struct Longtail_FileMap_private
+{
+    HANDLE m_MappingHandle;
+    void* m_BasePtr;
+};
+
+size_t Longtail_GetFileMapSize()
+{
+    return sizeof(struct Longtail_FileMap_private);
+}
+
+int Longtail_MapFile(void* mem, HLongtail_OpenFile handle, uint64_t offset, uint64_t length, HLongtail_FileMap* out_file_map, const void** out_data_ptr)
+{
+    HANDLE h = (HANDLE)(handle);
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    // Views must start at a multiple of the allocation granularity
+    uint64_t aligned_offset = offset - (offset % system_info.dwAllocationGranularity);
+    HANDLE mapping_handle = CreateFileMappingA(h, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping_handle == 0)
+    {
+        return Win32ErrorToErrno(GetLastError());
+    }
+    void* base_ptr = MapViewOfFile(mapping_handle, FILE_MAP_READ, (DWORD)(aligned_offset >> 32), (DWORD)(aligned_offset & 0xffffffff), (SIZE_T)(length + (offset - aligned_offset)));
+    if (base_ptr == 0)
+    {
+        int e = Win32ErrorToErrno(GetLastError());
+        CloseHandle(mapping_handle);
+        return e;
+    }
+    struct Longtail_FileMap_private* file_map = (struct Longtail_FileMap_private*)mem;
+    file_map->m_MappingHandle = mapping_handle;
+    file_map->m_BasePtr = base_ptr;
+    *out_file_map = file_map;
+    *out_data_ptr = &((const uint8_t*)base_ptr)[offset - aligned_offset];
+    return 0;
+}
+
+void Longtail_UnmapFile(HLongtail_FileMap file_map)
+{
+    UnmapViewOfFile(file_map->m_BasePtr);
+    CloseHandle(file_map->m_MappingHandle);
+}
 #endif
 
 #if defined(__APPLE__) || defined(__linux__)
@@ -838,8 +908,11 @@ int Longtail_UnlockFile(HLongtail_FileLock file_lock)
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <pwd.h>
+#include <time.h>
 
 uint32_t Longtail_GetCPUCount()
 {
@@ -851,11 +924,23 @@ void Longtail_Sleep(uint64_t timeout_us)
     usleep((useconds_t)timeout_us);
 }
 
+uint64_t Longtail_GetTimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
 int32_t Longtail_AtomicAdd32(TLongtail_Atomic32* value, int32_t amount)
 {
     return __sync_fetch_and_add(value, amount) + amount;
 }
 
+int Longtail_CompareAndSwap(TLongtail_Atomic32* value, int32_t expected, int32_t new_value)
+{
+    return __sync_bool_compare_and_swap(value, expected, new_value) ? 1 : 0;
+}
+
 int64_t Longtail_AtomicAdd64(TLongtail_Atomic64* value, int64_t amount)
 {
     return __sync_fetch_and_add(value, amount) + amount;
@@ -1081,11 +1166,6 @@ mode_t = unsigned short
 uid = short
 gid = short
 */
-#if !defined(__clang__) || defined(__APPLE__)
-#define off64_t off_t
-#define ftruncate64 ftruncate
-#endif
-
 #ifdef __APPLE__
 # include <os/lock.h>
 # include <dispatch/dispatch.h>
@@ -1527,7 +1607,7 @@ const char* Longtail_GetDirectoryName(HLongtail_FSIterator fs_iterator)
     return fs_iterator->m_DirEntry->d_name;
 }
 
-int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir)
+int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir, uint64_t* out_modification_time, uint64_t* out_change_time, uint64_t* out_file_id)
 {
     size_t dir_len = strlen(fs_iterator->m_DirPath);
     size_t file_len = strlen(fs_iterator->m_DirEntry->d_name);
@@ -1551,6 +1631,14 @@ int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_
             *out_is_dir = 0;
             *out_size = (uint64_t)stat_buf.st_size;
         }
+#if defined(__APPLE__)
+        *out_modification_time = (uint64_t)stat_buf.st_mtimespec.tv_sec * 1000000000u + (uint64_t)stat_buf.st_mtimespec.tv_nsec;
+        *out_change_time = (uint64_t)stat_buf.st_ctimespec.tv_sec * 1000000000u + (uint64_t)stat_buf.st_ctimespec.tv_nsec;
+#else
+        *out_modification_time = (uint64_t)stat_buf.st_mtim.tv_sec * 1000000000u + (uint64_t)stat_buf.st_mtim.tv_nsec;
+        *out_change_time = (uint64_t)stat_buf.st_ctim.tv_sec * 1000000000u + (uint64_t)stat_buf.st_ctim.tv_nsec;
+#endif
+        *out_file_id = (uint64_t)stat_buf.st_ino;
     }
     else
     {
@@ -1560,47 +1648,59 @@ int Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_
     return res;
 }
 
+// Open files are plain file descriptors so reads and writes at different offsets
+// of the same file can be issued from multiple threads without any locking.
+// The descriptor is offset by one so a valid handle is never zero.
+#define LONGTAIL_FD_TO_HANDLE(fd) ((HLongtail_OpenFile)(uintptr_t)((fd) + 1))
+#define LONGTAIL_HANDLE_TO_FD(handle) ((int)((uintptr_t)(handle) - 1))
+
 int Longtail_OpenReadFile(const char* path, HLongtail_OpenFile* out_read_file)
 {
-    FILE* f = fopen(path, "rb");
-    if (f == 0)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
     {
         return errno;
     }
-    *out_read_file = (HLongtail_OpenFile)f;
+    *out_read_file = LONGTAIL_FD_TO_HANDLE(fd);
     return 0;
 }
 
+int Longtail_AdviseSequentialRead(HLongtail_OpenFile handle)
+{
+#if defined(__linux__)
+    return posix_fadvise(LONGTAIL_HANDLE_TO_FD(handle), 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+    return 0;
+#endif
+}
+
 int Longtail_OpenWriteFile(const char* path, uint64_t initial_size, HLongtail_OpenFile* out_write_file)
 {
-    FILE* f = fopen(path, "wb");
-    if (!f)
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd == -1)
     {
-        int e = errno;
-        return e;
+        return errno;
     }
     if  (initial_size > 0)
     {
-        int err = ftruncate64(fileno(f), (off64_t)initial_size);
+        int err = ftruncate(fd, (off_t)initial_size);
         if (err != 0)
         {
             int e = errno;
-            fclose(f);
+            close(fd);
             return e;
         }
     }
-    *out_write_file = (HLongtail_OpenFile)f;
+    *out_write_file = LONGTAIL_FD_TO_HANDLE(fd);
     return 0;
 }
 
 int Longtail_SetFileSize(HLongtail_OpenFile handle, uint64_t length)
 {
-    FILE* f = (FILE*)handle;
-    fflush(f);
-    int err = ftruncate(fileno(f), (off_t)length);
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    int err = ftruncate(fd, (off_t)length);
     if (err == 0)
     {
-        fflush(f);
         return 0;
     }
     return errno;
@@ -1626,49 +1726,69 @@ int Longtail_GetFilePermissions(const char* path, uint16_t* out_permissions)
 
 int Longtail_Read(HLongtail_OpenFile handle, uint64_t offset, uint64_t length, void* output)
 {
-    FILE* f = (FILE*)handle;
-    if (-1 == fseek(f, (long int)offset, SEEK_SET))
-    {
-        return errno;
-    }
-    size_t read = fread(output, (size_t)length, 1, f);
-    if (read != 1u)
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    uint8_t* p = (uint8_t*)output;
+    while (length > 0)
     {
-        return errno;
+        ssize_t read_count = pread(fd, p, (size_t)length, (off_t)offset);
+        if (read_count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno;
+        }
+        if (read_count == 0)
+        {
+            // Reading past end of file
+            return EIO;
+        }
+        p += read_count;
+        offset += (uint64_t)read_count;
+        length -= (uint64_t)read_count;
     }
     return 0;
 }
 
 int Longtail_Write(HLongtail_OpenFile handle, uint64_t offset, uint64_t length, const void* input)
 {
-    FILE* f = (FILE*)handle;
-    if (-1 == fseek(f, (long int )offset, SEEK_SET))
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    const uint8_t* p = (const uint8_t*)input;
+    while (length > 0)
     {
-        return errno;
-    }
-    size_t written = fwrite(input, (size_t)length, 1, f);
-    if (written != 1u)
-    {
-        return errno;
+        ssize_t written = pwrite(fd, p, (size_t)length, (off_t)offset);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno;
+        }
+        p += written;
+        offset += (uint64_t)written;
+        length -= (uint64_t)written;
     }
     return 0;
 }
 
 int Longtail_GetFileSize(HLongtail_OpenFile handle, uint64_t* out_size)
 {
-    FILE* f = (FILE*)handle;
-    if (-1 == fseek(f, 0, SEEK_END))
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    struct stat stat_buf;
+    if (-1 == fstat(fd, &stat_buf))
     {
         return errno;
     }
-    *out_size = (uint64_t)ftell(f);
+    *out_size = (uint64_t)stat_buf.st_size;
     return 0;
 }
 
 void Longtail_CloseFile(HLongtail_OpenFile handle)
 {
-    FILE* f = (FILE*)handle;
-    fclose(f);
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    close(fd);
 }
 
 const char* Longtail_ConcatPath(const char* folder, const char* file)
@@ -1735,4 +1855,40 @@ int Longtail_UnlockFile(HLongtail_FileLock file_lock)
     return 0;
 }
 
+struct Longtail_FileMap_private
+{
+    void* m_BasePtr;
+    size_t m_Size;
+};
+
+size_t Longtail_GetFileMapSize()
+{
+    return sizeof(struct Longtail_FileMap_private);
+}
+
+int Longtail_MapFile(void* mem, HLongtail_OpenFile handle, uint64_t offset, uint64_t length, HLongtail_FileMap* out_file_map, const void** out_data_ptr)
+{
+    int fd = LONGTAIL_HANDLE_TO_FD(handle);
+    // Mappings must start at a page boundary
+    uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t aligned_offset = offset - (offset % page_size);
+    size_t size = (size_t)(length + (offset - aligned_offset));
+    void* base_ptr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, (off_t)aligned_offset);
+    if (base_ptr == MAP_FAILED)
+    {
+        return errno;
+    }
+    struct Longtail_FileMap_private* file_map = (struct Longtail_FileMap_private*)mem;
+    file_map->m_BasePtr = base_ptr;
+    file_map->m_Size = size;
+    *out_file_map = file_map;
+    *out_data_ptr = &((const uint8_t*)base_ptr)[offset - aligned_offset];
+    return 0;
+}
+
+void Longtail_UnmapFile(HLongtail_FileMap file_map)
+{
+    munmap(file_map->m_BasePtr, file_map->m_Size);
+}
+
 #endif
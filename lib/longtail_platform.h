@@ -11,9 +11,13 @@ static const uint64_t LONGTAIL_TIMEOUT_INFINITE = ((uint64_t)-1);
 
 uint32_t    Longtail_GetCPUCount();
 void        Longtail_Sleep(uint64_t timeout_us);
+// Monotonic clock in nanoseconds
+uint64_t    Longtail_GetTimeNs();
 
 typedef int32_t volatile TLongtail_Atomic32;
 int32_t Longtail_AtomicAdd32(TLongtail_Atomic32* value, int32_t amount);
+// Sets *value to new_value if it equals expected, returns 1 if it did
+int     Longtail_CompareAndSwap(TLongtail_Atomic32* value, int32_t expected, int32_t new_value);
 
 typedef int64_t volatile TLongtail_Atomic64;
 int64_t Longtail_AtomicAdd64(TLongtail_Atomic64* value, int64_t amount);
@@ -60,11 +64,12 @@ int         Longtail_FindNext(HLongtail_FSIterator fs_iterator);
 void        Longtail_CloseFind(HLongtail_FSIterator fs_iterator);
 const char* Longtail_GetFileName(HLongtail_FSIterator fs_iterator);
 const char* Longtail_GetDirectoryName(HLongtail_FSIterator fs_iterator);
-int         Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir);
+int         Longtail_GetEntryProperties(HLongtail_FSIterator fs_iterator, uint64_t* out_size, uint16_t* out_permissions, int* out_is_dir, uint64_t* out_modification_time, uint64_t* out_change_time, uint64_t* out_file_id);
 
 typedef struct Longtail_OpenFile_private* HLongtail_OpenFile;
 
 int     Longtail_OpenReadFile(const char* path, HLongtail_OpenFile* out_read_file);
+int     Longtail_AdviseSequentialRead(HLongtail_OpenFile handle);
 int     Longtail_OpenWriteFile(const char* path, uint64_t initial_size, HLongtail_OpenFile* out_write_file);
 int     Longtail_SetFileSize(HLongtail_OpenFile handle, uint64_t length);
 int     Longtail_SetFilePermissions(const char* path, uint16_t permissions);
@@ -85,6 +90,11 @@ size_t Longtail_GetFileLockSize();
 int Longtail_LockFile(void* mem, const char* path, HLongtail_FileLock* out_file_lock);
 int Longtail_UnlockFile(HLongtail_FileLock file_lock);
 
+typedef struct Longtail_FileMap_private* HLongtail_FileMap;
+size_t Longtail_GetFileMapSize();
+int Longtail_MapFile(void* mem, HLongtail_OpenFile handle, uint64_t offset, uint64_t length, HLongtail_FileMap* out_file_map, const void** out_data_ptr);
+void Longtail_UnmapFile(HLongtail_FileMap file_map);
+
 #ifdef __cplusplus
 }
 #endif
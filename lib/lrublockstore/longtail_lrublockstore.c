@@ -7,78 +7,192 @@
 #include <errno.h>
 #include <inttypes.h>
 
+struct LRUBlockStoreAPI;
+struct LRUList;
+
+struct LRUStoredBlock {
+    struct Longtail_StoredBlock m_StoredBlock;
+    struct Longtail_StoredBlock* m_OriginalStoredBlock;
+    struct LRUBlockStoreAPI* m_LRUBlockStoreAPI;
+    struct LRUStoredBlock* m_Prev;
+    struct LRUStoredBlock* m_Next;
+    struct LRUList* m_List;
+    TLongtail_Atomic32 m_RefCount;
+};
+
+// Intrusive doubly linked list, m_First is the least recently used block
+struct LRUList
+{
+    struct LRUStoredBlock* m_First;
+    struct LRUStoredBlock* m_Last;
+    uint32_t m_Count;
+    uint64_t m_Size;
+};
+
+// Without scan resistance only m_Probation is used and this is a plain LRU.
+// With scan resistance it is a segmented LRU (a 2Q variant): new blocks enter m_Probation
+// and are promoted to m_Protected when they are requested again while cached. Eviction
+// takes from m_Probation first so a single pass over many blocks does not flush the
+// blocks that are actually reused.
 struct LRU
 {
-    struct LRUStoredBlock** m_StoredBlocks;
+    struct LRUList m_Probation;
+    struct LRUList m_Protected;
     uint32_t m_MaxCount;
-    uint32_t m_AllocatedCount;
+    uint64_t m_MaxSize;
+    int m_ScanResistant;
 };
 
-size_t LRU_GetSize(uint32_t max_count)
+static uint64_t LRU_GetBlockSize(struct LRUStoredBlock* stored_block)
+{
+    return stored_block->m_StoredBlock.m_BlockChunksDataSize;
+}
+
+static void LRUList_Init(struct LRUList* list)
 {
-    return sizeof(struct LRU) +
-        sizeof(struct LRUStoredBlock*) * max_count;
+    list->m_First = 0;
+    list->m_Last = 0;
+    list->m_Count = 0;
+    list->m_Size = 0;
 }
 
-struct LRU* LRU_Create(void* mem, uint32_t max_count)
+static void LRUList_Unlink(struct LRUList* list, struct LRUStoredBlock* stored_block)
+{
+    LONGTAIL_FATAL_ASSERT(stored_block->m_List == list, return)
+    if (stored_block->m_Prev)
+    {
+        stored_block->m_Prev->m_Next = stored_block->m_Next;
+    }
+    else
+    {
+        list->m_First = stored_block->m_Next;
+    }
+    if (stored_block->m_Next)
+    {
+        stored_block->m_Next->m_Prev = stored_block->m_Prev;
+    }
+    else
+    {
+        list->m_Last = stored_block->m_Prev;
+    }
+    stored_block->m_Prev = 0;
+    stored_block->m_Next = 0;
+    stored_block->m_List = 0;
+    --list->m_Count;
+    list->m_Size -= LRU_GetBlockSize(stored_block);
+}
+
+static void LRUList_PushLast(struct LRUList* list, struct LRUStoredBlock* stored_block)
+{
+    LONGTAIL_FATAL_ASSERT(stored_block->m_List == 0, return)
+    stored_block->m_Prev = list->m_Last;
+    stored_block->m_Next = 0;
+    stored_block->m_List = list;
+    if (list->m_Last)
+    {
+        list->m_Last->m_Next = stored_block;
+    }
+    else
+    {
+        list->m_First = stored_block;
+    }
+    list->m_Last = stored_block;
+    ++list->m_Count;
+    list->m_Size += LRU_GetBlockSize(stored_block);
+}
+
+size_t LRU_GetSize()
+{
+    return sizeof(struct LRU);
+}
+
+struct LRU* LRU_Create(void* mem, uint32_t max_count, uint64_t max_size, int scan_resistant)
 {
     LONGTAIL_FATAL_ASSERT(mem, return 0)
     struct LRU* lru = (struct LRU*)mem;
-    lru->m_StoredBlocks = (struct LRUStoredBlock**)&lru[1];
+    LRUList_Init(&lru->m_Probation);
+    LRUList_Init(&lru->m_Protected);
     lru->m_MaxCount = max_count;
-    lru->m_AllocatedCount = 0;
+    lru->m_MaxSize = max_size;
+    lru->m_ScanResistant = scan_resistant;
     return lru;
 }
 
-struct LRUStoredBlock* LRU_Evict(struct LRU* lru)
+uint32_t LRU_GetCount(struct LRU* lru)
+{
+    LONGTAIL_FATAL_ASSERT(lru, return 0)
+    return lru->m_Probation.m_Count + lru->m_Protected.m_Count;
+}
+
+// Returns non-zero if a block of added_size bytes does not fit until something is evicted
+int LRU_IsFull(struct LRU* lru, uint64_t added_size)
 {
     LONGTAIL_FATAL_ASSERT(lru, return 0)
-    LONGTAIL_FATAL_ASSERT(lru->m_AllocatedCount > 0, return 0)
-    struct LRUStoredBlock* stored_block = lru->m_StoredBlocks[0];
-    --lru->m_AllocatedCount;
-    for(uint32_t scan = 0; scan < lru->m_AllocatedCount; ++scan)
+    uint32_t count = LRU_GetCount(lru);
+    if (count == 0)
     {
-        lru->m_StoredBlocks[scan] = lru->m_StoredBlocks[scan + 1];
+        return 0;
     }
-    return stored_block;
+    if (lru->m_MaxCount && (count + 1 > lru->m_MaxCount))
+    {
+        return 1;
+    }
+    if (lru->m_MaxSize && (lru->m_Probation.m_Size + lru->m_Protected.m_Size + added_size > lru->m_MaxSize))
+    {
+        return 1;
+    }
+    return 0;
 }
 
-struct LRUStoredBlock** LRU_Put(struct LRU* lru)
+struct LRUStoredBlock* LRU_Evict(struct LRU* lru)
 {
     LONGTAIL_FATAL_ASSERT(lru, return 0)
-    LONGTAIL_FATAL_ASSERT(lru->m_AllocatedCount != lru->m_MaxCount, return 0)
-    struct LRUStoredBlock** slot = &lru->m_StoredBlocks[lru->m_AllocatedCount];
-    ++lru->m_AllocatedCount;
-    return slot;
+    LONGTAIL_FATAL_ASSERT(LRU_GetCount(lru) > 0, return 0)
+    struct LRUList* list = lru->m_Probation.m_First ? &lru->m_Probation : &lru->m_Protected;
+    struct LRUStoredBlock* stored_block = list->m_First;
+    LRUList_Unlink(list, stored_block);
+    return stored_block;
+}
+
+void LRU_Put(struct LRU* lru, struct LRUStoredBlock* stored_block)
+{
+    LONGTAIL_FATAL_ASSERT(lru, return)
+    LRUList_PushLast(&lru->m_Probation, stored_block);
 }
 
 void LRU_Refresh(struct LRU* lru, struct LRUStoredBlock* stored_block)
 {
     LONGTAIL_FATAL_ASSERT(lru, return)
-    for (uint32_t i = 0; i < lru->m_AllocatedCount; ++i)
+    struct LRUList* list = stored_block->m_List;
+    LONGTAIL_FATAL_ASSERT(list == &lru->m_Probation || list == &lru->m_Protected, return)
+    LRUList_Unlink(list, stored_block);
+    LRUList_PushLast(list, stored_block);
+}
+
+// Called when a cached block is requested again
+void LRU_Promote(struct LRU* lru, struct LRUStoredBlock* stored_block)
+{
+    LONGTAIL_FATAL_ASSERT(lru, return)
+    if (!lru->m_ScanResistant || stored_block->m_List != &lru->m_Probation)
     {
-        if (lru->m_StoredBlocks[i] == stored_block)
-        {
-            while(++i < lru->m_AllocatedCount)
-            {
-                lru->m_StoredBlocks[i - 1] = lru->m_StoredBlocks[i];
-            }
-            lru->m_StoredBlocks[lru->m_AllocatedCount - 1] = stored_block;
-            return;
-        }
+        return;
+    }
+    LRUList_Unlink(&lru->m_Probation, stored_block);
+    LRUList_PushLast(&lru->m_Protected, stored_block);
+
+    // Keep the protected segment within three quarters of the budget, demoted blocks get another chance in probation
+    uint32_t max_protected_count = lru->m_MaxCount - lru->m_MaxCount / 4;
+    uint64_t max_protected_size = lru->m_MaxSize - lru->m_MaxSize / 4;
+    while (lru->m_Protected.m_First != stored_block &&
+        ((lru->m_MaxCount && lru->m_Protected.m_Count > max_protected_count) ||
+        (lru->m_MaxSize && lru->m_Protected.m_Size > max_protected_size)))
+    {
+        struct LRUStoredBlock* demoted_block = lru->m_Protected.m_First;
+        LRUList_Unlink(&lru->m_Protected, demoted_block);
+        LRUList_PushLast(&lru->m_Probation, demoted_block);
     }
-    LONGTAIL_FATAL_ASSERT(0, return)
 }
 
-struct LRUBlockStoreAPI;
-
-struct LRUStoredBlock {
-    struct Longtail_StoredBlock m_StoredBlock;
-    struct Longtail_StoredBlock* m_OriginalStoredBlock;
-    struct LRUBlockStoreAPI* m_LRUBlockStoreAPI;
-    TLongtail_Atomic32 m_RefCount;
-};
-
 struct BlockHashToLRUStoredBlock
 {
     TLongtail_Hash key;
@@ -167,12 +281,19 @@ struct LRUStoredBlock* CreateLRUBlock(struct LRUBlockStoreAPI* api, struct Longt
 {
     TLongtail_Hash block_hash = *original_stored_block->m_BlockIndex->m_BlockHash;
     struct LRUStoredBlock* allocated_block = (struct LRUStoredBlock*)Longtail_Alloc(sizeof(struct LRUStoredBlock));
+    if (!allocated_block)
+    {
+        return 0;
+    }
     allocated_block->m_OriginalStoredBlock = original_stored_block;
     allocated_block->m_LRUBlockStoreAPI = api;
     allocated_block->m_StoredBlock.Dispose = LRUStoredBlock_Dispose;
     allocated_block->m_StoredBlock.m_BlockChunksDataSize = original_stored_block->m_BlockChunksDataSize;
     allocated_block->m_StoredBlock.m_BlockData = original_stored_block->m_BlockData;
     allocated_block->m_StoredBlock.m_BlockIndex = original_stored_block->m_BlockIndex;
+    allocated_block->m_Prev = 0;
+    allocated_block->m_Next = 0;
+    allocated_block->m_List = 0;
     allocated_block->m_RefCount = 1;
     return allocated_block;
 }
@@ -186,7 +307,7 @@ struct LRUStoredBlock* GetLRUBlock(struct LRUBlockStoreAPI* api, TLongtail_Hash
         return 0;
     }
     struct LRUStoredBlock* stored_block = api->m_BlockHashToLRUStoredBlock[find_ptr].value;
-//    LRU_Refresh(api->m_LRU, block_index);
+    LRU_Promote(api->m_LRU, stored_block);
     LONGTAIL_FATAL_ASSERT(stored_block->m_RefCount > 0, return 0)
     Longtail_AtomicAdd32(&stored_block->m_RefCount, 1);
     return stored_block;
@@ -306,15 +427,16 @@ static void LRUBlockStore_AsyncGetStoredBlockAPI_OnComplete(struct Longtail_Asyn
     }
 
     struct Longtail_AsyncGetStoredBlockAPI** list;
-    struct Longtail_StoredBlock* dispose_block = 0;
+    struct Longtail_StoredBlock** dispose_blocks = 0;
 
     Longtail_LockSpinLock(api->m_Lock);
-    if (api->m_LRU->m_AllocatedCount == api->m_LRU->m_MaxCount)
+    while (LRU_IsFull(api->m_LRU, shared_stored_block->m_StoredBlock.m_BlockChunksDataSize))
     {
-        dispose_block = &LRU_Evict(api->m_LRU)->m_StoredBlock;
+        struct Longtail_StoredBlock* dispose_block = &LRU_Evict(api->m_LRU)->m_StoredBlock;
         hmdel(api->m_BlockHashToLRUStoredBlock, *dispose_block->m_BlockIndex->m_BlockHash);
+        arrput(dispose_blocks, dispose_block);
     }
-    *LRU_Put(api->m_LRU) = shared_stored_block;
+    LRU_Put(api->m_LRU, shared_stored_block);
     hmput(api->m_BlockHashToLRUStoredBlock, block_hash, shared_stored_block);
 
     list = hmget(api->m_BlockHashToCompleteCallbacks, block_hash);
@@ -324,10 +446,15 @@ static void LRUBlockStore_AsyncGetStoredBlockAPI_OnComplete(struct Longtail_Asyn
 
     Longtail_UnlockSpinLock(api->m_Lock);
 
-    if (dispose_block && dispose_block->Dispose)
+    size_t dispose_count = arrlen(dispose_blocks);
+    for (size_t d = 0; d < dispose_count; ++d)
     {
-        dispose_block->Dispose(dispose_block);
+        if (dispose_blocks[d]->Dispose)
+        {
+            dispose_blocks[d]->Dispose(dispose_blocks[d]);
+        }
     }
+    arrfree(dispose_blocks);
 
     Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *shared_stored_block->m_StoredBlock.m_BlockIndex->m_ChunkCount);
     Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*shared_stored_block->m_StoredBlock.m_BlockIndex->m_ChunkCount) + shared_stored_block->m_StoredBlock.m_BlockChunksDataSize);
@@ -358,6 +485,7 @@ static int LRUBlockStore_GetStoredBlock(
     if (lru_block != 0 && lru_block->m_RefCount > 0)
     {
         Longtail_UnlockSpinLock(api->m_Lock);
+        Longtail_AddMetric(Longtail_Metric_LRUBlockStore_HitCount, 1);
         Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *lru_block->m_StoredBlock.m_BlockIndex->m_ChunkCount);
         Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*lru_block->m_StoredBlock.m_BlockIndex->m_ChunkCount) + lru_block->m_StoredBlock.m_BlockChunksDataSize);
         async_complete_api->OnComplete(async_complete_api, &lru_block->m_StoredBlock, 0);
@@ -369,6 +497,8 @@ static int LRUBlockStore_GetStoredBlock(
     {
         arrput(api->m_BlockHashToCompleteCallbacks[find_wait_list_ptr].value, async_complete_api);
         Longtail_UnlockSpinLock(api->m_Lock);
+        // Waiting on a fetch already in flight does not go to the backing store either
+        Longtail_AddMetric(Longtail_Metric_LRUBlockStore_HitCount, 1);
         return 0;
     }
 
@@ -378,6 +508,7 @@ static int LRUBlockStore_GetStoredBlock(
     hmput(api->m_BlockHashToCompleteCallbacks, block_hash, wait_list);
 
     Longtail_UnlockSpinLock(api->m_Lock);
+    Longtail_AddMetric(Longtail_Metric_LRUBlockStore_MissCount, 1);
 
     size_t share_lock_store_async_get_stored_block_API_size = sizeof(struct LRUBlockStore_AsyncGetStoredBlockAPI);
     struct LRUBlockStore_AsyncGetStoredBlockAPI* share_lock_store_async_get_stored_block_API = (struct LRUBlockStore_AsyncGetStoredBlockAPI*)Longtail_Alloc(share_lock_store_async_get_stored_block_API_size);
@@ -484,7 +615,7 @@ static void LRUBlockStore_Dispose(struct Longtail_API* base_api)
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "LRUBlockStore_Dispose(%p) waiting for %d pending requests", api, (int32_t)api->m_PendingRequestCount);
         }
     }
-    while (api->m_LRU->m_AllocatedCount > 0)
+    while (LRU_GetCount(api->m_LRU) > 0)
     {
         struct Longtail_StoredBlock* lru_block = &LRU_Evict(api->m_LRU)->m_StoredBlock;
         hmdel(api->m_BlockHashToLRUStoredBlock, *lru_block->m_BlockIndex->m_BlockHash);
@@ -504,10 +635,12 @@ static int LRUBlockStore_Init(
     void* mem,
     struct Longtail_BlockStoreAPI* backing_block_store,
     uint32_t max_lru_count,
+    uint64_t max_lru_size,
+    int scan_resistant,
     struct Longtail_BlockStoreAPI** out_block_store_api)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "LRUBlockStore_Init(%p, %p, %p)",
-        mem, backing_block_store, out_block_store_api)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "LRUBlockStore_Init(%p, %p, %u, %" PRIu64 ", %d, %p)",
+        mem, backing_block_store, max_lru_count, max_lru_size, scan_resistant, out_block_store_api)
     LONGTAIL_FATAL_ASSERT(mem, return EINVAL)
     LONGTAIL_FATAL_ASSERT(backing_block_store, return EINVAL)
     LONGTAIL_FATAL_ASSERT(out_block_store_api, return EINVAL)
@@ -533,7 +666,7 @@ static int LRUBlockStore_Init(
     api->m_PendingRequestCount = 0;
     api->m_PendingAsyncFlushAPIs = 0;
 
-    api->m_LRU = LRU_Create(&api[1], max_lru_count);
+    api->m_LRU = LRU_Create(&api[1], max_lru_count, max_lru_size, scan_resistant);
 
     int err =Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &api->m_Lock);
     if (err)
@@ -555,21 +688,23 @@ static int LRUBlockStore_Init(
 
 struct Longtail_BlockStoreAPI* Longtail_CreateLRUBlockStoreAPI(
     struct Longtail_BlockStoreAPI* backing_block_store,
-    uint32_t max_lru_count)
+    uint32_t max_lru_count,
+    uint64_t max_lru_size,
+    int scan_resistant)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateLRUBlockStoreAPI(%p)", backing_block_store)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateLRUBlockStoreAPI(%p, %u, %" PRIu64 ", %d)", backing_block_store, max_lru_count, max_lru_size, scan_resistant)
     LONGTAIL_VALIDATE_INPUT(backing_block_store, return 0)
+    LONGTAIL_VALIDATE_INPUT(max_lru_count != 0 || max_lru_size != 0, return 0)
 
     size_t api_size =
         sizeof(struct LRUBlockStoreAPI) +
-        sizeof(struct LRUStoredBlock) * max_lru_count +
-        LRU_GetSize(max_lru_count);
+        LRU_GetSize();
 
     void* mem = Longtail_Alloc(api_size);
     if (!mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLRUBlockStoreAPI(%p) failed with %d",
-            backing_block_store,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLRUBlockStoreAPI(%p, %u, %" PRIu64 ", %d) failed with %d",
+            backing_block_store, max_lru_count, max_lru_size, scan_resistant,
             ENOMEM)
         return 0;
     }
@@ -578,11 +713,13 @@ struct Longtail_BlockStoreAPI* Longtail_CreateLRUBlockStoreAPI(
         mem,
         backing_block_store,
         max_lru_count,
+        max_lru_size,
+        scan_resistant,
         &block_store_api);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLRUBlockStoreAPI(%p) failed with %d",
-            backing_block_store,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLRUBlockStoreAPI(%p, %u, %" PRIu64 ", %d) failed with %d",
+            backing_block_store, max_lru_count, max_lru_size, scan_resistant,
             err)
         Longtail_Free(mem);
         return 0;
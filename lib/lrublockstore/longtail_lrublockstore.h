@@ -6,9 +6,15 @@
 extern "C" {
 #endif
 
+// Keeps recently used blocks in memory. max_lru_count limits the number of cached blocks and
+// max_lru_size limits the sum of their chunk data sizes, zero disables the respective limit.
+// With scan_resistant set, blocks must be requested twice before they are protected from
+// being evicted by blocks that are only requested once.
 LONGTAIL_EXPORT extern struct Longtail_BlockStoreAPI* Longtail_CreateLRUBlockStoreAPI(
     struct Longtail_BlockStoreAPI* backing_block_store,
-    uint32_t max_lru_count);
+    uint32_t max_lru_count,
+    uint64_t max_lru_size,
+    int scan_resistant);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,8 @@
 #include "longtail_lz4.h"
 
+#include "../../src/ext/stb_ds.h"
+#include "../longtail_platform.h"
+#define LZ4_STATIC_LINKING_ONLY
 #include "ext/lz4.h"
 
 #include <errno.h>
@@ -16,16 +19,56 @@ static int SettingsIDToCompressionSetting(uint32_t settings_id)
     return LZ4CompressionAPI_DefaultCompressionSetting;
 }
 
+// Compression states are pooled and reused with a fast reset instead of
+// clearing a fresh state for every block
 struct LZ4CompressionAPI
 {
     struct Longtail_CompressionAPI m_LZ4CompressionAPI;
+    HLongtail_SpinLock m_Lock;
+    void** m_CompressionStates;
 };
 
 void LZ4CompressionAPI_Dispose(struct Longtail_API* compression_api)
 {
+    struct LZ4CompressionAPI* api = (struct LZ4CompressionAPI*)compression_api;
+    for (ptrdiff_t i = 0; i < arrlen(api->m_CompressionStates); ++i)
+    {
+        Longtail_Free(api->m_CompressionStates[i]);
+    }
+    arrfree(api->m_CompressionStates);
+    Longtail_DeleteSpinLock(api->m_Lock);
+    Longtail_Free(api->m_Lock);
     Longtail_Free(compression_api);
 }
 
+static void* LZ4CompressionAPI_AcquireState(struct LZ4CompressionAPI* api)
+{
+    void* state = 0;
+    Longtail_LockSpinLock(api->m_Lock);
+    if (arrlen(api->m_CompressionStates) > 0)
+    {
+        state = arrpop(api->m_CompressionStates);
+    }
+    Longtail_UnlockSpinLock(api->m_Lock);
+    if (state)
+    {
+        return state;
+    }
+    state = Longtail_Alloc((size_t)LZ4_sizeofState());
+    if (!state)
+    {
+        return 0;
+    }
+    return LZ4_initStream(state, (size_t)LZ4_sizeofState());
+}
+
+static void LZ4CompressionAPI_ReleaseState(struct LZ4CompressionAPI* api, void* state)
+{
+    Longtail_LockSpinLock(api->m_Lock);
+    arrput(api->m_CompressionStates, state);
+    Longtail_UnlockSpinLock(api->m_Lock);
+}
+
 static size_t LZ4CompressionAPI_GetMaxCompressedSize(struct Longtail_CompressionAPI* compression_api, uint32_t settings_id, size_t size)
 {
     return (size_t)LZ4_COMPRESSBOUND((unsigned)size);
@@ -33,8 +76,15 @@ static size_t LZ4CompressionAPI_GetMaxCompressedSize(struct Longtail_Compression
 
 int LZ4CompressionAPI_Compress(struct Longtail_CompressionAPI* compression_api, uint32_t settings_id, const char* uncompressed, char* compressed, size_t uncompressed_size, size_t max_compressed_size, size_t* out_compressed_size)
 {
+    struct LZ4CompressionAPI* api = (struct LZ4CompressionAPI*)compression_api;
     int compression_setting = SettingsIDToCompressionSetting(settings_id);
-    int compressed_size = LZ4_compress_fast(uncompressed, compressed, (int)uncompressed_size, (int)max_compressed_size, compression_setting);
+    void* state = LZ4CompressionAPI_AcquireState(api);
+    if (!state)
+    {
+        return ENOMEM;
+    }
+    int compressed_size = LZ4_compress_fast_extState_fastReset(state, uncompressed, compressed, (int)uncompressed_size, (int)max_compressed_size, compression_setting);
+    LZ4CompressionAPI_ReleaseState(api, state);
     if (compressed_size == 0)
     {
         return ENOMEM;
@@ -54,17 +104,32 @@ static int LZ4CompressionAPI_Decompress(struct Longtail_CompressionAPI* compress
     return 0;
 }
 
-static void LZ4CompressionAPI_Init(struct LZ4CompressionAPI* compression_api)
+static int LZ4CompressionAPI_Init(struct LZ4CompressionAPI* compression_api)
 {
     compression_api->m_LZ4CompressionAPI.m_API.Dispose = LZ4CompressionAPI_Dispose;
     compression_api->m_LZ4CompressionAPI.GetMaxCompressedSize = LZ4CompressionAPI_GetMaxCompressedSize;
     compression_api->m_LZ4CompressionAPI.Compress = LZ4CompressionAPI_Compress;
     compression_api->m_LZ4CompressionAPI.Decompress = LZ4CompressionAPI_Decompress;
+    compression_api->m_CompressionStates = 0;
+    return Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &compression_api->m_Lock);
 }
 
 struct Longtail_CompressionAPI* Longtail_CreateLZ4CompressionAPI()
 {
     struct LZ4CompressionAPI* compression_api = (struct LZ4CompressionAPI*)Longtail_Alloc(sizeof(struct LZ4CompressionAPI));
-    LZ4CompressionAPI_Init(compression_api);
+    if (!compression_api)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLZ4CompressionAPI() failed with %d",
+            ENOMEM)
+        return 0;
+    }
+    int err = LZ4CompressionAPI_Init(compression_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateLZ4CompressionAPI() failed with %d",
+            err)
+        Longtail_Free(compression_api);
+        return 0;
+    }
     return &compression_api->m_LZ4CompressionAPI;
 }
@@ -40,6 +40,8 @@ struct PathEntry
     uint16_t m_Permissions;
     uint8_t m_IsOpenWrite;
     uint32_t m_IsOpenRead;
+    uint64_t m_ModificationTime;
+    uint64_t m_ChangeTime;
 };
 
 struct Lookup
@@ -54,6 +56,8 @@ struct InMemStorageAPI
     struct Lookup* m_PathHashToContent;
     struct PathEntry* m_PathEntries;
     HLongtail_SpinLock m_SpinLock;
+    // There is no clock, modification and change times are taken from a counter bumped on every change
+    uint64_t m_ChangeStamp;
 };
 
 static void InMemStorageAPI_Dispose(struct Longtail_API* storage_api)
@@ -277,6 +281,7 @@ static int InMemStorageAPI_OpenWriteFile(struct Longtail_StorageAPI* storage_api
     }
     arrsetcap(path_entry->m_Content, initial_size == 0 ? 16 : (uint32_t)initial_size);
     arrsetlen(path_entry->m_Content, (uint32_t)initial_size);
+    path_entry->m_ModificationTime = path_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     Longtail_UnlockSpinLock(instance->m_SpinLock);
     *out_open_file = (Longtail_StorageAPI_HOpenFile)(uintptr_t)path_hash;
     return 0;
@@ -316,6 +321,7 @@ static int InMemStorageAPI_Write(struct Longtail_StorageAPI* storage_api, Longta
     arrsetcap(path_entry->m_Content, size == 0 ? 16 : (uint32_t)size);
     arrsetlen(path_entry->m_Content, (uint32_t)size);
     memcpy(&(path_entry->m_Content)[offset], input, length);
+    path_entry->m_ModificationTime = path_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     Longtail_UnlockSpinLock(instance->m_SpinLock);
     return 0;
 }
@@ -338,6 +344,7 @@ static int InMemStorageAPI_SetSize(struct Longtail_StorageAPI* storage_api, Long
     }
     struct PathEntry* path_entry = &instance->m_PathEntries[instance->m_PathHashToContent[it].value];
     arrsetlen(path_entry->m_Content, (uint32_t)length);
+    path_entry->m_ModificationTime = path_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     Longtail_UnlockSpinLock(instance->m_SpinLock);
     return 0;
 }
@@ -360,6 +367,7 @@ static int InMemStorageAPI_SetPermissions(struct Longtail_StorageAPI* storage_ap
     }
     struct PathEntry* path_entry = &instance->m_PathEntries[instance->m_PathHashToContent[it].value];
     path_entry->m_Permissions = permissions;
+    path_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     Longtail_UnlockSpinLock(instance->m_SpinLock);
     return 0;
 }
@@ -462,6 +470,7 @@ static int InMemStorageAPI_CreateDir(struct Longtail_StorageAPI* storage_api, co
     path_entry->m_FileName = Longtail_Strdup(InMemStorageAPI_GetFileNamePart(path));
     path_entry->m_Content = 0;
     path_entry->m_Permissions = 0775;
+    path_entry->m_ModificationTime = path_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     hmput(instance->m_PathHashToContent, path_hash, (uint32_t)entry_index);
     Longtail_UnlockSpinLock(instance->m_SpinLock);
     return 0;
@@ -500,6 +509,7 @@ static int InMemStorageAPI_RenameFile(struct Longtail_StorageAPI* storage_api, c
     source_entry->m_ParentHash = target_parent_path_hash;
     Longtail_Free(source_entry->m_FileName);
     source_entry->m_FileName = Longtail_Strdup(InMemStorageAPI_GetFileNamePart(target_path));
+    source_entry->m_ChangeTime = ++instance->m_ChangeStamp;
     hmput(instance->m_PathHashToContent, target_path_hash, instance->m_PathHashToContent[source_path_ptr].value);
     hmdel(instance->m_PathHashToContent, source_path_hash);
     Longtail_UnlockSpinLock(instance->m_SpinLock);
@@ -752,6 +762,9 @@ static int InMemStorageAPI_GetEntryProperties(struct Longtail_StorageAPI* storag
     }
     out_properties->m_Permissions = instance->m_PathEntries[*i].m_Permissions;
     out_properties->m_Name = instance->m_PathEntries[*i].m_FileName;
+    out_properties->m_ModificationTime = instance->m_PathEntries[*i].m_ModificationTime;
+    out_properties->m_ChangeTime = instance->m_PathEntries[*i].m_ChangeTime;
+    out_properties->m_FileId = (uint64_t)*i + 1;
     return 0;
 }
 
@@ -852,6 +865,53 @@ static int InMemStorageAPI_UnlockFile(struct Longtail_StorageAPI* storage_api, L
     return 0;
 }
 
+// The view points straight at the file content which can't change while the file is open for read
+static int InMemStorageAPI_MapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(f != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(out_file_map != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(out_data_ptr != 0, return EINVAL);
+    struct InMemStorageAPI* instance = (struct InMemStorageAPI*)storage_api;
+    Longtail_LockSpinLock(instance->m_SpinLock);
+    uint32_t path_hash = (uint32_t)(uintptr_t)f;
+    intptr_t it = hmgeti(instance->m_PathHashToContent, path_hash);
+    if (it == -1) {
+        Longtail_UnlockSpinLock(instance->m_SpinLock);
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "InMemStorageAPI_MapFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            storage_api, f, offset, length, out_file_map, out_data_ptr,
+            EINVAL)
+        return EINVAL;
+    }
+    struct PathEntry* path_entry = (struct PathEntry*)&instance->m_PathEntries[instance->m_PathHashToContent[it].value];
+    if (path_entry->m_IsOpenRead == 0 || (ptrdiff_t)(offset + length) > arrlen(path_entry->m_Content))
+    {
+        Longtail_UnlockSpinLock(instance->m_SpinLock);
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "InMemStorageAPI_MapFile(%p, %p, %" PRIu64 ", %" PRIu64 ", %p, %p) failed with %d",
+            storage_api, f, offset, length, out_file_map, out_data_ptr,
+            EIO)
+        return EIO;
+    }
+    const void* content_ptr = &path_entry->m_Content[offset];
+    Longtail_UnlockSpinLock(instance->m_SpinLock);
+    *out_file_map = (Longtail_StorageAPI_HFileMap)f;
+    *out_data_ptr = content_ptr;
+    return 0;
+}
+
+static void InMemStorageAPI_UnmapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return);
+    LONGTAIL_VALIDATE_INPUT(file_map != 0, return);
+}
+
+static int InMemStorageAPI_AdviseSequentialRead(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f)
+{
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL);
+    LONGTAIL_VALIDATE_INPUT(f != 0, return EINVAL);
+    return 0;
+}
+
 static int InMemStorageAPI_Init(
     void* mem,
     struct Longtail_StorageAPI** out_storage_api)
@@ -881,12 +941,16 @@ static int InMemStorageAPI_Init(
         InMemStorageAPI_CloseFind,
         InMemStorageAPI_GetEntryProperties,
         InMemStorageAPI_LockFile,
-        InMemStorageAPI_UnlockFile);
+        InMemStorageAPI_UnlockFile,
+        InMemStorageAPI_MapFile,
+        InMemStorageAPI_UnmapFile,
+        InMemStorageAPI_AdviseSequentialRead);
 
     struct InMemStorageAPI* storage_api = (struct InMemStorageAPI*)api;
 
     storage_api->m_PathHashToContent = 0;
     storage_api->m_PathEntries = 0;
+    storage_api->m_ChangeStamp = 0;
     int err = Longtail_CreateSpinLock(&storage_api[1], &storage_api->m_SpinLock);
     if (err)
     {
@@ -0,0 +1,270 @@
+#include "longtail_metrics.h"
+
+#include "../longtail_platform.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Bucket 0 holds zero, bucket n holds values in [2^(n-1), 2^n - 1]
+#define METRICS_BUCKET_COUNT    65
+
+struct MetricsAPI
+{
+    struct Longtail_MetricsAPI m_MetricsAPI;
+    TLongtail_Atomic64 m_Values[Longtail_Metric_Count];
+    TLongtail_Atomic64 m_Counts[Longtail_Metric_Count];
+    TLongtail_Atomic64 m_Buckets[Longtail_Metric_Count][METRICS_BUCKET_COUNT];
+};
+
+static uint32_t GetBucketIndex(uint64_t value)
+{
+    uint32_t index = 0;
+    while (value)
+    {
+        ++index;
+        value >>= 1;
+    }
+    return index;
+}
+
+static uint64_t GetBucketUpperBound(uint32_t bucket_index)
+{
+    return bucket_index == 64 ? 0xffffffffffffffffull : (1ull << bucket_index) - 1;
+}
+
+static void MetricsAPI_Add(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value)
+{
+    LONGTAIL_FATAL_ASSERT(metrics_api, return)
+    LONGTAIL_FATAL_ASSERT(metric < Longtail_Metric_Count, return)
+    struct MetricsAPI* api = (struct MetricsAPI*)metrics_api;
+    Longtail_AtomicAdd64(&api->m_Values[metric], (int64_t)value);
+}
+
+static void MetricsAPI_Observe(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value)
+{
+    LONGTAIL_FATAL_ASSERT(metrics_api, return)
+    LONGTAIL_FATAL_ASSERT(metric < Longtail_Metric_Count, return)
+    struct MetricsAPI* api = (struct MetricsAPI*)metrics_api;
+    Longtail_AtomicAdd64(&api->m_Values[metric], (int64_t)value);
+    Longtail_AtomicAdd64(&api->m_Counts[metric], 1);
+    Longtail_AtomicAdd64(&api->m_Buckets[metric][GetBucketIndex(value)], 1);
+}
+
+static uint64_t MetricsAPI_GetTime(struct Longtail_MetricsAPI* metrics_api)
+{
+    return Longtail_GetTimeNs();
+}
+
+static void MetricsAPI_Dispose(struct Longtail_API* metrics_api)
+{
+    LONGTAIL_VALIDATE_INPUT(metrics_api, return)
+    Longtail_Free(metrics_api);
+}
+
+struct Longtail_MetricsAPI* Longtail_CreateMetricsAPI()
+{
+    struct MetricsAPI* api = (struct MetricsAPI*)Longtail_Alloc(sizeof(struct MetricsAPI));
+    if (!api)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateMetricsAPI() failed with %d",
+            ENOMEM)
+        return 0;
+    }
+    memset(api, 0, sizeof(struct MetricsAPI));
+    return Longtail_MakeMetricsAPI(
+        api,
+        MetricsAPI_Dispose,
+        MetricsAPI_Add,
+        MetricsAPI_Observe,
+        MetricsAPI_GetTime);
+}
+
+struct MetricsText
+{
+    char* m_Data;
+    size_t m_Size;
+    size_t m_Capacity;
+    int m_Err;
+};
+
+// Grows the buffer if the text does not fit, on failure m_Err is set and the text is left as it was
+static void AppendText(struct MetricsText* text, const char* fmt, ...)
+{
+    if (text->m_Err)
+    {
+        return;
+    }
+    va_list argptr;
+    va_start(argptr, fmt);
+    va_list retry_argptr;
+    va_copy(retry_argptr, argptr);
+    int length = vsnprintf(&text->m_Data[text->m_Size], text->m_Capacity - text->m_Size, fmt, argptr);
+    va_end(argptr);
+    if (length > 0 && (size_t)length >= text->m_Capacity - text->m_Size)
+    {
+        size_t new_capacity = text->m_Capacity * 2;
+        if (new_capacity < text->m_Size + (size_t)length + 1)
+        {
+            new_capacity = text->m_Size + (size_t)length + 1;
+        }
+        char* new_data = (char*)Longtail_Alloc(new_capacity);
+        if (!new_data)
+        {
+            text->m_Data[text->m_Size] = 0;
+            text->m_Err = ENOMEM;
+            va_end(retry_argptr);
+            return;
+        }
+        memcpy(new_data, text->m_Data, text->m_Size);
+        Longtail_Free(text->m_Data);
+        text->m_Data = new_data;
+        text->m_Capacity = new_capacity;
+        length = vsnprintf(&text->m_Data[text->m_Size], text->m_Capacity - text->m_Size, fmt, retry_argptr);
+    }
+    va_end(retry_argptr);
+    if (length > 0)
+    {
+        text->m_Size += (size_t)length;
+    }
+}
+
+static int InitText(struct MetricsText* text)
+{
+    // Large enough for every bucket of every metric, AppendText grows it if it is not
+    text->m_Capacity = 256 + Longtail_Metric_Count * (256 + METRICS_BUCKET_COUNT * 128);
+    text->m_Data = (char*)Longtail_Alloc(text->m_Capacity);
+    if (!text->m_Data)
+    {
+        return ENOMEM;
+    }
+    text->m_Data[0] = 0;
+    text->m_Size = 0;
+    text->m_Err = 0;
+    return 0;
+}
+
+// Highest bucket with any observations, plus one
+static uint32_t GetUsedBucketCount(const struct MetricsAPI* api, uint32_t metric)
+{
+    uint32_t used_count = 0;
+    for (uint32_t b = 0; b < METRICS_BUCKET_COUNT; ++b)
+    {
+        if (api->m_Buckets[metric][b])
+        {
+            used_count = b + 1;
+        }
+    }
+    return used_count;
+}
+
+int Longtail_Metrics_FormatJSON(struct Longtail_MetricsAPI* metrics_api, char** out_text)
+{
+    LONGTAIL_VALIDATE_INPUT(metrics_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_text, return EINVAL)
+    struct MetricsAPI* api = (struct MetricsAPI*)metrics_api;
+
+    struct MetricsText text;
+    int err = InitText(&text);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_Metrics_FormatJSON(%p, %p) failed with %d",
+            metrics_api, out_text,
+            err)
+        return err;
+    }
+
+    AppendText(&text, "{\n  \"metrics\": [\n");
+    for (uint32_t m = 0; m < Longtail_Metric_Count; ++m)
+    {
+        const char* separator = (m + 1 < Longtail_Metric_Count) ? "," : "";
+        int kind = Longtail_GetMetricKind(m);
+        if (kind == LONGTAIL_METRIC_KIND_COUNTER)
+        {
+            AppendText(&text, "    {\"name\": \"%s\", \"type\": \"counter\", \"value\": %" PRIu64 "}%s\n",
+                Longtail_GetMetricName(m), (uint64_t)api->m_Values[m], separator);
+            continue;
+        }
+        AppendText(&text, "    {\"name\": \"%s\", \"type\": \"%s\", \"unit\": \"%s\", \"count\": %" PRIu64 ", \"sum\": %" PRIu64 ", \"buckets\": [",
+            Longtail_GetMetricName(m),
+            kind == LONGTAIL_METRIC_KIND_TIMER ? "timer" : "histogram",
+            kind == LONGTAIL_METRIC_KIND_TIMER ? "ns" : "",
+            (uint64_t)api->m_Counts[m],
+            (uint64_t)api->m_Values[m]);
+        uint32_t used_bucket_count = GetUsedBucketCount(api, m);
+        for (uint32_t b = 0; b < used_bucket_count; ++b)
+        {
+            AppendText(&text, "%s{\"le\": %" PRIu64 ", \"count\": %" PRIu64 "}",
+                b ? ", " : "", GetBucketUpperBound(b), (uint64_t)api->m_Buckets[m][b]);
+        }
+        AppendText(&text, "]}%s\n", separator);
+    }
+    AppendText(&text, "  ]\n}\n");
+    if (text.m_Err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_Metrics_FormatJSON(%p, %p) failed with %d",
+            metrics_api, out_text,
+            text.m_Err)
+        Longtail_Free(text.m_Data);
+        return text.m_Err;
+    }
+
+    *out_text = text.m_Data;
+    return 0;
+}
+
+int Longtail_Metrics_FormatPrometheus(struct Longtail_MetricsAPI* metrics_api, char** out_text)
+{
+    LONGTAIL_VALIDATE_INPUT(metrics_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_text, return EINVAL)
+    struct MetricsAPI* api = (struct MetricsAPI*)metrics_api;
+
+    struct MetricsText text;
+    int err = InitText(&text);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_Metrics_FormatPrometheus(%p, %p) failed with %d",
+            metrics_api, out_text,
+            err)
+        return err;
+    }
+
+    for (uint32_t m = 0; m < Longtail_Metric_Count; ++m)
+    {
+        const char* name = Longtail_GetMetricName(m);
+        int kind = Longtail_GetMetricKind(m);
+        if (kind == LONGTAIL_METRIC_KIND_COUNTER)
+        {
+            AppendText(&text, "# TYPE longtail_%s_total counter\nlongtail_%s_total %" PRIu64 "\n",
+                name, name, (uint64_t)api->m_Values[m]);
+            continue;
+        }
+        // Prometheus expects durations in seconds and cumulative buckets
+        const char* suffix = kind == LONGTAIL_METRIC_KIND_TIMER ? "_seconds" : "";
+        double scale = kind == LONGTAIL_METRIC_KIND_TIMER ? 1e-9 : 1.0;
+        AppendText(&text, "# TYPE longtail_%s%s histogram\n", name, suffix);
+        uint64_t cumulative_count = 0;
+        uint32_t used_bucket_count = GetUsedBucketCount(api, m);
+        for (uint32_t b = 0; b < used_bucket_count && b < 64; ++b)
+        {
+            cumulative_count += (uint64_t)api->m_Buckets[m][b];
+            AppendText(&text, "longtail_%s%s_bucket{le=\"%.9g\"} %" PRIu64 "\n",
+                name, suffix, (double)GetBucketUpperBound(b) * scale, cumulative_count);
+        }
+        AppendText(&text, "longtail_%s%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, suffix, (uint64_t)api->m_Counts[m]);
+        AppendText(&text, "longtail_%s%s_sum %.9g\n", name, suffix, (double)(uint64_t)api->m_Values[m] * scale);
+        AppendText(&text, "longtail_%s%s_count %" PRIu64 "\n", name, suffix, (uint64_t)api->m_Counts[m]);
+    }
+    if (text.m_Err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_Metrics_FormatPrometheus(%p, %p) failed with %d",
+            metrics_api, out_text,
+            text.m_Err)
+        Longtail_Free(text.m_Data);
+        return text.m_Err;
+    }
+
+    *out_text = text.m_Data;
+    return 0;
+}
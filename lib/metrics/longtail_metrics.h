@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../../src/longtail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Metrics sink that aggregates counters and log2 bucketed histograms in memory, safe to report into from any thread
+LONGTAIL_EXPORT extern struct Longtail_MetricsAPI* Longtail_CreateMetricsAPI();
+
+// Formats the metrics aggregated by a sink created with Longtail_CreateMetricsAPI(), free *out_text with Longtail_Free()
+LONGTAIL_EXPORT extern int Longtail_Metrics_FormatJSON(struct Longtail_MetricsAPI* metrics_api, char** out_text);
+LONGTAIL_EXPORT extern int Longtail_Metrics_FormatPrometheus(struct Longtail_MetricsAPI* metrics_api, char** out_text);
+
+#ifdef __cplusplus
+}
+#endif
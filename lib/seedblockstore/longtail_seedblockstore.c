@@ -0,0 +1,1040 @@
+#include "longtail_seedblockstore.h"
+
+#include "../../src/ext/stb_ds.h"
+#include "../longtail_platform.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+// Files are moved to the stash only after the journal listing them is in place, the journal is
+// written under a temporary name and renamed so it is never partially written
+#define SEED_STASH_FOLDER_NAME ".longtail_seed"
+#define SEED_STASH_JOURNAL_NAME "stash.journal"
+#define SEED_STASH_JOURNAL_TMP_NAME "stash.journal.tmp"
+#define SEED_STASH_NAME_LENGTH 16
+
+#define SEED_ASSET_STATE_IN_PLACE           0
+#define SEED_ASSET_STATE_STASHED_REMOVED    1
+#define SEED_ASSET_STATE_STASHED_MODIFIED   2
+#define SEED_ASSET_STATE_UNUSABLE           3
+
+struct SeedChunkLocation
+{
+    uint64_t m_Offset;
+    uint32_t m_AssetIndex;
+    uint32_t m_ChunkIndex;
+};
+
+struct ChunkHashToSeedChunkLocation
+{
+    TLongtail_Hash key;
+    struct SeedChunkLocation value;
+};
+
+struct BlockHashToSeedChunkHashes
+{
+    TLongtail_Hash key;
+    TLongtail_Hash* value;
+};
+
+struct SeedBlockStoreAPI
+{
+    struct Longtail_BlockStoreAPI m_BlockStoreAPI;
+    struct Longtail_BlockStoreAPI* m_BackingBlockStore;
+    struct Longtail_StorageAPI* m_StorageAPI;
+    struct Longtail_HashAPI* m_HashAPI;
+    const struct Longtail_VersionIndex* m_SeedVersionIndex;
+    char* m_SeedPath;
+    char* m_StashPath;
+
+    uint8_t* m_AssetStates;
+    uint32_t* m_StashedAssetIndexes;
+    struct ChunkHashToSeedChunkLocation* m_ChunkHashToSeedChunkLocation;
+
+    HLongtail_SpinLock m_Lock;
+    struct BlockHashToSeedChunkHashes* m_BlockHashToSeedChunkHashes;
+
+    TLongtail_Atomic64 m_StatU64[Longtail_BlockStoreAPI_StatU64_Count];
+};
+
+static void SeedBlockStore_FreeBlockHashToSeedChunkHashes(struct BlockHashToSeedChunkHashes* block_hash_to_seed_chunk_hashes)
+{
+    size_t block_count = hmlen(block_hash_to_seed_chunk_hashes);
+    for (size_t b = 0; b < block_count; ++b)
+    {
+        arrfree(block_hash_to_seed_chunk_hashes[b].value);
+    }
+    hmfree(block_hash_to_seed_chunk_hashes);
+}
+
+static void SeedBlockStore_GetStashName(TLongtail_Hash path_hash, char* out_name)
+{
+    static const char HashLUT[] = "0123456789abcdef";
+    for (uint32_t n = 0; n < SEED_STASH_NAME_LENGTH; ++n)
+    {
+        out_name[n] = HashLUT[(path_hash >> (60 - n * 4)) & 0xf];
+    }
+}
+
+static char* SeedBlockStore_GetStashedAssetPath(struct SeedBlockStoreAPI* api, uint32_t asset_index)
+{
+    char file_name[SEED_STASH_NAME_LENGTH + 1];
+    SeedBlockStore_GetStashName(api->m_SeedVersionIndex->m_PathHashes[asset_index], file_name);
+    file_name[SEED_STASH_NAME_LENGTH] = '\0';
+    return api->m_StorageAPI->ConcatPath(api->m_StorageAPI, api->m_StashPath, file_name);
+}
+
+static char* SeedBlockStore_GetAssetPath(struct SeedBlockStoreAPI* api, uint32_t asset_index)
+{
+    const struct Longtail_VersionIndex* version_index = api->m_SeedVersionIndex;
+    const char* asset_path = &version_index->m_NameData[version_index->m_NameOffsets[asset_index]];
+    return api->m_StorageAPI->ConcatPath(api->m_StorageAPI, api->m_SeedPath, asset_path);
+}
+
+static char* SeedBlockStore_GetAssetReadPath(struct SeedBlockStoreAPI* api, uint32_t asset_index)
+{
+    if (api->m_AssetStates[asset_index] == SEED_ASSET_STATE_IN_PLACE)
+    {
+        return SeedBlockStore_GetAssetPath(api, asset_index);
+    }
+    return SeedBlockStore_GetStashedAssetPath(api, asset_index);
+}
+
+static int SeedBlockStore_IsDirPath(const char* path)
+{
+    size_t length = strlen(path);
+    return length > 0 && path[length - 1] == '/';
+}
+
+static int SeedBlockStore_ReadBlock(
+    struct SeedBlockStoreAPI* api,
+    TLongtail_Hash block_hash,
+    uint32_t chunk_count,
+    TLongtail_Hash* chunk_hashes,
+    struct Longtail_StoredBlock** out_stored_block)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_ReadBlock(%p, 0x%" PRIx64 ", %u, %p, %p)",
+        api, block_hash, chunk_count, chunk_hashes, out_stored_block)
+    LONGTAIL_FATAL_ASSERT(api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_count > 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_hashes, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_stored_block, return EINVAL)
+
+    const struct Longtail_VersionIndex* version_index = api->m_SeedVersionIndex;
+
+    struct SeedChunkLocation* chunk_locations = (struct SeedChunkLocation*)Longtail_Alloc(sizeof(struct SeedChunkLocation) * chunk_count + sizeof(uint32_t) * chunk_count);
+    if (!chunk_locations)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_ReadBlock(%p, 0x%" PRIx64 ", %u, %p, %p) failed with %d",
+            api, block_hash, chunk_count, chunk_hashes, out_stored_block,
+            ENOMEM)
+        return ENOMEM;
+    }
+    uint32_t* chunk_sizes = (uint32_t*)&chunk_locations[chunk_count];
+
+    uint64_t block_data_size = 0;
+    for (uint32_t c = 0; c < chunk_count; ++c)
+    {
+        intptr_t chunk_location_ptr = hmgeti(api->m_ChunkHashToSeedChunkLocation, chunk_hashes[c]);
+        if (chunk_location_ptr == -1)
+        {
+            Longtail_Free(chunk_locations);
+            return ENOENT;
+        }
+        chunk_locations[c] = api->m_ChunkHashToSeedChunkLocation[chunk_location_ptr].value;
+        chunk_sizes[c] = version_index->m_ChunkSizes[chunk_locations[c].m_ChunkIndex];
+        block_data_size += chunk_sizes[c];
+    }
+    if (block_data_size > 0xffffffffu)
+    {
+        Longtail_Free(chunk_locations);
+        return EINVAL;
+    }
+
+    uint32_t tag = version_index->m_ChunkTags[chunk_locations[0].m_ChunkIndex];
+    struct Longtail_StoredBlock* stored_block;
+    int err = Longtail_CreateStoredBlock(
+        block_hash,
+        *version_index->m_HashIdentifier,
+        chunk_count,
+        tag,
+        chunk_hashes,
+        chunk_sizes,
+        (uint32_t)block_data_size,
+        &stored_block);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_ReadBlock(%p, 0x%" PRIx64 ", %u, %p, %p) failed with %d",
+            api, block_hash, chunk_count, chunk_hashes, out_stored_block,
+            err)
+        Longtail_Free(chunk_locations);
+        return err;
+    }
+
+    // Read runs of chunks that are stored back-to-back in the same asset with a single read
+    uint8_t* block_data = (uint8_t*)stored_block->m_BlockData;
+    uint64_t block_data_offset = 0;
+    uint32_t open_asset_index = 0xffffffffu;
+    Longtail_StorageAPI_HOpenFile open_file = 0;
+    uint32_t c = 0;
+    while (c < chunk_count)
+    {
+        const struct SeedChunkLocation* location = &chunk_locations[c];
+        uint64_t run_size = chunk_sizes[c];
+        uint32_t run_end = c + 1;
+        while (run_end < chunk_count &&
+            chunk_locations[run_end].m_AssetIndex == location->m_AssetIndex &&
+            chunk_locations[run_end].m_Offset == location->m_Offset + run_size)
+        {
+            run_size += chunk_sizes[run_end];
+            ++run_end;
+        }
+        if (location->m_AssetIndex != open_asset_index)
+        {
+            if (open_file)
+            {
+                api->m_StorageAPI->CloseFile(api->m_StorageAPI, open_file);
+                open_file = 0;
+            }
+            char* asset_path = SeedBlockStore_GetAssetReadPath(api, location->m_AssetIndex);
+            err = api->m_StorageAPI->OpenReadFile(api->m_StorageAPI, asset_path, &open_file);
+            Longtail_Free(asset_path);
+            if (err)
+            {
+                open_file = 0;
+                break;
+            }
+            open_asset_index = location->m_AssetIndex;
+        }
+        err = api->m_StorageAPI->Read(api->m_StorageAPI, open_file, location->m_Offset, run_size, &block_data[block_data_offset]);
+        if (err)
+        {
+            break;
+        }
+        block_data_offset += run_size;
+        c = run_end;
+    }
+    if (open_file)
+    {
+        api->m_StorageAPI->CloseFile(api->m_StorageAPI, open_file);
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "SeedBlockStore_ReadBlock(%p, 0x%" PRIx64 ", %u, %p, %p) failed with %d",
+            api, block_hash, chunk_count, chunk_hashes, out_stored_block,
+            err)
+        stored_block->Dispose(stored_block);
+        Longtail_Free(chunk_locations);
+        return err;
+    }
+
+    // The local files may have been changed since the seed version index was created, verify everything we read
+    block_data_offset = 0;
+    for (c = 0; c < chunk_count; ++c)
+    {
+        uint64_t chunk_hash;
+        err = api->m_HashAPI->HashBuffer(api->m_HashAPI, chunk_sizes[c], &block_data[block_data_offset], &chunk_hash);
+        if (err || chunk_hash != chunk_hashes[c])
+        {
+            err = err ? err : EBADF;
+            break;
+        }
+        block_data_offset += chunk_sizes[c];
+    }
+    if (!err)
+    {
+        uint64_t verify_block_hash;
+        err = api->m_HashAPI->HashBuffer(api->m_HashAPI, (uint32_t)(sizeof(TLongtail_Hash) * chunk_count), chunk_hashes, &verify_block_hash);
+        if (!err && verify_block_hash != block_hash)
+        {
+            err = EBADF;
+        }
+    }
+    Longtail_Free(chunk_locations);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_ReadBlock(%p, 0x%" PRIx64 ", %u, %p, %p) failed with %d",
+            api, block_hash, chunk_count, chunk_hashes, out_stored_block,
+            err)
+        stored_block->Dispose(stored_block);
+        return err;
+    }
+    *out_stored_block = stored_block;
+    return 0;
+}
+
+static int SeedBlockStore_PutStoredBlock(
+    struct Longtail_BlockStoreAPI* block_store_api,
+    struct Longtail_StoredBlock* stored_block,
+    struct Longtail_AsyncPutStoredBlockAPI* async_complete_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_PutStoredBlock(%p, %p, %p)", block_store_api, stored_block, async_complete_api)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(stored_block, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api->OnComplete, return EINVAL)
+
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_Count], 1);
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_Chunk_Count], *stored_block->m_BlockIndex->m_ChunkCount);
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*stored_block->m_BlockIndex->m_ChunkCount) + stored_block->m_BlockChunksDataSize);
+
+    int err = api->m_BackingBlockStore->PutStoredBlock(
+        api->m_BackingBlockStore,
+        stored_block,
+        async_complete_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_PutStoredBlock(%p, %p, %p) failed with %d",
+            block_store_api, stored_block, async_complete_api,
+            err)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PutStoredBlock_FailCount], 1);
+    }
+    return err;
+}
+
+static int SeedBlockStore_PreflightGet(struct Longtail_BlockStoreAPI* block_store_api, const struct Longtail_ContentIndex* content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_PreflightGet(%p, %p)", block_store_api, content_index)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(content_index, return EINVAL)
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PreflightGet_Count], 1);
+
+    const struct Longtail_VersionIndex* version_index = api->m_SeedVersionIndex;
+    uint64_t block_count = *content_index->m_BlockCount;
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+
+    size_t block_states_size = sizeof(TLongtail_Hash*) * block_count + sizeof(uint32_t) * block_count + sizeof(uint8_t) * block_count;
+    void* block_states_mem = Longtail_Alloc(block_states_size == 0 ? 1 : block_states_size);
+    if (!block_states_mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_PreflightGet(%p, %p) failed with %d",
+            block_store_api, content_index,
+            ENOMEM)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PreflightGet_FailCount], 1);
+        return ENOMEM;
+    }
+    memset(block_states_mem, 0, block_states_size);
+    TLongtail_Hash** block_chunk_hashes = (TLongtail_Hash**)block_states_mem;
+    uint32_t* block_tags = (uint32_t*)&block_chunk_hashes[block_count];
+    uint8_t* block_is_remote = (uint8_t*)&block_tags[block_count];
+
+    // A block can only be seeded if we have every chunk in it locally and they all agree on the tag
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        uint64_t block_index = content_index->m_ChunkBlockIndexes[c];
+        if (block_is_remote[block_index])
+        {
+            continue;
+        }
+        TLongtail_Hash chunk_hash = content_index->m_ChunkHashes[c];
+        intptr_t chunk_location_ptr = hmgeti(api->m_ChunkHashToSeedChunkLocation, chunk_hash);
+        if (chunk_location_ptr == -1)
+        {
+            block_is_remote[block_index] = 1;
+            continue;
+        }
+        uint32_t chunk_tag = version_index->m_ChunkTags[api->m_ChunkHashToSeedChunkLocation[chunk_location_ptr].value.m_ChunkIndex];
+        if (arrlen(block_chunk_hashes[block_index]) == 0)
+        {
+            block_tags[block_index] = chunk_tag;
+        }
+        else if (block_tags[block_index] != chunk_tag)
+        {
+            block_is_remote[block_index] = 1;
+            continue;
+        }
+        arrput(block_chunk_hashes[block_index], chunk_hash);
+    }
+
+    struct BlockHashToSeedChunkHashes* block_hash_to_seed_chunk_hashes = 0;
+    uint64_t remote_block_count = 0;
+    uint64_t remote_chunk_count = 0;
+    for (uint64_t b = 0; b < block_count; ++b)
+    {
+        if (block_is_remote[b] || block_chunk_hashes[b] == 0)
+        {
+            arrfree(block_chunk_hashes[b]);
+            block_is_remote[b] = 1;
+            ++remote_block_count;
+            continue;
+        }
+        hmput(block_hash_to_seed_chunk_hashes, content_index->m_BlockHashes[b], block_chunk_hashes[b]);
+    }
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        remote_chunk_count += block_is_remote[content_index->m_ChunkBlockIndexes[c]];
+    }
+
+    Longtail_LockSpinLock(api->m_Lock);
+    struct BlockHashToSeedChunkHashes* old_block_hash_to_seed_chunk_hashes = api->m_BlockHashToSeedChunkHashes;
+    api->m_BlockHashToSeedChunkHashes = block_hash_to_seed_chunk_hashes;
+    Longtail_UnlockSpinLock(api->m_Lock);
+    SeedBlockStore_FreeBlockHashToSeedChunkHashes(old_block_hash_to_seed_chunk_hashes);
+
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "SeedBlockStore_PreflightGet(%p, %p) seeding %" PRIu64 " of %" PRIu64 " blocks from local content",
+        block_store_api, content_index,
+        block_count - remote_block_count, block_count)
+
+    // Only tell the backing store about the blocks we will actually request from it
+    size_t remote_content_index_size = Longtail_GetContentIndexSize(remote_block_count, remote_chunk_count);
+    struct Longtail_ContentIndex* remote_content_index = (struct Longtail_ContentIndex*)Longtail_Alloc(remote_content_index_size);
+    if (!remote_content_index)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_PreflightGet(%p, %p) failed with %d",
+            block_store_api, content_index,
+            ENOMEM)
+        Longtail_Free(block_states_mem);
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PreflightGet_FailCount], 1);
+        return ENOMEM;
+    }
+    int err = Longtail_InitContentIndex(
+        remote_content_index,
+        &remote_content_index[1],
+        remote_content_index_size - sizeof(struct Longtail_ContentIndex),
+        *content_index->m_HashIdentifier,
+        *content_index->m_MaxBlockSize,
+        *content_index->m_MaxChunksPerBlock,
+        remote_block_count,
+        remote_chunk_count);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_PreflightGet(%p, %p) failed with %d",
+            block_store_api, content_index,
+            err)
+        Longtail_Free(remote_content_index);
+        Longtail_Free(block_states_mem);
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PreflightGet_FailCount], 1);
+        return err;
+    }
+
+    // Reuse the block tag array to map content index block index to remote content index block index
+    uint32_t* remote_block_indexes = block_tags;
+    uint64_t remote_block_index = 0;
+    for (uint64_t b = 0; b < block_count; ++b)
+    {
+        if (block_is_remote[b])
+        {
+            remote_content_index->m_BlockHashes[remote_block_index] = content_index->m_BlockHashes[b];
+            remote_block_indexes[b] = (uint32_t)remote_block_index;
+            ++remote_block_index;
+        }
+    }
+    uint64_t remote_chunk_index = 0;
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        uint64_t block_index = content_index->m_ChunkBlockIndexes[c];
+        if (block_is_remote[block_index])
+        {
+            remote_content_index->m_ChunkHashes[remote_chunk_index] = content_index->m_ChunkHashes[c];
+            remote_content_index->m_ChunkBlockIndexes[remote_chunk_index] = remote_block_indexes[block_index];
+            ++remote_chunk_index;
+        }
+    }
+    Longtail_Free(block_states_mem);
+
+    err = api->m_BackingBlockStore->PreflightGet(
+        api->m_BackingBlockStore,
+        remote_content_index);
+    Longtail_Free(remote_content_index);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_PreflightGet(%p, %p) failed with %d",
+            block_store_api, content_index,
+            err)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_PreflightGet_FailCount], 1);
+    }
+    return err;
+}
+
+static int SeedBlockStore_GetStoredBlock(
+    struct Longtail_BlockStoreAPI* block_store_api,
+    uint64_t block_hash,
+    struct Longtail_AsyncGetStoredBlockAPI* async_complete_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_GetStoredBlock(%p, 0x%" PRIx64 ", %p)", block_store_api, block_hash, async_complete_api)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api->OnComplete, return EINVAL)
+
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count], 1);
+
+    TLongtail_Hash* chunk_hashes = 0;
+    uint32_t chunk_count = 0;
+    Longtail_LockSpinLock(api->m_Lock);
+    intptr_t block_ptr = hmgeti(api->m_BlockHashToSeedChunkHashes, block_hash);
+    if (block_ptr != -1)
+    {
+        TLongtail_Hash* seed_chunk_hashes = api->m_BlockHashToSeedChunkHashes[block_ptr].value;
+        chunk_count = (uint32_t)arrlen(seed_chunk_hashes);
+        chunk_hashes = (TLongtail_Hash*)Longtail_Alloc(sizeof(TLongtail_Hash) * chunk_count);
+        if (chunk_hashes)
+        {
+            memcpy(chunk_hashes, seed_chunk_hashes, sizeof(TLongtail_Hash) * chunk_count);
+        }
+    }
+    Longtail_UnlockSpinLock(api->m_Lock);
+
+    if (chunk_hashes)
+    {
+        struct Longtail_StoredBlock* stored_block;
+        int err = SeedBlockStore_ReadBlock(api, block_hash, chunk_count, chunk_hashes, &stored_block);
+        Longtail_Free(chunk_hashes);
+        if (!err)
+        {
+            Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *stored_block->m_BlockIndex->m_ChunkCount);
+            Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*stored_block->m_BlockIndex->m_ChunkCount) + stored_block->m_BlockChunksDataSize);
+            async_complete_api->OnComplete(async_complete_api, stored_block, 0);
+            return 0;
+        }
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "SeedBlockStore_GetStoredBlock(%p, 0x%" PRIx64 ", %p) could not seed block from local content (%d), falling back to backing store",
+            block_store_api, block_hash, async_complete_api,
+            err)
+    }
+
+    int err = api->m_BackingBlockStore->GetStoredBlock(
+        api->m_BackingBlockStore,
+        block_hash,
+        async_complete_api);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_GetStoredBlock(%p, 0x%" PRIx64 ", %p) failed with %d",
+            block_store_api, block_hash, async_complete_api,
+            err)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_FailCount], 1);
+    }
+    return err;
+}
+
+static int SeedBlockStore_RetargetContent(
+    struct Longtail_BlockStoreAPI* block_store_api,
+    const struct Longtail_ContentIndex* content_index,
+    struct Longtail_AsyncRetargetContentAPI* async_complete_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_RetargetContent(%p, %p, %p)",
+        block_store_api, content_index, async_complete_api)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(content_index, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api, return EINVAL)
+
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_RetargetContent_Count], 1);
+    int err = api->m_BackingBlockStore->RetargetContent(
+        api->m_BackingBlockStore,
+        content_index,
+        async_complete_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_RetargetContent(%p, %p, %p) failed with %d",
+            block_store_api, content_index, async_complete_api,
+            err)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_RetargetContent_FailCount], 1);
+        return err;
+    }
+    return 0;
+}
+
+static int SeedBlockStore_GetStats(struct Longtail_BlockStoreAPI* block_store_api, struct Longtail_BlockStore_Stats* out_stats)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_GetStats(%p, %p)", block_store_api, out_stats)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_stats, return EINVAL)
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStats_Count], 1);
+    memset(out_stats, 0, sizeof(struct Longtail_BlockStore_Stats));
+    for (uint32_t s = 0; s < Longtail_BlockStoreAPI_StatU64_Count; ++s)
+    {
+        out_stats->m_StatU64[s] = api->m_StatU64[s];
+    }
+    return 0;
+}
+
+static int SeedBlockStore_Flush(struct Longtail_BlockStoreAPI* block_store_api, struct Longtail_AsyncFlushAPI* async_complete_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_Flush(%p, %p)", block_store_api, async_complete_api)
+    LONGTAIL_VALIDATE_INPUT(block_store_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(async_complete_api, return EINVAL)
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_Flush_Count], 1);
+    // Seeded blocks are completed synchronously so only the backing store can have pending requests
+    int err = api->m_BackingBlockStore->Flush(
+        api->m_BackingBlockStore,
+        async_complete_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_Flush(%p, %p) failed with %d",
+            block_store_api, async_complete_api,
+            err)
+        Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_Flush_FailCount], 1);
+    }
+    return err;
+}
+
+static int SeedBlockStore_RemoveStashedFile(struct Longtail_StorageAPI* storage_api, const char* stashed_asset_path)
+{
+    uint16_t permissions = 0;
+    int err = storage_api->GetPermissions(storage_api, stashed_asset_path, &permissions);
+    if (!err && !(permissions & Longtail_StorageAPI_UserWriteAccess))
+    {
+        storage_api->SetPermissions(storage_api, stashed_asset_path, permissions | Longtail_StorageAPI_UserWriteAccess);
+    }
+    return storage_api->RemoveFile(storage_api, stashed_asset_path);
+}
+
+// Puts every file listed in the journal back in seed_path unless something else has been written there,
+// in which case the stashed file is removed. The journal and stash folder are removed once all files are handled
+static int SeedBlockStore_RecoverStash(struct Longtail_StorageAPI* storage_api, const char* stash_path, const char* seed_path)
+{
+    char* journal_path = storage_api->ConcatPath(storage_api, stash_path, SEED_STASH_JOURNAL_NAME);
+    char* journal_tmp_path = storage_api->ConcatPath(storage_api, stash_path, SEED_STASH_JOURNAL_TMP_NAME);
+    if (!journal_path || !journal_tmp_path)
+    {
+        Longtail_Free(journal_tmp_path);
+        Longtail_Free(journal_path);
+        return ENOMEM;
+    }
+    int err = 0;
+    if (storage_api->IsFile(storage_api, journal_path))
+    {
+        Longtail_StorageAPI_HOpenFile journal_file;
+        err = storage_api->OpenReadFile(storage_api, journal_path, &journal_file);
+        uint64_t journal_size = 0;
+        char* journal = 0;
+        if (!err)
+        {
+            err = storage_api->GetSize(storage_api, journal_file, &journal_size);
+            if (!err)
+            {
+                journal = (char*)Longtail_Alloc((size_t)journal_size + 1);
+                err = journal ? storage_api->Read(storage_api, journal_file, 0, journal_size, journal) : ENOMEM;
+            }
+            storage_api->CloseFile(storage_api, journal_file);
+        }
+        if (!err)
+        {
+            journal[journal_size] = '\0';
+            // Each record is the stash name followed by the zero terminated asset path
+            uint64_t offset = 0;
+            while (offset + SEED_STASH_NAME_LENGTH < journal_size)
+            {
+                char stash_name[SEED_STASH_NAME_LENGTH + 1];
+                memcpy(stash_name, &journal[offset], SEED_STASH_NAME_LENGTH);
+                stash_name[SEED_STASH_NAME_LENGTH] = '\0';
+                const char* asset_name = &journal[offset + SEED_STASH_NAME_LENGTH];
+                offset += SEED_STASH_NAME_LENGTH + strlen(asset_name) + 1;
+
+                char* stashed_asset_path = storage_api->ConcatPath(storage_api, stash_path, stash_name);
+                char* asset_path = storage_api->ConcatPath(storage_api, seed_path, asset_name);
+                int restore_err = (stashed_asset_path && asset_path) ? 0 : ENOMEM;
+                if (!restore_err && storage_api->IsFile(storage_api, stashed_asset_path))
+                {
+                    if (storage_api->IsFile(storage_api, asset_path))
+                    {
+                        restore_err = SeedBlockStore_RemoveStashedFile(storage_api, stashed_asset_path);
+                    }
+                    else
+                    {
+                        restore_err = EnsureParentPathExists(storage_api, asset_path);
+                        if (!restore_err)
+                        {
+                            restore_err = storage_api->RenameFile(storage_api, stashed_asset_path, asset_path);
+                        }
+                    }
+                }
+                if (restore_err)
+                {
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_RecoverStash(%p, %s, %s) failed to restore `%s` from `%s`, %d",
+                        storage_api, stash_path, seed_path, asset_path, stashed_asset_path,
+                        restore_err)
+                    err = err ? err : restore_err;
+                }
+                Longtail_Free(asset_path);
+                Longtail_Free(stashed_asset_path);
+            }
+        }
+        Longtail_Free(journal);
+        if (!err)
+        {
+            err = storage_api->RemoveFile(storage_api, journal_path);
+        }
+    }
+    if (!err && storage_api->IsFile(storage_api, journal_tmp_path))
+    {
+        // Nothing is moved to the stash before the journal has its final name
+        err = storage_api->RemoveFile(storage_api, journal_tmp_path);
+    }
+    if (!err)
+    {
+        err = storage_api->RemoveDir(storage_api, stash_path);
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_RecoverStash(%p, %s, %s) failed with %d",
+            storage_api, stash_path, seed_path,
+            err)
+    }
+    Longtail_Free(journal_tmp_path);
+    Longtail_Free(journal_path);
+    return err;
+}
+
+static int SeedBlockStore_WriteStashJournal(struct SeedBlockStoreAPI* api)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    const struct Longtail_VersionIndex* version_index = api->m_SeedVersionIndex;
+    size_t stashed_count = arrlen(api->m_StashedAssetIndexes);
+    size_t journal_size = 0;
+    for (size_t s = 0; s < stashed_count; ++s)
+    {
+        uint32_t asset_index = api->m_StashedAssetIndexes[s];
+        journal_size += SEED_STASH_NAME_LENGTH + strlen(&version_index->m_NameData[version_index->m_NameOffsets[asset_index]]) + 1;
+    }
+    char* journal = (char*)Longtail_Alloc(journal_size);
+    char* journal_path = storage_api->ConcatPath(storage_api, api->m_StashPath, SEED_STASH_JOURNAL_NAME);
+    char* journal_tmp_path = storage_api->ConcatPath(storage_api, api->m_StashPath, SEED_STASH_JOURNAL_TMP_NAME);
+    if (!journal || !journal_path || !journal_tmp_path)
+    {
+        Longtail_Free(journal_tmp_path);
+        Longtail_Free(journal_path);
+        Longtail_Free(journal);
+        return ENOMEM;
+    }
+    size_t offset = 0;
+    for (size_t s = 0; s < stashed_count; ++s)
+    {
+        uint32_t asset_index = api->m_StashedAssetIndexes[s];
+        const char* asset_name = &version_index->m_NameData[version_index->m_NameOffsets[asset_index]];
+        size_t asset_name_size = strlen(asset_name) + 1;
+        SeedBlockStore_GetStashName(version_index->m_PathHashes[asset_index], &journal[offset]);
+        memcpy(&journal[offset + SEED_STASH_NAME_LENGTH], asset_name, asset_name_size);
+        offset += SEED_STASH_NAME_LENGTH + asset_name_size;
+    }
+
+    Longtail_StorageAPI_HOpenFile journal_file;
+    int err = storage_api->OpenWriteFile(storage_api, journal_tmp_path, 0, &journal_file);
+    if (!err)
+    {
+        err = storage_api->Write(storage_api, journal_file, 0, journal_size, journal);
+        storage_api->CloseFile(storage_api, journal_file);
+    }
+    if (!err)
+    {
+        err = storage_api->RenameFile(storage_api, journal_tmp_path, journal_path);
+    }
+    Longtail_Free(journal_tmp_path);
+    Longtail_Free(journal_path);
+    Longtail_Free(journal);
+    return err;
+}
+
+static void SeedBlockStore_RestoreStashedAssets(struct SeedBlockStoreAPI* api)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    size_t stashed_count = arrlen(api->m_StashedAssetIndexes);
+    for (size_t s = 0; s < stashed_count; ++s)
+    {
+        uint32_t asset_index = api->m_StashedAssetIndexes[s];
+        if (api->m_AssetStates[asset_index] != SEED_ASSET_STATE_STASHED_REMOVED)
+        {
+            continue;
+        }
+        char* stashed_asset_path = SeedBlockStore_GetStashedAssetPath(api, asset_index);
+        int err = SeedBlockStore_RemoveStashedFile(storage_api, stashed_asset_path);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_RestoreStashedAssets(%p) failed to remove `%s`, %d",
+                api, stashed_asset_path,
+                err)
+        }
+        Longtail_Free(stashed_asset_path);
+    }
+    // Modified assets that were never written are put back in place, the rest of the stash is removed
+    if (storage_api->IsDir(storage_api, api->m_StashPath))
+    {
+        SeedBlockStore_RecoverStash(storage_api, api->m_StashPath, api->m_SeedPath);
+    }
+}
+
+static void SeedBlockStore_StashAssets(struct SeedBlockStoreAPI* api, const struct Longtail_VersionDiff* version_diff)
+{
+    struct Longtail_StorageAPI* storage_api = api->m_StorageAPI;
+    const struct Longtail_VersionIndex* version_index = api->m_SeedVersionIndex;
+    uint32_t removed_count = *version_diff->m_SourceRemovedCount;
+    uint32_t modified_count = *version_diff->m_ModifiedContentCount;
+    for (uint32_t i = 0; i < removed_count + modified_count; ++i)
+    {
+        int is_removed = i < removed_count;
+        uint32_t asset_index = is_removed ? version_diff->m_SourceRemovedAssetIndexes[i] : version_diff->m_SourceContentModifiedAssetIndexes[i - removed_count];
+        const char* asset_name = &version_index->m_NameData[version_index->m_NameOffsets[asset_index]];
+        if (SeedBlockStore_IsDirPath(asset_name))
+        {
+            continue;
+        }
+        char* asset_path = SeedBlockStore_GetAssetPath(api, asset_index);
+        if (storage_api->IsFile(storage_api, asset_path))
+        {
+            api->m_AssetStates[asset_index] = is_removed ? SEED_ASSET_STATE_STASHED_REMOVED : SEED_ASSET_STATE_STASHED_MODIFIED;
+            arrput(api->m_StashedAssetIndexes, asset_index);
+        }
+        else
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "SeedBlockStore_StashAssets(%p, %p) can not seed from `%s`, %d",
+                api, version_diff, asset_path,
+                ENOENT)
+            api->m_AssetStates[asset_index] = SEED_ASSET_STATE_UNUSABLE;
+        }
+        Longtail_Free(asset_path);
+    }
+    size_t stashed_count = arrlen(api->m_StashedAssetIndexes);
+    if (stashed_count == 0)
+    {
+        return;
+    }
+
+    // A stash left by an earlier run that could not be recovered is not touched
+    int err = storage_api->IsDir(storage_api, api->m_StashPath) ? EEXIST : storage_api->CreateDir(storage_api, api->m_StashPath);
+    if (!err)
+    {
+        err = SeedBlockStore_WriteStashJournal(api);
+        if (err)
+        {
+            SeedBlockStore_RecoverStash(storage_api, api->m_StashPath, api->m_SeedPath);
+        }
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_StashAssets(%p, %p) failed to create stash `%s`, %d",
+            api, version_diff, api->m_StashPath,
+            err)
+        for (size_t s = 0; s < stashed_count; ++s)
+        {
+            api->m_AssetStates[api->m_StashedAssetIndexes[s]] = SEED_ASSET_STATE_UNUSABLE;
+        }
+        arrsetlen(api->m_StashedAssetIndexes, 0);
+        return;
+    }
+
+    for (size_t s = 0; s < stashed_count; ++s)
+    {
+        uint32_t asset_index = api->m_StashedAssetIndexes[s];
+        char* asset_path = SeedBlockStore_GetAssetPath(api, asset_index);
+        char* stashed_asset_path = SeedBlockStore_GetStashedAssetPath(api, asset_index);
+        int rename_err = storage_api->RenameFile(storage_api, asset_path, stashed_asset_path);
+        if (rename_err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "SeedBlockStore_StashAssets(%p, %p) can not seed from `%s`, %d",
+                api, version_diff, asset_path,
+                rename_err)
+            api->m_AssetStates[asset_index] = SEED_ASSET_STATE_UNUSABLE;
+        }
+        Longtail_Free(stashed_asset_path);
+        Longtail_Free(asset_path);
+    }
+}
+
+static void SeedBlockStore_Dispose(struct Longtail_API* base_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_Dispose(%p)", base_api)
+    LONGTAIL_FATAL_ASSERT(base_api, return)
+
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)base_api;
+    SeedBlockStore_RestoreStashedAssets(api);
+    SeedBlockStore_FreeBlockHashToSeedChunkHashes(api->m_BlockHashToSeedChunkHashes);
+    hmfree(api->m_ChunkHashToSeedChunkLocation);
+    arrfree(api->m_StashedAssetIndexes);
+    Longtail_Free(api->m_AssetStates);
+    Longtail_Free(api->m_StashPath);
+    Longtail_Free(api->m_SeedPath);
+    Longtail_DeleteSpinLock(api->m_Lock);
+    Longtail_Free(api->m_Lock);
+    Longtail_Free(api);
+}
+
+static int SeedBlockStore_Init(
+    void* mem,
+    struct Longtail_StorageAPI* seed_storage_api,
+    struct Longtail_HashAPI* hash_api,
+    const struct Longtail_VersionIndex* seed_version_index,
+    const struct Longtail_VersionDiff* optional_version_diff,
+    const char* seed_path,
+    struct Longtail_BlockStoreAPI* backing_block_store,
+    struct Longtail_BlockStoreAPI** out_block_store_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "SeedBlockStore_Init(%p, %p, %p, %p, %p, %s, %p, %p)",
+        mem, seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store, out_block_store_api)
+    LONGTAIL_FATAL_ASSERT(mem, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(seed_storage_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(hash_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(seed_version_index, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(seed_path, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(backing_block_store, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_block_store_api, return EINVAL)
+
+    struct Longtail_BlockStoreAPI* block_store_api = Longtail_MakeBlockStoreAPI(
+        mem,
+        SeedBlockStore_Dispose,
+        SeedBlockStore_PutStoredBlock,
+        SeedBlockStore_PreflightGet,
+        SeedBlockStore_GetStoredBlock,
+        SeedBlockStore_RetargetContent,
+        SeedBlockStore_GetStats,
+        SeedBlockStore_Flush);
+    if (!block_store_api)
+    {
+        return EINVAL;
+    }
+
+    uint32_t asset_count = *seed_version_index->m_AssetCount;
+
+    struct SeedBlockStoreAPI* api = (struct SeedBlockStoreAPI*)block_store_api;
+    api->m_BackingBlockStore = backing_block_store;
+    api->m_StorageAPI = seed_storage_api;
+    api->m_HashAPI = hash_api;
+    api->m_SeedVersionIndex = seed_version_index;
+    api->m_SeedPath = Longtail_Strdup(seed_path);
+    api->m_StashPath = api->m_SeedPath ? seed_storage_api->ConcatPath(seed_storage_api, seed_path, SEED_STASH_FOLDER_NAME) : 0;
+    api->m_AssetStates = (uint8_t*)Longtail_Alloc(asset_count == 0 ? 1 : asset_count);
+    api->m_StashedAssetIndexes = 0;
+    api->m_ChunkHashToSeedChunkLocation = 0;
+    api->m_BlockHashToSeedChunkHashes = 0;
+    for (uint32_t s = 0; s < Longtail_BlockStoreAPI_StatU64_Count; ++s)
+    {
+        api->m_StatU64[s] = 0;
+    }
+    if (!api->m_SeedPath || !api->m_StashPath || !api->m_AssetStates)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_Init(%p, %p, %p, %p, %p, %s, %p, %p) failed with %d",
+            mem, seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store, out_block_store_api,
+            ENOMEM)
+        Longtail_Free(api->m_AssetStates);
+        Longtail_Free(api->m_StashPath);
+        Longtail_Free(api->m_SeedPath);
+        return ENOMEM;
+    }
+    int err = Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &api->m_Lock);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "SeedBlockStore_Init(%p, %p, %p, %p, %p, %s, %p, %p) failed with %d",
+            mem, seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store, out_block_store_api,
+            err)
+        Longtail_Free(api->m_AssetStates);
+        Longtail_Free(api->m_StashPath);
+        Longtail_Free(api->m_SeedPath);
+        return err;
+    }
+    memset(api->m_AssetStates, SEED_ASSET_STATE_IN_PLACE, asset_count);
+
+    if (seed_storage_api->IsDir(seed_storage_api, api->m_StashPath))
+    {
+        // A seed block store that was not disposed left files in the stash
+        SeedBlockStore_RecoverStash(seed_storage_api, api->m_StashPath, api->m_SeedPath);
+    }
+
+    if (hash_api->GetIdentifier(hash_api) != *seed_version_index->m_HashIdentifier)
+    {
+        // We can't verify the chunks we read, don't seed anything
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "SeedBlockStore_Init(%p, %p, %p, %p, %p, %s, %p, %p) hash api does not match seed version index, seeding disabled",
+            mem, seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store, out_block_store_api)
+        memset(api->m_AssetStates, SEED_ASSET_STATE_UNUSABLE, asset_count);
+    }
+    else if (optional_version_diff)
+    {
+        SeedBlockStore_StashAssets(api, optional_version_diff);
+    }
+
+    for (uint32_t a = 0; a < asset_count; ++a)
+    {
+        if (api->m_AssetStates[a] == SEED_ASSET_STATE_UNUSABLE)
+        {
+            continue;
+        }
+        uint64_t offset = 0;
+        uint32_t chunk_start = seed_version_index->m_AssetChunkIndexStarts[a];
+        uint32_t chunk_count = seed_version_index->m_AssetChunkCounts[a];
+        for (uint32_t c = 0; c < chunk_count; ++c)
+        {
+            uint32_t chunk_index = seed_version_index->m_AssetChunkIndexes[chunk_start + c];
+            TLongtail_Hash chunk_hash = seed_version_index->m_ChunkHashes[chunk_index];
+            if (hmgeti(api->m_ChunkHashToSeedChunkLocation, chunk_hash) == -1)
+            {
+                struct SeedChunkLocation location = {offset, a, chunk_index};
+                hmput(api->m_ChunkHashToSeedChunkLocation, chunk_hash, location);
+            }
+            offset += seed_version_index->m_ChunkSizes[chunk_index];
+        }
+    }
+
+    *out_block_store_api = block_store_api;
+    return 0;
+}
+
+struct Longtail_BlockStoreAPI* Longtail_CreateSeedBlockStoreAPI(
+    struct Longtail_StorageAPI* seed_storage_api,
+    struct Longtail_HashAPI* hash_api,
+    const struct Longtail_VersionIndex* seed_version_index,
+    const struct Longtail_VersionDiff* optional_version_diff,
+    const char* seed_path,
+    struct Longtail_BlockStoreAPI* backing_block_store)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateSeedBlockStoreAPI(%p, %p, %p, %p, %s, %p)",
+        seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store)
+    LONGTAIL_VALIDATE_INPUT(seed_storage_api, return 0)
+    LONGTAIL_VALIDATE_INPUT(hash_api, return 0)
+    LONGTAIL_VALIDATE_INPUT(seed_version_index, return 0)
+    LONGTAIL_VALIDATE_INPUT(seed_path, return 0)
+    LONGTAIL_VALIDATE_INPUT(backing_block_store, return 0)
+
+    size_t api_size = sizeof(struct SeedBlockStoreAPI);
+    void* mem = Longtail_Alloc(api_size);
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateSeedBlockStoreAPI(%p, %p, %p, %p, %s, %p) failed with %d",
+            seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store,
+            ENOMEM)
+        return 0;
+    }
+    struct Longtail_BlockStoreAPI* block_store_api;
+    int err = SeedBlockStore_Init(
+        mem,
+        seed_storage_api,
+        hash_api,
+        seed_version_index,
+        optional_version_diff,
+        seed_path,
+        backing_block_store,
+        &block_store_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateSeedBlockStoreAPI(%p, %p, %p, %p, %s, %p) failed with %d",
+            seed_storage_api, hash_api, seed_version_index, optional_version_diff, seed_path, backing_block_store,
+            err)
+        Longtail_Free(mem);
+        return 0;
+    }
+    return block_store_api;
+}
+
+int Longtail_RecoverSeedBlockStoreStash(
+    struct Longtail_StorageAPI* seed_storage_api,
+    const char* seed_path)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_RecoverSeedBlockStoreStash(%p, %s)",
+        seed_storage_api, seed_path)
+    LONGTAIL_VALIDATE_INPUT(seed_storage_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(seed_path, return EINVAL)
+
+    char* stash_path = seed_storage_api->ConcatPath(seed_storage_api, seed_path, SEED_STASH_FOLDER_NAME);
+    if (!stash_path)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_RecoverSeedBlockStoreStash(%p, %s) failed with %d",
+            seed_storage_api, seed_path,
+            ENOMEM)
+        return ENOMEM;
+    }
+    int err = seed_storage_api->IsDir(seed_storage_api, stash_path) ? SeedBlockStore_RecoverStash(seed_storage_api, stash_path, seed_path) : 0;
+    Longtail_Free(stash_path);
+    return err;
+}
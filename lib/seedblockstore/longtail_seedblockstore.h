@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../../src/longtail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Serves blocks by reading chunks from the files in seed_path, described by seed_version_index.
+// Blocks with chunks not present in seed_path are fetched from backing_block_store.
+// If optional_version_diff is given, files that will be removed or modified by the diff are
+// moved aside until the block store is disposed so seed_path can be updated while seeding.
+// The diff must have seed_version_index as source and seed_version_index must outlive the block store.
+// Files moved aside by a block store that was never disposed are put back when the next one is created.
+LONGTAIL_EXPORT extern struct Longtail_BlockStoreAPI* Longtail_CreateSeedBlockStoreAPI(
+    struct Longtail_StorageAPI* seed_storage_api,
+    struct Longtail_HashAPI* hash_api,
+    const struct Longtail_VersionIndex* seed_version_index,
+    const struct Longtail_VersionDiff* optional_version_diff,
+    const char* seed_path,
+    struct Longtail_BlockStoreAPI* backing_block_store);
+
+// Puts back the files a seed block store for seed_path moved aside but never restored, for example
+// because the process was killed. Call it before indexing seed_path so the moved files are included.
+LONGTAIL_EXPORT extern int Longtail_RecoverSeedBlockStoreStash(
+    struct Longtail_StorageAPI* seed_storage_api,
+    const char* seed_path);
+
+#ifdef __cplusplus
+}
+#endif
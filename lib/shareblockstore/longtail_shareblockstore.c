@@ -258,6 +258,7 @@ static int ShareBlockStore_GetStoredBlock(
         struct SharedStoredBlock* shared_stored_block = api->m_BlockHashToSharedStoredBlock[find_block_ptr].value;
         Longtail_AtomicAdd32(&shared_stored_block->m_RefCount, 1);
         Longtail_UnlockSpinLock(api->m_Lock);
+        Longtail_AddMetric(Longtail_Metric_ShareBlockStore_SharedCount, 1);
         Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Chunk_Count], *shared_stored_block->m_StoredBlock.m_BlockIndex->m_ChunkCount);
         Longtail_AtomicAdd64(&api->m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Byte_Count], Longtail_GetBlockIndexDataSize(*shared_stored_block->m_StoredBlock.m_BlockIndex->m_ChunkCount) + shared_stored_block->m_StoredBlock.m_BlockChunksDataSize);
         async_complete_api->OnComplete(async_complete_api, &shared_stored_block->m_StoredBlock, 0);
@@ -269,6 +270,7 @@ static int ShareBlockStore_GetStoredBlock(
     {
         arrput(api->m_BlockHashToCompleteCallbacks[find_wait_list_ptr].value, async_complete_api);
         Longtail_UnlockSpinLock(api->m_Lock);
+        Longtail_AddMetric(Longtail_Metric_ShareBlockStore_SharedCount, 1);
         return 0;
     }
 
@@ -0,0 +1,784 @@
+#include "longtail_workstealing.h"
+
+#include "../longtail_platform.h"
+#include "../../src/ext/stb_ds.h"
+
+#include <errno.h>
+#include <string.h>
+
+// Jobs live in pages that are allocated on demand and never move so a job id can be resolved
+// without taking a lock. Job ids are recycled when a job group is released so this is a limit
+// on the number of jobs in flight, not on the total number of jobs.
+#define WORKSTEALING_JOB_PAGE_SHIFT         14
+#define WORKSTEALING_JOB_PAGE_SIZE          (1u << WORKSTEALING_JOB_PAGE_SHIFT)
+#define WORKSTEALING_JOB_PAGE_MASK          (WORKSTEALING_JOB_PAGE_SIZE - 1)
+#define WORKSTEALING_MAX_JOB_PAGE_COUNT     16384u
+#define WORKSTEALING_DEPENDENCY_BLOCK_SIZE  256u
+#define WORKSTEALING_QUEUE_INITIAL_CAPACITY 1024u
+#define WORKSTEALING_NO_WORKER              0xffffffffu
+// How often WaitForAllJobs wakes up to report progress and check for cancellation
+#define WORKSTEALING_PROGRESS_INTERVAL_US   10000u
+
+struct WorkStealingJobGroup;
+
+struct WorkStealingDependency
+{
+    struct WorkStealingDependency* m_Next;
+    uint32_t m_JobID;
+};
+
+struct WorkStealingDependencyBlock
+{
+    struct WorkStealingDependencyBlock* m_Next;
+    uint32_t m_Count;
+    struct WorkStealingDependency m_Dependencies[WORKSTEALING_DEPENDENCY_BLOCK_SIZE];
+};
+
+struct WorkStealingJob
+{
+    Longtail_JobAPI_JobFunc m_JobFunc;
+    void* m_Context;
+    struct WorkStealingJobGroup* m_JobGroup;
+    struct WorkStealingDependency* m_Dependents;
+    TLongtail_Atomic32 m_PendingDependencyCount;
+    // Incremented when the job returns EBUSY and decremented by ResumeJob, whichever side brings it back to zero queues the job again
+    TLongtail_Atomic32 m_BlockState;
+};
+
+// Ring buffer of ready job ids, the owning worker takes the most recently added job and other threads steal the oldest.
+// The queue is guarded by a spinlock rather than being a lock-free deque built on Longtail_CompareAndSwap since it grows
+// on demand and a lock-free deque would have to keep retired buffers alive until no thief can read them. The lock is
+// only held for a few instructions and is only contended when a thief picks the same queue as its owner.
+struct WorkStealingQueue
+{
+    HLongtail_SpinLock m_Lock;
+    uint32_t* m_JobIDs;
+    uint32_t m_Capacity;
+    uint32_t m_Head;
+    TLongtail_Atomic32 m_Count;
+};
+
+struct WorkStealingWorker
+{
+    struct WorkStealingJobAPI* m_API;
+    uint32_t m_WorkerIndex;
+    HLongtail_Thread m_Thread;
+};
+
+struct WorkStealingJobAPI
+{
+    struct Longtail_JobAPI m_JobAPI;
+    uint32_t m_WorkerCount;
+    uint32_t m_QueueCount;
+    int m_WorkerPriority;
+    struct WorkStealingQueue* m_Queues;
+    struct WorkStealingWorker* m_Workers;
+    HLongtail_Sema m_WorkSema;
+    TLongtail_Atomic32 m_IdleWorkerCount;
+    TLongtail_Atomic32 m_NextQueue;
+    TLongtail_Atomic32 m_Stop;
+
+    HLongtail_SpinLock m_JobIDLock;
+    uint32_t* m_FreeJobIDs;
+    uint32_t m_NextJobID;
+    struct WorkStealingJob* m_JobPages[WORKSTEALING_MAX_JOB_PAGE_COUNT];
+};
+
+struct WorkStealingJobGroup
+{
+    struct WorkStealingJobAPI* m_API;
+    uint32_t* m_JobIDs;
+    uint32_t m_ReservedJobCount;
+    HLongtail_Sema m_CompleteSema;
+    HLongtail_SpinLock m_DependencyLock;
+    struct WorkStealingDependencyBlock* m_DependencyBlocks;
+    TLongtail_Atomic32 m_Cancelled;
+    TLongtail_Atomic32 m_SubmittedJobCount;
+    // Starts at one, the extra count is released by WaitForAllJobs so the group can not complete while jobs are still being added
+    TLongtail_Atomic32 m_PendingJobCount;
+    TLongtail_Atomic32 m_JobsCompleted;
+    TLongtail_Atomic32 m_IsComplete;
+};
+
+static struct WorkStealingJob* GetJob(struct WorkStealingJobAPI* api, uint32_t job_id)
+{
+    LONGTAIL_FATAL_ASSERT(job_id != 0, return 0)
+    struct WorkStealingJob* page = api->m_JobPages[job_id >> WORKSTEALING_JOB_PAGE_SHIFT];
+    LONGTAIL_FATAL_ASSERT(page != 0, return 0)
+    return &page[job_id & WORKSTEALING_JOB_PAGE_MASK];
+}
+
+static int AllocateJobIDs(struct WorkStealingJobAPI* api, uint32_t count, uint32_t* out_job_ids)
+{
+    Longtail_LockSpinLock(api->m_JobIDLock);
+    uint32_t free_count = (uint32_t)arrlen(api->m_FreeJobIDs);
+    uint32_t reuse_count = free_count < count ? free_count : count;
+    uint32_t new_count = count - reuse_count;
+    uint64_t max_job_id = (uint64_t)WORKSTEALING_MAX_JOB_PAGE_COUNT * WORKSTEALING_JOB_PAGE_SIZE;
+    if ((uint64_t)api->m_NextJobID + new_count > max_job_id)
+    {
+        Longtail_UnlockSpinLock(api->m_JobIDLock);
+        return ENOMEM;
+    }
+    for (uint32_t i = 0; i < new_count; ++i)
+    {
+        uint32_t job_id = api->m_NextJobID + i;
+        uint32_t page_index = job_id >> WORKSTEALING_JOB_PAGE_SHIFT;
+        if (api->m_JobPages[page_index] == 0)
+        {
+            api->m_JobPages[page_index] = (struct WorkStealingJob*)Longtail_Alloc(sizeof(struct WorkStealingJob) * WORKSTEALING_JOB_PAGE_SIZE);
+            if (api->m_JobPages[page_index] == 0)
+            {
+                Longtail_UnlockSpinLock(api->m_JobIDLock);
+                return ENOMEM;
+            }
+        }
+        out_job_ids[reuse_count + i] = job_id;
+    }
+    api->m_NextJobID += new_count;
+    if (reuse_count > 0)
+    {
+        memcpy(out_job_ids, &api->m_FreeJobIDs[free_count - reuse_count], sizeof(uint32_t) * reuse_count);
+        arrsetlen(api->m_FreeJobIDs, free_count - reuse_count);
+    }
+    Longtail_UnlockSpinLock(api->m_JobIDLock);
+    return 0;
+}
+
+static void FreeJobIDs(struct WorkStealingJobAPI* api, uint32_t count, const uint32_t* job_ids)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    Longtail_LockSpinLock(api->m_JobIDLock);
+    size_t offset = arraddn(api->m_FreeJobIDs, count);
+    memcpy(&api->m_FreeJobIDs[offset], job_ids, sizeof(uint32_t) * count);
+    Longtail_UnlockSpinLock(api->m_JobIDLock);
+}
+
+static int WorkStealingQueue_Init(struct WorkStealingQueue* queue)
+{
+    queue->m_JobIDs = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * WORKSTEALING_QUEUE_INITIAL_CAPACITY);
+    if (!queue->m_JobIDs)
+    {
+        return ENOMEM;
+    }
+    int err = Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &queue->m_Lock);
+    if (err)
+    {
+        Longtail_Free(queue->m_JobIDs);
+        return err;
+    }
+    queue->m_Capacity = WORKSTEALING_QUEUE_INITIAL_CAPACITY;
+    queue->m_Head = 0;
+    queue->m_Count = 0;
+    return 0;
+}
+
+static void WorkStealingQueue_Dispose(struct WorkStealingQueue* queue)
+{
+    Longtail_DeleteSpinLock(queue->m_Lock);
+    Longtail_Free(queue->m_Lock);
+    Longtail_Free(queue->m_JobIDs);
+}
+
+static int WorkStealingQueue_Push(struct WorkStealingQueue* queue, uint32_t count, const uint32_t* job_ids)
+{
+    Longtail_LockSpinLock(queue->m_Lock);
+    uint32_t queued_count = (uint32_t)queue->m_Count;
+    if (queued_count + count > queue->m_Capacity)
+    {
+        uint32_t new_capacity = queue->m_Capacity;
+        while (queued_count + count > new_capacity)
+        {
+            new_capacity *= 2;
+        }
+        uint32_t* new_job_ids = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * new_capacity);
+        if (!new_job_ids)
+        {
+            Longtail_UnlockSpinLock(queue->m_Lock);
+            return ENOMEM;
+        }
+        for (uint32_t i = 0; i < queued_count; ++i)
+        {
+            new_job_ids[i] = queue->m_JobIDs[(queue->m_Head + i) & (queue->m_Capacity - 1)];
+        }
+        Longtail_Free(queue->m_JobIDs);
+        queue->m_JobIDs = new_job_ids;
+        queue->m_Capacity = new_capacity;
+        queue->m_Head = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        queue->m_JobIDs[(queue->m_Head + queued_count + i) & (queue->m_Capacity - 1)] = job_ids[i];
+    }
+    Longtail_AtomicAdd32(&queue->m_Count, (int32_t)count);
+    Longtail_UnlockSpinLock(queue->m_Lock);
+    return 0;
+}
+
+static uint32_t WorkStealingQueue_Pop(struct WorkStealingQueue* queue)
+{
+    if (queue->m_Count == 0)
+    {
+        return 0;
+    }
+    Longtail_LockSpinLock(queue->m_Lock);
+    uint32_t job_id = 0;
+    if (queue->m_Count > 0)
+    {
+        job_id = queue->m_JobIDs[(queue->m_Head + (uint32_t)queue->m_Count - 1) & (queue->m_Capacity - 1)];
+        Longtail_AtomicAdd32(&queue->m_Count, -1);
+    }
+    Longtail_UnlockSpinLock(queue->m_Lock);
+    return job_id;
+}
+
+static uint32_t WorkStealingQueue_Steal(struct WorkStealingQueue* queue)
+{
+    if (queue->m_Count == 0)
+    {
+        return 0;
+    }
+    Longtail_LockSpinLock(queue->m_Lock);
+    uint32_t job_id = 0;
+    if (queue->m_Count > 0)
+    {
+        job_id = queue->m_JobIDs[queue->m_Head];
+        queue->m_Head = (queue->m_Head + 1) & (queue->m_Capacity - 1);
+        Longtail_AtomicAdd32(&queue->m_Count, -1);
+    }
+    Longtail_UnlockSpinLock(queue->m_Lock);
+    return job_id;
+}
+
+static int HasQueuedJobs(struct WorkStealingJobAPI* api)
+{
+    for (uint32_t q = 0; q < api->m_QueueCount; ++q)
+    {
+        if (Longtail_AtomicAdd32(&api->m_Queues[q].m_Count, 0) > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t TakeJob(struct WorkStealingJobAPI* api, uint32_t worker_index)
+{
+    uint32_t queue_count = api->m_QueueCount;
+    uint32_t start = worker_index;
+    if (worker_index < queue_count)
+    {
+        uint32_t job_id = WorkStealingQueue_Pop(&api->m_Queues[worker_index]);
+        if (job_id)
+        {
+            return job_id;
+        }
+        start = worker_index + 1;
+    }
+    else
+    {
+        start = (uint32_t)api->m_NextQueue;
+    }
+    for (uint32_t i = 0; i < queue_count; ++i)
+    {
+        uint32_t job_id = WorkStealingQueue_Steal(&api->m_Queues[(start + i) % queue_count]);
+        if (job_id)
+        {
+            return job_id;
+        }
+    }
+    return 0;
+}
+
+static int PushJobs(struct WorkStealingJobAPI* api, uint32_t worker_index, uint32_t count, const uint32_t* job_ids)
+{
+    if (api->m_WorkerCount == 0)
+    {
+        // Without workers the jobs are executed by the threads waiting for their job groups, wake the waiter
+        // of each job. The group is looked up before the job is queued since it may complete as soon as it is queued
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            HLongtail_Sema complete_sema = GetJob(api, job_ids[i])->m_JobGroup->m_CompleteSema;
+            int err = WorkStealingQueue_Push(&api->m_Queues[0], 1, &job_ids[i]);
+            if (err)
+            {
+                return err;
+            }
+            Longtail_PostSema(complete_sema, 1);
+        }
+        return 0;
+    }
+    uint32_t queue_index = worker_index < api->m_QueueCount ? worker_index : ((uint32_t)Longtail_AtomicAdd32(&api->m_NextQueue, 1)) % api->m_QueueCount;
+    int err = WorkStealingQueue_Push(&api->m_Queues[queue_index], count, job_ids);
+    if (err)
+    {
+        return err;
+    }
+    int32_t idle_count = Longtail_AtomicAdd32(&api->m_IdleWorkerCount, 0);
+    if (idle_count > 0)
+    {
+        Longtail_PostSema(api->m_WorkSema, (unsigned int)((uint32_t)idle_count < count ? (uint32_t)idle_count : count));
+    }
+    return 0;
+}
+
+static void ExecuteJob(struct WorkStealingJobAPI* api, uint32_t job_id, uint32_t worker_index)
+{
+    struct WorkStealingJob* job = GetJob(api, job_id);
+    struct WorkStealingJobGroup* job_group = job->m_JobGroup;
+    int res = job->m_JobFunc(job->m_Context, job_id, (int)job_group->m_Cancelled);
+    if (res == EBUSY)
+    {
+        if (Longtail_AtomicAdd32(&job->m_BlockState, 1) == 0)
+        {
+            // ResumeJob was called before we returned
+            int err = PushJobs(api, worker_index, 1, &job_id);
+            LONGTAIL_FATAL_ASSERT(err == 0, return)
+        }
+        return;
+    }
+    LONGTAIL_FATAL_ASSERT(res == 0, return)
+    LONGTAIL_FATAL_ASSERT(job_group->m_PendingJobCount > 0, return)
+    Longtail_AtomicAdd32(&job_group->m_JobsCompleted, 1);
+
+    struct WorkStealingDependency* dependent = job->m_Dependents;
+    while (dependent)
+    {
+        struct WorkStealingJob* dependent_job = GetJob(api, dependent->m_JobID);
+        if (Longtail_AtomicAdd32(&dependent_job->m_PendingDependencyCount, -1) == 0)
+        {
+            int err = PushJobs(api, worker_index, 1, &dependent->m_JobID);
+            LONGTAIL_FATAL_ASSERT(err == 0, return)
+        }
+        dependent = dependent->m_Next;
+    }
+
+    if (Longtail_AtomicAdd32(&job_group->m_PendingJobCount, -1) == 0)
+    {
+        Longtail_PostSema(job_group->m_CompleteSema, 1);
+        // Last access to the job group, the waiter releases it once it sees this
+        Longtail_AtomicAdd32(&job_group->m_IsComplete, 1);
+    }
+}
+
+static int32_t WorkStealingWorker_Execute(void* context)
+{
+    LONGTAIL_FATAL_ASSERT(context, return 0)
+    struct WorkStealingWorker* worker = (struct WorkStealingWorker*)context;
+    struct WorkStealingJobAPI* api = worker->m_API;
+    while (api->m_Stop == 0)
+    {
+        uint32_t job_id = TakeJob(api, worker->m_WorkerIndex);
+        if (job_id)
+        {
+            ExecuteJob(api, job_id, worker->m_WorkerIndex);
+            continue;
+        }
+        Longtail_AtomicAdd32(&api->m_IdleWorkerCount, 1);
+        if (api->m_Stop == 0 && !HasQueuedJobs(api))
+        {
+            Longtail_WaitSema(api->m_WorkSema, LONGTAIL_TIMEOUT_INFINITE);
+        }
+        Longtail_AtomicAdd32(&api->m_IdleWorkerCount, -1);
+    }
+    return 0;
+}
+
+static uint32_t WorkStealing_GetWorkerCount(struct Longtail_JobAPI* job_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_GetWorkerCount(%p)", job_api)
+    LONGTAIL_VALIDATE_INPUT(job_api, return 0)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    return api->m_WorkerCount;
+}
+
+static int WorkStealing_ReserveJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Group* out_job_group)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_ReserveJobs(%p, %u, %p)", job_api, job_count, out_job_group)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_count > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_job_group, return EINVAL)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+
+    size_t job_group_size = sizeof(struct WorkStealingJobGroup) +
+        Longtail_GetSemaSize() +
+        Longtail_GetSpinLockSize() +
+        sizeof(uint32_t) * job_count;
+    struct WorkStealingJobGroup* job_group = (struct WorkStealingJobGroup*)Longtail_Alloc(job_group_size);
+    if (!job_group)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_ReserveJobs(%p, %u, %p) failed with %d",
+            job_api, job_count, out_job_group,
+            ENOMEM)
+        return ENOMEM;
+    }
+    char* p = (char*)&job_group[1];
+    int err = Longtail_CreateSema(p, 0, &job_group->m_CompleteSema);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_ReserveJobs(%p, %u, %p) failed with %d",
+            job_api, job_count, out_job_group,
+            err)
+        Longtail_Free(job_group);
+        return err;
+    }
+    p += Longtail_GetSemaSize();
+    err = Longtail_CreateSpinLock(p, &job_group->m_DependencyLock);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_ReserveJobs(%p, %u, %p) failed with %d",
+            job_api, job_count, out_job_group,
+            err)
+        Longtail_DeleteSema(job_group->m_CompleteSema);
+        Longtail_Free(job_group);
+        return err;
+    }
+    p += Longtail_GetSpinLockSize();
+    job_group->m_JobIDs = (uint32_t*)p;
+    job_group->m_API = api;
+    job_group->m_ReservedJobCount = job_count;
+    job_group->m_DependencyBlocks = 0;
+    job_group->m_Cancelled = 0;
+    job_group->m_SubmittedJobCount = 0;
+    job_group->m_PendingJobCount = 1;
+    job_group->m_JobsCompleted = 0;
+    job_group->m_IsComplete = 0;
+    *out_job_group = (Longtail_JobAPI_Group)job_group;
+    return 0;
+}
+
+static int WorkStealing_CreateJobs(
+    struct Longtail_JobAPI* job_api,
+    Longtail_JobAPI_Group job_group,
+    uint32_t job_count,
+    Longtail_JobAPI_JobFunc job_funcs[],
+    void* job_contexts[],
+    uint32_t job_class,
+    Longtail_JobAPI_Jobs* out_jobs)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_CreateJobs(%p, %p, %u, %p, %p, %u, %p)", job_api, job_group, job_count, job_funcs, job_contexts, job_class, out_jobs)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_group, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_funcs, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_contexts, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_class < LONGTAIL_JOB_CLASS_COUNT, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_jobs, return EINVAL)
+    // All job classes share the same queues, stealing keeps the workers busy regardless of class
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    struct WorkStealingJobGroup* ws_job_group = (struct WorkStealingJobGroup*)job_group;
+
+    int32_t new_job_count = Longtail_AtomicAdd32(&ws_job_group->m_SubmittedJobCount, (int32_t)job_count);
+    if (new_job_count > (int32_t)ws_job_group->m_ReservedJobCount)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_CreateJobs(%p, %p, %u, %p, %p, %u, %p) failed with %d",
+            job_api, job_group, job_count, job_funcs, job_contexts, job_class, out_jobs,
+            ENOMEM)
+        Longtail_AtomicAdd32(&ws_job_group->m_SubmittedJobCount, -((int32_t)job_count));
+        return ENOMEM;
+    }
+    uint32_t* job_ids = &ws_job_group->m_JobIDs[new_job_count - (int32_t)job_count];
+    int err = AllocateJobIDs(api, job_count, job_ids);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_CreateJobs(%p, %p, %u, %p, %p, %u, %p) failed with %d",
+            job_api, job_group, job_count, job_funcs, job_contexts, job_class, out_jobs,
+            err)
+        Longtail_AtomicAdd32(&ws_job_group->m_SubmittedJobCount, -((int32_t)job_count));
+        return err;
+    }
+    for (uint32_t i = 0; i < job_count; ++i)
+    {
+        struct WorkStealingJob* job = GetJob(api, job_ids[i]);
+        job->m_JobFunc = job_funcs[i];
+        job->m_Context = job_contexts[i];
+        job->m_JobGroup = ws_job_group;
+        job->m_Dependents = 0;
+        job->m_PendingDependencyCount = 0;
+        job->m_BlockState = 0;
+    }
+    Longtail_AtomicAdd32(&ws_job_group->m_PendingJobCount, (int32_t)job_count);
+    *out_jobs = job_ids;
+    return 0;
+}
+
+static int WorkStealing_AddDependecies(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs, uint32_t dependency_job_count, Longtail_JobAPI_Jobs dependency_jobs)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_AddDependecies(%p, %u, %p, %u, %p)", job_api, job_count, jobs, dependency_job_count, dependency_jobs)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_count > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(jobs, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(dependency_job_count > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(dependency_jobs, return EINVAL)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    const uint32_t* job_ids = (const uint32_t*)jobs;
+    const uint32_t* dependency_job_ids = (const uint32_t*)dependency_jobs;
+
+    for (uint32_t j = 0; j < job_count; ++j)
+    {
+        Longtail_AtomicAdd32(&GetJob(api, job_ids[j])->m_PendingDependencyCount, (int32_t)dependency_job_count);
+    }
+
+    for (uint32_t d = 0; d < dependency_job_count; ++d)
+    {
+        struct WorkStealingJob* dependency_job = GetJob(api, dependency_job_ids[d]);
+        struct WorkStealingJobGroup* job_group = dependency_job->m_JobGroup;
+        Longtail_LockSpinLock(job_group->m_DependencyLock);
+        for (uint32_t j = 0; j < job_count; ++j)
+        {
+            struct WorkStealingDependencyBlock* block = job_group->m_DependencyBlocks;
+            if (block == 0 || block->m_Count == WORKSTEALING_DEPENDENCY_BLOCK_SIZE)
+            {
+                block = (struct WorkStealingDependencyBlock*)Longtail_Alloc(sizeof(struct WorkStealingDependencyBlock));
+                if (!block)
+                {
+                    Longtail_UnlockSpinLock(job_group->m_DependencyLock);
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_AddDependecies(%p, %u, %p, %u, %p) failed with %d",
+                        job_api, job_count, jobs, dependency_job_count, dependency_jobs,
+                        ENOMEM)
+                    return ENOMEM;
+                }
+                block->m_Next = job_group->m_DependencyBlocks;
+                block->m_Count = 0;
+                job_group->m_DependencyBlocks = block;
+            }
+            struct WorkStealingDependency* dependency = &block->m_Dependencies[block->m_Count++];
+            dependency->m_JobID = job_ids[j];
+            dependency->m_Next = dependency_job->m_Dependents;
+            dependency_job->m_Dependents = dependency;
+        }
+        Longtail_UnlockSpinLock(job_group->m_DependencyLock);
+    }
+    return 0;
+}
+
+static int WorkStealing_ReadyJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_ReadyJobs(%p, %u, %p)", job_api, job_count, jobs)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_count > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(jobs, return EINVAL)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    int err = PushJobs(api, WORKSTEALING_NO_WORKER, job_count, (const uint32_t*)jobs);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_ReadyJobs(%p, %u, %p) failed with %d",
+            job_api, job_count, jobs,
+            err)
+        return err;
+    }
+    return 0;
+}
+
+static int WorkStealing_WaitForAllJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, struct Longtail_ProgressAPI* progressAPI, struct Longtail_CancelAPI* optional_cancel_api, Longtail_CancelAPI_HCancelToken optional_cancel_token)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_WaitForAllJobs(%p, %p, %p, %p, %p)", job_api, job_group, progressAPI, optional_cancel_api, optional_cancel_token)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_group, return EINVAL)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    struct WorkStealingJobGroup* ws_job_group = (struct WorkStealingJobGroup*)job_group;
+
+    uint64_t wait_timeout = (progressAPI || (optional_cancel_api && optional_cancel_token)) ? WORKSTEALING_PROGRESS_INTERVAL_US : LONGTAIL_TIMEOUT_INFINITE;
+    if (Longtail_AtomicAdd32(&ws_job_group->m_PendingJobCount, -1) != 0)
+    {
+        while (ws_job_group->m_IsComplete == 0)
+        {
+            if (ws_job_group->m_Cancelled == 0)
+            {
+                if (progressAPI)
+                {
+                    progressAPI->OnProgress(progressAPI, ws_job_group->m_ReservedJobCount, (uint32_t)ws_job_group->m_JobsCompleted);
+                }
+                if (optional_cancel_api && optional_cancel_token)
+                {
+                    if (optional_cancel_api->IsCancelled(optional_cancel_api, optional_cancel_token) == ECANCELED)
+                    {
+                        Longtail_AtomicAdd32(&ws_job_group->m_Cancelled, 1);
+                    }
+                }
+            }
+            uint32_t job_id = TakeJob(api, WORKSTEALING_NO_WORKER);
+            if (job_id)
+            {
+                ExecuteJob(api, job_id, WORKSTEALING_NO_WORKER);
+                continue;
+            }
+            if (ws_job_group->m_PendingJobCount == 0)
+            {
+                // The last job is completing, m_IsComplete is set right after the semaphore is posted
+                continue;
+            }
+            Longtail_WaitSema(ws_job_group->m_CompleteSema, wait_timeout);
+        }
+    }
+    if (progressAPI)
+    {
+        progressAPI->OnProgress(progressAPI, (uint32_t)ws_job_group->m_SubmittedJobCount, (uint32_t)ws_job_group->m_SubmittedJobCount);
+    }
+    int is_cancelled = ws_job_group->m_Cancelled;
+
+    FreeJobIDs(api, (uint32_t)ws_job_group->m_SubmittedJobCount, ws_job_group->m_JobIDs);
+    while (ws_job_group->m_DependencyBlocks)
+    {
+        struct WorkStealingDependencyBlock* block = ws_job_group->m_DependencyBlocks;
+        ws_job_group->m_DependencyBlocks = block->m_Next;
+        Longtail_Free(block);
+    }
+    Longtail_DeleteSpinLock(ws_job_group->m_DependencyLock);
+    Longtail_DeleteSema(ws_job_group->m_CompleteSema);
+    Longtail_Free(ws_job_group);
+    if (is_cancelled)
+    {
+        return ECANCELED;
+    }
+    return 0;
+}
+
+static int WorkStealing_ResumeJob(struct Longtail_JobAPI* job_api, uint32_t job_id)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_ResumeJob(%p, %u)", job_api, job_id)
+    LONGTAIL_VALIDATE_INPUT(job_api, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_id != 0, return EINVAL)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    if (Longtail_AtomicAdd32(&GetJob(api, job_id)->m_BlockState, -1) == 0)
+    {
+        int err = PushJobs(api, WORKSTEALING_NO_WORKER, 1, &job_id);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WorkStealing_ResumeJob(%p, %u) failed with %d",
+                job_api, job_id,
+                err)
+            return err;
+        }
+    }
+    return 0;
+}
+
+static void WorkStealing_Cleanup(struct WorkStealingJobAPI* api, uint32_t thread_count, uint32_t queue_count)
+{
+    Longtail_AtomicAdd32(&api->m_Stop, 1);
+    if (thread_count > 0)
+    {
+        Longtail_PostSema(api->m_WorkSema, thread_count);
+    }
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        Longtail_JoinThread(api->m_Workers[i].m_Thread, LONGTAIL_TIMEOUT_INFINITE);
+        Longtail_DeleteThread(api->m_Workers[i].m_Thread);
+        Longtail_Free(api->m_Workers[i].m_Thread);
+    }
+    for (uint32_t q = 0; q < queue_count; ++q)
+    {
+        WorkStealingQueue_Dispose(&api->m_Queues[q]);
+    }
+    for (uint32_t p = 0; p < WORKSTEALING_MAX_JOB_PAGE_COUNT && api->m_JobPages[p]; ++p)
+    {
+        Longtail_Free(api->m_JobPages[p]);
+    }
+    arrfree(api->m_FreeJobIDs);
+    Longtail_DeleteSpinLock(api->m_JobIDLock);
+    Longtail_Free(api->m_JobIDLock);
+    Longtail_DeleteSema(api->m_WorkSema);
+    Longtail_Free(api->m_WorkSema);
+    Longtail_Free(api->m_Workers);
+    Longtail_Free(api->m_Queues);
+}
+
+static void WorkStealing_Dispose(struct Longtail_API* job_api)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WorkStealing_Dispose(%p)", job_api)
+    LONGTAIL_VALIDATE_INPUT(job_api, return)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)job_api;
+    WorkStealing_Cleanup(api, api->m_WorkerCount, api->m_QueueCount);
+    Longtail_Free(api);
+}
+
+static int WorkStealing_Init(struct WorkStealingJobAPI* api, uint32_t worker_count, int worker_priority)
+{
+    LONGTAIL_FATAL_ASSERT(api, return EINVAL)
+    api->m_JobAPI.m_API.Dispose = WorkStealing_Dispose;
+    api->m_JobAPI.GetWorkerCount = WorkStealing_GetWorkerCount;
+    api->m_JobAPI.ReserveJobs = WorkStealing_ReserveJobs;
+    api->m_JobAPI.CreateJobs = WorkStealing_CreateJobs;
+    api->m_JobAPI.AddDependecies = WorkStealing_AddDependecies;
+    api->m_JobAPI.ReadyJobs = WorkStealing_ReadyJobs;
+    api->m_JobAPI.WaitForAllJobs = WorkStealing_WaitForAllJobs;
+    api->m_JobAPI.ResumeJob = WorkStealing_ResumeJob;
+    api->m_WorkerCount = worker_count;
+    api->m_QueueCount = worker_count > 0 ? worker_count : 1;
+    api->m_WorkerPriority = worker_priority;
+    api->m_IdleWorkerCount = 0;
+    api->m_NextQueue = 0;
+    api->m_Stop = 0;
+    api->m_FreeJobIDs = 0;
+    api->m_NextJobID = 1;
+    memset(api->m_JobPages, 0, sizeof(api->m_JobPages));
+
+    int err = Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &api->m_WorkSema);
+    if (err)
+    {
+        return err;
+    }
+    err = Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &api->m_JobIDLock);
+    if (err)
+    {
+        Longtail_DeleteSema(api->m_WorkSema);
+        Longtail_Free(api->m_WorkSema);
+        return err;
+    }
+    api->m_Queues = (struct WorkStealingQueue*)Longtail_Alloc(sizeof(struct WorkStealingQueue) * api->m_QueueCount);
+    api->m_Workers = (struct WorkStealingWorker*)Longtail_Alloc(sizeof(struct WorkStealingWorker) * (worker_count > 0 ? worker_count : 1));
+    if (!api->m_Queues || !api->m_Workers)
+    {
+        WorkStealing_Cleanup(api, 0, 0);
+        return ENOMEM;
+    }
+    for (uint32_t q = 0; q < api->m_QueueCount; ++q)
+    {
+        err = WorkStealingQueue_Init(&api->m_Queues[q]);
+        if (err)
+        {
+            WorkStealing_Cleanup(api, 0, q);
+            return err;
+        }
+    }
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        struct WorkStealingWorker* worker = &api->m_Workers[i];
+        worker->m_API = api;
+        worker->m_WorkerIndex = i;
+        err = Longtail_CreateThread(Longtail_Alloc(Longtail_GetThreadSize()), WorkStealingWorker_Execute, 0, worker, worker_priority, &worker->m_Thread);
+        if (err)
+        {
+            WorkStealing_Cleanup(api, i, api->m_QueueCount);
+            return err;
+        }
+    }
+    return 0;
+}
+
+struct Longtail_JobAPI* Longtail_CreateWorkStealingJobAPI(uint32_t worker_count, int worker_priority)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateWorkStealingJobAPI(%u, %d)", worker_count, worker_priority)
+    LONGTAIL_VALIDATE_INPUT(worker_priority >= -1 && worker_priority <= 1, return 0)
+    struct WorkStealingJobAPI* api = (struct WorkStealingJobAPI*)Longtail_Alloc(sizeof(struct WorkStealingJobAPI));
+    if (!api)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateWorkStealingJobAPI(%u, %d) failed with %d",
+            worker_count, worker_priority,
+            ENOMEM)
+        return 0;
+    }
+    int err = WorkStealing_Init(api, worker_count, worker_priority);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateWorkStealingJobAPI(%u, %d) failed with %d",
+            worker_count, worker_priority,
+            err)
+        Longtail_Free(api);
+        return 0;
+    }
+    return &api->m_JobAPI;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../../src/longtail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Job API where each worker has its own job queue and idle workers steal from the other queues.
+// There is no fixed limit on the number of jobs or dependencies and WaitForAllJobs sleeps until
+// the last job in the group completes instead of polling.
+LONGTAIL_EXPORT extern struct Longtail_JobAPI* Longtail_CreateWorkStealingJobAPI(uint32_t worker_count, int worker_priority);
+
+#ifdef __cplusplus
+}
+#endif
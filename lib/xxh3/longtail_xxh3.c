@@ -0,0 +1,115 @@
+#include "longtail_xxh3.h"
+
+#define XXH_INLINE_ALL
+#include "ext/xxhash.h"
+#include <errno.h>
+
+const uint32_t LONGTAIL_XXH3_HASH_TYPE = (((uint32_t)'x') << 24) + (((uint32_t)'x') << 16) + (((uint32_t)'h') << 8) + ((uint32_t)'3');
+const uint32_t Longtail_GetXXH3HashType() { return LONGTAIL_XXH3_HASH_TYPE; }
+
+// XXH3_state_t must be 64 byte aligned, the offset to the allocation is stored in the byte before the state
+#define XXH3_STATE_ALIGNMENT 64
+
+struct XXH3HashAPI
+{
+    struct Longtail_HashAPI m_XXH3HashAPI;
+};
+
+static uint32_t XXH3Hash_GetIdentifier(struct Longtail_HashAPI* hash_api)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return 0)
+    return LONGTAIL_XXH3_HASH_TYPE;
+}
+
+static int XXH3Hash_BeginContext(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext* out_context)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_context, return EINVAL)
+    uint8_t* mem = (uint8_t*)Longtail_Alloc(sizeof(XXH3_state_t) + XXH3_STATE_ALIGNMENT);
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "XXH3Hash_BeginContext(%p, %p) failed with %d",
+            hash_api, out_context,
+            ENOMEM)
+        return ENOMEM;
+    }
+    uint8_t offset = (uint8_t)(XXH3_STATE_ALIGNMENT - ((uintptr_t)mem & (XXH3_STATE_ALIGNMENT - 1)));
+    XXH3_state_t* state = (XXH3_state_t*)&mem[offset];
+    mem[offset - 1] = offset;
+    XXH3_64bits_reset(state);
+    *out_context = (Longtail_HashAPI_HContext)state;
+    return 0;
+}
+
+static void XXH3Hash_Hash(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context, uint32_t length, const void* data)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return)
+    LONGTAIL_FATAL_ASSERT(context, return)
+    XXH3_state_t* state = (XXH3_state_t*)context;
+    XXH3_64bits_update(state, data, (size_t)length);
+}
+
+static uint64_t XXH3Hash_EndContext(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return 0)
+    LONGTAIL_FATAL_ASSERT(context, return 0)
+    XXH3_state_t* state = (XXH3_state_t*)context;
+    uint64_t hash = (uint64_t)XXH3_64bits_digest(state);
+    uint8_t* mem = (uint8_t*)state;
+    Longtail_Free(mem - mem[-1]);
+    return hash;
+}
+
+static int XXH3Hash_HashBuffer(struct Longtail_HashAPI* hash_api, uint32_t length, const void* data, uint64_t* out_hash)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(length == 0 || data, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_hash, return EINVAL)
+    *out_hash = (uint64_t)XXH3_64bits(data, (size_t)length);
+    return 0;
+}
+
+// XXH3 already spreads a single buffer over the SIMD lanes, batching only saves the call through the API per buffer
+static int XXH3Hash_HashBuffers(struct Longtail_HashAPI* hash_api, uint32_t count, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || lengths, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || data, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(count == 0 || out_hashes, return EINVAL)
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        out_hashes[i] = (uint64_t)XXH3_64bits(data[i], (size_t)lengths[i]);
+    }
+    return 0;
+}
+
+static void XXH3Hash_Dispose(struct Longtail_API* hash_api)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return)
+    Longtail_Free(hash_api);
+}
+
+static void XXH3Hash_Init(struct XXH3HashAPI* hash_api)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api, return)
+    hash_api->m_XXH3HashAPI.m_API.Dispose = XXH3Hash_Dispose;
+    hash_api->m_XXH3HashAPI.GetIdentifier = XXH3Hash_GetIdentifier;
+    hash_api->m_XXH3HashAPI.BeginContext = XXH3Hash_BeginContext;
+    hash_api->m_XXH3HashAPI.Hash = XXH3Hash_Hash;
+    hash_api->m_XXH3HashAPI.EndContext = XXH3Hash_EndContext;
+    hash_api->m_XXH3HashAPI.HashBuffer = XXH3Hash_HashBuffer;
+    hash_api->m_XXH3HashAPI.HashBuffers = XXH3Hash_HashBuffers;
+}
+
+struct Longtail_HashAPI* Longtail_CreateXXH3HashAPI()
+{
+    struct XXH3HashAPI* xxh3_hash = (struct XXH3HashAPI*)Longtail_Alloc(sizeof(struct XXH3HashAPI));
+    if (!xxh3_hash)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateXXH3HashAPI() failed with %d",
+            ENOMEM)
+        return 0;
+    }
+    XXH3Hash_Init(xxh3_hash);
+    return &xxh3_hash->m_XXH3HashAPI;
+}
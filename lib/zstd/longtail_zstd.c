@@ -1,10 +1,14 @@
 #include "longtail_zstd.h"
 
+#include "../../src/ext/stb_ds.h"
+#include "../longtail_platform.h"
+#define ZSTD_STATIC_LINKING_ONLY
 #include "ext/zstd.h"
 #include "ext/common/zstd_errors.h"
 
 #include <errno.h>
 #include <inttypes.h>
+#include <string.h>
 
 
 const int LONGTAIL_ZSTD_MIN_COMPRESSION_LEVEL      = 0;
@@ -14,10 +18,20 @@ const int LONGTAIL_ZSTD_MAX_COMPRESSION_LEVEL      = 19;
 #define LONGTAIL_ZSTD_MIN_COMPRESSION_TYPE     ((((uint32_t)'z') << 24) + (((uint32_t)'t') << 16) + (((uint32_t)'d') << 8) + ((uint32_t)'1'))
 #define LONGTAIL_ZSTD_DEFAULT_COMPRESSION_TYPE ((((uint32_t)'z') << 24) + (((uint32_t)'t') << 16) + (((uint32_t)'d') << 8) + ((uint32_t)'2'))
 #define LONGTAIL_ZSTD_MAX_COMPRESSION_TYPE     ((((uint32_t)'z') << 24) + (((uint32_t)'t') << 16) + (((uint32_t)'d') << 8) + ((uint32_t)'3'))
+#define LONGTAIL_ZSTD_MAX_MT_COMPRESSION_TYPE  ((((uint32_t)'z') << 24) + (((uint32_t)'t') << 16) + (((uint32_t)'m') << 8) + ((uint32_t)'3'))
+
+// Smallest slice of a block handed to a zstd worker, same as ZSTDMT_JOBSIZE_MIN
+#define LONGTAIL_ZSTD_MT_JOB_SIZE (1024u * 1024u)
 
 uint32_t Longtail_GetZStdMinQuality() { return LONGTAIL_ZSTD_MIN_COMPRESSION_TYPE; }
 uint32_t Longtail_GetZStdDefaultQuality() { return LONGTAIL_ZSTD_DEFAULT_COMPRESSION_TYPE; }
 uint32_t Longtail_GetZStdMaxQuality() { return LONGTAIL_ZSTD_MAX_COMPRESSION_TYPE; }
+uint32_t Longtail_GetZStdMaxMTQuality() { return LONGTAIL_ZSTD_MAX_MT_COMPRESSION_TYPE; }
+
+#define LONGTAIL_ZSTD_DICTIONARY_COMPRESSION_TYPE ((((uint32_t)'z') << 24) + (((uint32_t)'d') << 16))
+
+uint32_t Longtail_GetZStdDictionaryCompressionType(uint16_t dictionary_id) { return LONGTAIL_ZSTD_DICTIONARY_COMPRESSION_TYPE + dictionary_id; }
+int Longtail_IsZStdDictionaryCompressionType(uint32_t compression_type) { return (compression_type & 0xffff0000u) == LONGTAIL_ZSTD_DICTIONARY_COMPRESSION_TYPE; }
 
 static int SettingsIDToCompressionSetting(uint32_t settings_id)
 {
@@ -28,22 +42,154 @@ static int SettingsIDToCompressionSetting(uint32_t settings_id)
         case LONGTAIL_ZSTD_DEFAULT_COMPRESSION_TYPE:
             return LONGTAIL_ZSTD_DEFAULT_COMPRESSION_LEVEL;
         case LONGTAIL_ZSTD_MAX_COMPRESSION_TYPE:
+        case LONGTAIL_ZSTD_MAX_MT_COMPRESSION_TYPE:
             return LONGTAIL_ZSTD_MAX_COMPRESSION_LEVEL;
        default:
            return 0;
     }
 }
 
+// Contexts are pooled so a block does not pay for context creation and its allocations,
+// the pool grows to the number of concurrent compress/decompress calls.
+// There is only one multithreaded context since it owns a worker pool sized to the CPU count,
+// blocks that are compressed while it is busy fall back to a single threaded context.
 struct ZStdCompressionAPI
 {
     struct Longtail_CompressionAPI m_ZStdCompressionAPI;
+    HLongtail_SpinLock m_Lock;
+    ZSTD_CCtx** m_CompressionContexts;
+    ZSTD_CCtx* m_MTCompressionContext;
+    int m_MTCompressionContextBusy;
+    ZSTD_DCtx** m_DecompressionContexts;
+    ZSTD_CDict* m_CDict;
+    ZSTD_DDict* m_DDict;
 };
 
 void ZStdCompressionAPI_Dispose(struct Longtail_API* compression_api)
 {
+    struct ZStdCompressionAPI* api = (struct ZStdCompressionAPI*)compression_api;
+    for (ptrdiff_t i = 0; i < arrlen(api->m_CompressionContexts); ++i)
+    {
+        ZSTD_freeCCtx(api->m_CompressionContexts[i]);
+    }
+    arrfree(api->m_CompressionContexts);
+    ZSTD_freeCCtx(api->m_MTCompressionContext);
+    for (ptrdiff_t i = 0; i < arrlen(api->m_DecompressionContexts); ++i)
+    {
+        ZSTD_freeDCtx(api->m_DecompressionContexts[i]);
+    }
+    arrfree(api->m_DecompressionContexts);
+    ZSTD_freeCDict(api->m_CDict);
+    ZSTD_freeDDict(api->m_DDict);
+    Longtail_DeleteSpinLock(api->m_Lock);
+    Longtail_Free(api->m_Lock);
     Longtail_Free(compression_api);
 }
 
+// Context workspaces go through Longtail_Alloc like the rest of the library
+static void* ZStdCompressionAPI_Alloc(void* opaque, size_t size)
+{
+    return Longtail_Alloc(size);
+}
+
+static void ZStdCompressionAPI_Free(void* opaque, void* address)
+{
+    Longtail_Free(address);
+}
+
+static const ZSTD_customMem ZStdCompressionAPI_CustomMem = { ZStdCompressionAPI_Alloc, ZStdCompressionAPI_Free, 0 };
+
+static ZSTD_CCtx* ZStdCompressionAPI_AcquireCCtx(struct ZStdCompressionAPI* api)
+{
+    ZSTD_CCtx* cctx = 0;
+    Longtail_LockSpinLock(api->m_Lock);
+    if (arrlen(api->m_CompressionContexts) > 0)
+    {
+        cctx = arrpop(api->m_CompressionContexts);
+    }
+    Longtail_UnlockSpinLock(api->m_Lock);
+    return cctx ? cctx : ZSTD_createCCtx_advanced(ZStdCompressionAPI_CustomMem);
+}
+
+static void ZStdCompressionAPI_ReleaseCCtx(struct ZStdCompressionAPI* api, ZSTD_CCtx* cctx)
+{
+    Longtail_LockSpinLock(api->m_Lock);
+    arrput(api->m_CompressionContexts, cctx);
+    Longtail_UnlockSpinLock(api->m_Lock);
+}
+
+static ZSTD_CCtx* ZStdCompressionAPI_CreateMTCCtx()
+{
+    ZSTD_CCtx* cctx = ZSTD_createCCtx_advanced(ZStdCompressionAPI_CustomMem);
+    if (!cctx)
+    {
+        return 0;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, LONGTAIL_ZSTD_MAX_COMPRESSION_LEVEL);
+    // Fails if zstd is built without ZSTD_MULTITHREAD, the context then compresses on the calling thread
+    size_t err = ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int)Longtail_GetCPUCount());
+    if (ZSTD_isError(err))
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "ZStdCompressionAPI_CreateMTCCtx() zstd multithreading is not available, %s", ZSTD_getErrorName(err))
+        return cctx;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_jobSize, LONGTAIL_ZSTD_MT_JOB_SIZE);
+    return cctx;
+}
+
+// Returns 0 if the multithreaded context is in use
+static ZSTD_CCtx* ZStdCompressionAPI_AcquireMTCCtx(struct ZStdCompressionAPI* api)
+{
+    Longtail_LockSpinLock(api->m_Lock);
+    if (api->m_MTCompressionContextBusy)
+    {
+        Longtail_UnlockSpinLock(api->m_Lock);
+        return 0;
+    }
+    api->m_MTCompressionContextBusy = 1;
+    ZSTD_CCtx* cctx = api->m_MTCompressionContext;
+    Longtail_UnlockSpinLock(api->m_Lock);
+    if (!cctx)
+    {
+        cctx = ZStdCompressionAPI_CreateMTCCtx();
+        if (!cctx)
+        {
+            Longtail_LockSpinLock(api->m_Lock);
+            api->m_MTCompressionContextBusy = 0;
+            Longtail_UnlockSpinLock(api->m_Lock);
+            return 0;
+        }
+    }
+    return cctx;
+}
+
+static void ZStdCompressionAPI_ReleaseMTCCtx(struct ZStdCompressionAPI* api, ZSTD_CCtx* cctx)
+{
+    Longtail_LockSpinLock(api->m_Lock);
+    api->m_MTCompressionContext = cctx;
+    api->m_MTCompressionContextBusy = 0;
+    Longtail_UnlockSpinLock(api->m_Lock);
+}
+
+static ZSTD_DCtx* ZStdCompressionAPI_AcquireDCtx(struct ZStdCompressionAPI* api)
+{
+    ZSTD_DCtx* dctx = 0;
+    Longtail_LockSpinLock(api->m_Lock);
+    if (arrlen(api->m_DecompressionContexts) > 0)
+    {
+        dctx = arrpop(api->m_DecompressionContexts);
+    }
+    Longtail_UnlockSpinLock(api->m_Lock);
+    return dctx ? dctx : ZSTD_createDCtx_advanced(ZStdCompressionAPI_CustomMem);
+}
+
+static void ZStdCompressionAPI_ReleaseDCtx(struct ZStdCompressionAPI* api, ZSTD_DCtx* dctx)
+{
+    Longtail_LockSpinLock(api->m_Lock);
+    arrput(api->m_DecompressionContexts, dctx);
+    Longtail_UnlockSpinLock(api->m_Lock);
+}
+
 static size_t ZStdCompressionAPI_GetMaxCompressedSize(struct Longtail_CompressionAPI* compression_api, uint32_t settings_id, size_t size)
 {
     return ZSTD_COMPRESSBOUND(size);
@@ -51,8 +197,42 @@ static size_t ZStdCompressionAPI_GetMaxCompressedSize(struct Longtail_Compressio
 
 int ZStdCompressionAPI_Compress(struct Longtail_CompressionAPI* compression_api, uint32_t settings_id, const char* uncompressed, char* compressed, size_t uncompressed_size, size_t max_compressed_size, size_t* out_compressed_size)
 {
+    struct ZStdCompressionAPI* api = (struct ZStdCompressionAPI*)compression_api;
     int compression_setting = SettingsIDToCompressionSetting(settings_id);
-    size_t size = ZSTD_compress( compressed, max_compressed_size, uncompressed, uncompressed_size, compression_setting);
+
+    // A single large block otherwise keeps one core busy at the maximum level while the rest idle
+    if (settings_id == LONGTAIL_ZSTD_MAX_MT_COMPRESSION_TYPE && !api->m_CDict && uncompressed_size > LONGTAIL_ZSTD_MT_JOB_SIZE)
+    {
+        ZSTD_CCtx* mt_cctx = ZStdCompressionAPI_AcquireMTCCtx(api);
+        if (mt_cctx)
+        {
+            size_t size = ZSTD_compress2(mt_cctx, compressed, max_compressed_size, uncompressed, uncompressed_size);
+            ZStdCompressionAPI_ReleaseMTCCtx(api, mt_cctx);
+            if (ZSTD_isError(size))
+            {
+                int err = ZSTD_getErrorCode(size);
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ZStdCompressionAPI_Compress(%p, %u, %p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+                    compression_api, settings_id, uncompressed, compressed, uncompressed_size, max_compressed_size, out_compressed_size,
+                    err);
+                return EINVAL;
+            }
+            *out_compressed_size = size;
+            return 0;
+        }
+    }
+
+    ZSTD_CCtx* cctx = ZStdCompressionAPI_AcquireCCtx(api);
+    if (!cctx)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ZStdCompressionAPI_Compress(%p, %u, %p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+            compression_api, settings_id, uncompressed, compressed, uncompressed_size, max_compressed_size, out_compressed_size,
+            ENOMEM);
+        return ENOMEM;
+    }
+    size_t size = api->m_CDict ?
+        ZSTD_compress_usingCDict(cctx, compressed, max_compressed_size, uncompressed, uncompressed_size, api->m_CDict) :
+        ZSTD_compressCCtx(cctx, compressed, max_compressed_size, uncompressed, uncompressed_size, compression_setting);
+    ZStdCompressionAPI_ReleaseCCtx(api, cctx);
     if (ZSTD_isError(size))
     {
         int err = ZSTD_getErrorCode(size);
@@ -68,7 +248,19 @@ int ZStdCompressionAPI_Compress(struct Longtail_CompressionAPI* compression_api,
 
 int ZStdCompressionAPI_Decompress(struct Longtail_CompressionAPI* compression_api, const char* compressed, char* uncompressed, size_t compressed_size, size_t max_uncompressed_size, size_t* out_uncompressed_size)
 {
-    size_t size = ZSTD_decompress( uncompressed, max_uncompressed_size, compressed, compressed_size);
+    struct ZStdCompressionAPI* api = (struct ZStdCompressionAPI*)compression_api;
+    ZSTD_DCtx* dctx = ZStdCompressionAPI_AcquireDCtx(api);
+    if (!dctx)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ZStdCompressionAPI_Decompress(%p, %p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
+            compression_api, compressed, uncompressed, compressed_size, max_uncompressed_size, out_uncompressed_size,
+            ENOMEM);
+        return ENOMEM;
+    }
+    size_t size = api->m_DDict ?
+        ZSTD_decompress_usingDDict(dctx, uncompressed, max_uncompressed_size, compressed, compressed_size, api->m_DDict) :
+        ZSTD_decompressDCtx(dctx, uncompressed, max_uncompressed_size, compressed, compressed_size);
+    ZStdCompressionAPI_ReleaseDCtx(api, dctx);
     if (ZSTD_isError(size))
     {
         int err = ZSTD_getErrorCode(size);
@@ -81,12 +273,19 @@ int ZStdCompressionAPI_Decompress(struct Longtail_CompressionAPI* compression_ap
     return 0;
 }
 
-static void ZStdCompressionAPI_Init(struct ZStdCompressionAPI* compression_api)
+static int ZStdCompressionAPI_Init(struct ZStdCompressionAPI* compression_api)
 {
     compression_api->m_ZStdCompressionAPI.m_API.Dispose = ZStdCompressionAPI_Dispose;
     compression_api->m_ZStdCompressionAPI.GetMaxCompressedSize = ZStdCompressionAPI_GetMaxCompressedSize;
     compression_api->m_ZStdCompressionAPI.Compress = ZStdCompressionAPI_Compress;
     compression_api->m_ZStdCompressionAPI.Decompress = ZStdCompressionAPI_Decompress;
+    compression_api->m_CompressionContexts = 0;
+    compression_api->m_MTCompressionContext = 0;
+    compression_api->m_MTCompressionContextBusy = 0;
+    compression_api->m_DecompressionContexts = 0;
+    compression_api->m_CDict = 0;
+    compression_api->m_DDict = 0;
+    return Longtail_CreateSpinLock(Longtail_Alloc(Longtail_GetSpinLockSize()), &compression_api->m_Lock);
 }
 
 struct Longtail_CompressionAPI* Longtail_CreateZStdCompressionAPI()
@@ -98,6 +297,113 @@ struct Longtail_CompressionAPI* Longtail_CreateZStdCompressionAPI()
             ENOMEM)
         return 0;
     }
-    ZStdCompressionAPI_Init(compression_api);
+    int err = ZStdCompressionAPI_Init(compression_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdCompressionAPI() failed with %d",
+            err)
+        Longtail_Free(compression_api);
+        return 0;
+    }
     return &compression_api->m_ZStdCompressionAPI;
 }
+
+struct Longtail_CompressionAPI* Longtail_CreateZStdDictionaryCompressionAPI(
+    const void* dictionary_data,
+    size_t dictionary_size)
+{
+    LONGTAIL_VALIDATE_INPUT(dictionary_data, return 0)
+    LONGTAIL_VALIDATE_INPUT(dictionary_size > 0, return 0)
+    struct ZStdCompressionAPI* compression_api = (struct ZStdCompressionAPI*)Longtail_Alloc(sizeof(struct ZStdCompressionAPI));
+    if (!compression_api)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionaryCompressionAPI(%p, %" PRIu64 ") failed with %d",
+            dictionary_data, (uint64_t)dictionary_size,
+            ENOMEM)
+        return 0;
+    }
+    int err = ZStdCompressionAPI_Init(compression_api);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionaryCompressionAPI(%p, %" PRIu64 ") failed with %d",
+            dictionary_data, (uint64_t)dictionary_size,
+            err)
+        Longtail_Free(compression_api);
+        return 0;
+    }
+    compression_api->m_CDict = ZSTD_createCDict(dictionary_data, dictionary_size, LONGTAIL_ZSTD_DEFAULT_COMPRESSION_LEVEL);
+    compression_api->m_DDict = ZSTD_createDDict(dictionary_data, dictionary_size);
+    if (!compression_api->m_CDict || !compression_api->m_DDict)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionaryCompressionAPI(%p, %" PRIu64 ") failed with %d",
+            dictionary_data, (uint64_t)dictionary_size,
+            ENOMEM)
+        ZStdCompressionAPI_Dispose(&compression_api->m_ZStdCompressionAPI.m_API);
+        return 0;
+    }
+    return &compression_api->m_ZStdCompressionAPI;
+}
+
+int Longtail_CreateZStdDictionary(
+    uint32_t sample_count,
+    const void* const* samples,
+    const size_t* sample_sizes,
+    size_t max_dictionary_size,
+    void** out_dictionary_data,
+    size_t* out_dictionary_size)
+{
+    LONGTAIL_VALIDATE_INPUT(sample_count == 0 || samples != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(sample_count == 0 || sample_sizes != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(max_dictionary_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_dictionary_data, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_dictionary_size, return EINVAL)
+
+    uint64_t total_sample_size = 0;
+    for (uint32_t s = 0; s < sample_count; ++s)
+    {
+        total_sample_size += sample_sizes[s];
+    }
+    if (total_sample_size == 0)
+    {
+        return ENOENT;
+    }
+    size_t dictionary_size = total_sample_size < max_dictionary_size ? (size_t)total_sample_size : max_dictionary_size;
+    char* dictionary_data = (char*)Longtail_Alloc(dictionary_size);
+    if (!dictionary_data)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateZStdDictionary(%u, %p, %p, %" PRIu64 ", %p, %p) failed with %d",
+            sample_count, samples, sample_sizes, (uint64_t)max_dictionary_size, out_dictionary_data, out_dictionary_size,
+            ENOMEM)
+        return ENOMEM;
+    }
+
+    // Zstd does not vendor the dictionary trainer, a raw content dictionary made of samples picked
+    // evenly over the sample set captures the shared structure of small files well enough.
+    // Content closer to the end of a raw dictionary is cheaper to reference so the samples
+    // are laid out back to front.
+    uint64_t stride = total_sample_size / dictionary_size;
+    uint64_t next_pick = 0;
+    uint64_t sample_start = 0;
+    size_t write_end = dictionary_size;
+    for (uint32_t s = 0; s < sample_count && write_end > 0; ++s)
+    {
+        size_t sample_size = sample_sizes[s];
+        uint64_t sample_end = sample_start + sample_size;
+        if (sample_size > 0 && sample_end > next_pick)
+        {
+            size_t copy_size = sample_size < write_end ? sample_size : write_end;
+            write_end -= copy_size;
+            memcpy(&dictionary_data[write_end], samples[s], copy_size);
+            next_pick = sample_start + (uint64_t)sample_size * stride;
+        }
+        sample_start = sample_end;
+    }
+    if (write_end > 0)
+    {
+        memmove(dictionary_data, &dictionary_data[write_end], dictionary_size - write_end);
+        dictionary_size -= write_end;
+    }
+    *out_dictionary_data = dictionary_data;
+    *out_dictionary_size = dictionary_size;
+    return 0;
+}
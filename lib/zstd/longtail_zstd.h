@@ -12,6 +12,30 @@ LONGTAIL_EXPORT extern uint32_t Longtail_GetZStdMinQuality();
 LONGTAIL_EXPORT extern uint32_t Longtail_GetZStdDefaultQuality();
 LONGTAIL_EXPORT extern uint32_t Longtail_GetZStdMaxQuality();
 
+// Maximum quality where blocks larger than 1 MB are split over one zstd worker thread per core.
+// The output is a regular zstd frame, decompression is the same as for the other qualities
+LONGTAIL_EXPORT extern uint32_t Longtail_GetZStdMaxMTQuality();
+
+// Dictionary compression types reference a dictionary by a 16 bit id, the dictionary is
+// not part of the compressed data so it must be available when decompressing
+LONGTAIL_EXPORT extern uint32_t Longtail_GetZStdDictionaryCompressionType(uint16_t dictionary_id);
+LONGTAIL_EXPORT extern int Longtail_IsZStdDictionaryCompressionType(uint32_t compression_type);
+
+// Compresses at the default zstd level using dictionary_data which is copied
+LONGTAIL_EXPORT extern struct Longtail_CompressionAPI* Longtail_CreateZStdDictionaryCompressionAPI(
+    const void* dictionary_data,
+    size_t dictionary_size);
+
+// Creates a raw content dictionary of at most max_dictionary_size bytes from samples spread over
+// the sample set. The dictionary is allocated with Longtail_Alloc()
+LONGTAIL_EXPORT extern int Longtail_CreateZStdDictionary(
+    uint32_t sample_count,
+    const void* const* samples,
+    const size_t* sample_sizes,
+    size_t max_dictionary_size,
+    void** out_dictionary_data,
+    size_t* out_dictionary_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,11 +2,17 @@
 #define _CRTDBG_MAP_ALLOC
 #include <cstdlib>
 #include <crtdbg.h>
-#endif
-
 #include <intrin.h>
+#endif
 
+#include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
 #define SOKOL_IMPL
 #include "ext/sokol_time.h"
@@ -14,10 +20,25 @@
 #include "../src/ext/stb_ds.h"
 
 #include "../src/longtail.h"
+#include "../lib/longtail_platform.h"
+#include "../lib/bikeshed/longtail_bikeshed.h"
+#include "../lib/blake2/longtail_blake2.h"
+#include "../lib/blake3/longtail_blake3.h"
+#include "../lib/compressblockstore/longtail_compressblockstore.h"
+#include "../lib/compressionregistry/longtail_full_compression_registry.h"
 #include "../lib/filestorage/longtail_filestorage.h"
-
-
-struct Longtail_LookupTable
+#include "../lib/fsblockstore/longtail_fsblockstore.h"
+#include "../lib/fastcdcchunker/longtail_fastcdcchunker.h"
+#include "../lib/hpcdcchunker/longtail_hpcdcchunker.h"
+#include "../lib/lrublockstore/longtail_lrublockstore.h"
+#include "../lib/meowhash/longtail_meowhash.h"
+#include "../lib/shareblockstore/longtail_shareblockstore.h"
+#include "../lib/xxh3/longtail_xxh3.h"
+#include "../lib/zstd/longtail_zstd.h"
+
+
+// The chained table Longtail_LookupTable used to be, kept as a baseline
+struct ChainedLookupTable
 {
     uint64_t  m_BucketCount;
 
@@ -31,17 +52,17 @@ struct Longtail_LookupTable
     uint64_t* m_NextIndex;
 };
 
-static uint64_t Longtail_LookupTable_Capacity(struct Longtail_LookupTable* lut)
+static uint64_t ChainedLookupTable_Capacity(struct ChainedLookupTable* lut)
 {
     return lut->m_Capacity;
 }
 
-static uint64_t Longtail_LookupTable_Size(struct Longtail_LookupTable* lut)
+static uint64_t ChainedLookupTable_Size(struct ChainedLookupTable* lut)
 {
     return lut->m_Count;
 }
 
-static int Longtail_LookupTable_Put(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value)
+static int ChainedLookupTable_Put(struct ChainedLookupTable* lut, uint64_t key, uint64_t value)
 {
     if (lut->m_NextFreeIndex == lut->m_Capacity)
     {
@@ -75,7 +96,7 @@ static int Longtail_LookupTable_Put(struct Longtail_LookupTable* lut, uint64_t k
     return 0;
 }
 
-static uint64_t Longtail_LookupTable_Get(struct Longtail_LookupTable* lut, uint64_t key)
+static uint64_t ChainedLookupTable_Get(struct ChainedLookupTable* lut, uint64_t key)
 {
     uint64_t bucket_index = key & (lut->m_BucketCount - 1);
     uint64_t index = lut->m_Buckets[bucket_index];
@@ -90,19 +111,19 @@ static uint64_t Longtail_LookupTable_Get(struct Longtail_LookupTable* lut, uint6
     return 0xfffffffffffffffful;
 }
 
-static struct Longtail_LookupTable* Longtail_LookupTable_Create(size_t capacity, struct Longtail_LookupTable* optional_source_entries)
+static struct ChainedLookupTable* ChainedLookupTable_Create(size_t capacity, struct ChainedLookupTable* optional_source_entries)
 {
     size_t table_size = 1;
-    while (table_size < (capacity / 2))
+    while (table_size < (capacity / 8))
     {
         table_size <<= 1;
     }
-    size_t mem_size = sizeof(struct Longtail_LookupTable) +
+    size_t mem_size = sizeof(struct ChainedLookupTable) +
         sizeof(uint64_t) * table_size +
         sizeof(uint64_t) * capacity +
         sizeof(uint64_t) * capacity +
         sizeof(uint64_t) * capacity;
-    struct Longtail_LookupTable* lut = (struct Longtail_LookupTable*)Longtail_Alloc(mem_size);
+    struct ChainedLookupTable* lut = (struct ChainedLookupTable*)Longtail_Alloc(mem_size);
     if (!lut)
     {
         return 0;
@@ -129,7 +150,7 @@ static struct Longtail_LookupTable* Longtail_LookupTable_Create(size_t capacity,
                 {
                     uint64_t key = optional_source_entries->m_Keys[index];
                     uint64_t value = optional_source_entries->m_Values[index];
-                    Longtail_LookupTable_Put(lut, key, value);
+                    ChainedLookupTable_Put(lut, key, value);
                     index = optional_source_entries->m_NextIndex[index];
                 }
             }
@@ -244,32 +265,32 @@ uint64_t TestLookupHashMapSpeed(
     return stm_now() - start;
 }
 
-uint64_t TestCreateBlockHashTableSpeed(struct Longtail_ContentIndex* content_index, struct Longtail_LookupTable** block_hash_table, struct Longtail_LookupTable** chunk_hash_table)
+uint64_t TestCreateBlockHashTableSpeed(struct Longtail_ContentIndex* content_index, struct ChainedLookupTable** block_hash_table, struct ChainedLookupTable** chunk_hash_table)
 {
     uint64_t start = stm_now();
 
     uint64_t block_count = *content_index->m_BlockCount;
     uint64_t chunk_count = *content_index->m_ChunkCount;
 
-    *block_hash_table = Longtail_LookupTable_Create(block_count, 0);
-    *chunk_hash_table = Longtail_LookupTable_Create(chunk_count, 0);
+    *block_hash_table = ChainedLookupTable_Create(block_count, 0);
+    *chunk_hash_table = ChainedLookupTable_Create(chunk_count, 0);
 
     for (uint64_t b = 0; b < block_count; ++b)
     {
-        Longtail_LookupTable_Put(*block_hash_table, content_index->m_BlockHashes[b], b);
+        ChainedLookupTable_Put(*block_hash_table, content_index->m_BlockHashes[b], b);
     }
 
     for (uint64_t c = 0; c < chunk_count; ++c)
     {
-        Longtail_LookupTable_Put(*chunk_hash_table, content_index->m_ChunkHashes[c], c);
+        ChainedLookupTable_Put(*chunk_hash_table, content_index->m_ChunkHashes[c], c);
     }
     return stm_now() - start;
 }
 
 uint64_t TestLookupBlockHashTableSpeed(
     struct Longtail_ContentIndex* content_index,
-    struct Longtail_LookupTable* block_lookup_table,
-    struct Longtail_LookupTable* chunk_lookup_table)
+    struct ChainedLookupTable* block_lookup_table,
+    struct ChainedLookupTable* chunk_lookup_table)
 {
     uint64_t start = stm_now();
 
@@ -278,7 +299,7 @@ uint64_t TestLookupBlockHashTableSpeed(
 
     for (uint64_t b = 0; b < block_count; ++b)
     {
-        uint64_t index = Longtail_LookupTable_Get(block_lookup_table, content_index->m_BlockHashes[b]);
+        uint64_t index = ChainedLookupTable_Get(block_lookup_table, content_index->m_BlockHashes[b]);
         if (index == 0xfffffffffffffffful)
         {
             return (uint64_t)-1;
@@ -291,7 +312,7 @@ uint64_t TestLookupBlockHashTableSpeed(
 
     for (uint64_t c = 0; c < chunk_count; ++c)
     {
-        uint64_t index = Longtail_LookupTable_Get(chunk_lookup_table, content_index->m_ChunkHashes[c]);
+        uint64_t index = ChainedLookupTable_Get(chunk_lookup_table, content_index->m_ChunkHashes[c]);
         if (index == 0xfffffffffffffffful)
         {
             return (uint64_t)-1;
@@ -304,7 +325,1003 @@ uint64_t TestLookupBlockHashTableSpeed(
     return stm_now() - start;
 }
 
+uint64_t TestCreateLookupTableSpeed(
+    uint64_t count,
+    const TLongtail_Hash* hashes,
+    struct Longtail_LookupTable** out_lookup_table)
+{
+    uint64_t start = stm_now();
+
+    struct Longtail_LookupTable* lut = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(count)), count, 0);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        Longtail_LookupTable_Put(lut, hashes[i], i);
+    }
+    *out_lookup_table = lut;
+    return stm_now() - start;
+}
+
+uint64_t TestLookupLookupTableSpeed(
+    uint64_t count,
+    const TLongtail_Hash* hashes,
+    struct Longtail_LookupTable* lookup_table)
+{
+    uint64_t start = stm_now();
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const uint64_t* index = Longtail_LookupTable_Get(lookup_table, hashes[i]);
+        if (index == 0 || *index != i)
+        {
+            return (uint64_t)-1;
+        }
+    }
+    return stm_now() - start;
+}
+
+uint64_t TestBatchLookupLookupTableSpeed(
+    uint64_t count,
+    const TLongtail_Hash* hashes,
+    struct Longtail_LookupTable* lookup_table)
+{
+    uint64_t start = stm_now();
+
+    uint64_t* indexes[256];
+    for (uint64_t i = 0; i < count; i += 256)
+    {
+        uint64_t batch_count = count - i < 256 ? count - i : 256;
+        Longtail_LookupTable_GetBatch(lookup_table, batch_count, &hashes[i], indexes);
+        for (uint64_t b = 0; b < batch_count; ++b)
+        {
+            if (indexes[b] == 0 || *indexes[b] != i + b)
+            {
+                return (uint64_t)-1;
+            }
+        }
+    }
+    return stm_now() - start;
+}
+
+uint64_t TestCreateChainedLookupTableSpeed(
+    uint64_t count,
+    const TLongtail_Hash* hashes,
+    struct ChainedLookupTable** out_lookup_table)
+{
+    uint64_t start = stm_now();
+
+    struct ChainedLookupTable* lut = ChainedLookupTable_Create(count, 0);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        ChainedLookupTable_Put(lut, hashes[i], i);
+    }
+    *out_lookup_table = lut;
+    return stm_now() - start;
+}
+
+uint64_t TestLookupChainedLookupTableSpeed(
+    uint64_t count,
+    const TLongtail_Hash* hashes,
+    struct ChainedLookupTable* lookup_table)
+{
+    uint64_t start = stm_now();
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (ChainedLookupTable_Get(lookup_table, hashes[i]) != i)
+        {
+            return (uint64_t)-1;
+        }
+    }
+    return stm_now() - start;
+}
+
+// Chunk hash lookups of a store with chunk_count chunks, lookups are done in random order like
+// they are when resolving the chunks of a version
+static void RunLookupTableBenchmarks(uint64_t chunk_count)
+{
+    TLongtail_Hash* hashes = (TLongtail_Hash*)Longtail_Alloc(sizeof(TLongtail_Hash) * chunk_count);
+    TLongtail_Hash* lookup_hashes = (TLongtail_Hash*)Longtail_Alloc(sizeof(TLongtail_Hash) * chunk_count);
+    uint64_t* lookup_indexes = (uint64_t*)Longtail_Alloc(sizeof(uint64_t) * chunk_count);
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    for (uint64_t i = 0; i < chunk_count; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        hashes[i] = seed;
+        lookup_indexes[i] = i;
+    }
+    for (uint64_t i = chunk_count - 1; i > 0; --i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        uint64_t j = seed % (i + 1);
+        uint64_t tmp = lookup_indexes[i];
+        lookup_indexes[i] = lookup_indexes[j];
+        lookup_indexes[j] = tmp;
+    }
+
+    printf("Lookup table benchmarks, %" PRIu64 " chunks\n", chunk_count);
+
+    struct ChainedLookupTable* chained_lut = 0;
+    uint64_t chained_create_ticks = TestCreateChainedLookupTableSpeed(chunk_count, hashes, &chained_lut);
+    printf("TestCreateChainedLookupTableSpeed: %.3lf ms\n", stm_ms(chained_create_ticks));
+    uint64_t chained_lookup_ticks = TestLookupChainedLookupTableSpeed(chunk_count, hashes, chained_lut);
+    printf("TestLookupChainedLookupTableSpeed: %.3lf ms\n", stm_ms(chained_lookup_ticks));
+    Longtail_Free(chained_lut);
+
+    struct Longtail_LookupTable* lut = 0;
+    uint64_t create_ticks = TestCreateLookupTableSpeed(chunk_count, hashes, &lut);
+    printf("TestCreateLookupTableSpeed: %.3lf ms\n", stm_ms(create_ticks));
+    uint64_t lookup_ticks = TestLookupLookupTableSpeed(chunk_count, hashes, lut);
+    printf("TestLookupLookupTableSpeed: %.3lf ms\n", stm_ms(lookup_ticks));
+    uint64_t batch_lookup_ticks = TestBatchLookupLookupTableSpeed(chunk_count, hashes, lut);
+    printf("TestBatchLookupLookupTableSpeed: %.3lf ms\n", stm_ms(batch_lookup_ticks));
+
+    // Random order defeats the hardware prefetcher the sequential runs above get for the keys
+    uint64_t random_start = stm_now();
+    for (uint64_t i = 0; i < chunk_count; ++i)
+    {
+        lookup_hashes[i] = hashes[lookup_indexes[i]];
+    }
+    uint64_t* indexes[256];
+    for (uint64_t i = 0; i < chunk_count; i += 256)
+    {
+        uint64_t batch_count = chunk_count - i < 256 ? chunk_count - i : 256;
+        Longtail_LookupTable_GetBatch(lut, batch_count, &lookup_hashes[i], indexes);
+        for (uint64_t b = 0; b < batch_count; ++b)
+        {
+            if (indexes[b] == 0 || *indexes[b] != lookup_indexes[i + b])
+            {
+                printf("TestRandomBatchLookupLookupTableSpeed: lookup failed\n");
+                break;
+            }
+        }
+    }
+    printf("TestRandomBatchLookupLookupTableSpeed: %.3lf ms\n", stm_ms(stm_now() - random_start));
+    Longtail_Free(lut);
+
+    Longtail_Free(lookup_indexes);
+    Longtail_Free(lookup_hashes);
+    Longtail_Free(hashes);
+}
+
+struct ChunkerBenchmarkFeeder
+{
+    const uint8_t* m_Data;
+    uint64_t m_Size;
+    uint64_t m_Offset;
+};
+
+static int ChunkerBenchmarkFeed(void* context, Longtail_ChunkerAPI_HChunker chunker, uint32_t requested_size, char* buffer, uint32_t* out_size)
+{
+    struct ChunkerBenchmarkFeeder* feeder = (struct ChunkerBenchmarkFeeder*)context;
+    uint64_t left = feeder->m_Size - feeder->m_Offset;
+    uint32_t size = left < requested_size ? (uint32_t)left : requested_size;
+    memcpy(buffer, &feeder->m_Data[feeder->m_Offset], size);
+    feeder->m_Offset += size;
+    *out_size = size;
+    return 0;
+}
+
+static void RunChunkerBenchmark(const char* name, struct Longtail_ChunkerAPI* chunker_api, const uint8_t* data, uint64_t size, uint32_t target_chunk_size)
+{
+    uint32_t min_chunk_size;
+    chunker_api->GetMinChunkSize(chunker_api, &min_chunk_size);
+    // Same parameters as used when creating a version index
+    uint32_t min = target_chunk_size / 8 < min_chunk_size ? min_chunk_size : target_chunk_size / 8;
+    uint32_t avg = target_chunk_size / 2 < min_chunk_size ? min_chunk_size : target_chunk_size / 2;
+    uint32_t max = target_chunk_size * 2 < min_chunk_size ? min_chunk_size : target_chunk_size * 2;
+
+    Longtail_ChunkerAPI_HChunker chunker;
+    if (chunker_api->CreateChunker(chunker_api, min, avg, max, &chunker))
+    {
+        printf("%s: failed to create chunker\n", name);
+        return;
+    }
+    struct ChunkerBenchmarkFeeder feeder = {data, size, 0};
+    uint64_t chunk_count = 0;
+    uint64_t start = stm_now();
+    struct Longtail_Chunker_ChunkRange r;
+    while (chunker_api->NextChunk(chunker_api, chunker, ChunkerBenchmarkFeed, &feeder, &r) == 0)
+    {
+        ++chunk_count;
+    }
+    double ms = stm_ms(stm_now() - start);
+    chunker_api->DisposeChunker(chunker_api, chunker);
+    printf("%s: %.3lf ms, %.1lf MB/s, %" PRIu64 " chunks, %" PRIu64 " bytes average\n",
+        name, ms, ms > 0.0 ? (size / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0, chunk_count, chunk_count ? size / chunk_count : 0);
+
+    if (chunker_api->NextChunkFromBuffer == 0 || chunker_api->CreateChunker(chunker_api, min, avg, max, &chunker))
+    {
+        return;
+    }
+    chunk_count = 0;
+    start = stm_now();
+    const uint8_t* chunk_start = data;
+    const uint8_t* data_end = &data[size];
+    while (chunk_start < data_end)
+    {
+        const void* next_chunk_start;
+        if (chunker_api->NextChunkFromBuffer(chunker_api, chunker, chunk_start, (uint64_t)(data_end - chunk_start), &next_chunk_start))
+        {
+            break;
+        }
+        chunk_start = (const uint8_t*)next_chunk_start;
+        ++chunk_count;
+    }
+    ms = stm_ms(stm_now() - start);
+    chunker_api->DisposeChunker(chunker_api, chunker);
+    printf("%s (from buffer): %.3lf ms, %.1lf MB/s, %" PRIu64 " chunks, %" PRIu64 " bytes average\n",
+        name, ms, ms > 0.0 ? (size / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0, chunk_count, chunk_count ? size / chunk_count : 0);
+}
+
+static void RunChunkerBenchmarks(uint64_t size, uint32_t target_chunk_size)
+{
+    uint8_t* data = (uint8_t*)Longtail_Alloc(size);
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        data[i] = (uint8_t)(seed >> 32);
+    }
+
+    printf("Chunker benchmarks, %" PRIu64 " bytes, target chunk size %u\n", size, target_chunk_size);
+
+    struct Longtail_ChunkerAPI* hpcdc_chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    RunChunkerBenchmark("HPCDCChunker", hpcdc_chunker_api, data, size, target_chunk_size);
+    SAFE_DISPOSE_API(hpcdc_chunker_api);
+
+    struct Longtail_ChunkerAPI* fastcdc_chunker_api = Longtail_CreateFastCDCChunkerAPI();
+    RunChunkerBenchmark("FastCDCChunker", fastcdc_chunker_api, data, size, target_chunk_size);
+    SAFE_DISPOSE_API(fastcdc_chunker_api);
 
+    Longtail_Free(data);
+}
+
+static void RunHashBenchmark(const char* name, struct Longtail_HashAPI* hash_api, const uint8_t* data, uint64_t size, uint32_t target_chunk_size)
+{
+    // Chunk sizes spread between a quarter and twice the target, like the chunkers produce
+    uint32_t max_chunk_count = (uint32_t)(size / (target_chunk_size / 4));
+    uint32_t* lengths = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * max_chunk_count);
+    const void** buffers = (const void**)Longtail_Alloc(sizeof(const void*) * max_chunk_count);
+    uint64_t* hashes = (uint64_t*)Longtail_Alloc(sizeof(uint64_t) * max_chunk_count);
+    uint32_t chunk_count = 0;
+    uint64_t offset = 0;
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    while (chunk_count < max_chunk_count)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        uint32_t length = target_chunk_size / 4 + (uint32_t)(seed % (target_chunk_size * 2 - target_chunk_size / 4));
+        if (offset + length > size)
+        {
+            break;
+        }
+        lengths[chunk_count] = length;
+        buffers[chunk_count] = &data[offset];
+        offset += length;
+        ++chunk_count;
+    }
+
+    // Best of a few runs, alternating between the two to even out noise
+    double single_ms = 0.0;
+    double batch_ms = 0.0;
+    for (uint32_t run = 0; run < 3; ++run)
+    {
+        uint64_t start = stm_now();
+        for (uint32_t i = 0; i < chunk_count; ++i)
+        {
+            hash_api->HashBuffer(hash_api, lengths[i], buffers[i], &hashes[i]);
+        }
+        double ms = stm_ms(stm_now() - start);
+        single_ms = (run == 0 || ms < single_ms) ? ms : single_ms;
+
+        if (hash_api->HashBuffers)
+        {
+            start = stm_now();
+            for (uint32_t i = 0; i < chunk_count; i += 64)
+            {
+                uint32_t batch_count = chunk_count - i < 64 ? chunk_count - i : 64;
+                hash_api->HashBuffers(hash_api, batch_count, &lengths[i], &buffers[i], &hashes[i]);
+            }
+            ms = stm_ms(stm_now() - start);
+            batch_ms = (run == 0 || ms < batch_ms) ? ms : batch_ms;
+        }
+    }
+
+    uint64_t batch_check = 0;
+    for (uint32_t i = 0; i < chunk_count; ++i)
+    {
+        batch_check ^= hashes[i];
+    }
+    for (uint32_t i = 0; i < chunk_count; ++i)
+    {
+        hash_api->HashBuffer(hash_api, lengths[i], buffers[i], &hashes[i]);
+    }
+    uint64_t single_check = 0;
+    for (uint32_t i = 0; i < chunk_count; ++i)
+    {
+        single_check ^= hashes[i];
+    }
+
+    double mb = offset / (1024.0 * 1024.0);
+    if (hash_api->HashBuffers == 0)
+    {
+        printf("%s, target chunk size %u: HashBuffer %.1lf MB/s\n",
+            name, target_chunk_size,
+            single_ms > 0.0 ? mb / (single_ms / 1000.0) : 0.0);
+    }
+    else
+    {
+        printf("%s, target chunk size %u: HashBuffer %.1lf MB/s, HashBuffers %.1lf MB/s%s\n",
+            name, target_chunk_size,
+            single_ms > 0.0 ? mb / (single_ms / 1000.0) : 0.0,
+            batch_ms > 0.0 ? mb / (batch_ms / 1000.0) : 0.0,
+            single_check == batch_check ? "" : " MISMATCH");
+    }
+
+    Longtail_Free(hashes);
+    Longtail_Free(buffers);
+    Longtail_Free(lengths);
+}
+
+static void RunHashBenchmarks(uint64_t size)
+{
+    uint8_t* data = (uint8_t*)Longtail_Alloc(size);
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        data[i] = (uint8_t)((i * 2654435761u) >> 13);
+    }
+
+    printf("Hash benchmarks, %" PRIu64 " bytes\n", size);
+
+    struct Longtail_HashAPI* hash_apis[4] = {
+        Longtail_CreateBlake2HashAPI(),
+        Longtail_CreateBlake3HashAPI(),
+        Longtail_CreateMeowHashAPI(),
+        Longtail_CreateXXH3HashAPI()};
+    const char* hash_names[4] = {"Blake2", "Blake3", "Meow", "XXH3"};
+    for (uint32_t h = 0; h < 4; ++h)
+    {
+        RunHashBenchmark(hash_names[h], hash_apis[h], data, size, 8192);
+        RunHashBenchmark(hash_names[h], hash_apis[h], data, size, 32768);
+        SAFE_DISPOSE_API(hash_apis[h]);
+    }
+
+    Longtail_Free(data);
+}
+
+// End to end benchmarks of the upsync / downsync pipeline on deterministic synthetic data
+
+static uint64_t BenchmarkRandom(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static uint64_t BenchmarkSeed(uint64_t a, uint64_t b)
+{
+    uint64_t x = (a * 0x9E3779B97F4A7C15ull) ^ (b + 0x632BE59BD9B4E019ull);
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    return x | 1;
+}
+
+static uint64_t GetPeakRSSKB()
+{
+#if defined(__linux__)
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f)
+    {
+        char line[256];
+        uint64_t peak_kb = 0;
+        while (fgets(line, sizeof(line), f))
+        {
+            if (sscanf(line, "VmHWM: %" SCNu64 " kB", &peak_kb) == 1)
+            {
+                break;
+            }
+        }
+        fclose(f);
+        return peak_kb;
+    }
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(__APPLE__)
+        return (uint64_t)usage.ru_maxrss / 1024;
+#else
+        return (uint64_t)usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static void ResetPeakRSS()
+{
+#if defined(__linux__)
+    // Resets VmHWM to the current RSS so the peak is measured per phase
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (f)
+    {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+struct BenchmarkPhase
+{
+    const char* m_Name;
+    double m_Ms;
+    uint64_t m_Bytes;
+    uint64_t m_PeakRSSKB;
+};
+
+struct BenchmarkDataset
+{
+    const char* m_Name;
+    uint32_t m_FileCount;
+    uint64_t m_TotalSize;
+    struct BenchmarkPhase* m_Phases;
+};
+
+struct BenchmarkTimer
+{
+    uint64_t m_Start;
+};
+
+static void BeginPhase(struct BenchmarkTimer* timer)
+{
+    ResetPeakRSS();
+    timer->m_Start = stm_now();
+}
+
+static void EndPhase(struct BenchmarkDataset* dataset, struct BenchmarkTimer* timer, const char* name, uint64_t bytes)
+{
+    struct BenchmarkPhase phase;
+    phase.m_Ms = stm_ms(stm_now() - timer->m_Start);
+    phase.m_Name = name;
+    phase.m_Bytes = bytes;
+    phase.m_PeakRSSKB = GetPeakRSSKB();
+    arrput(dataset->m_Phases, phase);
+    double mb_per_s = phase.m_Ms > 0.0 ? (bytes / (1024.0 * 1024.0)) / (phase.m_Ms / 1000.0) : 0.0;
+    fprintf(stderr, "%s/%s: %.3lf ms, %.1lf MB/s, peak rss %" PRIu64 " kB\n", dataset->m_Name, name, phase.m_Ms, mb_per_s, phase.m_PeakRSSKB);
+}
+
+struct BenchmarkDatasetSpec
+{
+    const char* m_Name;
+    uint32_t m_FileCount;
+    uint32_t m_MinFileSize;
+    uint32_t m_MaxFileSize;
+};
+
+#define BENCHMARK_SEGMENT_SIZE 16384u
+#define BENCHMARK_TEMPLATE_COUNT 64u
+
+static const char* BENCHMARK_WORDS[16] = {
+    "longtail ", "chunk ", "block ", "index ", "version ", "content ", "asset ", "store ",
+    "hash ", "path ", "diff ", "compress ", "data ", "sync ", "file ", "\n"};
+
+// Mix of segments shared between files (dedupe), compressible text and noise
+static void FillBenchmarkData(uint64_t seed, const uint8_t* templates, uint8_t* out, uint64_t size)
+{
+    uint64_t state = seed;
+    uint64_t offset = 0;
+    while (offset < size)
+    {
+        uint64_t segment_size = size - offset < BENCHMARK_SEGMENT_SIZE ? size - offset : BENCHMARK_SEGMENT_SIZE;
+        uint64_t kind = BenchmarkRandom(&state) % 4;
+        if (kind == 0)
+        {
+            const uint8_t* segment = &templates[(BenchmarkRandom(&state) % BENCHMARK_TEMPLATE_COUNT) * BENCHMARK_SEGMENT_SIZE];
+            memcpy(&out[offset], segment, segment_size);
+        }
+        else if (kind == 3)
+        {
+            for (uint64_t i = 0; i < segment_size; ++i)
+            {
+                out[offset + i] = (uint8_t)BenchmarkRandom(&state);
+            }
+        }
+        else
+        {
+            uint64_t i = 0;
+            while (i < segment_size)
+            {
+                const char* word = BENCHMARK_WORDS[BenchmarkRandom(&state) & 15];
+                while (*word && i < segment_size)
+                {
+                    out[offset + i++] = (uint8_t)*word++;
+                }
+            }
+        }
+        offset += segment_size;
+    }
+}
+
+static int WriteBenchmarkFile(struct Longtail_StorageAPI* storage_api, const char* root_path, const char* sub_path, const uint8_t* data, uint64_t size)
+{
+    char* path = storage_api->ConcatPath(storage_api, root_path, sub_path);
+    int err = EnsureParentPathExists(storage_api, path);
+    if (err == 0)
+    {
+        Longtail_StorageAPI_HOpenFile f;
+        err = storage_api->OpenWriteFile(storage_api, path, 0, &f);
+        if (err == 0)
+        {
+            err = size ? storage_api->Write(storage_api, f, 0, size, data) : 0;
+            storage_api->CloseFile(storage_api, f);
+        }
+    }
+    Longtail_Free(path);
+    return err;
+}
+
+static void GetBenchmarkFilePath(const struct BenchmarkDatasetSpec* spec, uint32_t file_index, int added, char* out_path, size_t out_path_size)
+{
+    snprintf(out_path, out_path_size, "%s/dir%02u/sub%02u/%s%05u.dat", spec->m_Name, file_index % 16, (file_index / 16) % 8, added ? "added" : "file", file_index);
+}
+
+// Fate of a file in the mutated version, 5% modified and 2% deleted
+enum BenchmarkFileMutation
+{
+    BENCHMARK_UNCHANGED,
+    BENCHMARK_MODIFIED,
+    BENCHMARK_DELETED
+};
+
+static enum BenchmarkFileMutation GetBenchmarkFileMutation(uint32_t file_index)
+{
+    // Spread out by index so datasets with only a few files still get a modification
+    return (file_index % 20) == 1 ? BENCHMARK_MODIFIED : (file_index % 50) == 7 ? BENCHMARK_DELETED : BENCHMARK_UNCHANGED;
+}
+
+static uint64_t GetBenchmarkFileSize(const struct BenchmarkDatasetSpec* spec, uint32_t file_index, int added)
+{
+    uint64_t range = (uint64_t)spec->m_MaxFileSize - spec->m_MinFileSize;
+    return spec->m_MinFileSize + (range ? BenchmarkSeed(file_index, added ? 0xadd : 0x512e) % (range + 1) : 0);
+}
+
+// Modified files get a change near the start and an insertion in the middle which content
+// defined chunking should contain to a few chunks
+static uint64_t MutateBenchmarkData(uint64_t seed, uint8_t* data, uint64_t size, uint64_t capacity)
+{
+    uint64_t state = seed;
+    uint64_t insert_size = 4096 + BenchmarkRandom(&state) % 61440;
+    if (size + insert_size > capacity)
+    {
+        insert_size = capacity - size;
+    }
+    uint64_t insert_offset = size / 2;
+    memmove(&data[insert_offset + insert_size], &data[insert_offset], size - insert_offset);
+    for (uint64_t i = 0; i < insert_size; ++i)
+    {
+        data[insert_offset + i] = (uint8_t)BenchmarkRandom(&state);
+    }
+    uint64_t patch_size = size < 512 ? size : 512;
+    for (uint64_t i = 0; i < patch_size; ++i)
+    {
+        data[i] ^= (uint8_t)BenchmarkRandom(&state);
+    }
+    return size + insert_size;
+}
+
+static int GenerateBenchmarkFile(
+    struct Longtail_StorageAPI* storage_api,
+    const char* root_path,
+    const struct BenchmarkDatasetSpec* spec,
+    const uint8_t* templates,
+    uint8_t* buffer,
+    uint64_t buffer_size,
+    uint32_t file_index,
+    int added,
+    int modified,
+    uint64_t* out_size)
+{
+    char sub_path[256];
+    GetBenchmarkFilePath(spec, file_index, added, sub_path, sizeof(sub_path));
+    uint64_t size = GetBenchmarkFileSize(spec, file_index, added);
+    FillBenchmarkData(BenchmarkSeed(file_index, added ? 0xdada : 0xda7a), templates, buffer, size);
+    if (modified)
+    {
+        size = MutateBenchmarkData(BenchmarkSeed(file_index, 0x3a7e), buffer, size, buffer_size);
+    }
+    *out_size = size;
+    return WriteBenchmarkFile(storage_api, root_path, sub_path, buffer, size);
+}
+
+// Writes the first version of the dataset if @p mutate is zero, otherwise changes the first version in place
+// to the second so unchanged files keep their modification times
+static int GenerateBenchmarkDataset(
+    struct Longtail_StorageAPI* storage_api,
+    const char* root_path,
+    const struct BenchmarkDatasetSpec* spec,
+    int mutate,
+    uint64_t* out_bytes_written)
+{
+    uint8_t* templates = (uint8_t*)Longtail_Alloc(BENCHMARK_TEMPLATE_COUNT * BENCHMARK_SEGMENT_SIZE);
+    uint64_t template_state = 0x7e3a7e;
+    for (uint32_t i = 0; i < BENCHMARK_TEMPLATE_COUNT * BENCHMARK_SEGMENT_SIZE; ++i)
+    {
+        templates[i] = (uint8_t)BenchmarkRandom(&template_state);
+    }
+    uint64_t buffer_size = (uint64_t)spec->m_MaxFileSize + 65536u;
+    uint8_t* buffer = (uint8_t*)Longtail_Alloc(buffer_size);
+
+    int err = 0;
+    uint64_t bytes_written = 0;
+    for (uint32_t i = 0; err == 0 && i < spec->m_FileCount; ++i)
+    {
+        enum BenchmarkFileMutation mutation = GetBenchmarkFileMutation(i);
+        uint64_t size = 0;
+        if (!mutate)
+        {
+            err = GenerateBenchmarkFile(storage_api, root_path, spec, templates, buffer, buffer_size, i, 0, 0, &size);
+        }
+        else if (mutation == BENCHMARK_MODIFIED)
+        {
+            err = GenerateBenchmarkFile(storage_api, root_path, spec, templates, buffer, buffer_size, i, 0, 1, &size);
+        }
+        else if (mutation == BENCHMARK_DELETED)
+        {
+            char sub_path[256];
+            GetBenchmarkFilePath(spec, i, 0, sub_path, sizeof(sub_path));
+            char* path = storage_api->ConcatPath(storage_api, root_path, sub_path);
+            err = storage_api->RemoveFile(storage_api, path);
+            Longtail_Free(path);
+        }
+        bytes_written += size;
+    }
+    // 2% new files
+    uint32_t added_count = mutate ? (spec->m_FileCount + 49) / 50 : 0;
+    for (uint32_t i = 0; err == 0 && i < added_count; ++i)
+    {
+        uint64_t size = 0;
+        err = GenerateBenchmarkFile(storage_api, root_path, spec, templates, buffer, buffer_size, i, 1, 0, &size);
+        bytes_written += size;
+    }
+
+    Longtail_Free(buffer);
+    Longtail_Free(templates);
+    *out_bytes_written = bytes_written;
+    return err;
+}
+
+static int RemoveBenchmarkDir(struct Longtail_StorageAPI* storage_api, const char* path)
+{
+    Longtail_StorageAPI_HIterator fs_iterator;
+    int err = storage_api->StartFind(storage_api, path, &fs_iterator);
+    if (err == ENOENT)
+    {
+        return storage_api->IsDir(storage_api, path) ? storage_api->RemoveDir(storage_api, path) : 0;
+    }
+    if (err)
+    {
+        return err;
+    }
+    do
+    {
+        struct Longtail_StorageAPI_EntryProperties properties;
+        err = storage_api->GetEntryProperties(storage_api, fs_iterator, &properties);
+        if (err)
+        {
+            break;
+        }
+        char* child_path = storage_api->ConcatPath(storage_api, path, properties.m_Name);
+        err = properties.m_IsDir ? RemoveBenchmarkDir(storage_api, child_path) : storage_api->RemoveFile(storage_api, child_path);
+        Longtail_Free(child_path);
+        if (err)
+        {
+            break;
+        }
+        err = storage_api->FindNext(storage_api, fs_iterator);
+    } while (err == 0);
+    storage_api->CloseFind(storage_api, fs_iterator);
+    if (err != ENOENT)
+    {
+        return err;
+    }
+    return storage_api->RemoveDir(storage_api, path);
+}
+
+static uint64_t GetVersionIndexAssetBytes(const struct Longtail_VersionIndex* version_index, uint32_t count, const uint32_t* optional_asset_indexes)
+{
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bytes += version_index->m_AssetSizes[optional_asset_indexes ? optional_asset_indexes[i] : i];
+    }
+    return bytes;
+}
+
+// Size of the unique chunks of @p version_index that are stored in @p content_index
+static uint64_t GetContentIndexChunkBytes(const struct Longtail_VersionIndex* version_index, const struct Longtail_ContentIndex* content_index)
+{
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    void* lut_mem = Longtail_Alloc(Longtail_LookupTable_GetSize(chunk_count));
+    struct Longtail_LookupTable* lut = Longtail_LookupTable_Create(lut_mem, chunk_count, 0);
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        Longtail_LookupTable_PutUnique(lut, content_index->m_ChunkHashes[c], 0);
+    }
+    uint64_t bytes = 0;
+    for (uint32_t c = 0; c < *version_index->m_ChunkCount; ++c)
+    {
+        uint64_t* counted = Longtail_LookupTable_Get(lut, version_index->m_ChunkHashes[c]);
+        if (counted && *counted == 0)
+        {
+            *counted = 1;
+            bytes += version_index->m_ChunkSizes[c];
+        }
+    }
+    Longtail_Free(lut_mem);
+    return bytes;
+}
+
+static int IsEmptyVersionDiff(const struct Longtail_VersionDiff* version_diff)
+{
+    return *version_diff->m_SourceRemovedCount == 0 &&
+        *version_diff->m_TargetAddedCount == 0 &&
+        *version_diff->m_ModifiedContentCount == 0;
+}
+
+#define BENCHMARK_CHECK(x) \
+    if ((err = (x)) != 0) \
+    { \
+        fprintf(stderr, "%s(%d): `%s` failed with %d\n", __FILE__, __LINE__, #x, err); \
+        goto end; \
+    }
+
+static int RunEndToEndBenchmark(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_CompressionRegistryAPI* compression_registry,
+    const char* work_path,
+    const struct BenchmarkDatasetSpec* spec,
+    struct BenchmarkDataset* dataset)
+{
+    const uint32_t target_chunk_size = 32768u;
+    const uint32_t target_block_size = 8u * 1024u * 1024u;
+    const uint32_t max_chunks_per_block = 1024u;
+
+    char* source_path = storage_api->ConcatPath(storage_api, work_path, "source");
+    char* store_path = storage_api->ConcatPath(storage_api, work_path, "store");
+    char* target_path = storage_api->ConcatPath(storage_api, work_path, "target");
+
+    struct Longtail_BlockStoreAPI* fs_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, store_path, target_block_size, max_chunks_per_block, 0);
+    struct Longtail_BlockStoreAPI* compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry, 0);
+    struct Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(compress_block_store_api, 0, 32u * (uint64_t)target_block_size, 1);
+    struct Longtail_BlockStoreAPI* block_store_api = Longtail_CreateShareBlockStoreAPI(lru_block_store_api);
+
+    struct Longtail_FileInfos* file_infos = 0;
+    uint32_t* tags = 0;
+    struct Longtail_VersionIndex* version_index_v1 = 0;
+    struct Longtail_VersionIndex* version_index_v2 = 0;
+    struct Longtail_VersionIndex* version_index_v2_incremental = 0;
+    struct Longtail_VersionIndex* target_version_index = 0;
+    struct Longtail_ContentIndex* content_index_v1 = 0;
+    struct Longtail_ContentIndex* missing_content_index = 0;
+    struct Longtail_ContentIndex* content_index_v2 = 0;
+    struct Longtail_VersionDiff* version_diff = 0;
+    struct Longtail_VersionDiff* verify_diff = 0;
+    struct BenchmarkTimer timer;
+    uint64_t bytes = 0;
+    int err = 0;
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(GenerateBenchmarkDataset(storage_api, source_path, spec, 0, &bytes))
+    EndPhase(dataset, &timer, "generate_v1", bytes);
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_GetFilesRecursively(storage_api, 0, 0, 0, source_path, &file_infos))
+    EndPhase(dataset, &timer, "scan_v1", 0);
+    dataset->m_FileCount = 0;
+    dataset->m_TotalSize = 0;
+    for (uint32_t i = 0; i < file_infos->m_Count; ++i)
+    {
+        const char* path = &file_infos->m_PathData[file_infos->m_PathStartOffsets[i]];
+        dataset->m_FileCount += path[strlen(path) - 1] != '/';
+        dataset->m_TotalSize += file_infos->m_Sizes[i];
+    }
+
+    tags = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * file_infos->m_Count);
+    for (uint32_t i = 0; i < file_infos->m_Count; ++i)
+    {
+        tags[i] = Longtail_GetZStdDefaultQuality();
+    }
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, source_path, file_infos, tags, target_chunk_size, &version_index_v1))
+    EndPhase(dataset, &timer, "create_version_index_v1", GetVersionIndexAssetBytes(version_index_v1, *version_index_v1->m_AssetCount, 0));
+    Longtail_Free(tags);
+    tags = 0;
+    Longtail_Free(file_infos);
+    file_infos = 0;
+
+    BENCHMARK_CHECK(Longtail_CreateContentIndex(hash_api, version_index_v1, target_block_size, max_chunks_per_block, &content_index_v1))
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_WriteContent(storage_api, block_store_api, job_api, 0, 0, 0, content_index_v1, version_index_v1, source_path))
+    EndPhase(dataset, &timer, "write_content_v1", GetContentIndexChunkBytes(version_index_v1, content_index_v1));
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_WriteVersion(block_store_api, storage_api, job_api, 0, 0, 0, content_index_v1, version_index_v1, target_path, 1))
+    EndPhase(dataset, &timer, "write_version_v1", GetVersionIndexAssetBytes(version_index_v1, *version_index_v1->m_AssetCount, 0));
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(GenerateBenchmarkDataset(storage_api, source_path, spec, 1, &bytes))
+    EndPhase(dataset, &timer, "generate_v2", bytes);
+
+    BENCHMARK_CHECK(Longtail_GetFilesRecursively(storage_api, 0, 0, 0, source_path, &file_infos))
+    tags = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * file_infos->m_Count);
+    for (uint32_t i = 0; i < file_infos->m_Count; ++i)
+    {
+        tags[i] = Longtail_GetZStdDefaultQuality();
+    }
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, source_path, file_infos, tags, target_chunk_size, &version_index_v2))
+    EndPhase(dataset, &timer, "create_version_index_v2", GetVersionIndexAssetBytes(version_index_v2, *version_index_v2->m_AssetCount, 0));
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_CreateVersionIndexIncremental(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, source_path, file_infos, tags, target_chunk_size, version_index_v1, &version_index_v2_incremental))
+    EndPhase(dataset, &timer, "create_version_index_v2_incremental", GetVersionIndexAssetBytes(version_index_v2_incremental, *version_index_v2_incremental->m_AssetCount, 0));
+
+    BENCHMARK_CHECK(Longtail_CreateVersionDiff(hash_api, version_index_v2, version_index_v2_incremental, &verify_diff))
+    if (!IsEmptyVersionDiff(verify_diff))
+    {
+        fprintf(stderr, "%s: incremental version index differs from full version index\n", dataset->m_Name);
+        err = EINVAL;
+        goto end;
+    }
+    Longtail_Free(verify_diff);
+    verify_diff = 0;
+
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_CreateVersionDiff(hash_api, version_index_v1, version_index_v2, &version_diff))
+    EndPhase(dataset, &timer, "create_version_diff", 0);
+
+    BENCHMARK_CHECK(Longtail_CreateMissingContent(hash_api, content_index_v1, version_index_v2, target_block_size, max_chunks_per_block, &missing_content_index))
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_WriteContent(storage_api, block_store_api, job_api, 0, 0, 0, missing_content_index, version_index_v2, source_path))
+    EndPhase(dataset, &timer, "write_content_v2", GetContentIndexChunkBytes(version_index_v2, missing_content_index));
+
+    BENCHMARK_CHECK(Longtail_MergeContentIndex(job_api, content_index_v1, missing_content_index, &content_index_v2))
+    BeginPhase(&timer);
+    BENCHMARK_CHECK(Longtail_ChangeVersion(block_store_api, storage_api, hash_api, job_api, 0, 0, 0, content_index_v2, version_index_v1, version_index_v2, version_diff, target_path, 1))
+    EndPhase(dataset, &timer, "change_version_v1_to_v2",
+        GetVersionIndexAssetBytes(version_index_v2, *version_diff->m_TargetAddedCount, version_diff->m_TargetAddedAssetIndexes) +
+        GetVersionIndexAssetBytes(version_index_v2, *version_diff->m_ModifiedContentCount, version_diff->m_TargetContentModifiedAssetIndexes));
+
+    Longtail_Free(file_infos);
+    file_infos = 0;
+    BENCHMARK_CHECK(Longtail_GetFilesRecursively(storage_api, 0, 0, 0, target_path, &file_infos))
+    BENCHMARK_CHECK(Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, target_path, file_infos, tags, target_chunk_size, &target_version_index))
+    BENCHMARK_CHECK(Longtail_CreateVersionDiff(hash_api, version_index_v2, target_version_index, &verify_diff))
+    if (!IsEmptyVersionDiff(verify_diff))
+    {
+        fprintf(stderr, "%s: changed version does not match the source version\n", dataset->m_Name);
+        err = EINVAL;
+        goto end;
+    }
+
+end:
+    Longtail_Free(verify_diff);
+    Longtail_Free(version_diff);
+    Longtail_Free(content_index_v2);
+    Longtail_Free(missing_content_index);
+    Longtail_Free(content_index_v1);
+    Longtail_Free(target_version_index);
+    Longtail_Free(version_index_v2_incremental);
+    Longtail_Free(version_index_v2);
+    Longtail_Free(version_index_v1);
+    Longtail_Free(tags);
+    Longtail_Free(file_infos);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(lru_block_store_api);
+    SAFE_DISPOSE_API(compress_block_store_api);
+    SAFE_DISPOSE_API(fs_block_store_api);
+    Longtail_Free(target_path);
+    Longtail_Free(store_path);
+    Longtail_Free(source_path);
+    return err;
+}
+
+static void WriteBenchmarkReport(FILE* f, uint32_t scale, uint32_t worker_count, const struct BenchmarkDataset* datasets, uint32_t dataset_count)
+{
+    fprintf(f, "{\n  \"suite\": \"longtail_e2e\",\n  \"scale\": %u,\n  \"worker_count\": %u,\n  \"datasets\": [\n", scale, worker_count);
+    for (uint32_t d = 0; d < dataset_count; ++d)
+    {
+        const struct BenchmarkDataset* dataset = &datasets[d];
+        fprintf(f, "    {\n      \"name\": \"%s\",\n      \"file_count\": %u,\n      \"total_size\": %" PRIu64 ",\n      \"phases\": [\n",
+            dataset->m_Name, dataset->m_FileCount, dataset->m_TotalSize);
+        for (ptrdiff_t p = 0; p < arrlen(dataset->m_Phases); ++p)
+        {
+            const struct BenchmarkPhase* phase = &dataset->m_Phases[p];
+            double mb_per_s = phase->m_Ms > 0.0 ? (phase->m_Bytes / (1024.0 * 1024.0)) / (phase->m_Ms / 1000.0) : 0.0;
+            fprintf(f, "        {\"name\": \"%s\", \"ms\": %.3lf, \"bytes\": %" PRIu64 ", \"mb_per_s\": %.3lf, \"peak_rss_kb\": %" PRIu64 "}%s\n",
+                phase->m_Name, phase->m_Ms, phase->m_Bytes, mb_per_s, phase->m_PeakRSSKB, p + 1 < arrlen(dataset->m_Phases) ? "," : "");
+        }
+        fprintf(f, "      ]\n    }%s\n", d + 1 < dataset_count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+// perf e2e <work-path> [scale] [report-path]
+static int RunEndToEndBenchmarks(const char* work_path, uint32_t scale, const char* optional_report_path)
+{
+    struct BenchmarkDatasetSpec specs[2] = {
+        {"small_files", 4000u * scale, 1024u, 32768u},
+        {"large_files", 4u, 64u * 1024u * 1024u * scale, 64u * 1024u * 1024u * scale}};
+    const uint32_t dataset_count = sizeof(specs) / sizeof(specs[0]);
+    struct BenchmarkDataset datasets[2];
+    memset(datasets, 0, sizeof(datasets));
+
+    uint32_t worker_count = Longtail_GetCPUCount();
+    struct Longtail_StorageAPI* storage_api = Longtail_CreateFSStorageAPI();
+    struct Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(worker_count, 0);
+    struct Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    struct Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    struct Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
+
+    int err = 0;
+    for (uint32_t d = 0; err == 0 && d < dataset_count; ++d)
+    {
+        datasets[d].m_Name = specs[d].m_Name;
+        char* dataset_work_path = storage_api->ConcatPath(storage_api, work_path, specs[d].m_Name);
+        err = RemoveBenchmarkDir(storage_api, dataset_work_path);
+        if (err == 0)
+        {
+            err = RunEndToEndBenchmark(storage_api, job_api, hash_api, chunker_api, compression_registry, dataset_work_path, &specs[d], &datasets[d]);
+            int remove_err = RemoveBenchmarkDir(storage_api, dataset_work_path);
+            err = err ? err : remove_err;
+        }
+        Longtail_Free(dataset_work_path);
+    }
+
+    if (err == 0)
+    {
+        FILE* report = optional_report_path ? fopen(optional_report_path, "w") : stdout;
+        if (report)
+        {
+            WriteBenchmarkReport(report, scale, worker_count, datasets, dataset_count);
+            if (report != stdout)
+            {
+                fclose(report);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Failed to open `%s`\n", optional_report_path);
+            err = EACCES;
+        }
+    }
+
+    for (uint32_t d = 0; d < dataset_count; ++d)
+    {
+        arrfree(datasets[d].m_Phases);
+    }
+    SAFE_DISPOSE_API(compression_registry);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(storage_api);
+    return err;
+}
 
 int main(int argc, char** argv)
 {
@@ -318,15 +1335,43 @@ int main(int argc, char** argv)
 
     stm_setup();
 
+    if (argc > 2 && strcmp(argv[1], "e2e") == 0)
+    {
+        Longtail_SetLogLevel(LONGTAIL_LOG_LEVEL_WARNING);
+        uint32_t scale = argc > 3 ? (uint32_t)atoi(argv[3]) : 1u;
+        result = RunEndToEndBenchmarks(argv[2], scale ? scale : 1u, argc > 4 ? argv[4] : 0);
+        Longtail_SetAssert(0);
+        return result;
+    }
+
+    RunLookupTableBenchmarks(16 * 1024 * 1024);
+    RunChunkerBenchmarks(256 * 1024 * 1024, 32768);
+    RunHashBenchmarks(64 * 1024 * 1024);
+
+    // Optional content index to run the lookups on real store data
+    const char* content_index_path = argc > 1 ? argv[1] : 0;
+    if (content_index_path == 0)
+    {
+        Longtail_SetAssert(0);
+        return result;
+    }
+
     struct Longtail_StorageAPI* storage_api = Longtail_CreateFSStorageAPI();
 
     struct Longtail_ContentIndex* content_index = 0;
-    uint64_t read_ticks = TestReadSpeed(storage_api, "D:\\Temp\\Pioneer_Client_store_store.lci", &content_index);
+    uint64_t read_ticks = TestReadSpeed(storage_api, content_index_path, &content_index);
+    if (content_index == 0)
+    {
+        printf("Failed to read `%s`\n", content_index_path);
+        SAFE_DISPOSE_API(storage_api);
+        Longtail_SetAssert(0);
+        return 1;
+    }
 
     printf("TestReadSpeed: %.3lf ms\n", stm_ms(read_ticks));
 
-    struct Longtail_LookupTable* block_hash_table = 0;
-    struct Longtail_LookupTable* chunk_hash_table = 0;
+    struct ChainedLookupTable* block_hash_table = 0;
+    struct ChainedLookupTable* chunk_hash_table = 0;
     uint64_t create_blockhash_lookup_ticks = TestCreateBlockHashTableSpeed(content_index, &block_hash_table, &chunk_hash_table);
     printf("TestCreateBlockHashTableSpeed: %.3lf ms\n", stm_ms(create_blockhash_lookup_ticks));
 
@@ -336,16 +1381,29 @@ int main(int argc, char** argv)
     Longtail_Free(chunk_hash_table);
     Longtail_Free(block_hash_table);
 
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    struct Longtail_LookupTable* chunk_lookup_table = 0;
+    uint64_t create_chunk_lookup_ticks = TestCreateLookupTableSpeed(chunk_count, content_index->m_ChunkHashes, &chunk_lookup_table);
+    printf("TestCreateLookupTableSpeed: %.3lf ms\n", stm_ms(create_chunk_lookup_ticks));
+
+    uint64_t chunk_lookup_ticks = TestLookupLookupTableSpeed(chunk_count, content_index->m_ChunkHashes, chunk_lookup_table);
+    printf("TestLookupLookupTableSpeed: %.3lf ms\n", stm_ms(chunk_lookup_ticks));
+
+    uint64_t chunk_batch_lookup_ticks = TestBatchLookupLookupTableSpeed(chunk_count, content_index->m_ChunkHashes, chunk_lookup_table);
+    printf("TestBatchLookupLookupTableSpeed: %.3lf ms\n", stm_ms(chunk_batch_lookup_ticks));
+
+    Longtail_Free(chunk_lookup_table);
+
     struct LookupEntry* block_lookup_table = 0;
-    struct LookupEntry* chunk_lookup_table = 0;
+    struct LookupEntry* chunk_hm_lookup_table = 0;
 
-    uint64_t create_lookup_ticks = TestCreateHashMapSpeed(content_index, &block_lookup_table, &chunk_lookup_table);
+    uint64_t create_lookup_ticks = TestCreateHashMapSpeed(content_index, &block_lookup_table, &chunk_hm_lookup_table);
     printf("TestCreateHashMapSpeed: %.3lf ms\n", stm_ms(create_lookup_ticks));
 
-    uint64_t lookup_ticks = TestLookupHashMapSpeed(content_index, block_lookup_table, chunk_lookup_table);
+    uint64_t lookup_ticks = TestLookupHashMapSpeed(content_index, block_lookup_table, chunk_hm_lookup_table);
     printf("TestLookupHashMapSpeed: %.3lf ms\n", stm_ms(lookup_ticks));
 
-    hmfree(chunk_lookup_table);
+    hmfree(chunk_hm_lookup_table);
     hmfree(block_lookup_table);
 
     Longtail_Free(content_index);
@@ -23,6 +23,22 @@
     #define alloca _alloca
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define LONGTAIL_LOOKUP_TABLE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #if defined(_M_X64) || defined(_M_IX86)
+        #define LONGTAIL_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+    #else
+        #define LONGTAIL_PREFETCH(p)
+    #endif
+#else
+    #define LONGTAIL_PREFETCH(p) __builtin_prefetch(p)
+#endif
+
 /*
 #if defined(LONGTAIL_ASSERTS)
 void* Longtail_NukeMalloc(size_t s);
@@ -42,10 +58,16 @@ void Longtail_NukeFree(void* p);
 #define LONGTAIL_VERSION(major, minor, patch)  ((((uint32_t)major) << 24) | ((uint32_t)minor << 16) | ((uint32_t)patch))
 #define LONGTAIL_VERSION_0_0_1  LONGTAIL_VERSION(0,0,1)
 #define LONGTAIL_VERSION_INDEX_VERSION_0_0_2  LONGTAIL_VERSION(0,0,2)
+// 0.0.3 adds the modification time, change time and file id of each asset after the asset sizes
+#define LONGTAIL_VERSION_INDEX_VERSION_0_0_3  LONGTAIL_VERSION(0,0,3)
+// 0.0.4 adds the identifier of the chunker used to split the assets after the chunk tags
+#define LONGTAIL_VERSION_INDEX_VERSION_0_0_4  LONGTAIL_VERSION(0,0,4)
 #define LONGTAIL_CONTENT_INDEX_VERSION_0_0_1  LONGTAIL_VERSION(0,0,1)
 #define LONGTAIL_CONTENT_INDEX_VERSION_1_0_0  LONGTAIL_VERSION(1,0,0)
+// 1.1.0 appends the chunk hashes sorted by value and the block index for each sorted chunk hash
+#define LONGTAIL_CONTENT_INDEX_VERSION_1_1_0  LONGTAIL_VERSION(1,1,0)
 
-uint32_t Longtail_CurrentContentIndexVersion = LONGTAIL_VERSION_INDEX_VERSION_0_0_2;
+uint32_t Longtail_CurrentContentIndexVersion = LONGTAIL_VERSION_INDEX_VERSION_0_0_4;
 
 #if defined(_WIN32)
     #define SORTFUNC(name) int name(void* context, const void* a_ptr, const void* b_ptr)
@@ -122,7 +144,8 @@ struct Longtail_HashAPI* Longtail_MakeHashAPI(
     Longtail_Hash_BeginContextFunc begin_context_func,
     Longtail_Hash_HashFunc hash_func,
     Longtail_Hash_EndContextFunc end_context_func,
-    Longtail_Hash_HashBufferFunc hash_buffer_func)
+    Longtail_Hash_HashBufferFunc hash_buffer_func,
+    Longtail_Hash_HashBuffersFunc hash_buffers_func)
 {
     LONGTAIL_VALIDATE_INPUT(mem != 0, return 0)
     struct Longtail_HashAPI* api = (struct Longtail_HashAPI*)mem;
@@ -132,6 +155,7 @@ struct Longtail_HashAPI* Longtail_MakeHashAPI(
     api->Hash = hash_func;
     api->EndContext = end_context_func;
     api->HashBuffer = hash_buffer_func;
+    api->HashBuffers = hash_buffers_func;
     return api;
 }
 
@@ -141,6 +165,24 @@ void Longtail_Hash_Hash(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HCon
 uint64_t Longtail_Hash_EndContext(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context) { return hash_api->EndContext(hash_api, context); }
 int Longtail_Hash_HashBuffer(struct Longtail_HashAPI* hash_api, uint32_t length, const void* data, uint64_t* out_hash) { return hash_api->HashBuffer(hash_api, length, data, out_hash); }
 
+int Longtail_Hash_HashBuffers(struct Longtail_HashAPI* hash_api, uint32_t count, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes)
+{
+    if (hash_api->HashBuffers)
+    {
+        return hash_api->HashBuffers(hash_api, count, lengths, data, out_hashes);
+    }
+    // HashBuffers is optional, hash the buffers one at a time if the hash api does not batch
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        int err = hash_api->HashBuffer(hash_api, lengths[i], data[i], &out_hashes[i]);
+        if (err)
+        {
+            return err;
+        }
+    }
+    return 0;
+}
+
 
 uint64_t Longtail_GetHashRegistrySize()
 {
@@ -241,7 +283,10 @@ struct Longtail_StorageAPI* Longtail_MakeStorageAPI(
     Longtail_Storage_CloseFindFunc close_find_func,
     Longtail_Storage_GetEntryPropertiesFunc get_entry_properties_func,
     Longtail_Storage_LockFileFunc lock_file_func,
-    Longtail_Storage_UnlockFileFunc unlock_file_func)
+    Longtail_Storage_UnlockFileFunc unlock_file_func,
+    Longtail_Storage_MapFileFunc map_file_func,
+    Longtail_Storage_UnmapFileFunc unmap_file_func,
+    Longtail_Storage_AdviseSequentialReadFunc advise_sequential_read_func)
 {
     LONGTAIL_VALIDATE_INPUT(mem != 0, return 0)
     struct Longtail_StorageAPI* api = (struct Longtail_StorageAPI*)mem;
@@ -268,6 +313,9 @@ struct Longtail_StorageAPI* Longtail_MakeStorageAPI(
     api->GetEntryProperties = get_entry_properties_func;
     api->LockFile = lock_file_func;
     api->UnlockFile = unlock_file_func;
+    api->MapFile = map_file_func;
+    api->UnmapFile = unmap_file_func;
+    api->AdviseSequentialRead = advise_sequential_read_func;
     return api;
 }
 
@@ -293,6 +341,9 @@ void Longtail_Storage_CloseFind(struct Longtail_StorageAPI* storage_api, Longtai
 int Longtail_Storage_GetEntryProperties(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HIterator iterator, struct Longtail_StorageAPI_EntryProperties* out_properties) { return storage_api->GetEntryProperties(storage_api, iterator, out_properties); }
 int Longtail_Storage_LockFile(struct Longtail_StorageAPI* storage_api, const char* path, Longtail_StorageAPI_HLockFile* out_lock_file) { return storage_api->LockFile(storage_api, path, out_lock_file); }
 int Longtail_Storage_UnlockFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HLockFile lock_file) { return storage_api->UnlockFile(storage_api, lock_file); }
+int Longtail_Storage_MapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr) { return storage_api->MapFile(storage_api, f, offset, length, out_file_map, out_data_ptr); }
+void Longtail_Storage_UnmapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map) { storage_api->UnmapFile(storage_api, file_map); }
+int Longtail_Storage_AdviseSequentialRead(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f) { return storage_api->AdviseSequentialRead(storage_api, f); }
 
 ////////////// ProgressAPI
 
@@ -315,6 +366,140 @@ struct Longtail_ProgressAPI* Longtail_MakeProgressAPI(
 
 void Longtail_Progress_OnProgress(struct Longtail_ProgressAPI* progressAPI, uint32_t total_count, uint32_t done_count) { progressAPI->OnProgress(progressAPI, total_count, done_count); }
 
+////////////// MetricsAPI
+
+static const char* Longtail_MetricNames[Longtail_Metric_Count] = {
+    "scan_time",
+    "scan_entries",
+    "chunk_time",
+    "chunk_bytes",
+    "hash_time",
+    "write_content_block_time",
+    "block_fetch_wait_time",
+    "block_fetch_bytes",
+    "block_fetch_failures",
+    "file_write_time",
+    "file_write_bytes",
+    "set_permissions_time",
+    "compress_time",
+    "compress_bytes",
+    "decompress_time",
+    "decompress_bytes",
+    "fsblockstore_read_time",
+    "fsblockstore_write_time",
+    "lrublockstore_hits",
+    "lrublockstore_misses",
+    "cacheblockstore_hits",
+    "cacheblockstore_misses",
+    "shareblockstore_shared",
+    "filestorage_read_bytes",
+    "filestorage_write_bytes"};
+
+static const int Longtail_MetricKinds[Longtail_Metric_Count] = {
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_TIMER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER,
+    LONGTAIL_METRIC_KIND_COUNTER};
+
+const char* Longtail_GetMetricName(uint32_t metric)
+{
+    LONGTAIL_VALIDATE_INPUT(metric < Longtail_Metric_Count, return 0)
+    return Longtail_MetricNames[metric];
+}
+
+int Longtail_GetMetricKind(uint32_t metric)
+{
+    LONGTAIL_VALIDATE_INPUT(metric < Longtail_Metric_Count, return -1)
+    return Longtail_MetricKinds[metric];
+}
+
+uint64_t Longtail_GetMetricsAPISize()
+{
+    return sizeof(struct Longtail_MetricsAPI);
+}
+
+struct Longtail_MetricsAPI* Longtail_MakeMetricsAPI(
+    void* mem,
+    Longtail_DisposeFunc dispose_func,
+    Longtail_Metrics_AddFunc add_func,
+    Longtail_Metrics_ObserveFunc observe_func,
+    Longtail_Metrics_GetTimeFunc get_time_func)
+{
+    LONGTAIL_VALIDATE_INPUT(mem != 0, return 0)
+    struct Longtail_MetricsAPI* api = (struct Longtail_MetricsAPI*)mem;
+    api->m_API.Dispose = dispose_func;
+    api->Add = add_func;
+    api->Observe = observe_func;
+    api->GetTime = get_time_func;
+    return api;
+}
+
+void Longtail_Metrics_Add(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value) { metrics_api->Add(metrics_api, metric, value); }
+void Longtail_Metrics_Observe(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value) { metrics_api->Observe(metrics_api, metric, value); }
+uint64_t Longtail_Metrics_GetTime(struct Longtail_MetricsAPI* metrics_api) { return metrics_api->GetTime(metrics_api); }
+
+static struct Longtail_MetricsAPI* Longtail_Metrics_private = 0;
+
+void Longtail_SetMetrics(struct Longtail_MetricsAPI* metrics_api)
+{
+    Longtail_Metrics_private = metrics_api;
+}
+
+void Longtail_AddMetric(uint32_t metric, uint64_t value)
+{
+    struct Longtail_MetricsAPI* metrics_api = Longtail_Metrics_private;
+    if (metrics_api)
+    {
+        metrics_api->Add(metrics_api, metric, value);
+    }
+}
+
+void Longtail_ObserveMetric(uint32_t metric, uint64_t value)
+{
+    struct Longtail_MetricsAPI* metrics_api = Longtail_Metrics_private;
+    if (metrics_api)
+    {
+        metrics_api->Observe(metrics_api, metric, value);
+    }
+}
+
+uint64_t Longtail_GetMetricTime()
+{
+    struct Longtail_MetricsAPI* metrics_api = Longtail_Metrics_private;
+    return metrics_api ? metrics_api->GetTime(metrics_api) : 0;
+}
+
+void Longtail_ObserveMetricTime(uint32_t metric, uint64_t start_time)
+{
+    struct Longtail_MetricsAPI* metrics_api = Longtail_Metrics_private;
+    if (metrics_api && start_time != 0)
+    {
+        uint64_t now = metrics_api->GetTime(metrics_api);
+        metrics_api->Observe(metrics_api, metric, now > start_time ? now - start_time : 0);
+    }
+}
+
 ////////////// JobAPI
 
 uint64_t Longtail_GetJobAPISize()
@@ -348,7 +533,7 @@ struct Longtail_JobAPI* Longtail_MakeJobAPI(
 
 uint32_t Longtail_Job_GetWorkerCount(struct Longtail_JobAPI* job_api) { return job_api->GetWorkerCount(job_api); }
 int Longtail_Job_ReserveJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Group* out_job_group) { return job_api->ReserveJobs(job_api, job_count, out_job_group); }
-int Longtail_Job_CreateJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], Longtail_JobAPI_Jobs* out_jobs) { return job_api->CreateJobs(job_api, job_group, job_count, job_funcs, job_contexts, out_jobs); }
+int Longtail_Job_CreateJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], uint32_t job_class, Longtail_JobAPI_Jobs* out_jobs) { return job_api->CreateJobs(job_api, job_group, job_count, job_funcs, job_contexts, job_class, out_jobs); }
 int Longtail_Job_AddDependecies(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs, uint32_t dependency_job_count, Longtail_JobAPI_Jobs dependency_jobs) { return job_api->AddDependecies(job_api, job_count, jobs, dependency_job_count, dependency_jobs); }
 int Longtail_Job_ReadyJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs) { return job_api->ReadyJobs(job_api, job_count, jobs); }
 int Longtail_Job_WaitForAllJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, struct Longtail_ProgressAPI* progressAPI, struct Longtail_CancelAPI* optional_cancel_api, Longtail_CancelAPI_HCancelToken optional_cancel_token) { return job_api->WaitForAllJobs(job_api, job_group, progressAPI, optional_cancel_api, optional_cancel_token); }
@@ -364,25 +549,31 @@ LONGTAIL_EXPORT uint64_t Longtail_GetChunkerAPISize()
 LONGTAIL_EXPORT struct Longtail_ChunkerAPI* Longtail_MakeChunkerAPI(
     void* mem,
     Longtail_DisposeFunc dispose_func,
+    Longtail_Chunker_GetIdentifierFunc get_identifier_func,
     Longtail_Chunker_GetMinChunkSizeFunc get_min_chunk_size_func,
     Longtail_Chunker_CreateChunkerFunc create_chunker_func,
     Longtail_Chunker_NextChunkFunc next_chunk_func,
-    Longtail_Chunker_DisposeChunkerFunc dispose_chunker_func)
+    Longtail_Chunker_DisposeChunkerFunc dispose_chunker_func,
+    Longtail_Chunker_NextChunkFromBufferFunc next_chunk_from_buffer_func)
 {
     LONGTAIL_VALIDATE_INPUT(mem != 0, return 0)
     struct Longtail_ChunkerAPI* api = (struct Longtail_ChunkerAPI*)mem;
     api->m_API.Dispose = dispose_func;
+    api->GetIdentifier = get_identifier_func;
     api->GetMinChunkSize = get_min_chunk_size_func;
     api->CreateChunker = create_chunker_func;
     api->NextChunk = next_chunk_func;
     api->DisposeChunker = dispose_chunker_func;
+    api->NextChunkFromBuffer = next_chunk_from_buffer_func;
     return api;
 }
 
+LONGTAIL_EXPORT uint32_t Longtail_Chunker_GetIdentifier(struct Longtail_ChunkerAPI* chunker_api) { return chunker_api->GetIdentifier(chunker_api); }
 LONGTAIL_EXPORT int Longtail_Chunker_GetMinChunkSize(struct Longtail_ChunkerAPI* chunker_api, uint32_t* out_min_chunk_size) { return chunker_api->GetMinChunkSize(chunker_api, out_min_chunk_size); }
 LONGTAIL_EXPORT int Longtail_Chunker_CreateChunker(struct Longtail_ChunkerAPI* chunker_api, uint32_t min_chunk_size, uint32_t avg_chunk_size, uint32_t max_chunk_size, Longtail_ChunkerAPI_HChunker* out_chunker) { return chunker_api->CreateChunker(chunker_api, min_chunk_size, avg_chunk_size, max_chunk_size, out_chunker); }
 LONGTAIL_EXPORT int Longtail_Chunker_NextChunk(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, Longtail_Chunker_Feeder feeder, void* feeder_context, struct Longtail_Chunker_ChunkRange* out_chunk_range) { return chunker_api->NextChunk(chunker_api, chunker, feeder, feeder_context, out_chunk_range); }
 LONGTAIL_EXPORT int Longtail_Chunker_DisposeChunker(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker) { return chunker_api->DisposeChunker(chunker_api, chunker); }
+LONGTAIL_EXPORT int Longtail_Chunker_NextChunkFromBuffer(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, const void* buffer, uint64_t buffer_size, const void** out_next_chunk_start) { return chunker_api->NextChunkFromBuffer(chunker_api, chunker, buffer, buffer_size, out_next_chunk_start); }
 
 ////////////// AsyncPutStoredBlockAPI
 
@@ -557,34 +748,354 @@ void Longtail_Free(void* p)
 
 static Longtail_Log Longtail_Log_private = 0;
 static void* Longtail_LogContext = 0;
+static Longtail_StructuredLog Longtail_StructuredLog_private = 0;
+static void* Longtail_StructuredLogContext = 0;
 static int Longtail_LogLevel_private = LONGTAIL_LOG_LEVEL;
+int Longtail_LogFilterLevel_private = LONGTAIL_LOG_LEVEL_OFF;
+
+static void UpdateLogFilterLevel()
+{
+    Longtail_LogFilterLevel_private = (Longtail_Log_private || Longtail_StructuredLog_private) ? Longtail_LogLevel_private : LONGTAIL_LOG_LEVEL_OFF;
+}
 
 void Longtail_SetLog(Longtail_Log log_func, void* context)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_SetLog(%p, %p)", (void*)log_func, context)
     Longtail_Log_private = log_func;
     Longtail_LogContext = context;
+    UpdateLogFilterLevel();
+}
+
+void Longtail_SetStructuredLog(Longtail_StructuredLog log_func, void* context)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_SetStructuredLog(%p, %p)", (void*)log_func, context)
+    Longtail_StructuredLog_private = log_func;
+    Longtail_StructuredLogContext = context;
+    UpdateLogFilterLevel();
 }
 
 void Longtail_SetLogLevel(int level)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_SetLogLevel(%d)", level)
     Longtail_LogLevel_private = level;
+    UpdateLogFilterLevel();
+}
+
+#define LOG_ARG_NONE    0
+#define LOG_ARG_INT     1
+#define LOG_ARG_LONG    2
+#define LOG_ARG_LLONG   3
+#define LOG_ARG_SIZE    4
+#define LOG_ARG_DOUBLE  5
+#define LOG_ARG_PTR     6
+#define LOG_ARG_STRING  7
+
+#define LOG_NULL_STRING_OFFSET  0xffffffffffffffffull
+
+// Parses the printf conversion specification following a '%'. Returns its length and the kind of argument
+// it consumes, '*' width and precision each consume an extra int argument before it
+static size_t ParseLogConversion(const char* spec, int* out_arg_kind, uint32_t* out_star_count)
+{
+    const char* p = spec;
+    uint32_t star_count = 0;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+    {
+        ++p;
+    }
+    if (*p == '*')
+    {
+        ++star_count;
+        ++p;
+    }
+    while (*p >= '0' && *p <= '9')
+    {
+        ++p;
+    }
+    if (*p == '.')
+    {
+        ++p;
+        if (*p == '*')
+        {
+            ++star_count;
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            ++p;
+        }
+    }
+    int integer_kind = LOG_ARG_INT;
+    if (*p == 'h')
+    {
+        p += (p[1] == 'h') ? 2 : 1;
+    }
+    else if (*p == 'l')
+    {
+        integer_kind = (p[1] == 'l') ? LOG_ARG_LLONG : LOG_ARG_LONG;
+        p += (p[1] == 'l') ? 2 : 1;
+    }
+    else if (*p == 'j' || *p == 'q')
+    {
+        integer_kind = LOG_ARG_LLONG;
+        ++p;
+    }
+    else if (*p == 'z' || *p == 't')
+    {
+        integer_kind = LOG_ARG_SIZE;
+        ++p;
+    }
+    else if (p[0] == 'I' && p[1] == '6' && p[2] == '4')
+    {
+        integer_kind = LOG_ARG_LLONG;
+        p += 3;
+    }
+    else if (p[0] == 'I' && p[1] == '3' && p[2] == '2')
+    {
+        p += 3;
+    }
+    *out_star_count = star_count;
+    switch (*p)
+    {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            *out_arg_kind = integer_kind;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            *out_arg_kind = LOG_ARG_DOUBLE;
+            break;
+        case 'p':
+            *out_arg_kind = LOG_ARG_PTR;
+            break;
+        case 's':
+            *out_arg_kind = LOG_ARG_STRING;
+            break;
+        case 0:
+            *out_arg_kind = LOG_ARG_NONE;
+            *out_star_count = 0;
+            return (size_t)(p - spec);
+        default:
+            *out_arg_kind = LOG_ARG_NONE;
+            *out_star_count = 0;
+            break;
+    }
+    return (size_t)(p - spec) + 1;
+}
+
+static uint32_t CountLogArgs(const char* fmt)
+{
+    uint32_t arg_count = 0;
+    while (*fmt)
+    {
+        if (*fmt++ != '%')
+        {
+            continue;
+        }
+        int arg_kind;
+        uint32_t star_count;
+        fmt += ParseLogConversion(fmt, &arg_kind, &star_count);
+        arg_count += star_count + ((arg_kind != LOG_ARG_NONE) ? 1 : 0);
+    }
+    return arg_count;
+}
+
+// Packs the arguments of a log call into a record in buffer without formatting them
+static struct Longtail_LogRecord* PackLogRecord(uint64_t* buffer, size_t buffer_size, int level, const char* fmt, va_list args)
+{
+    struct Longtail_LogRecord* record = (struct Longtail_LogRecord*)buffer;
+    uint32_t arg_count = CountLogArgs(fmt);
+    size_t slots_offset = (sizeof(struct Longtail_LogRecord) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    if (slots_offset + sizeof(uint64_t) * arg_count > buffer_size)
+    {
+        return 0;
+    }
+    uint64_t* slots = (uint64_t*)&((uint8_t*)buffer)[slots_offset];
+    size_t size = slots_offset + sizeof(uint64_t) * arg_count;
+    uint32_t arg_index = 0;
+    const char* p = fmt;
+    while (*p)
+    {
+        if (*p++ != '%')
+        {
+            continue;
+        }
+        int arg_kind;
+        uint32_t star_count;
+        p += ParseLogConversion(p, &arg_kind, &star_count);
+        while (star_count--)
+        {
+            slots[arg_index++] = (uint64_t)(int64_t)va_arg(args, int);
+        }
+        switch (arg_kind)
+        {
+            case LOG_ARG_INT:
+                slots[arg_index++] = (uint64_t)(int64_t)va_arg(args, int);
+                break;
+            case LOG_ARG_LONG:
+                slots[arg_index++] = (uint64_t)(int64_t)va_arg(args, long);
+                break;
+            case LOG_ARG_LLONG:
+                slots[arg_index++] = (uint64_t)va_arg(args, long long);
+                break;
+            case LOG_ARG_SIZE:
+                slots[arg_index++] = (uint64_t)va_arg(args, size_t);
+                break;
+            case LOG_ARG_DOUBLE:
+            {
+                double d = va_arg(args, double);
+                memcpy(&slots[arg_index++], &d, sizeof(double));
+                break;
+            }
+            case LOG_ARG_PTR:
+                slots[arg_index++] = (uint64_t)(uintptr_t)va_arg(args, void*);
+                break;
+            case LOG_ARG_STRING:
+            {
+                const char* str = va_arg(args, const char*);
+                if (!str)
+                {
+                    slots[arg_index++] = LOG_NULL_STRING_OFFSET;
+                    break;
+                }
+                size_t length = strlen(str);
+                if (size + 1 > buffer_size)
+                {
+                    slots[arg_index++] = LOG_NULL_STRING_OFFSET;
+                    break;
+                }
+                if (size + length + 1 > buffer_size)
+                {
+                    length = buffer_size - size - 1;
+                }
+                memcpy(&((char*)buffer)[size], str, length);
+                ((char*)buffer)[size + length] = 0;
+                slots[arg_index++] = (uint64_t)size;
+                size += length + 1;
+                break;
+            }
+        }
+    }
+    record->m_Format = fmt;
+    record->m_Level = level;
+    record->m_ArgCount = arg_count;
+    record->m_Size = (uint32_t)size;
+    return record;
+}
+
+size_t Longtail_FormatLogRecord(const struct Longtail_LogRecord* record, char* buffer, size_t buffer_size)
+{
+    LONGTAIL_VALIDATE_INPUT(record != 0, return 0)
+    LONGTAIL_VALIDATE_INPUT(buffer != 0, return 0)
+    LONGTAIL_VALIDATE_INPUT(buffer_size > 0, return 0)
+    size_t slots_offset = (sizeof(struct Longtail_LogRecord) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    const uint64_t* slots = (const uint64_t*)&((const uint8_t*)record)[slots_offset];
+    uint32_t arg_index = 0;
+    size_t length = 0;
+    const char* p = record->m_Format;
+    while (*p && length + 1 < buffer_size)
+    {
+        if (*p != '%')
+        {
+            buffer[length++] = *p++;
+            continue;
+        }
+        int arg_kind;
+        uint32_t star_count;
+        size_t spec_length = ParseLogConversion(&p[1], &arg_kind, &star_count);
+        if (arg_index + star_count + ((arg_kind != LOG_ARG_NONE) ? 1 : 0) > record->m_ArgCount)
+        {
+            break;
+        }
+
+        // Rebuild the conversion with '*' replaced by the packed width and precision
+        char spec[64];
+        size_t s = 0;
+        for (size_t i = 0; i <= spec_length && s + 24 < sizeof(spec); ++i)
+        {
+            if (p[i] == '*')
+            {
+                s += (size_t)sprintf(&spec[s], "%d", (int)(int64_t)slots[arg_index++]);
+            }
+            else
+            {
+                spec[s++] = p[i];
+            }
+        }
+        spec[s] = 0;
+        p += spec_length + 1;
+
+        size_t available = buffer_size - length;
+        int written = 0;
+        switch (arg_kind)
+        {
+            case LOG_ARG_NONE:
+                written = (spec_length == 1 && spec[1] == '%') ? snprintf(&buffer[length], available, "%%") : 0;
+                break;
+            case LOG_ARG_INT:
+                written = snprintf(&buffer[length], available, spec, (int)(int64_t)slots[arg_index++]);
+                break;
+            case LOG_ARG_LONG:
+                written = snprintf(&buffer[length], available, spec, (long)(int64_t)slots[arg_index++]);
+                break;
+            case LOG_ARG_LLONG:
+                written = snprintf(&buffer[length], available, spec, (long long)slots[arg_index++]);
+                break;
+            case LOG_ARG_SIZE:
+                written = snprintf(&buffer[length], available, spec, (size_t)slots[arg_index++]);
+                break;
+            case LOG_ARG_DOUBLE:
+            {
+                double d;
+                memcpy(&d, &slots[arg_index++], sizeof(double));
+                written = snprintf(&buffer[length], available, spec, d);
+                break;
+            }
+            case LOG_ARG_PTR:
+                written = snprintf(&buffer[length], available, spec, (void*)(uintptr_t)slots[arg_index++]);
+                break;
+            case LOG_ARG_STRING:
+            {
+                uint64_t offset = slots[arg_index++];
+                const char* str = (offset == LOG_NULL_STRING_OFFSET || offset >= record->m_Size) ? "(null)" : &((const char*)record)[offset];
+                written = snprintf(&buffer[length], available, spec, str);
+                break;
+            }
+        }
+        if (written > 0)
+        {
+            length += ((size_t)written < available) ? (size_t)written : available - 1;
+        }
+    }
+    buffer[length] = 0;
+    return length;
 }
 
 void Longtail_CallLogger(int level, const char* fmt, ...)
 {
     LONGTAIL_FATAL_ASSERT(fmt != 0, return)
-    if (!Longtail_Log_private || (level < Longtail_LogLevel_private))
+    if (level < Longtail_LogLevel_private)
     {
         return;
     }
-    va_list argptr;
-    va_start(argptr, fmt);
-    char buffer[2048];
-    vsprintf(buffer, fmt, argptr);
-    va_end(argptr);
-    Longtail_Log_private(Longtail_LogContext, level, buffer);
+    if (Longtail_StructuredLog_private)
+    {
+        uint64_t record_buffer[256];
+        va_list argptr;
+        va_start(argptr, fmt);
+        struct Longtail_LogRecord* record = PackLogRecord(record_buffer, sizeof(record_buffer), level, fmt, argptr);
+        va_end(argptr);
+        if (record)
+        {
+            Longtail_StructuredLog_private(Longtail_StructuredLogContext, record);
+        }
+    }
+    if (Longtail_Log_private)
+    {
+        va_list argptr;
+        va_start(argptr, fmt);
+        char buffer[2048];
+        vsprintf(buffer, fmt, argptr);
+        va_end(argptr);
+        Longtail_Log_private(Longtail_LogContext, level, buffer);
+    }
 }
 
 char* Longtail_Strdup(const char* path)
@@ -606,160 +1117,242 @@ char* Longtail_Strdup(const char* path)
 
 //////////////////////////////// Longtail_LookupTable
 
+// Open addressing table in the style of a Swiss table. Slots are arranged in groups of 16, each
+// slot has a control byte which is either LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT or 7 bits of the key
+// hash so a whole group is probed with one compare of its control bytes. Keys and values are
+// stored next to each other so a hit costs one more cache miss at most.
+// There is no removal so probing stops at the first group with an empty slot, duplicate keys
+// added with Longtail_LookupTable_Put() are found in the order they were added.
+
+#define LONGTAIL_LOOKUP_TABLE_GROUP_SIZE 16
+#define LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT 0x80u
+
+struct Longtail_LookupTableEntry
+{
+    uint64_t m_Key;
+    uint64_t m_Value;
+};
+
 struct Longtail_LookupTable
 {
-    uint64_t  m_BucketCount;
+    uint64_t m_GroupCount;
 
     uint64_t m_Capacity;
     uint64_t m_Count;
 
-    uint64_t* m_Buckets;
-    uint64_t* m_Keys;
-    uint64_t* m_Values;
-    uint64_t* m_NextIndex;
+    uint8_t* m_Control;
+    struct Longtail_LookupTableEntry* m_Entries;
 };
 
-int Longtail_LookupTable_Put(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value)
+static uint64_t LookupTable_GetGroupCount(size_t capacity)
 {
-    LONGTAIL_FATAL_ASSERT(lut->m_Count < lut->m_Capacity, return ENOMEM)
+    // Keep the load at or below 7/8 and at least one slot empty so probing always terminates
+    uint64_t slot_count = (uint64_t)capacity + (uint64_t)capacity / 7 + 1;
+    return (slot_count + LONGTAIL_LOOKUP_TABLE_GROUP_SIZE - 1) / LONGTAIL_LOOKUP_TABLE_GROUP_SIZE;
+}
 
-    uint64_t entry_index = lut->m_Count++;
-    lut->m_Keys[entry_index] = key;
-    lut->m_Values[entry_index] = value;
+static uint64_t LookupTable_Mix(uint64_t key)
+{
+    // Most keys are already uniform hashes, the multiply is for the ones that are not
+    return key * 0x9E3779B97F4A7C15ull;
+}
 
-    uint64_t bucket_index = key & (lut->m_BucketCount - 1);
-    uint64_t* buckets = lut->m_Buckets;
-    uint64_t index = buckets[bucket_index];
-    if (index == 0xfffffffffffffffful)
-    {
-        buckets[bucket_index] = entry_index;
-        return 0;
-    }
-    uint64_t* next_index = lut->m_NextIndex;
-    uint64_t next = next_index[index];
-    while (next != 0xfffffffffffffffful)
-    {
-        index = next;
-        next = next_index[index];
-    }
+static uint64_t LookupTable_GetGroup(const struct Longtail_LookupTable* lut, uint64_t mixed_key)
+{
+    // Maps the top 32 bits to [0, m_GroupCount) without a modulo so the group count does not have to be a power of two
+    return ((mixed_key >> 32) * lut->m_GroupCount) >> 32;
+}
 
-    next_index[index] = entry_index;
-    return 0;
+static uint8_t LookupTable_GetTag(uint64_t mixed_key)
+{
+    return (uint8_t)((mixed_key >> 25) & 0x7fu);
 }
 
-uint64_t* Longtail_LookupTable_PutUnique(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value)
+static uint32_t LookupTable_MatchGroup(const uint8_t* control, uint8_t tag)
 {
-    uint64_t bucket_index = key & (lut->m_BucketCount - 1);
-    uint64_t* buckets = lut->m_Buckets;
-    uint64_t index = buckets[bucket_index];
-    if (index == 0xfffffffffffffffful)
+#if defined(LONGTAIL_LOOKUP_TABLE_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i*)control);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < LONGTAIL_LOOKUP_TABLE_GROUP_SIZE; ++i)
     {
-        LONGTAIL_FATAL_ASSERT(lut->m_Count < lut->m_Capacity, return 0)
-        uint64_t entry_index = lut->m_Count++;
-        lut->m_Keys[entry_index] = key;
-        lut->m_Values[entry_index] = value;
-        buckets[bucket_index] = entry_index;
-        return 0;
+        mask |= (control[i] == tag) ? (1u << i) : 0u;
     }
-    if (lut->m_Keys[index] == key)
+    return mask;
+#endif
+}
+
+static uint32_t LookupTable_FirstSlot(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+static uint64_t LookupTable_NextGroup(const struct Longtail_LookupTable* lut, uint64_t group)
+{
+    ++group;
+    return group == lut->m_GroupCount ? 0 : group;
+}
+
+static void LookupTable_SetSlot(struct Longtail_LookupTable* lut, uint64_t slot, uint8_t tag, uint64_t key, uint64_t value)
+{
+    lut->m_Control[slot] = tag;
+    lut->m_Entries[slot].m_Key = key;
+    lut->m_Entries[slot].m_Value = value;
+    ++lut->m_Count;
+}
+
+int Longtail_LookupTable_Put(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value)
+{
+    LONGTAIL_FATAL_ASSERT(lut->m_Count < lut->m_Capacity, return ENOMEM)
+
+    uint64_t mixed_key = LookupTable_Mix(key);
+    uint64_t group = LookupTable_GetGroup(lut, mixed_key);
+    while (1)
     {
-        return &lut->m_Values[index];
+        uint32_t empty_mask = LookupTable_MatchGroup(&lut->m_Control[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE], LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT);
+        if (empty_mask)
+        {
+            uint64_t slot = group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE + LookupTable_FirstSlot(empty_mask);
+            LookupTable_SetSlot(lut, slot, LookupTable_GetTag(mixed_key), key, value);
+            return 0;
+        }
+        group = LookupTable_NextGroup(lut, group);
     }
-    uint64_t* keys = lut->m_Keys;
-    uint64_t* next_index = lut->m_NextIndex;
-    uint64_t next = next_index[index];
-    while (next != 0xfffffffffffffffful)
+}
+
+uint64_t* Longtail_LookupTable_PutUnique(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value)
+{
+    uint64_t mixed_key = LookupTable_Mix(key);
+    uint8_t tag = LookupTable_GetTag(mixed_key);
+    uint64_t group = LookupTable_GetGroup(lut, mixed_key);
+    while (1)
     {
-        index = next;
-        if (keys[index] == key)
+        const uint8_t* control = &lut->m_Control[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE];
+        struct Longtail_LookupTableEntry* entries = &lut->m_Entries[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE];
+        uint32_t match_mask = LookupTable_MatchGroup(control, tag);
+        while (match_mask)
         {
-            return &lut->m_Values[index];
+            uint32_t i = LookupTable_FirstSlot(match_mask);
+            if (entries[i].m_Key == key)
+            {
+                return &entries[i].m_Value;
+            }
+            match_mask &= match_mask - 1;
+        }
+        uint32_t empty_mask = LookupTable_MatchGroup(control, LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT);
+        if (empty_mask)
+        {
+            LONGTAIL_FATAL_ASSERT(lut->m_Count < lut->m_Capacity, return 0)
+            uint64_t slot = group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE + LookupTable_FirstSlot(empty_mask);
+            LookupTable_SetSlot(lut, slot, tag, key, value);
+            return 0;
         }
-        next = next_index[index];
+        group = LookupTable_NextGroup(lut, group);
     }
-
-    LONGTAIL_FATAL_ASSERT(lut->m_Count < lut->m_Capacity, return 0)
-    uint64_t entry_index = lut->m_Count++;
-    keys[entry_index] = key;
-    lut->m_Values[entry_index] = value;
-    next_index[index] = entry_index;
-    return 0;
 }
 
 uint64_t* Longtail_LookupTable_Get(const struct Longtail_LookupTable* lut, uint64_t key)
 {
-    uint64_t bucket_index = key & (lut->m_BucketCount - 1);
-    uint64_t index = lut->m_Buckets[bucket_index];
-    const uint64_t* keys = lut->m_Keys;
-    const uint64_t* next_index = lut->m_NextIndex;
-    while (index != 0xfffffffffffffffful)
+    uint64_t mixed_key = LookupTable_Mix(key);
+    uint8_t tag = LookupTable_GetTag(mixed_key);
+    uint64_t group = LookupTable_GetGroup(lut, mixed_key);
+    while (1)
     {
-        if (keys[index] == key)
+        const uint8_t* control = &lut->m_Control[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE];
+        struct Longtail_LookupTableEntry* entries = &lut->m_Entries[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE];
+        uint32_t match_mask = LookupTable_MatchGroup(control, tag);
+        while (match_mask)
+        {
+            uint32_t i = LookupTable_FirstSlot(match_mask);
+            if (entries[i].m_Key == key)
+            {
+                return &entries[i].m_Value;
+            }
+            match_mask &= match_mask - 1;
+        }
+        if (LookupTable_MatchGroup(control, LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT))
         {
-            return &lut->m_Values[index];
+            return 0;
         }
-        index = next_index[index];
+        group = LookupTable_NextGroup(lut, group);
     }
-    return 0;
 }
 
-uint64_t Longtail_LookupTable_GetSpaceLeft(const struct Longtail_LookupTable* lut)
-{
-    return lut->m_Capacity - lut->m_Count;
-}
+#define LONGTAIL_LOOKUP_TABLE_PREFETCH_DISTANCE 16
+
+// Number of keys callers pass to Longtail_LookupTable_GetBatch() at a time from a stack array
+#define LONGTAIL_LOOKUP_TABLE_BATCH_SIZE 256
 
-static size_t GetLookupTableSize(size_t capacity)
+void Longtail_LookupTable_GetBatch(const struct Longtail_LookupTable* lut, uint64_t count, const uint64_t* keys, uint64_t** out_values)
 {
-    size_t table_size = 1;
-    while (table_size < (capacity / 8))
+    // Two stage pipeline, the control bytes of a key are fetched two distances ahead and the entry
+    // of its first tag match one distance ahead so the lookup itself mostly hits the cache
+    for (uint64_t i = 0; i < count; ++i)
     {
-        table_size <<= 1;
+        if (i + 2 * LONGTAIL_LOOKUP_TABLE_PREFETCH_DISTANCE < count)
+        {
+            uint64_t group = LookupTable_GetGroup(lut, LookupTable_Mix(keys[i + 2 * LONGTAIL_LOOKUP_TABLE_PREFETCH_DISTANCE]));
+            LONGTAIL_PREFETCH(&lut->m_Control[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE]);
+        }
+        if (i + LONGTAIL_LOOKUP_TABLE_PREFETCH_DISTANCE < count)
+        {
+            uint64_t mixed_key = LookupTable_Mix(keys[i + LONGTAIL_LOOKUP_TABLE_PREFETCH_DISTANCE]);
+            uint64_t group = LookupTable_GetGroup(lut, mixed_key);
+            uint32_t match_mask = LookupTable_MatchGroup(&lut->m_Control[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE], LookupTable_GetTag(mixed_key));
+            if (match_mask)
+            {
+                LONGTAIL_PREFETCH(&lut->m_Entries[group * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE + LookupTable_FirstSlot(match_mask)]);
+            }
+        }
+        out_values[i] = Longtail_LookupTable_Get(lut, keys[i]);
     }
-    return table_size;
+}
+
+uint64_t Longtail_LookupTable_GetSpaceLeft(const struct Longtail_LookupTable* lut)
+{
+    return lut->m_Capacity - lut->m_Count;
 }
 
 size_t Longtail_LookupTable_GetSize(size_t capacity)
 {
-    size_t table_size = GetLookupTableSize(capacity);
+    uint64_t slot_count = LookupTable_GetGroupCount(capacity) * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE;
     size_t mem_size = sizeof(struct Longtail_LookupTable) +
-        sizeof(uint64_t) * table_size +
-        sizeof(uint64_t) * capacity +
-        sizeof(uint64_t) * capacity +
-        sizeof(uint64_t) * capacity;
+        sizeof(uint8_t) * slot_count +
+        sizeof(struct Longtail_LookupTableEntry) * slot_count;
     return mem_size;
 }
 
 struct Longtail_LookupTable* Longtail_LookupTable_Create(void* mem, size_t capacity, struct Longtail_LookupTable* optional_source_entries)
 {
     struct Longtail_LookupTable* lut = (struct Longtail_LookupTable*)mem;
-    size_t table_size = GetLookupTableSize(capacity);
-    lut->m_BucketCount = table_size;
+    uint64_t group_count = LookupTable_GetGroupCount(capacity);
+    uint64_t slot_count = group_count * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE;
+    lut->m_GroupCount = group_count;
     lut->m_Capacity = capacity;
     lut->m_Count = 0;
-    lut->m_Buckets = (uint64_t*)&lut[1];
-    lut->m_Keys = (uint64_t*)&lut->m_Buckets[table_size];
-    lut->m_Values = &lut->m_Keys[capacity];
-    lut->m_NextIndex = &lut->m_Values[capacity];
+    lut->m_Control = (uint8_t*)&lut[1];
+    lut->m_Entries = (struct Longtail_LookupTableEntry*)&lut->m_Control[slot_count];
 
-    memset(lut->m_Buckets, 0xff, sizeof(uint64_t) * table_size);
-    memset(lut->m_NextIndex, 0xff, sizeof(uint64_t) * capacity);
+    memset(lut->m_Control, LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT, sizeof(uint8_t) * slot_count);
 
     if (optional_source_entries == 0)
     {
         return lut;
     }
-    for (uint64_t i = 0; i < optional_source_entries->m_BucketCount; ++i)
+    uint64_t source_slot_count = optional_source_entries->m_GroupCount * LONGTAIL_LOOKUP_TABLE_GROUP_SIZE;
+    for (uint64_t i = 0; i < source_slot_count; ++i)
     {
-        if (optional_source_entries->m_Buckets[i] != 0xfffffffffffffffful)
+        if (optional_source_entries->m_Control[i] != LONGTAIL_LOOKUP_TABLE_EMPTY_SLOT)
         {
-            uint64_t index = optional_source_entries->m_Buckets[i];
-            while (index != 0xfffffffffffffffful)
-            {
-                uint64_t key = optional_source_entries->m_Keys[index];
-                uint64_t value = optional_source_entries->m_Values[index];
-                Longtail_LookupTable_Put(lut, key, value);
-                index = optional_source_entries->m_NextIndex[index];
-            }
+            const struct Longtail_LookupTableEntry* entry = &optional_source_entries->m_Entries[i];
+            Longtail_LookupTable_Put(lut, entry->m_Key, entry->m_Value);
         }
     }
     return lut;
@@ -1050,6 +1643,9 @@ static size_t GetFileInfosSize(uint32_t path_count, uint32_t path_data_size)
         sizeof(uint32_t) * path_count +    // m_Permissions[path_count]
         sizeof(uint32_t) * path_count +    // m_Offsets[path_count]
         sizeof(uint64_t) * path_count +    // m_Sizes[path_count]
+        sizeof(uint64_t) * path_count +    // m_ModificationTimes[path_count]
+        sizeof(uint64_t) * path_count +    // m_ChangeTimes[path_count]
+        sizeof(uint64_t) * path_count +    // m_FileIds[path_count]
         path_data_size;
 };
 
@@ -1070,7 +1666,13 @@ static struct Longtail_FileInfos* CreateFileInfos(uint32_t path_count, uint32_t
     file_infos->m_PathDataSize = 0;
     file_infos->m_Sizes = (uint64_t*)p;
     p += sizeof(uint64_t) * path_count;
-    file_infos->m_PathStartOffsets = (uint32_t*)p;
+    file_infos->m_ModificationTimes = (uint64_t*)p;
+    p += sizeof(uint64_t) * path_count;
+    file_infos->m_ChangeTimes = (uint64_t*)p;
+    p += sizeof(uint64_t) * path_count;
+    file_infos->m_FileIds = (uint64_t*)p;
+    p += sizeof(uint64_t) * path_count;
+    file_infos->m_PathStartOffsets = (uint32_t*)p;
     p += sizeof(uint32_t) * path_count;
     file_infos->m_Permissions = (uint16_t*)p;
     p += sizeof(uint16_t) * path_count;
@@ -1110,6 +1712,9 @@ int Longtail_MakeFileInfos(
     {
         uint32_t length = (uint32_t)strlen(path_names[i]) + 1;
         file_infos->m_Sizes[i] = file_sizes[i];
+        file_infos->m_ModificationTimes[i] = 0;
+        file_infos->m_ChangeTimes[i] = 0;
+        file_infos->m_FileIds[i] = 0;
         file_infos->m_Permissions[i] = file_permissions[i];
         file_infos->m_PathStartOffsets[i] = offset;
         memmove(&file_infos->m_PathData[offset], path_names[i], length);
@@ -1126,6 +1731,9 @@ static int AppendPath(
     const char* path,
     uint64_t file_size,
     uint16_t file_permissions,
+    uint64_t modification_time,
+    uint64_t change_time,
+    uint64_t file_id,
     uint32_t* max_path_count,
     uint32_t* max_data_size,
     uint32_t path_count_increment,
@@ -1161,6 +1769,9 @@ static int AppendPath(
         new_file_infos->m_Count = (*file_infos)->m_Count;
 
         memmove(new_file_infos->m_Sizes, (*file_infos)->m_Sizes, sizeof(uint64_t) * (*file_infos)->m_Count);
+        memmove(new_file_infos->m_ModificationTimes, (*file_infos)->m_ModificationTimes, sizeof(uint64_t) * (*file_infos)->m_Count);
+        memmove(new_file_infos->m_ChangeTimes, (*file_infos)->m_ChangeTimes, sizeof(uint64_t) * (*file_infos)->m_Count);
+        memmove(new_file_infos->m_FileIds, (*file_infos)->m_FileIds, sizeof(uint64_t) * (*file_infos)->m_Count);
         memmove(new_file_infos->m_PathStartOffsets, (*file_infos)->m_PathStartOffsets, sizeof(uint32_t) * (*file_infos)->m_Count);
         memmove(new_file_infos->m_Permissions, (*file_infos)->m_Permissions, sizeof(uint32_t) * (*file_infos)->m_Count);
         memmove(new_file_infos->m_PathData, (*file_infos)->m_PathData, (*file_infos)->m_PathDataSize);
@@ -1174,6 +1785,9 @@ static int AppendPath(
     (*file_infos)->m_PathDataSize += path_size;
     (*file_infos)->m_Sizes[(*file_infos)->m_Count] = file_size;
     (*file_infos)->m_Permissions[(*file_infos)->m_Count] = file_permissions;
+    (*file_infos)->m_ModificationTimes[(*file_infos)->m_Count] = modification_time;
+    (*file_infos)->m_ChangeTimes[(*file_infos)->m_Count] = change_time;
+    (*file_infos)->m_FileIds[(*file_infos)->m_Count] = file_id;
     (*file_infos)->m_Count++;
 
     return 0;
@@ -1205,7 +1819,7 @@ static int AddFile(void* context, const char* root_path, const char* asset_path,
         full_path[asset_path_length + 1] = 0;
     }
 
-    int err = AppendPath(&paths_context->m_FileInfos, full_path, properties->m_Size, properties->m_Permissions, &paths_context->m_ReservedPathCount, &paths_context->m_ReservedPathSize, 512, 128);
+    int err = AppendPath(&paths_context->m_FileInfos, full_path, properties->m_Size, properties->m_Permissions, properties->m_ModificationTime, properties->m_ChangeTime, properties->m_FileId, &paths_context->m_ReservedPathCount, &paths_context->m_ReservedPathSize, 512, 128);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "AddFile(%p, %s, %s, %s, %d, %" PRIu64 ", %u) failed with %d",
@@ -1253,6 +1867,7 @@ int Longtail_GetFilesRecursively(
     struct AddFile_Context context = {storage_api, default_path_count, default_path_data_size, (uint32_t)(strlen(root_path)), file_infos};
     file_infos = 0;
 
+    uint64_t scan_start_time = Longtail_GetMetricTime();
     int err = RecurseTree(storage_api, optional_path_filter_api, optional_cancel_api, optional_cancel_token, root_path, AddFile, &context);
     if(err)
     {
@@ -1263,6 +1878,8 @@ int Longtail_GetFilesRecursively(
         context.m_FileInfos = 0;
         return err;
     }
+    Longtail_ObserveMetricTime(Longtail_Metric_Scan_Time, scan_start_time);
+    Longtail_AddMetric(Longtail_Metric_Scan_EntryCount, context.m_FileInfos->m_Count);
 
     *out_file_infos = context.m_FileInfos;
     context.m_FileInfos = 0;
@@ -1277,6 +1894,7 @@ struct StorageChunkFeederContext
     uint64_t m_StartRange;
     uint64_t m_Size;
     uint64_t m_Offset;
+    const char* m_Data;
 };
 
 static int StorageChunkFeederFunc(void* context, Longtail_ChunkerAPI_HChunker chunker, uint32_t requested_size, char* buffer, uint32_t* out_size)
@@ -1296,13 +1914,20 @@ static int StorageChunkFeederFunc(void* context, Longtail_ChunkerAPI_HChunker ch
         {
             read_count = requested_size;
         }
-        int err = c->m_StorageAPI->Read(c->m_StorageAPI, c->m_AssetFile, c->m_StartRange + c->m_Offset, (uint32_t)read_count, buffer);
-        if (err)
+        if (c->m_Data)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "StorageChunkFeederFunc(%p, %p, %u, %p, %p) failed with %d",
-                context, (void*)chunker, requested_size, (void*)buffer, (void*)out_size,
-                err)
-            return err;
+            memcpy(buffer, &c->m_Data[c->m_Offset], (size_t)read_count);
+        }
+        else
+        {
+            int err = c->m_StorageAPI->Read(c->m_StorageAPI, c->m_AssetFile, c->m_StartRange + c->m_Offset, (uint32_t)read_count, buffer);
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "StorageChunkFeederFunc(%p, %p, %u, %p, %p) failed with %d",
+                    context, (void*)chunker, requested_size, (void*)buffer, (void*)out_size,
+                    err)
+                return err;
+            }
         }
         c->m_Offset += read_count;
     }
@@ -1328,6 +1953,7 @@ struct HashJob
     uint32_t* m_ChunkTags;
     uint32_t* m_ChunkSizes;
     uint32_t m_TargetChunkSize;
+    char* m_ChunkData;
     int m_Err;
 };
 
@@ -1335,6 +1961,11 @@ struct HashJob
 #define AVG_CHUNKER_SIZE(min_chunk_size, target_chunk_size) (((target_chunk_size / 2) < min_chunk_size) ? min_chunk_size : (target_chunk_size / 2))
 #define MAX_CHUNKER_SIZE(min_chunk_size, target_chunk_size) (((target_chunk_size * 2) < min_chunk_size) ? min_chunk_size : (target_chunk_size * 2))
 
+// Smaller ranges are read into memory in one go, mapping and unmapping them costs more than the copy
+#define MIN_MAPPED_CHUNKING_SIZE (1024u * 1024u)
+// Number of chunks handed to HashAPI::HashBuffers at a time
+#define HASH_BATCH_CHUNK_COUNT 64u
+
 static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "DynamicChunking(%p, %u)",
@@ -1370,6 +2001,9 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
         return 0;
     }
     uint32_t chunk_count = 0;
+    // Includes reading and hashing, the hashing is also reported on its own
+    uint64_t chunk_start_time = Longtail_GetMetricTime();
+    uint64_t hash_time = 0;
 
     struct Longtail_StorageAPI* storage_api = hash_job->m_StorageAPI;
     char* path = storage_api->ConcatPath(storage_api, hash_job->m_RootPath, hash_job->m_Path);
@@ -1385,6 +2019,8 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
         hash_job->m_Err = err;
         return 0;
     }
+    // Chunking reads the range front to back, the hint is best effort
+    storage_api->AdviseSequentialRead(storage_api, file_handle);
 
 
     uint64_t hash_size = hash_job->m_SizeRange;
@@ -1402,7 +2038,47 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
             hash_job->m_Err = err;
             return 0;
         }
-        if (hash_size <= chunker_min_size)
+        if (hash_job->m_ChunkData)
+        {
+            // The caller wants the chunk data as well, read the whole range once and chunk from memory
+            err = storage_api->Read(storage_api, file_handle, hash_job->m_StartRange, hash_size, hash_job->m_ChunkData);
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
+                    context, job_id, is_cancelled,
+                    err)
+                storage_api->CloseFile(storage_api, file_handle);
+                file_handle = 0;
+                Longtail_Free(path);
+                path = 0;
+                hash_job->m_Err = err;
+                return 0;
+            }
+        }
+        if (hash_size <= chunker_min_size && hash_job->m_ChunkData)
+        {
+            uint64_t hash_start_time = Longtail_GetMetricTime();
+            err = hash_job->m_HashAPI->HashBuffer(hash_job->m_HashAPI, (uint32_t)hash_size, hash_job->m_ChunkData, &hash_job->m_ChunkHashes[chunk_count]);
+            hash_time += hash_start_time ? Longtail_GetMetricTime() - hash_start_time : 0;
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
+                    context, job_id, is_cancelled,
+                    err)
+                storage_api->CloseFile(storage_api, file_handle);
+                file_handle = 0;
+                Longtail_Free(path);
+                path = 0;
+                hash_job->m_Err = err;
+                return 0;
+            }
+
+            hash_job->m_ChunkSizes[chunk_count] = (uint32_t)hash_size;
+            hash_job->m_ChunkTags[chunk_count] = hash_job->m_ContentTag;
+
+            ++chunk_count;
+        }
+        else if (hash_size <= chunker_min_size)
         {
             char* buffer = (char*)Longtail_Alloc((size_t)hash_size);
             if (!buffer)
@@ -1433,7 +2109,9 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
                 return 0;
             }
 
+            uint64_t hash_start_time = Longtail_GetMetricTime();
             err = hash_job->m_HashAPI->HashBuffer(hash_job->m_HashAPI, (uint32_t)hash_size, buffer, &hash_job->m_ChunkHashes[chunk_count]);
+            hash_time += hash_start_time ? Longtail_GetMetricTime() - hash_start_time : 0;
             if (err)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with ",
@@ -1477,35 +2155,97 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
                 return 0;
             }
 
-            struct StorageChunkFeederContext feeder_context =
+            // Chunk straight from the data if it is already in memory or the file can be mapped, otherwise feed the chunker
+            const uint8_t* chunk_data = (const uint8_t*)hash_job->m_ChunkData;
+            Longtail_StorageAPI_HFileMap file_map = 0;
+            char* read_buffer = 0;
+            if (chunk_data == 0 && hash_job->m_ChunkerAPI->NextChunkFromBuffer && hash_size < MIN_MAPPED_CHUNKING_SIZE)
             {
-                storage_api,
-                file_handle,
-                path,
-                hash_job->m_StartRange,
-                hash_size,
-                0
-            };
-
-            if (err)
+                read_buffer = (char*)Longtail_Alloc((size_t)hash_size);
+                err = read_buffer ? storage_api->Read(storage_api, file_handle, hash_job->m_StartRange, hash_size, read_buffer) : ENOMEM;
+                if (err)
+                {
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
+                        context, job_id, is_cancelled,
+                        err)
+                    Longtail_Free(read_buffer);
+                    read_buffer = 0;
+                    hash_job->m_ChunkerAPI->DisposeChunker(hash_job->m_ChunkerAPI, chunker);
+                    chunker = 0;
+                    storage_api->CloseFile(storage_api, file_handle);
+                    file_handle = 0;
+                    Longtail_Free(path);
+                    path = 0;
+                    hash_job->m_Err = err;
+                    return 0;
+                }
+                chunk_data = (const uint8_t*)read_buffer;
+            }
+            else if (chunk_data == 0 && hash_job->m_ChunkerAPI->NextChunkFromBuffer)
             {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
-                    context, job_id, is_cancelled,
-                    err)
-                storage_api->CloseFile(storage_api, file_handle);
-                file_handle = 0;
-                Longtail_Free(path);
-                path = 0;
-                hash_job->m_Err = err;
-                return 0;
+                const void* mapped_data = 0;
+                err = storage_api->MapFile(storage_api, file_handle, hash_job->m_StartRange, hash_size, &file_map, &mapped_data);
+                if (err == 0)
+                {
+                    chunk_data = (const uint8_t*)mapped_data;
+                }
+                else
+                {
+                    if (err != ENOTSUP)
+                    {
+                        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "DynamicChunking(%p, %u, %d) failed to map `%s` with %d, reading it instead",
+                            context, job_id, is_cancelled,
+                            path, err)
+                    }
+                    file_map = 0;
+                    err = 0;
+                }
             }
 
-            struct Longtail_Chunker_ChunkRange chunk_range;
-            err = hash_job->m_ChunkerAPI->NextChunk(hash_job->m_ChunkerAPI, chunker, StorageChunkFeederFunc, &feeder_context, &chunk_range);
-            while (err == 0)
+            if (chunk_data && hash_job->m_ChunkerAPI->NextChunkFromBuffer)
             {
-                err = hash_job->m_HashAPI->HashBuffer(hash_job->m_HashAPI, chunk_range.len, (void*)chunk_range.buf, &hash_job->m_ChunkHashes[chunk_count]);
-                if (err != 0)
+                // Find all the chunk boundaries first so the chunks can be hashed in batches
+                const uint8_t* chunk_start = chunk_data;
+                const uint8_t* data_end = &chunk_data[hash_size];
+                while (chunk_start < data_end)
+                {
+                    const void* next_chunk_start;
+                    err = hash_job->m_ChunkerAPI->NextChunkFromBuffer(hash_job->m_ChunkerAPI, chunker, chunk_start, (uint64_t)(data_end - chunk_start), &next_chunk_start);
+                    if (err)
+                    {
+                        break;
+                    }
+                    hash_job->m_ChunkSizes[chunk_count] = (uint32_t)((const uint8_t*)next_chunk_start - chunk_start);
+                    hash_job->m_ChunkTags[chunk_count] = hash_job->m_ContentTag;
+
+                    ++chunk_count;
+                    chunk_start = (const uint8_t*)next_chunk_start;
+                }
+                chunk_start = chunk_data;
+                uint32_t chunk_index = 0;
+                while (err == 0 && chunk_index < chunk_count)
+                {
+                    const void* batch_data[HASH_BATCH_CHUNK_COUNT];
+                    uint32_t batch_count = 0;
+                    while (batch_count < HASH_BATCH_CHUNK_COUNT && chunk_index + batch_count < chunk_count)
+                    {
+                        batch_data[batch_count] = chunk_start;
+                        chunk_start += hash_job->m_ChunkSizes[chunk_index + batch_count];
+                        ++batch_count;
+                    }
+                    uint64_t hash_start_time = Longtail_GetMetricTime();
+                    err = Longtail_Hash_HashBuffers(hash_job->m_HashAPI, batch_count, &hash_job->m_ChunkSizes[chunk_index], batch_data, &hash_job->m_ChunkHashes[chunk_index]);
+                    hash_time += hash_start_time ? Longtail_GetMetricTime() - hash_start_time : 0;
+                    chunk_index += batch_count;
+                }
+                if (file_map)
+                {
+                    storage_api->UnmapFile(storage_api, file_map);
+                    file_map = 0;
+                }
+                Longtail_Free(read_buffer);
+                read_buffer = 0;
+                if (err)
                 {
                     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
                         context, job_id, is_cancelled,
@@ -1519,12 +2259,48 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
                     hash_job->m_Err = err;
                     return 0;
                 }
-                hash_job->m_ChunkSizes[chunk_count] = chunk_range.len;
-                hash_job->m_ChunkTags[chunk_count] = hash_job->m_ContentTag;
-
-                ++chunk_count;
+            }
+            else
+            {
+                struct StorageChunkFeederContext feeder_context =
+                {
+                    storage_api,
+                    file_handle,
+                    path,
+                    hash_job->m_StartRange,
+                    hash_size,
+                    0,
+                    hash_job->m_ChunkData
+                };
 
+                struct Longtail_Chunker_ChunkRange chunk_range;
                 err = hash_job->m_ChunkerAPI->NextChunk(hash_job->m_ChunkerAPI, chunker, StorageChunkFeederFunc, &feeder_context, &chunk_range);
+                while (err == 0)
+                {
+                    uint64_t hash_start_time = Longtail_GetMetricTime();
+                    err = hash_job->m_HashAPI->HashBuffer(hash_job->m_HashAPI, chunk_range.len, (void*)chunk_range.buf, &hash_job->m_ChunkHashes[chunk_count]);
+                    hash_time += hash_start_time ? Longtail_GetMetricTime() - hash_start_time : 0;
+                    if (err != 0)
+                    {
+                        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "DynamicChunking(%p, %u, %d) failed with %d",
+                            context, job_id, is_cancelled,
+                            err)
+                        hash_job->m_ChunkerAPI->DisposeChunker(hash_job->m_ChunkerAPI, chunker);
+                        chunker = 0;
+                        storage_api->CloseFile(storage_api, file_handle);
+                        file_handle = 0;
+                        Longtail_Free(path);
+                        path = 0;
+                        hash_job->m_Err = err;
+                        return 0;
+                    }
+                    hash_job->m_ChunkSizes[chunk_count] = chunk_range.len;
+                    hash_job->m_ChunkTags[chunk_count] = hash_job->m_ContentTag;
+
+                    ++chunk_count;
+
+                    err = hash_job->m_ChunkerAPI->NextChunk(hash_job->m_ChunkerAPI, chunker, StorageChunkFeederFunc, &feeder_context, &chunk_range);
+                }
             }
 
             hash_job->m_ChunkerAPI->DisposeChunker(hash_job->m_ChunkerAPI, chunker);
@@ -1537,6 +2313,13 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
     LONGTAIL_FATAL_ASSERT(chunk_count <= hash_job->m_MaxChunkCount, hash_job->m_Err = EINVAL; return 0)
     *hash_job->m_AssetChunkCount = chunk_count;
 
+    if (chunk_start_time)
+    {
+        Longtail_ObserveMetric(Longtail_Metric_Hash_Time, hash_time);
+        Longtail_ObserveMetricTime(Longtail_Metric_Chunk_Time, chunk_start_time);
+        Longtail_AddMetric(Longtail_Metric_Chunk_ByteCount, hash_job->m_SizeRange);
+    }
+
     Longtail_Free((char*)path);
     path = 0;
 
@@ -1544,112 +2327,518 @@ static int DynamicChunking(void* context, uint32_t job_id, int is_cancelled)
     return 0;
 }
 
-static int ChunkAssets(
-    struct Longtail_StorageAPI* storage_api,
-    struct Longtail_HashAPI* hash_api,
-    struct Longtail_ChunkerAPI* chunker_api,
-    struct Longtail_JobAPI* job_api,
-    struct Longtail_ProgressAPI* progress_api,
-    struct Longtail_CancelAPI* optional_cancel_api,
-    Longtail_CancelAPI_HCancelToken optional_cancel_token,
-    const char* root_path,
-    const struct Longtail_FileInfos* file_infos,
-    TLongtail_Hash* path_hashes,
-    TLongtail_Hash* content_hashes,
-    const uint32_t* optional_asset_tags,
-    uint32_t* asset_chunk_start_index,
-    uint32_t* asset_chunk_counts,
-    uint32_t** chunk_sizes,
-    TLongtail_Hash** chunk_hashes,
-    uint32_t** chunk_tags,
-    uint32_t target_chunk_size,
-    uint32_t* chunk_count)
+static int DisposePutBlock(struct Longtail_StoredBlock* stored_block)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p)",
-        storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count)
-    LONGTAIL_FATAL_ASSERT(storage_api != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(hash_api != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(job_api != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(root_path != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(file_infos != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(path_hashes != 0, return EINVAL)
-
-    LONGTAIL_FATAL_ASSERT(content_hashes != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(asset_chunk_start_index != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(asset_chunk_counts != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(chunk_sizes != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(chunk_hashes != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(chunk_tags != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(target_chunk_size != 0, return EINVAL)
-    LONGTAIL_FATAL_ASSERT(chunk_count != 0, return EINVAL)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "DisposePutBlock(%p)",
+        stored_block)
+    Longtail_Free(stored_block->m_BlockIndex);
+    Longtail_Free(stored_block->m_BlockData);
+    Longtail_Free(stored_block);
+    return 0;
+}
 
-    uint32_t asset_count = file_infos->m_Count;
+struct PutBlockJob
+{
+    struct Longtail_AsyncPutStoredBlockAPI m_AsyncCompleteAPI;
+    struct Longtail_BlockStoreAPI* m_BlockStoreAPI;
+    struct Longtail_JobAPI* m_JobAPI;
+    uint32_t m_JobID;
+    struct Longtail_StoredBlock* m_StoredBlock;
+    int m_Err;
+};
 
-    uint64_t max_hash_size = target_chunk_size * 1024;
-    uint32_t job_count = 0;
+static void PutBlockJobOnComplete(struct Longtail_AsyncPutStoredBlockAPI* async_complete_api, int err)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "PutBlockJobOnComplete(%p, %d)",
+        async_complete_api, err)
+    LONGTAIL_FATAL_ASSERT(async_complete_api != 0, return)
+    struct PutBlockJob* job = (struct PutBlockJob*)async_complete_api;
+    LONGTAIL_FATAL_ASSERT(job->m_AsyncCompleteAPI.OnComplete != 0, return);
+    LONGTAIL_FATAL_ASSERT(job->m_StoredBlock != 0, return);
+    LONGTAIL_FATAL_ASSERT(job->m_JobID != 0, return);
+    uint32_t job_id = job->m_JobID;
+    job->m_StoredBlock->Dispose(job->m_StoredBlock);
+    job->m_StoredBlock = 0;
+    job->m_JobID = 0;
+    job->m_Err = err;
+    job->m_JobAPI->ResumeJob(job->m_JobAPI, job_id);
+}
 
-    uint32_t min_chunk_size;
-    int err = chunker_api->GetMinChunkSize(chunker_api, &min_chunk_size);
+static int PutBlock(void* context, uint32_t job_id, int is_cancelled)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "PutBlock(%p, %u, %d)",
+        context, job_id, is_cancelled)
+    LONGTAIL_FATAL_ASSERT(context != 0, return EINVAL)
+    struct PutBlockJob* job = (struct PutBlockJob*)context;
 
-    uint64_t max_chunk_count = 0;
-    for (uint64_t asset_index = 0; asset_index < asset_count; ++asset_index)
+    if (job->m_AsyncCompleteAPI.OnComplete)
     {
-        uint64_t asset_size = file_infos->m_Sizes[asset_index];
-        uint64_t asset_part_count = 1 + (asset_size / max_hash_size);
-        job_count += (uint32_t)asset_part_count;
-
-        for (uint64_t job_part = 0; job_part < asset_part_count; ++job_part)
-        {
-            uint64_t range_start = job_part * max_hash_size;
-            uint64_t job_size = (asset_size - range_start) > max_hash_size ? max_hash_size : (asset_size - range_start);
-
-            uint32_t max_count = (uint32_t)(job_size == 0 ? 0 : 1 + (job_size / min_chunk_size));
-            max_chunk_count += max_count;
-        }
+        // We got a notification so we are complete
+        job->m_AsyncCompleteAPI.OnComplete = 0;
+        return 0;
     }
 
-    if (job_count == 0)
+    if (is_cancelled)
     {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "PutBlock(%p, %u, %d) failed with %d",
+            context, job_id, is_cancelled,
+            ECANCELED)
+        job->m_StoredBlock->Dispose(job->m_StoredBlock);
+        job->m_StoredBlock = 0;
+        job->m_Err = ECANCELED;
         return 0;
     }
 
-    Longtail_JobAPI_Group job_group = 0;
-    err = job_api->ReserveJobs(job_api, job_count, &job_group);
+    job->m_JobID = job_id;
+    job->m_AsyncCompleteAPI.OnComplete = PutBlockJobOnComplete;
+
+    int err = job->m_BlockStoreAPI->PutStoredBlock(job->m_BlockStoreAPI, job->m_StoredBlock, &job->m_AsyncCompleteAPI);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "PutBlock(%p, %u, %d) failed with %d",
+            context, job_id, is_cancelled,
             err)
-        return err;
+        job->m_StoredBlock->Dispose(job->m_StoredBlock);
+        job->m_StoredBlock = 0;
+        job->m_JobID = 0;
+        job->m_Err = err;
+        return 0;
     }
+    return EBUSY;
+}
 
-    size_t work_mem_size = (sizeof(uint32_t) * job_count) +
-        (sizeof(TLongtail_Hash) * max_chunk_count) +
-        (sizeof(uint32_t) * max_chunk_count) +
-        (sizeof(uint32_t) * max_chunk_count) +
-        (sizeof(struct HashJob) * job_count);
+// Packs chunks into blocks in the order they are added, using the same rules as Longtail_CreateContentIndexRaw,
+// so the resulting blocks are identical to those created from the finished version index
+struct BlockPacker
+{
+    struct Longtail_HashAPI* m_HashAPI;
+    struct Longtail_BlockStoreAPI* m_BlockStoreAPI;
+    struct Longtail_JobAPI* m_JobAPI;
+    uint32_t m_MaxBlockSize;
+    uint32_t m_MaxChunksPerBlock;
+    uint64_t* m_ChunkIndexes;
+    TLongtail_Hash* m_ChunkHashes;
+    uint32_t* m_ChunkSizes;
+    uint32_t m_ChunkCount;
+    uint32_t m_Tag;
+    char* m_BlockData;
+    uint32_t m_BlockDataSize;
+    struct Longtail_BlockIndex** m_BlockIndexes;
+    struct PutBlockJob* m_PutBlockJobs;
+};
+
+static int BlockPacker_Init(
+    struct BlockPacker* block_packer,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_BlockStoreAPI* block_store_api,
+    struct Longtail_JobAPI* job_api,
+    uint32_t max_block_size,
+    uint32_t max_chunks_per_block)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockPacker_Init(%p, %p, %p, %p, %u, %u)",
+        block_packer, hash_api, block_store_api, job_api, max_block_size, max_chunks_per_block)
+    LONGTAIL_FATAL_ASSERT(block_packer != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(max_chunks_per_block != 0, return EINVAL)
+
+    size_t work_mem_size =
+        (sizeof(uint64_t) * max_chunks_per_block) +
+        (sizeof(TLongtail_Hash) * max_chunks_per_block) +
+        (sizeof(uint32_t) * max_chunks_per_block);
     void* work_mem = Longtail_Alloc(work_mem_size);
     if (!work_mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockPacker_Init(%p, %p, %p, %p, %u, %u) failed with %d",
+            block_packer, hash_api, block_store_api, job_api, max_block_size, max_chunks_per_block,
             ENOMEM)
         return ENOMEM;
     }
+    block_packer->m_HashAPI = hash_api;
+    block_packer->m_BlockStoreAPI = block_store_api;
+    block_packer->m_JobAPI = job_api;
+    block_packer->m_MaxBlockSize = max_block_size;
+    block_packer->m_MaxChunksPerBlock = max_chunks_per_block;
+    block_packer->m_ChunkIndexes = (uint64_t*)work_mem;
+    block_packer->m_ChunkHashes = (TLongtail_Hash*)&block_packer->m_ChunkIndexes[max_chunks_per_block];
+    block_packer->m_ChunkSizes = (uint32_t*)&block_packer->m_ChunkHashes[max_chunks_per_block];
+    block_packer->m_ChunkCount = 0;
+    block_packer->m_Tag = 0;
+    block_packer->m_BlockData = 0;
+    block_packer->m_BlockDataSize = 0;
+    block_packer->m_BlockIndexes = 0;
+    block_packer->m_PutBlockJobs = 0;
+    for (uint32_t c = 0; c < max_chunks_per_block; ++c)
+    {
+        block_packer->m_ChunkIndexes[c] = c;
+    }
+    return 0;
+}
 
-    uint32_t* tmp_job_chunk_counts = (uint32_t*)work_mem;
-    TLongtail_Hash* tmp_hashes = (TLongtail_Hash*)&tmp_job_chunk_counts[job_count];
-    uint32_t* tmp_sizes = (uint32_t*)&tmp_hashes[max_chunk_count];
-    uint32_t* tmp_tags = (uint32_t*)&tmp_sizes[max_chunk_count];
-    struct HashJob* tmp_hash_jobs = (struct HashJob*)&tmp_tags[max_chunk_count];
+static void BlockPacker_Dispose(struct BlockPacker* block_packer)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockPacker_Dispose(%p)",
+        block_packer)
+    size_t put_block_job_count = arrlen(block_packer->m_PutBlockJobs);
+    for (size_t j = 0; j < put_block_job_count; ++j)
+    {
+        struct Longtail_StoredBlock* stored_block = block_packer->m_PutBlockJobs[j].m_StoredBlock;
+        if (stored_block)
+        {
+            stored_block->Dispose(stored_block);
+        }
+    }
+    arrfree(block_packer->m_PutBlockJobs);
+    size_t block_count = arrlen(block_packer->m_BlockIndexes);
+    for (size_t b = 0; b < block_count; ++b)
+    {
+        Longtail_Free(block_packer->m_BlockIndexes[b]);
+    }
+    arrfree(block_packer->m_BlockIndexes);
+    Longtail_Free(block_packer->m_BlockData);
+    Longtail_Free(block_packer->m_ChunkIndexes);
+}
+
+static int BlockPacker_FlushBlock(struct BlockPacker* block_packer)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockPacker_FlushBlock(%p)",
+        block_packer)
+    if (block_packer->m_ChunkCount == 0)
+    {
+        return 0;
+    }
+    uint32_t chunk_count = block_packer->m_ChunkCount;
+    struct Longtail_BlockIndex* block_index;
+    int err = Longtail_CreateBlockIndex(
+        block_packer->m_HashAPI,
+        block_packer->m_Tag,
+        chunk_count,
+        block_packer->m_ChunkIndexes,
+        block_packer->m_ChunkHashes,
+        block_packer->m_ChunkSizes,
+        &block_index);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockPacker_FlushBlock(%p) failed with %d",
+            block_packer,
+            err)
+        return err;
+    }
+
+    size_t block_index_size = Longtail_GetBlockIndexSize(chunk_count);
+    struct Longtail_BlockIndex* put_block_index = (struct Longtail_BlockIndex*)Longtail_Alloc(block_index_size);
+    struct Longtail_StoredBlock* stored_block = (struct Longtail_StoredBlock*)Longtail_Alloc(sizeof(struct Longtail_StoredBlock));
+    if (!put_block_index || !stored_block)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockPacker_FlushBlock(%p) failed with %d",
+            block_packer,
+            ENOMEM)
+        Longtail_Free(stored_block);
+        Longtail_Free(put_block_index);
+        Longtail_Free(block_index);
+        return ENOMEM;
+    }
+    Longtail_InitBlockIndex(put_block_index, chunk_count);
+    memmove(put_block_index->m_ChunkHashes, block_index->m_ChunkHashes, sizeof(TLongtail_Hash) * chunk_count);
+    memmove(put_block_index->m_ChunkSizes, block_index->m_ChunkSizes, sizeof(uint32_t) * chunk_count);
+    *put_block_index->m_BlockHash = *block_index->m_BlockHash;
+    *put_block_index->m_HashIdentifier = *block_index->m_HashIdentifier;
+    *put_block_index->m_Tag = *block_index->m_Tag;
+    *put_block_index->m_ChunkCount = chunk_count;
+
+    stored_block->Dispose = DisposePutBlock;
+    stored_block->m_BlockIndex = put_block_index;
+    stored_block->m_BlockData = block_packer->m_BlockData;
+    stored_block->m_BlockChunksDataSize = block_packer->m_BlockDataSize;
+
+    struct PutBlockJob put_block_job;
+    put_block_job.m_AsyncCompleteAPI.m_API.Dispose = 0;
+    put_block_job.m_AsyncCompleteAPI.OnComplete = 0;
+    put_block_job.m_BlockStoreAPI = block_packer->m_BlockStoreAPI;
+    put_block_job.m_JobAPI = block_packer->m_JobAPI;
+    put_block_job.m_JobID = 0;
+    put_block_job.m_StoredBlock = stored_block;
+    put_block_job.m_Err = EINVAL;
+    arrput(block_packer->m_PutBlockJobs, put_block_job);
+    arrput(block_packer->m_BlockIndexes, block_index);
+
+    block_packer->m_BlockData = 0;
+    block_packer->m_BlockDataSize = 0;
+    block_packer->m_ChunkCount = 0;
+    return 0;
+}
+
+static int BlockPacker_AddChunks(
+    struct BlockPacker* block_packer,
+    struct Longtail_LookupTable* chunk_hash_lookup,
+    uint32_t chunk_count,
+    const TLongtail_Hash* chunk_hashes,
+    const uint32_t* chunk_sizes,
+    const uint32_t* chunk_tags,
+    const char* chunk_data)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockPacker_AddChunks(%p, %p, %u, %p, %p, %p, %p)",
+        block_packer, chunk_hash_lookup, chunk_count, chunk_hashes, chunk_sizes, chunk_tags, chunk_data)
+    LONGTAIL_FATAL_ASSERT(block_packer != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_hash_lookup != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_count == 0 || chunk_data != 0, return EINVAL)
+
+    const uint32_t max_block_data_size = block_packer->m_MaxBlockSize + (block_packer->m_MaxBlockSize / 10);
+    for (uint32_t c = 0; c < chunk_count; ++c)
+    {
+        uint32_t chunk_size = chunk_sizes[c];
+        const char* data = chunk_data;
+        chunk_data += chunk_size;
+        if (Longtail_LookupTable_PutUnique(chunk_hash_lookup, chunk_hashes[c], 0))
+        {
+            continue;
+        }
+        uint32_t tag = chunk_tags[c];
+        if (block_packer->m_ChunkCount > 0)
+        {
+            // Overshoot by 10% is ok
+            if ((tag != block_packer->m_Tag) ||
+                (block_packer->m_ChunkCount == block_packer->m_MaxChunksPerBlock) ||
+                ((block_packer->m_BlockDataSize + chunk_size) > max_block_data_size))
+            {
+                int err = BlockPacker_FlushBlock(block_packer);
+                if (err)
+                {
+                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockPacker_AddChunks(%p, %p, %u, %p, %p, %p, %p) failed with %d",
+                        block_packer, chunk_hash_lookup, chunk_count, chunk_hashes, chunk_sizes, chunk_tags, chunk_data,
+                        err)
+                    return err;
+                }
+            }
+        }
+        if (block_packer->m_ChunkCount == 0)
+        {
+            block_packer->m_BlockData = (char*)Longtail_Alloc(chunk_size > max_block_data_size ? chunk_size : max_block_data_size);
+            if (!block_packer->m_BlockData)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BlockPacker_AddChunks(%p, %p, %u, %p, %p, %p, %p) failed with %d",
+                    block_packer, chunk_hash_lookup, chunk_count, chunk_hashes, chunk_sizes, chunk_tags, chunk_data,
+                    ENOMEM)
+                return ENOMEM;
+            }
+            block_packer->m_Tag = tag;
+        }
+        memcpy(&block_packer->m_BlockData[block_packer->m_BlockDataSize], data, chunk_size);
+        block_packer->m_ChunkHashes[block_packer->m_ChunkCount] = chunk_hashes[c];
+        block_packer->m_ChunkSizes[block_packer->m_ChunkCount] = chunk_size;
+        block_packer->m_BlockDataSize += chunk_size;
+        ++block_packer->m_ChunkCount;
+    }
+    return 0;
+}
+
+// Upper limit of source data kept in memory while chunking assets for a block packer, the limit
+// is raised if needed so each worker can process at least one job
+#define MAX_CHUNK_WINDOW_DATA_SIZE  (256u * 1024u * 1024u)
+
+#define NO_PREVIOUS_ASSET_INDEX 0xffffffffu
+
+// Calculates the path hash of each asset and looks it up in the previous version index. Assets with the same size,
+// tag and change stamps as in the previous version get the index of the previous asset, all others NO_PREVIOUS_ASSET_INDEX
+static int FindReusableAssets(
+    struct Longtail_HashAPI* hash_api,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    const struct Longtail_VersionIndex* previous_version_index,
+    TLongtail_Hash* path_hashes,
+    uint32_t* previous_asset_indexes,
+    uint32_t* out_reused_asset_count)
+{
+    LONGTAIL_FATAL_ASSERT(hash_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(file_infos != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(previous_version_index != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(path_hashes != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(previous_asset_indexes != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_reused_asset_count != 0, return EINVAL)
+
+    uint32_t asset_count = file_infos->m_Count;
+    for (uint32_t a = 0; a < asset_count; ++a)
+    {
+        previous_asset_indexes[a] = NO_PREVIOUS_ASSET_INDEX;
+    }
+    *out_reused_asset_count = 0;
+
+    if (previous_version_index->m_ModificationTimes == 0)
+    {
+        // Written before change stamps were recorded, nothing can be trusted
+        return 0;
+    }
+
+    uint32_t previous_asset_count = *previous_version_index->m_AssetCount;
+    void* lookup_mem = Longtail_Alloc(Longtail_LookupTable_GetSize(previous_asset_count));
+    if (!lookup_mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FindReusableAssets(%p, %p, %p, %p, %p, %p, %p) failed with %d",
+            hash_api, file_infos, optional_asset_tags, previous_version_index, path_hashes, previous_asset_indexes, out_reused_asset_count,
+            ENOMEM)
+        return ENOMEM;
+    }
+    struct Longtail_LookupTable* previous_asset_lookup = Longtail_LookupTable_Create(lookup_mem, previous_asset_count, 0);
+    for (uint32_t a = 0; a < previous_asset_count; ++a)
+    {
+        Longtail_LookupTable_PutUnique(previous_asset_lookup, previous_version_index->m_PathHashes[a], a);
+    }
+
+    uint32_t reused_asset_count = 0;
+    for (uint32_t a = 0; a < asset_count; ++a)
+    {
+        const char* path = &file_infos->m_PathData[file_infos->m_PathStartOffsets[a]];
+        int err = Longtail_GetPathHash(hash_api, path, &path_hashes[a]);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FindReusableAssets(%p, %p, %p, %p, %p, %p, %p) failed with %d",
+                hash_api, file_infos, optional_asset_tags, previous_version_index, path_hashes, previous_asset_indexes, out_reused_asset_count,
+                err)
+            Longtail_Free(lookup_mem);
+            return err;
+        }
+        // A zero modification time means the storage does not provide one, the file must be chunked
+        if (file_infos->m_ModificationTimes[a] == 0)
+        {
+            continue;
+        }
+        const uint64_t* previous_index_ptr = Longtail_LookupTable_Get(previous_asset_lookup, path_hashes[a]);
+        if (previous_index_ptr == 0)
+        {
+            continue;
+        }
+        uint32_t p = (uint32_t)*previous_index_ptr;
+        if ((previous_version_index->m_AssetSizes[p] != file_infos->m_Sizes[a]) ||
+            (previous_version_index->m_ModificationTimes[p] != file_infos->m_ModificationTimes[a]) ||
+            (previous_version_index->m_ChangeTimes[p] != file_infos->m_ChangeTimes[a]) ||
+            (previous_version_index->m_FileIds[p] != file_infos->m_FileIds[a]))
+        {
+            continue;
+        }
+        uint32_t asset_tag = optional_asset_tags ? optional_asset_tags[a] : 0;
+        if (previous_version_index->m_AssetChunkCounts[p] > 0)
+        {
+            uint32_t first_chunk_index = previous_version_index->m_AssetChunkIndexes[previous_version_index->m_AssetChunkIndexStarts[p]];
+            if (previous_version_index->m_ChunkTags[first_chunk_index] != asset_tag)
+            {
+                continue;
+            }
+        }
+        previous_asset_indexes[a] = p;
+        ++reused_asset_count;
+    }
+    Longtail_Free(lookup_mem);
+    *out_reused_asset_count = reused_asset_count;
+    return 0;
+}
+
+static int ChunkAssets(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    TLongtail_Hash* path_hashes,
+    TLongtail_Hash* content_hashes,
+    const uint32_t* optional_asset_tags,
+    uint32_t* asset_chunk_start_index,
+    uint32_t* asset_chunk_counts,
+    uint32_t** chunk_sizes,
+    TLongtail_Hash** chunk_hashes,
+    uint32_t** chunk_tags,
+    uint32_t target_chunk_size,
+    struct BlockPacker* optional_block_packer,
+    const struct Longtail_VersionIndex* optional_previous_version_index,
+    const uint32_t* optional_previous_asset_indexes,
+    uint32_t* chunk_count)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p)",
+        storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count)
+    LONGTAIL_FATAL_ASSERT(storage_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(hash_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(job_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(root_path != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(file_infos != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(path_hashes != 0, return EINVAL)
+
+    LONGTAIL_FATAL_ASSERT(content_hashes != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(asset_chunk_start_index != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(asset_chunk_counts != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_sizes != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_hashes != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_tags != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(target_chunk_size != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(chunk_count != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT((optional_previous_version_index == 0) == (optional_previous_asset_indexes == 0), return EINVAL)
+    LONGTAIL_FATAL_ASSERT(optional_previous_asset_indexes == 0 || optional_block_packer == 0, return EINVAL)
+
+    uint32_t asset_count = file_infos->m_Count;
+
+    uint64_t max_hash_size = target_chunk_size * 1024;
+    uint32_t job_count = 0;
+
+    uint32_t min_chunk_size;
+    int err = chunker_api->GetMinChunkSize(chunker_api, &min_chunk_size);
+
+    uint64_t max_chunk_count = 0;
+    for (uint64_t asset_index = 0; asset_index < asset_count; ++asset_index)
+    {
+        if (optional_previous_asset_indexes && optional_previous_asset_indexes[asset_index] != NO_PREVIOUS_ASSET_INDEX)
+        {
+            continue;
+        }
+        uint64_t asset_size = file_infos->m_Sizes[asset_index];
+        uint64_t asset_part_count = 1 + (asset_size / max_hash_size);
+        job_count += (uint32_t)asset_part_count;
 
-    Longtail_JobAPI_JobFunc* funcs = (Longtail_JobAPI_JobFunc*)Longtail_Alloc(sizeof(Longtail_JobAPI_JobFunc) * job_count);
-    void** ctxs = (void**)Longtail_Alloc(sizeof(void*) * job_count);
+        for (uint64_t job_part = 0; job_part < asset_part_count; ++job_part)
+        {
+            uint64_t range_start = job_part * max_hash_size;
+            uint64_t job_size = (asset_size - range_start) > max_hash_size ? max_hash_size : (asset_size - range_start);
+
+            uint32_t max_count = (uint32_t)(job_size == 0 ? 0 : 1 + (job_size / min_chunk_size));
+            max_chunk_count += max_count;
+        }
+    }
+
+    if (job_count == 0 && optional_previous_asset_indexes == 0)
+    {
+        return 0;
+    }
+
+    size_t work_mem_size = (sizeof(uint32_t) * job_count) +
+        (sizeof(TLongtail_Hash) * max_chunk_count) +
+        (sizeof(uint32_t) * max_chunk_count) +
+        (sizeof(uint32_t) * max_chunk_count) +
+        (sizeof(struct HashJob) * job_count) +
+        (optional_block_packer ? Longtail_LookupTable_GetSize(max_chunk_count) : 0);
+    // All assets may be reused from the previous version in which case there is nothing to chunk
+    void* work_mem = (job_count > 0) ? Longtail_Alloc(work_mem_size) : 0;
+    if (job_count > 0 && !work_mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
+            storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count,
+            ENOMEM)
+        return ENOMEM;
+    }
+
+    uint32_t* tmp_job_chunk_counts = (uint32_t*)work_mem;
+    TLongtail_Hash* tmp_hashes = (TLongtail_Hash*)&tmp_job_chunk_counts[job_count];
+    uint32_t* tmp_sizes = (uint32_t*)&tmp_hashes[max_chunk_count];
+    uint32_t* tmp_tags = (uint32_t*)&tmp_sizes[max_chunk_count];
+    struct HashJob* tmp_hash_jobs = (struct HashJob*)&tmp_tags[max_chunk_count];
+    struct Longtail_LookupTable* chunk_hash_lookup = optional_block_packer ? Longtail_LookupTable_Create(&tmp_hash_jobs[job_count], max_chunk_count, 0) : 0;
 
     uint64_t jobs_started = 0;
     uint64_t chunks_offset = 0;
     for (uint32_t asset_index = 0; asset_index < asset_count; ++asset_index)
     {
+        if (optional_previous_asset_indexes && optional_previous_asset_indexes[asset_index] != NO_PREVIOUS_ASSET_INDEX)
+        {
+            continue;
+        }
         uint64_t asset_size = file_infos->m_Sizes[asset_index];
         uint64_t asset_part_count = 1 + (asset_size / max_hash_size);
 
@@ -1679,25 +2868,170 @@ static int ChunkAssets(
             job->m_ChunkSizes = &tmp_sizes[chunks_offset];
             job->m_ChunkTags = &tmp_tags[chunks_offset];
             job->m_TargetChunkSize = target_chunk_size;
+            job->m_ChunkData = 0;
             job->m_Err = EINVAL;
-            funcs[jobs_started] = DynamicChunking;
-            ctxs[jobs_started] = job;
             chunks_offset += asset_max_chunk_count;
             ++jobs_started;
         }
     }
     // TODO: Add logic here if we end up creating more jobs than can be held in a uint32_t
     LONGTAIL_FATAL_ASSERT(jobs_started < 0xffffffff, return ENOMEM);
-    Longtail_JobAPI_Jobs jobs;
-    err = job_api->CreateJobs(job_api, job_group, (uint32_t)jobs_started, funcs, ctxs, &jobs);
-    LONGTAIL_FATAL_ASSERT(!err, return err)
-    err = job_api->ReadyJobs(job_api, (uint32_t)jobs_started, jobs);
-    LONGTAIL_FATAL_ASSERT(!err, return err)
 
-    Longtail_Free(ctxs);
-    Longtail_Free(funcs);
+    // Without a block packer all jobs are run in one go. With a block packer the jobs are run in windows
+    // limited by the amount of source data they read, the chunks of each window are then handed to the
+    // block packer in asset order and the finished blocks are written while the next window is chunked
+    uint64_t max_window_data_size = 0;
+    if (optional_block_packer)
+    {
+        max_window_data_size = (uint64_t)(job_api->GetWorkerCount(job_api) + 1) * max_hash_size;
+        if (max_window_data_size < MAX_CHUNK_WINDOW_DATA_SIZE)
+        {
+            max_window_data_size = MAX_CHUNK_WINDOW_DATA_SIZE;
+        }
+    }
 
-    err = job_api->WaitForAllJobs(job_api, job_group, progress_api, optional_cancel_api, optional_cancel_token);
+    uint32_t window_start = 0;
+    while (err == 0)
+    {
+        if (optional_cancel_api && optional_cancel_token && optional_cancel_api->IsCancelled(optional_cancel_api, optional_cancel_token) == ECANCELED)
+        {
+            err = ECANCELED;
+            break;
+        }
+        uint32_t window_end = (uint32_t)jobs_started;
+        char* window_data = 0;
+        if (optional_block_packer)
+        {
+            uint64_t window_data_size = 0;
+            window_end = window_start;
+            while (window_end < jobs_started && (window_end == window_start || (window_data_size + tmp_hash_jobs[window_end].m_SizeRange) <= max_window_data_size))
+            {
+                window_data_size += tmp_hash_jobs[window_end].m_SizeRange;
+                ++window_end;
+            }
+            if (window_end == window_start)
+            {
+                // All assets are chunked, write the last partially filled block
+                err = BlockPacker_FlushBlock(optional_block_packer);
+                if (err)
+                {
+                    break;
+                }
+            }
+            if (window_data_size > 0)
+            {
+                window_data = (char*)Longtail_Alloc((size_t)window_data_size);
+                if (!window_data)
+                {
+                    err = ENOMEM;
+                    break;
+                }
+            }
+            char* chunk_data = window_data;
+            for (uint32_t j = window_start; j < window_end; ++j)
+            {
+                tmp_hash_jobs[j].m_ChunkData = chunk_data;
+                chunk_data += tmp_hash_jobs[j].m_SizeRange;
+            }
+        }
+        uint32_t window_job_count = window_end - window_start;
+        uint32_t put_block_job_count = optional_block_packer ? (uint32_t)arrlen(optional_block_packer->m_PutBlockJobs) : 0;
+        uint32_t window_total_job_count = window_job_count + put_block_job_count;
+        if (window_total_job_count == 0)
+        {
+            Longtail_Free(window_data);
+            break;
+        }
+
+        Longtail_JobAPI_Group job_group = 0;
+        err = job_api->ReserveJobs(job_api, window_total_job_count, &job_group);
+        if (err)
+        {
+            Longtail_Free(window_data);
+            break;
+        }
+
+        Longtail_JobAPI_JobFunc* funcs = (Longtail_JobAPI_JobFunc*)Longtail_Alloc(sizeof(Longtail_JobAPI_JobFunc) * window_total_job_count);
+        void** ctxs = (void**)Longtail_Alloc(sizeof(void*) * window_total_job_count);
+        for (uint32_t j = 0; j < window_job_count; ++j)
+        {
+            funcs[j] = DynamicChunking;
+            ctxs[j] = &tmp_hash_jobs[window_start + j];
+        }
+        for (uint32_t j = 0; j < put_block_job_count; ++j)
+        {
+            funcs[window_job_count + j] = PutBlock;
+            ctxs[window_job_count + j] = &optional_block_packer->m_PutBlockJobs[j];
+        }
+
+        if (window_job_count > 0)
+        {
+            Longtail_JobAPI_Jobs chunk_jobs;
+            err = job_api->CreateJobs(job_api, job_group, window_job_count, funcs, ctxs, LONGTAIL_JOB_CLASS_CPU, &chunk_jobs);
+            LONGTAIL_FATAL_ASSERT(!err, return err)
+            err = job_api->ReadyJobs(job_api, window_job_count, chunk_jobs);
+            LONGTAIL_FATAL_ASSERT(!err, return err)
+        }
+        if (put_block_job_count > 0)
+        {
+            Longtail_JobAPI_Jobs put_block_jobs;
+            // The block store compresses the block in PutStoredBlock so this is CPU work
+            err = job_api->CreateJobs(job_api, job_group, put_block_job_count, &funcs[window_job_count], &ctxs[window_job_count], LONGTAIL_JOB_CLASS_CPU, &put_block_jobs);
+            LONGTAIL_FATAL_ASSERT(!err, return err)
+            err = job_api->ReadyJobs(job_api, put_block_job_count, put_block_jobs);
+            LONGTAIL_FATAL_ASSERT(!err, return err)
+        }
+
+        Longtail_Free(ctxs);
+        Longtail_Free(funcs);
+
+        err = job_api->WaitForAllJobs(job_api, job_group, progress_api, optional_cancel_api, optional_cancel_token);
+        if (err)
+        {
+            Longtail_Free(window_data);
+            break;
+        }
+
+        for (uint32_t j = window_start; j < window_end; ++j)
+        {
+            if (tmp_hash_jobs[j].m_Err)
+            {
+                LONGTAIL_LOG((tmp_hash_jobs[j].m_Err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
+                    storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count,
+                    tmp_hash_jobs[j].m_Err)
+                err = err ? err : tmp_hash_jobs[j].m_Err;
+            }
+        }
+        for (uint32_t j = 0; j < put_block_job_count; ++j)
+        {
+            err = err ? err : optional_block_packer->m_PutBlockJobs[j].m_Err;
+        }
+        if (optional_block_packer)
+        {
+            arrsetlen(optional_block_packer->m_PutBlockJobs, 0);
+        }
+
+        for (uint32_t j = window_start; optional_block_packer && (err == 0) && (j < window_end); ++j)
+        {
+            struct HashJob* job = &tmp_hash_jobs[j];
+            err = BlockPacker_AddChunks(
+                optional_block_packer,
+                chunk_hash_lookup,
+                *job->m_AssetChunkCount,
+                job->m_ChunkHashes,
+                job->m_ChunkSizes,
+                job->m_ChunkTags,
+                job->m_ChunkData);
+            job->m_ChunkData = 0;
+        }
+        Longtail_Free(window_data);
+
+        window_start = window_end;
+        if (!optional_block_packer)
+        {
+            break;
+        }
+    }
     if (err)
     {
         LONGTAIL_LOG(err == ECANCELED ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
@@ -1707,18 +3041,6 @@ static int ChunkAssets(
         return err;
     }
 
-    err = 0;
-    for (uint32_t i = 0; i < jobs_started; ++i)
-    {
-        if (tmp_hash_jobs[i].m_Err)
-        {
-            LONGTAIL_LOG((tmp_hash_jobs[i].m_Err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "ChunkAssets(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %p, %p, %p, %p, %p, %p, %p, %u, %p) failed with %d",
-                storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, path_hashes, content_hashes, optional_asset_tags, asset_chunk_start_index, asset_chunk_counts, chunk_sizes, chunk_hashes, chunk_tags, target_chunk_size, chunk_count,
-                tmp_hash_jobs[i].m_Err)
-            err = err ? err : tmp_hash_jobs[i].m_Err;
-        }
-    }
-
     if (!err)
     {
         uint32_t built_chunk_count = 0;
@@ -1727,6 +3049,14 @@ static int ChunkAssets(
             LONGTAIL_FATAL_ASSERT(*tmp_hash_jobs[i].m_AssetChunkCount <= tmp_hash_jobs[i].m_MaxChunkCount, return EINVAL)
             built_chunk_count += *tmp_hash_jobs[i].m_AssetChunkCount;
         }
+        for (uint32_t a = 0; optional_previous_asset_indexes && a < asset_count; ++a)
+        {
+            uint32_t previous_asset_index = optional_previous_asset_indexes[a];
+            if (previous_asset_index != NO_PREVIOUS_ASSET_INDEX)
+            {
+                built_chunk_count += optional_previous_version_index->m_AssetChunkCounts[previous_asset_index];
+            }
+        }
         *chunk_count = built_chunk_count;
         size_t chunk_sizes_size = sizeof(uint32_t) * *chunk_count;
         *chunk_sizes = (uint32_t*)Longtail_Alloc(chunk_sizes_size);
@@ -1766,22 +3096,40 @@ static int ChunkAssets(
         }
 
         uint32_t chunk_offset = 0;
-        for (uint32_t i = 0; i < jobs_started; ++i)
+        uint32_t job_index = 0;
+        for (uint32_t asset_index = 0; asset_index < asset_count; ++asset_index)
         {
-            uint64_t asset_index = tmp_hash_jobs[i].m_AssetIndex;
-            if (tmp_hash_jobs[i].m_StartRange == 0)
+            asset_chunk_start_index[asset_index] = chunk_offset;
+            asset_chunk_counts[asset_index] = 0;
+            uint32_t previous_asset_index = optional_previous_asset_indexes ? optional_previous_asset_indexes[asset_index] : NO_PREVIOUS_ASSET_INDEX;
+            if (previous_asset_index != NO_PREVIOUS_ASSET_INDEX)
             {
-                asset_chunk_start_index[asset_index] = chunk_offset;
-                asset_chunk_counts[asset_index] = 0;
+                const struct Longtail_VersionIndex* previous = optional_previous_version_index;
+                uint32_t previous_chunk_count = previous->m_AssetChunkCounts[previous_asset_index];
+                const uint32_t* previous_chunk_indexes = &previous->m_AssetChunkIndexes[previous->m_AssetChunkIndexStarts[previous_asset_index]];
+                asset_chunk_counts[asset_index] = previous_chunk_count;
+                for (uint32_t c = 0; c < previous_chunk_count; ++c)
+                {
+                    uint32_t chunk_index = previous_chunk_indexes[c];
+                    (*chunk_sizes)[chunk_offset] = previous->m_ChunkSizes[chunk_index];
+                    (*chunk_hashes)[chunk_offset] = previous->m_ChunkHashes[chunk_index];
+                    (*chunk_tags)[chunk_offset] = previous->m_ChunkTags[chunk_index];
+                    ++chunk_offset;
+                }
+                continue;
             }
-            uint32_t job_chunk_count = *tmp_hash_jobs[i].m_AssetChunkCount;
-            asset_chunk_counts[asset_index] += job_chunk_count;
-            for (uint32_t chunk_index = 0; chunk_index < job_chunk_count; ++chunk_index)
+            while (job_index < jobs_started && tmp_hash_jobs[job_index].m_AssetIndex == asset_index)
             {
-                (*chunk_sizes)[chunk_offset] = tmp_hash_jobs[i].m_ChunkSizes[chunk_index];
-                (*chunk_hashes)[chunk_offset] = tmp_hash_jobs[i].m_ChunkHashes[chunk_index];
-                (*chunk_tags)[chunk_offset] = tmp_hash_jobs[i].m_ChunkTags[chunk_index];
-                ++chunk_offset;
+                uint32_t job_chunk_count = *tmp_hash_jobs[job_index].m_AssetChunkCount;
+                asset_chunk_counts[asset_index] += job_chunk_count;
+                for (uint32_t chunk_index = 0; chunk_index < job_chunk_count; ++chunk_index)
+                {
+                    (*chunk_sizes)[chunk_offset] = tmp_hash_jobs[job_index].m_ChunkSizes[chunk_index];
+                    (*chunk_hashes)[chunk_offset] = tmp_hash_jobs[job_index].m_ChunkHashes[chunk_index];
+                    (*chunk_tags)[chunk_offset] = tmp_hash_jobs[job_index].m_ChunkTags[chunk_index];
+                    ++chunk_offset;
+                }
+                ++job_index;
             }
         }
         for (uint32_t a = 0; a < asset_count; ++a)
@@ -1830,12 +3178,16 @@ static size_t Longtail_GetVersionIndexDataSize(
         (sizeof(TLongtail_Hash) * asset_count) +        // m_PathHashes
         (sizeof(TLongtail_Hash) * asset_count) +        // m_ContentHashes
         (sizeof(uint64_t) * asset_count) +              // m_AssetSizes
+        (sizeof(uint64_t) * asset_count) +              // m_ModificationTimes
+        (sizeof(uint64_t) * asset_count) +              // m_ChangeTimes
+        (sizeof(uint64_t) * asset_count) +              // m_FileIds
         (sizeof(uint32_t) * asset_count) +              // m_AssetChunkCounts
         (sizeof(uint32_t) * asset_count) +              // m_AssetChunkIndexStarts
         (sizeof(uint32_t) * asset_chunk_index_count) +  // m_AssetChunkIndexes
         (sizeof(TLongtail_Hash) * chunk_count) +        // m_ChunkHashes
         (sizeof(uint32_t) * chunk_count) +              // m_ChunkSizes
         (sizeof(uint32_t) * chunk_count) +              // m_ChunkTags
+        sizeof(uint32_t) +                              // m_ChunkerIdentifier
         (sizeof(uint32_t) * asset_count) +              // m_NameOffsets
         (sizeof(uint16_t) * asset_count) +              // m_Permissions
         path_data_size;
@@ -1856,6 +3208,21 @@ size_t Longtail_GetVersionIndexSize(
             Longtail_GetVersionIndexDataSize(asset_count, chunk_count, asset_chunk_index_count, path_data_size);
 }
 
+// Size of the serialized version index, without the fields that are missing if it was read from an older index
+static size_t GetVersionIndexDataSize(const struct Longtail_VersionIndex* version_index)
+{
+    size_t size = Longtail_GetVersionIndexDataSize(*version_index->m_AssetCount, *version_index->m_ChunkCount, *version_index->m_AssetChunkIndexCount, version_index->m_NameDataSize);
+    if (version_index->m_ModificationTimes == 0)
+    {
+        size -= sizeof(uint64_t) * 3 * (*version_index->m_AssetCount);
+    }
+    if (version_index->m_ChunkerIdentifier == 0)
+    {
+        size -= sizeof(uint32_t);
+    }
+    return size;
+}
+
 static int InitVersionIndexFromData(
     struct Longtail_VersionIndex* version_index,
     void* data,
@@ -1872,7 +3239,9 @@ static int InitVersionIndexFromData(
     version_index->m_Version = (uint32_t*)(void*)p;
     p += sizeof(uint32_t);
 
-    if ((*version_index->m_Version) != LONGTAIL_VERSION_INDEX_VERSION_0_0_2)
+    if (((*version_index->m_Version) != LONGTAIL_VERSION_INDEX_VERSION_0_0_2) &&
+        ((*version_index->m_Version) != LONGTAIL_VERSION_INDEX_VERSION_0_0_3) &&
+        ((*version_index->m_Version) != LONGTAIL_VERSION_INDEX_VERSION_0_0_4))
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Missmatching versions in version index data %" PRIu64 " != %" PRIu64 "", (void*)version_index->m_Version, Longtail_CurrentContentIndexVersion);
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "InitVersionIndexFromData(%p, %p, %" PRIu64 ") failed with %d",
@@ -1902,7 +3271,18 @@ static int InitVersionIndexFromData(
 
     uint32_t asset_chunk_index_count = *version_index->m_AssetChunkIndexCount;
 
+    int has_change_stamps = (*version_index->m_Version) >= LONGTAIL_VERSION_INDEX_VERSION_0_0_3;
+    int has_chunker_identifier = (*version_index->m_Version) >= LONGTAIL_VERSION_INDEX_VERSION_0_0_4;
+
     size_t versiom_index_data_size = Longtail_GetVersionIndexDataSize(asset_count, chunk_count, asset_chunk_index_count, 0);
+    if (!has_change_stamps)
+    {
+        versiom_index_data_size -= sizeof(uint64_t) * 3 * asset_count;
+    }
+    if (!has_chunker_identifier)
+    {
+        versiom_index_data_size -= sizeof(uint32_t);
+    }
     if (versiom_index_data_size > data_size)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Version index data is truncated: %" PRIu64 " <= %" PRIu64, data_size, versiom_index_data_size)
@@ -1921,6 +3301,21 @@ static int InitVersionIndexFromData(
     version_index->m_AssetSizes = (uint64_t*)(void*)p;
     p += (sizeof(uint64_t) * asset_count);
 
+    version_index->m_ModificationTimes = 0;
+    version_index->m_ChangeTimes = 0;
+    version_index->m_FileIds = 0;
+    if (has_change_stamps)
+    {
+        version_index->m_ModificationTimes = (uint64_t*)(void*)p;
+        p += (sizeof(uint64_t) * asset_count);
+
+        version_index->m_ChangeTimes = (uint64_t*)(void*)p;
+        p += (sizeof(uint64_t) * asset_count);
+
+        version_index->m_FileIds = (uint64_t*)(void*)p;
+        p += (sizeof(uint64_t) * asset_count);
+    }
+
     version_index->m_AssetChunkCounts = (uint32_t*)(void*)p;
     p += (sizeof(uint32_t) * asset_count);
 
@@ -1939,6 +3334,13 @@ static int InitVersionIndexFromData(
     version_index->m_ChunkTags = (uint32_t*)(void*)p;
     p += (sizeof(uint32_t) * chunk_count);
 
+    version_index->m_ChunkerIdentifier = 0;
+    if (has_chunker_identifier)
+    {
+        version_index->m_ChunkerIdentifier = (uint32_t*)(void*)p;
+        p += sizeof(uint32_t);
+    }
+
     version_index->m_NameOffsets = (uint32_t*)(void*)p;
     p += (sizeof(uint32_t) * asset_count);
 
@@ -1969,11 +3371,12 @@ int Longtail_BuildVersionIndex(
     const TLongtail_Hash* chunk_hashes,
     const uint32_t* optional_chunk_tags,
     uint32_t hash_api_identifier,
+    uint32_t chunker_api_identifier,
     uint32_t target_chunk_size,
     struct Longtail_VersionIndex** out_version_index)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_BuildVersionIndex(%p, %" PRIu64 ", %p, %p, %p, %p, %p, %u, %p, %u,%p ,%p, %p, %u, %p)",
-        mem, mem_size, file_infos, path_hashes, content_hashes, asset_chunk_index_starts, asset_chunk_counts, asset_chunk_index_count, asset_chunk_indexes, chunk_count, chunk_sizes, chunk_hashes, optional_chunk_tags, hash_api_identifier, out_version_index);
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_BuildVersionIndex(%p, %" PRIu64 ", %p, %p, %p, %p, %p, %u, %p, %u,%p ,%p, %p, %u, %u, %p)",
+        mem, mem_size, file_infos, path_hashes, content_hashes, asset_chunk_index_starts, asset_chunk_counts, asset_chunk_index_count, asset_chunk_indexes, chunk_count, chunk_sizes, chunk_hashes, optional_chunk_tags, hash_api_identifier, chunker_api_identifier, out_version_index);
     LONGTAIL_VALIDATE_INPUT(mem != 0, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(mem_size != 0, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(file_infos != 0, return EINVAL)
@@ -1996,7 +3399,17 @@ int Longtail_BuildVersionIndex(
     version_index->m_AssetCount = &p[3];
     version_index->m_ChunkCount = &p[4];
     version_index->m_AssetChunkIndexCount = &p[5];
-    *version_index->m_Version = Longtail_CurrentContentIndexVersion;
+
+    // Write the oldest version that can hold the data so readers that predate the
+    // change stamps or the chunker identifier can still read indexes that do not use them
+    int has_change_stamps = 0;
+    for (uint32_t a = 0; a < asset_count && !has_change_stamps; ++a)
+    {
+        has_change_stamps = (file_infos->m_ModificationTimes[a] != 0) || (file_infos->m_ChangeTimes[a] != 0) || (file_infos->m_FileIds[a] != 0);
+    }
+    *version_index->m_Version = (chunker_api_identifier != 0) ? LONGTAIL_VERSION_INDEX_VERSION_0_0_4 :
+        has_change_stamps ? LONGTAIL_VERSION_INDEX_VERSION_0_0_3 :
+        LONGTAIL_VERSION_INDEX_VERSION_0_0_2;
     *version_index->m_HashIdentifier = hash_api_identifier;
     *version_index->m_TargetChunkSize = target_chunk_size;
     *version_index->m_AssetCount = asset_count;
@@ -2007,15 +3420,23 @@ int Longtail_BuildVersionIndex(
     int err = InitVersionIndexFromData(version_index, &version_index[1], index_data_size);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_BuildVersionIndex(%p, %" PRIu64 ", %p, %p, %p, %p, %p, %u, %p, %u,%p ,%p, %p, %u, %p) failed with %d",
-            mem, mem_size, file_infos, path_hashes, content_hashes, asset_chunk_index_starts, asset_chunk_counts, asset_chunk_index_count, asset_chunk_indexes, chunk_count, chunk_sizes, chunk_hashes, optional_chunk_tags, hash_api_identifier, out_version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_BuildVersionIndex(%p, %" PRIu64 ", %p, %p, %p, %p, %p, %u, %p, %u,%p ,%p, %p, %u, %u, %p) failed with %d",
+            mem, mem_size, file_infos, path_hashes, content_hashes, asset_chunk_index_starts, asset_chunk_counts, asset_chunk_index_count, asset_chunk_indexes, chunk_count, chunk_sizes, chunk_hashes, optional_chunk_tags, hash_api_identifier, chunker_api_identifier, out_version_index,
             err);
         return err;
     }
+    // The fields left out of older versions are not part of the name data
+    version_index->m_NameDataSize = file_infos->m_PathDataSize;
 
     memmove(version_index->m_PathHashes, path_hashes, sizeof(TLongtail_Hash) * asset_count);
     memmove(version_index->m_ContentHashes, content_hashes, sizeof(TLongtail_Hash) * asset_count);
     memmove(version_index->m_AssetSizes, file_infos->m_Sizes, sizeof(uint64_t) * asset_count);
+    if (version_index->m_ModificationTimes)
+    {
+        memmove(version_index->m_ModificationTimes, file_infos->m_ModificationTimes, sizeof(uint64_t) * asset_count);
+        memmove(version_index->m_ChangeTimes, file_infos->m_ChangeTimes, sizeof(uint64_t) * asset_count);
+        memmove(version_index->m_FileIds, file_infos->m_FileIds, sizeof(uint64_t) * asset_count);
+    }
     memmove(version_index->m_AssetChunkCounts, asset_chunk_counts, sizeof(uint32_t) * asset_count);
     memmove(version_index->m_AssetChunkIndexStarts, asset_chunk_index_starts, sizeof(uint32_t) * asset_count);
     memmove(version_index->m_AssetChunkIndexes, asset_chunk_indexes, sizeof(uint32_t) * asset_chunk_index_count);
@@ -2029,6 +3450,10 @@ int Longtail_BuildVersionIndex(
     {
         memset(version_index->m_ChunkTags, 0, sizeof(uint32_t) * chunk_count);
     }
+    if (version_index->m_ChunkerIdentifier)
+    {
+        *version_index->m_ChunkerIdentifier = chunker_api_identifier;
+    }
     memmove(version_index->m_NameOffsets, file_infos->m_PathStartOffsets, sizeof(uint32_t) * asset_count);
     memmove(version_index->m_Permissions, file_infos->m_Permissions, sizeof(uint16_t) * asset_count);
     memmove(version_index->m_NameData, file_infos->m_PathData, file_infos->m_PathDataSize);
@@ -2037,7 +3462,7 @@ int Longtail_BuildVersionIndex(
     return 0;
 }
 
-int Longtail_CreateVersionIndex(
+static int CreateVersionIndex(
     struct Longtail_StorageAPI* storage_api,
     struct Longtail_HashAPI* hash_api,
     struct Longtail_ChunkerAPI* chunker_api,
@@ -2049,16 +3474,12 @@ int Longtail_CreateVersionIndex(
     const struct Longtail_FileInfos* file_infos,
     const uint32_t* optional_asset_tags,
     uint32_t target_chunk_size,
+    const struct Longtail_VersionIndex* optional_previous_version_index,
+    struct BlockPacker* optional_block_packer,
     struct Longtail_VersionIndex** out_version_index)
-{
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p)",
-        storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index)
-    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT(hash_api != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT(job_api != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || root_path != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || target_chunk_size > 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || out_version_index != 0, return EINVAL)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p)",
+        storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index)
 
     uint32_t path_count = file_infos->m_Count;
 
@@ -2068,8 +3489,8 @@ int Longtail_CreateVersionIndex(
         void* version_index_mem = Longtail_Alloc(version_index_size);
         if (!version_index_mem)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-                storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+                storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
                 ENOMEM)
             return ENOMEM;
         }
@@ -2090,12 +3511,13 @@ int Longtail_CreateVersionIndex(
             0,           // chunk_hashes
             0,          // chunk_tags
             hash_api->GetIdentifier(hash_api),
+            chunker_api ? chunker_api->GetIdentifier(chunker_api) : 0,
             target_chunk_size,
             &version_index);
         if (err)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-                storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+                storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
                 err)
             return err;
         }
@@ -2106,12 +3528,13 @@ int Longtail_CreateVersionIndex(
     size_t work_mem_size = (sizeof(TLongtail_Hash) * path_count) +
         (sizeof(TLongtail_Hash) * path_count) +
         (sizeof(uint32_t) * path_count) +
-        (sizeof(uint32_t) * path_count);
+        (sizeof(uint32_t) * path_count) +
+        (optional_previous_version_index ? (sizeof(uint32_t) * path_count) : 0);
     void* work_mem = Longtail_Alloc(work_mem_size);
     if (!work_mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
             ENOMEM)
         return ENOMEM;
     }
@@ -2120,6 +3543,30 @@ int Longtail_CreateVersionIndex(
     TLongtail_Hash* tmp_content_hashes = (TLongtail_Hash*)&tmp_path_hashes[path_count];
     uint32_t* tmp_asset_chunk_counts = (uint32_t*)&tmp_content_hashes[path_count];
     uint32_t* tmp_asset_chunk_start_index = (uint32_t*)&tmp_asset_chunk_counts[path_count];
+    uint32_t* tmp_previous_asset_indexes = optional_previous_version_index ? (uint32_t*)&tmp_asset_chunk_start_index[path_count] : 0;
+
+    if (optional_previous_version_index)
+    {
+        uint32_t reused_asset_count = 0;
+        int err = FindReusableAssets(
+            hash_api,
+            file_infos,
+            optional_asset_tags,
+            optional_previous_version_index,
+            tmp_path_hashes,
+            tmp_previous_asset_indexes,
+            &reused_asset_count);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+                storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
+                err)
+            Longtail_Free(work_mem);
+            return err;
+        }
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "CreateVersionIndex: reusing chunks of %u out of %u assets from previous version",
+            reused_asset_count, path_count)
+    }
 
     uint32_t assets_chunk_index_count = 0;
     uint32_t* asset_chunk_sizes = 0;
@@ -2145,11 +3592,14 @@ int Longtail_CreateVersionIndex(
         &asset_chunk_hashes,
         &asset_chunk_tags,
         target_chunk_size,
+        optional_block_packer,
+        optional_previous_version_index,
+        tmp_previous_asset_indexes,
         &assets_chunk_index_count);
     if (err)
     {
-        LONGTAIL_LOG((err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+        LONGTAIL_LOG((err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
             err)
         Longtail_Free(work_mem);
         return err;
@@ -2163,8 +3613,8 @@ int Longtail_CreateVersionIndex(
     void* work_mem_compact = Longtail_Alloc(work_mem_compact_size);
     if (!work_mem_compact)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
             ENOMEM)
         Longtail_Free(asset_chunk_tags);
         Longtail_Free(asset_chunk_hashes);
@@ -2203,8 +3653,8 @@ int Longtail_CreateVersionIndex(
     void* version_index_mem = Longtail_Alloc(version_index_size);
     if (!version_index_mem)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
             ENOMEM)
         Longtail_Free(work_mem_compact);
         Longtail_Free(asset_chunk_tags);
@@ -2230,32 +3680,393 @@ int Longtail_CreateVersionIndex(
         tmp_compact_chunk_hashes,           // chunk_hashes
         tmp_compact_chunk_tags,// chunk_tags
         hash_api->GetIdentifier(hash_api),
+        chunker_api->GetIdentifier(chunker_api),
+        target_chunk_size,
+        &version_index);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p, %p, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, optional_block_packer, out_version_index,
+            err)
+        Longtail_Free(work_mem_compact);
+        Longtail_Free(version_index_mem);
+        Longtail_Free(asset_chunk_tags);
+        Longtail_Free(asset_chunk_hashes);
+        Longtail_Free(asset_chunk_sizes);
+        Longtail_Free(work_mem);
+        return err;
+    }
+
+    Longtail_Free(work_mem_compact);
+    Longtail_Free(asset_chunk_tags);
+    Longtail_Free(asset_chunk_hashes);
+    Longtail_Free(asset_chunk_sizes);
+    Longtail_Free(work_mem);
+
+    *out_version_index = version_index;
+    return 0;
+}
+
+int Longtail_CreateVersionIndex(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    uint32_t target_chunk_size,
+    struct Longtail_VersionIndex** out_version_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p)",
+        storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(hash_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || root_path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || target_chunk_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || chunker_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT((file_infos == 0 || file_infos->m_Count == 0) || out_version_index != 0, return EINVAL)
+
+    int err = CreateVersionIndex(
+        storage_api,
+        hash_api,
+        chunker_api,
+        job_api,
+        progress_api,
+        optional_cancel_api,
+        optional_cancel_token,
+        root_path,
+        file_infos,
+        optional_asset_tags,
+        target_chunk_size,
+        0,
+        0,
+        out_version_index);
+    if (err)
+    {
+        LONGTAIL_LOG((err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
+            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+            err)
+        return err;
+    }
+    return 0;
+}
+
+int Longtail_CreateVersionIndexIncremental(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    uint32_t target_chunk_size,
+    const struct Longtail_VersionIndex* optional_previous_version_index,
+    struct Longtail_VersionIndex** out_version_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateVersionIndexIncremental(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %p, %p)",
+        storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, out_version_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(hash_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || root_path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || target_chunk_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || chunker_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_version_index != 0, return EINVAL)
+
+    const struct Longtail_VersionIndex* previous_version_index = optional_previous_version_index;
+    if (previous_version_index &&
+        ((*previous_version_index->m_HashIdentifier != hash_api->GetIdentifier(hash_api)) ||
+        (Longtail_VersionIndex_GetChunkerAPI(previous_version_index) != (chunker_api ? chunker_api->GetIdentifier(chunker_api) : 0)) ||
+        (*previous_version_index->m_TargetChunkSize != target_chunk_size)))
+    {
+        // Chunks from a different hash, chunker or chunk size would not match a full indexing of the same content
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateVersionIndexIncremental: previous version index uses hash api %u, chunker api %u and target chunk size %u, indexing all assets",
+            *previous_version_index->m_HashIdentifier, Longtail_VersionIndex_GetChunkerAPI(previous_version_index), *previous_version_index->m_TargetChunkSize)
+        previous_version_index = 0;
+    }
+
+    int err = CreateVersionIndex(
+        storage_api,
+        hash_api,
+        chunker_api,
+        job_api,
+        progress_api,
+        optional_cancel_api,
+        optional_cancel_token,
+        root_path,
+        file_infos,
+        optional_asset_tags,
+        target_chunk_size,
+        previous_version_index,
+        0,
+        out_version_index);
+    if (err)
+    {
+        LONGTAIL_LOG((err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndexIncremental(%p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %p, %p) failed with %d",
+            storage_api, hash_api, chunker_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, optional_previous_version_index, out_version_index,
+            err)
+        return err;
+    }
+    return 0;
+}
+
+int Longtail_CreateVersionIndexAndWriteContent(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_BlockStoreAPI* block_store_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    uint32_t target_chunk_size,
+    uint32_t max_block_size,
+    uint32_t max_chunks_per_block,
+    struct Longtail_VersionIndex** out_version_index,
+    struct Longtail_ContentIndex** out_content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateVersionIndexAndWriteContent(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %u, %u, %p, %p)",
+        storage_api, hash_api, chunker_api, block_store_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, max_block_size, max_chunks_per_block, out_version_index, out_content_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(hash_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(block_store_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(job_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || root_path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || target_chunk_size > 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(file_infos->m_Count == 0 || chunker_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(max_block_size != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(max_chunks_per_block != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_version_index != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+
+    struct BlockPacker block_packer;
+    int err = BlockPacker_Init(&block_packer, hash_api, block_store_api, job_api, max_block_size, max_chunks_per_block);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndexAndWriteContent(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %u, %u, %p, %p) failed with %d",
+            storage_api, hash_api, chunker_api, block_store_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, max_block_size, max_chunks_per_block, out_version_index, out_content_index,
+            err)
+        return err;
+    }
+
+    struct Longtail_VersionIndex* version_index;
+    err = CreateVersionIndex(
+        storage_api,
+        hash_api,
+        chunker_api,
+        job_api,
+        progress_api,
+        optional_cancel_api,
+        optional_cancel_token,
+        root_path,
+        file_infos,
+        optional_asset_tags,
         target_chunk_size,
+        0,
+        &block_packer,
         &version_index);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndex(%p, %p, %p, %p, %s, %p, %s, %p, %p, %u, %p) failed with %d",
-            storage_api, hash_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, out_version_index,
+        LONGTAIL_LOG((err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndexAndWriteContent(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %u, %u, %p, %p) failed with %d",
+            storage_api, hash_api, chunker_api, block_store_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, max_block_size, max_chunks_per_block, out_version_index, out_content_index,
+            err)
+        BlockPacker_Dispose(&block_packer);
+        return err;
+    }
+
+    struct Longtail_ContentIndex* content_index;
+    uint64_t block_count = arrlen(block_packer.m_BlockIndexes);
+    if (block_count == 0)
+    {
+        err = Longtail_CreateContentIndexRaw(hash_api, 0, 0, 0, 0, max_block_size, max_chunks_per_block, &content_index);
+    }
+    else
+    {
+        err = Longtail_CreateContentIndexFromBlocks(max_block_size, max_chunks_per_block, block_count, block_packer.m_BlockIndexes, &content_index);
+    }
+    BlockPacker_Dispose(&block_packer);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateVersionIndexAndWriteContent(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %u, %u, %u, %p, %p) failed with %d",
+            storage_api, hash_api, chunker_api, block_store_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, root_path, file_infos, optional_asset_tags, target_chunk_size, max_block_size, max_chunks_per_block, out_version_index, out_content_index,
+            err)
+        Longtail_Free(version_index);
+        return err;
+    }
+
+    *out_version_index = version_index;
+    *out_content_index = content_index;
+    return 0;
+}
+
+// Trails the index header of mapped indexes, the data is either a view of the file or a copy following this struct
+struct IndexFileMapping
+{
+    struct Longtail_StorageAPI* m_StorageAPI;
+    Longtail_StorageAPI_HOpenFile m_FileHandle;
+    Longtail_StorageAPI_HFileMap m_FileMap;
+};
+
+static int MapIndexFile(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    size_t header_size,
+    void** out_header,
+    void** out_data,
+    uint64_t* out_data_size)
+{
+    LONGTAIL_FATAL_ASSERT(storage_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(path != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_header != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_data != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_data_size != 0, return EINVAL)
+
+    Longtail_StorageAPI_HOpenFile file_handle;
+    int err = storage_api->OpenReadFile(storage_api, path, &file_handle);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_WARNING : LONGTAIL_LOG_LEVEL_ERROR, "MapIndexFile(%p, %s, %" PRIu64 ", %p, %p, %p) failed with %d",
+            storage_api, path, (uint64_t)header_size, out_header, out_data, out_data_size,
+            err)
+        return err;
+    }
+    uint64_t data_size;
+    err = storage_api->GetSize(storage_api, file_handle, &data_size);
+    if (err == 0 && data_size < sizeof(uint32_t))
+    {
+        err = EBADF;
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "MapIndexFile(%p, %s, %" PRIu64 ", %p, %p, %p) failed with %d",
+            storage_api, path, (uint64_t)header_size, out_header, out_data, out_data_size,
+            err)
+        storage_api->CloseFile(storage_api, file_handle);
+        return err;
+    }
+    Longtail_StorageAPI_HFileMap file_map = 0;
+    const void* mapped_data = 0;
+    err = storage_api->MapFile(storage_api, file_handle, 0, data_size, &file_map, &mapped_data);
+    if (err == ENOTSUP)
+    {
+        file_map = 0;
+    }
+    else if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "MapIndexFile(%p, %s, %" PRIu64 ", %p, %p, %p) failed with %d",
+            storage_api, path, (uint64_t)header_size, out_header, out_data, out_data_size,
+            err)
+        storage_api->CloseFile(storage_api, file_handle);
+        return err;
+    }
+
+    size_t mem_size = header_size + sizeof(struct IndexFileMapping) + (file_map ? 0 : (size_t)data_size);
+    void* header = Longtail_Alloc(mem_size);
+    if (!header)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "MapIndexFile(%p, %s, %" PRIu64 ", %p, %p, %p) failed with %d",
+            storage_api, path, (uint64_t)header_size, out_header, out_data, out_data_size,
+            ENOMEM)
+        if (file_map)
+        {
+            storage_api->UnmapFile(storage_api, file_map);
+        }
+        storage_api->CloseFile(storage_api, file_handle);
+        return ENOMEM;
+    }
+    struct IndexFileMapping* mapping = (struct IndexFileMapping*)&((char*)header)[header_size];
+    void* data = (void*)mapped_data;
+    if (!file_map)
+    {
+        data = &mapping[1];
+        err = storage_api->Read(storage_api, file_handle, 0, data_size, data);
+        storage_api->CloseFile(storage_api, file_handle);
+        file_handle = 0;
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "MapIndexFile(%p, %s, %" PRIu64 ", %p, %p, %p) failed with %d",
+                storage_api, path, (uint64_t)header_size, out_header, out_data, out_data_size,
+                err)
+            Longtail_Free(header);
+            return err;
+        }
+    }
+    mapping->m_StorageAPI = storage_api;
+    mapping->m_FileHandle = file_handle;
+    mapping->m_FileMap = file_map;
+    *out_header = header;
+    *out_data = data;
+    *out_data_size = data_size;
+    return 0;
+}
+
+static void UnmapIndexFile(void* header, size_t header_size)
+{
+    struct IndexFileMapping* mapping = (struct IndexFileMapping*)&((char*)header)[header_size];
+    if (mapping->m_FileMap)
+    {
+        mapping->m_StorageAPI->UnmapFile(mapping->m_StorageAPI, mapping->m_FileMap);
+        mapping->m_StorageAPI->CloseFile(mapping->m_StorageAPI, mapping->m_FileHandle);
+    }
+    Longtail_Free(header);
+}
+
+int Longtail_MapVersionIndex(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    struct Longtail_VersionIndex** out_version_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_MapVersionIndex(%p, %s, %p)",
+        storage_api, path, out_version_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_version_index != 0, return EINVAL)
+
+    void* header;
+    void* data;
+    uint64_t data_size;
+    int err = MapIndexFile(storage_api, path, sizeof(struct Longtail_VersionIndex), &header, &data, &data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_WARNING : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_MapVersionIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_version_index,
             err)
-        Longtail_Free(work_mem_compact);
-        Longtail_Free(version_index_mem);
-        Longtail_Free(asset_chunk_tags);
-        Longtail_Free(asset_chunk_hashes);
-        Longtail_Free(asset_chunk_sizes);
-        Longtail_Free(work_mem);
         return err;
     }
-
-    Longtail_Free(work_mem_compact);
-    Longtail_Free(asset_chunk_tags);
-    Longtail_Free(asset_chunk_hashes);
-    Longtail_Free(asset_chunk_sizes);
-    Longtail_Free(work_mem);
-
+    struct Longtail_VersionIndex* version_index = (struct Longtail_VersionIndex*)header;
+    err = InitVersionIndexFromData(version_index, data, (size_t)data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_MapVersionIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_version_index,
+            err)
+        UnmapIndexFile(version_index, sizeof(struct Longtail_VersionIndex));
+        return err;
+    }
     *out_version_index = version_index;
     return 0;
 }
 
+void Longtail_UnmapVersionIndex(struct Longtail_VersionIndex* version_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_UnmapVersionIndex(%p)", version_index)
+    LONGTAIL_VALIDATE_INPUT(version_index != 0, return)
+    UnmapIndexFile(version_index, sizeof(struct Longtail_VersionIndex));
+}
+
 int Longtail_WriteVersionIndexToBuffer(
     const struct Longtail_VersionIndex* version_index,
     void** out_buffer,
@@ -2267,7 +4078,7 @@ int Longtail_WriteVersionIndexToBuffer(
     LONGTAIL_VALIDATE_INPUT(out_buffer != 0, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(out_size != 0, return EINVAL)
 
-    size_t index_data_size = Longtail_GetVersionIndexDataSize(*version_index->m_AssetCount, *version_index->m_ChunkCount, *version_index->m_AssetChunkIndexCount, version_index->m_NameDataSize);
+    size_t index_data_size = GetVersionIndexDataSize(version_index);
     *out_buffer = Longtail_Alloc(index_data_size);
     if (!(*out_buffer))
     {
@@ -2276,7 +4087,7 @@ int Longtail_WriteVersionIndexToBuffer(
             ENOMEM)
         return ENOMEM;
     }
-    memcpy(*out_buffer, &version_index[1], index_data_size);
+    memcpy(*out_buffer, version_index->m_Version, index_data_size);
     *out_size = index_data_size;
     return 0;
 }
@@ -2292,7 +4103,7 @@ int Longtail_WriteVersionIndex(
     LONGTAIL_VALIDATE_INPUT(version_index != 0, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(path != 0, return EINVAL)
 
-    size_t index_data_size = Longtail_GetVersionIndexDataSize(*version_index->m_AssetCount, *version_index->m_ChunkCount, *version_index->m_AssetChunkIndexCount, version_index->m_NameDataSize);
+    size_t index_data_size = GetVersionIndexDataSize(version_index);
 
     int err = EnsureParentPathExists(storage_api, path);
     if (err)
@@ -2311,7 +4122,7 @@ int Longtail_WriteVersionIndex(
             err)
         return err;
     }
-    err = storage_api->Write(storage_api, file_handle, 0, index_data_size, &version_index[1]);
+    err = storage_api->Write(storage_api, file_handle, 0, index_data_size, version_index->m_Version);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteVersionIndex(%s, %u, %u) failed with %d",
@@ -3097,6 +4908,25 @@ size_t Longtail_GetContentIndexDataSize(uint64_t block_count, uint64_t chunk_cou
     return block_index_data_size;
 }
 
+static size_t GetSortedChunksDataSize(uint64_t chunk_count)
+{
+    return (size_t)(
+        (sizeof(TLongtail_Hash) * chunk_count) +    // m_SortedChunkHashes[]
+        (sizeof(uint64_t) * chunk_count)            // m_SortedChunkBlockIndexes[]
+        );
+}
+
+// Size of the serialized content index, including the sorted chunk columns if present
+static size_t GetContentIndexDataSize(const struct Longtail_ContentIndex* content_index)
+{
+    size_t size = Longtail_GetContentIndexDataSize(*content_index->m_BlockCount, *content_index->m_ChunkCount);
+    if (content_index->m_SortedChunkHashes)
+    {
+        size += GetSortedChunksDataSize(*content_index->m_ChunkCount);
+    }
+    return size;
+}
+
 size_t Longtail_GetContentIndexSize(uint64_t block_count, uint64_t chunk_count)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "Longtail_GetContentIndexSize(%" PRIu64 ", %" PRIu64 ")",
@@ -3122,7 +4952,8 @@ int Longtail_InitContentIndexFromData(
     p += sizeof(uint32_t);
 
     if (((*content_index->m_Version) != LONGTAIL_CONTENT_INDEX_VERSION_0_0_1) &&
-        ((*content_index->m_Version) != LONGTAIL_CONTENT_INDEX_VERSION_1_0_0))
+        ((*content_index->m_Version) != LONGTAIL_CONTENT_INDEX_VERSION_1_0_0) &&
+        ((*content_index->m_Version) != LONGTAIL_CONTENT_INDEX_VERSION_1_1_0))
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Unsupported version of content data %" PRIu64 "", (void*)content_index->m_Version);
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_InitContentIndexFromData(%p, %p, %" PRIu64 ") failed with %d",
@@ -3145,7 +4976,13 @@ int Longtail_InitContentIndexFromData(
     uint64_t block_count = *content_index->m_BlockCount;
     uint64_t chunk_count = *content_index->m_ChunkCount;
 
+    int is_sorted = (*content_index->m_Version) == LONGTAIL_CONTENT_INDEX_VERSION_1_1_0;
+
     size_t content_index_data_size = Longtail_GetContentIndexDataSize(block_count, chunk_count);
+    if (is_sorted)
+    {
+        content_index_data_size += GetSortedChunksDataSize(chunk_count);
+    }
     if (content_index_data_size > data_size)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Content index data is truncated: %" PRIu64 " <= %" PRIu64, data_size, content_index_data_size)
@@ -3160,6 +4997,19 @@ int Longtail_InitContentIndexFromData(
     content_index->m_ChunkHashes = (TLongtail_Hash*)(void*)p;
     p += (sizeof(TLongtail_Hash) * chunk_count);
     content_index->m_ChunkBlockIndexes = (uint64_t*)(void*)p;
+    p += (sizeof(uint64_t) * chunk_count);
+
+    if (is_sorted)
+    {
+        content_index->m_SortedChunkHashes = (TLongtail_Hash*)(void*)p;
+        p += (sizeof(TLongtail_Hash) * chunk_count);
+        content_index->m_SortedChunkBlockIndexes = (uint64_t*)(void*)p;
+    }
+    else
+    {
+        content_index->m_SortedChunkHashes = 0;
+        content_index->m_SortedChunkBlockIndexes = 0;
+    }
 
     return 0;
 }
@@ -3628,7 +5478,7 @@ int Longtail_WriteContentIndexToBuffer(
     LONGTAIL_VALIDATE_INPUT(out_buffer != 0, return EINVAL)
     LONGTAIL_VALIDATE_INPUT(out_size != 0, return EINVAL)
 
-    size_t index_data_size = Longtail_GetContentIndexDataSize(*content_index->m_BlockCount, *content_index->m_ChunkCount);
+    size_t index_data_size = GetContentIndexDataSize(content_index);
     *out_buffer = Longtail_Alloc(index_data_size);
     if (!(*out_buffer))
     {
@@ -3637,7 +5487,7 @@ int Longtail_WriteContentIndexToBuffer(
             ENOMEM)
         return ENOMEM;
     }
-    memcpy(*out_buffer, &content_index[1], index_data_size);
+    memcpy(*out_buffer, content_index->m_Version, index_data_size);
     *out_size = index_data_size;
     return 0;
 }
@@ -3704,8 +5554,8 @@ int Longtail_WriteContentIndex(
             err)
         return err;
     }
-    size_t index_data_size = Longtail_GetContentIndexDataSize(*content_index->m_BlockCount, *content_index->m_ChunkCount);
-    err = storage_api->Write(storage_api, file_handle, 0, index_data_size, &content_index[1]);
+    size_t index_data_size = GetContentIndexDataSize(content_index);
+    err = storage_api->Write(storage_api, file_handle, 0, index_data_size, content_index->m_Version);
     if (err){
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteContentIndex(%p, %p, %s) failed with %d",
             storage_api, content_index, path,
@@ -3715,74 +5565,384 @@ int Longtail_WriteContentIndex(
         return err;
     }
 
-    storage_api->CloseFile(storage_api, file_handle);
+    storage_api->CloseFile(storage_api, file_handle);
+
+    return 0;
+}
+
+int Longtail_ReadContentIndex(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    struct Longtail_ContentIndex** out_content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_ReadContentIndex(%p, %s, %p)",
+        storage_api, path, out_content_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+
+    Longtail_StorageAPI_HOpenFile file_handle;
+    int err = storage_api->OpenReadFile(storage_api, path, &file_handle);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_WARNING : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        return err;
+    }
+    uint64_t content_index_data_size;
+    err = storage_api->GetSize(storage_api, file_handle, &content_index_data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        storage_api->CloseFile(storage_api, file_handle);
+        return err;
+    }
+    uint64_t content_index_size = sizeof(struct Longtail_ContentIndex) + content_index_data_size;
+    struct Longtail_ContentIndex* content_index = (struct Longtail_ContentIndex*)Longtail_Alloc((size_t)(content_index_size));
+    if (!content_index)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            ENOMEM)
+        Longtail_Free(content_index);
+        storage_api->CloseFile(storage_api, file_handle);
+        return ENOMEM;
+    }
+    err = storage_api->Read(storage_api, file_handle, 0, content_index_data_size, &content_index[1]);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        Longtail_Free(content_index);
+        storage_api->CloseFile(storage_api, file_handle);
+        return err;
+    }
+    err = Longtail_InitContentIndexFromData(content_index, &content_index[1], content_index_data_size);
+    storage_api->CloseFile(storage_api, file_handle);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        Longtail_Free(content_index);
+        return err;
+    }
+    *out_content_index = content_index;
+    return 0;
+}
+
+int Longtail_MapContentIndex(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    struct Longtail_ContentIndex** out_content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_MapContentIndex(%p, %s, %p)",
+        storage_api, path, out_content_index)
+    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(path != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+
+    void* header;
+    void* data;
+    uint64_t data_size;
+    int err = MapIndexFile(storage_api, path, sizeof(struct Longtail_ContentIndex), &header, &data, &data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_WARNING : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_MapContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        return err;
+    }
+    struct Longtail_ContentIndex* content_index = (struct Longtail_ContentIndex*)header;
+    err = Longtail_InitContentIndexFromData(content_index, data, data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_MapContentIndex(%p, %s, %p) failed with %d",
+            storage_api, path, out_content_index,
+            err)
+        UnmapIndexFile(content_index, sizeof(struct Longtail_ContentIndex));
+        return err;
+    }
+    *out_content_index = content_index;
+    return 0;
+}
+
+void Longtail_UnmapContentIndex(struct Longtail_ContentIndex* content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_UnmapContentIndex(%p)", content_index)
+    LONGTAIL_VALIDATE_INPUT(content_index != 0, return)
+    UnmapIndexFile(content_index, sizeof(struct Longtail_ContentIndex));
+}
+
+static SORTFUNC(SortChunkHashes)
+{
+    LONGTAIL_FATAL_ASSERT(context != 0, return 0)
+    LONGTAIL_FATAL_ASSERT(a_ptr != 0, return 0)
+    LONGTAIL_FATAL_ASSERT(b_ptr != 0, return 0)
+
+    const TLongtail_Hash* chunk_hashes = (const TLongtail_Hash*)context;
+    uint64_t a = *(const uint64_t*)a_ptr;
+    uint64_t b = *(const uint64_t*)b_ptr;
+    TLongtail_Hash a_hash = chunk_hashes[a];
+    TLongtail_Hash b_hash = chunk_hashes[b];
+    if (a_hash != b_hash)
+    {
+        return a_hash < b_hash ? -1 : 1;
+    }
+    // Keep the first occurrence of a chunk first so duplicates resolve to the same block as Longtail_LookupTable_PutUnique
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// Switches a content index to the sorted format and fills in the sorted chunk columns from the
+// chunk hashes and chunk block indexes. The data of content_index must have room for the sorted columns.
+static int AddSortedChunkColumns(struct Longtail_ContentIndex* content_index)
+{
+    LONGTAIL_FATAL_ASSERT(content_index != 0, return EINVAL)
+
+    uint64_t block_count = *content_index->m_BlockCount;
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    size_t data_size = Longtail_GetContentIndexDataSize(block_count, chunk_count) + GetSortedChunksDataSize(chunk_count);
+    *content_index->m_Version = LONGTAIL_CONTENT_INDEX_VERSION_1_1_0;
+    int err = Longtail_InitContentIndexFromData(content_index, content_index->m_Version, data_size);
+    if (err)
+    {
+        return err;
+    }
+
+    uint64_t* chunk_order = (uint64_t*)Longtail_Alloc(sizeof(uint64_t) * chunk_count);
+    if (chunk_count > 0 && !chunk_order)
+    {
+        return ENOMEM;
+    }
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        chunk_order[c] = c;
+    }
+    QSORT(chunk_order, (size_t)chunk_count, sizeof(uint64_t), SortChunkHashes, (void*)content_index->m_ChunkHashes);
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        uint64_t chunk_index = chunk_order[c];
+        content_index->m_SortedChunkHashes[c] = content_index->m_ChunkHashes[chunk_index];
+        content_index->m_SortedChunkBlockIndexes[c] = content_index->m_ChunkBlockIndexes[chunk_index];
+    }
+    Longtail_Free(chunk_order);
+    return 0;
+}
+
+int Longtail_CreateSortedContentIndex(
+    const struct Longtail_ContentIndex* content_index,
+    struct Longtail_ContentIndex** out_content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CreateSortedContentIndex(%p, %p)",
+        content_index, out_content_index)
+    LONGTAIL_VALIDATE_INPUT(content_index != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+
+    uint64_t block_count = *content_index->m_BlockCount;
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    size_t data_size = Longtail_GetContentIndexDataSize(block_count, chunk_count) + GetSortedChunksDataSize(chunk_count);
+    void* mem = Longtail_Alloc(sizeof(struct Longtail_ContentIndex) + data_size);
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateSortedContentIndex(%p, %p) failed with %d",
+            content_index, out_content_index,
+            ENOMEM)
+        return ENOMEM;
+    }
+
+    struct Longtail_ContentIndex* sorted_content_index = (struct Longtail_ContentIndex*)mem;
+    void* data = &sorted_content_index[1];
+    memcpy(data, content_index->m_Version, Longtail_GetContentIndexDataSize(block_count, chunk_count));
+    *(uint32_t*)data = LONGTAIL_CONTENT_INDEX_VERSION_1_0_0;
+    int err = Longtail_InitContentIndexFromData(sorted_content_index, data, data_size);
+    if (!err)
+    {
+        err = AddSortedChunkColumns(sorted_content_index);
+    }
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CreateSortedContentIndex(%p, %p) failed with %d",
+            content_index, out_content_index,
+            err)
+        Longtail_Free(mem);
+        return err;
+    }
+
+    *out_content_index = sorted_content_index;
+    return 0;
+}
+
+int Longtail_CopyContentIndex(
+    const struct Longtail_ContentIndex* content_index,
+    int sorted,
+    struct Longtail_ContentIndex** out_content_index)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_CopyContentIndex(%p, %d, %p)",
+        content_index, sorted, out_content_index)
+    LONGTAIL_VALIDATE_INPUT(content_index != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+
+    if (sorted && !content_index->m_SortedChunkHashes)
+    {
+        return Longtail_CreateSortedContentIndex(content_index, out_content_index);
+    }
+
+    uint64_t block_count = *content_index->m_BlockCount;
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    size_t data_size = sorted ? GetContentIndexDataSize(content_index) : Longtail_GetContentIndexDataSize(block_count, chunk_count);
+    void* mem = Longtail_Alloc(sizeof(struct Longtail_ContentIndex) + data_size);
+    if (!mem)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CopyContentIndex(%p, %d, %p) failed with %d",
+            content_index, sorted, out_content_index,
+            ENOMEM)
+        return ENOMEM;
+    }
+
+    struct Longtail_ContentIndex* copy_content_index = (struct Longtail_ContentIndex*)mem;
+    void* data = &copy_content_index[1];
+    memcpy(data, content_index->m_Version, data_size);
+    if (!sorted && content_index->m_SortedChunkHashes)
+    {
+        *(uint32_t*)data = LONGTAIL_CONTENT_INDEX_VERSION_1_0_0;
+    }
+    int err = Longtail_InitContentIndexFromData(copy_content_index, data, data_size);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_CopyContentIndex(%p, %d, %p) failed with %d",
+            content_index, sorted, out_content_index,
+            err)
+        Longtail_Free(mem);
+        return err;
+    }
+
+    *out_content_index = copy_content_index;
+    return 0;
+}
+
+// Returns the index of the first sorted chunk hash that is not less than chunk_hash.
+// Chunk hashes are close to uniformly distributed so a few interpolation steps narrows
+// the range down quickly, the remaining range is resolved with a binary search.
+static uint64_t LowerBoundSortedChunkHash(const TLongtail_Hash* sorted_hashes, uint64_t count, TLongtail_Hash chunk_hash)
+{
+    uint64_t lo = 0;
+    uint64_t hi = count;
+    for (uint32_t probe = 0; probe < 8 && hi - lo > 16; ++probe)
+    {
+        TLongtail_Hash lo_hash = sorted_hashes[lo];
+        TLongtail_Hash hi_hash = sorted_hashes[hi - 1];
+        if (chunk_hash <= lo_hash)
+        {
+            return lo;
+        }
+        if (chunk_hash > hi_hash)
+        {
+            return hi;
+        }
+        uint64_t pos = lo + (uint64_t)(((double)(chunk_hash - lo_hash) / (double)(hi_hash - lo_hash)) * (double)(hi - 1 - lo));
+        if (pos >= hi)
+        {
+            pos = hi - 1;
+        }
+        if (sorted_hashes[pos] < chunk_hash)
+        {
+            lo = pos + 1;
+        }
+        else
+        {
+            hi = pos;
+        }
+    }
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (sorted_hashes[mid] < chunk_hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static const uint64_t* FindSortedChunkBlockIndex(const struct Longtail_ContentIndex* content_index, TLongtail_Hash chunk_hash)
+{
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    uint64_t i = LowerBoundSortedChunkHash(content_index->m_SortedChunkHashes, chunk_count, chunk_hash);
+    if (i == chunk_count || content_index->m_SortedChunkHashes[i] != chunk_hash)
+    {
+        return 0;
+    }
+    return &content_index->m_SortedChunkBlockIndexes[i];
+}
+
+int Longtail_ContentIndex_LookupChunkBlockIndex(
+    const struct Longtail_ContentIndex* content_index,
+    TLongtail_Hash chunk_hash,
+    uint64_t* out_block_index)
+{
+    LONGTAIL_VALIDATE_INPUT(content_index != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(content_index->m_SortedChunkHashes != 0, return EINVAL)
+    LONGTAIL_VALIDATE_INPUT(out_block_index != 0, return EINVAL)
 
+    const uint64_t* block_index_ptr = FindSortedChunkBlockIndex(content_index, chunk_hash);
+    if (!block_index_ptr)
+    {
+        return ENOENT;
+    }
+    *out_block_index = *block_index_ptr;
     return 0;
 }
 
-int Longtail_ReadContentIndex(
-    struct Longtail_StorageAPI* storage_api,
-    const char* path,
-    struct Longtail_ContentIndex** out_content_index)
+// Chunk hash to block index lookup, uses the sorted chunk columns in place if the content index has them
+// and builds a hash table otherwise
+struct ChunkBlockIndexLookup
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "Longtail_ReadContentIndex(%p, %s, %p)",
-        storage_api, path, out_content_index)
-    LONGTAIL_VALIDATE_INPUT(storage_api != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT(path != 0, return EINVAL)
-    LONGTAIL_VALIDATE_INPUT(out_content_index != 0, return EINVAL)
+    const struct Longtail_ContentIndex* m_ContentIndex;
+    struct Longtail_LookupTable* m_LookupTable;
+};
 
-    Longtail_StorageAPI_HOpenFile file_handle;
-    int err = storage_api->OpenReadFile(storage_api, path, &file_handle);
-    if (err)
-    {
-        LONGTAIL_LOG(err == ENOENT ? LONGTAIL_LOG_LEVEL_WARNING : LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
-            storage_api, path, out_content_index,
-            err)
-        return err;
-    }
-    uint64_t content_index_data_size;
-    err = storage_api->GetSize(storage_api, file_handle, &content_index_data_size);
-    if (err)
+static struct ChunkBlockIndexLookup* CreateChunkBlockIndexLookup(const struct Longtail_ContentIndex* content_index)
+{
+    LONGTAIL_FATAL_ASSERT(content_index != 0, return 0)
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    int use_sorted = content_index->m_SortedChunkHashes != 0;
+    size_t lookup_size = sizeof(struct ChunkBlockIndexLookup) + (use_sorted ? 0 : Longtail_LookupTable_GetSize(chunk_count));
+    struct ChunkBlockIndexLookup* lookup = (struct ChunkBlockIndexLookup*)Longtail_Alloc(lookup_size);
+    if (!lookup)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
-            storage_api, path, out_content_index,
-            err)
-        storage_api->CloseFile(storage_api, file_handle);
-        return err;
+        return 0;
     }
-    uint64_t content_index_size = sizeof(struct Longtail_ContentIndex) + content_index_data_size;
-    struct Longtail_ContentIndex* content_index = (struct Longtail_ContentIndex*)Longtail_Alloc((size_t)(content_index_size));
-    if (!content_index)
+    lookup->m_ContentIndex = content_index;
+    lookup->m_LookupTable = 0;
+    if (use_sorted)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
-            storage_api, path, out_content_index,
-            ENOMEM)
-        Longtail_Free(content_index);
-        storage_api->CloseFile(storage_api, file_handle);
-        return ENOMEM;
+        return lookup;
     }
-    err = storage_api->Read(storage_api, file_handle, 0, content_index_data_size, &content_index[1]);
-    if (err)
+    lookup->m_LookupTable = Longtail_LookupTable_Create(&lookup[1], chunk_count, 0);
+    for (uint64_t i = 0; i < chunk_count; ++i)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
-            storage_api, path, out_content_index,
-            err)
-        Longtail_Free(content_index);
-        storage_api->CloseFile(storage_api, file_handle);
-        return err;
+        TLongtail_Hash chunk_hash = content_index->m_ChunkHashes[i];
+        uint64_t block_index = content_index->m_ChunkBlockIndexes[i];
+        Longtail_LookupTable_PutUnique(lookup->m_LookupTable, chunk_hash, block_index);
     }
-    err = Longtail_InitContentIndexFromData(content_index, &content_index[1], content_index_data_size);
-    storage_api->CloseFile(storage_api, file_handle);
-    if (err)
+    return lookup;
+}
+
+static const uint64_t* ChunkBlockIndexLookup_Get(const struct ChunkBlockIndexLookup* lookup, TLongtail_Hash chunk_hash)
+{
+    if (lookup->m_LookupTable)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ReadContentIndex(%p, %s, %p) failed with %d",
-            storage_api, path, out_content_index,
-            err)
-        Longtail_Free(content_index);
-        return err;
+        return Longtail_LookupTable_Get(lookup->m_LookupTable, chunk_hash);
     }
-    *out_content_index = content_index;
-    return 0;
+    return FindSortedChunkBlockIndex(lookup->m_ContentIndex, chunk_hash);
 }
 
 struct ChunkAssetPartReference
@@ -3873,6 +6033,7 @@ struct WriteBlockJob
     struct AssetPartLookup* m_AssetPartLookup;
     uint64_t m_FirstChunkIndex;
     uint32_t m_ChunkCount;
+    uint64_t m_StartTime;
     int m_Err;
 };
 
@@ -3895,46 +6056,36 @@ static void BlockWriterJobOnComplete(struct Longtail_AsyncPutStoredBlockAPI* asy
     job->m_StoredBlock = 0;
     job->m_JobID = 0;
     job->m_Err = err;
+    if (!err)
+    {
+        Longtail_ObserveMetricTime(Longtail_Metric_WriteContent_BlockTime, job->m_StartTime);
+    }
     job->m_JobAPI->ResumeJob(job->m_JobAPI, job_id);
 }
 
-static int DisposePutBlock(struct Longtail_StoredBlock* stored_block)
-{
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockWriterJobOnComplete(%p)",
-        stored_block)
-    Longtail_Free(stored_block->m_BlockIndex);
-    Longtail_Free(stored_block->m_BlockData);
-    Longtail_Free(stored_block);
-    return 0;
-}
-
-static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled)
+// Reads the chunks of a block from the source assets, WriteContentPutBlockJob stores the block once it is read
+static int WriteContentReadBlockJob(void* context, uint32_t job_id, int is_cancelled)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BlockWriterJobOnComplete(%p, %u)",
-        context, job_id)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WriteContentReadBlockJob(%p, %u, %d)",
+        context, job_id, is_cancelled)
     LONGTAIL_FATAL_ASSERT(context != 0, return EINVAL)
 
     struct WriteBlockJob* job = (struct WriteBlockJob*)context;
     LONGTAIL_FATAL_ASSERT(job->m_JobID == 0, return EINVAL);
 
-    if (job->m_AsyncCompleteAPI.OnComplete)
-    {
-        // We got a notification so we are complete
-        job->m_AsyncCompleteAPI.OnComplete = 0;
-        return 0;
-    }
-
     if (is_cancelled)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
             context, job_id, is_cancelled,
             ECANCELED)
         job->m_Err = ECANCELED;
         return 0;
     }
 
+    // Measured until the block store completes the put
+    job->m_StartTime = Longtail_GetMetricTime();
+
     struct Longtail_StorageAPI* source_storage_api = job->m_SourceStorageAPI;
-    struct Longtail_BlockStoreAPI* block_store_api = job->m_BlockStoreAPI;
 
     const struct Longtail_ContentIndex* content_index = job->m_ContentIndex;
     uint64_t first_chunk_index = job->m_FirstChunkIndex;
@@ -3953,7 +6104,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
     char* block_data_buffer = (char*)Longtail_Alloc(block_data_size);
     if (!block_data_buffer)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
             context, job_id, is_cancelled,
             ENOMEM);
         job->m_Err = ENOMEM;
@@ -3978,7 +6129,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
 
         if (asset_path && tag != next_asset_part->m_Tag)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "WriteContentBlockJob(%p, %u, %d): Warning: Inconsistent tag type for chunks inside block 0x%" PRIx64 ", retaining 0x%" PRIx64 "",
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "WriteContentReadBlockJob(%p, %u, %d): Warning: Inconsistent tag type for chunks inside block 0x%" PRIx64 ", retaining 0x%" PRIx64 "",
                 context, job_id, is_cancelled,
                 block_hash, tag)
         }
@@ -4002,7 +6153,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
             full_path = 0;
             if (err)
             {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
                     context, job_id, is_cancelled,
                     err);
                 Longtail_Free(block_data_buffer);
@@ -4013,7 +6164,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
             err = source_storage_api->GetSize(source_storage_api, file_handle, &next_asset_file_size);
             if (err)
             {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
                     context, job_id, is_cancelled,
                     err);
                 Longtail_Free(block_data_buffer);
@@ -4029,7 +6180,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "Source asset file does not match indexed size %" PRIu64 " < %" PRIu64,
                 asset_file_size, (asset_offset + chunk_size))
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
                 context, job_id, is_cancelled,
                 EBADF);
             Longtail_Free(block_data_buffer);
@@ -4040,7 +6191,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
         int err = source_storage_api->Read(source_storage_api, file_handle, asset_offset, chunk_size, write_ptr);
         if (err)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
                 context, job_id, is_cancelled,
                 err);
             Longtail_Free(block_data_buffer);
@@ -4061,7 +6212,7 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
     struct Longtail_BlockIndex* block_index_ptr = (struct Longtail_BlockIndex*)Longtail_Alloc(block_index_size);
     if (!block_index_ptr)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentReadBlockJob(%p, %u, %d) failed with %d",
             context, job_id, is_cancelled,
             ENOMEM);
         job->m_Err = ENOMEM;
@@ -4081,14 +6232,51 @@ static int WriteContentBlockJob(void* context, uint32_t job_id, int is_cancelled
     job->m_StoredBlock->m_BlockIndex = block_index_ptr;
     job->m_StoredBlock->m_BlockData = block_data_buffer;
     job->m_StoredBlock->m_BlockChunksDataSize = block_data_size;
+    return 0;
+}
+
+// Compressing the block in the block store is CPU work so this runs as a CPU job, separate from the read
+static int WriteContentPutBlockJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WriteContentPutBlockJob(%p, %u, %d)",
+        context, job_id, is_cancelled)
+    LONGTAIL_FATAL_ASSERT(context != 0, return EINVAL)
+
+    struct WriteBlockJob* job = (struct WriteBlockJob*)context;
+    LONGTAIL_FATAL_ASSERT(job->m_JobID == 0, return EINVAL);
+
+    if (job->m_AsyncCompleteAPI.OnComplete)
+    {
+        // We got a notification so we are complete
+        job->m_AsyncCompleteAPI.OnComplete = 0;
+        return 0;
+    }
+
+    if (job->m_StoredBlock == 0)
+    {
+        // Reading the block failed, m_Err is already set
+        return 0;
+    }
+
+    if (is_cancelled)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "WriteContentPutBlockJob(%p, %u, %d) failed with %d",
+            context, job_id, is_cancelled,
+            ECANCELED)
+        job->m_StoredBlock->Dispose(job->m_StoredBlock);
+        job->m_StoredBlock = 0;
+        job->m_Err = ECANCELED;
+        return 0;
+    }
 
+    struct Longtail_BlockStoreAPI* block_store_api = job->m_BlockStoreAPI;
     job->m_JobID = job_id;
     job->m_AsyncCompleteAPI.OnComplete = BlockWriterJobOnComplete;
 
     int err = block_store_api->PutStoredBlock(block_store_api, job->m_StoredBlock, &job->m_AsyncCompleteAPI);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentBlockJob(%p, %u, %d) failed with %d",
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteContentPutBlockJob(%p, %u, %d) failed with %d",
             context, job_id, is_cancelled,
             err);
         job->m_StoredBlock->Dispose(job->m_StoredBlock);
@@ -4151,16 +6339,21 @@ int Longtail_WriteContent(
         Longtail_Free(chunk_lookup);
         return ENOMEM;
     }
-    for (uint64_t c = 0; c < version_content_index_chunk_count; ++c)
+    for (uint64_t c = 0; c < version_content_index_chunk_count; c += LONGTAIL_LOOKUP_TABLE_BATCH_SIZE)
     {
-        uint64_t* version_chunk_index = Longtail_LookupTable_Get(chunk_lookup, content_index->m_ChunkHashes[c]);
-        if (version_chunk_index == 0)
+        uint64_t* version_chunk_indexes[LONGTAIL_LOOKUP_TABLE_BATCH_SIZE];
+        uint64_t batch_count = version_content_index_chunk_count - c < LONGTAIL_LOOKUP_TABLE_BATCH_SIZE ? version_content_index_chunk_count - c : LONGTAIL_LOOKUP_TABLE_BATCH_SIZE;
+        Longtail_LookupTable_GetBatch(chunk_lookup, batch_count, &content_index->m_ChunkHashes[c], version_chunk_indexes);
+        for (uint64_t b = 0; b < batch_count; ++b)
         {
-            Longtail_Free(chunk_sizes);
-            Longtail_Free(chunk_lookup);
-            return EINVAL;
+            if (version_chunk_indexes[b] == 0)
+            {
+                Longtail_Free(chunk_sizes);
+                Longtail_Free(chunk_lookup);
+                return EINVAL;
+            }
+            chunk_sizes[c + b] = version_index->m_ChunkSizes[*version_chunk_indexes[b]];
         }
-        chunk_sizes[c] = version_index->m_ChunkSizes[*version_chunk_index];
     }
     Longtail_Free(chunk_lookup);
     chunk_lookup = 0;
@@ -4189,7 +6382,6 @@ int Longtail_WriteContent(
     LONGTAIL_FATAL_ASSERT(write_block_jobs != 0, return ENOMEM)
     uint32_t block_start_chunk_index = 0;
     uint32_t job_count = 0;
-    Longtail_JobAPI_JobFunc* funcs = (Longtail_JobAPI_JobFunc*)Longtail_Alloc(sizeof(Longtail_JobAPI_JobFunc*) * block_count);
     void** ctxs = (void**)Longtail_Alloc(sizeof(void*) * block_count);
     for (uint64_t block_index = 0; block_index < block_count; ++block_index)
     {
@@ -4219,7 +6411,6 @@ int Longtail_WriteContent(
         job->m_ChunkSizes = chunk_sizes;
         job->m_Err = EINVAL;
 
-        funcs[job_count] = WriteContentBlockJob;
         ctxs[job_count] = job;
 
         ++job_count;
@@ -4229,7 +6420,6 @@ int Longtail_WriteContent(
     if (job_count == 0)
     {
         Longtail_Free(ctxs);
-        Longtail_Free(funcs);
         Longtail_Free(asset_part_lookup);
         Longtail_Free(write_block_jobs);
         Longtail_Free(chunk_sizes);
@@ -4237,7 +6427,7 @@ int Longtail_WriteContent(
     }
 
     Longtail_JobAPI_Group job_group = 0;
-    err = job_api->ReserveJobs(job_api, (uint32_t)job_count, &job_group);
+    err = job_api->ReserveJobs(job_api, (uint32_t)job_count * 2, &job_group);
     if (err)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteContent(%p, %p, %p, %p, %p, %p, %p, %p, %s) failed with %d",
@@ -4247,14 +6437,25 @@ int Longtail_WriteContent(
         return err;
     }
 
-    Longtail_JobAPI_Jobs jobs;
-    err = job_api->CreateJobs(job_api, job_group, job_count, funcs, ctxs, &jobs);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
-    err = job_api->ReadyJobs(job_api, job_count, jobs);
-    LONGTAIL_FATAL_ASSERT(err == 0, return err)
+    // Reading the assets is disk I/O while compressing the block is CPU work, each block
+    // gets an I/O class read job and a CPU class put job that runs when the read is done
+    for (uint32_t j = 0; j < job_count; ++j)
+    {
+        Longtail_JobAPI_JobFunc read_funcs[1] = { WriteContentReadBlockJob };
+        Longtail_JobAPI_Jobs read_job;
+        err = job_api->CreateJobs(job_api, job_group, 1, read_funcs, &ctxs[j], LONGTAIL_JOB_CLASS_IO, &read_job);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        Longtail_JobAPI_JobFunc put_funcs[1] = { WriteContentPutBlockJob };
+        Longtail_JobAPI_Jobs put_job;
+        err = job_api->CreateJobs(job_api, job_group, 1, put_funcs, &ctxs[j], LONGTAIL_JOB_CLASS_CPU, &put_job);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        err = job_api->AddDependecies(job_api, 1, put_job, 1, read_job);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        err = job_api->ReadyJobs(job_api, 1, read_job);
+        LONGTAIL_FATAL_ASSERT(err == 0, return err)
+    }
 
     Longtail_Free(ctxs);
-    Longtail_Free(funcs);
 
     err = job_api->WaitForAllJobs(job_api, job_group, progress_api, optional_cancel_api, optional_cancel_token);
     if (err)
@@ -4302,6 +6503,7 @@ struct BlockReaderJob
     uint32_t m_JobID;
     TLongtail_Hash m_BlockHash;
     struct Longtail_StoredBlock* m_StoredBlock;
+    uint64_t m_RequestTime;
     int m_Err;
 };
 
@@ -4317,6 +6519,15 @@ void BlockReaderJobOnComplete(struct Longtail_AsyncGetStoredBlockAPI* async_comp
     LONGTAIL_FATAL_ASSERT(async_complete_api != 0, return)
     struct BlockReaderJob* job = (struct BlockReaderJob*)async_complete_api;
     LONGTAIL_FATAL_ASSERT(job->m_AsyncCompleteAPI.OnComplete != 0, return);
+    if (err)
+    {
+        Longtail_AddMetric(Longtail_Metric_BlockFetch_FailCount, 1);
+    }
+    else
+    {
+        Longtail_ObserveMetricTime(Longtail_Metric_BlockFetch_WaitTime, job->m_RequestTime);
+        Longtail_AddMetric(Longtail_Metric_BlockFetch_ByteCount, stored_block->m_BlockChunksDataSize);
+    }
     job->m_Err = err;
     job->m_StoredBlock = stored_block;
     job->m_JobAPI->ResumeJob(job->m_JobAPI, job->m_JobID);
@@ -4349,7 +6560,8 @@ static int BlockReader(void* context, uint32_t job_id, int is_cancelled)
     job->m_JobID = job_id;
     job->m_StoredBlock = 0;
     job->m_AsyncCompleteAPI.OnComplete = BlockReaderJobOnComplete;
-    
+    job->m_RequestTime = Longtail_GetMetricTime();
+
     int err = job->m_BlockStoreAPI->GetStoredBlock(job->m_BlockStoreAPI, job->m_BlockHash, &job->m_AsyncCompleteAPI);
     if (err)
     {
@@ -4378,7 +6590,7 @@ struct WritePartialAssetFromBlocksJob
     const struct Longtail_ContentIndex* m_ContentIndex;
     const struct Longtail_VersionIndex* m_VersionIndex;
     const char* m_VersionFolder;
-    struct Longtail_LookupTable* m_ChunkHashToBlockIndex;
+    const struct ChunkBlockIndexLookup* m_ChunkHashToBlockIndex;
     uint32_t m_AssetIndex;
     int m_RetainPermissions;
 
@@ -4388,14 +6600,34 @@ struct WritePartialAssetFromBlocksJob
 
     uint32_t m_AssetChunkIndexOffset;
     uint32_t m_AssetChunkCount;
+    uint32_t m_AssetChunkIndexEnd;
+    uint32_t m_MaxBlockCount;
 
     Longtail_StorageAPI_HOpenFile m_AssetOutputFile;
+    // Set when the asset is written as multiple ranges sharing m_AssetOutputFile, readied instead of closing the file
+    Longtail_JobAPI_Jobs m_RangeDoneJob;
 
     int m_Err;
 };
 
 int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled);
 
+static void ReleasePartialAssetOutputFile(struct WritePartialAssetFromBlocksJob* job)
+{
+    if (job->m_RangeDoneJob)
+    {
+        // The file is shared with the other ranges of the asset, FinalizeAssetRanges closes it
+        int err = job->m_JobAPI->ReadyJobs(job->m_JobAPI, 1, job->m_RangeDoneJob);
+        LONGTAIL_FATAL_ASSERT(err == 0, return)
+        job->m_RangeDoneJob = 0;
+    }
+    else if (job->m_AssetOutputFile)
+    {
+        job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
+    }
+    job->m_AssetOutputFile = 0;
+}
+
 // Returns the write sync task, or the write task if there is no need for reading new blocks
 static int CreatePartialAssetWriteJob(
     struct Longtail_BlockStoreAPI* block_store_api,
@@ -4404,17 +6636,20 @@ static int CreatePartialAssetWriteJob(
     const struct Longtail_ContentIndex* content_index,
     const struct Longtail_VersionIndex* version_index,
     const char* version_folder,
-    struct Longtail_LookupTable* chunk_hash_to_block_index,
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index,
     uint32_t asset_index,
     int retain_permissions,
     Longtail_JobAPI_Group job_group,
     struct WritePartialAssetFromBlocksJob* job,
     uint32_t asset_chunk_index_offset,
+    uint32_t asset_chunk_index_end,
+    uint32_t max_block_count,
     Longtail_StorageAPI_HOpenFile asset_output_file,
+    Longtail_JobAPI_Jobs range_done_job,
     Longtail_JobAPI_Jobs* out_jobs)
 {
-    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CreatePartialAssetWriteJob(%p, , %p, %p, %p, %p, %s, %p, %u, %d, %p, %p, %u, %p, %p)",
-        block_store_api, version_storage_api, job_api, content_index, version_index, version_folder, chunk_hash_to_block_index, asset_index, retain_permissions, job_group, job, asset_chunk_index_offset, asset_output_file, out_jobs)
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "CreatePartialAssetWriteJob(%p, , %p, %p, %p, %p, %s, %p, %u, %d, %p, %p, %u, %u, %u, %p, %p, %p)",
+        block_store_api, version_storage_api, job_api, content_index, version_index, version_folder, chunk_hash_to_block_index, asset_index, retain_permissions, job_group, job, asset_chunk_index_offset, asset_chunk_index_end, max_block_count, asset_output_file, range_done_job, out_jobs)
 
     LONGTAIL_FATAL_ASSERT(block_store_api !=0, return EINVAL)
     LONGTAIL_FATAL_ASSERT(version_storage_api !=0, return EINVAL)
@@ -4424,6 +6659,9 @@ static int CreatePartialAssetWriteJob(
     LONGTAIL_FATAL_ASSERT(version_folder !=0, return EINVAL)
     LONGTAIL_FATAL_ASSERT(chunk_hash_to_block_index !=0, return EINVAL)
     LONGTAIL_FATAL_ASSERT(asset_index < *version_index->m_AssetCount, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(asset_chunk_index_offset <= asset_chunk_index_end, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(asset_chunk_index_end <= version_index->m_AssetChunkCounts[asset_index], return EINVAL)
+    LONGTAIL_FATAL_ASSERT(max_block_count > 0 && max_block_count <= MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE, return EINVAL)
     LONGTAIL_FATAL_ASSERT(job !=0, return EINVAL)
     LONGTAIL_FATAL_ASSERT(out_jobs !=0, return EINVAL)
 
@@ -4440,25 +6678,25 @@ static int CreatePartialAssetWriteJob(
     job->m_BlockReaderJobCount = 0;
     job->m_AssetChunkIndexOffset = asset_chunk_index_offset;
     job->m_AssetChunkCount = 0;
+    job->m_AssetChunkIndexEnd = asset_chunk_index_end;
+    job->m_MaxBlockCount = max_block_count;
     job->m_AssetOutputFile = asset_output_file;
+    job->m_RangeDoneJob = range_done_job;
     job->m_Err = EINVAL;
 
     uint32_t chunk_index_start = version_index->m_AssetChunkIndexStarts[asset_index];
     uint32_t chunk_start_index_offset = chunk_index_start + asset_chunk_index_offset;
-    uint32_t chunk_index_end = chunk_index_start + version_index->m_AssetChunkCounts[asset_index];
+    uint32_t chunk_index_end = chunk_index_start + asset_chunk_index_end;
     uint32_t chunk_index_offset = chunk_start_index_offset;
 
     Longtail_JobAPI_JobFunc block_read_funcs[MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE];
     void* block_read_ctx[MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE];
 
-    const uint32_t worker_count = job_api->GetWorkerCount(job_api) + 1;
-    const uint32_t max_parallell_block_read_jobs = worker_count < MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE ? worker_count : MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE;
-
-    while (chunk_index_offset != chunk_index_end && job->m_BlockReaderJobCount < max_parallell_block_read_jobs)
+    while (chunk_index_offset != chunk_index_end && job->m_BlockReaderJobCount < max_block_count)
     {
         uint32_t chunk_index = version_index->m_AssetChunkIndexes[chunk_index_offset];
         TLongtail_Hash chunk_hash = version_index->m_ChunkHashes[chunk_index];
-        const uint64_t* block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, chunk_hash);
+        const uint64_t* block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, chunk_hash);
         LONGTAIL_FATAL_ASSERT(block_index_ptr, return EINVAL)
         uint64_t block_index = *block_index_ptr;
         TLongtail_Hash block_hash = content_index->m_BlockHashes[block_index];
@@ -4493,11 +6731,11 @@ static int CreatePartialAssetWriteJob(
     Longtail_JobAPI_JobFunc write_funcs[1] = { WritePartialAssetFromBlocks };
     void* write_ctx[1] = { job };
     Longtail_JobAPI_Jobs write_job;
-    int err = job_api->CreateJobs(job_api, job_group, 1, write_funcs, write_ctx, &write_job);
+    int err = job_api->CreateJobs(job_api, job_group, 1, write_funcs, write_ctx, LONGTAIL_JOB_CLASS_IO, &write_job);
     if (err)
     {
-        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreatePartialAssetWriteJob(%p, %p, %p, %p, %p, %s, %p, %u, %d, %p, %p, %u, %p, %p) failed with %d",
-            block_store_api, version_storage_api, job_api, content_index, version_index, version_folder, chunk_hash_to_block_index, asset_index, retain_permissions, job_group, job, asset_chunk_index_offset, asset_output_file, out_jobs,
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "CreatePartialAssetWriteJob(%p, %p, %p, %p, %p, %s, %p, %u, %d, %p, %p, %u, %u, %u, %p, %p, %p) failed with %d",
+            block_store_api, version_storage_api, job_api, content_index, version_index, version_folder, chunk_hash_to_block_index, asset_index, retain_permissions, job_group, job, asset_chunk_index_offset, asset_chunk_index_end, max_block_count, asset_output_file, range_done_job, out_jobs,
             err)
         return err;
     }
@@ -4505,12 +6743,12 @@ static int CreatePartialAssetWriteJob(
     if (job->m_BlockReaderJobCount > 0)
     {
         Longtail_JobAPI_Jobs block_read_jobs;
-        err = job_api->CreateJobs(job_api, job_group, job->m_BlockReaderJobCount, block_read_funcs, block_read_ctx, &block_read_jobs);
+        err = job_api->CreateJobs(job_api, job_group, job->m_BlockReaderJobCount, block_read_funcs, block_read_ctx, LONGTAIL_JOB_CLASS_IO, &block_read_jobs);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
         Longtail_JobAPI_JobFunc sync_write_funcs[1] = { WriteReady };
         void* sync_write_ctx[1] = { 0 };
         Longtail_JobAPI_Jobs write_sync_job;
-        err = job_api->CreateJobs(job_api, job_group, 1, sync_write_funcs, sync_write_ctx, &write_sync_job);
+        err = job_api->CreateJobs(job_api, job_group, 1, sync_write_funcs, sync_write_ctx, LONGTAIL_JOB_CLASS_IO, &write_sync_job);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
 
         err = job_api->AddDependecies(job_api, 1, write_job, 1, write_sync_job);
@@ -4527,6 +6765,61 @@ static int CreatePartialAssetWriteJob(
     return 0;
 }
 
+// Prepares the path of a (non-directory) asset and opens it for writing with the size of the asset
+static int OpenAssetOutputFile(
+    struct Longtail_StorageAPI* version_storage_api,
+    const char* full_asset_path,
+    uint64_t asset_size,
+    Longtail_StorageAPI_HOpenFile* out_asset_output_file)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "OpenAssetOutputFile(%p, %s, %" PRIu64 ", %p)",
+        version_storage_api, full_asset_path, asset_size, out_asset_output_file)
+    LONGTAIL_FATAL_ASSERT(version_storage_api != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(full_asset_path != 0, return EINVAL)
+    LONGTAIL_FATAL_ASSERT(out_asset_output_file != 0, return EINVAL)
+
+    int err = EnsureParentPathExists(version_storage_api, full_asset_path);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "OpenAssetOutputFile(%p, %s, %" PRIu64 ", %p) failed with %d",
+            version_storage_api, full_asset_path, asset_size, out_asset_output_file,
+            err)
+        return err;
+    }
+
+    uint16_t permissions;
+    err = version_storage_api->GetPermissions(version_storage_api, full_asset_path, &permissions);
+    if (err && (err != ENOENT))
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "OpenAssetOutputFile(%p, %s, %" PRIu64 ", %p) failed with %d",
+            version_storage_api, full_asset_path, asset_size, out_asset_output_file,
+            err)
+        return err;
+    }
+
+    if ((err != ENOENT) && !(permissions & Longtail_StorageAPI_UserWriteAccess))
+    {
+        err = version_storage_api->SetPermissions(version_storage_api, full_asset_path, permissions | (Longtail_StorageAPI_UserWriteAccess));
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "OpenAssetOutputFile(%p, %s, %" PRIu64 ", %p) failed with %d",
+                version_storage_api, full_asset_path, asset_size, out_asset_output_file,
+                err)
+            return err;
+        }
+    }
+
+    err = version_storage_api->OpenWriteFile(version_storage_api, full_asset_path, asset_size, out_asset_output_file);
+    if (err)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "OpenAssetOutputFile(%p, %s, %" PRIu64 ", %p) failed with %d",
+            version_storage_api, full_asset_path, asset_size, out_asset_output_file,
+            err)
+        return err;
+    }
+    return 0;
+}
+
 int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "WritePartialAssetFromBlocks(%p, %u)",
@@ -4568,12 +6861,8 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
             }
             job->m_BlockReaderJobs[d].m_StoredBlock = 0;
         }
-        if (job->m_AssetOutputFile)
-        {
-            job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
-            job->m_AssetOutputFile = 0;
-        }
         job->m_Err = ECANCELED;
+        ReleasePartialAssetOutputFile(job);
         return 0;
     }
 
@@ -4608,44 +6897,22 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
             }
         }
 
-        if (job->m_AssetOutputFile)
-        {
-            job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
-            job->m_AssetOutputFile = 0;
-        }
         job->m_Err = block_reader_errors;
+        ReleasePartialAssetOutputFile(job);
         return 0;
     }
 
     uint32_t write_chunk_index_offset = job->m_AssetChunkIndexOffset;
     uint32_t write_chunk_count = job->m_AssetChunkCount;
-    uint32_t asset_chunk_count = job->m_VersionIndex->m_AssetChunkCounts[job->m_AssetIndex];
     const char* asset_path = &job->m_VersionIndex->m_NameData[job->m_VersionIndex->m_NameOffsets[job->m_AssetIndex]];
 
     if (!job->m_AssetOutputFile)
     {
         char* full_asset_path = job->m_VersionStorageAPI->ConcatPath(job->m_VersionStorageAPI, job->m_VersionFolder, asset_path);
-        int err = EnsureParentPathExists(job->m_VersionStorageAPI, full_asset_path);
-        if (err)
-        {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
-                context, job_id, is_cancelled,
-                err)
-            Longtail_Free(full_asset_path);
-            for (uint32_t d = 0; d < block_reader_job_count; ++d)
-            {
-                stored_block[d]->Dispose(stored_block[d]);
-                stored_block[d] = 0;
-            }
-            job->m_Err = err;
-            return 0;
-        }
         if (IsDirPath(full_asset_path))
         {
             LONGTAIL_FATAL_ASSERT(block_reader_job_count == 0, job->m_Err = EINVAL; return 0)
-            // Remove trailing forward slash
-            full_asset_path[strlen(full_asset_path) - 1] = '\0';
-            err = SafeCreateDir(job->m_VersionStorageAPI, full_asset_path);
+            int err = EnsureParentPathExists(job->m_VersionStorageAPI, full_asset_path);
             if (err)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
@@ -4655,58 +6922,32 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
                 job->m_Err = err;
                 return 0;
             }
-            Longtail_Free(full_asset_path);
-            job->m_Err = 0;
-            return 0;
-        }
-
-        uint16_t permissions;
-        err = job->m_VersionStorageAPI->GetPermissions(job->m_VersionStorageAPI, full_asset_path, &permissions);
-        if (err && (err != ENOENT))
-        {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
-                context, job_id, is_cancelled,
-                err)
-            Longtail_Free(full_asset_path);
-            for (uint32_t d = 0; d < block_reader_job_count; ++d)
-            {
-                stored_block[d]->Dispose(stored_block[d]);
-                stored_block[d] = 0;
-            }
-            job->m_Err = err;
-            return 0;
-        }
-
-        if (err != ENOENT)
-        {
-            if (!(permissions & Longtail_StorageAPI_UserWriteAccess))
+            // Remove trailing forward slash
+            full_asset_path[strlen(full_asset_path) - 1] = '\0';
+            err = SafeCreateDir(job->m_VersionStorageAPI, full_asset_path);
+            if (err)
             {
-                err = job->m_VersionStorageAPI->SetPermissions(job->m_VersionStorageAPI, full_asset_path, permissions | (Longtail_StorageAPI_UserWriteAccess));
-                if (err)
-                {
-                    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
-                        context, job_id, is_cancelled,
-                        err)
-                    Longtail_Free(full_asset_path);
-                    for (uint32_t d = 0; d < block_reader_job_count; ++d)
-                    {
-                        stored_block[d]->Dispose(stored_block[d]);
-                        stored_block[d] = 0;
-                    }
-                    job->m_Err = err;
-                    return 0;
-                }
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
+                    context, job_id, is_cancelled,
+                    err)
+                Longtail_Free(full_asset_path);
+                job->m_Err = err;
+                return 0;
             }
+            Longtail_Free(full_asset_path);
+            job->m_Err = 0;
+            return 0;
         }
 
         uint64_t asset_size = job->m_VersionIndex->m_AssetSizes[job->m_AssetIndex];
-        err = job->m_VersionStorageAPI->OpenWriteFile(job->m_VersionStorageAPI, full_asset_path, asset_size, &job->m_AssetOutputFile);
+        int err = OpenAssetOutputFile(job->m_VersionStorageAPI, full_asset_path, asset_size, &job->m_AssetOutputFile);
+        Longtail_Free(full_asset_path);
+        full_asset_path = 0;
         if (err)
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %d) failed with %d",
                 context, job_id, is_cancelled,
                 err)
-            Longtail_Free(full_asset_path);
             for (uint32_t d = 0; d < block_reader_job_count; ++d)
             {
                 stored_block[d]->Dispose(stored_block[d]);
@@ -4715,12 +6956,10 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
             job->m_Err = err;
             return 0;
         }
-        Longtail_Free(full_asset_path);
-        full_asset_path = 0;
     }
 
     Longtail_JobAPI_Jobs sync_write_job = 0;
-    if (write_chunk_index_offset + write_chunk_count < asset_chunk_count)
+    if (write_chunk_index_offset + write_chunk_count < job->m_AssetChunkIndexEnd)
     {
         int err = CreatePartialAssetWriteJob(
             job->m_BlockStoreAPI,
@@ -4735,7 +6974,10 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
             job->m_JobGroup,
             job,    // Reuse job
             write_chunk_index_offset + write_chunk_count,
+            job->m_AssetChunkIndexEnd,
+            job->m_MaxBlockCount,
             job->m_AssetOutputFile,
+            job->m_RangeDoneJob,
             &sync_write_job);
 
         if (err)
@@ -4783,14 +7025,13 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
             stored_block[d]->Dispose(stored_block[d]);
             stored_block[d] = 0;
         }
-        job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
-        job->m_AssetOutputFile = 0;
+        job->m_Err = ENOMEM;
+        ReleasePartialAssetOutputFile(job);
         if (sync_write_job)
         {
             int err = job->m_JobAPI->ReadyJobs(job->m_JobAPI, 1, sync_write_job);
             LONGTAIL_FATAL_ASSERT(err == 0, job->m_Err = EINVAL; return 0)
         }
-        job->m_Err = ENOMEM;
         return 0;
     }
     uint32_t* chunk_sizes = (uint32_t*)lookup_mem;
@@ -4831,14 +7072,13 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
                 stored_block[d]->Dispose(stored_block[d]);
                 stored_block[d] = 0;
             }
-            job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
-            job->m_AssetOutputFile = 0;
+            job->m_Err = EINVAL;
+            ReleasePartialAssetOutputFile(job);
             if (sync_write_job)
             {
                 int err = job->m_JobAPI->ReadyJobs(job->m_JobAPI, 1, sync_write_job);
                 LONGTAIL_FATAL_ASSERT(err == 0, job->m_Err = EINVAL; return 0)
             }
-            job->m_Err = EINVAL;
             Longtail_Free(lookup_mem);
             return 0;
         }
@@ -4848,22 +7088,23 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
         uint32_t block_index = block_indexes[*chunk_block_index];
         const char* block_data = (char*)stored_block[block_index]->m_BlockData;
 
+        uint64_t write_start_time = Longtail_GetMetricTime();
         int err = job->m_VersionStorageAPI->Write(job->m_VersionStorageAPI, job->m_AssetOutputFile, write_offset, chunk_size, &block_data[chunk_block_offset]);
+        Longtail_ObserveMetricTime(Longtail_Metric_FileWrite_Time, write_start_time);
+        Longtail_AddMetric(Longtail_Metric_FileWrite_ByteCount, chunk_size);
         if (err)
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WritePartialAssetFromBlocks(%p, %u, %p) job->m_VersionStorageAPI->Write(%p, %p, %" PRIu64 ", %" PRIu64 ", %p) failed with %d",
                 context, job_id, is_cancelled,
                 job->m_VersionStorageAPI, job->m_AssetOutputFile, write_offset, chunk_size, &block_data[chunk_block_offset],
                 err)
-            job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
-            job->m_AssetOutputFile = 0;
-
             for (uint32_t d = 0; d < block_reader_job_count; ++d)
             {
                 stored_block[d]->Dispose(stored_block[d]);
                 stored_block[d] = 0;
             }
             job->m_Err = err;
+            ReleasePartialAssetOutputFile(job);
             if (sync_write_job)
             {
                 int sync_err = job->m_JobAPI->ReadyJobs(job->m_JobAPI, 1, sync_write_job);
@@ -4890,11 +7131,18 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
         int err = job->m_JobAPI->ReadyJobs(job->m_JobAPI, 1, sync_write_job);
         if (err)
         {
-            job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
             job->m_Err = err;
+            ReleasePartialAssetOutputFile(job);
             return 0;
         }
+        // The next write job owns job->m_Err from here on
+        return 0;
+    }
+
+    if (job->m_RangeDoneJob)
+    {
         job->m_Err = 0;
+        ReleasePartialAssetOutputFile(job);
         return 0;
     }
 
@@ -4904,7 +7152,9 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
     if (job->m_RetainPermissions)
     {
         char* full_asset_path = job->m_VersionStorageAPI->ConcatPath(job->m_VersionStorageAPI, job->m_VersionFolder, asset_path);
+        uint64_t permissions_start_time = Longtail_GetMetricTime();
         int err = job->m_VersionStorageAPI->SetPermissions(job->m_VersionStorageAPI, full_asset_path, (uint16_t)job->m_VersionIndex->m_Permissions[job->m_AssetIndex]);
+        Longtail_ObserveMetricTime(Longtail_Metric_SetPermissions_Time, permissions_start_time);
         Longtail_Free(full_asset_path);
         full_asset_path = 0;
         if (err)
@@ -4921,6 +7171,68 @@ int WritePartialAssetFromBlocks(void* context, uint32_t job_id, int is_cancelled
     return 0;
 }
 
+struct FinalizeAssetRangesJob
+{
+    struct Longtail_StorageAPI* m_VersionStorageAPI;
+    const struct Longtail_VersionIndex* m_VersionIndex;
+    const char* m_VersionFolder;
+    uint32_t m_AssetIndex;
+    int m_RetainPermissions;
+    Longtail_StorageAPI_HOpenFile m_AssetOutputFile;
+    const struct WritePartialAssetFromBlocksJob* m_RangeJobs;
+    uint32_t m_RangeCount;
+    int m_Err;
+};
+
+// Runs when all ranges of an asset are written (or have failed), closes the shared file and applies permissions
+static int FinalizeAssetRanges(void* context, uint32_t job_id, int is_cancelled)
+{
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "FinalizeAssetRanges(%p, %u, %d)",
+        context, job_id, is_cancelled)
+    LONGTAIL_FATAL_ASSERT(context != 0, return EINVAL)
+    struct FinalizeAssetRangesJob* job = (struct FinalizeAssetRangesJob*)context;
+
+    job->m_VersionStorageAPI->CloseFile(job->m_VersionStorageAPI, job->m_AssetOutputFile);
+    job->m_AssetOutputFile = 0;
+
+    for (uint32_t r = 0; r < job->m_RangeCount; ++r)
+    {
+        if (job->m_RangeJobs[r].m_Err)
+        {
+            // The failing range job reports the error
+            job->m_Err = 0;
+            return 0;
+        }
+    }
+
+    if (is_cancelled)
+    {
+        job->m_Err = ECANCELED;
+        return 0;
+    }
+
+    if (job->m_RetainPermissions)
+    {
+        const char* asset_path = &job->m_VersionIndex->m_NameData[job->m_VersionIndex->m_NameOffsets[job->m_AssetIndex]];
+        char* full_asset_path = job->m_VersionStorageAPI->ConcatPath(job->m_VersionStorageAPI, job->m_VersionFolder, asset_path);
+        uint64_t permissions_start_time = Longtail_GetMetricTime();
+        int err = job->m_VersionStorageAPI->SetPermissions(job->m_VersionStorageAPI, full_asset_path, (uint16_t)job->m_VersionIndex->m_Permissions[job->m_AssetIndex]);
+        Longtail_ObserveMetricTime(Longtail_Metric_SetPermissions_Time, permissions_start_time);
+        Longtail_Free(full_asset_path);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "FinalizeAssetRanges(%p, %u, %d) failed with %d",
+                context, job_id, is_cancelled,
+                err)
+            job->m_Err = err;
+            return 0;
+        }
+    }
+
+    job->m_Err = 0;
+    return 0;
+}
+
 struct WriteAssetsFromBlockJob
 {
     struct Longtail_StorageAPI* m_VersionStorageAPI;
@@ -5099,7 +7411,10 @@ static int WriteAssetsFromBlock(void* context, uint32_t job_id, int is_cancelled
             uint32_t chunk_block_offset = chunk_offsets[*chunk_block_index];
             uint32_t chunk_size = chunk_sizes[*chunk_block_index];
 
+            uint64_t write_start_time = Longtail_GetMetricTime();
             err = version_storage_api->Write(version_storage_api, asset_file, asset_write_offset, chunk_size, &block_data[chunk_block_offset]);
+            Longtail_ObserveMetricTime(Longtail_Metric_FileWrite_Time, write_start_time);
+            Longtail_AddMetric(Longtail_Metric_FileWrite_ByteCount, chunk_size);
             if (err)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssetsFromBlock(%p, %u, %d) failed with %d",
@@ -5124,7 +7439,9 @@ static int WriteAssetsFromBlock(void* context, uint32_t job_id, int is_cancelled
 
         if (job->m_RetainPermissions)
         {
+            uint64_t permissions_start_time = Longtail_GetMetricTime();
             err = version_storage_api->SetPermissions(version_storage_api, full_asset_path, (uint16_t)version_index->m_Permissions[asset_index]);
+            Longtail_ObserveMetricTime(Longtail_Metric_SetPermissions_Time, permissions_start_time);
             Longtail_Free(full_asset_path);
             full_asset_path = 0;
             if (err)
@@ -5164,7 +7481,7 @@ struct BlockJobCompareContext
     const uint32_t* asset_chunk_index_starts;
     const uint32_t* asset_chunk_indexes;
     const TLongtail_Hash* chunk_hashes;
-    struct Longtail_LookupTable* chunk_hash_to_block_index;
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index;
 };
 
 static SORTFUNC(BlockJobCompare)
@@ -5174,7 +7491,7 @@ static SORTFUNC(BlockJobCompare)
     LONGTAIL_FATAL_ASSERT(b_ptr != 0, return 0)
 
     struct BlockJobCompareContext* c = (struct BlockJobCompareContext*)context;
-    struct Longtail_LookupTable* chunk_hash_to_block_index = c->chunk_hash_to_block_index;
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index = c->chunk_hash_to_block_index;
 
     uint32_t a = *(const uint32_t*)a_ptr;
     uint32_t b = *(const uint32_t*)b_ptr;
@@ -5190,9 +7507,9 @@ static SORTFUNC(BlockJobCompare)
 //    {
 //        return 0;
 //    }
-    const uint64_t* a_block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, a_first_chunk_hash);
+    const uint64_t* a_block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, a_first_chunk_hash);
     LONGTAIL_FATAL_ASSERT(a_block_index_ptr, return 0)
-    const uint64_t* b_block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, b_first_chunk_hash);
+    const uint64_t* b_block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, b_first_chunk_hash);
     LONGTAIL_FATAL_ASSERT(b_block_index_ptr, return 0)
     uint64_t a_block_index = *a_block_index_ptr;
     uint64_t b_block_index = *b_block_index_ptr;
@@ -5237,7 +7554,7 @@ static int BuildAssetWriteList(
     const uint32_t* asset_chunk_counts,
     const uint32_t* asset_chunk_index_starts,
     const uint32_t* asset_chunk_indexes,
-    struct Longtail_LookupTable* chunk_hash_to_block_index,
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index,
     struct AssetWriteList** out_asset_write_list)
 {
     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_DEBUG, "BuildAssetWriteList(%u, %p, %p, %s, %p, %p, %p, %p, %p, %p)",
@@ -5274,10 +7591,10 @@ static int BuildAssetWriteList(
         }
         uint32_t chunk_index = asset_chunk_indexes[asset_chunk_offset];
         TLongtail_Hash chunk_hash = chunk_hashes[chunk_index];
-        uint64_t* content_block_index = Longtail_LookupTable_Get(chunk_hash_to_block_index, chunk_hash);
+        const uint64_t* content_block_index = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, chunk_hash);
         if (content_block_index == 0)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BuildAssetWriteList(%u, %p, %p, %s, %p, %p, %p, %p, %p, %p) Longtail_LookupTable_Get(chunk_hash_to_block_index, chunk_hash) failed with %d",
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BuildAssetWriteList(%u, %p, %p, %s, %p, %p, %p, %p, %p, %p) ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, chunk_hash) failed with %d",
                 asset_count, optional_asset_indexes, name_offsets, name_data, chunk_hashes, asset_chunk_counts, asset_chunk_index_starts, asset_chunk_indexes, chunk_hash_to_block_index, out_asset_write_list,
                 ENOENT)
             Longtail_Free(awl);
@@ -5289,10 +7606,10 @@ static int BuildAssetWriteList(
         {
             uint32_t next_chunk_index = asset_chunk_indexes[asset_chunk_offset + c];
             TLongtail_Hash next_chunk_hash = chunk_hashes[next_chunk_index];
-            uint64_t* next_content_block_index = Longtail_LookupTable_Get(chunk_hash_to_block_index, next_chunk_hash);
+            const uint64_t* next_content_block_index = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, next_chunk_hash);
             if (next_content_block_index == 0)
             {
-                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BuildAssetWriteList(%u, %p, %p, %s, %p, %p, %p, %p, %p, %p) Longtail_LookupTable_Get(chunk_hash_to_block_index, next_chunk_hash) failed with %d",
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "BuildAssetWriteList(%u, %p, %p, %s, %p, %p, %p, %p, %p, %p) ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, next_chunk_hash) failed with %d",
                     asset_count, optional_asset_indexes, name_offsets, name_data, chunk_hashes, asset_chunk_counts, asset_chunk_index_starts, asset_chunk_indexes, chunk_hash_to_block_index, out_asset_write_list,
                     ENOENT)
                 Longtail_Free(awl);
@@ -5330,6 +7647,101 @@ static int BuildAssetWriteList(
     return 0;
 }
 
+// Huge assets that need more than one window of blocks are split into ranges that are
+// written concurrently to the same preallocated file. The window is divided between the ranges
+// so the blocks in memory for the asset stays the same as when it is written as one range
+#define MAX_RANGES_PER_PARTIAL_ASSET_WRITE  8u
+
+// Finds the end of the window of an asset that CreatePartialAssetWriteJob will produce starting at asset_chunk_index_offset
+static int GetPartialAssetWriteWindow(
+    const struct Longtail_ContentIndex* content_index,
+    const struct Longtail_VersionIndex* version_index,
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index,
+    uint32_t asset_index,
+    uint32_t asset_chunk_index_offset,
+    uint32_t max_block_count,
+    uint32_t* out_asset_chunk_index_window_end,
+    uint32_t* out_block_count)
+{
+    uint32_t chunk_index_start = version_index->m_AssetChunkIndexStarts[asset_index];
+    uint32_t chunk_index_end = chunk_index_start + version_index->m_AssetChunkCounts[asset_index];
+    uint32_t chunk_index_offset = chunk_index_start + asset_chunk_index_offset;
+
+    uint32_t block_count = 0;
+    TLongtail_Hash block_hashes[MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE];
+    while (chunk_index_offset != chunk_index_end && block_count < max_block_count)
+    {
+        uint32_t chunk_index = version_index->m_AssetChunkIndexes[chunk_index_offset];
+        TLongtail_Hash chunk_hash = version_index->m_ChunkHashes[chunk_index];
+        const uint64_t* block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, chunk_hash);
+        LONGTAIL_FATAL_ASSERT(block_index_ptr, return EINVAL)
+        TLongtail_Hash block_hash = content_index->m_BlockHashes[*block_index_ptr];
+        int has_block = 0;
+        for (uint32_t d = 0; d < block_count; ++d)
+        {
+            if (block_hashes[d] == block_hash)
+            {
+                has_block = 1;
+                break;
+            }
+        }
+        if (!has_block)
+        {
+            block_hashes[block_count++] = block_hash;
+        }
+        ++chunk_index_offset;
+    }
+    *out_asset_chunk_index_window_end = chunk_index_offset - chunk_index_start;
+    *out_block_count = block_count;
+    return 0;
+}
+
+// Finds the end of each window of an asset when written with max_block_count blocks per window,
+// out_window_ends must have room for one entry per chunk of the asset
+static int GetPartialAssetWriteWindows(
+    const struct Longtail_ContentIndex* content_index,
+    const struct Longtail_VersionIndex* version_index,
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index,
+    uint32_t asset_index,
+    uint32_t max_block_count,
+    uint32_t* out_window_ends,
+    uint32_t* out_window_count,
+    uint32_t* out_block_count)
+{
+    uint32_t chunk_count = version_index->m_AssetChunkCounts[asset_index];
+    uint32_t window_count = 0;
+    uint32_t block_count = 0;
+    uint32_t asset_chunk_index_offset = 0;
+    while (asset_chunk_index_offset != chunk_count)
+    {
+        uint32_t window_block_count = 0;
+        int err = GetPartialAssetWriteWindow(content_index, version_index, chunk_hash_to_block_index, asset_index, asset_chunk_index_offset, max_block_count, &asset_chunk_index_offset, &window_block_count);
+        if (err)
+        {
+            return err;
+        }
+        out_window_ends[window_count++] = asset_chunk_index_offset;
+        block_count += window_block_count;
+    }
+    *out_window_count = window_count;
+    *out_block_count = block_count;
+    return 0;
+}
+
+static uint32_t GetPartialAssetWriteRangeCount(uint32_t window_count, uint32_t worker_count)
+{
+    uint32_t range_count = window_count < worker_count ? window_count : worker_count;
+    return range_count < MAX_RANGES_PER_PARTIAL_ASSET_WRITE ? range_count : MAX_RANGES_PER_PARTIAL_ASSET_WRITE;
+}
+
+struct PartialAssetWritePlan
+{
+    uint32_t m_WindowEndsOffset;
+    uint32_t m_WindowCount;
+    uint32_t m_RangeCount;
+    uint32_t m_MaxBlockCount;
+};
+
 static int WriteAssets(
     struct Longtail_BlockStoreAPI* block_store_api,
     struct Longtail_StorageAPI* version_storage_api,
@@ -5340,7 +7752,7 @@ static int WriteAssets(
     const struct Longtail_ContentIndex* content_index,
     const struct Longtail_VersionIndex* version_index,
     const char* version_path,
-    struct Longtail_LookupTable* chunk_hash_to_block_index,
+    const struct ChunkBlockIndexLookup* chunk_hash_to_block_index,
     struct AssetWriteList* awl,
     int retain_permssions)
 {
@@ -5361,7 +7773,7 @@ static int WriteAssets(
         {
             uint32_t asset_index = awl->m_BlockJobAssetIndexes[j];
             TLongtail_Hash first_chunk_hash = version_index->m_ChunkHashes[version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[asset_index]]];
-            const uint64_t* block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, first_chunk_hash);
+            const uint64_t* block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, first_chunk_hash);
             if (!block_index_ptr)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
@@ -5378,7 +7790,7 @@ static int WriteAssets(
             {
                 uint32_t asset_index = awl->m_BlockJobAssetIndexes[j];
                 TLongtail_Hash first_chunk_hash = version_index->m_ChunkHashes[version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[asset_index]]];
-                const uint64_t* next_block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, first_chunk_hash);
+                const uint64_t* next_block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, first_chunk_hash);
                 if (!next_block_index_ptr)
                 {
                     LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
@@ -5399,51 +7811,71 @@ static int WriteAssets(
     const uint32_t worker_count = job_api->GetWorkerCount(job_api) + 1;
     const uint32_t max_parallell_block_read_jobs = worker_count < MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE ? worker_count : MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE;
 
+    uint32_t window_end_count = 0;
+    for (uint32_t a = 0; a < awl->m_AssetJobCount; ++a)
+    {
+        window_end_count += version_index->m_AssetChunkCounts[awl->m_AssetIndexJobs[a]];
+    }
+    size_t asset_plans_size = sizeof(struct PartialAssetWritePlan) * awl->m_AssetJobCount;
+    size_t window_ends_size = sizeof(uint32_t) * window_end_count;
+    struct PartialAssetWritePlan* asset_plans = (struct PartialAssetWritePlan*)Longtail_Alloc(asset_plans_size + window_ends_size);
+    if (!asset_plans)
+    {
+        LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
+            block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
+            ENOMEM)
+        return ENOMEM;
+    }
+    uint32_t* window_ends = (uint32_t*)(void*)&asset_plans[awl->m_AssetJobCount];
+
     uint32_t asset_job_count = 0;
+    uint32_t range_job_count = 0;
+    uint32_t ranged_asset_count = 0;
+    uint32_t window_ends_offset = 0;
     for (uint32_t a = 0; a < awl->m_AssetJobCount; ++a)
     {
         uint32_t asset_index = awl->m_AssetIndexJobs[a];
-        uint32_t chunk_index_start = version_index->m_AssetChunkIndexStarts[asset_index];
         uint32_t chunk_count = version_index->m_AssetChunkCounts[asset_index];
+        struct PartialAssetWritePlan* plan = &asset_plans[a];
+        plan->m_WindowEndsOffset = window_ends_offset;
+        plan->m_WindowCount = 0;
+        plan->m_RangeCount = 1;
+        plan->m_MaxBlockCount = max_parallell_block_read_jobs;
+        window_ends_offset += chunk_count;
         if (chunk_count == 0)
         {
             asset_job_count += 1;   // Write job
+            range_job_count += 1;
             continue;
         }
 
-        uint32_t chunk_index_end = chunk_index_start + chunk_count;
-        uint32_t chunk_index_offset = chunk_index_start;
-
-        while(chunk_index_offset != chunk_index_end)
+        uint32_t* asset_window_ends = &window_ends[plan->m_WindowEndsOffset];
+        uint32_t block_read_job_count = 0;
+        int err = GetPartialAssetWriteWindows(content_index, version_index, chunk_hash_to_block_index, asset_index, plan->m_MaxBlockCount, asset_window_ends, &plan->m_WindowCount, &block_read_job_count);
+        plan->m_RangeCount = GetPartialAssetWriteRangeCount(plan->m_WindowCount, worker_count);
+        if (!err && plan->m_RangeCount > 1)
         {
-            uint32_t block_read_job_count = 0;
-            TLongtail_Hash block_hashes[MAX_BLOCKS_PER_PARTIAL_ASSET_WRITE];
-            while (chunk_index_offset != chunk_index_end && block_read_job_count < max_parallell_block_read_jobs)
-            {
-                uint32_t chunk_index = version_index->m_AssetChunkIndexes[chunk_index_offset];
-                TLongtail_Hash chunk_hash = version_index->m_ChunkHashes[chunk_index];
-                const uint64_t* block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, chunk_hash);
-                LONGTAIL_FATAL_ASSERT(block_index_ptr, return EINVAL)
-                uint64_t block_index = *block_index_ptr;
-                TLongtail_Hash block_hash = content_index->m_BlockHashes[block_index];
-                int has_block = 0;
-                for (uint32_t d = 0; d < block_read_job_count; ++d)
-                {
-                    if (block_hashes[d] == block_hash)
-                    {
-                        has_block = 1;
-                        break;
-                    }
-                }
-                if (!has_block)
-                {
-                    block_hashes[block_read_job_count++] = block_hash;
-                }
-                ++chunk_index_offset;
-            }
-            asset_job_count += 1;   // Write job
-            asset_job_count += 1;   // Sync job
-            asset_job_count += block_read_job_count;
+            // The ranges share the window of a single writer so splitting the asset does not raise the number of blocks in flight
+            plan->m_MaxBlockCount = max_parallell_block_read_jobs / plan->m_RangeCount;
+            err = GetPartialAssetWriteWindows(content_index, version_index, chunk_hash_to_block_index, asset_index, plan->m_MaxBlockCount, asset_window_ends, &plan->m_WindowCount, &block_read_job_count);
+        }
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
+                block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
+                err)
+            Longtail_Free(asset_plans);
+            return err;
+        }
+        asset_job_count += plan->m_WindowCount;  // Write jobs
+        asset_job_count += plan->m_WindowCount;  // Sync jobs
+        asset_job_count += block_read_job_count;
+        range_job_count += plan->m_RangeCount;
+        if (plan->m_RangeCount > 1)
+        {
+            asset_job_count += plan->m_RangeCount;  // Range done sync jobs
+            asset_job_count += 1;   // Finalize job
+            ++ranged_asset_count;
         }
     }
 
@@ -5453,6 +7885,7 @@ static int WriteAssets(
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
             block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
             err)
+        Longtail_Free(asset_plans);
         return err;
     }
 
@@ -5461,6 +7894,7 @@ static int WriteAssets(
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_INFO, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
             block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
             ECANCELED)
+        Longtail_Free(asset_plans);
         return ECANCELED;
     }
 
@@ -5470,6 +7904,7 @@ static int WriteAssets(
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
             block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
             ENOMEM)
+        Longtail_Free(asset_plans);
         return ENOMEM;
     }
 
@@ -5481,6 +7916,7 @@ static int WriteAssets(
             block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
             err)
         Longtail_Free(block_jobs);
+        Longtail_Free(asset_plans);
         return err;
     }
 
@@ -5490,7 +7926,7 @@ static int WriteAssets(
     {
         uint32_t asset_index = awl->m_BlockJobAssetIndexes[j];
         TLongtail_Hash first_chunk_hash = version_index->m_ChunkHashes[version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[asset_index]]];
-        const uint64_t* block_index_ptr = Longtail_LookupTable_Get(chunk_hash_to_block_index, first_chunk_hash);
+        const uint64_t* block_index_ptr = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, first_chunk_hash);
         LONGTAIL_FATAL_ASSERT(block_index_ptr, return EINVAL)
         uint64_t block_index = *block_index_ptr;
 
@@ -5507,7 +7943,7 @@ static int WriteAssets(
         Longtail_JobAPI_JobFunc block_read_funcs[1] = { BlockReader };
         void* block_read_ctxs[1] = {block_job};
         Longtail_JobAPI_Jobs block_read_job;
-        err = job_api->CreateJobs(job_api, job_group, 1, block_read_funcs, block_read_ctxs, &block_read_job);
+        err = job_api->CreateJobs(job_api, job_group, 1, block_read_funcs, block_read_ctxs, LONGTAIL_JOB_CLASS_IO, &block_read_job);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
 
         job->m_VersionStorageAPI = version_storage_api;
@@ -5525,7 +7961,7 @@ static int WriteAssets(
         {
             uint32_t next_asset_index = awl->m_BlockJobAssetIndexes[j];
             TLongtail_Hash next_first_chunk_hash = version_index->m_ChunkHashes[version_index->m_AssetChunkIndexes[version_index->m_AssetChunkIndexStarts[next_asset_index]]];
-            uint64_t* next_block_index = Longtail_LookupTable_Get(chunk_hash_to_block_index, next_first_chunk_hash);
+            const uint64_t* next_block_index = ChunkBlockIndexLookup_Get(chunk_hash_to_block_index, next_first_chunk_hash);
             LONGTAIL_FATAL_ASSERT(next_block_index != 0, return EINVAL)
             if (block_index != *next_block_index)
             {
@@ -5540,7 +7976,7 @@ static int WriteAssets(
         void* ctx[1] = { job };
 
         Longtail_JobAPI_Jobs block_write_job;
-        err = job_api->CreateJobs(job_api, job_group, 1, func, ctx, &block_write_job);
+        err = job_api->CreateJobs(job_api, job_group, 1, func, ctx, LONGTAIL_JOB_CLASS_IO, &block_write_job);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
         err = job_api->AddDependecies(job_api, 1, block_write_job, 1, block_read_job);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
@@ -5577,45 +8013,139 @@ Write Task Execute (When block_reador Tasks [block_readorCount] and WriteSync Ta
         Ready WriteSync Task
 */
 
-    size_t asset_jobs_size = sizeof(struct WritePartialAssetFromBlocksJob) * awl->m_AssetJobCount;
-    struct WritePartialAssetFromBlocksJob* asset_jobs = (struct WritePartialAssetFromBlocksJob*)Longtail_Alloc(asset_jobs_size);
+    size_t asset_jobs_size = sizeof(struct WritePartialAssetFromBlocksJob) * range_job_count;
+    size_t finalize_jobs_size = sizeof(struct FinalizeAssetRangesJob) * ranged_asset_count;
+    struct WritePartialAssetFromBlocksJob* asset_jobs = (struct WritePartialAssetFromBlocksJob*)Longtail_Alloc(asset_jobs_size + finalize_jobs_size);
     if (!asset_jobs)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
             block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
             ENOMEM)
         Longtail_Free(block_jobs);
+        Longtail_Free(asset_plans);
         return ENOMEM;
     }
+    struct FinalizeAssetRangesJob* finalize_jobs = (struct FinalizeAssetRangesJob*)&asset_jobs[range_job_count];
+    uint32_t asset_job_index = 0;
+    uint32_t finalize_job_index = 0;
     for (uint32_t a = 0; a < awl->m_AssetJobCount; ++a)
     {
-        Longtail_JobAPI_Jobs write_sync_job;
-        err = CreatePartialAssetWriteJob(
-            block_store_api,
-            version_storage_api,
-            job_api,
-            content_index,
-            version_index,
-            version_path,
-            chunk_hash_to_block_index,
-            awl->m_AssetIndexJobs[a],
-            retain_permssions,
-            job_group,
-            &asset_jobs[a],
-            0,
-            (Longtail_StorageAPI_HOpenFile)0,
-            &write_sync_job);
+        uint32_t asset_index = awl->m_AssetIndexJobs[a];
+        uint32_t chunk_count = version_index->m_AssetChunkCounts[asset_index];
+        const struct PartialAssetWritePlan* plan = &asset_plans[a];
+        uint32_t range_count = plan->m_RangeCount;
+
+        if (range_count < 2)
+        {
+            Longtail_JobAPI_Jobs write_sync_job;
+            err = CreatePartialAssetWriteJob(
+                block_store_api,
+                version_storage_api,
+                job_api,
+                content_index,
+                version_index,
+                version_path,
+                chunk_hash_to_block_index,
+                asset_index,
+                retain_permssions,
+                job_group,
+                &asset_jobs[asset_job_index++],
+                0,
+                chunk_count,
+                plan->m_MaxBlockCount,
+                (Longtail_StorageAPI_HOpenFile)0,
+                0,
+                &write_sync_job);
+            if (err)
+            {
+                LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
+                    block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
+                    err)
+                Longtail_Free(asset_jobs);
+                Longtail_Free(block_jobs);
+                Longtail_Free(asset_plans);
+                return err;
+            }
+            err = job_api->ReadyJobs(job_api, 1, write_sync_job);
+            LONGTAIL_FATAL_ASSERT(err == 0, return err)
+            continue;
+        }
+
+        struct FinalizeAssetRangesJob* finalize_job = &finalize_jobs[finalize_job_index++];
+        finalize_job->m_VersionStorageAPI = version_storage_api;
+        finalize_job->m_VersionIndex = version_index;
+        finalize_job->m_VersionFolder = version_path;
+        finalize_job->m_AssetIndex = asset_index;
+        finalize_job->m_RetainPermissions = retain_permssions;
+        finalize_job->m_AssetOutputFile = 0;
+        finalize_job->m_RangeJobs = &asset_jobs[asset_job_index];
+        finalize_job->m_RangeCount = 0;
+        finalize_job->m_Err = EINVAL;
+
+        // Open and size the file up front so the ranges can write to it in any order
+        const char* asset_path = &version_index->m_NameData[version_index->m_NameOffsets[asset_index]];
+        char* full_asset_path = version_storage_api->ConcatPath(version_storage_api, version_path, asset_path);
+        err = OpenAssetOutputFile(version_storage_api, full_asset_path, version_index->m_AssetSizes[asset_index], &finalize_job->m_AssetOutputFile);
+        Longtail_Free(full_asset_path);
         if (err)
         {
-            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
-                block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
-                err)
-            Longtail_Free(asset_jobs);
-            Longtail_Free(block_jobs);
-            return err;
+            finalize_job->m_Err = err;
+            continue;
         }
-        err = job_api->ReadyJobs(job_api, 1, write_sync_job);
+
+        Longtail_JobAPI_JobFunc finalize_funcs[1] = { FinalizeAssetRanges };
+        void* finalize_ctxs[1] = { finalize_job };
+        Longtail_JobAPI_Jobs finalize_job_id;
+        err = job_api->CreateJobs(job_api, job_group, 1, finalize_funcs, finalize_ctxs, LONGTAIL_JOB_CLASS_IO, &finalize_job_id);
         LONGTAIL_FATAL_ASSERT(err == 0, return err)
+
+        // All range done jobs must be dependencies of the finalize job before any range can complete
+        Longtail_JobAPI_Jobs range_done_jobs[MAX_RANGES_PER_PARTIAL_ASSET_WRITE];
+        for (uint32_t r = 0; r < range_count; ++r)
+        {
+            Longtail_JobAPI_JobFunc range_done_funcs[1] = { WriteReady };
+            void* range_done_ctxs[1] = { 0 };
+            err = job_api->CreateJobs(job_api, job_group, 1, range_done_funcs, range_done_ctxs, LONGTAIL_JOB_CLASS_IO, &range_done_jobs[r]);
+            LONGTAIL_FATAL_ASSERT(err == 0, return err)
+            err = job_api->AddDependecies(job_api, 1, finalize_job_id, 1, range_done_jobs[r]);
+            LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        }
+
+        Longtail_JobAPI_Jobs range_sync_jobs[MAX_RANGES_PER_PARTIAL_ASSET_WRITE];
+        const uint32_t* asset_window_ends = &window_ends[plan->m_WindowEndsOffset];
+        uint32_t asset_chunk_index_offset = 0;
+        for (uint32_t r = 0; r < range_count; ++r)
+        {
+            uint32_t range_chunk_index_offset = asset_chunk_index_offset;
+            uint32_t range_window_end = (uint32_t)(((uint64_t)plan->m_WindowCount * (r + 1)) / range_count);
+            asset_chunk_index_offset = asset_window_ends[range_window_end - 1];
+            err = CreatePartialAssetWriteJob(
+                block_store_api,
+                version_storage_api,
+                job_api,
+                content_index,
+                version_index,
+                version_path,
+                chunk_hash_to_block_index,
+                asset_index,
+                retain_permssions,
+                job_group,
+                &asset_jobs[asset_job_index++],
+                range_chunk_index_offset,
+                asset_chunk_index_offset,
+                plan->m_MaxBlockCount,
+                finalize_job->m_AssetOutputFile,
+                range_done_jobs[r],
+                &range_sync_jobs[r]);
+            LONGTAIL_FATAL_ASSERT(err == 0, return err)
+            ++finalize_job->m_RangeCount;
+        }
+
+        for (uint32_t r = 0; r < range_count; ++r)
+        {
+            err = job_api->ReadyJobs(job_api, 1, range_sync_jobs[r]);
+            LONGTAIL_FATAL_ASSERT(err == 0, return err)
+        }
     }
 
     err = job_api->WaitForAllJobs(job_api, job_group, progress_api, optional_cancel_api, optional_cancel_token);
@@ -5626,6 +8156,7 @@ Write Task Execute (When block_reador Tasks [block_readorCount] and WriteSync Ta
             err)
         Longtail_Free(asset_jobs);
         Longtail_Free(block_jobs);
+        Longtail_Free(asset_plans);
         return err;
     }
 
@@ -5641,7 +8172,7 @@ Write Task Execute (When block_reador Tasks [block_readorCount] and WriteSync Ta
             err = err ? err : job->m_Err;
         }
     }
-    for (uint32_t a = 0; a < awl->m_AssetJobCount; ++a)
+    for (uint32_t a = 0; a < asset_job_index; ++a)
     {
         struct WritePartialAssetFromBlocksJob* job = &asset_jobs[a];
         if (job->m_Err)
@@ -5661,8 +8192,24 @@ Write Task Execute (When block_reador Tasks [block_readorCount] and WriteSync Ta
         }
     }
 
+    for (uint32_t f = 0; f < finalize_job_index; ++f)
+    {
+        struct FinalizeAssetRangesJob* job = &finalize_jobs[f];
+        if (job->m_Err)
+        {
+            LONGTAIL_LOG((job->m_Err == ECANCELED) ? LONGTAIL_LOG_LEVEL_INFO : LONGTAIL_LOG_LEVEL_ERROR, "WriteAssets(%p, %p, %p, %p, %p, %p, %p, %p, %s, %p, %p, %d) failed with %d",
+                block_store_api, version_storage_api, job_api, progress_api, optional_cancel_api, optional_cancel_token, content_index, version_index, version_path, chunk_hash_to_block_index, awl, retain_permssions,
+                job->m_Err)
+            if (err == 0)
+            {
+                err = job->m_Err;
+            }
+        }
+    }
+
     Longtail_Free(asset_jobs);
     Longtail_Free(block_jobs);
+    Longtail_Free(asset_plans);
 
     return err;
 }
@@ -5693,8 +8240,7 @@ int Longtail_WriteVersion(
         return 0;
     }
 
-    uint64_t chunk_count = *content_index->m_ChunkCount;
-    struct Longtail_LookupTable* chunk_hash_to_block_index = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(chunk_count)), chunk_count, 0);
+    struct ChunkBlockIndexLookup* chunk_hash_to_block_index = CreateChunkBlockIndexLookup(content_index);
     if (!chunk_hash_to_block_index)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_WriteVersion(%p, %p, %p, %p, %p, %p, %p, %p, %s, %u) failed with %d",
@@ -5702,12 +8248,6 @@ int Longtail_WriteVersion(
             ENOMEM)
         return ENOMEM;
     }
-    for (uint64_t i = 0; i < chunk_count; ++i)
-    {
-        TLongtail_Hash chunk_hash = content_index->m_ChunkHashes[i];
-        uint64_t block_index = content_index->m_ChunkBlockIndexes[i];
-        Longtail_LookupTable_PutUnique(chunk_hash_to_block_index, chunk_hash, block_index);
-    }
 
     uint32_t asset_count = *version_index->m_AssetCount;
 
@@ -5790,9 +8330,11 @@ static uint64_t MakeUnique(TLongtail_Hash* hashes, uint64_t count)
     return w;
 }
 
+// If reference_hashes_sorted is non-zero reference_hashes are already sorted and used in place, they may contain duplicates
 static int DiffHashes(
     const TLongtail_Hash* reference_hashes,
     uint64_t reference_hash_count,
+    int reference_hashes_sorted,
     const TLongtail_Hash* new_hashes,
     uint64_t new_hash_count,
     uint64_t* added_hash_count,
@@ -5808,7 +8350,7 @@ static int DiffHashes(
     LONGTAIL_FATAL_ASSERT(added_hashes != 0, return EINVAL)
     LONGTAIL_FATAL_ASSERT((removed_hash_count == 0 && removed_hashes == 0) || (removed_hash_count != 0 && removed_hashes != 0), return EINVAL)
 
-    size_t work_mem_size = (sizeof(TLongtail_Hash) * reference_hash_count) +
+    size_t work_mem_size = (reference_hashes_sorted ? 0 : (sizeof(TLongtail_Hash) * reference_hash_count)) +
         (sizeof(TLongtail_Hash) * new_hash_count);
     void* work_mem = Longtail_Alloc(work_mem_size);
     if (!work_mem)
@@ -5819,15 +8361,18 @@ static int DiffHashes(
         return ENOMEM;
     }
 
-    TLongtail_Hash* tmp_refs = (TLongtail_Hash*)work_mem;
-    TLongtail_Hash* tmp_news = (TLongtail_Hash*)&tmp_refs[reference_hash_count];
+    TLongtail_Hash* tmp_news = (TLongtail_Hash*)work_mem;
+    const TLongtail_Hash* refs = reference_hashes;
+    if (!reference_hashes_sorted)
+    {
+        TLongtail_Hash* tmp_refs = &tmp_news[new_hash_count];
+        memmove(tmp_refs, reference_hashes, (size_t)(sizeof(TLongtail_Hash) * reference_hash_count));
+        qsort(&tmp_refs[0], (size_t)reference_hash_count, sizeof(TLongtail_Hash), CompareHash);
+        reference_hash_count = MakeUnique(&tmp_refs[0], reference_hash_count);
+        refs = tmp_refs;
+    }
 
-    memmove(tmp_refs, reference_hashes, (size_t)(sizeof(TLongtail_Hash) * reference_hash_count));
     memmove(tmp_news, new_hashes, (size_t)(sizeof(TLongtail_Hash) * new_hash_count));
-
-    qsort(&tmp_refs[0], (size_t)reference_hash_count, sizeof(TLongtail_Hash), CompareHash);
-    reference_hash_count = MakeUnique(&tmp_refs[0], reference_hash_count);
-
     qsort(&tmp_news[0], (size_t)new_hash_count, sizeof(TLongtail_Hash), CompareHash);
     new_hash_count = MakeUnique(&tmp_news[0], new_hash_count);
 
@@ -5837,25 +8382,28 @@ static int DiffHashes(
     uint64_t ri = 0;
     while (ri < reference_hash_count && ni < new_hash_count)
     {
-        if (tmp_refs[ri] == tmp_news[ni])
+        if (refs[ri] == tmp_news[ni])
         {
             ++ri;
             ++ni;
-            continue;
         }
-        else if (tmp_refs[ri] < tmp_news[ni])
+        else if (refs[ri] < tmp_news[ni])
         {
             if (removed_hashes)
             {
-                removed_hashes[removed] = tmp_refs[ri];
+                removed_hashes[removed] = refs[ri];
             }
             ++removed;
             ++ri;
         }
-        else if (tmp_refs[ri] > tmp_news[ni])
+        else
         {
             added_hashes[added++] = tmp_news[ni++];
         }
+        while (ri > 0 && ri < reference_hash_count && refs[ri - 1] == refs[ri])
+        {
+            ++ri;
+        }
     }
     while (ni < new_hash_count)
     {
@@ -5866,10 +8414,14 @@ static int DiffHashes(
     {
         if (removed_hashes)
         {
-            removed_hashes[removed] = tmp_refs[ri];
+            removed_hashes[removed] = refs[ri];
         }
         ++removed;
         ++ri;
+        while (ri < reference_hash_count && refs[ri - 1] == refs[ri])
+        {
+            ++ri;
+        }
     }
     if (removed_hash_count)
     {
@@ -5938,9 +8490,11 @@ int Longtail_CreateMissingContent(
     }
 
     uint64_t added_hash_count = 0;
+    int reference_sorted = content_index->m_SortedChunkHashes != 0;
     int err = DiffHashes(
-        content_index->m_ChunkHashes,
+        reference_sorted ? content_index->m_SortedChunkHashes : content_index->m_ChunkHashes,
         *content_index->m_ChunkCount,
+        reference_sorted,
         version_index->m_ChunkHashes,
         chunk_count,
         &added_hash_count,
@@ -6001,13 +8555,18 @@ int Longtail_CreateMissingContent(
         Longtail_LookupTable_Put(chunk_index_lookup, version_index->m_ChunkHashes[i], i);
     }
 
-    for (uint32_t j = 0; j < added_hash_count; ++j)
+    for (uint32_t j = 0; j < added_hash_count; j += LONGTAIL_LOOKUP_TABLE_BATCH_SIZE)
     {
-        const uint64_t* chunk_index_ptr = Longtail_LookupTable_Get(chunk_index_lookup, added_hashes[j]);
-        LONGTAIL_FATAL_ASSERT(chunk_index_ptr, return EINVAL)
-        uint64_t chunk_index = *chunk_index_ptr;
-        tmp_diff_chunk_sizes[j] = version_index->m_ChunkSizes[chunk_index];
-        tmp_diff_chunk_tags[j] = version_index->m_ChunkTags[chunk_index];
+        uint64_t* chunk_index_ptrs[LONGTAIL_LOOKUP_TABLE_BATCH_SIZE];
+        uint32_t batch_count = added_hash_count - j < LONGTAIL_LOOKUP_TABLE_BATCH_SIZE ? added_hash_count - j : LONGTAIL_LOOKUP_TABLE_BATCH_SIZE;
+        Longtail_LookupTable_GetBatch(chunk_index_lookup, batch_count, &added_hashes[j], chunk_index_ptrs);
+        for (uint32_t b = 0; b < batch_count; ++b)
+        {
+            LONGTAIL_FATAL_ASSERT(chunk_index_ptrs[b], return EINVAL)
+            uint64_t chunk_index = *chunk_index_ptrs[b];
+            tmp_diff_chunk_sizes[j + b] = version_index->m_ChunkSizes[chunk_index];
+            tmp_diff_chunk_tags[j + b] = version_index->m_ChunkTags[chunk_index];
+        }
     }
     Longtail_Free(chunk_index_lookup);
     chunk_index_lookup = 0;
@@ -6051,8 +8610,7 @@ LONGTAIL_EXPORT int Longtail_GetMissingContent(
     // Go through all chunks in content_index, if there is a chunk that is not in reference_content_index
     // add that block to out_content_index
 
-    uint64_t reference_chunk_count = *reference_content_index->m_ChunkCount;
-    struct Longtail_LookupTable* chunk_to_reference_block_index_lookup = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(reference_chunk_count)), reference_chunk_count, 0);
+    struct ChunkBlockIndexLookup* chunk_to_reference_block_index_lookup = CreateChunkBlockIndexLookup(reference_content_index);
     if (!chunk_to_reference_block_index_lookup)
     {
         LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_GetMissingContent(%p, %u, %p, %p) failed with %d",
@@ -6060,12 +8618,6 @@ LONGTAIL_EXPORT int Longtail_GetMissingContent(
             ENOMEM)
         return ENOMEM;
     }
-    for (uint64_t c = 0; c < reference_chunk_count; ++c)
-    {
-        TLongtail_Hash chunk_hash = reference_content_index->m_ChunkHashes[c];
-        uint64_t block_index = reference_content_index->m_ChunkBlockIndexes[c];
-        Longtail_LookupTable_Put(chunk_to_reference_block_index_lookup, chunk_hash, block_index);
-    }
 
     size_t missing_blocks_indexes_size = sizeof(uint64_t) * (*content_index->m_BlockCount);
     uint64_t* missing_blocks_indexes = (uint64_t*)Longtail_Alloc(missing_blocks_indexes_size);
@@ -6095,7 +8647,7 @@ LONGTAIL_EXPORT int Longtail_GetMissingContent(
     for (uint64_t c = 0; c < content_index_chunk_count; ++c)
     {
         TLongtail_Hash chunk_hash = content_index->m_ChunkHashes[c];
-        if (Longtail_LookupTable_Get(chunk_to_reference_block_index_lookup, chunk_hash) != 0)
+        if (ChunkBlockIndexLookup_Get(chunk_to_reference_block_index_lookup, chunk_hash) != 0)
         {
             continue;
         }
@@ -6299,7 +8851,8 @@ int Longtail_RetargetContent(
     }
     Longtail_Free(added_chunk_hashes);
 
-    size_t content_index_size = Longtail_GetContentIndexSize(block_count, chunk_count);
+    int sorted = reference_content_index->m_SortedChunkHashes != 0;
+    size_t content_index_size = Longtail_GetContentIndexSize(block_count, chunk_count) + (sorted ? GetSortedChunksDataSize(chunk_count) : 0);
     struct Longtail_ContentIndex* resulting_content_index = (struct Longtail_ContentIndex*)Longtail_Alloc(content_index_size);
     if (!resulting_content_index)
     {
@@ -6340,6 +8893,19 @@ int Longtail_RetargetContent(
     Longtail_Free(keep_blocks_lookup);
     Longtail_Free(chunk_to_requested_block_index_lookup);
 
+    if (sorted)
+    {
+        err = AddSortedChunkColumns(resulting_content_index);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_RetargetContent(%p, %p, %p) failed with %d",
+                reference_content_index, requested_content_index, out_content_index,
+                err)
+            Longtail_Free(resulting_content_index);
+            return err;
+        }
+    }
+
     *out_content_index = resulting_content_index;
 
     return 0;
@@ -6473,7 +9039,7 @@ int Longtail_MergeContentIndex(
         job_api->ReserveJobs(job_api, 2, &job_group);
 
         Longtail_JobAPI_Jobs jobs;
-        job_api->CreateJobs(job_api, job_group, 2, funcs, ctxs, &jobs);
+        job_api->CreateJobs(job_api, job_group, 2, funcs, ctxs, LONGTAIL_JOB_CLASS_CPU, &jobs);
         job_api->ReadyJobs(job_api, 2, jobs);
         job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0);
     }
@@ -6517,7 +9083,7 @@ int Longtail_MergeContentIndex(
             chunk_job_start += chunks_per_job;
         }
         Longtail_JobAPI_Jobs runjobs;
-        job_api->CreateJobs(job_api, job_group, job_count, funcs, ctxs, &runjobs);
+        job_api->CreateJobs(job_api, job_group, job_count, funcs, ctxs, LONGTAIL_JOB_CLASS_CPU, &runjobs);
         job_api->ReadyJobs(job_api, job_count, runjobs);
 
         job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0);
@@ -6549,7 +9115,8 @@ int Longtail_MergeContentIndex(
         Longtail_Free(chunk_block_indexes);
     }
 
-    size_t content_index_size = Longtail_GetContentIndexSize(compact_block_count, compact_chunk_count);
+    int sorted = local_content_index->m_SortedChunkHashes != 0 || new_content_index->m_SortedChunkHashes != 0;
+    size_t content_index_size = Longtail_GetContentIndexSize(compact_block_count, compact_chunk_count) + (sorted ? GetSortedChunksDataSize(compact_chunk_count) : 0);
     struct Longtail_ContentIndex* compact_content_index = (struct Longtail_ContentIndex*)Longtail_Alloc(content_index_size);
     if (!compact_content_index)
     {
@@ -6586,10 +9153,24 @@ int Longtail_MergeContentIndex(
     memcpy(compact_content_index->m_ChunkHashes, tmp_compact_chunk_hashes, sizeof(TLongtail_Hash) * compact_chunk_count);
     memcpy(compact_content_index->m_ChunkBlockIndexes, tmp_compact_chunk_block_indexes, sizeof(uint64_t) * compact_chunk_count);
 
-    *out_content_index = compact_content_index;
     Longtail_Free(block_hash_to_block_index);
     Longtail_Free(chunk_hash_to_block_index);
     Longtail_Free(work_mem);
+
+    if (sorted)
+    {
+        err = AddSortedChunkColumns(compact_content_index);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_MergeContentIndex(%p, %p, %p) failed with %d",
+                local_content_index, new_content_index, out_content_index,
+                err)
+            Longtail_Free(compact_content_index);
+            return err;
+        }
+    }
+
+    *out_content_index = compact_content_index;
     return 0;
 }
 
@@ -6611,7 +9192,8 @@ int Longtail_AddContentIndex(
     uint64_t remote_chunk_count = *new_content_index->m_ChunkCount;
     uint64_t block_count = local_block_count + remote_block_count;
     uint64_t chunk_count = local_chunk_count + remote_chunk_count;
-    size_t content_index_size = Longtail_GetContentIndexSize(block_count, chunk_count);
+    int sorted = local_content_index->m_SortedChunkHashes != 0 || new_content_index->m_SortedChunkHashes != 0;
+    size_t content_index_size = Longtail_GetContentIndexSize(block_count, chunk_count) + (sorted ? GetSortedChunksDataSize(chunk_count) : 0);
     struct Longtail_ContentIndex* content_index = (struct Longtail_ContentIndex*)Longtail_Alloc(content_index_size);
     if (!content_index)
     {
@@ -6657,6 +9239,18 @@ int Longtail_AddContentIndex(
         content_index->m_ChunkHashes[local_chunk_count + a] = new_content_index->m_ChunkHashes[a];
         content_index->m_ChunkBlockIndexes[local_chunk_count + a] = local_block_count + new_content_index->m_ChunkBlockIndexes[a];
     }
+    if (sorted)
+    {
+        err = AddSortedChunkColumns(content_index);
+        if (err)
+        {
+            LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_AddContentIndex(%p, %p, %p) failed with %d",
+                local_content_index, new_content_index, out_content_index,
+                err)
+            Longtail_Free(content_index);
+            return err;
+        }
+    }
     *out_content_index = content_index;
     return 0;
 }
@@ -7199,8 +9793,7 @@ int Longtail_ChangeVersion(
 
     if (write_asset_count > 0)
     {
-        uint64_t chunk_count = *content_index->m_ChunkCount;
-        struct Longtail_LookupTable* chunk_hash_to_block_index = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(chunk_count)), chunk_count, 0);
+        struct ChunkBlockIndexLookup* chunk_hash_to_block_index = CreateChunkBlockIndexLookup(content_index);
         if (!chunk_hash_to_block_index)
         {
             LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ChangeVersion(%p, %p, %p, %p, %p, %p, %p, %p, %p, %p, %p, %s, %u) failed with %d",
@@ -7208,12 +9801,6 @@ int Longtail_ChangeVersion(
                 ENOMEM)
             return ENOMEM;
         }
-        for (uint64_t i = 0; i < chunk_count; ++i)
-        {
-            TLongtail_Hash chunk_hash = content_index->m_ChunkHashes[i];
-            uint64_t block_index = content_index->m_ChunkBlockIndexes[i];
-            Longtail_LookupTable_PutUnique(chunk_hash_to_block_index, chunk_hash, block_index);
-        }
 
         size_t asset_indexes_size = sizeof(uint32_t) * write_asset_count;
         uint32_t* asset_indexes = (uint32_t*)Longtail_Alloc(asset_indexes_size);
@@ -7307,7 +9894,9 @@ int Longtail_ChangeVersion(
             const char* asset_path = &target_version->m_NameData[target_version->m_NameOffsets[asset_index]];
             char* full_path = version_storage_api->ConcatPath(version_storage_api, version_path, asset_path);
             uint16_t permissions = (uint16_t)target_version->m_Permissions[asset_index];
+            uint64_t permissions_start_time = Longtail_GetMetricTime();
             err = version_storage_api->SetPermissions(version_storage_api, full_path, permissions);
+            Longtail_ObserveMetricTime(Longtail_Metric_SetPermissions_Time, permissions_start_time);
             if (err)
             {
                 LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "Longtail_ChangeVersion(%p, %p, %p, %p, %p, %p, %p, %p, %p, %p, %p, %s, %u) failed with %d",
@@ -7534,5 +10123,6 @@ TLongtail_Hash* Longtail_ContentIndex_BlockHashes(const struct Longtail_ContentI
 
 uint32_t Longtail_VersionIndex_GetVersion(const struct Longtail_VersionIndex* content_index) { return *content_index->m_Version; }
 uint32_t Longtail_VersionIndex_GetHashAPI(const struct Longtail_VersionIndex* content_index) { return *content_index->m_HashIdentifier; }
+uint32_t Longtail_VersionIndex_GetChunkerAPI(const struct Longtail_VersionIndex* content_index) { return content_index->m_ChunkerIdentifier ? *content_index->m_ChunkerIdentifier : 0; }
 uint32_t Longtail_VersionIndex_GetAssetCount(const struct Longtail_VersionIndex* content_index) { return *content_index->m_AssetCount; }
 uint32_t Longtail_VersionIndex_GetChunkCount(const struct Longtail_VersionIndex* content_index) { return *content_index->m_ChunkCount; }
@@ -206,6 +206,8 @@ typedef int (*Longtail_Hash_BeginContextFunc)(struct Longtail_HashAPI* hash_api,
 typedef void (*Longtail_Hash_HashFunc)(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context, uint32_t length, const void* data);
 typedef uint64_t (*Longtail_Hash_EndContextFunc)(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context);
 typedef int (*Longtail_Hash_HashBufferFunc)(struct Longtail_HashAPI* hash_api, uint32_t length, const void* data, uint64_t* out_hash);
+// Optional, hashes count independent buffers, out_hashes[i] is the same as HashBuffer(lengths[i], data[i])
+typedef int (*Longtail_Hash_HashBuffersFunc)(struct Longtail_HashAPI* hash_api, uint32_t count, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes);
 
 struct Longtail_HashAPI
 {
@@ -215,6 +217,7 @@ struct Longtail_HashAPI
     Longtail_Hash_HashFunc Hash;
     Longtail_Hash_EndContextFunc EndContext;
     Longtail_Hash_HashBufferFunc HashBuffer;
+    Longtail_Hash_HashBuffersFunc HashBuffers;
 };
 
 LONGTAIL_EXPORT uint64_t Longtail_GetHashAPISize();
@@ -226,13 +229,15 @@ LONGTAIL_EXPORT struct Longtail_HashAPI* Longtail_MakeHashAPI(
     Longtail_Hash_BeginContextFunc begin_context_func,
     Longtail_Hash_HashFunc hash_func,
     Longtail_Hash_EndContextFunc end_context_func,
-    Longtail_Hash_HashBufferFunc hash_buffer_func);
+    Longtail_Hash_HashBufferFunc hash_buffer_func,
+    Longtail_Hash_HashBuffersFunc hash_buffers_func);
 
 LONGTAIL_EXPORT uint32_t Longtail_Hash_GetIdentifier(struct Longtail_HashAPI* hash_api);
 LONGTAIL_EXPORT int Longtail_Hash_BeginContext(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext* out_context);
 LONGTAIL_EXPORT void Longtail_Hash_Hash(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context, uint32_t length, const void* data);
 LONGTAIL_EXPORT uint64_t Longtail_Hash_EndContext(struct Longtail_HashAPI* hash_api, Longtail_HashAPI_HContext context);
 LONGTAIL_EXPORT int Longtail_Hash_HashBuffer(struct Longtail_HashAPI* hash_api, uint32_t length, const void* data, uint64_t* out_hash);
+LONGTAIL_EXPORT int Longtail_Hash_HashBuffers(struct Longtail_HashAPI* hash_api, uint32_t count, const uint32_t* lengths, const void* const* data, uint64_t* out_hashes);
 
 ////////////// Longtail_HashRegistryAPI
 
@@ -308,6 +313,7 @@ LONGTAIL_EXPORT int Longtail_GetCompressionRegistry_GetCompressionAPI(struct Lon
 typedef struct Longtail_StorageAPI_OpenFile* Longtail_StorageAPI_HOpenFile;
 typedef struct Longtail_StorageAPI_Iterator* Longtail_StorageAPI_HIterator;
 typedef struct Longtail_StorageAPI_LockFile* Longtail_StorageAPI_HLockFile;
+typedef struct Longtail_StorageAPI_FileMap* Longtail_StorageAPI_HFileMap;
 
 enum
 {
@@ -330,6 +336,10 @@ struct Longtail_StorageAPI_EntryProperties
     uint64_t m_Size;
     uint16_t m_Permissions;
     int m_IsDir;
+    // Change detection stamps, zero if the storage can not provide them
+    uint64_t m_ModificationTime;
+    uint64_t m_ChangeTime;
+    uint64_t m_FileId;
 };
 
 struct Longtail_StorageAPI;
@@ -356,6 +366,13 @@ typedef void (*Longtail_Storage_CloseFindFunc)(struct Longtail_StorageAPI* stora
 typedef int (*Longtail_Storage_GetEntryPropertiesFunc)(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HIterator iterator, struct Longtail_StorageAPI_EntryProperties* out_properties);
 typedef int (*Longtail_Storage_LockFileFunc)(struct Longtail_StorageAPI* storage_api, const char* path, Longtail_StorageAPI_HLockFile* out_lock_file);
 typedef int (*Longtail_Storage_UnlockFileFunc)(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HLockFile file_lock);
+// Maps a read-only view of an open file, returns ENOTSUP if the storage can't map files.
+// The file must stay open until the view is released with UnmapFile
+typedef int (*Longtail_Storage_MapFileFunc)(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr);
+typedef void (*Longtail_Storage_UnmapFileFunc)(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map);
+// Hints that an open file will be read front to back so the storage can read ahead more aggressively.
+// Only a hint, storages that have no use for it return 0
+typedef int (*Longtail_Storage_AdviseSequentialReadFunc)(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f);
 
 struct Longtail_StorageAPI
 {
@@ -382,6 +399,9 @@ struct Longtail_StorageAPI
     Longtail_Storage_GetEntryPropertiesFunc GetEntryProperties;
     Longtail_Storage_LockFileFunc LockFile;
     Longtail_Storage_UnlockFileFunc UnlockFile;
+    Longtail_Storage_MapFileFunc MapFile;
+    Longtail_Storage_UnmapFileFunc UnmapFile;
+    Longtail_Storage_AdviseSequentialReadFunc AdviseSequentialRead;
 };
 
 LONGTAIL_EXPORT uint64_t Longtail_GetStorageAPISize();
@@ -410,7 +430,10 @@ LONGTAIL_EXPORT struct Longtail_StorageAPI* Longtail_MakeStorageAPI(
     Longtail_Storage_CloseFindFunc close_find_func,
     Longtail_Storage_GetEntryPropertiesFunc get_entry_properties_func,
     Longtail_Storage_LockFileFunc lock_file_func,
-    Longtail_Storage_UnlockFileFunc unlock_file_func);
+    Longtail_Storage_UnlockFileFunc unlock_file_func,
+    Longtail_Storage_MapFileFunc map_file_func,
+    Longtail_Storage_UnmapFileFunc unmap_file_func,
+    Longtail_Storage_AdviseSequentialReadFunc advise_sequential_read_func);
 
 LONGTAIL_EXPORT int Longtail_Storage_OpenReadFile(struct Longtail_StorageAPI* storage_api, const char* path, Longtail_StorageAPI_HOpenFile* out_open_file);
 LONGTAIL_EXPORT int Longtail_Storage_GetSize(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t* out_size);
@@ -434,6 +457,9 @@ LONGTAIL_EXPORT void Longtail_Storage_CloseFind(struct Longtail_StorageAPI* stor
 LONGTAIL_EXPORT int Longtail_Storage_GetEntryProperties(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HIterator iterator, struct Longtail_StorageAPI_EntryProperties* out_properties);
 LONGTAIL_EXPORT int Longtail_Storage_LockFile(struct Longtail_StorageAPI* storage_api, const char* path, Longtail_StorageAPI_HLockFile* out_lock_file);
 LONGTAIL_EXPORT int Longtail_Storage_UnlockFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HLockFile lock_file);
+LONGTAIL_EXPORT int Longtail_Storage_MapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr);
+LONGTAIL_EXPORT void Longtail_Storage_UnmapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map);
+LONGTAIL_EXPORT int Longtail_Storage_AdviseSequentialRead(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f);
 
 ////////////// Longtail_ProgressAPI
 
@@ -456,6 +482,101 @@ LONGTAIL_EXPORT struct Longtail_ProgressAPI* Longtail_MakeProgressAPI(
 
 LONGTAIL_EXPORT void Longtail_Progress_OnProgress(struct Longtail_ProgressAPI* progressAPI, uint32_t total_count, uint32_t done_count);
 
+////////////// Longtail_MetricsAPI
+
+enum
+{
+    Longtail_Metric_Scan_Time,
+    Longtail_Metric_Scan_EntryCount,
+
+    Longtail_Metric_Chunk_Time,
+    Longtail_Metric_Chunk_ByteCount,
+    Longtail_Metric_Hash_Time,
+
+    Longtail_Metric_WriteContent_BlockTime,
+
+    Longtail_Metric_BlockFetch_WaitTime,
+    Longtail_Metric_BlockFetch_ByteCount,
+    Longtail_Metric_BlockFetch_FailCount,
+
+    Longtail_Metric_FileWrite_Time,
+    Longtail_Metric_FileWrite_ByteCount,
+    Longtail_Metric_SetPermissions_Time,
+
+    Longtail_Metric_Compress_Time,
+    Longtail_Metric_Compress_ByteCount,
+    Longtail_Metric_Decompress_Time,
+    Longtail_Metric_Decompress_ByteCount,
+
+    Longtail_Metric_FSBlockStore_ReadTime,
+    Longtail_Metric_FSBlockStore_WriteTime,
+    Longtail_Metric_LRUBlockStore_HitCount,
+    Longtail_Metric_LRUBlockStore_MissCount,
+    Longtail_Metric_CacheBlockStore_HitCount,
+    Longtail_Metric_CacheBlockStore_MissCount,
+    Longtail_Metric_ShareBlockStore_SharedCount,
+
+    Longtail_Metric_FileStorage_ReadByteCount,
+    Longtail_Metric_FileStorage_WriteByteCount,
+    Longtail_Metric_Count
+};
+
+// A counter is a running total, a histogram records the distribution of observed values and
+// a timer is a histogram of durations in nanoseconds
+#define LONGTAIL_METRIC_KIND_COUNTER    0
+#define LONGTAIL_METRIC_KIND_HISTOGRAM  1
+#define LONGTAIL_METRIC_KIND_TIMER      2
+
+LONGTAIL_EXPORT const char* Longtail_GetMetricName(uint32_t metric);
+LONGTAIL_EXPORT int Longtail_GetMetricKind(uint32_t metric);
+
+struct Longtail_MetricsAPI;
+
+typedef void (*Longtail_Metrics_AddFunc)(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value);
+typedef void (*Longtail_Metrics_ObserveFunc)(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value);
+typedef uint64_t (*Longtail_Metrics_GetTimeFunc)(struct Longtail_MetricsAPI* metrics_api);
+
+/*! @brief Sink for the metrics reported by longtail and the lib implementations.
+ *
+ * Add is called for counters and Observe for histograms and timers. GetTime returns a monotonic
+ * time in nanoseconds used to measure timers. All functions can be called from any thread.
+ */
+struct Longtail_MetricsAPI
+{
+    struct Longtail_API m_API;
+    Longtail_Metrics_AddFunc Add;
+    Longtail_Metrics_ObserveFunc Observe;
+    Longtail_Metrics_GetTimeFunc GetTime;
+};
+
+LONGTAIL_EXPORT uint64_t Longtail_GetMetricsAPISize();
+
+LONGTAIL_EXPORT struct Longtail_MetricsAPI* Longtail_MakeMetricsAPI(
+    void* mem,
+    Longtail_DisposeFunc dispose_func,
+    Longtail_Metrics_AddFunc add_func,
+    Longtail_Metrics_ObserveFunc observe_func,
+    Longtail_Metrics_GetTimeFunc get_time_func);
+
+LONGTAIL_EXPORT void Longtail_Metrics_Add(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value);
+LONGTAIL_EXPORT void Longtail_Metrics_Observe(struct Longtail_MetricsAPI* metrics_api, uint32_t metric, uint64_t value);
+LONGTAIL_EXPORT uint64_t Longtail_Metrics_GetTime(struct Longtail_MetricsAPI* metrics_api);
+
+/*! @brief Sets the metrics sink that longtail reports into.
+ *
+ * The sink is not owned, it must outlive all longtail calls made while it is set.
+ *
+ * @param[in] metrics_api   The sink, or 0 to stop reporting
+ */
+LONGTAIL_EXPORT void Longtail_SetMetrics(struct Longtail_MetricsAPI* metrics_api);
+
+// Reporting functions, they do nothing when no metrics sink is set
+LONGTAIL_EXPORT void Longtail_AddMetric(uint32_t metric, uint64_t value);
+LONGTAIL_EXPORT void Longtail_ObserveMetric(uint32_t metric, uint64_t value);
+// Returns zero when no metrics sink is set, pass the result to Longtail_ObserveMetricTime()
+LONGTAIL_EXPORT uint64_t Longtail_GetMetricTime();
+LONGTAIL_EXPORT void Longtail_ObserveMetricTime(uint32_t metric, uint64_t start_time);
+
 ////////////// Longtail_JobAPI
 
 struct Longtail_JobAPI;
@@ -463,9 +584,14 @@ typedef void* Longtail_JobAPI_Jobs;
 typedef int (*Longtail_JobAPI_JobFunc)(void* context, uint32_t job_id, int is_cancelled);
 typedef void* Longtail_JobAPI_Group;
 
+// Job classes let a job api schedule disk bound and cpu bound work with separate concurrency limits
+#define LONGTAIL_JOB_CLASS_CPU      0
+#define LONGTAIL_JOB_CLASS_IO       1
+#define LONGTAIL_JOB_CLASS_COUNT    2
+
 typedef uint32_t (*Longtail_Job_GetWorkerCountFunc)(struct Longtail_JobAPI* job_api);
 typedef int (*Longtail_Job_ReserveJobsFunc)(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Group* out_job_group);
-typedef int (*Longtail_Job_CreateJobsFunc)(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], Longtail_JobAPI_Jobs* out_jobs);
+typedef int (*Longtail_Job_CreateJobsFunc)(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], uint32_t job_class, Longtail_JobAPI_Jobs* out_jobs);
 typedef int (*Longtail_Job_AddDependeciesFunc)(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs, uint32_t dependency_job_count, Longtail_JobAPI_Jobs dependency_jobs);
 typedef int (*Longtail_Job_ReadyJobsFunc)(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs);
 typedef int (*Longtail_Job_WaitForAllJobsFunc)(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, struct Longtail_ProgressAPI* progressAPI, struct Longtail_CancelAPI* optional_cancel_api, Longtail_CancelAPI_HCancelToken optional_cancel_token);
@@ -498,7 +624,7 @@ struct Longtail_JobAPI* Longtail_MakeJobAPI(
 
 LONGTAIL_EXPORT uint32_t Longtail_Job_GetWorkerCount(struct Longtail_JobAPI* job_api);
 LONGTAIL_EXPORT int Longtail_Job_ReserveJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Group* out_job_group);
-LONGTAIL_EXPORT int Longtail_Job_CreateJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], Longtail_JobAPI_Jobs* out_jobs);
+LONGTAIL_EXPORT int Longtail_Job_CreateJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, uint32_t job_count, Longtail_JobAPI_JobFunc job_funcs[], void* job_contexts[], uint32_t job_class, Longtail_JobAPI_Jobs* out_jobs);
 LONGTAIL_EXPORT int Longtail_Job_AddDependecies(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs, uint32_t dependency_job_count, Longtail_JobAPI_Jobs dependency_jobs);
 LONGTAIL_EXPORT int Longtail_Job_ReadyJobs(struct Longtail_JobAPI* job_api, uint32_t job_count, Longtail_JobAPI_Jobs jobs);
 LONGTAIL_EXPORT int Longtail_Job_WaitForAllJobs(struct Longtail_JobAPI* job_api, Longtail_JobAPI_Group job_group, struct Longtail_ProgressAPI* progressAPI, struct Longtail_CancelAPI* optional_cancel_api, Longtail_CancelAPI_HCancelToken optional_cancel_token);
@@ -519,18 +645,23 @@ struct Longtail_Chunker_ChunkRange
     uint32_t len;
 };
 
+typedef uint32_t (*Longtail_Chunker_GetIdentifierFunc)(struct Longtail_ChunkerAPI* chunker_api);
 typedef int (*Longtail_Chunker_GetMinChunkSizeFunc)(struct Longtail_ChunkerAPI* chunker_api, uint32_t* out_min_chunk_size);
 typedef int (*Longtail_Chunker_CreateChunkerFunc)(struct Longtail_ChunkerAPI* chunker_api, uint32_t min_chunk_size, uint32_t avg_chunk_size, uint32_t max_chunk_size, Longtail_ChunkerAPI_HChunker* out_chunker);
 typedef int (*Longtail_Chunker_NextChunkFunc)(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, Longtail_Chunker_Feeder feeder, void* feeder_context, struct Longtail_Chunker_ChunkRange* out_chunk_range);
 typedef int (*Longtail_Chunker_DisposeChunkerFunc)(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker);
+// Optional, finds the end of the chunk starting at buffer without copying the data, buffer_size is the size left until the end of the data
+typedef int (*Longtail_Chunker_NextChunkFromBufferFunc)(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, const void* buffer, uint64_t buffer_size, const void** out_next_chunk_start);
 
 struct Longtail_ChunkerAPI
 {
     struct Longtail_API m_API;
+    Longtail_Chunker_GetIdentifierFunc GetIdentifier;
     Longtail_Chunker_GetMinChunkSizeFunc GetMinChunkSize;
     Longtail_Chunker_CreateChunkerFunc CreateChunker;
     Longtail_Chunker_NextChunkFunc NextChunk;
     Longtail_Chunker_DisposeChunkerFunc DisposeChunker;
+    Longtail_Chunker_NextChunkFromBufferFunc NextChunkFromBuffer;
 };
 
 LONGTAIL_EXPORT uint64_t Longtail_GetChunkerAPISize();
@@ -538,15 +669,19 @@ LONGTAIL_EXPORT uint64_t Longtail_GetChunkerAPISize();
 LONGTAIL_EXPORT struct Longtail_ChunkerAPI* Longtail_MakeChunkerAPI(
     void* mem,
     Longtail_DisposeFunc dispose_func,
+    Longtail_Chunker_GetIdentifierFunc get_identifier_func,
     Longtail_Chunker_GetMinChunkSizeFunc get_min_chunk_size_func,
     Longtail_Chunker_CreateChunkerFunc create_chunker_func,
     Longtail_Chunker_NextChunkFunc next_chunk_func,
-    Longtail_Chunker_DisposeChunkerFunc dispose_chunker_func);
+    Longtail_Chunker_DisposeChunkerFunc dispose_chunker_func,
+    Longtail_Chunker_NextChunkFromBufferFunc next_chunk_from_buffer_func);
 
+LONGTAIL_EXPORT uint32_t Longtail_Chunker_GetIdentifier(struct Longtail_ChunkerAPI* chunker_api);
 LONGTAIL_EXPORT int Longtail_Chunker_GetMinChunkSize(struct Longtail_ChunkerAPI* chunker_api, uint32_t* out_min_chunk_size);
 LONGTAIL_EXPORT int Longtail_Chunker_CreateChunker(struct Longtail_ChunkerAPI* chunker_api, uint32_t min_chunk_size, uint32_t avg_chunk_size, uint32_t max_chunk_size, Longtail_ChunkerAPI_HChunker* out_chunker);
 LONGTAIL_EXPORT int Longtail_Chunker_NextChunk(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, Longtail_Chunker_Feeder feeder, void* feeder_context, struct Longtail_Chunker_ChunkRange* out_chunk_range);
 LONGTAIL_EXPORT int Longtail_Chunker_DisposeChunker(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker);
+LONGTAIL_EXPORT int Longtail_Chunker_NextChunkFromBuffer(struct Longtail_ChunkerAPI* chunker_api, Longtail_ChunkerAPI_HChunker chunker, const void* buffer, uint64_t buffer_size, const void** out_next_chunk_start);
 
 ////////////// Longtail_AsyncPutStoredBlockAPI
 
@@ -714,16 +849,65 @@ typedef void (*Longtail_Log)(void* context, int level, const char* str);
 LONGTAIL_EXPORT void Longtail_SetLog(Longtail_Log log_func, void* context);
 LONGTAIL_EXPORT void Longtail_SetLogLevel(int level);
 
+/*! @brief Unformatted log message.
+ *
+ * Holds the format string of the log call site and its arguments packed in binary form,
+ * formatting is deferred until Longtail_FormatLogRecord is called.
+ * The arguments follow the header as m_ArgCount 64-bit slots, string arguments are copied
+ * after the slots and their slot holds the offset from the start of the record.
+ * A copy of the first m_Size bytes of a record is a valid record.
+ */
+struct Longtail_LogRecord
+{
+    const char* m_Format;
+    int32_t m_Level;
+    uint32_t m_ArgCount;
+    uint32_t m_Size;
+};
+
+typedef void (*Longtail_StructuredLog)(void* context, const struct Longtail_LogRecord* record);
+
+/*! @brief Sets a sink that receives log messages as unformatted records.
+ *
+ * The sink is called in addition to the Longtail_Log function set by Longtail_SetLog.
+ * The record is only valid during the call, the format string is a string literal and stays valid.
+ *
+ * @param[in] log_func      The sink function, or 0 to remove it
+ * @param[in] context       Context passed to @p log_func
+ */
+LONGTAIL_EXPORT void Longtail_SetStructuredLog(Longtail_StructuredLog log_func, void* context);
+
+/*! @brief Formats a log record.
+ *
+ * @param[in] record        A record received by a Longtail_StructuredLog sink, or a copy of it
+ * @param[out] buffer       Buffer receiving the zero terminated message
+ * @param[in] buffer_size   Size of @p buffer, output is truncated to fit
+ * @return                  Length of the formatted message, excluding the terminator
+ */
+LONGTAIL_EXPORT size_t Longtail_FormatLogRecord(const struct Longtail_LogRecord* record, char* buffer, size_t buffer_size);
+
 #define LONGTAIL_LOG_LEVEL_DEBUG    0
 #define LONGTAIL_LOG_LEVEL_INFO     1
 #define LONGTAIL_LOG_LEVEL_WARNING  2
 #define LONGTAIL_LOG_LEVEL_ERROR    3
 #define LONGTAIL_LOG_LEVEL_OFF      4
 
+// Log calls below LONGTAIL_LOG_MIN_LEVEL are compiled out, including evaluation of their arguments
+#ifndef LONGTAIL_LOG_MIN_LEVEL
+    #define LONGTAIL_LOG_MIN_LEVEL  LONGTAIL_LOG_LEVEL_DEBUG
+#endif
+
 #ifndef LONGTAIL_LOG
-    void Longtail_CallLogger(int level, const char* fmt, ...);
+    // Lowest level that reaches a log sink, LONGTAIL_LOG_LEVEL_OFF when no sink is set
+    LONGTAIL_EXPORT extern int Longtail_LogFilterLevel_private;
+    LONGTAIL_EXPORT void Longtail_CallLogger(int level, const char* fmt, ...);
     #define LONGTAIL_LOG(level, fmt, ...) \
-        Longtail_CallLogger(level, fmt, __VA_ARGS__);
+        do { \
+            if (((level) >= LONGTAIL_LOG_MIN_LEVEL) && ((level) >= Longtail_LogFilterLevel_private)) \
+            { \
+                Longtail_CallLogger(level, fmt, __VA_ARGS__); \
+            } \
+        } while (0);
 #endif
 
 #if defined(LONGTAIL_ASSERTS)
@@ -811,6 +995,10 @@ LONGTAIL_EXPORT int Longtail_GetFilesRecursively(
  * All files are chunked and hashes to create a struct VersionIndex, allocated using Longtail_Alloc()
  * Free the version index with Longtail_Free()
  *
+ * The version index is written as the oldest format that holds its data: 0.0.4 if a @p chunker_api is given,
+ * 0.0.3 if @p file_infos has change stamps and 0.0.2 otherwise. Readers older than 0.0.3 and 0.0.4 reject
+ * version indexes of those formats.
+ *
  * @param[in] storage_api           An implementation of struct Longtail_StorageAPI interface.
  * @param[in] hash_api              An implementation of struct Longtail_HashAPI interface.
  * @param[in] chunker_api           An implementation of struct Longtail_ChunkerAPI interface.
@@ -838,6 +1026,86 @@ LONGTAIL_EXPORT int Longtail_CreateVersionIndex(
     uint32_t target_chunk_size,
     struct Longtail_VersionIndex** out_version_index);
 
+/*! @brief Create a version index for a struct Longtail_FileInfos, reusing the chunks of unchanged assets from a previous version index.
+ *
+ * Assets whose path, size, modification time, change time and file id match the entry in @p optional_previous_version_index
+ * get the chunk hashes, sizes and tags of the previous version without being read, all other assets are chunked as in
+ * Longtail_CreateVersionIndex(). Nothing is reused if the storage does not report modification times, if the previous version
+ * index has no change stamps or if it was created with a different hash api or target chunk size.
+ * Free the version index with Longtail_Free()
+ *
+ * @param[in] storage_api                       An implementation of struct Longtail_StorageAPI interface.
+ * @param[in] hash_api                          An implementation of struct Longtail_HashAPI interface.
+ * @param[in] chunker_api                       An implementation of struct Longtail_ChunkerAPI interface.
+ * @param[in] job_api                           An implementation of struct Longtail_JobAPI interface
+ * @param[in] progress_api                      An implementation of struct Longtail_JobAPI interface or null if no progress indication is required
+ * @param[in] optional_cancel_api               An implementation of struct Longtail_CancelAPI interface or null if no cancelling is required
+ * @param[in] optional_cancel_token             A cancel token or null if @p optional_cancel_api is null
+ * @param[in] root_path                         Root path for files in @p file_infos
+ * @param[in] optional_asset_tags               An array with a tag for each entry in @p file_infos, usually a compression tag, set to zero if no tags are wanted
+ * @param[in] target_chunk_size                 The target size of chunks, with minimum size set to @target_chunk_size / 8 and maximum size set to @p target_chunk_size * 2
+ * @param[in] optional_previous_version_index   The version index of a previous scan of @p root_path or null to chunk all assets
+ * @param[out] out_version_index                Pointer to a struct Longtail_VersionIndex* pointer which will be set on success
+ * @return                                      Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_CreateVersionIndexIncremental(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    uint32_t target_chunk_size,
+    const struct Longtail_VersionIndex* optional_previous_version_index,
+    struct Longtail_VersionIndex** out_version_index);
+
+/*! @brief Create a version index and write the content of the version in one pass.
+ *
+ * Same as calling Longtail_CreateVersionIndex(), Longtail_CreateContentIndex() and Longtail_WriteContent() but each
+ * source file is only read once, chunk data is packed into blocks while the assets are chunked and the blocks are
+ * written to @p block_store_api.
+ * The resulting version index and content index are identical to the ones created by the separate calls.
+ * Free the version index and content index with Longtail_Free()
+ *
+ * @param[in] storage_api           An implementation of struct Longtail_StorageAPI interface.
+ * @param[in] hash_api              An implementation of struct Longtail_HashAPI interface.
+ * @param[in] chunker_api           An implementation of struct Longtail_ChunkerAPI interface.
+ * @param[in] block_store_api       An implementation of struct Longtail_BlockStoreAPI interface, all blocks of the version are written to it
+ * @param[in] job_api               An implementation of struct Longtail_JobAPI interface
+ * @param[in] progress_api          An implementation of struct Longtail_JobAPI interface or null if no progress indication is required
+ * @param[in] optional_cancel_api   An implementation of struct Longtail_CancelAPI interface or null if no cancelling is required
+ * @param[in] optional_cancel_token A cancel token or null if @p optional_cancel_api is null
+ * @param[in] root_path             Root path for files in @p file_infos
+ * @param[in] optional_asset_tags   An array with a tag for each entry in @p file_infos, usually a compression tag, set to zero if no tags are wanted
+ * @param[in] target_chunk_size     The target size of chunks, with minimum size set to @target_chunk_size / 8 and maximum size set to @p target_chunk_size * 2
+ * @param[in] max_block_size        The maximum size if bytes one block is allowed to be
+ * @param[in] max_chunks_per_block  The maximum number of chunks allowed inside one block
+ * @param[out] out_version_index    Pointer to a struct Longtail_VersionIndex* pointer which will be set on success
+ * @param[out] out_content_index    Pointer to a struct Longtail_ContentIndex* pointer which will be set on success
+ * @return                          Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_CreateVersionIndexAndWriteContent(
+    struct Longtail_StorageAPI* storage_api,
+    struct Longtail_HashAPI* hash_api,
+    struct Longtail_ChunkerAPI* chunker_api,
+    struct Longtail_BlockStoreAPI* block_store_api,
+    struct Longtail_JobAPI* job_api,
+    struct Longtail_ProgressAPI* progress_api,
+    struct Longtail_CancelAPI* optional_cancel_api,
+    Longtail_CancelAPI_HCancelToken optional_cancel_token,
+    const char* root_path,
+    const struct Longtail_FileInfos* file_infos,
+    const uint32_t* optional_asset_tags,
+    uint32_t target_chunk_size,
+    uint32_t max_block_size,
+    uint32_t max_chunks_per_block,
+    struct Longtail_VersionIndex** out_version_index,
+    struct Longtail_ContentIndex** out_content_index);
+
 /*! @brief Writes a struct Longtail_VersionIndex to a byte buffer.
  *
  * Serializes a struct Longtail_VersionIndex to a buffer which is allocated using Longtail_Alloc()
@@ -896,6 +1164,30 @@ LONGTAIL_EXPORT int Longtail_ReadVersionIndex(
     const char* path,
     struct Longtail_VersionIndex** out_version_index);
 
+/*! @brief Maps a struct Longtail_VersionIndex.
+ *
+ * Maps the file at the specified path in a struct Longtail_StorageAPI and uses the data in place so
+ * only the parts of the version index that are accessed are read. The version index data must not be modified.
+ * If the struct Longtail_StorageAPI can not map files the version index is read into memory instead.
+ * Free the version index with Longtail_UnmapVersionIndex()
+ *
+ * @param[in] storage_api           An initialized struct Longtail_StorageAPI
+ * @param[in] path                  A path in the storage api to map the version index from
+ * @param[out] out_version_index    Pointer to an struct Longtail_VersionIndex pointer
+ * @return                          Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_MapVersionIndex(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    struct Longtail_VersionIndex** out_version_index);
+
+/*! @brief Releases a struct Longtail_VersionIndex created with Longtail_MapVersionIndex().
+ *
+ * @param[in] version_index         Pointer to a struct Longtail_VersionIndex returned by Longtail_MapVersionIndex()
+ */
+LONGTAIL_EXPORT void Longtail_UnmapVersionIndex(
+    struct Longtail_VersionIndex* version_index);
+
 /*! @brief Get size of content index data.
  *
  * Content index data size is the size raw size of the content index excluding the struct Longtail_ContentIndex
@@ -1104,6 +1396,77 @@ LONGTAIL_EXPORT int Longtail_ReadContentIndex(
     const char* path,
     struct Longtail_ContentIndex** out_content_index);
 
+/*! @brief Maps a struct Longtail_ContentIndex.
+ *
+ * Maps the file at the specified path in a struct Longtail_StorageAPI and uses the data in place so
+ * only the parts of the content index that are accessed are read. The content index data must not be modified.
+ * If the struct Longtail_StorageAPI can not map files the content index is read into memory instead.
+ * Free the content index with Longtail_UnmapContentIndex()
+ *
+ * @param[in] storage_api           An initialized struct Longtail_StorageAPI
+ * @param[in] path                  A path in the storage api to map the content index from
+ * @param[out] out_content_index    Pointer to an struct Longtail_ContentIndex pointer
+ * @return                          Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_MapContentIndex(
+    struct Longtail_StorageAPI* storage_api,
+    const char* path,
+    struct Longtail_ContentIndex** out_content_index);
+
+/*! @brief Releases a struct Longtail_ContentIndex created with Longtail_MapContentIndex().
+ *
+ * @param[in] content_index         Pointer to a struct Longtail_ContentIndex returned by Longtail_MapContentIndex()
+ */
+LONGTAIL_EXPORT void Longtail_UnmapContentIndex(
+    struct Longtail_ContentIndex* content_index);
+
+/*! @brief Creates a copy of a struct Longtail_ContentIndex with a sorted chunk lookup.
+ *
+ * The copy carries the chunk hashes sorted by value together with the block index of each chunk
+ * so chunks can be found with Longtail_ContentIndex_LookupChunkBlockIndex() without building a hash table.
+ * The sorted columns are serialized with the content index and are usable directly from a mapped content index.
+ * If a chunk is present in several blocks the first block in @p content_index is used.
+ * The resulting struct Longtail_ContentIndex is freed with Longtail_Free()
+ *
+ * @param[in] content_index         Pointer to an initialized struct Longtail_ContentIndex
+ * @param[out] out_content_index    Pointer to an struct Longtail_ContentIndex pointer
+ * @return                          Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_CreateSortedContentIndex(
+    const struct Longtail_ContentIndex* content_index,
+    struct Longtail_ContentIndex** out_content_index);
+
+/*! @brief Creates a copy of a struct Longtail_ContentIndex with or without the sorted chunk lookup.
+ *
+ * Useful to get a heap copy of a mapped content index or to drop the sorted columns before writing
+ * a content index that older readers should be able to read.
+ * The resulting struct Longtail_ContentIndex is freed with Longtail_Free()
+ *
+ * @param[in] content_index         Pointer to an initialized struct Longtail_ContentIndex
+ * @param[in] sorted                Non-zero to include the sorted chunk lookup, zero to leave it out
+ * @param[out] out_content_index    Pointer to an struct Longtail_ContentIndex pointer
+ * @return                          Return code (errno style), zero on success
+ */
+LONGTAIL_EXPORT int Longtail_CopyContentIndex(
+    const struct Longtail_ContentIndex* content_index,
+    int sorted,
+    struct Longtail_ContentIndex** out_content_index);
+
+/*! @brief Finds the block index of a chunk in a sorted struct Longtail_ContentIndex.
+ *
+ * Uses interpolation search over the sorted chunk hashes, the content index must have a sorted chunk lookup,
+ * see Longtail_CreateSortedContentIndex().
+ *
+ * @param[in] content_index         Pointer to a sorted struct Longtail_ContentIndex
+ * @param[in] chunk_hash            The chunk hash to look up
+ * @param[out] out_block_index      Pointer to a block index set on success
+ * @return                          Return code (errno style), zero on success, ENOENT if the chunk is not present
+ */
+LONGTAIL_EXPORT int Longtail_ContentIndex_LookupChunkBlockIndex(
+    const struct Longtail_ContentIndex* content_index,
+    TLongtail_Hash chunk_hash,
+    uint64_t* out_block_index);
+
 /*! @brief Write content blocks from version data
  *
  * Writes all blocks for @p version_content_index using @p version_index and asset_path as data source to a block store
@@ -1180,6 +1543,7 @@ LONGTAIL_EXPORT int Longtail_GetMissingContent(
  *
  * The result is the chunks known in @p reference_content_index arrangend in blocks known to @p reference_content_index.
  * Use Longtail_CreateMissingContent() to create blocks of any chunks not found in @p reference_content_index
+ * The result has a sorted chunk lookup if @p reference_content_index has one.
  *
  * @param[in] reference_content_index   The known content to check against
  * @param[in] requested_content_index   The content you want to test against @p reference_content_index
@@ -1195,6 +1559,7 @@ LONGTAIL_EXPORT int Longtail_RetargetContent(
  *
  * Create a join of two content indexes, @p local_content_index has precedence, if a chunk is present in @p local_content_index the
  * block containing it is added to @p out_content_index over a block from @p new_content_index.
+ * The result has a sorted chunk lookup if either of the content indexes has one.
  *
  * @param[in] job_api                   An initialized struct Longtail_JobAPI
  * @param[in] local_content_index       The known content used a base
@@ -1212,6 +1577,7 @@ LONGTAIL_EXPORT int Longtail_MergeContentIndex(
  *
  * Create a join of two content indexes, @p local_content_index is added first and @p new_content_index is added to that
  * without any checking of duplicate chunks or blocks.
+ * The result has a sorted chunk lookup if either of the content indexes has one.
  *
  * @param[in] local_content_index       The known content used a base
  * @param[in] new_content_index         The content you want add - add chunks and blocks from @p new_content_index will be added
@@ -1598,6 +1964,9 @@ struct Longtail_FileInfos
     uint32_t m_Count;
     uint32_t m_PathDataSize;
     uint64_t* m_Sizes;
+    uint64_t* m_ModificationTimes;
+    uint64_t* m_ChangeTimes;
+    uint64_t* m_FileIds;
     uint32_t* m_PathStartOffsets;
     uint16_t* m_Permissions;
     char* m_PathData;
@@ -1623,6 +1992,10 @@ struct Longtail_ContentIndex
     TLongtail_Hash* m_BlockHashes;      // []
     TLongtail_Hash* m_ChunkHashes;      // []
     uint64_t* m_ChunkBlockIndexes;      // []
+
+    // Optional, zero unless the content index has a sorted chunk lookup, see Longtail_CreateSortedContentIndex()
+    TLongtail_Hash* m_SortedChunkHashes;        // []
+    uint64_t* m_SortedChunkBlockIndexes;        // []
 };
 
 LONGTAIL_EXPORT uint32_t Longtail_ContentIndex_GetVersion(const struct Longtail_ContentIndex* content_index);
@@ -1642,15 +2015,17 @@ struct Longtail_VersionIndex
     TLongtail_Hash* m_PathHashes;       // []
     TLongtail_Hash* m_ContentHashes;    // []
     uint64_t* m_AssetSizes;             // []
+    uint64_t* m_ModificationTimes;      // [] null if read from a version index without change stamps
+    uint64_t* m_ChangeTimes;            // [] null if read from a version index without change stamps
+    uint64_t* m_FileIds;                // [] null if read from a version index without change stamps
     uint32_t* m_AssetChunkCounts;       // []
-    // uint64_t* m_CreationDates;       // []
-    // uint64_t* m_ModificationDates;   // []
     uint32_t* m_AssetChunkIndexStarts;  // []
     uint32_t* m_AssetChunkIndexes;      // []
     TLongtail_Hash* m_ChunkHashes;      // []
 
     uint32_t* m_ChunkSizes;             // []
     uint32_t* m_ChunkTags;              // []
+    uint32_t* m_ChunkerIdentifier;      // null if read from a version index older than 0.0.4
 
     uint32_t* m_NameOffsets;            // []
     uint32_t m_NameDataSize;
@@ -1660,6 +2035,8 @@ struct Longtail_VersionIndex
 
 LONGTAIL_EXPORT uint32_t Longtail_VersionIndex_GetVersion(const struct Longtail_VersionIndex* content_index);
 LONGTAIL_EXPORT uint32_t Longtail_VersionIndex_GetHashAPI(const struct Longtail_VersionIndex* content_index);
+// Zero if the version index was created before the chunker identifier was recorded
+LONGTAIL_EXPORT uint32_t Longtail_VersionIndex_GetChunkerAPI(const struct Longtail_VersionIndex* content_index);
 LONGTAIL_EXPORT uint32_t Longtail_VersionIndex_GetAssetCount(const struct Longtail_VersionIndex* content_index);
 LONGTAIL_EXPORT uint32_t Longtail_VersionIndex_GetChunkCount(const struct Longtail_VersionIndex* content_index);
 
@@ -1684,6 +2061,8 @@ struct Longtail_LookupTable* Longtail_LookupTable_Create(void* mem, size_t capac
 int Longtail_LookupTable_Put(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value);
 uint64_t* Longtail_LookupTable_PutUnique(struct Longtail_LookupTable* lut, uint64_t key, uint64_t value);
 uint64_t* Longtail_LookupTable_Get(const struct Longtail_LookupTable* lut, uint64_t key);
+// Same as calling Longtail_LookupTable_Get() for each key but overlaps the memory accesses of consecutive keys
+void Longtail_LookupTable_GetBatch(const struct Longtail_LookupTable* lut, uint64_t count, const uint64_t* keys, uint64_t** out_values);
 uint64_t Longtail_LookupTable_GetSpaceLeft(const struct Longtail_LookupTable* lut);
 
 ///////////// Test functions
@@ -1716,6 +2095,7 @@ int Longtail_BuildVersionIndex(
     const TLongtail_Hash* chunk_hashes,
     const uint32_t* optional_chunk_tags,
     uint32_t hash_api_identifier,
+    uint32_t chunker_api_identifier,
     uint32_t target_chunk_size,
     struct Longtail_VersionIndex** out_version_index);
 
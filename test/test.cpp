@@ -12,6 +12,8 @@
 #include "../lib/cacheblockstore/longtail_cacheblockstore.h"
 #include "../lib/compressblockstore/longtail_compressblockstore.h"
 #include "../lib/compressionregistry/longtail_full_compression_registry.h"
+#include "../lib/compressionregistry/longtail_zstd_dictionary_compression_registry.h"
+#include "../lib/fastcdcchunker/longtail_fastcdcchunker.h"
 #include "../lib/filestorage/longtail_filestorage.h"
 #include "../lib/fsblockstore/longtail_fsblockstore.h"
 #include "../lib/hpcdcchunker/longtail_hpcdcchunker.h"
@@ -21,7 +23,11 @@
 #include "../lib/lz4/longtail_lz4.h"
 #include "../lib/memstorage/longtail_memstorage.h"
 #include "../lib/meowhash/longtail_meowhash.h"
+#include "../lib/metrics/longtail_metrics.h"
+#include "../lib/seedblockstore/longtail_seedblockstore.h"
 #include "../lib/shareblockstore/longtail_shareblockstore.h"
+#include "../lib/workstealing/longtail_workstealing.h"
+#include "../lib/xxh3/longtail_xxh3.h"
 #include "../lib/zstd/longtail_zstd.h"
 
 #include "../lib/longtail_platform.h"
@@ -324,6 +330,279 @@ TEST(Longtail, Longtail_ZStd)
     Longtail_DisposeAPI(&compression_api->m_API);
 }
 
+TEST(Longtail, Longtail_ZStdDictionary)
+{
+    static const uint32_t SAMPLE_COUNT = 32;
+    char sample_data[SAMPLE_COUNT][128];
+    const void* samples[SAMPLE_COUNT];
+    size_t sample_sizes[SAMPLE_COUNT];
+    for (uint32_t s = 0; s < SAMPLE_COUNT; ++s)
+    {
+        sample_sizes[s] = (size_t)sprintf(sample_data[s], "{\"name\": \"material_%u\", \"shader\": \"pbr\", \"roughness\": 0.%u, \"metallic\": 0.0}", s, s * 7);
+        samples[s] = sample_data[s];
+    }
+    void* dictionary_data;
+    size_t dictionary_size;
+    ASSERT_EQ(0, Longtail_CreateZStdDictionary(SAMPLE_COUNT, samples, sample_sizes, 1024, &dictionary_data, &dictionary_size));
+    ASSERT_EQ(1024u, dictionary_size);
+
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    uint32_t compression_type;
+    ASSERT_EQ(0, Longtail_WriteZStdDictionary(storage_api, "store/dictionaries", dictionary_data, dictionary_size, &compression_type));
+    ASSERT_NE(0, Longtail_IsZStdDictionaryCompressionType(compression_type));
+    uint32_t same_compression_type;
+    ASSERT_EQ(0, Longtail_WriteZStdDictionary(storage_api, "store/dictionaries", dictionary_data, dictionary_size, &same_compression_type));
+    ASSERT_EQ(compression_type, same_compression_type);
+    Longtail_Free(dictionary_data);
+
+    Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateZStdDictionaryCompressionRegistry(storage_api, "store/dictionaries", Longtail_CreateFullCompressionRegistry());
+    ASSERT_NE((Longtail_CompressionRegistryAPI*)0, compression_registry);
+    Longtail_CompressionAPI* compression_api;
+    uint32_t compression_settings;
+    ASSERT_EQ(0, compression_registry->GetCompressionAPI(compression_registry, Longtail_GetZStdDefaultQuality(), &compression_api, &compression_settings));
+    ASSERT_EQ(Longtail_GetZStdDefaultQuality(), compression_settings);
+    ASSERT_EQ(ENOENT, compression_registry->GetCompressionAPI(compression_registry, Longtail_GetZStdDictionaryCompressionType((uint16_t)(compression_type + 1)), &compression_api, &compression_settings));
+    ASSERT_EQ(0, compression_registry->GetCompressionAPI(compression_registry, compression_type, &compression_api, &compression_settings));
+    Longtail_CompressionAPI* loaded_compression_api = compression_api;
+    ASSERT_EQ(0, compression_registry->GetCompressionAPI(compression_registry, compression_type, &compression_api, &compression_settings));
+    ASSERT_EQ(loaded_compression_api, compression_api);
+
+    const char* raw_data = "{\"name\": \"material_77\", \"shader\": \"pbr\", \"roughness\": 0.77, \"metallic\": 0.0}";
+    size_t data_len = strlen(raw_data) + 1;
+    size_t max_compressed_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, data_len);
+    char* compressed_buffer = (char*)Longtail_Alloc(max_compressed_size);
+    size_t compressed_size;
+    ASSERT_EQ(0, compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, data_len, max_compressed_size, &compressed_size));
+
+    Longtail_CompressionAPI* zstd_compression_api = Longtail_CreateZStdCompressionAPI();
+    char* plain_compressed_buffer = (char*)Longtail_Alloc(max_compressed_size);
+    size_t plain_compressed_size;
+    ASSERT_EQ(0, zstd_compression_api->Compress(zstd_compression_api, Longtail_GetZStdDefaultQuality(), raw_data, plain_compressed_buffer, data_len, max_compressed_size, &plain_compressed_size));
+    ASSERT_LT(compressed_size, plain_compressed_size);
+    Longtail_Free(plain_compressed_buffer);
+    SAFE_DISPOSE_API(zstd_compression_api);
+
+    char* decompressed_buffer = (char*)Longtail_Alloc(data_len);
+    size_t uncompressed_size;
+    ASSERT_EQ(0, compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, data_len, &uncompressed_size));
+    ASSERT_EQ(data_len, uncompressed_size);
+    ASSERT_STREQ(raw_data, decompressed_buffer);
+    Longtail_Free(decompressed_buffer);
+    Longtail_Free(compressed_buffer);
+
+    SAFE_DISPOSE_API(compression_registry);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, Longtail_ZStdMultiThreaded)
+{
+    Longtail_CompressionAPI* compression_api = Longtail_CreateZStdCompressionAPI();
+    ASSERT_NE((Longtail_CompressionAPI*)0, compression_api);
+    uint32_t compression_settings = Longtail_GetZStdMaxMTQuality();
+
+    // Large enough to be split over several zstd jobs
+    const size_t data_len = 3 * 1024 * 1024 + 17;
+    char* raw_data = (char*)Longtail_Alloc(data_len);
+    ASSERT_NE((char*)0, raw_data);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < data_len; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        raw_data[i] = (char)('a' + ((seed >> 16) % 8));
+    }
+
+    size_t compressed_size = 0;
+    size_t max_compressed_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, data_len);
+    char* compressed_buffer = (char*)Longtail_Alloc(max_compressed_size);
+    ASSERT_NE((char*)0, compressed_buffer);
+    ASSERT_EQ(0, compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, data_len, max_compressed_size, &compressed_size));
+    ASSERT_LT(compressed_size, data_len);
+
+    char* decompressed_buffer = (char*)Longtail_Alloc(data_len);
+    ASSERT_NE((char*)0, decompressed_buffer);
+    size_t uncompressed_size;
+    ASSERT_EQ(0, compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, data_len, &uncompressed_size));
+    ASSERT_EQ(data_len, uncompressed_size);
+    ASSERT_EQ(0, memcmp(raw_data, decompressed_buffer, data_len));
+
+    // Reuses the multithreaded context
+    ASSERT_EQ(0, compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, data_len, max_compressed_size, &compressed_size));
+    ASSERT_EQ(0, compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, data_len, &uncompressed_size));
+    ASSERT_EQ(0, memcmp(raw_data, decompressed_buffer, data_len));
+
+    Longtail_Free(decompressed_buffer);
+    Longtail_Free(compressed_buffer);
+    Longtail_Free(raw_data);
+
+    SAFE_DISPOSE_API(compression_api);
+}
+
+static TLongtail_Atomic32 CompressionPoolTest_AllocCount = 0;
+
+static void* CompressionPoolTest_Alloc(size_t s)
+{
+    Longtail_AtomicAdd32(&CompressionPoolTest_AllocCount, 1);
+    return malloc(s);
+}
+
+static void CompressionPoolTest_Free(void* p)
+{
+    free(p);
+}
+
+static void CompressionPoolTest_FillData(char* data, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (char)('a' + ((seed >> 16) % 8));
+    }
+}
+
+struct CompressionPoolTestJob
+{
+    Longtail_CompressionAPI* m_CompressionAPI;
+    uint32_t m_CompressionSettings;
+    uint32_t m_Seed;
+    int m_Err;
+};
+
+static const size_t COMPRESSION_POOL_TEST_DATA_SIZE = 128 * 1024;
+
+static int CompressionPoolTestJobFunc(void* context, uint32_t job_id, int is_cancelled)
+{
+    CompressionPoolTestJob* job = (CompressionPoolTestJob*)context;
+    Longtail_CompressionAPI* compression_api = job->m_CompressionAPI;
+    size_t max_compressed_size = compression_api->GetMaxCompressedSize(compression_api, job->m_CompressionSettings, COMPRESSION_POOL_TEST_DATA_SIZE);
+    char* raw_data = (char*)Longtail_Alloc(COMPRESSION_POOL_TEST_DATA_SIZE);
+    char* compressed_buffer = (char*)Longtail_Alloc(max_compressed_size);
+    char* decompressed_buffer = (char*)Longtail_Alloc(COMPRESSION_POOL_TEST_DATA_SIZE);
+    if (!raw_data || !compressed_buffer || !decompressed_buffer)
+    {
+        job->m_Err = ENOMEM;
+    }
+    else
+    {
+        CompressionPoolTest_FillData(raw_data, COMPRESSION_POOL_TEST_DATA_SIZE, job->m_Seed);
+        size_t compressed_size = 0;
+        size_t uncompressed_size = 0;
+        job->m_Err = compression_api->Compress(compression_api, job->m_CompressionSettings, raw_data, compressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE, max_compressed_size, &compressed_size);
+        if (!job->m_Err)
+        {
+            job->m_Err = compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, COMPRESSION_POOL_TEST_DATA_SIZE, &uncompressed_size);
+        }
+        if (!job->m_Err && (uncompressed_size != COMPRESSION_POOL_TEST_DATA_SIZE || memcmp(raw_data, decompressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE) != 0))
+        {
+            job->m_Err = EINVAL;
+        }
+    }
+    Longtail_Free(decompressed_buffer);
+    Longtail_Free(compressed_buffer);
+    Longtail_Free(raw_data);
+    return 0;
+}
+
+// Compresses from several jobs at once with the same api instance, after that the pooled contexts
+// must be reused so a compress/decompress round trip allocates nothing
+static void TestCompressionContextPool(Longtail_CompressionAPI* compression_api, uint32_t compression_settings)
+{
+    size_t max_compressed_size = compression_api->GetMaxCompressedSize(compression_api, compression_settings, COMPRESSION_POOL_TEST_DATA_SIZE);
+    char* raw_data = (char*)Longtail_Alloc(COMPRESSION_POOL_TEST_DATA_SIZE);
+    ASSERT_NE((char*)0, raw_data);
+    char* compressed_buffer = (char*)Longtail_Alloc(max_compressed_size);
+    ASSERT_NE((char*)0, compressed_buffer);
+    char* decompressed_buffer = (char*)Longtail_Alloc(COMPRESSION_POOL_TEST_DATA_SIZE);
+    ASSERT_NE((char*)0, decompressed_buffer);
+    CompressionPoolTest_FillData(raw_data, COMPRESSION_POOL_TEST_DATA_SIZE, 1);
+    size_t compressed_size = 0;
+    size_t uncompressed_size = 0;
+
+    // The first round trip creates the contexts, the second one takes them from the pool
+    CompressionPoolTest_AllocCount = 0;
+    Longtail_SetAllocAndFree(CompressionPoolTest_Alloc, CompressionPoolTest_Free);
+    int compress_err = compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE, max_compressed_size, &compressed_size);
+    int decompress_err = compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, COMPRESSION_POOL_TEST_DATA_SIZE, &uncompressed_size);
+    int32_t first_alloc_count = CompressionPoolTest_AllocCount;
+    compress_err = compress_err ? compress_err : compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE, max_compressed_size, &compressed_size);
+    decompress_err = decompress_err ? decompress_err : compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, COMPRESSION_POOL_TEST_DATA_SIZE, &uncompressed_size);
+    int32_t second_alloc_count = CompressionPoolTest_AllocCount - first_alloc_count;
+    Longtail_SetAllocAndFree(0, 0);
+    ASSERT_EQ(0, compress_err);
+    ASSERT_EQ(0, decompress_err);
+    ASSERT_LT(0, first_alloc_count);
+    ASSERT_EQ(0, second_alloc_count);
+    ASSERT_EQ(COMPRESSION_POOL_TEST_DATA_SIZE, uncompressed_size);
+    ASSERT_EQ(0, memcmp(raw_data, decompressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE));
+
+    const uint32_t worker_count = 4;
+    const uint32_t job_count = 32;
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(worker_count, 0);
+    ASSERT_NE((Longtail_JobAPI*)0, job_api);
+    CompressionPoolTestJob jobs[job_count];
+    Longtail_JobAPI_JobFunc job_funcs[job_count];
+    void* job_ctxs[job_count];
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        for (uint32_t j = 0; j < job_count; ++j)
+        {
+            jobs[j].m_CompressionAPI = compression_api;
+            jobs[j].m_CompressionSettings = compression_settings;
+            jobs[j].m_Seed = round * job_count + j + 2;
+            jobs[j].m_Err = EINVAL;
+            job_funcs[j] = CompressionPoolTestJobFunc;
+            job_ctxs[j] = &jobs[j];
+        }
+        Longtail_JobAPI_Group job_group;
+        ASSERT_EQ(0, job_api->ReserveJobs(job_api, job_count, &job_group));
+        Longtail_JobAPI_Jobs job_handles;
+        ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, job_count, job_funcs, job_ctxs, LONGTAIL_JOB_CLASS_CPU, &job_handles));
+        ASSERT_EQ(0, job_api->ReadyJobs(job_api, job_count, job_handles));
+        ASSERT_EQ(0, job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0));
+        for (uint32_t j = 0; j < job_count; ++j)
+        {
+            ASSERT_EQ(0, jobs[j].m_Err);
+        }
+    }
+    SAFE_DISPOSE_API(job_api);
+
+    // Contexts created by the jobs went back to the pool
+    CompressionPoolTest_AllocCount = 0;
+    Longtail_SetAllocAndFree(CompressionPoolTest_Alloc, CompressionPoolTest_Free);
+    compress_err = 0;
+    decompress_err = 0;
+    for (uint32_t i = 0; i < worker_count && !compress_err && !decompress_err; ++i)
+    {
+        compress_err = compression_api->Compress(compression_api, compression_settings, raw_data, compressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE, max_compressed_size, &compressed_size);
+        decompress_err = compress_err ? compress_err : compression_api->Decompress(compression_api, compressed_buffer, decompressed_buffer, compressed_size, COMPRESSION_POOL_TEST_DATA_SIZE, &uncompressed_size);
+    }
+    int32_t pooled_alloc_count = CompressionPoolTest_AllocCount;
+    Longtail_SetAllocAndFree(0, 0);
+    ASSERT_EQ(0, compress_err);
+    ASSERT_EQ(0, decompress_err);
+    ASSERT_EQ(0, pooled_alloc_count);
+    ASSERT_EQ(0, memcmp(raw_data, decompressed_buffer, COMPRESSION_POOL_TEST_DATA_SIZE));
+
+    Longtail_Free(decompressed_buffer);
+    Longtail_Free(compressed_buffer);
+    Longtail_Free(raw_data);
+}
+
+TEST(Longtail, Longtail_LZ4ContextPool)
+{
+    Longtail_CompressionAPI* compression_api = Longtail_CreateLZ4CompressionAPI();
+    ASSERT_NE((Longtail_CompressionAPI*)0, compression_api);
+    TestCompressionContextPool(compression_api, Longtail_GetLZ4DefaultQuality());
+    SAFE_DISPOSE_API(compression_api);
+}
+
+TEST(Longtail, Longtail_ZStdContextPool)
+{
+    Longtail_CompressionAPI* compression_api = Longtail_CreateZStdCompressionAPI();
+    ASSERT_NE((Longtail_CompressionAPI*)0, compression_api);
+    TestCompressionContextPool(compression_api, Longtail_GetZStdDefaultQuality());
+    SAFE_DISPOSE_API(compression_api);
+}
+
 TEST(Longtail, Longtail_Blake2)
 {
     const char* test_string = "This is the first test string which is fairly long and should - reconstructed properly, than you very much";
@@ -346,6 +625,54 @@ TEST(Longtail, Longtail_Blake3)
     Longtail_DisposeAPI(&hash_api->m_API);
 }
 
+TEST(Longtail, Longtail_Blake3HashBuffers)
+{
+    struct Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    ASSERT_NE((struct Longtail_HashAPI*)0, hash_api);
+    ASSERT_NE((Longtail_Hash_HashBuffersFunc)0, hash_api->HashBuffers);
+
+    // Lengths around the block, chunk and tree boundaries and above the size that is batched
+    const uint32_t lengths[] = {
+        0, 1, 63, 64, 65, 1023, 1024, 1025, 2047, 2048, 2049, 3072, 3073, 5000, 8191, 8192,
+        8193, 16384, 24577, 32768, 40000, 65535, 65536, 65537, 131072, 200000, 1, 1025, 7000, 33000};
+    const uint32_t count = (uint32_t)(sizeof(lengths) / sizeof(lengths[0]));
+    const uint32_t total_size = 1024 * 1024;
+    uint8_t* data = (uint8_t*)Longtail_Alloc(total_size);
+    for (uint32_t i = 0; i < total_size; ++i)
+    {
+        data[i] = (uint8_t)((i * 2654435761u) >> 13);
+    }
+    const void* buffers[count];
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        buffers[i] = &data[offset];
+        offset += lengths[i];
+    }
+    ASSERT_GE(total_size, offset);
+
+    uint64_t hashes[count];
+    ASSERT_EQ(0, hash_api->HashBuffers(hash_api, count, lengths, buffers, hashes));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint64_t hash;
+        ASSERT_EQ(0, hash_api->HashBuffer(hash_api, lengths[i], buffers[i], &hash));
+        ASSERT_EQ(hash, hashes[i]);
+    }
+
+    const char* test_string = "This is the first test string which is fairly long and should - reconstructed properly, than you very much";
+    const uint32_t test_string_length = (uint32_t)(strlen(test_string) + 1);
+    const void* test_string_buffers[2] = {test_string, test_string};
+    const uint32_t test_string_lengths[2] = {test_string_length, test_string_length};
+    uint64_t test_string_hashes[2];
+    ASSERT_EQ(0, hash_api->HashBuffers(hash_api, 2, test_string_lengths, test_string_buffers, test_string_hashes));
+    ASSERT_EQ(0xd38bbe79f1f03fda, test_string_hashes[0]);
+    ASSERT_EQ(0xd38bbe79f1f03fda, test_string_hashes[1]);
+
+    Longtail_Free(data);
+    Longtail_DisposeAPI(&hash_api->m_API);
+}
+
 TEST(Longtail, Longtail_MeowHash)
 {
     const char* test_string = "This is the first test string which is fairly long and should - reconstructed properly, than you very much";
@@ -354,9 +681,105 @@ TEST(Longtail, Longtail_MeowHash)
     uint64_t hash;
     ASSERT_EQ(0, hash_api->HashBuffer(hash_api, (uint32_t)(strlen(test_string) + 1), test_string, &hash));
     ASSERT_EQ(0x4edc68dac105c4ee, hash);
+
+    // Meow does not batch, Longtail_Hash_HashBuffers hashes the buffers one by one
+    ASSERT_EQ((Longtail_Hash_HashBuffersFunc)0, hash_api->HashBuffers);
+    const void* buffers[2] = {test_string, test_string};
+    const uint32_t lengths[2] = {(uint32_t)(strlen(test_string) + 1), (uint32_t)(strlen(test_string) + 1)};
+    uint64_t hashes[2];
+    ASSERT_EQ(0, Longtail_Hash_HashBuffers(hash_api, 2, lengths, buffers, hashes));
+    ASSERT_EQ(0x4edc68dac105c4ee, hashes[0]);
+    ASSERT_EQ(0x4edc68dac105c4ee, hashes[1]);
+    Longtail_DisposeAPI(&hash_api->m_API);
+}
+
+TEST(Longtail, Longtail_XXH3)
+{
+    const char* test_string = "This is the first test string which is fairly long and should - reconstructed properly, than you very much";
+    const uint32_t test_string_length = (uint32_t)(strlen(test_string) + 1);
+    struct Longtail_HashAPI* hash_api = Longtail_CreateXXH3HashAPI();
+    ASSERT_NE((struct Longtail_HashAPI*)0, hash_api);
+    ASSERT_EQ(Longtail_GetXXH3HashType(), hash_api->GetIdentifier(hash_api));
+    uint64_t hash;
+    ASSERT_EQ(0, hash_api->HashBuffer(hash_api, 0, "", &hash));
+    ASSERT_EQ(0x2d06800538d394c2, hash);
+    ASSERT_EQ(0, hash_api->HashBuffer(hash_api, test_string_length, test_string, &hash));
+    ASSERT_EQ(0xa948390d40d6e4c3, hash);
+
+    Longtail_HashAPI_HContext context;
+    ASSERT_EQ(0, hash_api->BeginContext(hash_api, &context));
+    hash_api->Hash(hash_api, context, 10, test_string);
+    hash_api->Hash(hash_api, context, test_string_length - 10, &test_string[10]);
+    ASSERT_EQ(0xa948390d40d6e4c3, hash_api->EndContext(hash_api, context));
+
+    const void* buffers[2] = {test_string, ""};
+    const uint32_t lengths[2] = {test_string_length, 0};
+    uint64_t hashes[2];
+    ASSERT_EQ(0, hash_api->HashBuffers(hash_api, 2, lengths, buffers, hashes));
+    ASSERT_EQ(0xa948390d40d6e4c3, hashes[0]);
+    ASSERT_EQ(0x2d06800538d394c2, hashes[1]);
     Longtail_DisposeAPI(&hash_api->m_API);
 }
 
+TEST(Longtail, Longtail_LookupTable)
+{
+    const uint64_t capacity = 10000;
+    struct Longtail_LookupTable* lut = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(capacity)), capacity, 0);
+    ASSERT_NE((struct Longtail_LookupTable*)0, lut);
+
+    // Sequential keys are not uniform like hashes
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        ASSERT_EQ((uint64_t*)0, Longtail_LookupTable_PutUnique(lut, k, k + 1));
+    }
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        uint64_t* existing = Longtail_LookupTable_PutUnique(lut, k, 0);
+        ASSERT_NE((uint64_t*)0, existing);
+        ASSERT_EQ(k + 1, *existing);
+    }
+    uint64_t hash = 1;
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+        ASSERT_EQ(0, Longtail_LookupTable_Put(lut, hash, k));
+    }
+    // Duplicates added with Put are found in insertion order
+    ASSERT_EQ(0, Longtail_LookupTable_Put(lut, 17, 4711));
+    ASSERT_EQ(18u, *Longtail_LookupTable_Get(lut, 17));
+    ASSERT_EQ((uint64_t*)0, Longtail_LookupTable_Get(lut, 4000));
+    ASSERT_EQ(capacity - 8001, Longtail_LookupTable_GetSpaceLeft(lut));
+
+    uint64_t keys[4001];
+    uint64_t* values[4001];
+    hash = 1;
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+        keys[k] = hash;
+    }
+    keys[4000] = 4000;
+    Longtail_LookupTable_GetBatch(lut, 4001, keys, values);
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        ASSERT_NE((uint64_t*)0, values[k]);
+        ASSERT_EQ(k, *values[k]);
+    }
+    ASSERT_EQ((uint64_t*)0, values[4000]);
+
+    struct Longtail_LookupTable* grown_lut = Longtail_LookupTable_Create(Longtail_Alloc(Longtail_LookupTable_GetSize(capacity * 2)), capacity * 2, lut);
+    ASSERT_NE((struct Longtail_LookupTable*)0, grown_lut);
+    ASSERT_EQ(capacity * 2 - 8001, Longtail_LookupTable_GetSpaceLeft(grown_lut));
+    for (uint64_t k = 0; k < 4000; ++k)
+    {
+        ASSERT_EQ(k + 1, *Longtail_LookupTable_Get(grown_lut, k));
+        ASSERT_EQ(k, *Longtail_LookupTable_Get(grown_lut, keys[k]));
+    }
+
+    Longtail_Free(grown_lut);
+    Longtail_Free(lut);
+}
+
 TEST(Longtail, Longtail_CreateBlockIndex)
 {
     struct Longtail_HashAPI* hash_api = Longtail_CreateMeowHashAPI();
@@ -551,6 +974,7 @@ TEST(Longtail, Longtail_VersionIndex)
         asset_content_hashes,
         asset_tags,
         0u, // Dummy hash identifier
+        0u, // Dummy chunker identifier
         TARGET_CHUNK_SIZE,
         &version_index));
 
@@ -820,6 +1244,212 @@ TEST(Longtail, ContentIndexSerialization)
     SAFE_DISPOSE_API(local_storage);
 }
 
+TEST(Longtail, MapIndexes)
+{
+    Longtail_StorageAPI* mem_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_StorageAPI* fs_storage = Longtail_CreateFSStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateMeowHashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+
+    ASSERT_EQ(1, CreateFakeContent(mem_storage, "source/version1/two_items", 2));
+    ASSERT_EQ(1, CreateFakeContent(mem_storage, "source/version1/five_items", 5));
+    Longtail_FileInfos* version1_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(mem_storage, 0, 0, 0, "source/version1", &version1_paths));
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        mem_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "source/version1",
+        version1_paths,
+        0,
+        16384,
+        &vindex));
+    Longtail_Free(version1_paths);
+    Longtail_ContentIndex* cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(hash_api, vindex, 65536u * 2u, 4096u, &cindex));
+
+    void* vindex_buffer;
+    size_t vindex_buffer_size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(vindex, &vindex_buffer, &vindex_buffer_size));
+
+    Longtail_StorageAPI* storages[2] = {mem_storage, fs_storage};
+    for (uint32_t s = 0; s < 2; ++s)
+    {
+        Longtail_StorageAPI* storage_api = storages[s];
+        ASSERT_EQ(0, Longtail_WriteVersionIndex(storage_api, vindex, "testdata/mapped.lvi"));
+        ASSERT_EQ(0, Longtail_WriteContentIndex(storage_api, cindex, "testdata/mapped.lci"));
+
+        Longtail_VersionIndex* mapped_vindex;
+        ASSERT_EQ(0, Longtail_MapVersionIndex(storage_api, "testdata/mapped.lvi", &mapped_vindex));
+        ASSERT_EQ(*vindex->m_AssetCount, *mapped_vindex->m_AssetCount);
+        ASSERT_EQ(*vindex->m_ChunkCount, *mapped_vindex->m_ChunkCount);
+        for (uint32_t a = 0; a < *vindex->m_AssetCount; ++a)
+        {
+            ASSERT_EQ(vindex->m_PathHashes[a], mapped_vindex->m_PathHashes[a]);
+            ASSERT_STREQ(&vindex->m_NameData[vindex->m_NameOffsets[a]], &mapped_vindex->m_NameData[mapped_vindex->m_NameOffsets[a]]);
+        }
+
+        // A mapped index serializes just like one that was read into memory
+        void* mapped_vindex_buffer;
+        size_t mapped_vindex_buffer_size;
+        ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(mapped_vindex, &mapped_vindex_buffer, &mapped_vindex_buffer_size));
+        ASSERT_EQ(vindex_buffer_size, mapped_vindex_buffer_size);
+        ASSERT_EQ(0, memcmp(vindex_buffer, mapped_vindex_buffer, vindex_buffer_size));
+        Longtail_Free(mapped_vindex_buffer);
+        Longtail_UnmapVersionIndex(mapped_vindex);
+
+        Longtail_ContentIndex* mapped_cindex;
+        ASSERT_EQ(0, Longtail_MapContentIndex(storage_api, "testdata/mapped.lci", &mapped_cindex));
+        ASSERT_EQ(*cindex->m_BlockCount, *mapped_cindex->m_BlockCount);
+        ASSERT_EQ(*cindex->m_ChunkCount, *mapped_cindex->m_ChunkCount);
+        for (uint64_t c = 0; c < *cindex->m_ChunkCount; ++c)
+        {
+            ASSERT_EQ(cindex->m_ChunkHashes[c], mapped_cindex->m_ChunkHashes[c]);
+            ASSERT_EQ(cindex->m_ChunkBlockIndexes[c], mapped_cindex->m_ChunkBlockIndexes[c]);
+        }
+        Longtail_UnmapContentIndex(mapped_cindex);
+
+        ASSERT_EQ(0, storage_api->RemoveFile(storage_api, "testdata/mapped.lvi"));
+        ASSERT_EQ(0, storage_api->RemoveFile(storage_api, "testdata/mapped.lci"));
+    }
+
+    Longtail_Free(vindex_buffer);
+    Longtail_Free(cindex);
+    Longtail_Free(vindex);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(fs_storage);
+    SAFE_DISPOSE_API(mem_storage);
+}
+
+// The sorted chunk columns of content_index must be the same as sorting it from scratch
+static void AssertSortedChunkColumns(const Longtail_ContentIndex* content_index)
+{
+    ASSERT_NE((TLongtail_Hash*)0, content_index->m_SortedChunkHashes);
+    Longtail_ContentIndex* unsorted_content_index;
+    ASSERT_EQ(0, Longtail_CopyContentIndex(content_index, 0, &unsorted_content_index));
+    ASSERT_EQ((TLongtail_Hash*)0, unsorted_content_index->m_SortedChunkHashes);
+    Longtail_ContentIndex* resorted_content_index;
+    ASSERT_EQ(0, Longtail_CreateSortedContentIndex(unsorted_content_index, &resorted_content_index));
+    uint64_t chunk_count = *content_index->m_ChunkCount;
+    ASSERT_EQ(0, memcmp(resorted_content_index->m_SortedChunkHashes, content_index->m_SortedChunkHashes, sizeof(TLongtail_Hash) * chunk_count));
+    ASSERT_EQ(0, memcmp(resorted_content_index->m_SortedChunkBlockIndexes, content_index->m_SortedChunkBlockIndexes, sizeof(uint64_t) * chunk_count));
+    Longtail_Free(resorted_content_index);
+    Longtail_Free(unsorted_content_index);
+}
+
+TEST(Longtail, SortedContentIndex)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateMeowHashAPI();
+
+    const uint64_t chunk_count = 1000;
+    TLongtail_Hash* chunk_hashes = (TLongtail_Hash*)Longtail_Alloc(sizeof(TLongtail_Hash) * chunk_count);
+    uint32_t* chunk_sizes = (uint32_t*)Longtail_Alloc(sizeof(uint32_t) * chunk_count);
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    for (uint64_t c = 0; c < chunk_count; ++c)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        // Odd values so seed + 1 is never a chunk hash
+        chunk_hashes[c] = seed | 1;
+        chunk_sizes[c] = 1024;
+    }
+    Longtail_ContentIndex* cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndexRaw(hash_api, chunk_count, chunk_hashes, chunk_sizes, 0, 16384, 8, &cindex));
+    ASSERT_EQ((TLongtail_Hash*)0, cindex->m_SortedChunkHashes);
+
+    Longtail_ContentIndex* sorted_cindex;
+    ASSERT_EQ(0, Longtail_CreateSortedContentIndex(cindex, &sorted_cindex));
+    ASSERT_NE((TLongtail_Hash*)0, sorted_cindex->m_SortedChunkHashes);
+    ASSERT_EQ(*cindex->m_BlockCount, *sorted_cindex->m_BlockCount);
+    for (uint64_t c = 1; c < chunk_count; ++c)
+    {
+        ASSERT_TRUE(sorted_cindex->m_SortedChunkHashes[c - 1] <= sorted_cindex->m_SortedChunkHashes[c]);
+    }
+
+    ASSERT_EQ(0, Longtail_WriteContentIndex(storage_api, sorted_cindex, "sorted.lci"));
+    Longtail_ContentIndex* mapped_cindex;
+    ASSERT_EQ(0, Longtail_MapContentIndex(storage_api, "sorted.lci", &mapped_cindex));
+    ASSERT_NE((TLongtail_Hash*)0, mapped_cindex->m_SortedChunkHashes);
+
+    for (uint64_t c = 0; c < *cindex->m_ChunkCount; ++c)
+    {
+        uint64_t block_index;
+        ASSERT_EQ(0, Longtail_ContentIndex_LookupChunkBlockIndex(mapped_cindex, cindex->m_ChunkHashes[c], &block_index));
+        ASSERT_EQ(cindex->m_ChunkBlockIndexes[c], block_index);
+        ASSERT_EQ(ENOENT, Longtail_ContentIndex_LookupChunkBlockIndex(mapped_cindex, cindex->m_ChunkHashes[c] + 1, &block_index));
+    }
+    uint64_t block_index;
+    ASSERT_EQ(ENOENT, Longtail_ContentIndex_LookupChunkBlockIndex(mapped_cindex, 0, &block_index));
+    ASSERT_EQ(ENOENT, Longtail_ContentIndex_LookupChunkBlockIndex(mapped_cindex, 0xffffffffffffffffull - 1, &block_index));
+
+    // Missing content against a sorted reference is the same as against an unsorted one
+    Longtail_ContentIndex* partial_cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndexRaw(hash_api, chunk_count / 2, chunk_hashes, chunk_sizes, 0, 16384, 8, &partial_cindex));
+    Longtail_ContentIndex* sorted_partial_cindex;
+    ASSERT_EQ(0, Longtail_CreateSortedContentIndex(partial_cindex, &sorted_partial_cindex));
+    Longtail_ContentIndex* missing_cindex;
+    ASSERT_EQ(0, Longtail_GetMissingContent(*cindex->m_HashIdentifier, partial_cindex, cindex, &missing_cindex));
+    Longtail_ContentIndex* sorted_missing_cindex;
+    ASSERT_EQ(0, Longtail_GetMissingContent(*cindex->m_HashIdentifier, sorted_partial_cindex, cindex, &sorted_missing_cindex));
+    ASSERT_NE(0u, *missing_cindex->m_BlockCount);
+    ASSERT_EQ(*missing_cindex->m_BlockCount, *sorted_missing_cindex->m_BlockCount);
+    ASSERT_EQ(*missing_cindex->m_ChunkCount, *sorted_missing_cindex->m_ChunkCount);
+    for (uint64_t b = 0; b < *missing_cindex->m_BlockCount; ++b)
+    {
+        ASSERT_EQ(missing_cindex->m_BlockHashes[b], sorted_missing_cindex->m_BlockHashes[b]);
+    }
+
+    // Merging, adding and retargeting keeps the sorted chunk lookup of the inputs
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_ContentIndex* merged_cindex;
+    ASSERT_EQ(0, Longtail_MergeContentIndex(job_api, sorted_partial_cindex, missing_cindex, &merged_cindex));
+    ASSERT_EQ(chunk_count, *merged_cindex->m_ChunkCount);
+    AssertSortedChunkColumns(merged_cindex);
+    Longtail_ContentIndex* added_cindex;
+    ASSERT_EQ(0, Longtail_AddContentIndex(missing_cindex, sorted_partial_cindex, &added_cindex));
+    ASSERT_EQ(*missing_cindex->m_ChunkCount + *sorted_partial_cindex->m_ChunkCount, *added_cindex->m_ChunkCount);
+    AssertSortedChunkColumns(added_cindex);
+    Longtail_ContentIndex* retargeted_cindex;
+    ASSERT_EQ(0, Longtail_RetargetContent(mapped_cindex, partial_cindex, &retargeted_cindex));
+    ASSERT_EQ(chunk_count / 2, *retargeted_cindex->m_ChunkCount);
+    AssertSortedChunkColumns(retargeted_cindex);
+    for (uint64_t c = 0; c < chunk_count / 2; ++c)
+    {
+        ASSERT_EQ(0, Longtail_ContentIndex_LookupChunkBlockIndex(retargeted_cindex, chunk_hashes[c], &block_index));
+        ASSERT_EQ(mapped_cindex->m_BlockHashes[mapped_cindex->m_ChunkBlockIndexes[c]], retargeted_cindex->m_BlockHashes[block_index]);
+    }
+    Longtail_ContentIndex* unsorted_retargeted_cindex;
+    ASSERT_EQ(0, Longtail_RetargetContent(cindex, partial_cindex, &unsorted_retargeted_cindex));
+    ASSERT_EQ((TLongtail_Hash*)0, unsorted_retargeted_cindex->m_SortedChunkHashes);
+
+    Longtail_Free(unsorted_retargeted_cindex);
+    Longtail_Free(retargeted_cindex);
+    Longtail_Free(added_cindex);
+    Longtail_Free(merged_cindex);
+    SAFE_DISPOSE_API(job_api);
+    Longtail_Free(sorted_missing_cindex);
+    Longtail_Free(missing_cindex);
+    Longtail_Free(sorted_partial_cindex);
+    Longtail_Free(partial_cindex);
+    Longtail_UnmapContentIndex(mapped_cindex);
+    Longtail_Free(sorted_cindex);
+    Longtail_Free(cindex);
+    Longtail_Free(chunk_sizes);
+    Longtail_Free(chunk_hashes);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
 TEST(Longtail, Longtail_CreateStoredBlock)
 {
     TLongtail_Hash block_hash = 0x77aa661199bb0011;
@@ -1226,7 +1856,7 @@ TEST(Longtail, Longtail_TestLRUBlockStore)
     Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* local_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, local_storage_api, "chunks", 524288, 1024, 0);
-    Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(local_block_store_api, 3);
+    Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(local_block_store_api, 3, 0, 0);
 
     static const uint32_t BLOCK_COUNT = 7;
     TLongtail_Hash block_hashes[BLOCK_COUNT];
@@ -1414,32 +2044,85 @@ TEST(Longtail, Longtail_TestLRUBlockStore)
     SAFE_DISPOSE_API(local_storage_api);
 }
 
-TEST(Longtail, Longtail_CacheBlockStore)
+TEST(Longtail, Longtail_TestLRUBlockStoreScanResistant)
 {
     Longtail_StorageAPI* local_storage_api = Longtail_CreateInMemStorageAPI();
-    Longtail_StorageAPI* remote_storage_api = Longtail_CreateInMemStorageAPI();
-    Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
     Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* local_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, local_storage_api, "chunks", 524288, 1024, 0);
-    Longtail_BlockStoreAPI* remote_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, remote_storage_api, "chunks", 524288, 1024, 0);
-    Longtail_BlockStoreAPI* cache_block_store_api = Longtail_CreateCacheBlockStoreAPI(job_api, local_block_store_api, remote_block_store_api);
 
-    Longtail_StoredBlock put_block;
-    put_block.Dispose = 0;
-    put_block.m_BlockIndex = 0;
-    put_block.m_BlockData = 0;
+    static const uint32_t BLOCK_COUNT = 8;
+    static const uint32_t BLOCK_CHUNK_SIZES[1] = {1000};
+    TLongtail_Hash block_hashes[BLOCK_COUNT];
+    for (uint32_t b = 0; b < BLOCK_COUNT; ++b)
+    {
+        Longtail_StoredBlock* block = GenerateStoredBlock(hash_api, 1, BLOCK_CHUNK_SIZES);
+        struct TestAsyncPutBlockComplete putCB;
+        ASSERT_EQ(0, local_block_store_api->PutStoredBlock(local_block_store_api, block, &putCB.m_API));
+        putCB.Wait();
+        ASSERT_EQ(0, putCB.m_Err);
+        block_hashes[b] = *block->m_BlockIndex->m_BlockHash;
+        block->Dispose(block);
+    }
 
-    struct TestAsyncGetBlockComplete getCB1;
-    ASSERT_EQ(0, cache_block_store_api->GetStoredBlock(cache_block_store_api, 4711, &getCB1.m_API));
-    getCB1.Wait();
-    struct Longtail_StoredBlock* get_block = getCB1.m_StoredBlock;
-    ASSERT_EQ(ENOENT, getCB1.m_Err);
+    // Room for four blocks by size, blocks 0 and 1 are reused, blocks 2 to 7 are a one-off scan
+    const uint32_t get_order[] = {0, 0, 1, 1, 2, 3, 4, 5, 6, 7, 0, 1};
+    for (int scan_resistant = 0; scan_resistant < 2; ++scan_resistant)
+    {
+        Longtail_BlockStore_Stats local_stats;
+        local_block_store_api->GetStats(local_block_store_api, &local_stats);
+        uint64_t local_get_count = local_stats.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count];
 
-    size_t block_index_size = Longtail_GetBlockIndexSize(2);
-    void* block_index_mem = Longtail_Alloc(block_index_size);
-    put_block.m_BlockIndex = Longtail_InitBlockIndex(block_index_mem, 2);
-    *put_block.m_BlockIndex->m_BlockHash = 0xdeadbeef;
+        Longtail_BlockStoreAPI* lru_block_store_api = Longtail_CreateLRUBlockStoreAPI(local_block_store_api, 0, 4000, scan_resistant);
+        ASSERT_NE((Longtail_BlockStoreAPI*)0, lru_block_store_api);
+        for (uint32_t g = 0; g < sizeof(get_order) / sizeof(get_order[0]); ++g)
+        {
+            struct TestAsyncGetBlockComplete getCB;
+            ASSERT_EQ(0, lru_block_store_api->GetStoredBlock(lru_block_store_api, block_hashes[get_order[g]], &getCB.m_API));
+            getCB.Wait();
+            ASSERT_EQ(0, getCB.m_Err);
+            struct Longtail_StoredBlock* get_block = getCB.m_StoredBlock;
+            ASSERT_EQ(BLOCK_CHUNK_SIZES[0], get_block->m_BlockChunksDataSize);
+            get_block->Dispose(get_block);
+        }
+        local_block_store_api->GetStats(local_block_store_api, &local_stats);
+        local_get_count = local_stats.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count] - local_get_count;
+        ASSERT_EQ(scan_resistant ? BLOCK_COUNT : BLOCK_COUNT + 2, local_get_count);
+        SAFE_DISPOSE_API(lru_block_store_api);
+    }
+
+    SAFE_DISPOSE_API(local_block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(local_storage_api);
+}
+
+TEST(Longtail, Longtail_CacheBlockStore)
+{
+    Longtail_StorageAPI* local_storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_StorageAPI* remote_storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_BlockStoreAPI* local_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, local_storage_api, "chunks", 524288, 1024, 0);
+    Longtail_BlockStoreAPI* remote_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, remote_storage_api, "chunks", 524288, 1024, 0);
+    Longtail_BlockStoreAPI* cache_block_store_api = Longtail_CreateCacheBlockStoreAPI(job_api, local_block_store_api, remote_block_store_api);
+
+    Longtail_StoredBlock put_block;
+    put_block.Dispose = 0;
+    put_block.m_BlockIndex = 0;
+    put_block.m_BlockData = 0;
+
+    struct TestAsyncGetBlockComplete getCB1;
+    ASSERT_EQ(0, cache_block_store_api->GetStoredBlock(cache_block_store_api, 4711, &getCB1.m_API));
+    getCB1.Wait();
+    struct Longtail_StoredBlock* get_block = getCB1.m_StoredBlock;
+    ASSERT_EQ(ENOENT, getCB1.m_Err);
+
+    size_t block_index_size = Longtail_GetBlockIndexSize(2);
+    void* block_index_mem = Longtail_Alloc(block_index_size);
+    put_block.m_BlockIndex = Longtail_InitBlockIndex(block_index_mem, 2);
+    *put_block.m_BlockIndex->m_BlockHash = 0xdeadbeef;
     *put_block.m_BlockIndex->m_HashIdentifier = hash_api->GetIdentifier(hash_api);
     *put_block.m_BlockIndex->m_Tag = 0;
     put_block.m_BlockIndex->m_ChunkHashes[0] = 0xf001fa5;
@@ -1524,7 +2207,7 @@ TEST(Longtail, Longtail_CompressBlockStore)
     Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* local_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, local_storage_api, "chunks", 524288, 1024, 0);
-    Longtail_BlockStoreAPI* compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(local_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* compress_block_store_api = Longtail_CreateCompressBlockStoreAPI(local_block_store_api, compression_registry, 0);
 
     struct TestAsyncGetBlockComplete getCB0;
     ASSERT_EQ(ENOENT, compress_block_store_api->GetStoredBlock(compress_block_store_api, 4711, &getCB0.m_API));
@@ -1807,6 +2490,70 @@ TEST(Longtail, Longtail_TestGetFilesRecursively)
     SAFE_DISPOSE_API(storage);
 }
 
+TEST(Longtail, Longtail_CompressBlockStoreFrames)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_BlockStoreAPI* fs_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", 524288, 1024, 0);
+    static const uint32_t MIN_FRAME_SIZE = 4096;
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry, MIN_FRAME_SIZE);
+
+    static const uint32_t CHUNK_COUNT = 6;
+    static const uint32_t CHUNK_SIZES[CHUNK_COUNT] = {1244, 4323, 711, 2046, 3010, 8192};
+    Longtail_StoredBlock* block = GenerateStoredBlock(hash_api, CHUNK_COUNT, CHUNK_SIZES);
+    ASSERT_NE((Longtail_StoredBlock*)0, block);
+    *block->m_BlockIndex->m_Tag = Longtail_GetZStdDefaultQuality();
+    TLongtail_Hash block_hash = *block->m_BlockIndex->m_BlockHash;
+
+    TestAsyncPutBlockComplete putCB;
+    ASSERT_EQ(0, block_store_api->PutStoredBlock(block_store_api, block, &putCB.m_API));
+    putCB.Wait();
+    ASSERT_EQ(0, putCB.m_Err);
+
+    TestAsyncGetBlockComplete getCB;
+    ASSERT_EQ(0, block_store_api->GetStoredBlock(block_store_api, block_hash, &getCB.m_API));
+    getCB.Wait();
+    ASSERT_EQ(0, getCB.m_Err);
+    ASSERT_EQ(block->m_BlockChunksDataSize, getCB.m_StoredBlock->m_BlockChunksDataSize);
+    ASSERT_EQ(0, memcmp(block->m_BlockData, getCB.m_StoredBlock->m_BlockData, block->m_BlockChunksDataSize));
+    getCB.m_StoredBlock->Dispose(getCB.m_StoredBlock);
+
+    TestAsyncGetBlockComplete getRawCB;
+    ASSERT_EQ(0, fs_block_store_api->GetStoredBlock(fs_block_store_api, block_hash, &getRawCB.m_API));
+    getRawCB.Wait();
+    ASSERT_EQ(0, getRawCB.m_Err);
+    Longtail_StoredBlock* compressed_block = getRawCB.m_StoredBlock;
+
+    char* range_data = (char*)Longtail_Alloc(block->m_BlockChunksDataSize);
+    uint32_t chunk_offsets[CHUNK_COUNT + 1] = {0};
+    for (uint32_t c = 0; c < CHUNK_COUNT; ++c)
+    {
+        chunk_offsets[c + 1] = chunk_offsets[c] + CHUNK_SIZES[c];
+    }
+    for (uint32_t chunk_start = 0; chunk_start < CHUNK_COUNT; ++chunk_start)
+    {
+        for (uint32_t chunk_end = chunk_start + 1; chunk_end <= CHUNK_COUNT; ++chunk_end)
+        {
+            uint32_t range_size = chunk_offsets[chunk_end] - chunk_offsets[chunk_start];
+            memset(range_data, 0, range_size);
+            ASSERT_EQ(0, Longtail_DecompressBlockChunkRange(compression_registry, compressed_block, chunk_start, chunk_end, range_data));
+            ASSERT_EQ(0, memcmp(&((const char*)block->m_BlockData)[chunk_offsets[chunk_start]], range_data, range_size));
+        }
+    }
+    Longtail_Free(range_data);
+    compressed_block->Dispose(compressed_block);
+
+    block->Dispose(block);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(fs_block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(compression_registry);
+    SAFE_DISPOSE_API(storage_api);
+}
+
 TEST(Longtail, Longtail_WriteContent)
 {
     static const uint32_t MAX_BLOCK_SIZE = 32u;
@@ -1819,7 +2566,7 @@ TEST(Longtail, Longtail_WriteContent)
     Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* fs_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, target_storage, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
-    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry, 0);
 
     const char* TEST_FILENAMES[5] = {
         "local/TheLongFile.txt",
@@ -1947,6 +2694,364 @@ TEST(Longtail, Longtail_WriteContent)
     SAFE_DISPOSE_API(source_storage);
 }
 
+TEST(Longtail, Longtail_CreateVersionIndexAndWriteContent)
+{
+    static const uint32_t MAX_BLOCK_SIZE = 65536u * 2u;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 4096u;
+
+    Longtail_StorageAPI* source_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_StorageAPI* target_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_StorageAPI* single_pass_target_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(2, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, target_storage, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+    Longtail_BlockStoreAPI* single_pass_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, single_pass_target_storage, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+
+    const uint32_t ASSET_COUNT = 16;
+    const uint32_t LARGE_ASSET_SIZE = 1024u * 1024u;
+    char* large_data = (char*)Longtail_Alloc(LARGE_ASSET_SIZE);
+    for (uint32_t i = 0; i < LARGE_ASSET_SIZE; ++i)
+    {
+        large_data[i] = (char)((i * 2654435761u) >> 13);
+    }
+    for (uint32_t a = 0; a < ASSET_COUNT; ++a)
+    {
+        char path[64];
+        sprintf(path, "local/%s/asset_%u.bin", (a & 1) ? "odd" : "even", a);
+        ASSERT_NE(0, CreateParentPath(source_storage, path));
+        Longtail_StorageAPI_HOpenFile w;
+        ASSERT_EQ(0, source_storage->OpenWriteFile(source_storage, path, 0, &w));
+        // Every third asset is large, the others are small and some of them are duplicates of each other
+        uint32_t size = (a % 3) == 0 ? LARGE_ASSET_SIZE - a * 4096u : 17u + (a % 4) * 9u;
+        ASSERT_EQ(0, source_storage->Write(source_storage, w, 0, size, &large_data[(a % 3) == 0 ? 0 : (a % 4) * 7u]));
+        source_storage->CloseFile(source_storage, w);
+    }
+    Longtail_Free(large_data);
+
+    Longtail_FileInfos* version_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(source_storage, 0, 0, 0, "local", &version_paths));
+    ASSERT_NE((Longtail_FileInfos*)0, version_paths);
+    uint32_t* compression_types = GetAssetTags(source_storage, version_paths);
+    ASSERT_NE((uint32_t*)0, compression_types);
+
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        source_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "local",
+        version_paths,
+        compression_types,
+        32768,
+        &vindex));
+    Longtail_ContentIndex* cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+        hash_api,
+        vindex,
+        MAX_BLOCK_SIZE,
+        MAX_CHUNKS_PER_BLOCK,
+        &cindex));
+    ASSERT_EQ(0, Longtail_WriteContent(
+        source_storage,
+        block_store_api,
+        job_api,
+        0,
+        0,
+        0,
+        cindex,
+        vindex,
+        "local"));
+
+    Longtail_VersionIndex* single_pass_vindex;
+    Longtail_ContentIndex* single_pass_cindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndexAndWriteContent(
+        source_storage,
+        hash_api,
+        chunker_api,
+        single_pass_block_store_api,
+        job_api,
+        0,
+        0,
+        0,
+        "local",
+        version_paths,
+        compression_types,
+        32768,
+        MAX_BLOCK_SIZE,
+        MAX_CHUNKS_PER_BLOCK,
+        &single_pass_vindex,
+        &single_pass_cindex));
+    Longtail_Free(compression_types);
+    Longtail_Free(version_paths);
+
+    ASSERT_LT(1u, *cindex->m_BlockCount);
+
+    void* buffer;
+    size_t size;
+    void* single_pass_buffer;
+    size_t single_pass_size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(vindex, &buffer, &size));
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(single_pass_vindex, &single_pass_buffer, &single_pass_size));
+    ASSERT_EQ(size, single_pass_size);
+    ASSERT_EQ(0, memcmp(buffer, single_pass_buffer, size));
+    Longtail_Free(single_pass_buffer);
+    Longtail_Free(buffer);
+
+    ASSERT_EQ(0, Longtail_WriteContentIndexToBuffer(cindex, &buffer, &size));
+    ASSERT_EQ(0, Longtail_WriteContentIndexToBuffer(single_pass_cindex, &single_pass_buffer, &single_pass_size));
+    ASSERT_EQ(size, single_pass_size);
+    ASSERT_EQ(0, memcmp(buffer, single_pass_buffer, size));
+    Longtail_Free(single_pass_buffer);
+    Longtail_Free(buffer);
+
+    for (uint64_t b = 0; b < *cindex->m_BlockCount; ++b)
+    {
+        TLongtail_Hash block_hash = cindex->m_BlockHashes[b];
+        TestAsyncGetBlockComplete get_cb;
+        ASSERT_EQ(0, block_store_api->GetStoredBlock(block_store_api, block_hash, &get_cb.m_API));
+        get_cb.Wait();
+        ASSERT_EQ(0, get_cb.m_Err);
+        TestAsyncGetBlockComplete single_pass_get_cb;
+        ASSERT_EQ(0, single_pass_block_store_api->GetStoredBlock(single_pass_block_store_api, block_hash, &single_pass_get_cb.m_API));
+        single_pass_get_cb.Wait();
+        ASSERT_EQ(0, single_pass_get_cb.m_Err);
+        struct Longtail_StoredBlock* stored_block = get_cb.m_StoredBlock;
+        struct Longtail_StoredBlock* single_pass_stored_block = single_pass_get_cb.m_StoredBlock;
+        ASSERT_EQ(stored_block->m_BlockChunksDataSize, single_pass_stored_block->m_BlockChunksDataSize);
+        ASSERT_EQ(0, memcmp(stored_block->m_BlockData, single_pass_stored_block->m_BlockData, stored_block->m_BlockChunksDataSize));
+        stored_block->Dispose(stored_block);
+        single_pass_stored_block->Dispose(single_pass_stored_block);
+    }
+
+    Longtail_Free(single_pass_cindex);
+    Longtail_Free(single_pass_vindex);
+    Longtail_Free(cindex);
+    Longtail_Free(vindex);
+
+    SAFE_DISPOSE_API(single_pass_block_store_api);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(single_pass_target_storage);
+    SAFE_DISPOSE_API(target_storage);
+    SAFE_DISPOSE_API(source_storage);
+}
+
+static void WriteIncrementalTestAsset(Longtail_StorageAPI* storage_api, const char* path, uint32_t size, uint32_t seed)
+{
+    char* data = (char*)Longtail_Alloc(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        data[i] = (char)(((i + seed * 7919u) * 2654435761u) >> 13);
+    }
+    Longtail_StorageAPI_HOpenFile w;
+    ASSERT_EQ(0, storage_api->OpenWriteFile(storage_api, path, 0, &w));
+    ASSERT_EQ(0, storage_api->Write(storage_api, w, 0, size, data));
+    storage_api->CloseFile(storage_api, w);
+    Longtail_Free(data);
+}
+
+TEST(Longtail, Longtail_CreateVersionIndexIncremental)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(2, 0);
+
+    const uint32_t ASSET_COUNT = 8;
+    for (uint32_t a = 0; a < ASSET_COUNT; ++a)
+    {
+        char path[64];
+        sprintf(path, "local/asset_%u.bin", a);
+        ASSERT_NE(0, CreateParentPath(storage_api, path));
+        WriteIncrementalTestAsset(storage_api, path, (a == 0) ? 300000u : 1000u + a * 311u, a);
+    }
+
+    Longtail_FileInfos* file_infos;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, "local", &file_infos));
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, &vindex));
+    Longtail_Free(file_infos);
+    ASSERT_NE((uint64_t*)0, vindex->m_ModificationTimes);
+    for (uint32_t a = 0; a < *vindex->m_AssetCount; ++a)
+    {
+        ASSERT_NE(0u, vindex->m_ModificationTimes[a]);
+    }
+
+    // Tamper with the chunks of the large asset in the previous index, they are only picked up if the asset is not read again
+    void* buffer;
+    size_t size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(vindex, &buffer, &size));
+    Longtail_VersionIndex* previous_vindex;
+    ASSERT_EQ(0, Longtail_ReadVersionIndexFromBuffer(buffer, size, &previous_vindex));
+    Longtail_Free(buffer);
+    ASSERT_EQ(0, memcmp(vindex->m_FileIds, previous_vindex->m_FileIds, sizeof(uint64_t) * *vindex->m_AssetCount));
+    uint32_t large_asset_index = 0;
+    while (strcmp(&previous_vindex->m_NameData[previous_vindex->m_NameOffsets[large_asset_index]], "asset_0.bin") != 0)
+    {
+        ++large_asset_index;
+    }
+    ASSERT_LT(1u, previous_vindex->m_AssetChunkCounts[large_asset_index]);
+    const TLongtail_Hash TAMPERED_HASH = 0x1234567890abcdefull;
+    previous_vindex->m_ChunkHashes[previous_vindex->m_AssetChunkIndexes[previous_vindex->m_AssetChunkIndexStarts[large_asset_index]]] = TAMPERED_HASH;
+
+    // Change one asset without changing its size and add a new one
+    WriteIncrementalTestAsset(storage_api, "local/asset_1.bin", 1000u + 1u * 311u, 100);
+    WriteIncrementalTestAsset(storage_api, "local/asset_8.bin", 4000u, 8);
+
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, "local", &file_infos));
+    Longtail_VersionIndex* full_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, &full_vindex));
+    Longtail_VersionIndex* incremental_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndexIncremental(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, previous_vindex, &incremental_vindex));
+
+    ASSERT_EQ(*full_vindex->m_AssetCount, *incremental_vindex->m_AssetCount);
+    for (uint32_t a = 0; a < *full_vindex->m_AssetCount; ++a)
+    {
+        const char* path = &full_vindex->m_NameData[full_vindex->m_NameOffsets[a]];
+        ASSERT_STREQ(path, &incremental_vindex->m_NameData[incremental_vindex->m_NameOffsets[a]]);
+        ASSERT_EQ(full_vindex->m_PathHashes[a], incremental_vindex->m_PathHashes[a]);
+        ASSERT_EQ(full_vindex->m_ModificationTimes[a], incremental_vindex->m_ModificationTimes[a]);
+        ASSERT_EQ(full_vindex->m_AssetChunkCounts[a], incremental_vindex->m_AssetChunkCounts[a]);
+        TLongtail_Hash first_chunk_hash = incremental_vindex->m_ChunkHashes[incremental_vindex->m_AssetChunkIndexes[incremental_vindex->m_AssetChunkIndexStarts[a]]];
+        if (strcmp(path, "asset_0.bin") == 0)
+        {
+            ASSERT_EQ(TAMPERED_HASH, first_chunk_hash);
+            ASSERT_NE(full_vindex->m_ContentHashes[a], incremental_vindex->m_ContentHashes[a]);
+        }
+        else
+        {
+            ASSERT_EQ(full_vindex->m_ContentHashes[a], incremental_vindex->m_ContentHashes[a]);
+        }
+    }
+    Longtail_Free(incremental_vindex);
+
+    // Without a previous version index everything is chunked
+    ASSERT_EQ(0, Longtail_CreateVersionIndexIncremental(storage_api, hash_api, chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, 0, &incremental_vindex));
+    void* full_buffer;
+    size_t full_size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(full_vindex, &full_buffer, &full_size));
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(incremental_vindex, &buffer, &size));
+    ASSERT_EQ(full_size, size);
+    ASSERT_EQ(0, memcmp(full_buffer, buffer, size));
+    Longtail_Free(buffer);
+    Longtail_Free(full_buffer);
+    Longtail_Free(incremental_vindex);
+
+    Longtail_Free(full_vindex);
+    Longtail_Free(file_infos);
+    Longtail_Free(previous_vindex);
+    Longtail_Free(vindex);
+
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, VersionIndexChunkerIdentifier)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* hpcdc_chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_ChunkerAPI* fastcdc_chunker_api = Longtail_CreateFastCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(2, 0);
+    ASSERT_NE(Longtail_GetHPCDCChunkerType(), Longtail_GetFastCDCChunkerType());
+    ASSERT_EQ(Longtail_GetHPCDCChunkerType(), Longtail_Chunker_GetIdentifier(hpcdc_chunker_api));
+    ASSERT_EQ(Longtail_GetFastCDCChunkerType(), Longtail_Chunker_GetIdentifier(fastcdc_chunker_api));
+
+    for (uint32_t a = 0; a < 4; ++a)
+    {
+        char path[64];
+        sprintf(path, "local/asset_%u.bin", a);
+        ASSERT_NE(0, CreateParentPath(storage_api, path));
+        WriteIncrementalTestAsset(storage_api, path, 200000u + a * 1013u, a);
+    }
+
+    Longtail_FileInfos* file_infos;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, "local", &file_infos));
+    Longtail_VersionIndex* hpcdc_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, hpcdc_chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, &hpcdc_vindex));
+    ASSERT_EQ(Longtail_GetHPCDCChunkerType(), Longtail_VersionIndex_GetChunkerAPI(hpcdc_vindex));
+    Longtail_VersionIndex* fastcdc_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, fastcdc_chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, &fastcdc_vindex));
+    ASSERT_EQ(Longtail_GetFastCDCChunkerType(), Longtail_VersionIndex_GetChunkerAPI(fastcdc_vindex));
+    ASSERT_EQ((0u << 24) | (0u << 16) | 4u, Longtail_VersionIndex_GetVersion(fastcdc_vindex));
+
+    void* buffer;
+    size_t size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(fastcdc_vindex, &buffer, &size));
+    Longtail_VersionIndex* read_vindex;
+    ASSERT_EQ(0, Longtail_ReadVersionIndexFromBuffer(buffer, size, &read_vindex));
+    ASSERT_EQ(Longtail_GetFastCDCChunkerType(), Longtail_VersionIndex_GetChunkerAPI(read_vindex));
+    ASSERT_EQ(*fastcdc_vindex->m_ChunkCount, *read_vindex->m_ChunkCount);
+    Longtail_Free(read_vindex);
+
+    // A 0.0.3 version index is the same data without the chunker identifier
+    size_t chunker_identifier_offset = (size_t)((char*)fastcdc_vindex->m_ChunkerIdentifier - (char*)fastcdc_vindex->m_Version);
+    char* legacy_buffer = (char*)Longtail_Alloc(size - sizeof(uint32_t));
+    memcpy(legacy_buffer, buffer, chunker_identifier_offset);
+    memcpy(&legacy_buffer[chunker_identifier_offset], &((char*)buffer)[chunker_identifier_offset + sizeof(uint32_t)], size - chunker_identifier_offset - sizeof(uint32_t));
+    *(uint32_t*)(void*)legacy_buffer = (0u << 24) | (0u << 16) | 3u;
+    ASSERT_EQ(0, Longtail_ReadVersionIndexFromBuffer(legacy_buffer, size - sizeof(uint32_t), &read_vindex));
+    ASSERT_EQ(0u, Longtail_VersionIndex_GetChunkerAPI(read_vindex));
+    ASSERT_EQ(*fastcdc_vindex->m_AssetCount, *read_vindex->m_AssetCount);
+    ASSERT_STREQ(&fastcdc_vindex->m_NameData[fastcdc_vindex->m_NameOffsets[0]], &read_vindex->m_NameData[read_vindex->m_NameOffsets[0]]);
+    void* legacy_write_buffer;
+    size_t legacy_write_size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(read_vindex, &legacy_write_buffer, &legacy_write_size));
+    ASSERT_EQ(size - sizeof(uint32_t), legacy_write_size);
+    Longtail_Free(legacy_write_buffer);
+    Longtail_Free(read_vindex);
+    Longtail_Free(legacy_buffer);
+    Longtail_Free(buffer);
+
+    // Chunks from a previous version index made with another chunker are not reused
+    Longtail_VersionIndex* incremental_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndexIncremental(storage_api, hash_api, fastcdc_chunker_api, job_api, 0, 0, 0, "local", file_infos, 0, 32768, hpcdc_vindex, &incremental_vindex));
+    void* full_buffer;
+    size_t full_size;
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(fastcdc_vindex, &full_buffer, &full_size));
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(incremental_vindex, &buffer, &size));
+    ASSERT_EQ(full_size, size);
+    ASSERT_EQ(0, memcmp(full_buffer, buffer, size));
+    Longtail_Free(buffer);
+    Longtail_Free(full_buffer);
+    Longtail_Free(incremental_vindex);
+
+    // An empty folder can be indexed without a chunker
+    Longtail_FileInfos* empty_file_infos;
+    ASSERT_EQ(0, Longtail_MakeFileInfos(0, 0, 0, 0, &empty_file_infos));
+    Longtail_VersionIndex* empty_vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, 0, job_api, 0, 0, 0, "local", empty_file_infos, 0, 32768, &empty_vindex));
+    ASSERT_EQ(0u, Longtail_VersionIndex_GetChunkerAPI(empty_vindex));
+    // Without a chunker or change stamps it is written in the oldest format so older readers accept it
+    ASSERT_EQ((0u << 24) | (0u << 16) | 2u, Longtail_VersionIndex_GetVersion(empty_vindex));
+    ASSERT_EQ(0, Longtail_WriteVersionIndexToBuffer(empty_vindex, &buffer, &size));
+    ASSERT_EQ(0, Longtail_ReadVersionIndexFromBuffer(buffer, size, &read_vindex));
+    ASSERT_EQ((0u << 24) | (0u << 16) | 2u, Longtail_VersionIndex_GetVersion(read_vindex));
+    ASSERT_EQ(0u, *read_vindex->m_AssetCount);
+    Longtail_Free(read_vindex);
+    Longtail_Free(buffer);
+    Longtail_Free(empty_vindex);
+    Longtail_Free(empty_file_infos);
+
+    Longtail_Free(fastcdc_vindex);
+    Longtail_Free(hpcdc_vindex);
+    Longtail_Free(file_infos);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(fastcdc_chunker_api);
+    SAFE_DISPOSE_API(hpcdc_chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
 #if 0
 TEST(Longtail, TestVeryLargeFile)
 {
@@ -2048,6 +3153,7 @@ TEST(Longtail, Longtail_CreateMissingContent)
         asset_content_hashes,
         0,
         0u,    // Dummy hash identifier
+        0u,    // Dummy chunker identifier
         TARGET_CHUNK_SIZE,
         &version_index));
     Longtail_Free(file_infos);
@@ -2223,7 +3329,7 @@ TEST(Longtail, Longtail_VersionDiff)
     Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* fs_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
-    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry, 0);
 
     const uint32_t OLD_ASSET_COUNT = 10u;
 
@@ -2659,7 +3765,7 @@ TEST(Longtail, Longtail_WriteVersion)
     Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* fs_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
-    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCompressBlockStoreAPI(fs_block_store_api, compression_registry, 0);
 
     const uint32_t asset_count = 8u;
 
@@ -2863,46 +3969,446 @@ TEST(Longtail, Longtail_WriteVersion)
     SAFE_DISPOSE_API(storage_api);
 }
 
-TEST(Longtail, ChunkerLargeFile)
+TEST(Longtail, Longtail_WriteVersionParallelRanges)
 {
-    FILE* large_file = fopen("testdata/chunker.input", "rb");
-    ASSERT_NE((FILE*)0, large_file);
+    static const uint32_t MAX_BLOCK_SIZE = 1024u;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 8u;
+    static const uint32_t ASSET_SIZE = 256u * 1024u;
 
-    fseek(large_file, 0, SEEK_END);
-    long size = ftell(large_file);
-    fseek(large_file, 0, SEEK_SET);
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(4, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
 
-    struct FeederContext
+    // Large enough to need many windows of blocks so it is written as concurrent ranges
+    char* asset_data = (char*)Longtail_Alloc(ASSET_SIZE);
+    uint32_t seed = 0x1234567u;
+    for (uint32_t i = 0; i < ASSET_SIZE; ++i)
     {
-        FILE* f;
-        long size;
-        long offset;
+        seed = seed * 1664525u + 1013904223u;
+        asset_data[i] = (char)(seed >> 24);
+    }
 
-        static int FeederFunc(void* context, Longtail_ChunkerAPI_HChunker chunker, uint32_t requested_size, char* buffer, uint32_t* out_size)
-        {
-            FeederContext* c = (FeederContext*)context;
-            uint32_t read_count = (uint32_t)(c->size - c->offset);
-            if (read_count > 0)
-            {
-                if (requested_size < read_count)
-                {
-                    read_count = requested_size;
-                }
-                int err = fseek(c->f, c->offset, SEEK_SET);
-                if (err)
-                {
-                    return err;
-                }
-                size_t r = fread(buffer, (size_t)read_count, 1, c->f);
-                if (r != 1)
-                {
-                    return errno;
-                }
-            }
-            c->offset += read_count;
-            *out_size = read_count;
-            return 0;
-        }
+    Longtail_StorageAPI_HOpenFile w;
+    ASSERT_EQ(0, storage_api->CreateDir(storage_api, "local"));
+    ASSERT_EQ(0, storage_api->OpenWriteFile(storage_api, "local/huge.bin", 0, &w));
+    ASSERT_EQ(0, storage_api->Write(storage_api, w, 0, ASSET_SIZE, asset_data));
+    storage_api->CloseFile(storage_api, w);
+    ASSERT_EQ(0, storage_api->SetPermissions(storage_api, "local/huge.bin", 0444));
+
+    Longtail_FileInfos* file_infos;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, "local", &file_infos));
+    uint32_t* tags = GetAssetTags(storage_api, file_infos);
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        storage_api,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "local",
+        file_infos,
+        tags,
+        128,
+        &vindex));
+    Longtail_Free(tags);
+    Longtail_Free(file_infos);
+
+    Longtail_ContentIndex* cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+        hash_api,
+        vindex,
+        MAX_BLOCK_SIZE,
+        MAX_CHUNKS_PER_BLOCK,
+        &cindex));
+    ASSERT_GT(*cindex->m_BlockCount, 5u * 8u);
+
+    ASSERT_EQ(0, Longtail_WriteContent(
+        storage_api,
+        block_store_api,
+        job_api,
+        0,
+        0,
+        0,
+        cindex,
+        vindex,
+        "local"));
+
+    ASSERT_EQ(0, Longtail_WriteVersion(
+        block_store_api,
+        storage_api,
+        job_api,
+        0,
+        0,
+        0,
+        cindex,
+        vindex,
+        "remote",
+        1));
+
+    Longtail_StorageAPI_HOpenFile r;
+    ASSERT_EQ(0, storage_api->OpenReadFile(storage_api, "remote/huge.bin", &r));
+    uint64_t size;
+    ASSERT_EQ(0, storage_api->GetSize(storage_api, r, &size));
+    ASSERT_EQ(ASSET_SIZE, size);
+    char* written_data = (char*)Longtail_Alloc(ASSET_SIZE);
+    ASSERT_EQ(0, storage_api->Read(storage_api, r, 0, ASSET_SIZE, written_data));
+    storage_api->CloseFile(storage_api, r);
+    ASSERT_EQ(0, memcmp(asset_data, written_data, ASSET_SIZE));
+    uint16_t permissions;
+    ASSERT_EQ(0, storage_api->GetPermissions(storage_api, "remote/huge.bin", &permissions));
+    ASSERT_EQ(0444, permissions);
+
+    Longtail_Free(written_data);
+    Longtail_Free(asset_data);
+    Longtail_Free(cindex);
+    Longtail_Free(vindex);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, Longtail_SeedBlockStoreChangeVersion)
+{
+    static const uint32_t MAX_BLOCK_SIZE = 4096u;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 16u;
+    static const uint32_t A_SIZE = 64u * 1024u;
+    static const uint32_t B_SIZE = 8u * 1024u;
+
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(4, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+
+    char* a_data = (char*)Longtail_Alloc(A_SIZE);
+    char* b_data = (char*)Longtail_Alloc(B_SIZE);
+    uint32_t seed = 0x7654321u;
+    for (uint32_t i = 0; i < A_SIZE; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        a_data[i] = (char)(seed >> 24);
+    }
+    for (uint32_t i = 0; i < B_SIZE; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        b_data[i] = (char)(seed >> 24);
+    }
+
+    char* old_data = (char*)Longtail_Alloc(B_SIZE);
+    memset(old_data, 0x55, B_SIZE);
+    char* modified_a_data = (char*)Longtail_Alloc(A_SIZE);
+    memcpy(modified_a_data, a_data, A_SIZE);
+    modified_a_data[A_SIZE / 2] = ~modified_a_data[A_SIZE / 2];
+
+    // The local folder has the old version, the new version modifies a.bin, adds c.bin as a copy of b.bin and removes old.bin
+    struct TestFile
+    {
+        const char* m_Path;
+        const char* m_Data;
+        uint32_t m_Size;
+    } test_files[] = {
+        {"local/old.bin", old_data, B_SIZE},
+        {"local/a.bin", a_data, A_SIZE},
+        {"local/b.bin", b_data, B_SIZE},
+        {"source/a.bin", modified_a_data, A_SIZE},
+        {"source/b.bin", b_data, B_SIZE},
+        {"source/c.bin", b_data, B_SIZE}
+    };
+    ASSERT_EQ(0, storage_api->CreateDir(storage_api, "local"));
+    ASSERT_EQ(0, storage_api->CreateDir(storage_api, "source"));
+    for (uint32_t f = 0; f < sizeof(test_files) / sizeof(test_files[0]); ++f)
+    {
+        Longtail_StorageAPI_HOpenFile w;
+        ASSERT_EQ(0, storage_api->OpenWriteFile(storage_api, test_files[f].m_Path, 0, &w));
+        ASSERT_EQ(0, storage_api->Write(storage_api, w, 0, test_files[f].m_Size, test_files[f].m_Data));
+        storage_api->CloseFile(storage_api, w);
+    }
+
+    Longtail_VersionIndex* local_vindex;
+    Longtail_VersionIndex* source_vindex;
+    const char* paths[2] = {"local", "source"};
+    Longtail_VersionIndex** vindexes[2] = {&local_vindex, &source_vindex};
+    for (uint32_t p = 0; p < 2; ++p)
+    {
+        Longtail_FileInfos* file_infos;
+        ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, paths[p], &file_infos));
+        uint32_t* tags = GetAssetTags(storage_api, file_infos);
+        ASSERT_EQ(0, Longtail_CreateVersionIndex(
+            storage_api,
+            hash_api,
+            chunker_api,
+            job_api,
+            0,
+            0,
+            0,
+            paths[p],
+            file_infos,
+            tags,
+            256,
+            vindexes[p]));
+        Longtail_Free(tags);
+        Longtail_Free(file_infos);
+    }
+
+    Longtail_ContentIndex* cindex;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+        hash_api,
+        source_vindex,
+        MAX_BLOCK_SIZE,
+        MAX_CHUNKS_PER_BLOCK,
+        &cindex));
+    ASSERT_EQ(0, Longtail_WriteContent(
+        storage_api,
+        block_store_api,
+        job_api,
+        0,
+        0,
+        0,
+        cindex,
+        source_vindex,
+        "source"));
+
+    Longtail_VersionDiff* version_diff;
+    ASSERT_EQ(0, Longtail_CreateVersionDiff(
+        hash_api,
+        local_vindex,
+        source_vindex,
+        &version_diff));
+
+    Longtail_BlockStoreAPI* seed_block_store_api = Longtail_CreateSeedBlockStoreAPI(
+        storage_api,
+        hash_api,
+        local_vindex,
+        version_diff,
+        "local",
+        block_store_api);
+    ASSERT_NE((Longtail_BlockStoreAPI*)0, seed_block_store_api);
+    ASSERT_EQ(1, storage_api->IsDir(storage_api, "local/.longtail_seed"));
+
+    ASSERT_EQ(0, Longtail_ChangeVersion(
+        seed_block_store_api,
+        storage_api,
+        hash_api,
+        job_api,
+        0,
+        0,
+        0,
+        cindex,
+        local_vindex,
+        source_vindex,
+        version_diff,
+        "local",
+        1));
+
+    struct Longtail_BlockStore_Stats seed_stats;
+    ASSERT_EQ(0, seed_block_store_api->GetStats(seed_block_store_api, &seed_stats));
+    struct Longtail_BlockStore_Stats backing_stats;
+    ASSERT_EQ(0, block_store_api->GetStats(block_store_api, &backing_stats));
+    // Only the block with the modified chunk of a.bin should be fetched from the backing store
+    ASSERT_NE(0u, backing_stats.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count]);
+    ASSERT_LT(backing_stats.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count] * 4, seed_stats.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count]);
+
+    SAFE_DISPOSE_API(seed_block_store_api);
+    ASSERT_EQ(0, storage_api->IsDir(storage_api, "local/.longtail_seed"));
+    ASSERT_EQ(0, storage_api->IsFile(storage_api, "local/old.bin"));
+
+    const char* check_paths[3] = {"local/a.bin", "local/b.bin", "local/c.bin"};
+    const char* check_data[3] = {modified_a_data, b_data, b_data};
+    const uint32_t check_sizes[3] = {A_SIZE, B_SIZE, B_SIZE};
+    char* read_data = (char*)Longtail_Alloc(A_SIZE);
+    for (uint32_t f = 0; f < 3; ++f)
+    {
+        Longtail_StorageAPI_HOpenFile r;
+        ASSERT_EQ(0, storage_api->OpenReadFile(storage_api, check_paths[f], &r));
+        uint64_t size;
+        ASSERT_EQ(0, storage_api->GetSize(storage_api, r, &size));
+        ASSERT_EQ(check_sizes[f], size);
+        ASSERT_EQ(0, storage_api->Read(storage_api, r, 0, size, read_data));
+        storage_api->CloseFile(storage_api, r);
+        ASSERT_EQ(0, memcmp(check_data[f], read_data, size));
+    }
+
+    Longtail_Free(read_data);
+    Longtail_Free(version_diff);
+    Longtail_Free(cindex);
+    Longtail_Free(source_vindex);
+    Longtail_Free(local_vindex);
+    Longtail_Free(modified_a_data);
+    Longtail_Free(old_data);
+    Longtail_Free(b_data);
+    Longtail_Free(a_data);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, Longtail_SeedBlockStoreRecoverStash)
+{
+    static const uint32_t A_SIZE = 16u * 1024u;
+
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(4, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", 4096u, 16u, 0);
+
+    char* a_data = (char*)Longtail_Alloc(A_SIZE);
+    char* old_data = (char*)Longtail_Alloc(A_SIZE);
+    char* modified_a_data = (char*)Longtail_Alloc(A_SIZE);
+    memset(a_data, 0x33, A_SIZE);
+    memset(old_data, 0x55, A_SIZE);
+    memset(modified_a_data, 0x77, A_SIZE);
+
+    // The new version modifies a.bin and removes old.bin, both are moved to the stash
+    struct TestFile
+    {
+        const char* m_Path;
+        const char* m_Data;
+    } test_files[] = {
+        {"local/old.bin", old_data},
+        {"local/sub/a.bin", a_data},
+        {"source/sub/a.bin", modified_a_data}
+    };
+    for (uint32_t f = 0; f < sizeof(test_files) / sizeof(test_files[0]); ++f)
+    {
+        ASSERT_EQ(0, EnsureParentPathExists(storage_api, test_files[f].m_Path));
+        Longtail_StorageAPI_HOpenFile w;
+        ASSERT_EQ(0, storage_api->OpenWriteFile(storage_api, test_files[f].m_Path, 0, &w));
+        ASSERT_EQ(0, storage_api->Write(storage_api, w, 0, A_SIZE, test_files[f].m_Data));
+        storage_api->CloseFile(storage_api, w);
+    }
+
+    Longtail_VersionIndex* local_vindex;
+    Longtail_VersionIndex* source_vindex;
+    const char* paths[2] = {"local", "source"};
+    Longtail_VersionIndex** vindexes[2] = {&local_vindex, &source_vindex};
+    for (uint32_t p = 0; p < 2; ++p)
+    {
+        Longtail_FileInfos* file_infos;
+        ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, paths[p], &file_infos));
+        uint32_t* tags = GetAssetTags(storage_api, file_infos);
+        ASSERT_EQ(0, Longtail_CreateVersionIndex(
+            storage_api,
+            hash_api,
+            chunker_api,
+            job_api,
+            0,
+            0,
+            0,
+            paths[p],
+            file_infos,
+            tags,
+            256,
+            vindexes[p]));
+        Longtail_Free(tags);
+        Longtail_Free(file_infos);
+    }
+
+    Longtail_VersionDiff* version_diff;
+    ASSERT_EQ(0, Longtail_CreateVersionDiff(
+        hash_api,
+        local_vindex,
+        source_vindex,
+        &version_diff));
+
+    Longtail_BlockStoreAPI* seed_block_store_api = Longtail_CreateSeedBlockStoreAPI(
+        storage_api,
+        hash_api,
+        local_vindex,
+        version_diff,
+        "local",
+        block_store_api);
+    ASSERT_NE((Longtail_BlockStoreAPI*)0, seed_block_store_api);
+    ASSERT_EQ(1, storage_api->IsDir(storage_api, "local/.longtail_seed"));
+    ASSERT_EQ(0, storage_api->IsFile(storage_api, "local/old.bin"));
+    ASSERT_EQ(0, storage_api->IsFile(storage_api, "local/sub/a.bin"));
+
+    // As if the process was killed while the files were stashed and the sub folder was removed
+    ASSERT_EQ(0, storage_api->RemoveDir(storage_api, "local/sub"));
+    ASSERT_EQ(0, Longtail_RecoverSeedBlockStoreStash(storage_api, "local"));
+    ASSERT_EQ(0, storage_api->IsDir(storage_api, "local/.longtail_seed"));
+    ASSERT_EQ(0, Longtail_RecoverSeedBlockStoreStash(storage_api, "local"));
+
+    // Disposing the seed block store afterwards leaves the recovered files alone
+    SAFE_DISPOSE_API(seed_block_store_api);
+
+    const char* check_paths[2] = {"local/old.bin", "local/sub/a.bin"};
+    const char* check_data[2] = {old_data, a_data};
+    char* read_data = (char*)Longtail_Alloc(A_SIZE);
+    for (uint32_t f = 0; f < 2; ++f)
+    {
+        Longtail_StorageAPI_HOpenFile r;
+        ASSERT_EQ(0, storage_api->OpenReadFile(storage_api, check_paths[f], &r));
+        uint64_t size;
+        ASSERT_EQ(0, storage_api->GetSize(storage_api, r, &size));
+        ASSERT_EQ(A_SIZE, size);
+        ASSERT_EQ(0, storage_api->Read(storage_api, r, 0, size, read_data));
+        storage_api->CloseFile(storage_api, r);
+        ASSERT_EQ(0, memcmp(check_data[f], read_data, size));
+    }
+
+    Longtail_Free(read_data);
+    Longtail_Free(version_diff);
+    Longtail_Free(source_vindex);
+    Longtail_Free(local_vindex);
+    Longtail_Free(modified_a_data);
+    Longtail_Free(old_data);
+    Longtail_Free(a_data);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, ChunkerLargeFile)
+{
+    FILE* large_file = fopen("testdata/chunker.input", "rb");
+    ASSERT_NE((FILE*)0, large_file);
+
+    fseek(large_file, 0, SEEK_END);
+    long size = ftell(large_file);
+    fseek(large_file, 0, SEEK_SET);
+
+    struct FeederContext
+    {
+        FILE* f;
+        long size;
+        long offset;
+
+        static int FeederFunc(void* context, Longtail_ChunkerAPI_HChunker chunker, uint32_t requested_size, char* buffer, uint32_t* out_size)
+        {
+            FeederContext* c = (FeederContext*)context;
+            uint32_t read_count = (uint32_t)(c->size - c->offset);
+            if (read_count > 0)
+            {
+                if (requested_size < read_count)
+                {
+                    read_count = requested_size;
+                }
+                int err = fseek(c->f, c->offset, SEEK_SET);
+                if (err)
+                {
+                    return err;
+                }
+                size_t r = fread(buffer, (size_t)read_count, 1, c->f);
+                if (r != 1)
+                {
+                    return errno;
+                }
+            }
+            c->offset += read_count;
+            *out_size = read_count;
+            return 0;
+        }
     };
 
     FeederContext feeder_context = {large_file, size, 0};
@@ -2958,13 +4464,197 @@ TEST(Longtail, ChunkerLargeFile)
     ASSERT_EQ((const uint8_t*)0, r.buf);
     ASSERT_EQ(0, r.len);
 
-    chunker_api->DisposeChunker(chunker_api, chunker);
-    chunker = 0;
+    chunker_api->DisposeChunker(chunker_api, chunker);
+    chunker = 0;
+
+    fclose(large_file);
+    large_file = 0;
+
+    SAFE_DISPOSE_API(chunker_api);
+}
+
+struct MemoryChunkerFeeder
+{
+    const char* m_Data;
+    uint32_t m_Size;
+    uint32_t m_Offset;
+
+    static int FeederFunc(void* context, Longtail_ChunkerAPI_HChunker chunker, uint32_t requested_size, char* buffer, uint32_t* out_size)
+    {
+        MemoryChunkerFeeder* c = (MemoryChunkerFeeder*)context;
+        uint32_t read_count = c->m_Size - c->m_Offset;
+        if (requested_size < read_count)
+        {
+            read_count = requested_size;
+        }
+        memcpy(buffer, &c->m_Data[c->m_Offset], read_count);
+        c->m_Offset += read_count;
+        *out_size = read_count;
+        return 0;
+    }
+};
+
+static uint32_t ChunkMemory(Longtail_ChunkerAPI* chunker_api, const char* data, uint32_t size, uint32_t min, uint32_t avg, uint32_t max, Longtail_Chunker_ChunkRange* out_chunks, uint32_t max_chunk_count)
+{
+    Longtail_ChunkerAPI_HChunker chunker;
+    if (chunker_api->CreateChunker(chunker_api, min, avg, max, &chunker))
+    {
+        return 0;
+    }
+    MemoryChunkerFeeder feeder = {data, size, 0};
+    uint32_t chunk_count = 0;
+    Longtail_Chunker_ChunkRange r;
+    while (chunk_count < max_chunk_count && chunker_api->NextChunk(chunker_api, chunker, MemoryChunkerFeeder::FeederFunc, &feeder, &r) == 0)
+    {
+        out_chunks[chunk_count++] = r;
+    }
+    chunker_api->DisposeChunker(chunker_api, chunker);
+    return chunk_count;
+}
+
+TEST(Longtail, FastCDCChunker)
+{
+    FILE* large_file = fopen("testdata/chunker.input", "rb");
+    ASSERT_NE((FILE*)0, large_file);
+    fseek(large_file, 0, SEEK_END);
+    uint32_t size = (uint32_t)ftell(large_file);
+    fseek(large_file, 0, SEEK_SET);
+
+    // Room for inserted data further down
+    const uint32_t INSERT_OFFSET = 300000u;
+    const uint32_t INSERT_SIZE = 1000u;
+    char* data = (char*)Longtail_Alloc(size + INSERT_SIZE);
+    ASSERT_EQ(1u, fread(data, size, 1, large_file));
+    fclose(large_file);
+
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateFastCDCChunkerAPI();
+    ASSERT_NE((Longtail_ChunkerAPI*)0, chunker_api);
+    uint32_t min_chunk_size;
+    ASSERT_EQ(0, chunker_api->GetMinChunkSize(chunker_api, &min_chunk_size));
+    ASSERT_EQ(64u, min_chunk_size);
+
+    const uint32_t ChunkSizeAvg = 64 * 1024;
+    const uint32_t ChunkSizeMin = ChunkSizeAvg / 4;
+    const uint32_t ChunkSizeMax = ChunkSizeAvg * 4;
+
+    // Changing these means existing FastCDC chunked versions will no longer match new indexing
+    const uint32_t expected_chunk_count = 14u;
+    const struct Longtail_Chunker_ChunkRange expected_chunks[expected_chunk_count] =
+    {
+        { (const uint8_t*)0, 0,       79407},
+        { (const uint8_t*)0, 79407,   113095},
+        { (const uint8_t*)0, 192502,  91638},
+        { (const uint8_t*)0, 284140,  83887},
+        { (const uint8_t*)0, 368027,  67112},
+        { (const uint8_t*)0, 435139,  66733},
+        { (const uint8_t*)0, 501872,  34266},
+        { (const uint8_t*)0, 536138,  18451},
+        { (const uint8_t*)0, 554589,  81418},
+        { (const uint8_t*)0, 636007,  94543},
+        { (const uint8_t*)0, 730550,  89273},
+        { (const uint8_t*)0, 819823,  65852},
+        { (const uint8_t*)0, 885675,  73554},
+        { (const uint8_t*)0, 959229,  89347}
+    };
+
+    Longtail_Chunker_ChunkRange chunks[64];
+    ASSERT_EQ(expected_chunk_count, ChunkMemory(chunker_api, data, size, ChunkSizeMin, ChunkSizeAvg, ChunkSizeMax, chunks, 64));
+    for (uint32_t i = 0; i < expected_chunk_count; ++i)
+    {
+        ASSERT_EQ(expected_chunks[i].offset, chunks[i].offset);
+        ASSERT_EQ(expected_chunks[i].len, chunks[i].len);
+    }
+
+    // Inserting data only changes the chunks around the insertion point
+    memmove(&data[INSERT_OFFSET + INSERT_SIZE], &data[INSERT_OFFSET], size - INSERT_OFFSET);
+    memset(&data[INSERT_OFFSET], 0x5a, INSERT_SIZE);
+    Longtail_Chunker_ChunkRange shifted_chunks[64];
+    uint32_t shifted_chunk_count = ChunkMemory(chunker_api, data, size + INSERT_SIZE, ChunkSizeMin, ChunkSizeAvg, ChunkSizeMax, shifted_chunks, 64);
+    ASSERT_NE(0u, shifted_chunk_count);
+    uint32_t kept_count = 0;
+    for (uint32_t i = 0; i < expected_chunk_count; ++i)
+    {
+        uint64_t shifted_offset = expected_chunks[i].offset + (expected_chunks[i].offset >= INSERT_OFFSET ? INSERT_SIZE : 0);
+        for (uint32_t s = 0; s < shifted_chunk_count; ++s)
+        {
+            if (shifted_chunks[s].offset == shifted_offset && shifted_chunks[s].len == expected_chunks[i].len)
+            {
+                ++kept_count;
+                break;
+            }
+        }
+    }
+    ASSERT_LE(expected_chunk_count - 2, kept_count);
+
+    // Every chunk but the last is within the size limits
+    for (uint32_t s = 0; s < shifted_chunk_count; ++s)
+    {
+        ASSERT_GE(ChunkSizeMax, shifted_chunks[s].len);
+        if (s + 1 < shifted_chunk_count)
+        {
+            ASSERT_LE(ChunkSizeMin, shifted_chunks[s].len);
+            ASSERT_EQ(shifted_chunks[s].offset + shifted_chunks[s].len, shifted_chunks[s + 1].offset);
+        }
+    }
+    ASSERT_EQ(size + INSERT_SIZE, shifted_chunks[shifted_chunk_count - 1].offset + shifted_chunks[shifted_chunk_count - 1].len);
+
+    Longtail_Free(data);
+    SAFE_DISPOSE_API(chunker_api);
+}
+
+static void VerifyChunkFromBuffer(Longtail_ChunkerAPI* chunker_api, const char* data, uint32_t size)
+{
+    const uint32_t ChunkSizeAvg = 64 * 1024;
+    const uint32_t ChunkSizeMin = ChunkSizeAvg / 4;
+    const uint32_t ChunkSizeMax = ChunkSizeAvg * 4;
+
+    Longtail_Chunker_ChunkRange fed_chunks[64];
+    uint32_t fed_chunk_count = ChunkMemory(chunker_api, data, size, ChunkSizeMin, ChunkSizeAvg, ChunkSizeMax, fed_chunks, 64);
+    ASSERT_NE(0u, fed_chunk_count);
+
+    ASSERT_NE((Longtail_Chunker_NextChunkFromBufferFunc)0, chunker_api->NextChunkFromBuffer);
+    Longtail_ChunkerAPI_HChunker chunker;
+    ASSERT_EQ(0, chunker_api->CreateChunker(chunker_api, ChunkSizeMin, ChunkSizeAvg, ChunkSizeMax, &chunker));
+    const char* chunk_start = data;
+    const char* data_end = &data[size];
+    uint32_t chunk_count = 0;
+    while (chunk_start < data_end)
+    {
+        const void* next_chunk_start = 0;
+        ASSERT_EQ(0, Longtail_Chunker_NextChunkFromBuffer(chunker_api, chunker, chunk_start, (uint64_t)(data_end - chunk_start), &next_chunk_start));
+        ASSERT_LT(chunk_count, fed_chunk_count);
+        ASSERT_EQ(fed_chunks[chunk_count].offset, (uint64_t)(chunk_start - data));
+        ASSERT_EQ(fed_chunks[chunk_count].len, (uint32_t)((const char*)next_chunk_start - chunk_start));
+        ++chunk_count;
+        chunk_start = (const char*)next_chunk_start;
+    }
+    ASSERT_EQ(fed_chunk_count, chunk_count);
+    ASSERT_EQ(0, chunker_api->DisposeChunker(chunker_api, chunker));
+}
+
+TEST(Longtail, ChunkerNextChunkFromBuffer)
+{
+    FILE* large_file = fopen("testdata/chunker.input", "rb");
+    ASSERT_NE((FILE*)0, large_file);
+    fseek(large_file, 0, SEEK_END);
+    uint32_t size = (uint32_t)ftell(large_file);
+    fseek(large_file, 0, SEEK_SET);
+    char* data = (char*)Longtail_Alloc(size);
+    ASSERT_EQ(1u, fread(data, size, 1, large_file));
+    fclose(large_file);
+
+    // Chunking from a buffer must give the same boundaries as feeding the chunker
+    Longtail_ChunkerAPI* hpcdc_chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    VerifyChunkFromBuffer(hpcdc_chunker_api, data, size);
+    VerifyChunkFromBuffer(hpcdc_chunker_api, data, 100000u);
+    SAFE_DISPOSE_API(hpcdc_chunker_api);
 
-    fclose(large_file);
-    large_file = 0;
+    Longtail_ChunkerAPI* fastcdc_chunker_api = Longtail_CreateFastCDCChunkerAPI();
+    VerifyChunkFromBuffer(fastcdc_chunker_api, data, size);
+    VerifyChunkFromBuffer(fastcdc_chunker_api, data, 100000u);
+    SAFE_DISPOSE_API(fastcdc_chunker_api);
 
-    SAFE_DISPOSE_API(chunker_api);
+    Longtail_Free(data);
 }
 
 TEST(Longtail, FileSystemStorage)
@@ -3560,7 +5250,7 @@ TEST(Longtail, AsyncBlockStore)
     TestAsyncBlockStore block_store;
     ASSERT_EQ(0, TestAsyncBlockStore::InitBlockStore(&block_store, hash_api, job_api));
     struct Longtail_BlockStoreAPI* async_block_store_api = &block_store.m_API; 
-    Longtail_BlockStoreAPI* compressed_block_store_api = Longtail_CreateCompressBlockStoreAPI(async_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* compressed_block_store_api = Longtail_CreateCompressBlockStoreAPI(async_block_store_api, compression_registry, 0);
     Longtail_BlockStoreAPI* block_store_api = Longtail_CreateCacheBlockStoreAPI(job_api, cache_block_store, compressed_block_store_api);
 
 #define TO_ACTUAL_TEST
@@ -4019,6 +5709,10 @@ TEST(Longtail, TestFullHashRegistry)
     ASSERT_EQ(0, hash_registry->GetHashAPI(hash_registry, Longtail_GetMeowHashType(), &meow_hash_api));
     ASSERT_NE((struct Longtail_HashAPI*)0, meow_hash_api);
 
+    struct Longtail_HashAPI* xxh3_hash_api = 0;
+    ASSERT_EQ(0, hash_registry->GetHashAPI(hash_registry, Longtail_GetXXH3HashType(), &xxh3_hash_api));
+    ASSERT_NE((struct Longtail_HashAPI*)0, xxh3_hash_api);
+
     struct Longtail_HashAPI* error_hash_api = 0;
     ASSERT_EQ(ENOENT, hash_registry->GetHashAPI(hash_registry, 0xdeadbeefu, &error_hash_api));
     ASSERT_EQ((struct Longtail_HashAPI*)0, error_hash_api);
@@ -4157,7 +5851,7 @@ TEST(Longtail, TestCreateVersionCancelOperation)
     void* job_ctxs[1] = {&job_context};
     Longtail_JobAPI_Jobs jobs;
 
-    ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, 1, job_funcs, job_ctxs, &jobs));
+    ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, 1, job_funcs, job_ctxs, LONGTAIL_JOB_CLASS_CPU, &jobs));
     ASSERT_EQ(0, job_api->ReadyJobs(job_api, 1, jobs));
     ASSERT_EQ(0, cancel_api->Cancel(cancel_api, cancel_token));
     ASSERT_EQ(0, Longtail_PostSema(sema, 1));
@@ -4196,8 +5890,8 @@ TEST(Longtail, TestChangeVersionCancelOperation)
 
     Longtail_BlockStoreAPI* local_block_store = Longtail_CreateFSBlockStoreAPI(job_api, storage, "cache", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
     Longtail_BlockStoreAPI* cache_block_store_api = Longtail_CreateCacheBlockStoreAPI(job_api, local_block_store, remote_block_store);
-    Longtail_BlockStoreAPI* compressed_remote_block_store = Longtail_CreateCompressBlockStoreAPI(remote_block_store, compression_registry);
-    Longtail_BlockStoreAPI* compressed_cached_block_store = Longtail_CreateCompressBlockStoreAPI(cache_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* compressed_remote_block_store = Longtail_CreateCompressBlockStoreAPI(remote_block_store, compression_registry, 0);
+    Longtail_BlockStoreAPI* compressed_cached_block_store = Longtail_CreateCompressBlockStoreAPI(cache_block_store_api, compression_registry, 0);
 
     const uint32_t ASSET_COUNT = 22u;
 
@@ -5400,6 +7094,9 @@ struct FailableStorageAPI
     static int GetEntryProperties(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HIterator iterator, struct Longtail_StorageAPI_EntryProperties* out_properties) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; return api->m_BackingAPI->GetEntryProperties(api->m_BackingAPI, iterator, out_properties);}
     static int LockFile(struct Longtail_StorageAPI* storage_api, const char* path, Longtail_StorageAPI_HLockFile* out_lock_file) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; return api->m_BackingAPI->LockFile(api->m_BackingAPI, path, out_lock_file);}
     static int UnlockFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HLockFile lock_file) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; return api->m_BackingAPI->UnlockFile(api->m_BackingAPI, lock_file);}
+    static int MapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, Longtail_StorageAPI_HFileMap* out_file_map, const void** out_data_ptr) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; return api->m_BackingAPI->MapFile(api->m_BackingAPI, f, offset, length, out_file_map, out_data_ptr);}
+    static void UnmapFile(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HFileMap file_map) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; api->m_BackingAPI->UnmapFile(api->m_BackingAPI, file_map);}
+    static int AdviseSequentialRead(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f) { struct FailableStorageAPI* api = (struct FailableStorageAPI*)storage_api; return api->m_BackingAPI->AdviseSequentialRead(api->m_BackingAPI, f);}
 };
 
 struct FailableStorageAPI* CreateFailableStorageAPI(struct Longtail_StorageAPI* backing_api)
@@ -5429,7 +7126,10 @@ struct FailableStorageAPI* CreateFailableStorageAPI(struct Longtail_StorageAPI*
         FailableStorageAPI::CloseFind,
         FailableStorageAPI::GetEntryProperties,
         FailableStorageAPI::LockFile,
-        FailableStorageAPI::UnlockFile);
+        FailableStorageAPI::UnlockFile,
+        FailableStorageAPI::MapFile,
+        FailableStorageAPI::UnmapFile,
+        FailableStorageAPI::AdviseSequentialRead);
     struct FailableStorageAPI* failable_storage_api = (struct FailableStorageAPI*)api;
     failable_storage_api->m_BackingAPI = backing_api;
     failable_storage_api->m_PassCount = 0x7fffffff;
@@ -5453,9 +7153,9 @@ TEST(Longtail, TestChangeVersionDiskFull)
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
     Longtail_BlockStoreAPI* local_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, local_storage, "cache", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
     Longtail_BlockStoreAPI* remote_block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, remote_storage, "chunks", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
-    Longtail_BlockStoreAPI* remote_compressed_block_store_api = Longtail_CreateCompressBlockStoreAPI(remote_block_store_api, compression_registry);
+    Longtail_BlockStoreAPI* remote_compressed_block_store_api = Longtail_CreateCompressBlockStoreAPI(remote_block_store_api, compression_registry, 0);
     Longtail_BlockStoreAPI* cached_store_api = Longtail_CreateCacheBlockStoreAPI(job_api, local_block_store_api, remote_block_store_api);
-    Longtail_BlockStoreAPI* cached_compress_store_api = Longtail_CreateCompressBlockStoreAPI(cached_store_api, compression_registry);
+    Longtail_BlockStoreAPI* cached_compress_store_api = Longtail_CreateCompressBlockStoreAPI(cached_store_api, compression_registry, 0);
 
     const uint32_t ASSET_COUNT = 1u;
 
@@ -5662,7 +7362,7 @@ TEST(Longtail, TestLongtailBlockFS)
     Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(8, 0);
     Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
     Longtail_BlockStoreAPI* raw_block_store = Longtail_CreateFSBlockStoreAPI(job_api, mem_storage, "store", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
-    Longtail_BlockStoreAPI* block_store = Longtail_CreateCompressBlockStoreAPI(raw_block_store, compression_registry);
+    Longtail_BlockStoreAPI* block_store = Longtail_CreateCompressBlockStoreAPI(raw_block_store, compression_registry, 0);
 
 //    printf("\nCreating...\n");
 
@@ -5847,17 +7547,408 @@ TEST(Longtail, TestLongtailBlockFS)
     Longtail_Free(block_store_content_index);
     block_store_content_index = 0;
 
-    Longtail_Free(version_content_index);
-    version_content_index = 0;
+    Longtail_Free(version_content_index);
+    version_content_index = 0;
+
+    Longtail_Free(vindex);
+    vindex = 0;
+
+    Longtail_Free(compression_types);
+    compression_types = 0;
+
+    Longtail_Free(version_paths);
+    version_paths = 0;
+    SAFE_DISPOSE_API(block_store);
+    SAFE_DISPOSE_API(raw_block_store);
+    SAFE_DISPOSE_API(compression_registry);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(mem_storage);
+}
+
+TEST(Longtail, TestLongtailBlockFSSequentialRead)
+{
+    static const uint32_t MAX_BLOCK_SIZE = 4096;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 16u;
+    static const uint32_t FILE_SIZE = MAX_BLOCK_SIZE * 24;
+
+    Longtail_StorageAPI* mem_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(8, 0);
+    Longtail_BlockStoreAPI* block_store = Longtail_CreateFSBlockStoreAPI(job_api, mem_storage, "store", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+
+    char* source_data = (char*)Longtail_Alloc(FILE_SIZE);
+    for (uint32_t i = 0; i < FILE_SIZE; ++i)
+    {
+        source_data[i] = (char)rand();
+    }
+    ASSERT_NE(0, CreateParentPath(mem_storage, "source/data.bin"));
+    Longtail_StorageAPI_HOpenFile w;
+    ASSERT_EQ(0, mem_storage->OpenWriteFile(mem_storage, "source/data.bin", 0, &w));
+    ASSERT_EQ(0, mem_storage->Write(mem_storage, w, 0, FILE_SIZE, source_data));
+    mem_storage->CloseFile(mem_storage, w);
+
+    Longtail_FileInfos* version_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(mem_storage, 0, 0, 0, "source", &version_paths));
+    uint32_t* compression_types = GetAssetTags(mem_storage, version_paths);
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        mem_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "source",
+        version_paths,
+        compression_types,
+        MAX_BLOCK_SIZE / MAX_CHUNKS_PER_BLOCK,
+        &vindex));
+
+    Longtail_ContentIndex* content_index;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+            hash_api,
+            vindex,
+            MAX_BLOCK_SIZE,
+            MAX_CHUNKS_PER_BLOCK,
+            &content_index));
+    ASSERT_EQ(0, Longtail_WriteContent(
+        mem_storage,
+        block_store,
+        job_api,
+        0,
+        0,
+        0,
+        content_index,
+        vindex,
+        "source"));
+    uint64_t block_count = *content_index->m_BlockCount;
+    ASSERT_GT(block_count, 4u);
+
+    struct Longtail_StorageAPI* block_store_fs = Longtail_CreateBlockStoreStorageAPI(
+        hash_api,
+        job_api,
+        block_store,
+        content_index,
+        vindex);
+    ASSERT_NE((struct Longtail_StorageAPI*)0, block_store_fs);
+
+    Longtail_BlockStore_Stats stats_before;
+    block_store->GetStats(block_store, &stats_before);
+
+    // Small sequential reads should fetch each block once
+    char* buf = (char*)Longtail_Alloc(FILE_SIZE);
+    Longtail_StorageAPI_HOpenFile block_store_file;
+    ASSERT_EQ(0, block_store_fs->OpenReadFile(block_store_fs, "data.bin", &block_store_file));
+    for (uint32_t o = 0; o < FILE_SIZE; o += 64)
+    {
+        ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, o, 64, &buf[o]));
+    }
+    ASSERT_EQ(0, memcmp(buf, source_data, FILE_SIZE));
+
+    Longtail_BlockStore_Stats stats_after;
+    block_store->GetStats(block_store, &stats_after);
+    uint64_t get_count = stats_after.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count] - stats_before.m_StatU64[Longtail_BlockStoreAPI_StatU64_GetStoredBlock_Count];
+    ASSERT_LE(get_count, block_count);
+
+    // Seek around and read sequentially again while prefetches may still be pending
+    memset(buf, 0, FILE_SIZE);
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, FILE_SIZE - 100, 100, &buf[FILE_SIZE - 100]));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 0, 1000, buf));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 1000, 1000, &buf[1000]));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 2000, FILE_SIZE / 2 - 2000, &buf[2000]));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, FILE_SIZE / 2, FILE_SIZE / 2 - 100, &buf[FILE_SIZE / 2]));
+    ASSERT_EQ(0, memcmp(buf, source_data, FILE_SIZE));
+    block_store_fs->CloseFile(block_store_fs, block_store_file);
+
+    Longtail_Free(buf);
+    SAFE_DISPOSE_API(block_store_fs);
+    Longtail_Free(content_index);
+    Longtail_Free(vindex);
+    Longtail_Free(compression_types);
+    Longtail_Free(version_paths);
+    Longtail_Free(source_data);
+    SAFE_DISPOSE_API(block_store);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(mem_storage);
+}
+
+TEST(Longtail, TestLongtailBlockFSPrefetchDoesNotBlockRead)
+{
+    static const uint32_t MAX_BLOCK_SIZE = 4096;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 16u;
+    static const uint32_t FILE_SIZE = MAX_BLOCK_SIZE * 8;
+
+    Longtail_StorageAPI* mem_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(4, 0);
+    Longtail_BlockStoreAPI* fs_block_store = Longtail_CreateFSBlockStoreAPI(job_api, mem_storage, "store", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+
+    char* source_data = (char*)Longtail_Alloc(FILE_SIZE);
+    for (uint32_t i = 0; i < FILE_SIZE; ++i)
+    {
+        source_data[i] = (char)rand();
+    }
+    ASSERT_NE(0, CreateParentPath(mem_storage, "source/data.bin"));
+    Longtail_StorageAPI_HOpenFile w;
+    ASSERT_EQ(0, mem_storage->OpenWriteFile(mem_storage, "source/data.bin", 0, &w));
+    ASSERT_EQ(0, mem_storage->Write(mem_storage, w, 0, FILE_SIZE, source_data));
+    mem_storage->CloseFile(mem_storage, w);
+
+    Longtail_FileInfos* version_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(mem_storage, 0, 0, 0, "source", &version_paths));
+    uint32_t* compression_types = SetAssetTags(mem_storage, version_paths, 0);
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        mem_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "source",
+        version_paths,
+        compression_types,
+        MAX_BLOCK_SIZE / MAX_CHUNKS_PER_BLOCK,
+        &vindex));
+
+    Longtail_ContentIndex* content_index;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+            hash_api,
+            vindex,
+            MAX_BLOCK_SIZE,
+            MAX_CHUNKS_PER_BLOCK,
+            &content_index));
+    ASSERT_EQ(0, Longtail_WriteContent(
+        mem_storage,
+        fs_block_store,
+        job_api,
+        0,
+        0,
+        0,
+        content_index,
+        vindex,
+        "source"));
+    ASSERT_GT(*content_index->m_BlockCount, 2u);
+
+    // Completes GetStoredBlock on the calling thread, requests for any block but the first one
+    // are held until the gate opens
+    struct GatedBlockStore
+    {
+        struct Longtail_BlockStoreAPI m_API;
+        struct Longtail_BlockStoreAPI* m_Base;
+        TLongtail_Hash m_OpenBlockHash;
+        HLongtail_Sema m_Gate;
+        TLongtail_Atomic32 m_HeldCount;
+        static void Dispose(struct Longtail_API* ) { }
+        static int PutStoredBlock(struct Longtail_BlockStoreAPI* block_store_api, struct Longtail_StoredBlock* stored_block, struct Longtail_AsyncPutStoredBlockAPI* async_complete_api)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            return api->m_Base->PutStoredBlock(api->m_Base, stored_block, async_complete_api);
+        }
+        static int PreflightGet(struct Longtail_BlockStoreAPI* block_store_api, const struct Longtail_ContentIndex* content_index)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            return api->m_Base->PreflightGet(api->m_Base, content_index);
+        }
+        static int GetStoredBlock(struct Longtail_BlockStoreAPI* block_store_api, uint64_t block_hash, struct Longtail_AsyncGetStoredBlockAPI* async_complete_api)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            if (block_hash != api->m_OpenBlockHash)
+            {
+                Longtail_AtomicAdd32(&api->m_HeldCount, 1);
+                Longtail_WaitSema(api->m_Gate, LONGTAIL_TIMEOUT_INFINITE);
+                Longtail_AtomicAdd32(&api->m_HeldCount, -1);
+            }
+            return api->m_Base->GetStoredBlock(api->m_Base, block_hash, async_complete_api);
+        }
+        static int RetargetContent(struct Longtail_BlockStoreAPI* block_store_api, const struct Longtail_ContentIndex* content_index, struct Longtail_AsyncRetargetContentAPI* async_complete_api)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            return api->m_Base->RetargetContent(api->m_Base, content_index, async_complete_api);
+        }
+        static int GetStats(struct Longtail_BlockStoreAPI* block_store_api, struct Longtail_BlockStore_Stats* out_stats)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            return api->m_Base->GetStats(api->m_Base, out_stats);
+        }
+        static int Flush(struct Longtail_BlockStoreAPI* block_store_api, struct Longtail_AsyncFlushAPI* async_complete_api)
+        {
+            struct GatedBlockStore* api = (struct GatedBlockStore*)block_store_api;
+            return api->m_Base->Flush(api->m_Base, async_complete_api);
+        }
+    } gated_store;
+    gated_store.m_Base = fs_block_store;
+    TLongtail_Hash first_chunk_hash = vindex->m_ChunkHashes[vindex->m_AssetChunkIndexes[0]];
+    for (uint64_t c = 0; c < *content_index->m_ChunkCount; ++c)
+    {
+        if (content_index->m_ChunkHashes[c] == first_chunk_hash)
+        {
+            gated_store.m_OpenBlockHash = content_index->m_BlockHashes[content_index->m_ChunkBlockIndexes[c]];
+        }
+    }
+    gated_store.m_HeldCount = 0;
+    void* gate_mem = Longtail_Alloc(Longtail_GetSemaSize());
+    ASSERT_EQ(0, Longtail_CreateSema(gate_mem, 0, &gated_store.m_Gate));
+    struct Longtail_BlockStoreAPI* block_store = Longtail_MakeBlockStoreAPI(
+        &gated_store,
+        GatedBlockStore::Dispose,
+        GatedBlockStore::PutStoredBlock,
+        GatedBlockStore::PreflightGet,
+        GatedBlockStore::GetStoredBlock,
+        GatedBlockStore::RetargetContent,
+        GatedBlockStore::GetStats,
+        GatedBlockStore::Flush);
+
+    struct Longtail_StorageAPI* block_store_fs = Longtail_CreateBlockStoreStorageAPI(
+        hash_api,
+        job_api,
+        block_store,
+        content_index,
+        vindex);
+    ASSERT_NE((struct Longtail_StorageAPI*)0, block_store_fs);
+
+    // The second sequential read starts prefetching the blocks that are held at the gate
+    char* buf = (char*)Longtail_Alloc(FILE_SIZE);
+    Longtail_StorageAPI_HOpenFile block_store_file;
+    ASSERT_EQ(0, block_store_fs->OpenReadFile(block_store_fs, "data.bin", &block_store_file));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 0, 16, buf));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 16, 16, &buf[16]));
+    for (uint32_t i = 0; i < 1000 && gated_store.m_HeldCount == 0; ++i)
+    {
+        Longtail_Sleep(1000);
+    }
+    int32_t held_count = gated_store.m_HeldCount;
+    Longtail_PostSema(gated_store.m_Gate, 1000);
+    // The read returned while the prefetches were still held
+    ASSERT_NE(0, held_count);
+    ASSERT_EQ(0, memcmp(buf, source_data, 32));
+
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 32, FILE_SIZE - 32, &buf[32]));
+    ASSERT_EQ(0, memcmp(buf, source_data, FILE_SIZE));
+    block_store_fs->CloseFile(block_store_fs, block_store_file);
+
+    Longtail_Free(buf);
+    SAFE_DISPOSE_API(block_store_fs);
+    Longtail_DeleteSema(gated_store.m_Gate);
+    Longtail_Free(gate_mem);
+    Longtail_Free(content_index);
+    Longtail_Free(vindex);
+    Longtail_Free(compression_types);
+    Longtail_Free(version_paths);
+    Longtail_Free(source_data);
+    SAFE_DISPOSE_API(block_store);
+    SAFE_DISPOSE_API(fs_block_store);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(mem_storage);
+}
+
+TEST(Longtail, TestLongtailBlockFSPartialDecompression)
+{
+    static const uint32_t MAX_BLOCK_SIZE = 4096;
+    static const uint32_t MAX_CHUNKS_PER_BLOCK = 16u;
+    static const uint32_t MIN_FRAME_SIZE = 1024;
+    static const uint32_t FILE_SIZE = MAX_BLOCK_SIZE * 12;
+
+    Longtail_StorageAPI* mem_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(8, 0);
+    Longtail_CompressionRegistryAPI* compression_registry = Longtail_CreateFullCompressionRegistry();
+    Longtail_BlockStoreAPI* raw_block_store = Longtail_CreateFSBlockStoreAPI(job_api, mem_storage, "store", MAX_BLOCK_SIZE, MAX_CHUNKS_PER_BLOCK, 0);
+    Longtail_BlockStoreAPI* block_store = Longtail_CreateCompressBlockStoreAPI(raw_block_store, compression_registry, MIN_FRAME_SIZE);
+
+    char* source_data = (char*)Longtail_Alloc(FILE_SIZE);
+    for (uint32_t i = 0; i < FILE_SIZE; ++i)
+    {
+        source_data[i] = (char)(rand() % 16);
+    }
+    ASSERT_NE(0, CreateParentPath(mem_storage, "source/data.bin"));
+    Longtail_StorageAPI_HOpenFile w;
+    ASSERT_EQ(0, mem_storage->OpenWriteFile(mem_storage, "source/data.bin", 0, &w));
+    ASSERT_EQ(0, mem_storage->Write(mem_storage, w, 0, FILE_SIZE, source_data));
+    mem_storage->CloseFile(mem_storage, w);
+
+    Longtail_FileInfos* version_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(mem_storage, 0, 0, 0, "source", &version_paths));
+    uint32_t* compression_types = SetAssetTags(mem_storage, version_paths, Longtail_GetZStdDefaultQuality());
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        mem_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "source",
+        version_paths,
+        compression_types,
+        MAX_BLOCK_SIZE / MAX_CHUNKS_PER_BLOCK,
+        &vindex));
+
+    Longtail_ContentIndex* content_index;
+    ASSERT_EQ(0, Longtail_CreateContentIndex(
+            hash_api,
+            vindex,
+            MAX_BLOCK_SIZE,
+            MAX_CHUNKS_PER_BLOCK,
+            &content_index));
+    ASSERT_EQ(0, Longtail_WriteContent(
+        mem_storage,
+        block_store,
+        job_api,
+        0,
+        0,
+        0,
+        content_index,
+        vindex,
+        "source"));
+
+    // Reads go straight to the stored blocks and decompress the frames they need
+    struct Longtail_StorageAPI* block_store_fs = Longtail_CreateBlockStoreStorageAPIWithCompression(
+        hash_api,
+        job_api,
+        raw_block_store,
+        compression_registry,
+        content_index,
+        vindex);
+    ASSERT_NE((struct Longtail_StorageAPI*)0, block_store_fs);
+
+    char* buf = (char*)Longtail_Alloc(FILE_SIZE);
+    Longtail_StorageAPI_HOpenFile block_store_file;
+    ASSERT_EQ(0, block_store_fs->OpenReadFile(block_store_fs, "data.bin", &block_store_file));
+    for (uint32_t o = 0; o < FILE_SIZE; o += 100)
+    {
+        uint32_t s = FILE_SIZE - o < 100 ? FILE_SIZE - o : 100;
+        ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, o, s, &buf[o]));
+    }
+    ASSERT_EQ(0, memcmp(buf, source_data, FILE_SIZE));
 
-    Longtail_Free(vindex);
-    vindex = 0;
+    memset(buf, 0, FILE_SIZE);
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, FILE_SIZE - 7, 7, &buf[FILE_SIZE - 7]));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 3, 5000, &buf[3]));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 0, 3, buf));
+    ASSERT_EQ(0, block_store_fs->Read(block_store_fs, block_store_file, 5003, FILE_SIZE - 5010, &buf[5003]));
+    ASSERT_EQ(0, memcmp(buf, source_data, FILE_SIZE));
+    block_store_fs->CloseFile(block_store_fs, block_store_file);
 
+    Longtail_Free(buf);
+    SAFE_DISPOSE_API(block_store_fs);
+    Longtail_Free(content_index);
+    Longtail_Free(vindex);
     Longtail_Free(compression_types);
-    compression_types = 0;
-
     Longtail_Free(version_paths);
-    version_paths = 0;
+    Longtail_Free(source_data);
     SAFE_DISPOSE_API(block_store);
     SAFE_DISPOSE_API(raw_block_store);
     SAFE_DISPOSE_API(compression_registry);
@@ -5878,6 +7969,306 @@ struct FSBlockStoreSyncWriteContentWorkerContext {
     uint32_t MAX_CHUNKS_PER_BLOCK;
 };
 
+static Longtail_Storage_WriteFunc BlockingWrite_OriginalWrite = 0;
+static HLongtail_Sema BlockingWrite_EnteredSema = 0;
+static HLongtail_Sema BlockingWrite_ReleaseSema = 0;
+static TLongtail_Atomic32 BlockingWrite_CallCount = 0;
+
+static int BlockingWrite(struct Longtail_StorageAPI* storage_api, Longtail_StorageAPI_HOpenFile f, uint64_t offset, uint64_t length, const void* input)
+{
+    if (Longtail_AtomicAdd32(&BlockingWrite_CallCount, 1) == 1)
+    {
+        Longtail_PostSema(BlockingWrite_EnteredSema, 1);
+        Longtail_WaitSema(BlockingWrite_ReleaseSema, LONGTAIL_TIMEOUT_INFINITE);
+    }
+    return BlockingWrite_OriginalWrite(storage_api, f, offset, length, input);
+}
+
+struct PutStoredBlockThreadContext
+{
+    Longtail_BlockStoreAPI* m_BlockStoreAPI;
+    Longtail_StoredBlock* m_StoredBlock;
+    TestAsyncPutBlockComplete* m_PutCB;
+};
+
+static int PutStoredBlockThread(void* context_data)
+{
+    PutStoredBlockThreadContext* ctx = (PutStoredBlockThreadContext*)context_data;
+    return ctx->m_BlockStoreAPI->PutStoredBlock(ctx->m_BlockStoreAPI, ctx->m_StoredBlock, &ctx->m_PutCB->m_API);
+}
+
+TEST(Longtail, TestFSBlockStoreGetWaitsForPut)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", 524288, 1024, 0);
+
+    static const uint32_t BLOCK_CHUNK_SIZES[2] = {1244, 4323};
+    Longtail_StoredBlock* block = GenerateStoredBlock(hash_api, 2, BLOCK_CHUNK_SIZES);
+    TLongtail_Hash block_hash = *block->m_BlockIndex->m_BlockHash;
+
+    // Stall the put inside the first write to storage so the get arrives while the put is in progress
+    ASSERT_EQ(0, Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &BlockingWrite_EnteredSema));
+    ASSERT_EQ(0, Longtail_CreateSema(Longtail_Alloc(Longtail_GetSemaSize()), 0, &BlockingWrite_ReleaseSema));
+    BlockingWrite_CallCount = 0;
+    BlockingWrite_OriginalWrite = storage_api->Write;
+    storage_api->Write = BlockingWrite;
+
+    TestAsyncPutBlockComplete putCB;
+    PutStoredBlockThreadContext ctx = {block_store_api, block, &putCB};
+    HLongtail_Thread put_thread;
+    ASSERT_EQ(0, Longtail_CreateThread(Longtail_Alloc(Longtail_GetThreadSize()), PutStoredBlockThread, 0, &ctx, -1, &put_thread));
+    ASSERT_EQ(0, Longtail_WaitSema(BlockingWrite_EnteredSema, LONGTAIL_TIMEOUT_INFINITE));
+
+    TestAsyncGetBlockComplete getCB;
+    ASSERT_EQ(0, block_store_api->GetStoredBlock(block_store_api, block_hash, &getCB.m_API));
+    Longtail_Sleep(10000);
+    ASSERT_EQ(EINVAL, getCB.m_Err);
+    ASSERT_EQ((Longtail_StoredBlock*)0, getCB.m_StoredBlock);
+
+    Longtail_PostSema(BlockingWrite_ReleaseSema, 1);
+    ASSERT_EQ(0, Longtail_JoinThread(put_thread, LONGTAIL_TIMEOUT_INFINITE));
+    Longtail_DeleteThread(put_thread);
+    Longtail_Free(put_thread);
+    putCB.Wait();
+    ASSERT_EQ(0, putCB.m_Err);
+
+    getCB.Wait();
+    ASSERT_EQ(0, getCB.m_Err);
+    ASSERT_EQ(block_hash, *getCB.m_StoredBlock->m_BlockIndex->m_BlockHash);
+    ASSERT_EQ(block->m_BlockChunksDataSize, getCB.m_StoredBlock->m_BlockChunksDataSize);
+    ASSERT_EQ(0, memcmp(block->m_BlockData, getCB.m_StoredBlock->m_BlockData, block->m_BlockChunksDataSize));
+    getCB.m_StoredBlock->Dispose(getCB.m_StoredBlock);
+
+    storage_api->Write = BlockingWrite_OriginalWrite;
+    Longtail_DeleteSema(BlockingWrite_ReleaseSema);
+    Longtail_Free(BlockingWrite_ReleaseSema);
+    Longtail_DeleteSema(BlockingWrite_EnteredSema);
+    Longtail_Free(BlockingWrite_EnteredSema);
+
+    block->Dispose(block);
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+static uint32_t CountIndexSegments(Longtail_StorageAPI* storage_api, const char* path)
+{
+    Longtail_FileInfos* file_infos = 0;
+    if (Longtail_GetFilesRecursively(storage_api, 0, 0, 0, path, &file_infos))
+    {
+        return 0;
+    }
+    uint32_t count = file_infos->m_Count;
+    Longtail_Free(file_infos);
+    return count;
+}
+
+TEST(Longtail, TestFSBlockStoreIndexSegments)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, "chunks", 524288, 1024, 0, 0, 1);
+
+    static const uint32_t BLOCK_COUNT = 20;
+    static const uint32_t BLOCK_CHUNK_SIZES[2] = {1244, 4323};
+    Longtail_StoredBlock* blocks[BLOCK_COUNT + 1];
+    Longtail_BlockIndex* block_indexes[BLOCK_COUNT + 1];
+    for (uint32_t b = 0; b < BLOCK_COUNT; ++b)
+    {
+        blocks[b] = GenerateStoredBlock(hash_api, 2, BLOCK_CHUNK_SIZES);
+        block_indexes[b] = blocks[b]->m_BlockIndex;
+
+        TestAsyncPutBlockComplete putCB;
+        ASSERT_EQ(0, block_store_api->PutStoredBlock(block_store_api, blocks[b], &putCB.m_API));
+        putCB.Wait();
+        ASSERT_EQ(0, putCB.m_Err);
+        TestAsyncFlushComplete flushCB;
+        ASSERT_EQ(0, block_store_api->Flush(block_store_api, &flushCB.m_API));
+        flushCB.Wait();
+        ASSERT_EQ(0, flushCB.m_Err);
+
+        if (b == 1)
+        {
+            // The first flush writes the full index, later flushes only append a segment
+            Longtail_ContentIndex* base_content_index;
+            ASSERT_EQ(0, Longtail_ReadContentIndex(storage_api, "chunks/store.lci", &base_content_index));
+            ASSERT_EQ(1, *base_content_index->m_BlockCount);
+            Longtail_Free(base_content_index);
+            ASSERT_EQ(1, CountIndexSegments(storage_api, "chunks/store_segments"));
+        }
+    }
+    SAFE_DISPOSE_API(block_store_api);
+
+    // Compaction kicked in when the segment count reached its limit
+    ASSERT_LT(CountIndexSegments(storage_api, "chunks/store_segments"), 16u);
+
+    Longtail_ContentIndex* content_index;
+    ASSERT_EQ(0, Longtail_CreateContentIndexFromBlocks(524288, 1024, BLOCK_COUNT, block_indexes, &content_index));
+    block_store_api = Longtail_CreateFSBlockStoreAPI(job_api, storage_api, "chunks", 524288, 1024, 0);
+    Longtail_ContentIndex* store_content_index = SyncRetargetContent(block_store_api, content_index);
+    ASSERT_NE((Longtail_ContentIndex*)0, store_content_index);
+    ASSERT_EQ(BLOCK_COUNT, *store_content_index->m_BlockCount);
+    ASSERT_EQ(BLOCK_COUNT * 2, *store_content_index->m_ChunkCount);
+    Longtail_Free(store_content_index);
+    Longtail_Free(content_index);
+
+    // Without segmented_store_index a flush folds the segments into a complete store.lci
+    blocks[BLOCK_COUNT] = GenerateStoredBlock(hash_api, 2, BLOCK_CHUNK_SIZES);
+    block_indexes[BLOCK_COUNT] = blocks[BLOCK_COUNT]->m_BlockIndex;
+    TestAsyncPutBlockComplete putCB;
+    ASSERT_EQ(0, block_store_api->PutStoredBlock(block_store_api, blocks[BLOCK_COUNT], &putCB.m_API));
+    putCB.Wait();
+    ASSERT_EQ(0, putCB.m_Err);
+    TestAsyncFlushComplete flushCB;
+    ASSERT_EQ(0, block_store_api->Flush(block_store_api, &flushCB.m_API));
+    flushCB.Wait();
+    ASSERT_EQ(0, flushCB.m_Err);
+    ASSERT_EQ(0u, CountIndexSegments(storage_api, "chunks/store_segments"));
+    Longtail_ContentIndex* base_content_index;
+    ASSERT_EQ(0, Longtail_ReadContentIndex(storage_api, "chunks/store.lci", &base_content_index));
+    ASSERT_EQ(BLOCK_COUNT + 1, *base_content_index->m_BlockCount);
+    Longtail_Free(base_content_index);
+
+    for (uint32_t b = 0; b < BLOCK_COUNT + 1; ++b)
+    {
+        blocks[b]->Dispose(blocks[b]);
+    }
+    SAFE_DISPOSE_API(block_store_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, TestFSBlockStoreFlushReadsOtherStoreBlocks)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+
+    const char* store_paths[2] = {"default", "segmented"};
+    for (int segmented = 0; segmented < 2; ++segmented)
+    {
+        Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, store_paths[segmented], 524288, 1024, 0, 0, segmented);
+        Longtail_BlockStoreAPI* other_block_store_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, store_paths[segmented], 524288, 1024, 0, 0, segmented);
+
+        // The second block is added by another store after the first store has its index in memory
+        static const uint32_t BLOCK_CHUNK_SIZES[2] = {1244, 4323};
+        Longtail_StoredBlock* blocks[3];
+        Longtail_BlockIndex* block_indexes[3];
+        Longtail_BlockStoreAPI* put_block_stores[3] = {block_store_api, other_block_store_api, block_store_api};
+        for (uint32_t b = 0; b < 3; ++b)
+        {
+            blocks[b] = GenerateStoredBlock(hash_api, 2, BLOCK_CHUNK_SIZES);
+            block_indexes[b] = blocks[b]->m_BlockIndex;
+
+            Longtail_BlockStoreAPI* put_block_store = put_block_stores[b];
+            TestAsyncPutBlockComplete putCB;
+            ASSERT_EQ(0, put_block_store->PutStoredBlock(put_block_store, blocks[b], &putCB.m_API));
+            putCB.Wait();
+            ASSERT_EQ(0, putCB.m_Err);
+            TestAsyncFlushComplete flushCB;
+            ASSERT_EQ(0, put_block_store->Flush(put_block_store, &flushCB.m_API));
+            flushCB.Wait();
+            ASSERT_EQ(0, flushCB.m_Err);
+        }
+
+        Longtail_ContentIndex* content_index;
+        ASSERT_EQ(0, Longtail_CreateContentIndexFromBlocks(524288, 1024, 3, block_indexes, &content_index));
+        Longtail_ContentIndex* store_content_index = SyncRetargetContent(block_store_api, content_index);
+        ASSERT_NE((Longtail_ContentIndex*)0, store_content_index);
+        ASSERT_EQ(3u, *store_content_index->m_BlockCount);
+        ASSERT_EQ(6u, *store_content_index->m_ChunkCount);
+        Longtail_Free(store_content_index);
+        Longtail_Free(content_index);
+
+        // Clients that only read store.lci see every block unless the store index is segmented
+        const char* store_index_path = storage_api->ConcatPath(storage_api, store_paths[segmented], "store.lci");
+        Longtail_ContentIndex* base_content_index;
+        ASSERT_EQ(0, Longtail_ReadContentIndex(storage_api, store_index_path, &base_content_index));
+        ASSERT_EQ(segmented ? 1u : 3u, *base_content_index->m_BlockCount);
+        Longtail_Free(base_content_index);
+        Longtail_Free((void*)store_index_path);
+
+        for (uint32_t b = 0; b < 3; ++b)
+        {
+            blocks[b]->Dispose(blocks[b]);
+        }
+        SAFE_DISPOSE_API(other_block_store_api);
+        SAFE_DISPOSE_API(block_store_api);
+    }
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+TEST(Longtail, TestFSBlockStoreSortedStoreIndex)
+{
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateBlake3HashAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+
+    static const uint32_t BLOCK_CHUNK_SIZES[3][2] = {{1244, 4323}, {2344, 323}, {7113, 1921}};
+    Longtail_StoredBlock* blocks[3];
+    for (uint32_t b = 0; b < 3; ++b)
+    {
+        blocks[b] = GenerateStoredBlock(hash_api, 2, BLOCK_CHUNK_SIZES[b]);
+    }
+
+    // The last round reopens the sorted store without the option so it is written back as 1.0.0
+    const char* store_paths[3] = {"default", "sorted", "sorted"};
+    const int store_sorted[3] = {0, 1, 0};
+    for (uint32_t b = 0; b < 3; ++b)
+    {
+        int sorted = store_sorted[b];
+        Longtail_BlockStoreAPI* block_store_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, store_paths[b], 524288, 1024, 0, sorted, 0);
+        TestAsyncPutBlockComplete putCB;
+        ASSERT_EQ(0, block_store_api->PutStoredBlock(block_store_api, blocks[b], &putCB.m_API));
+        putCB.Wait();
+        ASSERT_EQ(0, putCB.m_Err);
+        TestAsyncFlushComplete flushCB;
+        ASSERT_EQ(0, block_store_api->Flush(block_store_api, &flushCB.m_API));
+        flushCB.Wait();
+        ASSERT_EQ(0, flushCB.m_Err);
+        SAFE_DISPOSE_API(block_store_api);
+
+        // Adding a block on top of the existing store.lci keeps the layout of the option
+        block_store_api = Longtail_CreateFSBlockStoreAPIWithOptions(job_api, storage_api, store_paths[b], 524288, 1024, 0, sorted, 0);
+        ASSERT_EQ(0, block_store_api->PutStoredBlock(block_store_api, blocks[(b + 1) % 3], &putCB.m_API));
+        putCB.Wait();
+        ASSERT_EQ(0, putCB.m_Err);
+        ASSERT_EQ(0, block_store_api->Flush(block_store_api, &flushCB.m_API));
+        flushCB.Wait();
+        ASSERT_EQ(0, flushCB.m_Err);
+        SAFE_DISPOSE_API(block_store_api);
+
+        // Older clients only read 1.0.0 so the sorted layout is only written when asked for
+        const char* store_index_path = storage_api->ConcatPath(storage_api, store_paths[b], "store.lci");
+        Longtail_ContentIndex* store_content_index;
+        ASSERT_EQ(0, Longtail_ReadContentIndex(storage_api, store_index_path, &store_content_index));
+        ASSERT_EQ(sorted ? 0x01010000u : 0x01000000u, *store_content_index->m_Version);
+        ASSERT_EQ(sorted != 0, store_content_index->m_SortedChunkHashes != 0);
+        ASSERT_EQ(b == 2 ? 3u : 2u, *store_content_index->m_BlockCount);
+        if (sorted)
+        {
+            AssertSortedChunkColumns(store_content_index);
+        }
+        Longtail_Free(store_content_index);
+        Longtail_Free((void*)store_index_path);
+    }
+
+    for (uint32_t b = 0; b < 3; ++b)
+    {
+        blocks[b]->Dispose(blocks[b]);
+    }
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
 static int FSBlockStoreSyncWriteContentWorker(
     Longtail_StorageAPI* mem_storage,
     Longtail_HashAPI* hash_api,
@@ -6584,3 +8975,311 @@ TEST(Longtail, TestFileSystemLock)
     ASSERT_EQ(0, Longtail_UnlockFile(file_lock));
     Longtail_Free(file_lock);
 }
+
+struct WorkStealingTestContext
+{
+    struct Longtail_JobAPI* m_JobAPI;
+    TLongtail_Atomic32* m_DoneCount;
+    uint32_t m_RootCount;
+    int m_Blocked;
+    int m_Err;
+};
+
+static int WorkStealingTestRootJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    WorkStealingTestContext* c = (WorkStealingTestContext*)context;
+    Longtail_AtomicAdd32(c->m_DoneCount, 1);
+    return 0;
+}
+
+static int WorkStealingTestBlockingJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    WorkStealingTestContext* c = (WorkStealingTestContext*)context;
+    if (c->m_Blocked)
+    {
+        return 0;
+    }
+    // Resume before returning EBUSY, the job must still run again exactly once
+    c->m_Blocked = 1;
+    c->m_JobAPI->ResumeJob(c->m_JobAPI, job_id);
+    return EBUSY;
+}
+
+static int WorkStealingTestFinalJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    WorkStealingTestContext* c = (WorkStealingTestContext*)context;
+    c->m_Err = ((uint32_t)*c->m_DoneCount == c->m_RootCount && c->m_Blocked) ? 0 : EINVAL;
+    return 0;
+}
+
+TEST(Longtail, WorkStealingJobAPI)
+{
+    const uint32_t worker_counts[2] = {0, 4};
+    for (uint32_t w = 0; w < 2; ++w)
+    {
+        Longtail_JobAPI* job_api = Longtail_CreateWorkStealingJobAPI(worker_counts[w], 0);
+        ASSERT_NE((Longtail_JobAPI*)0, job_api);
+        ASSERT_EQ(worker_counts[w], job_api->GetWorkerCount(job_api));
+
+        for (uint32_t run = 0; run < 3; ++run)
+        {
+            const uint32_t root_count = 5000;
+            TLongtail_Atomic32 done_count = 0;
+            WorkStealingTestContext context = {job_api, &done_count, root_count, 0, EINVAL};
+
+            Longtail_JobAPI_Group job_group;
+            ASSERT_EQ(0, job_api->ReserveJobs(job_api, root_count + 2, &job_group));
+
+            Longtail_JobAPI_JobFunc final_funcs[1] = {WorkStealingTestFinalJob};
+            void* final_ctxs[1] = {&context};
+            Longtail_JobAPI_Jobs final_job;
+            ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, 1, final_funcs, final_ctxs, LONGTAIL_JOB_CLASS_CPU, &final_job));
+
+            Longtail_JobAPI_JobFunc blocking_funcs[1] = {WorkStealingTestBlockingJob};
+            void* blocking_ctxs[1] = {&context};
+            Longtail_JobAPI_Jobs blocking_job;
+            ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, 1, blocking_funcs, blocking_ctxs, LONGTAIL_JOB_CLASS_IO, &blocking_job));
+            ASSERT_EQ(0, job_api->AddDependecies(job_api, 1, final_job, 1, blocking_job));
+
+            Longtail_JobAPI_JobFunc* root_funcs = (Longtail_JobAPI_JobFunc*)Longtail_Alloc(sizeof(Longtail_JobAPI_JobFunc) * root_count);
+            void** root_ctxs = (void**)Longtail_Alloc(sizeof(void*) * root_count);
+            for (uint32_t i = 0; i < root_count; ++i)
+            {
+                root_funcs[i] = WorkStealingTestRootJob;
+                root_ctxs[i] = &context;
+            }
+            Longtail_JobAPI_Jobs root_jobs;
+            ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, root_count, root_funcs, root_ctxs, LONGTAIL_JOB_CLASS_CPU, &root_jobs));
+            ASSERT_EQ(0, job_api->AddDependecies(job_api, 1, final_job, root_count, root_jobs));
+            Longtail_Free(root_ctxs);
+            Longtail_Free(root_funcs);
+
+            ASSERT_EQ(0, job_api->ReadyJobs(job_api, 1, blocking_job));
+            ASSERT_EQ(0, job_api->ReadyJobs(job_api, root_count, root_jobs));
+            ASSERT_EQ(0, job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0));
+            ASSERT_EQ(root_count, (uint32_t)done_count);
+            ASSERT_EQ(0, context.m_Err);
+        }
+        SAFE_DISPOSE_API(job_api);
+    }
+
+    // Same version index as with the bikeshed job api
+    Longtail_StorageAPI* storage_api = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateMeowHashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    ASSERT_EQ(1, CreateFakeContent(storage_api, "source", 64));
+    Longtail_FileInfos* file_infos;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(storage_api, 0, 0, 0, "source", &file_infos));
+    Longtail_JobAPI* job_apis[2] = {Longtail_CreateBikeshedJobAPI(2, 0), Longtail_CreateWorkStealingJobAPI(2, 0)};
+    Longtail_VersionIndex* vindexes[2];
+    for (uint32_t j = 0; j < 2; ++j)
+    {
+        ASSERT_EQ(0, Longtail_CreateVersionIndex(storage_api, hash_api, chunker_api, job_apis[j], 0, 0, 0, "source", file_infos, 0, 128, &vindexes[j]));
+    }
+    ASSERT_EQ(*vindexes[0]->m_AssetCount, *vindexes[1]->m_AssetCount);
+    ASSERT_EQ(*vindexes[0]->m_ChunkCount, *vindexes[1]->m_ChunkCount);
+    for (uint32_t a = 0; a < *vindexes[0]->m_AssetCount; ++a)
+    {
+        ASSERT_EQ(vindexes[0]->m_ContentHashes[a], vindexes[1]->m_ContentHashes[a]);
+    }
+    for (uint32_t j = 0; j < 2; ++j)
+    {
+        Longtail_Free(vindexes[j]);
+        SAFE_DISPOSE_API(job_apis[j]);
+    }
+    Longtail_Free(file_infos);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(storage_api);
+}
+
+struct JobClassTestContext
+{
+    TLongtail_Atomic32* m_InFlight;
+    TLongtail_Atomic32* m_MaxInFlight;
+    TLongtail_Atomic32* m_DoneCount;
+};
+
+static int JobClassTestJob(void* context, uint32_t job_id, int is_cancelled)
+{
+    JobClassTestContext* c = (JobClassTestContext*)context;
+    int32_t in_flight = Longtail_AtomicAdd32(c->m_InFlight, 1);
+    int32_t max_in_flight = *c->m_MaxInFlight;
+    while (in_flight > max_in_flight && !Longtail_CompareAndSwap(c->m_MaxInFlight, max_in_flight, in_flight))
+    {
+        max_in_flight = *c->m_MaxInFlight;
+    }
+    Longtail_Sleep(200);
+    Longtail_AtomicAdd32(c->m_InFlight, -1);
+    Longtail_AtomicAdd32(c->m_DoneCount, 1);
+    return 0;
+}
+
+TEST(Longtail, BikeshedJobClassLimits)
+{
+    const uint32_t class_worker_counts[LONGTAIL_JOB_CLASS_COUNT] = {1, 2};
+    const uint32_t class_max_in_flight[LONGTAIL_JOB_CLASS_COUNT] = {0, 2};
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPIWithClasses(4, 0, class_worker_counts, class_max_in_flight);
+    ASSERT_NE((Longtail_JobAPI*)0, job_api);
+    ASSERT_EQ(7u, job_api->GetWorkerCount(job_api));
+
+    const uint32_t job_count = 64;
+    TLongtail_Atomic32 in_flight[LONGTAIL_JOB_CLASS_COUNT] = {0, 0};
+    TLongtail_Atomic32 max_in_flight[LONGTAIL_JOB_CLASS_COUNT] = {0, 0};
+    TLongtail_Atomic32 done_count[LONGTAIL_JOB_CLASS_COUNT] = {0, 0};
+    JobClassTestContext contexts[LONGTAIL_JOB_CLASS_COUNT];
+
+    Longtail_JobAPI_Group job_group;
+    ASSERT_EQ(0, job_api->ReserveJobs(job_api, job_count * LONGTAIL_JOB_CLASS_COUNT, &job_group));
+    for (uint32_t c = 0; c < LONGTAIL_JOB_CLASS_COUNT; ++c)
+    {
+        contexts[c].m_InFlight = &in_flight[c];
+        contexts[c].m_MaxInFlight = &max_in_flight[c];
+        contexts[c].m_DoneCount = &done_count[c];
+        Longtail_JobAPI_JobFunc funcs[job_count];
+        void* ctxs[job_count];
+        for (uint32_t j = 0; j < job_count; ++j)
+        {
+            funcs[j] = JobClassTestJob;
+            ctxs[j] = &contexts[c];
+        }
+        Longtail_JobAPI_Jobs jobs;
+        ASSERT_EQ(0, job_api->CreateJobs(job_api, job_group, job_count, funcs, ctxs, c, &jobs));
+        ASSERT_EQ(0, job_api->ReadyJobs(job_api, job_count, jobs));
+    }
+    ASSERT_EQ(0, job_api->WaitForAllJobs(job_api, job_group, 0, 0, 0));
+
+    ASSERT_EQ(job_count, (uint32_t)done_count[LONGTAIL_JOB_CLASS_CPU]);
+    ASSERT_EQ(job_count, (uint32_t)done_count[LONGTAIL_JOB_CLASS_IO]);
+    ASSERT_LE(max_in_flight[LONGTAIL_JOB_CLASS_IO], 2);
+    ASSERT_GT(max_in_flight[LONGTAIL_JOB_CLASS_CPU], 2);
+
+    SAFE_DISPOSE_API(job_api);
+}
+
+struct StructuredLogCapture
+{
+    uint64_t m_Record[256];
+    uint32_t m_RecordCount;
+};
+
+static void StructuredLogCapture_Log(void* context, const struct Longtail_LogRecord* record)
+{
+    StructuredLogCapture* capture = (StructuredLogCapture*)context;
+    memcpy(capture->m_Record, record, record->m_Size);
+    ++capture->m_RecordCount;
+}
+
+static int CountLogArgumentEvaluation(int* count)
+{
+    return ++(*count);
+}
+
+TEST(Longtail, StructuredLog)
+{
+    StructuredLogCapture capture;
+    capture.m_RecordCount = 0;
+    Longtail_SetStructuredLog(StructuredLogCapture_Log, &capture);
+    Longtail_SetLogLevel(LONGTAIL_LOG_LEVEL_ERROR);
+
+    char name[32];
+    strcpy(name, "block");
+    uint64_t hash = 0x123456789abcdefull;
+    void* ptr = &capture;
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "%s[%3u] %d %" PRIx64 " %" PRIu64 " %p %.2f %-4s| %*d %% %s", name, 7u, -12, hash, hash, ptr, 1.5, "ab", 5, 42, (const char*)0)
+    // Deferred formatting must not depend on the caller's buffers
+    strcpy(name, "xxxxx");
+    ASSERT_EQ(1u, capture.m_RecordCount);
+
+    char expected[256];
+    sprintf(expected, "%s[%3u] %d %" PRIx64 " %" PRIu64 " %p %.2f %-4s| %*d %% %s", "block", 7u, -12, hash, hash, ptr, 1.5, "ab", 5, 42, "(null)");
+    const struct Longtail_LogRecord* record = (const struct Longtail_LogRecord*)capture.m_Record;
+    ASSERT_EQ(LONGTAIL_LOG_LEVEL_ERROR, record->m_Level);
+    char formatted[256];
+    ASSERT_EQ(strlen(expected), Longtail_FormatLogRecord(record, formatted, sizeof(formatted)));
+    ASSERT_STREQ(expected, formatted);
+    ASSERT_EQ(9u, Longtail_FormatLogRecord(record, formatted, 10));
+    ASSERT_EQ(0, strncmp(expected, formatted, 9));
+
+    // Filtered messages do not reach the sink or evaluate their arguments
+    int evaluation_count = 0;
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_WARNING, "%d", CountLogArgumentEvaluation(&evaluation_count))
+    ASSERT_EQ(0, evaluation_count);
+    ASSERT_EQ(1u, capture.m_RecordCount);
+    LONGTAIL_LOG(LONGTAIL_LOG_LEVEL_ERROR, "%d", CountLogArgumentEvaluation(&evaluation_count))
+    ASSERT_EQ(1, evaluation_count);
+    ASSERT_EQ(2u, capture.m_RecordCount);
+
+    Longtail_SetStructuredLog(0, 0);
+    Longtail_SetLogLevel(LONGTAIL_LOG_LEVEL_WARNING);
+}
+
+TEST(Longtail, MetricsAPI)
+{
+    Longtail_StorageAPI* local_storage = Longtail_CreateInMemStorageAPI();
+    Longtail_HashAPI* hash_api = Longtail_CreateMeowHashAPI();
+    Longtail_ChunkerAPI* chunker_api = Longtail_CreateHPCDCChunkerAPI();
+    Longtail_JobAPI* job_api = Longtail_CreateBikeshedJobAPI(0, 0);
+    Longtail_MetricsAPI* metrics_api = Longtail_CreateMetricsAPI();
+    ASSERT_NE((Longtail_MetricsAPI*)0, metrics_api);
+
+    ASSERT_EQ(1, CreateFakeContent(local_storage, "source/version1/two_items", 2));
+    ASSERT_EQ(1, CreateFakeContent(local_storage, "source/version1/five_items", 5));
+
+    // Nothing is reported while no sink is set
+    ASSERT_EQ(0u, Longtail_GetMetricTime());
+    Longtail_FileInfos* version1_paths;
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(local_storage, 0, 0, 0, "source/version1", &version1_paths));
+    Longtail_Free(version1_paths);
+
+    Longtail_SetMetrics(metrics_api);
+    ASSERT_EQ(0, Longtail_GetFilesRecursively(local_storage, 0, 0, 0, "source/version1", &version1_paths));
+    uint32_t* compression_types = GetAssetTags(local_storage, version1_paths);
+    Longtail_VersionIndex* vindex;
+    ASSERT_EQ(0, Longtail_CreateVersionIndex(
+        local_storage,
+        hash_api,
+        chunker_api,
+        job_api,
+        0,
+        0,
+        0,
+        "source/version1",
+        version1_paths,
+        compression_types,
+        16384,
+        &vindex));
+    Longtail_SetMetrics(0);
+
+    uint64_t asset_bytes = 0;
+    for (uint32_t i = 0; i < version1_paths->m_Count; ++i)
+    {
+        asset_bytes += version1_paths->m_Sizes[i];
+    }
+
+    char* text;
+    char expected[128];
+    ASSERT_EQ(0, Longtail_Metrics_FormatPrometheus(metrics_api, &text));
+    sprintf(expected, "longtail_scan_entries_total %u\n", version1_paths->m_Count);
+    ASSERT_NE((const char*)0, strstr(text, expected));
+    sprintf(expected, "longtail_chunk_bytes_total %" PRIu64 "\n", asset_bytes);
+    ASSERT_NE((const char*)0, strstr(text, expected));
+    ASSERT_NE((const char*)0, strstr(text, "longtail_scan_time_seconds_count 1\n"));
+    ASSERT_NE((const char*)0, strstr(text, "longtail_scan_time_seconds_bucket{le=\"+Inf\"} 1\n"));
+    Longtail_Free(text);
+
+    ASSERT_EQ(0, Longtail_Metrics_FormatJSON(metrics_api, &text));
+    sprintf(expected, "{\"name\": \"scan_entries\", \"type\": \"counter\", \"value\": %u}", version1_paths->m_Count);
+    ASSERT_NE((const char*)0, strstr(text, expected));
+    ASSERT_NE((const char*)0, strstr(text, "{\"name\": \"chunk_time\", \"type\": \"timer\", \"unit\": \"ns\", \"count\": 7"));
+    Longtail_Free(text);
+
+    Longtail_Free(vindex);
+    Longtail_Free(compression_types);
+    Longtail_Free(version1_paths);
+    SAFE_DISPOSE_API(metrics_api);
+    SAFE_DISPOSE_API(job_api);
+    SAFE_DISPOSE_API(chunker_api);
+    SAFE_DISPOSE_API(hash_api);
+    SAFE_DISPOSE_API(local_storage);
+}